@@ -37,14 +37,19 @@ LOGDEVICE_STRONG_TYPEDEF(uint64_t, BYTE_OFFSET);
 
 // Declare the type of all the tables used by admin commands.
 
-typedef AdminCommandTable<ClientID, /* Client */
-                          int,      /* Queued total */
-                          int,      /* Queued Immediate */
-                          int,      /* Queued delayed */
-                          int,      /* Record Bytes Queued */
-                          bool,     /* Storage task in flight */
-                          bool,     /* Ping Timer Active */
-                          bool      /* Blocked */
+typedef AdminCommandTable<ClientID,    /* Client */
+                          int,         /* Queued total */
+                          int,         /* Queued Immediate */
+                          int,         /* Queued delayed */
+                          int,         /* Record Bytes Queued */
+                          bool,        /* Storage task in flight */
+                          bool,        /* Ping Timer Active */
+                          bool,        /* Blocked */
+                          uint32_t,    /* Read Weight */
+                          uint64_t,    /* Max Queue Delay Ms */
+                          uint64_t,    /* Avg Queue Delay Ms */
+                          std::string, /* Stream Queue Delays Ms */
+                          bool         /* Waiting For Turn */
                           >
     InfoCatchupQueuesTable;
 
@@ -67,8 +72,9 @@ typedef AdminCommandTable<shard_index_t,              /* Shard */
                           std::chrono::milliseconds,  /* Last Enqueue Time */
                           std::chrono::milliseconds,  /* Last Batch Started Time
                                                        */
-                          bool,    /* Storage task in flight */
-                          uint64_t /* Version */
+                          bool,     /* Storage task in flight */
+                          uint64_t, /* Version */
+                          uint64_t  /* Filtered out bytes */
                           >
     InfoReadersTable;
 
@@ -26,6 +26,7 @@
 #include "logdevice/common/PayloadHolder.h"
 #include "logdevice/common/PeriodicReleases.h"
 #include "logdevice/common/Processor.h"
+#include "logdevice/common/ReleaseBatcher.h"
 #include "logdevice/common/Sender.h"
 #include "logdevice/common/Sequencer.h"
 #include "logdevice/common/TailRecord.h"
@@ -2030,11 +2031,17 @@ void Appender::sendReleases(const ShardID* dests,
           store_hdr_.rid.toString().c_str(),
           ndests);
 
+  const bool batch = getSettings().batch_releases;
   for (size_t dest_num = 0; dest_num < ndests; ++dest_num) {
     const ShardID& dest = dests[dest_num];
 
-    auto release_msg = std::make_unique<RELEASE_Message>(
-        RELEASE_Header({store_hdr_.rid, release_type, dest.shard()}));
+    const RELEASE_Header header{store_hdr_.rid, release_type, dest.shard()};
+    if (batch) {
+      Worker::onThisThread()->releaseBatcher().enqueue(dest, header);
+      continue;
+    }
+
+    auto release_msg = std::make_unique<RELEASE_Message>(header);
 
     int rv = sender_->sendMessage(std::move(release_msg), dest.asNodeID());
     if (rv != 0) {
@@ -36,8 +36,36 @@ DataRecordOwnsPayload::DataRecordOwnsPayload(
       extra_metadata_(std::move(extra_metadata)),
       decoder_(std::move(decoder)) {}
 
+std::unique_ptr<DataRecordOwnsPayload>
+DataRecordOwnsPayload::createWithSharedPayload(
+    logid_t log_id,
+    Payload&& payload,
+    lsn_t lsn,
+    std::chrono::milliseconds timestamp,
+    RECORD_flags_t flags,
+    std::shared_ptr<const void> owner,
+    int batch_offset,
+    uint64_t byte_offset) {
+  auto record = std::make_unique<DataRecordOwnsPayload>(log_id,
+                                                        std::move(payload),
+                                                        lsn,
+                                                        timestamp,
+                                                        flags,
+                                                        nullptr,
+                                                        nullptr,
+                                                        batch_offset,
+                                                        byte_offset);
+  if (record->payload.data()) {
+    ld_check(owner);
+    // Aliasing constructor, like sharePayload() with a decoder
+    record->shared_payload_ =
+        std::shared_ptr<const void>(owner, record->payload.data());
+  }
+  return record;
+}
+
 DataRecordOwnsPayload::~DataRecordOwnsPayload() {
-  if (!decoder_) {
+  if (!decoder_ && !shared_payload_) {
     if (payload.data()) {
       free(const_cast<void*>(payload.data()));
     } else {
@@ -46,4 +74,20 @@ DataRecordOwnsPayload::~DataRecordOwnsPayload() {
   }
 }
 
+std::shared_ptr<const void> DataRecordOwnsPayload::sharePayload() {
+  if (!payload.data()) {
+    return nullptr;
+  }
+  if (decoder_) {
+    // Aliasing constructor: shares ownership of the decoder, which owns the
+    // memory, while pointing at the payload.
+    return std::shared_ptr<const void>(decoder_, payload.data());
+  }
+  if (!shared_payload_) {
+    shared_payload_ = std::shared_ptr<const void>(
+        payload.data(), [](const void* p) { free(const_cast<void*>(p)); });
+  }
+  return shared_payload_;
+}
+
 }} // namespace facebook::logdevice
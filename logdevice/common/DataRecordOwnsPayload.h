@@ -18,12 +18,18 @@ class BufferedWriteDecoder;
 struct ExtraMetadata;
 
 /**
- * Simple wrapper around DataRecord that owns the payload in one of two ways:
+ * Simple wrapper around DataRecord that owns the payload in one of three ways:
  * - Unique ownership, when decoder_ is null.  This is the most common;
  *   DataRecordOwnsPayload will free() the payload.
  * - Shared ownership, when decoder_ is non-null.  This record is part of a
  *   group that was decoded together; decoder_ owns the memory for all of
  *   them.
+ * - Shared ownership of a buffer that outlives the decoder, for records
+ *   created with createWithSharedPayload().
+ *
+ * Unique ownership can be converted into shared ownership with
+ * sharePayload(), which allows views into the payload to outlive the record
+ * without copying it.
  */
 struct DataRecordOwnsPayload : public DataRecord {
   /**
@@ -46,8 +52,32 @@ struct DataRecordOwnsPayload : public DataRecord {
                                  uint64_t byte_offset = BYTE_OFFSET_INVALID,
                                  bool invalid_checksum = false);
 
+  /**
+   * Creates a record whose payload is a soft pointer into memory kept alive
+   * by `owner', e.g. a buffer shared by all records of a decoded batch.  The
+   * memory is released once the last record referencing it is destroyed.
+   */
+  static std::unique_ptr<DataRecordOwnsPayload>
+  createWithSharedPayload(logid_t log_id,
+                          Payload&& payload,
+                          lsn_t lsn,
+                          std::chrono::milliseconds timestamp,
+                          RECORD_flags_t flags,
+                          std::shared_ptr<const void> owner,
+                          int batch_offset = 0,
+                          uint64_t byte_offset = BYTE_OFFSET_INVALID);
+
   ~DataRecordOwnsPayload() override;
 
+  /**
+   * Returns a reference-counted handle keeping the payload memory alive.  The
+   * first call on a uniquely owned payload moves ownership of the malloc()ed
+   * buffer into the returned handle (no copy); subsequent calls return the
+   * same handle.  If the payload is owned by a decoder, the handle shares
+   * ownership of the decoder.  Returns nullptr for empty payloads.
+   */
+  std::shared_ptr<const void> sharePayload();
+
   // flags extracted from the RECORD message
   RECORD_flags_t flags_;
 
@@ -60,6 +90,11 @@ struct DataRecordOwnsPayload : public DataRecord {
 
   // Decoder that owns memory if sharing ownership with other instances
   const std::shared_ptr<BufferedWriteDecoder> decoder_;
+
+ private:
+  // Owns the payload in place of this record once sharePayload() was called,
+  // or from creation for records made by createWithSharedPayload()
+  std::shared_ptr<const void> shared_payload_;
 };
 
 }} // namespace facebook::logdevice
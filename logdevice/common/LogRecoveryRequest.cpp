@@ -18,6 +18,7 @@
 #include "logdevice/common/LogIDUniqueQueue.h"
 #include "logdevice/common/MetaDataLogWriter.h"
 #include "logdevice/common/Processor.h"
+#include "logdevice/common/SealBatcher.h"
 #include "logdevice/common/Sequencer.h"
 #include "logdevice/common/settings/Settings.h"
 #include "logdevice/common/util.h"
@@ -970,8 +971,20 @@ int LogRecoveryRequest::sendSeal(ShardID shard) {
   SEAL_Header header = *seal_header_;
   header.shard = shard.shard();
 
+  Worker* worker = Worker::onThisThread();
+  if (Worker::settings().batch_seals &&
+      worker->sender().registerOnSocketClosed(
+          Address(NodeID(shard.node())), socket_cb) == 0) {
+    // The SEAL will go out in a SEAL_BATCH over the connection we're now
+    // watching. If there is no connection yet, send the SEAL by itself
+    // below, which establishes one. Failures to send the batch are reported
+    // through onSealMessageSent().
+    worker->sealBatcher().enqueue(shard, header);
+    return 0;
+  }
+
   auto msg = std::make_unique<SEAL_Message>(header);
-  return Worker::onThisThread()->sender().sendMessage(
+  return worker->sender().sendMessage(
       std::move(msg), NodeID(shard.node()), &socket_cb);
 }
 
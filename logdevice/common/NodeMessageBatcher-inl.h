@@ -0,0 +1,114 @@
+/**
+ * Copyright (c) 2017-present, Facebook, Inc. and its affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+// override-include-guard
+
+#include "logdevice/common/checks.h"
+#include "logdevice/common/protocol/Message.h"
+
+namespace facebook { namespace logdevice {
+
+template <typename Header, typename Key>
+constexpr size_t NodeMessageBatcher<Header, Key>::MAX_BATCH_SIZE;
+
+template <typename Header, typename Key>
+void NodeMessageBatcher<Header, Key>::enqueue(ShardID shard, Header header) {
+  const NodeID node = shard.asNodeID();
+  NodeBatch& batch = pending_[node];
+
+  folly::Optional<Key> key = getKey(header);
+  if (key.hasValue()) {
+    auto ins = batch.index.emplace(key.value(), batch.headers.size());
+    if (!ins.second) {
+      merge(batch.headers[ins.first->second], header);
+      return;
+    }
+  }
+  batch.headers.push_back(std::move(header));
+
+  if (batch.headers.size() >= max_batch_size_) {
+    std::vector<Header> full = std::move(batch.headers);
+    pending_.erase(node);
+    flushNode(node, std::move(full));
+    return;
+  }
+
+  scheduleFlush();
+}
+
+template <typename Header, typename Key>
+void NodeMessageBatcher<Header, Key>::flush() {
+  // Failures to send call into the senders of the messages, which may queue
+  // more; those go out with the next flush.
+  auto pending = std::move(pending_);
+  pending_.clear();
+  for (auto& kv : pending) {
+    flushNode(kv.first, std::move(kv.second.headers));
+  }
+}
+
+template <typename Header, typename Key>
+void NodeMessageBatcher<Header, Key>::clear() {
+  pending_.clear();
+  cancelFlush();
+}
+
+template <typename Header, typename Key>
+void NodeMessageBatcher<Header, Key>::merge(Header& /*queued*/,
+                                            const Header& /*header*/) {
+  // getKey() must be overridden along with merge().
+  ld_check(false);
+}
+
+template <typename Header, typename Key>
+void NodeMessageBatcher<Header, Key>::flushNode(NodeID node,
+                                                std::vector<Header> headers) {
+  folly::Optional<uint16_t> proto = getPeerProtocol(node);
+  const bool peer_can_batch =
+      proto.hasValue() && proto.value() >= batch_protocol_;
+
+  std::vector<Header> batch;
+  batch.reserve(headers.size());
+  for (Header& header : headers) {
+    if (isStale(node, header)) {
+      continue;
+    }
+    if (peer_can_batch && canBatch(header, proto.value())) {
+      batch.push_back(std::move(header));
+    } else {
+      sendSingle(node, header);
+    }
+  }
+
+  if (batch.size() <= 1) {
+    for (Header& header : batch) {
+      sendSingle(node, header);
+    }
+    return;
+  }
+
+  const size_t nheaders = batch.size();
+  std::unique_ptr<Message> msg = createBatchMessage(std::move(batch));
+  if (sendMessage(msg, node) != 0) {
+    ld_check(msg);
+    onSendFailed(*msg, err, node);
+    return;
+  }
+  onBatchSent(nheaders);
+}
+
+template <typename Header, typename Key>
+void NodeMessageBatcher<Header, Key>::sendSingle(NodeID node,
+                                                 Header& header) {
+  std::unique_ptr<Message> msg = createMessage(header);
+  if (sendMessage(msg, node) != 0) {
+    ld_check(msg);
+    onSendFailed(*msg, err, node);
+  }
+}
+
+}} // namespace facebook::logdevice
@@ -0,0 +1,67 @@
+/**
+ * Copyright (c) 2017-present, Facebook, Inc. and its affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+#include "NodeMessageBatcher.h"
+
+#include "logdevice/common/Address.h"
+#include "logdevice/common/EventLoop.h"
+#include "logdevice/common/LibeventTimer.h"
+#include "logdevice/common/Sender.h"
+#include "logdevice/common/Socket.h"
+#include "logdevice/common/Worker.h"
+#include "logdevice/common/protocol/Message.h"
+
+namespace facebook { namespace logdevice {
+
+NodeMessageBatcherBase::NodeMessageBatcherBase() {}
+
+NodeMessageBatcherBase::~NodeMessageBatcherBase() = default;
+
+folly::Optional<uint16_t> NodeMessageBatcherBase::getPeerProtocol(NodeID node) {
+  Socket* socket =
+      Worker::onThisThread()->sender().findServerSocket(node.index());
+  if (socket == nullptr || !socket->isHandshaken()) {
+    return folly::none;
+  }
+  return socket->getProto();
+}
+
+int NodeMessageBatcherBase::sendMessage(std::unique_ptr<Message>& msg,
+                                        NodeID node) {
+  return Worker::onThisThread()->sender().sendMessage(std::move(msg), node);
+}
+
+void NodeMessageBatcherBase::onSendFailed(const Message& msg,
+                                          Status st,
+                                          NodeID node) {
+  msg.onSent(st, Address(node));
+}
+
+void NodeMessageBatcherBase::scheduleFlush() {
+  if (!flush_timer_) {
+    flush_timer_ = std::make_unique<LibeventTimer>(
+        EventLoop::onThisThread()->getEventBase(), [this] { flush(); });
+  }
+  if (!flush_timer_->isActive()) {
+    // The delay counts from the first message queued since the last flush,
+    // so that no message waits longer than that.
+    const std::chrono::milliseconds delay = getMaxDelay();
+    if (delay.count() > 0) {
+      flush_timer_->activate(delay);
+    } else {
+      flush_timer_->activate(EventLoop::onThisThread()->zero_timeout_);
+    }
+  }
+}
+
+void NodeMessageBatcherBase::cancelFlush() {
+  if (flush_timer_) {
+    flush_timer_->cancel();
+  }
+}
+
+}} // namespace facebook::logdevice
@@ -0,0 +1,214 @@
+/**
+ * Copyright (c) 2017-present, Facebook, Inc. and its affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include <folly/Optional.h>
+
+#include "logdevice/common/NodeID.h"
+#include "logdevice/common/ShardID.h"
+#include "logdevice/include/Err.h"
+#include "logdevice/include/types.h"
+
+namespace facebook { namespace logdevice {
+
+/**
+ * @file Collects messages that a worker sends to storage nodes, and sends
+ *       those addressed to the same node as a single batch message.  Each
+ *       message is described by a header; a header queued with the same key
+ *       (typically log and shard) as one still waiting in the batch is merged
+ *       into it instead of being sent separately.
+ *
+ *       A node's batch is sent getMaxDelay() after the first header was
+ *       queued into it, at the end of the event loop iteration if that is 0,
+ *       or as soon as it reaches the maximum batch size.
+ *
+ *       Headers to nodes that don't speak the protocol of the batch message
+ *       (or with which no connection is established yet), headers that
+ *       canBatch() rejects for the node's protocol, and lone headers are sent
+ *       as individual messages.  When a message can't be sent, it is handed
+ *       to onSendFailed().
+ *
+ *       Not thread-safe; each worker owns its batchers.  See ReleaseBatcher,
+ *       SealBatcher and ClientReadStreamControlBatcher.
+ */
+
+class LibeventTimer;
+class Message;
+
+// Part of NodeMessageBatcher that doesn't depend on the header type.
+class NodeMessageBatcherBase {
+ public:
+  NodeMessageBatcherBase();
+  virtual ~NodeMessageBatcherBase();
+
+  /**
+   * Sends all queued messages.  Called by a timer, see scheduleFlush().
+   */
+  virtual void flush() = 0;
+
+ protected:
+  // The following are overridden in tests.
+
+  /**
+   * @return the protocol spoken on the handshaken connection to `node', or
+   *         folly::none if there is no such connection.
+   */
+  virtual folly::Optional<uint16_t> getPeerProtocol(NodeID node);
+
+  /**
+   * Sends `msg' to `node'.  On failure returns -1 with err set, and `msg' is
+   * left untouched.
+   */
+  virtual int sendMessage(std::unique_ptr<Message>& msg, NodeID node);
+
+  /**
+   * Called with a message that sendMessage() failed to send.  Calls
+   * msg.onSent(), as the messaging layer would have if the message had
+   * failed after being queued.
+   */
+  virtual void onSendFailed(const Message& msg, Status st, NodeID node);
+
+  /**
+   * Makes sure flush() gets called getMaxDelay() from now, or at the end of
+   * the event loop iteration if that is 0.  No-op if already scheduled.
+   */
+  virtual void scheduleFlush();
+
+  /**
+   * How long the first message queued since the last flush may wait.
+   */
+  virtual std::chrono::milliseconds getMaxDelay() const = 0;
+
+  void cancelFlush();
+
+ private:
+  // Created on first use, on the worker thread.
+  std::unique_ptr<LibeventTimer> flush_timer_;
+};
+
+/**
+ * Key of batchers whose headers are never merged.
+ */
+struct NodeMessageBatcherNoKey {
+  bool operator==(const NodeMessageBatcherNoKey& /*other*/) const {
+    return true;
+  }
+
+  struct Hash {
+    size_t operator()(const NodeMessageBatcherNoKey& /*key*/) const {
+      return 0;
+    }
+  };
+};
+
+/**
+ * @param Header  describes one message; may be move-only
+ * @param Key     what identifies headers to merge, with a nested Hash
+ */
+template <typename Header, typename Key = NodeMessageBatcherNoKey>
+class NodeMessageBatcher : public NodeMessageBatcherBase {
+ public:
+  /**
+   * @param batch_protocol  first protocol version that supports the batch
+   *                        message
+   * @param max_batch_size  a node's batch is sent as soon as it has this many
+   *                        headers
+   */
+  explicit NodeMessageBatcher(uint16_t batch_protocol,
+                              size_t max_batch_size = MAX_BATCH_SIZE)
+      : batch_protocol_(batch_protocol), max_batch_size_(max_batch_size) {}
+
+  /**
+   * Queues a message for the node of `shard'.
+   */
+  void enqueue(ShardID shard, Header header);
+
+  void flush() override;
+
+  /**
+   * Drops all queued messages.
+   */
+  void clear();
+
+  // Default maximum number of headers in one batch message.
+  static constexpr size_t MAX_BATCH_SIZE = 4096;
+
+ protected:
+  /**
+   * @return the key of `header', or folly::none if it is never merged with
+   *         other headers.  By default no header is merged.
+   */
+  virtual folly::Optional<Key> getKey(const Header& /*header*/) const {
+    return folly::none;
+  }
+
+  /**
+   * Called when `header' is queued while `queued' has the same key.
+   */
+  virtual void merge(Header& queued, const Header& header);
+
+  /**
+   * Creates the message that sends `header' on its own.
+   */
+  virtual std::unique_ptr<Message> createMessage(Header& header) = 0;
+
+  /**
+   * Creates the batch message that sends `headers' together.
+   */
+  virtual std::unique_ptr<Message>
+  createBatchMessage(std::vector<Header> headers) = 0;
+
+  /**
+   * @return false if `header' can't be sent inside a batch message to a node
+   *         speaking protocol `proto', e.g. because the embedded message
+   *         itself needs a newer protocol.  It is then sent on its own, ahead
+   *         of the batch.
+   */
+  virtual bool canBatch(const Header& /*header*/, uint16_t /*proto*/) const {
+    return true;
+  }
+
+  /**
+   * @return true if `header' is no longer worth sending to `node', e.g.
+   *         because whoever queued it went away.  Checked on flush.
+   */
+  virtual bool isStale(NodeID /*node*/, const Header& /*header*/) {
+    return false;
+  }
+
+  /**
+   * Called after a batch message of `nheaders' headers was sent.  Bumps
+   * stats.
+   */
+  virtual void onBatchSent(size_t /*nheaders*/) {}
+
+ private:
+  struct NodeBatch {
+    std::vector<Header> headers;
+    // Position of the header with each key in `headers'.
+    std::unordered_map<Key, size_t, typename Key::Hash> index;
+  };
+
+  void flushNode(NodeID node, std::vector<Header> headers);
+
+  // Sends `header' on its own.
+  void sendSingle(NodeID node, Header& header);
+
+  const uint16_t batch_protocol_;
+  const size_t max_batch_size_;
+  std::unordered_map<NodeID, NodeBatch, NodeID::Hash> pending_;
+};
+
+}} // namespace facebook::logdevice
+
+#include "logdevice/common/NodeMessageBatcher-inl.h"
@@ -8,6 +8,7 @@
 #pragma once
 
 #include "logdevice/common/ServerRecordFilter.h"
+#include "logdevice/common/ServerRecordSampler.h"
 
 /**
  *  @file (EXPERIMENTAL) Server-side filtering attributes. Used by server
@@ -21,6 +22,10 @@ namespace facebook { namespace logdevice {
  *                              record filtering. @see ServerRecordFilter.h
  *              filter_key1     param for constructing ServerRecordFilter
  *              filter_key2     param for constructing ServerRecordFilter
+ *              sample_mode     If not NONE, storage nodes only ship a sample
+ *                              of the records. @see ServerRecordSampler.h
+ *              sample_param    N for EVERY_NTH, bucket width in milliseconds
+ *                              for TIME_BUCKET
  */
 
 struct ReadStreamAttributes {
@@ -34,22 +39,29 @@ struct ReadStreamAttributes {
   ReadStreamAttributes(const ReadStreamAttributes& rhs)
       : filter_type(rhs.filter_type),
         filter_key1(rhs.filter_key1),
-        filter_key2(rhs.filter_key2) {}
+        filter_key2(rhs.filter_key2),
+        sample_mode(rhs.sample_mode),
+        sample_param(rhs.sample_param) {}
 
   ReadStreamAttributes& operator=(const ReadStreamAttributes& rhs) {
     filter_type = rhs.filter_type;
     filter_key1 = rhs.filter_key1;
     filter_key2 = rhs.filter_key2;
+    sample_mode = rhs.sample_mode;
+    sample_param = rhs.sample_param;
     return *this;
   }
 
   bool operator==(const ReadStreamAttributes& other) const {
     return filter_type == other.filter_type &&
-        filter_key1 == other.filter_key1 && filter_key2 == other.filter_key2;
+        filter_key1 == other.filter_key1 && filter_key2 == other.filter_key2 &&
+        sample_mode == other.sample_mode && sample_param == other.sample_param;
   }
 
   ServerRecordFilterType filter_type;
   std::string filter_key1;
   std::string filter_key2;
+  ServerRecordSampleMode sample_mode{ServerRecordSampleMode::NONE};
+  uint64_t sample_param{0};
 };
 }} // namespace facebook::logdevice
@@ -86,7 +86,10 @@ ReaderImpl::ReaderImpl(size_t max_logs,
                  buffer_size < 0
                      ? processor->settings()->client_read_buffer_size
                      : static_cast<size_t>(buffer_size),
-                 processor->settings()->client_read_flow_control_threshold) {}
+                 processor->settings()->client_read_flow_control_threshold) {
+  buffer_type_ = processor->settings()->client_read_buffer_type;
+  decode_parallelism_ = processor->settings()->client_read_decode_parallelism;
+}
 
 ReaderImpl::ReaderImpl(size_t max_logs,
                        Processor* processor,
@@ -180,6 +183,15 @@ int ReaderImpl::startReading(logid_t log_id,
     return -1;
   }
 
+  if (attrs && !isValidSampleParam(attrs->sample_mode, attrs->sample_param)) {
+    ld_error("invalid sampling parameter %lu for mode %d for log_id %lu",
+             attrs->sample_param,
+             static_cast<int>(attrs->sample_mode),
+             log_id.val_);
+    err = E::INVALID_PARAM;
+    return -1;
+  }
+
   const auto& index = log_states_.get<LogIndex>();
   auto it = index.find(log_id);
   // If we're already reading from this log, first stop that.
@@ -245,6 +257,9 @@ int ReaderImpl::stopReading(logid_t log_id) {
     // the worker.
   }
 
+  if (merge_window_) {
+    merge_discard(state.getReadStreamID());
+  }
   index.erase(it);
   {
     std::lock_guard<std::mutex> guard(health_map_lock_);
@@ -392,6 +407,13 @@ void ReaderImpl::includeByteOffset() {
   include_byte_offset_ = true;
 }
 
+void ReaderImpl::mergeByTimestamp(
+    std::chrono::milliseconds max_out_of_orderness) {
+  ld_check(log_states_.empty());
+  merge_window_ =
+      std::max(max_out_of_orderness, std::chrono::milliseconds::zero());
+}
+
 int ReaderImpl::isConnectionHealthy(logid_t log_id) const {
   // This call is made on the application thread so it is fine to access
   // log_states_
@@ -408,12 +430,28 @@ int ReaderImpl::isConnectionHealthy(logid_t log_id) const {
 ssize_t ReaderImpl::read(size_t nrecords,
                          std::vector<std::unique_ptr<DataRecord>>* data_out,
                          GapRecord* gap_out) {
+  ld_check(data_out != nullptr);
+  return readImpl(nrecords, data_out, nullptr, gap_out);
+}
+
+ssize_t ReaderImpl::readBatch(size_t nrecords,
+                              RecordBatch* batch_out,
+                              GapRecord* gap_out) {
+  ld_check(batch_out != nullptr);
+  batch_out->clear();
+  return readImpl(nrecords, nullptr, batch_out, gap_out);
+}
+
+ssize_t ReaderImpl::readImpl(size_t nrecords,
+                             std::vector<std::unique_ptr<DataRecord>>* data_out,
+                             RecordBatch* batch_out,
+                             GapRecord* gap_out) {
   // This is the workhorse method.  Each iteration of the loop consumes one
   // entry from the queue.  If we clear the queue, we wait (except in the case
   // of non-blocking reads when we immediately return).  The waiting protocol
   // is described in the header file.
 
-  ld_check(data_out != nullptr);
+  ld_check((data_out != nullptr) != (batch_out != nullptr));
   ld_check(gap_out != nullptr);
 
   if (nrecords == 0) {
@@ -432,6 +470,8 @@ ssize_t ReaderImpl::read(size_t nrecords,
 
   nrecords_ = nrecords;
   nread_ = 0;
+  data_out_ = data_out;
+  batch_out_ = batch_out;
   while (nread_ < nrecords_) {
     QueueEntry head;
     int rv = read_popQueue(head);
@@ -444,12 +484,6 @@ ssize_t ReaderImpl::read(size_t nrecords,
       // Worker asked us to notify when we have consumed this record.
       should_notify_worker = true;
 
-      // NOTE: Important to do this even if we soon discard the entry because
-      // the LogState instance no longer exists.  Otherwise notify_count_ can
-      // go out of sync with what is actually in the queue.
-      auto prev = notify_count_.fetch_sub(1);
-      ld_check(prev > 0);
-
       // Make sure we don't notify twice if this record gets buffered
       head.setNotifyWhenConsumed(false);
     }
@@ -483,10 +517,15 @@ ssize_t ReaderImpl::read(size_t nrecords,
         // The record contains a blob composed by BufferedWriter that we
         // should decode into records originally provided by the client.  This
         // call will do so and populate `pre_queue_' with entries that we'll
-        // pick up on subsequent iterations of the loop.
-        read_decodeBuffered(head);
+        // pick up on subsequent iterations of the loop.  readBatch() decodes
+        // straight into the batch when the whole blob fits, unless blobs are
+        // decoded in parallel.
+        if (!batch_out_ || read_decodeInParallel() ||
+            !read_decodeBufferedIntoBatch(head, state)) {
+          read_decodeBuffered(head);
+        }
       } else {
-        read_handleData(head, state, data_out);
+        read_handleData(head, state);
       }
     } else if (head.getType() == QueueEntry::Type::GAP) {
       bool break_loop;
@@ -519,6 +558,19 @@ int ReaderImpl::read_popQueue(QueueEntry& entry_out) {
     return 0;
   }
 
+  if (merge_window_) {
+    while (true) {
+      merge_drainQueue();
+      if (merge_pop(entry_out)) {
+        return 0;
+      }
+      if (!may_wait_) {
+        return -1;
+      }
+      read_wait();
+    }
+  }
+
   while (!queue_.read(entry_out)) {
     if (!may_wait_) {
       return -1;
@@ -527,14 +579,25 @@ int ReaderImpl::read_popQueue(QueueEntry& entry_out) {
     // read_wait() may have set may_wait_ to false in which case the loop
     // will terminate next time around
   }
+  read_onDequeued(entry_out);
+  return 0;
+}
+
+void ReaderImpl::read_onDequeued(const QueueEntry& entry) {
   // Decrement record_count_ as a result of removing an entry from queue_. Note
   // that record_count_ may temporarily become negative if this executes before
   // ReaderBridgeImpl::onEntry() updates the counter.
-  record_count_ -= entry_out.getRecordCount();
-  if (entry_out.getType() == QueueEntry::Type::GAP) {
+  record_count_ -= entry.getRecordCount();
+  if (entry.getType() == QueueEntry::Type::GAP) {
     --gap_count_;
   }
-  return 0;
+  if (entry.shouldNotifyWhenConsumed()) {
+    // NOTE: Important to do this even if we soon discard the entry because
+    // the LogState instance no longer exists.  Otherwise notify_count_ can
+    // go out of sync with what is actually in the queue.
+    auto prev = notify_count_.fetch_sub(1);
+    ld_check(prev > 0);
+  }
 }
 
 void ReaderImpl::read_wait() {
@@ -543,8 +606,9 @@ void ReaderImpl::read_wait() {
 
   // If waitOnlyWhenNoData() was called, 1 data record is enough to wake us.
   // Otherwise, set the watermark to however many we still need to satisfy the
-  // client's request.
-  const int64_t watermark = wait_only_when_no_data_
+  // client's request.  When merging, any record may unblock the ones held
+  // in the merge buffers.
+  const int64_t watermark = wait_only_when_no_data_ || merge_window_
       ? 1
       : std::min(queue_.capacity(), nrecords_ - nread_);
 
@@ -562,26 +626,42 @@ void ReaderImpl::read_wait() {
         notify_count_.load() > 0;
   };
 
+  // A record held back by the merge may become deliverable before the
+  // timeout, even if nothing else arrives.
+  folly::Optional<std::chrono::steady_clock::time_point> deadline;
+  if (timeout_.count() != -1) {
+    deadline = until_;
+  }
+  if (merge_window_) {
+    auto merge_until = merge_deadline();
+    if (merge_until.hasValue() &&
+        (!deadline.hasValue() || merge_until.value() < deadline.value())) {
+      deadline = merge_until;
+    }
+  }
+
   std::unique_lock<std::mutex> lock(cv_mutex_);
   wait_watermark_.store(watermark);
-  if (timeout_.count() == -1) {
+  if (!deadline.hasValue()) {
     cv_.wait(lock, wait_predicate);
   } else {
-    bool timed_out = !cv_.wait_until(lock, until_, wait_predicate);
+    bool timed_out = !cv_.wait_until(lock, deadline.value(), wait_predicate);
     if (timed_out) {
-      // If the semaphore wait timed out, disallow further waiting.  We'll
-      // process whatever is on the queue then stop.
-      may_wait_ = false;
       wait_watermark_.store(-1);
+      if (timeout_.count() != -1 &&
+          std::chrono::steady_clock::now() >= until_) {
+        // If the semaphore wait timed out, disallow further waiting.  We'll
+        // process whatever is on the queue then stop.
+        may_wait_ = false;
+      }
     }
   }
 }
 
-void ReaderImpl::read_handleData(
-    QueueEntry& entry,
-    LogState* state,
-    std::vector<std::unique_ptr<DataRecord>>* data_out) {
-  const lsn_t lsn = entry.getData().attrs.lsn;
+ReaderImpl::LogState*
+ReaderImpl::read_advanceFrontLSN(LogState* state,
+                                 lsn_t lsn,
+                                 bool allow_end_reading) {
   state->front_lsn = lsn + 1;
 
   if (state->front_lsn > state->until_lsn) {
@@ -589,7 +669,7 @@ void ReaderImpl::read_handleData(
     // read() call to block just because the client asked for a bigger
     // chunk of data than was left in the log.
     may_wait_ = false;
-    if (entry.getAllowEndReading()) {
+    if (allow_end_reading) {
       // Try to tear down the ClientReadStream instance.  This is
       // best-effort, may fail.
       stopReading(state->log_id);
@@ -605,11 +685,23 @@ void ReaderImpl::read_handleData(
     // waiting.
     may_wait_ = false;
   }
+  return state;
+}
 
-  // Here we upcast the std::unique_ptr<DataRecordOwnsPayload> to a
-  // std::unique_ptr<DataRecord>.  DataRecord has a virtual destructor so
-  // the payload will get freed when the application deletes the DataRecord.
-  data_out->push_back(entry.releaseData());
+void ReaderImpl::read_handleData(QueueEntry& entry, LogState* state) {
+  read_advanceFrontLSN(
+      state, entry.getData().attrs.lsn, entry.getAllowEndReading());
+
+  if (batch_out_) {
+    // Move the record from the queue entry into the batch; the batch's
+    // payload column points into it, so the payload is not copied.
+    batch_out_->append(entry.releaseData());
+  } else {
+    // Here we upcast the std::unique_ptr<DataRecordOwnsPayload> to a
+    // std::unique_ptr<DataRecord>.  DataRecord has a virtual destructor so
+    // the payload will get freed when the application deletes the DataRecord.
+    data_out_->push_back(entry.releaseData());
+  }
   ++nread_;
 }
 
@@ -656,6 +748,11 @@ void ReaderImpl::read_decodeBuffered(QueueEntry& entry) {
   // pre_queue_.
   ld_check(pre_queue_.empty());
 
+  if (read_decodeInParallel()) {
+    read_decodeBufferedParallel(entry);
+    return;
+  }
+
   // Make a copy of attributes since we'll need them after we pass ownership
   // of `entry.getData()'
   logid_t log_id = entry.getData().logid;
@@ -664,7 +761,8 @@ void ReaderImpl::read_decodeBuffered(QueueEntry& entry) {
   // We shouldn't be decoding buffered writes while rebuilding
   ld_check(!entry.getData().extra_metadata_);
 
-  auto decoder = std::make_shared<BufferedWriteDecoderImpl>();
+  auto decoder =
+      std::make_shared<BufferedWriteDecoderImpl>(1, processor_->stats_);
   std::vector<Payload> payloads;
   int rv = decoder->decodeOne(entry.releaseData(), payloads);
   if (rv != 0) {
@@ -701,6 +799,214 @@ void ReaderImpl::read_decodeBuffered(QueueEntry& entry) {
   }
 }
 
+void ReaderImpl::read_decodeBufferedParallel(QueueEntry& entry) {
+  // Take the buffered writes that are ready right behind this one, so that
+  // their blobs are decompressed concurrently.  The first entry of another
+  // kind stops the scan; it is delivered after the decoded records.
+  const size_t max_entries = 4 * decode_parallelism_;
+  std::vector<QueueEntry> entries;
+  entries.push_back(std::move(entry));
+  QueueEntry next;
+  while (entries.size() < max_entries && queue_.read(next)) {
+    read_onDequeued(next);
+    if (next.getType() != QueueEntry::Type::DATA ||
+        !(next.getData().flags_ & RECORD_Header::BUFFERED_WRITER_BLOB)) {
+      break;
+    }
+    entries.push_back(std::move(next));
+  }
+
+  struct BlobInfo {
+    logid_t log_id;
+    DataRecordAttributes attrs;
+    RECORD_flags_t flags;
+  };
+  std::vector<BlobInfo> blobs;
+  std::vector<std::unique_ptr<DataRecord>> records;
+  for (QueueEntry& blob_entry : entries) {
+    const DataRecordOwnsPayload& record = blob_entry.getData();
+    // We shouldn't be decoding buffered writes while rebuilding
+    ld_check(!record.extra_metadata_);
+    blobs.push_back(BlobInfo{record.logid, record.attrs, record.flags_});
+    records.push_back(blob_entry.releaseData());
+  }
+
+  if (!parallel_decoder_) {
+    parallel_decoder_ = std::make_unique<BufferedWriteDecoderImpl>(
+        decode_parallelism_, processor_ ? processor_->stats_ : nullptr);
+  }
+  std::vector<std::vector<Payload>> payloads;
+  std::vector<std::shared_ptr<const void>> owners;
+  std::vector<int> rvs;
+  parallel_decoder_->decodeEach(records, payloads, owners, rvs);
+
+  for (size_t i = 0; i < entries.size(); ++i) {
+    const BlobInfo& blob = blobs[i];
+    const read_stream_id_t rsid = entries[i].getReadStreamID();
+    const size_t size_before = pre_queue_.size();
+    if (rvs[i] != 0) {
+      // Decoding failed, inform the client with a DATALOSS gap like
+      // read_decodeBuffered()
+      pre_queue_.emplace_back( // creating a QueueEntry
+          rsid,
+          std::make_unique<GapRecord>(
+              blob.log_id, GapType::DATALOSS, blob.attrs.lsn, blob.attrs.lsn));
+    }
+    int batch_offset = 0;
+    for (Payload& payload : payloads[i]) {
+      // Each record shares ownership of the memory backing its blob's
+      // payloads, which is released as soon as the last of them is freed.
+      pre_queue_.emplace_back( // creating a QueueEntry
+          rsid,
+          DataRecordOwnsPayload::createWithSharedPayload(
+              blob.log_id,
+              std::move(payload),
+              blob.attrs.lsn,
+              blob.attrs.timestamp,
+              blob.flags & ~RECORD_Header::BUFFERED_WRITER_BLOB,
+              owners[i],
+              batch_offset++),
+          1);
+      // Only allow read() to stop reading the log after consuming the last
+      // record
+      pre_queue_.back().setAllowEndReading(&payload == &payloads[i].back());
+    }
+    // readImpl() already took care of the notification for the first entry.
+    // For the others, notify when the last record of the blob is consumed.
+    if (entries[i].shouldNotifyWhenConsumed() &&
+        pre_queue_.size() > size_before) {
+      pre_queue_.back().setNotifyWhenConsumed(true);
+    }
+  }
+
+  if (next.getType() != QueueEntry::Type::EMPTY) {
+    pre_queue_.push_back(std::move(next));
+  }
+}
+
+bool ReaderImpl::read_decodeBufferedIntoBatch(QueueEntry& entry,
+                                              LogState* state) {
+  ld_check(batch_out_);
+  ld_check(pre_queue_.empty());
+
+  size_t batch_size;
+  if (BufferedWriteDecoderImpl::getBatchSize(entry.getData(), &batch_size) !=
+          0 ||
+      batch_size == 0 || batch_size > nrecords_ - nread_) {
+    // Let read_decodeBuffered() deal with malformed blobs and with blobs that
+    // need to be split across readBatch() calls.
+    return false;
+  }
+
+  logid_t log_id = entry.getData().logid;
+  DataRecordAttributes attrs = entry.getData().attrs;
+
+  // The batch keeps the decoder, which owns the decompressed buffer (or the
+  // original record), alive for as long as the payload views are in use.
+  auto decoder =
+      std::make_shared<BufferedWriteDecoderImpl>(1, processor_->stats_);
+  std::vector<Payload> payloads;
+  int rv = decoder->decodeOne(entry.releaseData(), payloads);
+  if (rv != 0) {
+    pre_queue_.emplace_back( // creating a QueueEntry
+        entry.getReadStreamID(),
+        std::make_unique<GapRecord>(
+            log_id, GapType::DATALOSS, attrs.lsn, attrs.lsn));
+    return true;
+  }
+
+  nread_ += payloads.size();
+  batch_out_->appendDecoded(std::move(decoder),
+                            log_id,
+                            attrs.lsn,
+                            attrs.timestamp,
+                            attrs.byte_offset,
+                            payloads);
+  read_advanceFrontLSN(state, attrs.lsn, /* allow_end_reading */ true);
+  return true;
+}
+
+ReaderImpl::MergeKey ReaderImpl::mergeKey(const QueueEntry& entry) {
+  return MergeKey(entry.getType() == QueueEntry::Type::DATA
+                      ? entry.getData().attrs.timestamp
+                      : std::chrono::milliseconds::min(),
+                  entry.getReadStreamID());
+}
+
+void ReaderImpl::merge_drainQueue() {
+  ld_check(merge_window_);
+  const auto now = std::chrono::steady_clock::now();
+  auto& index = log_states_.get<ReadStreamIDIndex>();
+  QueueEntry entry;
+  while (queue_.read(entry)) {
+    read_onDequeued(entry);
+    if (index.find(entry.getReadStreamID()) == index.end()) {
+      // Entry for a read stream that no longer exists, see readImpl().
+      continue;
+    }
+    if (entry.getType() == QueueEntry::Type::DATA) {
+      merge_max_timestamp_ =
+          std::max(merge_max_timestamp_, entry.getData().attrs.timestamp);
+    }
+    auto& buffer = merge_buffers_[entry.getReadStreamID()];
+    if (buffer.empty()) {
+      merge_heads_.insert(mergeKey(entry));
+    }
+    buffer.push_back(MergeBufferEntry{now, std::move(entry)});
+  }
+}
+
+bool ReaderImpl::merge_pop(QueueEntry& entry_out) {
+  ld_check(merge_window_);
+  if (merge_heads_.empty()) {
+    return false;
+  }
+  const MergeKey key = *merge_heads_.begin();
+  auto it = merge_buffers_.find(key.second);
+  ld_check(it != merge_buffers_.end());
+  std::deque<MergeBufferEntry>& buffer = it->second;
+  ld_check(!buffer.empty());
+
+  const bool deliver = key.first == std::chrono::milliseconds::min() ||
+      merge_heads_.size() >= log_states_.size() ||
+      merge_max_timestamp_ - key.first >= merge_window_.value() ||
+      buffer.front().arrival_time + merge_window_.value() <=
+          std::chrono::steady_clock::now();
+  if (!deliver) {
+    return false;
+  }
+
+  merge_heads_.erase(merge_heads_.begin());
+  entry_out = std::move(buffer.front().entry);
+  buffer.pop_front();
+  if (buffer.empty()) {
+    merge_buffers_.erase(it);
+  } else {
+    merge_heads_.insert(mergeKey(buffer.front().entry));
+  }
+  return true;
+}
+
+folly::Optional<std::chrono::steady_clock::time_point>
+ReaderImpl::merge_deadline() const {
+  if (merge_heads_.empty()) {
+    return folly::none;
+  }
+  auto it = merge_buffers_.find(merge_heads_.begin()->second);
+  ld_check(it != merge_buffers_.end());
+  return it->second.front().arrival_time + merge_window_.value();
+}
+
+void ReaderImpl::merge_discard(read_stream_id_t rsid) {
+  auto it = merge_buffers_.find(rsid);
+  if (it == merge_buffers_.end()) {
+    return;
+  }
+  ld_check(!it->second.empty());
+  merge_heads_.erase(mergeKey(it->second.front().entry));
+  merge_buffers_.erase(it);
+}
+
 void ReaderImpl::notifyWorker(LogState& state) {
   std::unique_ptr<Request> req =
       std::make_unique<ReaderProgressRequest>(state.handle);
@@ -12,10 +12,12 @@
 #include <boost/multi_index/mem_fun.hpp>
 #include <boost/multi_index_container.hpp>
 #include <boost/noncopyable.hpp>
+#include <algorithm>
 #include <chrono>
 #include <condition_variable>
 #include <memory>
 #include <mutex>
+#include <set>
 #include <unordered_map>
 
 #include <folly/MPMCQueue.h>
@@ -28,10 +30,12 @@
 #include "logdevice/common/types_internal.h"
 #include "logdevice/include/Client.h"
 #include "logdevice/include/Reader.h"
+#include "logdevice/include/RecordBatch.h"
 #include "logdevice/include/types.h"
 
 namespace facebook { namespace logdevice {
 
+class BufferedWriteDecoderImpl;
 class Processor;
 class ReaderBridgeImpl;
 
@@ -48,6 +52,9 @@ class ReaderImpl : public Reader {
   ssize_t read(size_t nrecords,
                std::vector<std::unique_ptr<DataRecord>>* data_out,
                GapRecord* gap_out) override;
+  ssize_t readBatch(size_t nrecords,
+                    RecordBatch* batch_out,
+                    GapRecord* gap_out) override;
   void waitOnlyWhenNoData() override;
   void withoutPayload() override;
   void payloadHashOnly();
@@ -103,6 +110,21 @@ class ReaderImpl : public Reader {
     buffer_type_ = buffer_type;
   }
 
+  ClientReadStreamBufferType getBufferType() const {
+    return buffer_type_;
+  }
+
+  // Maximum number of threads used to decompress BufferedWriter batches,
+  // client_read_decode_parallelism unless overridden
+  void setDecodeParallelism(size_t parallelism) {
+    decode_parallelism_ = std::max<size_t>(parallelism, 1);
+  }
+
+  // Makes read() and readBatch() return the records of all logs merged in
+  // timestamp order, see Client::createTimestampMergingReader().  Must be
+  // called before startReading().
+  void mergeByTimestamp(std::chrono::milliseconds max_out_of_orderness);
+
  protected: // tests can override
   virtual int startReadingImpl(logid_t log_id,
                                lsn_t from,
@@ -182,10 +204,17 @@ class ReaderImpl : public Reader {
   // From addStartFlags().
   START_flags_t additional_start_flags_ = 0;
 
-  // type of the buffer used by the readstream, by default it uses a circular
-  // linear buffer
+  // type of the buffer used by the readstream, client_read_buffer_type unless
+  // overridden with setBufferType()
   ClientReadStreamBufferType buffer_type_{ClientReadStreamBufferType::CIRCULAR};
 
+  // see setDecodeParallelism()
+  size_t decode_parallelism_ = 1;
+
+  // Decoder used when decode_parallelism_ > 1, created on first use.  Keeps
+  // the decode threads running while the reader exists.
+  std::unique_ptr<BufferedWriteDecoderImpl> parallel_decoder_;
+
   /**
    * This gets put on the MPMCQueue when ClientReadStream sends us something.
    * Each entry wraps either a DataRecord or a GapRecord.
@@ -401,6 +430,55 @@ class ReaderImpl : public Reader {
   // bit set.  We send a Request to the worker, as requested.
   void notifyWorker(LogState& state);
 
+  //
+  // State of the timestamp merge, used if mergeByTimestamp() was called.
+  //
+  // Entries are moved off queue_ into a per-read-stream buffer as soon as
+  // they arrive.  The entry with the lowest timestamp among the fronts of all
+  // buffers is delivered once it is known that no log can produce an earlier
+  // record, or once it is late enough:
+  // - every log being read has something buffered, or
+  // - it is older than the newest timestamp seen by more than the
+  //   out-of-orderness window (bounded disorder), or
+  // - it has waited for longer than the window (idle logs).
+  // Gaps carry no timestamp and are delivered as soon as they reach the front
+  // of their buffer.
+  //
+  // Entries keep their `notify_when_consumed' bit while buffered, so the
+  // worker is only notified once the entry is delivered.  A log that is ahead
+  // of the others therefore fills its ClientReadStream window and stops being
+  // read from, instead of piling up in the merge buffers.
+  //
+  folly::Optional<std::chrono::milliseconds> merge_window_;
+
+  struct MergeBufferEntry {
+    std::chrono::steady_clock::time_point arrival_time;
+    QueueEntry entry;
+  };
+  std::unordered_map<read_stream_id_t,
+                     std::deque<MergeBufferEntry>,
+                     read_stream_id_t::Hash>
+      merge_buffers_;
+  // (timestamp, read stream ID) of the front of each non-empty merge buffer.
+  // Gaps sort first.
+  using MergeKey = std::pair<std::chrono::milliseconds, read_stream_id_t>;
+  std::set<MergeKey> merge_heads_;
+  // Highest timestamp of any record taken off queue_.
+  std::chrono::milliseconds merge_max_timestamp_{
+      std::chrono::milliseconds::min()};
+
+  static MergeKey mergeKey(const QueueEntry& entry);
+  // Moves everything currently in queue_ into the merge buffers.
+  void merge_drainQueue();
+  // Pops the next entry in merged order if one may be delivered now.
+  bool merge_pop(QueueEntry& entry_out);
+  // Time at which the front entry with the lowest timestamp may be delivered
+  // even if other logs have nothing buffered, or folly::none if the merge
+  // buffers are empty.
+  folly::Optional<std::chrono::steady_clock::time_point> merge_deadline() const;
+  // Discards the buffered entries of a read stream that was stopped.
+  void merge_discard(read_stream_id_t rsid);
+
   // Connection health for each log as reported by ClientReadStream
   std::unordered_map<logid_t, bool, logid_t::Hash> health_map_;
   // Lock guarding health_map_ since it can be concurrently accessed by the
@@ -414,6 +492,16 @@ class ReaderImpl : public Reader {
   std::chrono::steady_clock::time_point until_;
   size_t nrecords_;
   size_t nread_;
+  // Exactly one of these is non-null; data records go to the vector for
+  // read() and into the columnar batch for readBatch()
+  std::vector<std::unique_ptr<DataRecord>>* data_out_;
+  RecordBatch* batch_out_;
+
+  // Shared implementation of read() and readBatch().
+  ssize_t readImpl(size_t nrecords,
+                   std::vector<std::unique_ptr<DataRecord>>* data_out,
+                   RecordBatch* batch_out,
+                   GapRecord* gap_out);
 
   // Initializes may_wait_ and until_.
   void read_initWaitParams();
@@ -421,12 +509,13 @@ class ReaderImpl : public Reader {
   // allowed).  Returns 0 if we got something, -1 if we timed out without
   // getting anything.
   int read_popQueue(QueueEntry& entry_out);
+  // Updates the counters describing the contents of queue_ after `entry' was
+  // taken off it.
+  void read_onDequeued(const QueueEntry& entry);
   // Waits for work to appear in the queue.
   void read_wait();
   // Handlers for data and gap records.
-  void read_handleData(QueueEntry& entry,
-                       LogState* state,
-                       std::vector<std::unique_ptr<DataRecord>>* data_out);
+  void read_handleData(QueueEntry& entry, LogState* state);
   void read_handleGap(QueueEntry& entry,
                       LogState* state,
                       GapRecord* gap_out,
@@ -436,6 +525,25 @@ class ReaderImpl : public Reader {
   // original records onto `pre_queue_'.  If decoding fails, a DATALOSS gap is
   // generated instead.
   void read_decodeBuffered(QueueEntry& entry);
+  // Variant of read_decodeBuffered() for readBatch().  Decodes the blob
+  // straight into `batch_out_' without creating a DataRecord per original
+  // record.  Returns false, leaving `entry' untouched, if the decoded records
+  // would not fit into the current readBatch() call, in which case the caller
+  // should fall back to read_decodeBuffered().
+  bool read_decodeBufferedIntoBatch(QueueEntry& entry, LogState* state);
+  // With decode_parallelism_ > 1, read_decodeBuffered() also takes the
+  // buffered writes queued right behind `entry' and decodes all of them at
+  // once.  Not used when merging, which must see every queued entry.
+  bool read_decodeInParallel() const {
+    return decode_parallelism_ > 1 && !merge_window_;
+  }
+  void read_decodeBufferedParallel(QueueEntry& entry);
+  // Advances `state' past a delivered data record at `lsn' and stops reading
+  // the log if its `until' LSN was reached.  Returns `state', or nullptr if
+  // the LogState was erased.
+  LogState* read_advanceFrontLSN(LogState* state,
+                                 lsn_t lsn,
+                                 bool allow_end_reading);
 
   friend class TestReader;
 };
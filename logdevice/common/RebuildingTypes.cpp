@@ -142,4 +142,44 @@ void LogRebuildingMap::insert(logid_t logid,
   map[k] = std::move(log);
 }
 
+ChunkRebuildingInterface* ChunkRebuildingMap::find(log_rebuilding_id_t id,
+                                                    logid_t logid,
+                                                    shard_index_t shard) {
+  auto it = map.find(id);
+  if (it == map.end() || it->second->getLogID() != logid ||
+      it->second->getShard() != shard) {
+    return nullptr;
+  }
+  return it->second;
+}
+
+void ChunkRebuildingMap::erase(log_rebuilding_id_t id) {
+  map.erase(id);
+}
+
+void ChunkRebuildingMap::insert(log_rebuilding_id_t id,
+                                ChunkRebuildingInterface* chunk) {
+  ld_check(chunk != nullptr);
+  auto ins = map.emplace(id, chunk);
+  ld_check(ins.second);
+}
+
+RecordRebuildingInterface*
+findRecordRebuilding(LogRebuildingMap& log_rebuildings,
+                     ChunkRebuildingMap& chunk_rebuildings,
+                     log_rebuilding_id_t rebuilding_id,
+                     logid_t logid,
+                     shard_index_t shard,
+                     lsn_t lsn) {
+  auto log_rebuilding = log_rebuildings.find(logid, shard);
+  if (log_rebuilding) {
+    return log_rebuilding->findRecordRebuilding(lsn);
+  }
+  auto chunk_rebuilding = chunk_rebuildings.find(rebuilding_id, logid, shard);
+  if (chunk_rebuilding) {
+    return chunk_rebuilding->findRecordRebuilding(lsn);
+  }
+  return nullptr;
+}
+
 }} // namespace facebook::logdevice
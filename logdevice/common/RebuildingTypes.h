@@ -144,6 +144,23 @@ class LogRebuildingInterface {
   virtual ~LogRebuildingInterface() {}
 };
 
+// A group of consecutive records of one log re-replicated together by
+// ShardRebuildingV2. Unlike LogRebuilding, it's owned by the
+// ShardRebuildingV2 and is only registered in the worker's
+// ChunkRebuildingMap for routing STORED replies and flush notifications.
+class ChunkRebuildingInterface {
+ public:
+  virtual logid_t getLogID() const = 0;
+  virtual shard_index_t getShard() const = 0;
+  virtual RecordRebuildingInterface* findRecordRebuilding(lsn_t lsn) = 0;
+  virtual void onMemtableFlushed(node_index_t node_index,
+                                 ServerInstanceId server_instance_id,
+                                 FlushToken flushToken) = 0;
+  virtual void onGracefulShutdown(node_index_t node_index,
+                                  ServerInstanceId server_instance_id) = 0;
+  virtual ~ChunkRebuildingInterface() {}
+};
+
 class RebuildingCoordinatorInterface {
  public:
   virtual void noteConfigurationChanged() = 0;
@@ -172,6 +189,42 @@ struct LogRebuildingMap {
   Map map;
 };
 
+/**
+ * A map from rebuilding id to ChunkRebuildingInterface. Doesn't own the
+ * chunks: they register themselves while they have stores or amends in
+ * flight. Chunk ids are allocated from the same counter as LogRebuilding ids,
+ * so an id identifies at most one of them.
+ */
+struct ChunkRebuildingMap {
+ public:
+  using Map = std::unordered_map<log_rebuilding_id_t,
+                                 ChunkRebuildingInterface*,
+                                 log_rebuilding_id_t::Hash>;
+  // Returns nullptr if there's no chunk with this id or if the chunk is for
+  // a different log or shard.
+  ChunkRebuildingInterface*
+  find(log_rebuilding_id_t id, logid_t logid, shard_index_t shard);
+  void erase(log_rebuilding_id_t id);
+  void insert(log_rebuilding_id_t id, ChunkRebuildingInterface* chunk);
+  Map map;
+};
+
+/**
+ * Finds the RecordRebuilding state machine that a STORE sent or a STORED
+ * received for a rebuilding record belongs to: the one of the LogRebuilding
+ * of the log if there is one, otherwise the one of the ChunkRebuilding with
+ * id `rebuilding_id`.
+ *
+ * @return nullptr if there is none, e.g. because the chunk restarted since.
+ */
+RecordRebuildingInterface*
+findRecordRebuilding(LogRebuildingMap& log_rebuildings,
+                     ChunkRebuildingMap& chunk_rebuildings,
+                     log_rebuilding_id_t rebuilding_id,
+                     logid_t logid,
+                     shard_index_t shard,
+                     lsn_t lsn);
+
 /**
  * Object in charge of the data movement during rebuilding.
  * It reads and re-replicates the records.
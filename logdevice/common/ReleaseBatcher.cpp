@@ -0,0 +1,63 @@
+/**
+ * Copyright (c) 2017-present, Facebook, Inc. and its affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+#include "ReleaseBatcher.h"
+
+#include <folly/hash/Hash.h>
+
+#include "logdevice/common/Worker.h"
+#include "logdevice/common/protocol/RELEASE_BATCH_Message.h"
+#include "logdevice/common/settings/Settings.h"
+#include "logdevice/common/stats/Stats.h"
+
+namespace facebook { namespace logdevice {
+
+size_t ReleaseBatcherKey::Hash::
+operator()(const ReleaseBatcherKey& key) const {
+  return folly::hash::hash_128_to_64(
+      key.log_id.val_,
+      (uint64_t(uint16_t(key.shard)) << 8) | uint8_t(key.release_type));
+}
+
+ReleaseBatcher::ReleaseBatcher()
+    : NodeMessageBatcher(Compatibility::RELEASE_BATCH_SUPPORT) {}
+
+std::chrono::milliseconds ReleaseBatcher::getMaxDelay() const {
+  return Worker::settings().release_batch_max_delay;
+}
+
+folly::Optional<ReleaseBatcherKey>
+ReleaseBatcher::getKey(const RELEASE_Header& header) const {
+  return ReleaseBatcherKey{
+      header.rid.logid, header.shard, header.release_type};
+}
+
+void ReleaseBatcher::merge(RELEASE_Header& queued,
+                           const RELEASE_Header& header) {
+  // Releases are cumulative, only send the latest one.
+  if (header.rid.lsn() > queued.rid.lsn()) {
+    queued.rid = header.rid;
+  }
+  WORKER_STAT_INCR(release_batch_releases_coalesced);
+}
+
+void ReleaseBatcher::onBatchSent(size_t nheaders) {
+  WORKER_STAT_INCR(release_batches_sent);
+  WORKER_STAT_ADD(release_batch_releases_sent, nheaders);
+}
+
+std::unique_ptr<Message>
+ReleaseBatcher::createMessage(RELEASE_Header& header) {
+  return std::make_unique<RELEASE_Message>(header);
+}
+
+std::unique_ptr<Message>
+ReleaseBatcher::createBatchMessage(std::vector<RELEASE_Header> headers) {
+  return std::make_unique<RELEASE_BATCH_Message>(std::move(headers));
+}
+
+}} // namespace facebook::logdevice
@@ -0,0 +1,64 @@
+/**
+ * Copyright (c) 2017-present, Facebook, Inc. and its affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+#pragma once
+
+#include "logdevice/common/NodeMessageBatcher.h"
+#include "logdevice/common/protocol/RELEASE_Message.h"
+
+namespace facebook { namespace logdevice {
+
+/**
+ * @file Collects the RELEASE messages that the sequencers and Appenders of a
+ *       worker send, and sends them to each storage node as a single
+ *       RELEASE_BATCH message.  While waiting in a batch, a release of a log
+ *       replaces any earlier release of the same type of that log for the
+ *       same shard: releases are cumulative, so only the latest one matters.
+ *       A storage node then handles one message per sequencer worker and
+ *       flush instead of one per log and record.
+ *
+ *       A batch is sent --release-batch-max-delay after the first release was
+ *       queued into it, or at the end of the event loop iteration if that is
+ *       0, which bounds the latency batching adds to the delivery of records.
+ *       Failures to send a batch are handled for each release as if its
+ *       RELEASE had failed: PeriodicReleases of the log resends it.
+ *
+ *       Used when --batch-releases is set.  See NodeMessageBatcher.
+ */
+
+struct ReleaseBatcherKey {
+  logid_t log_id;
+  shard_index_t shard;
+  ReleaseType release_type;
+
+  bool operator==(const ReleaseBatcherKey& other) const {
+    return log_id == other.log_id && shard == other.shard &&
+        release_type == other.release_type;
+  }
+
+  struct Hash {
+    size_t operator()(const ReleaseBatcherKey& key) const;
+  };
+};
+
+class ReleaseBatcher
+    : public NodeMessageBatcher<RELEASE_Header, ReleaseBatcherKey> {
+ public:
+  ReleaseBatcher();
+
+ protected:
+  std::chrono::milliseconds getMaxDelay() const override;
+  folly::Optional<ReleaseBatcherKey>
+  getKey(const RELEASE_Header& header) const override;
+  void merge(RELEASE_Header& queued, const RELEASE_Header& header) override;
+  std::unique_ptr<Message> createMessage(RELEASE_Header& header) override;
+  std::unique_ptr<Message>
+  createBatchMessage(std::vector<RELEASE_Header> headers) override;
+  void onBatchSent(size_t nheaders) override;
+};
+
+}} // namespace facebook::logdevice
@@ -0,0 +1,59 @@
+/**
+ * Copyright (c) 2017-present, Facebook, Inc. and its affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+#include "SealBatcher.h"
+
+#include <folly/hash/Hash.h>
+
+#include "logdevice/common/Worker.h"
+#include "logdevice/common/protocol/SEAL_BATCH_Message.h"
+#include "logdevice/common/settings/Settings.h"
+#include "logdevice/common/stats/Stats.h"
+
+namespace facebook { namespace logdevice {
+
+size_t SealBatcherKey::Hash::operator()(const SealBatcherKey& key) const {
+  return folly::hash::hash_128_to_64(
+      key.log_id.val_, uint64_t(uint16_t(key.shard)));
+}
+
+SealBatcher::SealBatcher()
+    : NodeMessageBatcher(Compatibility::SEAL_BATCH_SUPPORT) {}
+
+std::chrono::milliseconds SealBatcher::getMaxDelay() const {
+  return Worker::settings().seal_batch_max_delay;
+}
+
+folly::Optional<SealBatcherKey>
+SealBatcher::getKey(const SEAL_Header& header) const {
+  return SealBatcherKey{header.log_id, header.shard};
+}
+
+void SealBatcher::merge(SEAL_Header& queued, const SEAL_Header& header) {
+  // The recovery retried its SEAL before the first one went out.  Seals only
+  // move forward: keep the one for the higher epoch, and the retry's request
+  // id if the epochs are the same.
+  if (header.seal_epoch >= queued.seal_epoch) {
+    queued = header;
+  }
+}
+
+void SealBatcher::onBatchSent(size_t nheaders) {
+  WORKER_STAT_INCR(seal_batches_sent);
+  WORKER_STAT_ADD(seal_batch_seals_sent, nheaders);
+}
+
+std::unique_ptr<Message> SealBatcher::createMessage(SEAL_Header& header) {
+  return std::make_unique<SEAL_Message>(header);
+}
+
+std::unique_ptr<Message>
+SealBatcher::createBatchMessage(std::vector<SEAL_Header> headers) {
+  return std::make_unique<SEAL_BATCH_Message>(std::move(headers));
+}
+
+}} // namespace facebook::logdevice
@@ -0,0 +1,61 @@
+/**
+ * Copyright (c) 2017-present, Facebook, Inc. and its affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+#pragma once
+
+#include "logdevice/common/NodeMessageBatcher.h"
+#include "logdevice/common/protocol/SEAL_Message.h"
+
+namespace facebook { namespace logdevice {
+
+/**
+ * @file Collects the SEAL messages that the LogRecoveryRequests of a worker
+ *       send, and sends them to each storage node as a single SEAL_BATCH
+ *       message.  When a sequencer node takes over many logs at once, their
+ *       recoveries seal mostly the same storage nodes; a storage node then
+ *       handles one message per sequencer worker and flush instead of one per
+ *       log and shard.  A retried SEAL of a log replaces the one of the same
+ *       log and shard still waiting in the batch, unless it is for a lower
+ *       epoch.
+ *
+ *       A batch is sent --seal-batch-max-delay after the first SEAL was
+ *       queued into it, or at the end of the event loop iteration if that is
+ *       0.  Failures to send a batch are reported to each LogRecoveryRequest
+ *       as if its SEAL had failed, which retries it.
+ *
+ *       Used when --batch-seals is set.  See NodeMessageBatcher.
+ */
+
+struct SealBatcherKey {
+  logid_t log_id;
+  shard_index_t shard;
+
+  bool operator==(const SealBatcherKey& other) const {
+    return log_id == other.log_id && shard == other.shard;
+  }
+
+  struct Hash {
+    size_t operator()(const SealBatcherKey& key) const;
+  };
+};
+
+class SealBatcher : public NodeMessageBatcher<SEAL_Header, SealBatcherKey> {
+ public:
+  SealBatcher();
+
+ protected:
+  std::chrono::milliseconds getMaxDelay() const override;
+  folly::Optional<SealBatcherKey>
+  getKey(const SEAL_Header& header) const override;
+  void merge(SEAL_Header& queued, const SEAL_Header& header) override;
+  std::unique_ptr<Message> createMessage(SEAL_Header& header) override;
+  std::unique_ptr<Message>
+  createBatchMessage(std::vector<SEAL_Header> headers) override;
+  void onBatchSent(size_t nheaders) override;
+};
+
+}} // namespace facebook::logdevice
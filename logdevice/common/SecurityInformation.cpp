@@ -22,8 +22,12 @@ bool Principal::isAllowedInConfig(const std::string& str) {
 }
 
 folly::dynamic Principal::toFollyDynamic() const {
-  return folly::dynamic::object("name", name)(
+  folly::dynamic res = folly::dynamic::object("name", name)(
       "max_read_traffic_class", trafficClasses()[max_read_traffic_class]);
+  if (read_weight != 1) {
+    res["read_weight"] = read_weight;
+  }
+  return res;
 };
 
 std::string AuthenticationTypeTranslator::toString(AuthenticationType type) {
@@ -67,6 +67,11 @@ class Principal {
   // The RFC 2474 "Differentiated Services Field Code Point" value to use
   // for all packets sent on connections associated with this principal.
   uint8_t egress_dscp = 0;
+
+  // Relative share of a storage node's read path given to clients identified
+  // by this Principal when they compete with other clients, see
+  // CatchupQueueArbiter.
+  uint32_t read_weight = 1;
 };
 
 /**
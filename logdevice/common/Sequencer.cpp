@@ -25,6 +25,7 @@
 #include "logdevice/common/NodeSetFinder.h"
 #include "logdevice/common/PeriodicReleases.h"
 #include "logdevice/common/Processor.h"
+#include "logdevice/common/ReleaseBatcher.h"
 #include "logdevice/common/Socket.h"
 #include "logdevice/common/Worker.h"
 #include "logdevice/common/debug.h"
@@ -1419,6 +1420,7 @@ int Sequencer::sendReleases(lsn_t lsn,
 
   // Header is the same for all messages we send below.
   const RELEASE_Header header{rid, release_type};
+  const bool batch = Worker::settings().batch_releases;
 
   int rv = 0;
   for (const auto& shard : *all_shards) {
@@ -1426,8 +1428,12 @@ int Sequencer::sendReleases(lsn_t lsn,
     if (!pred || pred(lsn, release_type, shard)) {
       auto h = header;
       h.shard = shard.shard();
-      if (sender.sendMessage(
-              std::make_unique<RELEASE_Message>(h), shard.asNodeID()) != 0) {
+      if (batch) {
+        // Failures to send the batch are reported through
+        // RELEASE_Message::onReleaseSent(), which schedules periodic releases.
+        w->releaseBatcher().enqueue(shard, h);
+      } else if (sender.sendMessage(std::make_unique<RELEASE_Message>(h),
+                                    shard.asNodeID()) != 0) {
         RATELIMIT_WARNING(
             std::chrono::seconds(1),
             1,
@@ -15,22 +15,33 @@ namespace facebook { namespace logdevice {
 
 /**
  * @file This class serves as an interface for server-side filter classes.
- *       There are two implementations right now. Experimental feature:
- *       Use with caution.
+ *       Experimental feature: Use with caution.
  */
 
 /**
- * Currently only two types.
  * 1) EQUALITY means exact match. It describes string equality filter based for
  *    now.
  * 2) RANGE means filter by upper and lower bounds. It describes string
  *    based range filter for now.
+ * 3) PREFIX matches keys starting with filter_key1.
+ * 4) KEY_SET matches keys in a set, encoded in filter_key1 with
+ *    ServerRecordFilterEncoding::encodeKeySet().
+ * 5) BLOOM matches keys that may be in the set of keys a bloom filter was
+ *    built from, encoded in filter_key1 with
+ *    ServerRecordFilterEncoding::buildBloomFilter(). Some keys not in the set
+ *    pass the filter, so readers must check the keys of the records they get.
+ *
+ * Filters are evaluated by storage threads as well as workers, so they must
+ * not have mutable state.
  */
 
 enum class ServerRecordFilterType : uint8_t {
   NOFILTER = 0,
   EQUALITY = 1,
   RANGE = 2,
+  PREFIX = 3,
+  KEY_SET = 4,
+  BLOOM = 5,
   MAX
 };
 
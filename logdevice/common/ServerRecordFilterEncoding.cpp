@@ -0,0 +1,125 @@
+/**
+ * Copyright (c) 2017-present, Facebook, Inc. and its affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+#include "logdevice/common/ServerRecordFilterEncoding.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <folly/Varint.h>
+#include <folly/hash/SpookyHashV2.h>
+
+#include "logdevice/common/checks.h"
+
+namespace facebook { namespace logdevice {
+
+constexpr size_t ServerRecordFilterEncoding::MAX_BLOOM_FILTER_HASHES;
+
+namespace {
+
+// Seeds for SpookyHash.  Changing them breaks compatibility between clients
+// and servers.
+constexpr uint64_t BLOOM_SEED1 = 0x2f693b1e5d8a07c3;
+constexpr uint64_t BLOOM_SEED2 = 0x71c5e0a94b3d26f8;
+
+// Calls f(bit) for each of the `num_hashes' bits of `key' in a bit array of
+// `num_bits' bits, using double hashing.
+template <typename F>
+void forEachBloomBit(folly::StringPiece key,
+                     size_t num_hashes,
+                     size_t num_bits,
+                     F f) {
+  uint64_t h1 = BLOOM_SEED1, h2 = BLOOM_SEED2;
+  folly::hash::SpookyHashV2::Hash128(key.data(), key.size(), &h1, &h2);
+  for (size_t i = 0; i < num_hashes; ++i) {
+    f((h1 + i * h2) % num_bits);
+  }
+}
+
+} // namespace
+
+std::string
+ServerRecordFilterEncoding::encodeKeySet(std::vector<std::string> keys) {
+  std::sort(keys.begin(), keys.end());
+  keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+  std::string out;
+  uint8_t buf[folly::kMaxVarintLength64];
+  for (const std::string& key : keys) {
+    size_t len = folly::encodeVarint(key.size(), buf);
+    out.append(reinterpret_cast<const char*>(buf), len);
+    out.append(key);
+  }
+  return out;
+}
+
+bool ServerRecordFilterEncoding::decodeKeySet(
+    folly::StringPiece encoded,
+    std::vector<folly::StringPiece>* keys_out) {
+  ld_check(keys_out != nullptr);
+  keys_out->clear();
+  folly::ByteRange range(
+      reinterpret_cast<const uint8_t*>(encoded.data()), encoded.size());
+  while (!range.empty()) {
+    auto len = folly::tryDecodeVarint(range);
+    if (len.hasError() || len.value() > range.size()) {
+      return false;
+    }
+    keys_out->emplace_back(
+        reinterpret_cast<const char*>(range.data()), len.value());
+    range.advance(len.value());
+  }
+  return true;
+}
+
+std::string ServerRecordFilterEncoding::buildBloomFilter(
+    const std::vector<std::string>& keys,
+    size_t bits_per_key) {
+  ld_check(bits_per_key > 0);
+  // k = ln(2) * bits per key minimizes the false positive rate.
+  size_t num_hashes = std::max<size_t>(
+      1,
+      std::min<size_t>(MAX_BLOOM_FILTER_HASHES,
+                       static_cast<size_t>(std::round(bits_per_key * 0.69))));
+  const size_t num_bytes =
+      std::max<size_t>(8, (keys.size() * bits_per_key + 7) / 8);
+  const size_t num_bits = num_bytes * 8;
+
+  std::string out(1 + num_bytes, '\0');
+  out[0] = static_cast<char>(num_hashes);
+  for (const std::string& key : keys) {
+    forEachBloomBit(key, num_hashes, num_bits, [&](size_t bit) {
+      out[1 + bit / 8] |= static_cast<char>(1 << (bit % 8));
+    });
+  }
+  return out;
+}
+
+bool ServerRecordFilterEncoding::isValidBloomFilter(
+    folly::StringPiece bloom_filter) {
+  if (bloom_filter.size() < 2) {
+    return false;
+  }
+  const size_t num_hashes = static_cast<uint8_t>(bloom_filter[0]);
+  return num_hashes >= 1 && num_hashes <= MAX_BLOOM_FILTER_HASHES;
+}
+
+bool ServerRecordFilterEncoding::bloomFilterMayContain(
+    folly::StringPiece bloom_filter,
+    folly::StringPiece key) {
+  ld_check(isValidBloomFilter(bloom_filter));
+  const size_t num_hashes = static_cast<uint8_t>(bloom_filter[0]);
+  const size_t num_bits = (bloom_filter.size() - 1) * 8;
+  bool result = true;
+  forEachBloomBit(key, num_hashes, num_bits, [&](size_t bit) {
+    result = result &&
+        (static_cast<uint8_t>(bloom_filter[1 + bit / 8]) & (1 << (bit % 8)));
+  });
+  return result;
+}
+
+}} // namespace facebook::logdevice
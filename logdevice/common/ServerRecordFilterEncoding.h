@@ -0,0 +1,68 @@
+/**
+ * Copyright (c) 2017-present, Facebook, Inc. and its affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <folly/Range.h>
+
+namespace facebook { namespace logdevice {
+
+/**
+ * @file Encoding of the filter keys of the server-side filters that take a
+ *       set of keys (ServerRecordFilterType::KEY_SET and BLOOM).  Readers use
+ *       the encode/build functions to fill ReadStreamAttributes::filter_key1,
+ *       storage nodes use the decode/lookup functions to evaluate the filter.
+ *       Both sides must agree on the format, so it must not change without a
+ *       protocol version bump.
+ */
+
+class ServerRecordFilterEncoding {
+ public:
+  /**
+   * Encodes a set of keys as a sequence of varint-length-prefixed strings.
+   * Duplicates are removed.
+   */
+  static std::string encodeKeySet(std::vector<std::string> keys);
+
+  /**
+   * Decodes the output of encodeKeySet().  The pieces point into `encoded'.
+   *
+   * @return false if `encoded' is malformed.
+   */
+  static bool decodeKeySet(folly::StringPiece encoded,
+                           std::vector<folly::StringPiece>* keys_out);
+
+  /**
+   * Builds a bloom filter containing `keys'.  The first byte of the result
+   * is the number of hash functions, the rest is the bit array.
+   *
+   * @param bits_per_key  size of the bit array per key; 10 bits per key gives
+   *                      a false positive rate of about 1%.
+   */
+  static std::string buildBloomFilter(const std::vector<std::string>& keys,
+                                      size_t bits_per_key = 10);
+
+  /**
+   * @return false if `bloom_filter' is not a valid output of
+   *         buildBloomFilter().
+   */
+  static bool isValidBloomFilter(folly::StringPiece bloom_filter);
+
+  /**
+   * @return false if `key' is definitely not in the set `bloom_filter' was
+   *         built from.  `bloom_filter' must be valid.
+   */
+  static bool bloomFilterMayContain(folly::StringPiece bloom_filter,
+                                    folly::StringPiece key);
+
+  static constexpr size_t MAX_BLOOM_FILTER_HASHES = 30;
+};
+
+}} // namespace facebook::logdevice
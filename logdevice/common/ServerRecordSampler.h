@@ -0,0 +1,77 @@
+/**
+ * Copyright (c) 2017-present, Facebook, Inc. and its affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <string>
+
+#include "logdevice/include/types.h"
+
+namespace facebook { namespace logdevice {
+
+/**
+ * @file Interface for server-side samplers.  A sampler lets a storage node
+ *       ship only a small subset of the records of a read stream (e.g. to
+ *       dashboards that only need one record in a hundred, or one record per
+ *       second).  Records that are not sampled are reported to the client as
+ *       FILTERED_OUT gaps, as for ServerRecordFilter.
+ *
+ *       Samplers only see the records the storage node is going to ship, i.e.
+ *       after single copy delivery filtering, so each sampled record is
+ *       delivered by exactly one storage node.
+ */
+
+/**
+ * 1) EVERY_NTH keeps the records whose ESN is a multiple of N.  The decision
+ *    only depends on the LSN, so all storage nodes agree on it regardless of
+ *    which of them ships the record.
+ * 2) TIME_BUCKET keeps the first record of each time bucket of the given
+ *    width (in milliseconds), based on the record timestamp.  Each storage
+ *    node decides based on the records it ships, so with single copy delivery
+ *    a bucket may be sampled once by each storage node of the read set;
+ *    ClientReadStream delivers the first of them and reports the others as
+ *    FILTERED_OUT gaps.
+ */
+enum class ServerRecordSampleMode : uint8_t {
+  NONE = 0,
+  EVERY_NTH = 1,
+  TIME_BUCKET = 2,
+  MAX
+};
+
+/**
+ * @return true if `param' is valid for `mode': N > 0 for EVERY_NTH, a
+ *         positive bucket width for TIME_BUCKET, anything for NONE.  Readers
+ *         reject invalid parameters in startReading(), storage nodes reject
+ *         START messages with them.
+ */
+inline bool isValidSampleParam(ServerRecordSampleMode mode, uint64_t param) {
+  switch (mode) {
+    case ServerRecordSampleMode::NONE:
+      return true;
+    case ServerRecordSampleMode::EVERY_NTH:
+    case ServerRecordSampleMode::TIME_BUCKET:
+      return param > 0 && param <= std::numeric_limits<int64_t>::max();
+    default:
+      return false;
+  }
+}
+
+class ServerRecordSampler {
+ public:
+  /**
+   * @return true if the record should be shipped to the client.  Called for
+   *         records in LSN order.
+   */
+  virtual bool operator()(lsn_t lsn, std::chrono::milliseconds timestamp) = 0;
+  virtual std::string toString() const = 0;
+  virtual ~ServerRecordSampler() {}
+};
+}} // namespace facebook::logdevice
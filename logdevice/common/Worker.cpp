@@ -47,7 +47,9 @@
 #include "logdevice/common/PermissionChecker.h"
 #include "logdevice/common/PrincipalParser.h"
 #include "logdevice/common/Processor.h"
+#include "logdevice/common/ReleaseBatcher.h"
 #include "logdevice/common/SSLFetcher.h"
+#include "logdevice/common/SealBatcher.h"
 #include "logdevice/common/SequencerBackgroundActivator.h"
 #include "logdevice/common/ServerConfigUpdatedRequest.h"
 #include "logdevice/common/SyncSequencerRequest.h"
@@ -109,6 +111,7 @@ class WorkerImpl {
   ShardAuthoritativeStatusManager shardStatusManager_;
   Sender sender_;
   LogRebuildingMap runningLogRebuildings_;
+  ChunkRebuildingMap runningChunkRebuildings_;
   FindKeyRequestMap runningFindKey_;
   FireAndForgetRequestMap runningFireAndForgets_;
   TrimRequestMap runningTrimRequests_;
@@ -137,6 +140,8 @@ class WorkerImpl {
   LogIDUniqueQueue recoveryQueueDataLog_;
   LogIDUniqueQueue recoveryQueueMetaDataLog_;
   AllClientReadStreams clientReadStreams_;
+  ReleaseBatcher releaseBatcher_;
+  SealBatcher sealBatcher_;
   WriteMetaDataRecordMap runningWriteMetaDataRecords_;
   AppendRequestEpochMap appendRequestEpochMap_;
   CheckNodeHealthRequestSet pendingHealthChecks_;
@@ -496,6 +501,9 @@ void Worker::finishWorkAndCloseSockets() {
     // that before we tear down the messaging fabric.
     subclassWorkFinished();
     clientReadStreams().clear();
+    // Send the RELEASEs still waiting in batches before sockets close.
+    releaseBatcher().flush();
+    sealBatcher().flush();
     noteShuttingDownNoPendingRequests();
 
     ld_info("Shutting down Sender");
@@ -975,6 +983,10 @@ LogRebuildingMap& Worker::runningLogRebuildings() const {
   return impl_->runningLogRebuildings_;
 }
 
+ChunkRebuildingMap& Worker::runningChunkRebuildings() const {
+  return impl_->runningChunkRebuildings_;
+}
+
 FindKeyRequestMap& Worker::runningFindKey() const {
   return impl_->runningFindKey_;
 }
@@ -1084,6 +1096,14 @@ AllClientReadStreams& Worker::clientReadStreams() const {
   return impl_->clientReadStreams_;
 }
 
+ReleaseBatcher& Worker::releaseBatcher() const {
+  return impl_->releaseBatcher_;
+}
+
+SealBatcher& Worker::sealBatcher() const {
+  return impl_->sealBatcher_;
+}
+
 WriteMetaDataRecordMap& Worker::runningWriteMetaDataRecords() const {
   return impl_->runningWriteMetaDataRecords_;
 }
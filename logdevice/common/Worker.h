@@ -121,7 +121,9 @@ class MetaDataLogReader;
 class Mutator;
 class Processor;
 class RebuildingCoordinatorInterface;
+class ReleaseBatcher;
 class SSLFetcher;
+class SealBatcher;
 class Sender;
 class ServerConfig;
 class SequencerBackgroundActivator;
@@ -151,6 +153,7 @@ struct IsLogEmptyRequestMap;
 struct DataSizeRequestMap;
 struct LogIDUniqueQueue;
 struct LogRebuildingMap;
+struct ChunkRebuildingMap;
 struct LogRecoveryRequestMap;
 struct LogsConfigApiRequestMap;
 struct LogsConfigManagerReplyMap;
@@ -339,6 +342,9 @@ class Worker : public EventLoop {
   // a map of all currently running LogRebuildings.
   LogRebuildingMap& runningLogRebuildings() const;
 
+  // a map of all ChunkRebuildings with stores or amends in flight.
+  ChunkRebuildingMap& runningChunkRebuildings() const;
+
   // a map of all currently running FindKeyRequests
   FindKeyRequestMap& runningFindKey() const;
 
@@ -491,6 +497,14 @@ class Worker : public EventLoop {
 
   AllClientReadStreams& clientReadStreams() const;
 
+  // Batches the RELEASE messages sent by sequencers on this worker, with
+  // --batch-releases.
+  ReleaseBatcher& releaseBatcher() const;
+
+  // Batches the SEAL messages sent by LogRecoveryRequests on this worker,
+  // with --batch-seals.
+  SealBatcher& sealBatcher() const;
+
   // a map of running WriteMetaDataRecord state machines, noted that we store
   // raw pointers in the map. The state machine is owned by their parent driver,
   // MetaDataLogWriter, which guarantees that it can outlive Workers and its
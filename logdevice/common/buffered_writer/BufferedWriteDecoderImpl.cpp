@@ -7,12 +7,24 @@
  */
 #include "BufferedWriteDecoderImpl.h"
 
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <limits>
+#include <mutex>
+
 #include <lz4.h>
 #include <zstd.h>
+#include <folly/Conv.h>
+#include <folly/Function.h>
+#include <folly/MPMCQueue.h>
 #include <folly/Varint.h>
 
 #include "logdevice/common/DataRecordOwnsPayload.h"
+#include "logdevice/common/Thread.h"
 #include "logdevice/common/debug.h"
+#include "logdevice/common/stats/ClientHistograms.h"
+#include "logdevice/common/stats/Stats.h"
 
 namespace facebook { namespace logdevice {
 
@@ -78,11 +90,304 @@ int decodeHeader(Slice& blob,
   }
   return 0;
 }
+
+// Decompresses the body of a compressed blob (following the header) into a
+// buffer from DecompressionBufferPool.  Does not touch any decoder state, so
+// it can run on any thread.
+int decompress(const Slice& slice,
+               const Compression compression,
+               DecompressionBufferPool::Buffer* buf_out,
+               size_t* size_out) {
+  const uint8_t *ptr = (const uint8_t*)slice.data, *end = ptr + slice.size;
+
+  // Blob should start with a varint containing the uncompressed size
+  uint64_t uncompressed_size;
+  try {
+    folly::ByteRange range(ptr, end);
+    uncompressed_size = folly::decodeVarint(range);
+    ptr = range.begin();
+  } catch (...) {
+    RATELIMIT_ERROR(std::chrono::seconds(1), 1, "Failed to decode varint");
+    return -1;
+  }
+
+  ld_spew("uncompressed length in header is %lu", uncompressed_size);
+  if (uncompressed_size > MAX_PAYLOAD_SIZE_INTERNAL) {
+    RATELIMIT_ERROR(std::chrono::seconds(1),
+                    1,
+                    "Compressed buffered write header says uncompressed length "
+                    "is %lu, should be at most MAX_PAYLOAD_SIZE_INTERNAL (%zu)",
+                    uncompressed_size,
+                    MAX_PAYLOAD_SIZE_INTERNAL);
+    return -1;
+  }
+
+  ld_spew("decompressing blob of size %ld", end - ptr);
+  DecompressionBufferPool::Buffer buf =
+      DecompressionBufferPool::get().allocate(uncompressed_size);
+  if (compression == Compression::ZSTD) {
+    size_t rv = ZSTD_decompress(buf.get(),         // dst
+                                uncompressed_size, // dstCapacity
+                                ptr,               // src
+                                end - ptr);        // compressedSize
+    if (ZSTD_isError(rv)) {
+      RATELIMIT_ERROR(std::chrono::seconds(1),
+                      1,
+                      "ZSTD_decompress() failed: %s",
+                      ZSTD_getErrorName(rv));
+      return -1;
+    }
+    if (rv != uncompressed_size) {
+      RATELIMIT_ERROR(std::chrono::seconds(1),
+                      1,
+                      "Zstd decompression length %zu does not match %lu found"
+                      "in header",
+                      rv,
+                      uncompressed_size);
+      return -1;
+    }
+  }
+  if (compression == Compression::LZ4 || compression == Compression::LZ4_HC) {
+    int rv = LZ4_decompress_safe(
+        (char*)ptr, (char*)buf.get(), end - ptr, uncompressed_size);
+
+    if (rv < 0) {
+      RATELIMIT_ERROR(std::chrono::seconds(1),
+                      1,
+                      "LZ4 decompression failed with error %d",
+                      rv);
+      return -1;
+    }
+    if (rv != uncompressed_size) {
+      RATELIMIT_ERROR(std::chrono::seconds(1),
+                      1,
+                      "LZ4 decompression length %d does not match %lu found"
+                      "in header",
+                      rv,
+                      uncompressed_size);
+      return -1;
+    }
+  }
+
+  *buf_out = std::move(buf);
+  *size_out = uncompressed_size;
+  return 0;
+}
+
+bool isCompressed(Compression compression) {
+  return compression == Compression::ZSTD || compression == Compression::LZ4 ||
+      compression == Compression::LZ4_HC;
+}
+
+// Moves a decompression buffer into a reference-counted handle.  The buffer
+// goes back to the pool when the last copy of the handle is dropped.
+std::shared_ptr<const void> shareBuffer(DecompressionBufferPool::Buffer buf) {
+  auto holder =
+      std::make_shared<DecompressionBufferPool::Buffer>(std::move(buf));
+  const uint8_t* data = holder->get();
+  return std::shared_ptr<const void>(holder, data);
+}
+} // namespace
+
+// Threads that decoders with parallelism > 1 fan decompression out to, shared
+// by all of them in the process.  Started on demand, up to the highest
+// parallelism any decoder asked for.  Each such decoder holds a reference;
+// when the last one is destroyed, the pool stops and joins its threads.
+class DecodeThreadPool {
+ public:
+  static constexpr size_t MAX_THREADS = 64;
+  static constexpr size_t QUEUE_SIZE = 1024;
+
+  // Returns the pool, creating it if no decoder holds a reference.
+  static std::shared_ptr<DecodeThreadPool> acquire() {
+    Instance& instance = getInstance();
+    std::lock_guard<std::mutex> lock(instance.mutex);
+    std::shared_ptr<DecodeThreadPool> pool = instance.pool.lock();
+    if (!pool) {
+      pool.reset(new DecodeThreadPool());
+      instance.pool = pool;
+    }
+    return pool;
+  }
+
+  // Returns the pool if a decoder holds a reference, nullptr otherwise.
+  static std::shared_ptr<DecodeThreadPool> current() {
+    Instance& instance = getInstance();
+    std::lock_guard<std::mutex> lock(instance.mutex);
+    return instance.pool.lock();
+  }
+
+  ~DecodeThreadPool() {
+    // An empty function makes the thread that reads it exit, so each thread
+    // takes exactly one.  Helpers still queued run first and find nothing
+    // left to do.
+    for (size_t i = 0; i < threads_.size(); ++i) {
+      queue_.blockingWrite(folly::Function<void()>());
+    }
+    for (auto& thread : threads_) {
+      thread->join();
+    }
+  }
+
+  // Tries to make sure that at least `n' threads (capped to MAX_THREADS) are
+  // running.  Returns the number of running threads.
+  size_t ensureThreads(size_t n) {
+    n = std::min(n, MAX_THREADS);
+    size_t running = num_threads_.load();
+    if (running >= n) {
+      return running;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    while (threads_.size() < n) {
+      threads_.emplace_back(new DecodeThread(&queue_, threads_.size()));
+      if (threads_.back()->start() != 0) {
+        threads_.pop_back();
+        break;
+      }
+      num_threads_.store(threads_.size());
+    }
+    return threads_.size();
+  }
+
+  size_t numThreads() const {
+    return num_threads_.load();
+  }
+
+  // Runs `fn' on one of the threads.  Fails if the queue is full.
+  bool add(folly::Function<void()> fn) {
+    return queue_.write(std::move(fn));
+  }
+
+ private:
+  class DecodeThread : public Thread {
+   public:
+    DecodeThread(folly::MPMCQueue<folly::Function<void()>>* queue, size_t num)
+        : queue_(queue), num_(num) {}
+
+   protected:
+    void run() override {
+      for (;;) {
+        folly::Function<void()> fn;
+        queue_->blockingRead(fn);
+        if (!fn) {
+          // The pool is shutting down
+          return;
+        }
+        fn();
+      }
+    }
+
+    std::string threadName() override {
+      return "ld:decode" + folly::to<std::string>(num_);
+    }
+
+   private:
+    folly::MPMCQueue<folly::Function<void()>>* const queue_;
+    const size_t num_;
+  };
+
+  struct Instance {
+    std::mutex mutex;
+    std::weak_ptr<DecodeThreadPool> pool;
+  };
+
+  static Instance& getInstance() {
+    // Never destroyed, decoders may be destroyed during static destruction.
+    static Instance* instance = new Instance();
+    return *instance;
+  }
+
+  DecodeThreadPool() : queue_(QUEUE_SIZE) {}
+
+  folly::MPMCQueue<folly::Function<void()>> queue_;
+  std::mutex mutex_;
+  std::vector<std::unique_ptr<DecodeThread>> threads_;
+  std::atomic<size_t> num_threads_{0};
+};
+
+constexpr size_t DecodeThreadPool::MAX_THREADS;
+constexpr size_t DecodeThreadPool::QUEUE_SIZE;
+
+namespace {
+// Compressed blobs of one decodeEach() call, decompressed concurrently by the
+// calling thread and by helpers on DecodeThreadPool.  Each participant claims
+// the next job until all are claimed.  Helpers that run late find nothing to
+// do; they share ownership of this object so that it outlives them.
+struct DecompressionJobs {
+  struct Job {
+    Slice blob;
+    Compression compression;
+    DecompressionBufferPool::Buffer buf;
+    size_t size{0};
+    int rv{-1};
+    std::chrono::microseconds latency{0};
+  };
+
+  std::vector<Job> jobs;
+  std::atomic<size_t> next{0};
+  std::atomic<size_t> remaining{0};
+  std::mutex mutex;
+  std::condition_variable cv;
+
+  void run() {
+    for (size_t i; (i = next.fetch_add(1)) < jobs.size();) {
+      Job& job = jobs[i];
+      auto start = std::chrono::steady_clock::now();
+      job.rv = decompress(job.blob, job.compression, &job.buf, &job.size);
+      job.latency = std::chrono::duration_cast<std::chrono::microseconds>(
+          std::chrono::steady_clock::now() - start);
+      if (remaining.fetch_sub(1) == 1) {
+        std::lock_guard<std::mutex> lock(mutex);
+        cv.notify_all();
+      }
+    }
+  }
+
+  void wait() {
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait(lock, [this] { return remaining.load() == 0; });
+  }
+};
 } // namespace
 
+BufferedWriteDecoderImpl::BufferedWriteDecoderImpl(size_t parallelism,
+                                                   StatsHolder* stats)
+    : parallelism_(std::max<size_t>(parallelism, 1)), stats_(stats) {
+  if (parallelism_ > 1) {
+    pool_ = DecodeThreadPool::acquire();
+  }
+}
+
+void BufferedWriteDecoderImpl::noteDecoded(
+    size_t bytes,
+    std::chrono::microseconds latency) {
+  CLIENT_HISTOGRAM_ADD(stats_, buffered_write_decoded_bytes, bytes);
+  CLIENT_HISTOGRAM_ADD(stats_, buffered_write_decode_latency, latency.count());
+}
+
 int BufferedWriteDecoderImpl::decode(
     std::vector<std::unique_ptr<DataRecord>>&& records,
     std::vector<Payload>& payloads_out) {
+  if (parallelism_ > 1 && records.size() > 1) {
+    // The payloads we return must stay valid for the decoder's lifetime, so
+    // pin what backs them.
+    std::vector<std::vector<Payload>> payloads;
+    std::vector<std::shared_ptr<const void>> owners;
+    std::vector<int> rvs;
+    decodeEach(records, payloads, owners, rvs);
+    int rv = 0;
+    for (size_t i = 0; i < records.size(); ++i) {
+      if (rvs[i] == 0) {
+        payloads_out.insert(
+            payloads_out.end(), payloads[i].begin(), payloads[i].end());
+        pinned_shared_payloads_.push_back(std::move(owners[i]));
+      } else {
+        rv = -1;
+      }
+    }
+    return rv;
+  }
+
   // We'll decode into this vector first to avoid partially filling
   // `payloads_out' with a batch that ends up failing to decode.
   std::vector<Payload> payloads_tmp;
@@ -99,6 +404,124 @@ int BufferedWriteDecoderImpl::decode(
   return rv;
 }
 
+void BufferedWriteDecoderImpl::decodeEach(
+    std::vector<std::unique_ptr<DataRecord>>& records,
+    std::vector<std::vector<Payload>>& payloads_out,
+    std::vector<std::shared_ptr<const void>>& owners_out,
+    std::vector<int>& rv_out) {
+  payloads_out.clear();
+  payloads_out.resize(records.size());
+  owners_out.clear();
+  owners_out.resize(records.size());
+  rv_out.assign(records.size(), -1);
+
+  constexpr size_t NO_JOB = std::numeric_limits<size_t>::max();
+  auto jobs = std::make_shared<DecompressionJobs>();
+  std::vector<size_t> job_index(records.size(), NO_JOB);
+  if (pool_ && records.size() > 1) {
+    for (size_t i = 0; i < records.size(); ++i) {
+      Slice blob(records[i]->payload);
+      flags_t flags;
+      if (decodeHeader(blob, &flags, nullptr) != 0) {
+        continue;
+      }
+      Compression compression = (Compression)(flags & Flags::COMPRESSION_MASK);
+      if (isCompressed(compression)) {
+        job_index[i] = jobs->jobs.size();
+        jobs->jobs.push_back(DecompressionJobs::Job{blob, compression});
+      }
+    }
+  }
+
+  const size_t njobs = jobs->jobs.size();
+  if (njobs > 1) {
+    jobs->remaining.store(njobs);
+    const size_t threads = pool_->ensureThreads(parallelism_ - 1);
+    const size_t helpers = std::min(threads, std::min(parallelism_, njobs) - 1);
+    for (size_t i = 0; i < helpers; ++i) {
+      if (!pool_->add([jobs] { jobs->run(); })) {
+        // Queue full, the calling thread does the rest.
+        break;
+      }
+    }
+    jobs->run();
+    jobs->wait();
+  }
+
+  // Parse the decompressed blobs on the calling thread
+  for (size_t i = 0; i < records.size(); ++i) {
+    if (job_index[i] == NO_JOB || njobs <= 1) {
+      rv_out[i] = decodeOwned(records[i], payloads_out[i], &owners_out[i]);
+    } else {
+      DecompressionJobs::Job& job = jobs->jobs[job_index[i]];
+      auto start = std::chrono::steady_clock::now();
+      if (job.rv == 0 &&
+          decodeUnowned(Slice(job.buf.get(), job.size), payloads_out[i]) ==
+              0) {
+        noteDecoded(job.size,
+                    job.latency +
+                        std::chrono::duration_cast<std::chrono::microseconds>(
+                            std::chrono::steady_clock::now() - start));
+        owners_out[i] = shareBuffer(std::move(job.buf));
+        records[i].reset();
+        rv_out[i] = 0;
+      }
+    }
+    if (rv_out[i] != 0) {
+      payloads_out[i].clear();
+    }
+  }
+}
+
+int BufferedWriteDecoderImpl::decodeOwned(
+    std::unique_ptr<DataRecord>& record,
+    std::vector<Payload>& payloads_out,
+    std::shared_ptr<const void>* owner_out) {
+  // For the memory ownership transfer to work as intended, `record' needs to
+  // be a DataRecordOwnsPayload under the hood.
+  ld_assert(dynamic_cast<DataRecordOwnsPayload*>(record.get()) != nullptr);
+
+  auto start = std::chrono::steady_clock::now();
+  Slice blob(record->payload);
+  flags_t flags;
+  if (decodeHeader(blob, &flags, nullptr) != 0) {
+    return -1;
+  }
+
+  Compression compression = (Compression)(flags & Flags::COMPRESSION_MASK);
+  if (compression == Compression::NONE) {
+    if (decodeUnowned(blob, payloads_out) != 0) {
+      return -1;
+    }
+    noteDecoded(blob.size,
+                std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now() - start));
+    *owner_out = std::shared_ptr<const void>(std::move(record));
+    return 0;
+  }
+
+  if (!isCompressed(compression)) {
+    RATELIMIT_ERROR(std::chrono::seconds(1),
+                    1,
+                    "Invalid compression flag value 0x%02x",
+                    (uint8_t)compression);
+    return -1;
+  }
+
+  DecompressionBufferPool::Buffer buf;
+  size_t size;
+  if (decompress(blob, compression, &buf, &size) != 0 ||
+      decodeUnowned(Slice(buf.get(), size), payloads_out) != 0) {
+    return -1;
+  }
+  noteDecoded(size,
+              std::chrono::duration_cast<std::chrono::microseconds>(
+                  std::chrono::steady_clock::now() - start));
+  *owner_out = shareBuffer(std::move(buf));
+  record.reset();
+  return 0;
+}
+
 int BufferedWriteDecoderImpl::decodeOne(std::unique_ptr<DataRecord>&& record,
                                         std::vector<Payload>& payloads_out) {
   Slice slice(record->payload);
@@ -116,6 +539,36 @@ int BufferedWriteDecoderImpl::decodeOne(const DataRecord& record,
                    /* copy_blob_if_uncompressed */ true);
 };
 
+int BufferedWriteDecoderImpl::decodeOneShared(
+    DataRecordOwnsPayload& record,
+    std::vector<Payload>& payloads_out) {
+  Slice blob(record.payload);
+  flags_t flags;
+  if (decodeHeader(blob, &flags, nullptr) != 0) {
+    return -1;
+  }
+
+  Compression compression = (Compression)(flags & Flags::COMPRESSION_MASK);
+  if (compression != Compression::NONE) {
+    // Decompression writes into a buffer owned by the decoder, the record is
+    // not referenced afterwards
+    return decodeOne(Slice(record.payload),
+                     payloads_out,
+                     nullptr,
+                     /* copy_blob_if_uncompressed */ false);
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  int rv = decodeUnowned(blob, payloads_out);
+  if (rv == 0) {
+    pinned_shared_payloads_.push_back(record.sharePayload());
+    noteDecoded(blob.size,
+                std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now() - start));
+  }
+  return rv;
+}
+
 int BufferedWriteDecoderImpl::decodeOne(Slice blob,
                                         std::vector<Payload>& payloads_out,
                                         std::unique_ptr<DataRecord>&& record,
@@ -126,6 +579,12 @@ int BufferedWriteDecoderImpl::decodeOne(Slice blob,
     ld_assert(dynamic_cast<DataRecordOwnsPayload*>(record.get()) != nullptr);
   }
 
+  auto start = std::chrono::steady_clock::now();
+  auto elapsed = [&start] {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start);
+  };
+
   flags_t flags;
   if (decodeHeader(blob, &flags, nullptr) != 0) {
     return -1;
@@ -134,9 +593,9 @@ int BufferedWriteDecoderImpl::decodeOne(Slice blob,
   Compression compression = (Compression)(flags & Flags::COMPRESSION_MASK);
   switch (compression) {
     case Compression::NONE: {
-      std::unique_ptr<uint8_t[]> buf;
+      DecompressionBufferPool::Buffer buf;
       if (copy_blob_if_uncompressed) {
-        buf = std::make_unique<uint8_t[]>(blob.size);
+        buf = DecompressionBufferPool::get().allocate(blob.size);
         memcpy(buf.get(), blob.data, blob.size);
         blob = Slice(buf.get(), blob.size);
       }
@@ -148,6 +607,7 @@ int BufferedWriteDecoderImpl::decodeOne(Slice blob,
         } else {
           pinned_data_records_.push_back(std::move(record));
         }
+        noteDecoded(blob.size, elapsed());
       }
       return rv;
     }
@@ -155,11 +615,14 @@ int BufferedWriteDecoderImpl::decodeOne(Slice blob,
     case Compression::ZSTD:
     case Compression::LZ4:
     case Compression::LZ4_HC: {
-      int rv = decodeCompressed(blob, compression, payloads_out);
+      size_t decoded_bytes;
+      int rv =
+          decodeCompressed(blob, compression, payloads_out, &decoded_bytes);
       // If we succeeded, steal the DataRecordOwnsPayload from the client to
       // be consistent with the uncompressed case.
       if (rv == 0) {
         record.reset();
+        noteDecoded(decoded_bytes, elapsed());
       }
       return rv;
     }
@@ -192,6 +655,11 @@ int BufferedWriteDecoderImpl::getCompression(const DataRecord& record,
   return -1;
 }
 
+size_t BufferedWriteDecoderImpl::getDecodeThreadCount() {
+  std::shared_ptr<DecodeThreadPool> pool = DecodeThreadPool::current();
+  return pool ? pool->numThreads() : 0;
+}
+
 int BufferedWriteDecoderImpl::decodeUnowned(
     const Slice& slice,
     std::vector<Payload>& payloads_out) {
@@ -225,83 +693,21 @@ int BufferedWriteDecoderImpl::decodeUnowned(
 int BufferedWriteDecoderImpl::decodeCompressed(
     const Slice& slice,
     const Compression compression,
-    std::vector<Payload>& payloads_out) {
-  const uint8_t *ptr = (const uint8_t*)slice.data, *end = ptr + slice.size;
-
-  // Blob should start with a varint containing the uncompressed size
-  uint64_t uncompressed_size;
-  try {
-    folly::ByteRange range(ptr, end);
-    uncompressed_size = folly::decodeVarint(range);
-    ptr = range.begin();
-  } catch (...) {
-    RATELIMIT_ERROR(std::chrono::seconds(1), 1, "Failed to decode varint");
-    return -1;
-  }
-
-  ld_spew("uncompressed length in header is %lu", uncompressed_size);
-  if (uncompressed_size > MAX_PAYLOAD_SIZE_INTERNAL) {
-    RATELIMIT_ERROR(std::chrono::seconds(1),
-                    1,
-                    "Compressed buffered write header says uncompressed length "
-                    "is %lu, should be at most MAX_PAYLOAD_SIZE_INTERNAL (%zu)",
-                    uncompressed_size,
-                    MAX_PAYLOAD_SIZE_INTERNAL);
+    std::vector<Payload>& payloads_out,
+    size_t* decoded_bytes_out) {
+  DecompressionBufferPool::Buffer buf;
+  size_t uncompressed_size;
+  if (decompress(slice, compression, &buf, &uncompressed_size) != 0) {
     return -1;
   }
 
-  ld_spew("decompressing blob of size %ld", end - ptr);
-  std::unique_ptr<uint8_t[]> buf(new uint8_t[uncompressed_size]);
-  if (compression == Compression::ZSTD) {
-    size_t rv = ZSTD_decompress(buf.get(),         // dst
-                                uncompressed_size, // dstCapacity
-                                ptr,               // src
-                                end - ptr);        // compressedSize
-    if (ZSTD_isError(rv)) {
-      RATELIMIT_ERROR(std::chrono::seconds(1),
-                      1,
-                      "ZSTD_decompress() failed: %s",
-                      ZSTD_getErrorName(rv));
-      return -1;
-    }
-    if (rv != uncompressed_size) {
-      RATELIMIT_ERROR(std::chrono::seconds(1),
-                      1,
-                      "Zstd decompression length %zu does not match %lu found"
-                      "in header",
-                      rv,
-                      uncompressed_size);
-      return -1;
-    }
-  }
-  if (compression == Compression::LZ4 || compression == Compression::LZ4_HC) {
-    int rv = LZ4_decompress_safe(
-        (char*)ptr, (char*)buf.get(), end - ptr, uncompressed_size);
-
-    if (rv < 0) {
-      RATELIMIT_ERROR(std::chrono::seconds(1),
-                      1,
-                      "LZ4 decompression failed with error %d",
-                      rv);
-      return -1;
-    }
-    if (rv != uncompressed_size) {
-      RATELIMIT_ERROR(std::chrono::seconds(1),
-                      1,
-                      "LZ4 decompression length %d does not match %lu found"
-                      "in header",
-                      rv,
-                      uncompressed_size);
-      return -1;
-    }
-  }
-
   if (decodeUnowned(Slice(buf.get(), uncompressed_size), payloads_out) != 0) {
     return -1;
   }
 
   // Decoding succeeded.  Pin the decompressed buffer.
   pinned_buffers_.push_back(std::move(buf));
+  *decoded_bytes_out = uncompressed_size;
   return 0;
 }
 }} // namespace facebook::logdevice
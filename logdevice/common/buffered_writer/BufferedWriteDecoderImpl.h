@@ -7,16 +7,22 @@
  */
 #pragma once
 
+#include <chrono>
 #include <deque>
 #include <memory>
 #include <vector>
 
+#include "logdevice/common/buffered_writer/DecompressionBufferPool.h"
 #include "logdevice/common/types_internal.h"
 #include "logdevice/include/BufferedWriteDecoder.h"
 #include "logdevice/include/BufferedWriter.h"
 
 namespace facebook { namespace logdevice {
 
+struct DataRecordOwnsPayload;
+class DecodeThreadPool;
+class StatsHolder;
+
 class BufferedWriteDecoderImpl : public BufferedWriteDecoder {
  public:
   // Represents a bitset of flags included in every record constructed by
@@ -32,8 +38,34 @@ class BufferedWriteDecoderImpl : public BufferedWriteDecoder {
     static constexpr flags_t SIZE_INCLUDED = 1 << 3;
   };
 
+  BufferedWriteDecoderImpl() {}
+
+  /**
+   * @param parallelism  maximum number of threads decode() uses to
+   *                     decompress batches, see
+   *                     BufferedWriteDecoder::Options::parallelism
+   * @param stats        if not null, the size and latency of every decoded
+   *                     blob are recorded in its client histograms
+   */
+  explicit BufferedWriteDecoderImpl(size_t parallelism,
+                                    StatsHolder* stats = nullptr);
+
   int decode(std::vector<std::unique_ptr<DataRecord>>&& records,
              std::vector<Payload>& payloads_out);
+
+  // Decodes each of `records' on its own.  `rv_out[i]' is 0 if records[i]
+  // was decoded, in which case its payloads are in `payloads_out[i]' and
+  // `owners_out[i]' keeps the memory they point into alive: the
+  // decompression buffer, which goes back to DecompressionBufferPool as soon
+  // as the last reference is dropped, or the record itself if the blob is
+  // uncompressed.  The decoder keeps nothing, so the payloads may outlive it.
+  // Decoded records are claimed; the others are left in `records'.  With
+  // parallelism_ > 1, compressed blobs are decompressed concurrently.
+  void decodeEach(std::vector<std::unique_ptr<DataRecord>>& records,
+                  std::vector<std::vector<Payload>>& payloads_out,
+                  std::vector<std::shared_ptr<const void>>& owners_out,
+                  std::vector<int>& rv_out);
+
   // Decodes a single DataRecord.  Claims ownership of the DataRecord if
   // successful.  Allowed to partially fill `payloads_out' in case of failed
   // decoding.  If necessary, caller will ensure atomicity in appending to the
@@ -45,6 +77,13 @@ class BufferedWriteDecoderImpl : public BufferedWriteDecoder {
   // unconditionally relinquish ownership of the DataRecord.
   int decodeOne(const DataRecord& record, std::vector<Payload>& payloads_out);
 
+  // Variant that neither consumes nor copies the input DataRecord.  If the
+  // blob is uncompressed, the decoder shares ownership of the record's
+  // payload buffer (see DataRecordOwnsPayload::sharePayload()), so the
+  // decoded payloads remain valid after the record is destroyed.
+  int decodeOneShared(DataRecordOwnsPayload& record,
+                      std::vector<Payload>& payloads_out);
+
   // Internal variant of decodeOne() where `record' is optional (`blob' may
   // point into a manually managed piece of memory).
   int decodeOne(Slice blob,
@@ -59,6 +98,11 @@ class BufferedWriteDecoderImpl : public BufferedWriteDecoder {
   static int getCompression(const DataRecord& record,
                             Compression* compression_out);
 
+  // Number of threads running in the pool that decoders with parallelism > 1
+  // share.  The pool stops and joins them when the last such decoder is
+  // destroyed.  For tests.
+  static size_t getDecodeThreadCount();
+
  private:
   // Decodes an uncompressed blob without claiming ownership of the memory.
   int decodeUnowned(const Slice& slice, std::vector<Payload>& payloads_out);
@@ -67,12 +111,29 @@ class BufferedWriteDecoderImpl : public BufferedWriteDecoder {
   // DataRecord is no longer needed.
   int decodeCompressed(const Slice& slice,
                        BufferedWriter::Options::Compression compression,
-                       std::vector<Payload>& payloads_out);
+                       std::vector<Payload>& payloads_out,
+                       size_t* decoded_bytes_out);
+  // Decodes `record' on the calling thread for decodeEach().  On success,
+  // claims the record and sets `owner_out'.
+  int decodeOwned(std::unique_ptr<DataRecord>& record,
+                  std::vector<Payload>& payloads_out,
+                  std::shared_ptr<const void>* owner_out);
+  // Records a successfully decoded blob in the histograms of stats_.
+  void noteDecoded(size_t bytes, std::chrono::microseconds latency);
+
+  const size_t parallelism_{1};
+  StatsHolder* const stats_{nullptr};
+  // Threads decodeEach() fans decompression out to, if parallelism_ > 1
+  std::shared_ptr<DecodeThreadPool> pool_;
 
   // DataRecord instances we decoded and assumed ownership of from the client
   std::deque<std::unique_ptr<DataRecord>> pinned_data_records_;
   // Buffers used for decompression; Payload instances we returned to the
-  // client point into these buffers.
-  std::deque<std::unique_ptr<uint8_t[]>> pinned_buffers_;
+  // client point into these buffers.  They go back to the pool when the
+  // decoder is destroyed.
+  std::deque<DecompressionBufferPool::Buffer> pinned_buffers_;
+  // Payload buffers of records decoded with decodeOneShared(), and memory
+  // backing the payloads returned by decode() with parallelism_ > 1
+  std::deque<std::shared_ptr<const void>> pinned_shared_payloads_;
 };
 }} // namespace facebook::logdevice
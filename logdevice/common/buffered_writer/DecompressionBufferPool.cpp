@@ -0,0 +1,82 @@
+/**
+ * Copyright (c) 2017-present, Facebook, Inc. and its affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+#include "DecompressionBufferPool.h"
+
+#include <algorithm>
+
+#include "logdevice/common/checks.h"
+
+namespace facebook { namespace logdevice {
+
+constexpr size_t DecompressionBufferPool::MIN_CLASS_SIZE;
+constexpr size_t DecompressionBufferPool::MAX_CLASS_SIZE;
+constexpr size_t DecompressionBufferPool::MAX_RETAINED_BYTES_PER_CLASS;
+constexpr size_t DecompressionBufferPool::NUM_CLASSES;
+
+void DecompressionBufferPool::Deleter::operator()(uint8_t* buf) const {
+  if (pool_) {
+    pool_->release(buf, size_class_);
+  } else {
+    delete[] buf;
+  }
+}
+
+DecompressionBufferPool& DecompressionBufferPool::get() {
+  // Never destroyed, buffers may be released during static destruction.
+  static DecompressionBufferPool* pool = new DecompressionBufferPool();
+  return *pool;
+}
+
+DecompressionBufferPool::DecompressionBufferPool() = default;
+DecompressionBufferPool::~DecompressionBufferPool() = default;
+
+DecompressionBufferPool::Buffer DecompressionBufferPool::allocate(size_t size) {
+  if (size > MAX_CLASS_SIZE) {
+    return Buffer(new uint8_t[size], Deleter());
+  }
+  size_t size_class = 0;
+  while (classSize(size_class) < size) {
+    ++size_class;
+  }
+  ld_check(size_class < NUM_CLASSES);
+
+  SizeClass& c = classes_[size_class];
+  {
+    std::lock_guard<std::mutex> lock(c.mutex);
+    if (!c.free_buffers.empty()) {
+      uint8_t* buf = c.free_buffers.back().release();
+      c.free_buffers.pop_back();
+      return Buffer(buf, Deleter(this, size_class));
+    }
+  }
+  return Buffer(new uint8_t[classSize(size_class)], Deleter(this, size_class));
+}
+
+void DecompressionBufferPool::release(uint8_t* buf, size_t size_class) {
+  ld_check(size_class < NUM_CLASSES);
+  std::unique_ptr<uint8_t[]> owned(buf);
+  const size_t max_retained =
+      std::max<size_t>(1, MAX_RETAINED_BYTES_PER_CLASS / classSize(size_class));
+
+  SizeClass& c = classes_[size_class];
+  std::lock_guard<std::mutex> lock(c.mutex);
+  if (c.free_buffers.size() < max_retained) {
+    c.free_buffers.push_back(std::move(owned));
+  }
+}
+
+size_t DecompressionBufferPool::getRetainedBytes() {
+  size_t total = 0;
+  for (size_t i = 0; i < NUM_CLASSES; ++i) {
+    std::lock_guard<std::mutex> lock(classes_[i].mutex);
+    total += classes_[i].free_buffers.size() * classSize(i);
+  }
+  return total;
+}
+
+}} // namespace facebook::logdevice
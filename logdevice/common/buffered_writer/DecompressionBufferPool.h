@@ -0,0 +1,94 @@
+/**
+ * Copyright (c) 2017-present, Facebook, Inc. and its affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace facebook { namespace logdevice {
+
+/**
+ * @file Process-wide pool of buffers that BufferedWriteDecoder decompresses
+ *       batches into.  Buffers are grouped in power-of-two size classes from
+ *       MIN_CLASS_SIZE to MAX_CLASS_SIZE; a request is served from the
+ *       smallest class that fits, so that a buffer freed by one decoder can
+ *       be reused for a batch of a slightly different size by the next one.
+ *       Larger requests are not pooled.
+ *
+ *       Each class keeps at most MAX_RETAINED_BYTES_PER_CLASS bytes of free
+ *       buffers (and at least one buffer); buffers released beyond that are
+ *       freed.
+ *
+ *       Thread-safe.
+ */
+
+class DecompressionBufferPool {
+ public:
+  static constexpr size_t MIN_CLASS_SIZE = 4096;
+  static constexpr size_t MAX_CLASS_SIZE = 4 * 1024 * 1024;
+  static constexpr size_t MAX_RETAINED_BYTES_PER_CLASS = 4 * 1024 * 1024;
+
+  // Returns a buffer to the pool it came from when destroyed.
+  class Deleter {
+   public:
+    Deleter() = default;
+    Deleter(DecompressionBufferPool* pool, size_t size_class)
+        : pool_(pool), size_class_(size_class) {}
+
+    void operator()(uint8_t* buf) const;
+
+   private:
+    // nullptr if the buffer is not pooled
+    DecompressionBufferPool* pool_{nullptr};
+    size_t size_class_{0};
+  };
+
+  using Buffer = std::unique_ptr<uint8_t[], Deleter>;
+
+  /**
+   * @return the pool shared by all decoders in the process.
+   */
+  static DecompressionBufferPool& get();
+
+  /**
+   * @return a buffer of at least `size' bytes, with undefined contents.
+   */
+  Buffer allocate(size_t size);
+
+  /**
+   * Number of bytes held in free buffers.  For tests and benchmarks.
+   */
+  size_t getRetainedBytes();
+
+  DecompressionBufferPool();
+  ~DecompressionBufferPool();
+
+ private:
+  static constexpr size_t NUM_CLASSES = 11;
+  static_assert(MIN_CLASS_SIZE << (NUM_CLASSES - 1) == MAX_CLASS_SIZE,
+                "NUM_CLASSES must cover MIN_CLASS_SIZE to MAX_CLASS_SIZE");
+
+  struct SizeClass {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<uint8_t[]>> free_buffers;
+  };
+
+  void release(uint8_t* buf, size_t size_class);
+
+  static size_t classSize(size_t size_class) {
+    return MIN_CLASS_SIZE << size_class;
+  }
+
+  std::array<SizeClass, NUM_CLASSES> classes_;
+};
+
+}} // namespace facebook::logdevice
@@ -11,6 +11,7 @@
 
 #include "logdevice/common/AdminCommandTable.h"
 #include "logdevice/common/DataRecordOwnsPayload.h"
+#include "logdevice/common/EventLoop.h"
 #include "logdevice/common/Sender.h"
 #include "logdevice/common/Worker.h"
 #include "logdevice/common/protocol/STOP_Message.h"
@@ -27,6 +28,42 @@ void AllClientReadStreams::insertAndStart(
   // Starting stream after insert, as start() might need to look up the calling
   // instance.
   insert_result.first->second->start();
+  activateIdleCompactionTimer();
+}
+
+void AllClientReadStreams::clear() {
+  streams_.clear();
+  control_batcher_.clear();
+  if (idle_compaction_timer_) {
+    idle_compaction_timer_->cancel();
+  }
+}
+
+void AllClientReadStreams::activateIdleCompactionTimer() {
+  const auto interval =
+      Worker::settings().client_read_stream_idle_compaction_interval;
+  if (interval.count() <= 0) {
+    return;
+  }
+  if (!idle_compaction_timer_) {
+    idle_compaction_timer_ = std::make_unique<LibeventTimer>(
+        EventLoop::onThisThread()->getEventBase(),
+        [this] { onIdleCompactionTimer(); });
+  }
+  if (!idle_compaction_timer_->isActive()) {
+    idle_compaction_timer_->activate(interval);
+  }
+}
+
+void AllClientReadStreams::onIdleCompactionTimer() {
+  if (streams_.empty()) {
+    // Rearmed by the next insertAndStart().
+    return;
+  }
+  for (auto& it : streams_) {
+    it.second->compactIfIdle();
+  }
+  activateIdleCompactionTimer();
 }
 
 void AllClientReadStreams::erase(read_stream_id_t id) {
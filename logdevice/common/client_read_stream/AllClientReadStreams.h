@@ -11,8 +11,11 @@
 #include <unordered_map>
 
 #include "logdevice/common/AdminCommandTable-fwd.h"
+#include "logdevice/common/LibeventTimer.h"
 #include "logdevice/common/ShardAuthoritativeStatusMap.h"
+#include "logdevice/common/checks.h"
 #include "logdevice/common/client_read_stream/ClientReadStream.h"
+#include "logdevice/common/client_read_stream/ClientReadStreamControlBatcher.h"
 #include "logdevice/common/protocol/GAP_Message.h"
 #include "logdevice/common/protocol/STARTED_Message.h"
 #include "logdevice/common/types_internal.h"
@@ -97,9 +100,7 @@ class AllClientReadStreams : public ShardAuthoritativeStatusSubscriber {
   /**
    * Forces the map to get cleared and all read streams destroyed.
    */
-  void clear() {
-    streams_.clear();
-  }
+  void clear();
 
   // A helper method for getting ClientReadStream instances from streams_
   ClientReadStream* getStream(read_stream_id_t id);
@@ -123,12 +124,51 @@ class AllClientReadStreams : public ShardAuthoritativeStatusSubscriber {
    */
   void forEachStream(std::function<void(ClientReadStream& read_stream)> cb);
 
+  /**
+   * Called by read streams when the number of payload bytes they buffer
+   * changes.
+   */
+  void noteBytesBufferedChanged(int64_t delta) {
+    ld_check(delta >= 0 || bytes_buffered_ >= size_t(-delta));
+    bytes_buffered_ += delta;
+  }
+
+  /**
+   * @return total number of payload bytes buffered by all read streams on
+   *         this worker.
+   */
+  size_t getBytesBuffered() const {
+    return bytes_buffered_;
+  }
+
+  /**
+   * Batches START, WINDOW and STOP messages of the read streams of this
+   * worker, see ClientReadStreamControlBatcher.
+   */
+  ClientReadStreamControlBatcher& controlBatcher() {
+    return control_batcher_;
+  }
+
  private:
+  // Declared before streams_ so that it outlives the read streams, which send
+  // STOPs when destroyed.
+  ClientReadStreamControlBatcher control_batcher_{*this};
+
   // Actual container
   std::unordered_map<read_stream_id_t,
                      std::unique_ptr<ClientReadStream>,
                      read_stream_id_t::Hash>
       streams_;
+
+  size_t bytes_buffered_{0};
+
+  // Periodically calls ClientReadStream::compactIfIdle() on every stream,
+  // see Settings::client_read_stream_idle_compaction_interval.  One timer per
+  // worker rather than one per stream.  Created by the first insertAndStart().
+  std::unique_ptr<LibeventTimer> idle_compaction_timer_;
+
+  void activateIdleCompactionTimer();
+  void onIdleCompactionTimer();
 };
 
 }} // namespace facebook::logdevice
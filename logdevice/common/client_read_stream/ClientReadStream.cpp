@@ -40,6 +40,7 @@
 #include "logdevice/common/client_read_stream/ClientReadStreamConnectionHealth.h"
 #include "logdevice/common/client_read_stream/ClientReadStreamScd.h"
 #include "logdevice/common/client_read_stream/ClientReadStreamTracer.h"
+#include "logdevice/common/client_read_stream/ClientReadStreamWindowController.h"
 #include "logdevice/common/configuration/Configuration.h"
 #include "logdevice/common/debug.h"
 #include "logdevice/common/event_log/EventLogRebuildingSet.h"
@@ -58,6 +59,14 @@ using ConnectionState = ClientReadStreamSenderState::ConnectionState;
 static const std::chrono::milliseconds INITIAL_RETRY_READ_METADATA_DELAY(1000);
 static const std::chrono::milliseconds MAX_RETRY_READ_METADATA_DELAY(30000);
 
+// Parameters of the adaptive window (see ClientReadStreamWindowController).
+// The window never shrinks below this many records ...
+static constexpr size_t MIN_ADAPTIVE_WINDOW_SIZE = 16;
+// ... keeps enough records in flight to cover two round trips ...
+static constexpr double ADAPTIVE_WINDOW_HEADROOM = 2.0;
+// ... and is never slid later than when this fraction of it was consumed.
+static constexpr double MIN_ADAPTIVE_FLOW_CONTROL_THRESHOLD = 0.1;
+
 // Calculates the actual buffer size to use, given the requested size, start
 // and until LSNs.
 static size_t actual_buffer_size(size_t requested_size,
@@ -360,6 +369,18 @@ void ClientReadStream::start() {
         Worker::onThisThread()->getTraceLogger(), this);
   }
 
+  if (deps_->getSettings().client_read_adaptive_window) {
+    ClientReadStreamWindowController::Params params;
+    params.min_window = std::min(MIN_ADAPTIVE_WINDOW_SIZE, buffer_->capacity());
+    params.max_window = buffer_->capacity();
+    params.headroom = ADAPTIVE_WINDOW_HEADROOM;
+    params.min_flow_control_threshold =
+        std::min(MIN_ADAPTIVE_FLOW_CONTROL_THRESHOLD, flow_control_threshold_);
+    params.max_flow_control_threshold = flow_control_threshold_;
+    window_controller_ =
+        std::make_unique<ClientReadStreamWindowController>(params);
+  }
+
   auto gap_grace_period = deps_->computeGapGracePeriod();
 
   if (gap_grace_period > decltype(gap_grace_period)::zero()) {
@@ -500,6 +521,9 @@ void ClientReadStream::sendStart(ShardID shard_id, SenderState& state) {
   if (ignore_released_status_) {
     header.flags |= START_Header::IGNORE_RELEASED_STATUS;
   }
+  if (attrs_.sample_mode != ServerRecordSampleMode::NONE) {
+    header.flags |= START_Header::SAMPLE;
+  }
 
   const auto& filtered_out =
       scd_->isActive() ? scd_->getFilteredOut() : small_shardset_t{};
@@ -527,6 +551,7 @@ void ClientReadStream::sendStart(ShardID shard_id, SenderState& state) {
   if (rv == 0) {
     state.setConnectionState(ConnectionState::CONNECTING);
     state.setWindowHigh(header.window_high);
+    state.window_rtt_probe_sent.clear();
     any_start_sent_ = true;
   } else if (err == E::PROTONOSUPPORT) {
     handleStartPROTONOSUPPORT(shard_id);
@@ -583,6 +608,43 @@ void ClientReadStream::onStartSent(ShardID shard_id, Status status) {
   }
 }
 
+void ClientReadStream::onWindowSendFailed(ShardID shard_id, lsn_t window_low) {
+  auto it = storage_set_states_.find(shard_id);
+  if (it == storage_set_states_.end()) {
+    return;
+  }
+  SenderState& state = it->second;
+  if (state.getConnectionState() != ConnectionState::READING) {
+    // A START is or will be in flight, and will carry an uptodate window.
+    return;
+  }
+  // We don't know which window the shard last heard of, but it is safe to
+  // assume an older one: the retry sends the current window, and storage
+  // shards ignore windows that do not move forward.  What matters is that
+  // sendWindowMessage() does not consider the shard uptodate.
+  ld_check(window_low > LSN_INVALID);
+  state.setWindowHigh(std::min(state.getWindowHigh(), window_low - 1));
+  state.activateRetryWindowTimer();
+}
+
+SocketCallback* ClientReadStream::getSocketClosedCallback(ShardID shard_id) {
+  auto it = storage_set_states_.find(shard_id);
+  return it != storage_set_states_.end()
+      ? it->second.getSocketClosedCallback()
+      : nullptr;
+}
+
+void ClientReadStream::compactIfIdle() {
+  if (active_since_compaction_) {
+    active_since_compaction_ = false;
+    return;
+  }
+  buffer_->releaseMemoryIfEmpty();
+  for (auto& it : storage_set_states_) {
+    it.second.releaseIdleTimers();
+  }
+}
+
 void ClientReadStream::onStarted(ShardID from, const STARTED_Message& msg) {
   ld_check(!done());
   ld_spew("Received STARTED_Message from %s, for log_:%lu, id_:%lu, status:%s",
@@ -724,8 +786,11 @@ void ClientReadStream::onStarted(ShardID from, const STARTED_Message& msg) {
     case E::NOTSTORAGE:
     case E::SHUTDOWN:
     case E::FAILED:
+    case E::INVALID_PARAM: // e.g. invalid sampling parameters
       RATELIMIT_LEVEL(
-          status == E::FAILED ? dbg::Level::ERROR : dbg::Level::DEBUG,
+          status == E::FAILED || status == E::INVALID_PARAM
+              ? dbg::Level::ERROR
+              : dbg::Level::DEBUG,
           std::chrono::seconds(1),
           1,
           "Received STARTED_Message(%s) from:%s (log_:%lu, id_:%lu"
@@ -794,6 +859,7 @@ void ClientReadStream::onDataRecord(
     ShardID shard,
     std::unique_ptr<DataRecordOwnsPayload> record) {
   ld_check(!done());
+  active_since_compaction_ = true;
 
   // There are several possible actions to take with the record:
   // (1) Ignore:
@@ -864,6 +930,17 @@ void ClientReadStream::onDataRecord(
 
   SenderState& sender_state = it->second;
 
+  if (sender_state.window_rtt_probe_sent.hasValue()) {
+    // First record since a WINDOW message unblocked this sender.
+    if (window_controller_) {
+      window_controller_->onRttSample(
+          std::chrono::duration_cast<std::chrono::microseconds>(
+              deps_->getCurrentTime() -
+              sender_state.window_rtt_probe_sent.value()));
+    }
+    sender_state.window_rtt_probe_sent.clear();
+  }
+
   if (filter_version_.val_ != 1 &&
       sender_state.filter_version != filter_version_) {
     ld_debug("Rejecting record from %s for log %lu because of filter_version "
@@ -1008,7 +1085,7 @@ void ClientReadStream::onDataRecord(
     if (!rstate->record) {
       rstate->record = std::move(record);
       // Updating info reg. buffer usage.
-      bytes_buffered_ += rstate->record->payload.size();
+      adjustBytesBuffered(rstate->record->payload.size());
     }
     // This shard won't send us anything before `lsn'+1.
     // Use that information for gap detection.
@@ -1025,6 +1102,7 @@ void ClientReadStream::onDataRecord(
 
 void ClientReadStream::onGap(ShardID shard, const GAP_Message& msg) {
   ld_check(!done());
+  active_since_compaction_ = true;
   auto& gap = msg.getHeader();
 
   ld_spew("%s from %s", gap.identify().c_str(), shard.toString().c_str());
@@ -2837,16 +2915,10 @@ bool ClientReadStream::canDeliverRecordsNow() const {
 
 ClientReadStreamSenderState&
 ClientReadStream::createStateForShard(ShardID shard_id) {
-  const auto& settings = deps_->getSettings();
   auto insert_result = storage_set_states_.emplace(
       std::piecewise_construct,
       std::forward_as_tuple(shard_id),
-      std::forward_as_tuple(
-          this,
-          shard_id,
-          deps_->createBackoffTimer(settings.reader_reconnect_delay),
-          deps_->createBackoffTimer(settings.reader_started_timeout),
-          deps_->createBackoffTimer(settings.reader_retry_window_delay)));
+      std::forward_as_tuple(this, shard_id));
   ld_check(insert_result.second);
   return insert_result.first->second;
 }
@@ -3110,6 +3182,23 @@ int ClientReadStream::deliverRecord(
   }
 
   bool bridge_record = (record->flags_ & RECORD_Header::BRIDGE);
+
+  const bool time_bucket_sampled =
+      attrs_.sample_mode == ServerRecordSampleMode::TIME_BUCKET &&
+      !bridge_record;
+  const int64_t bucket = time_bucket_sampled
+      ? record->attrs.timestamp.count() / int64_t(attrs_.sample_param)
+      : 0;
+  if (time_bucket_sampled && has_sampled_bucket_ &&
+      bucket == last_sampled_bucket_) {
+    // Another storage node already shipped a record of this bucket.
+    int rv = deliverGap(GapType::FILTERED_OUT, lsn, lsn);
+    if (rv == 0) {
+      adjustBytesBuffered(-int64_t(payload_size));
+    }
+    return rv;
+  }
+
   bool success;
   if (reader_) {
     bool notify =
@@ -3165,6 +3254,10 @@ int ClientReadStream::deliverRecord(
       // lsn appropriately in that case.
       last_delivered_lsn_ = lsn;
     }
+    if (time_bucket_sampled) {
+      has_sampled_bucket_ = true;
+      last_sampled_bucket_ = bucket;
+    }
     if (MetaDataLog::isMetaDataLog(log_id_)) {
       if (wait_for_all_copies_) {
         WORKER_STAT_INCR(client.metadata_log_records_delivered_wait_for_all);
@@ -3188,7 +3281,7 @@ int ClientReadStream::deliverRecord(
     num_records_delivered_++;
     num_bytes_delivered_ += payload_size;
     // Updating info reg. buffer usage.
-    bytes_buffered_ -= payload_size;
+    adjustBytesBuffered(-int64_t(payload_size));
     if (current_offset != BYTE_OFFSET_INVALID) {
       accumulated_byte_offset_ = current_offset;
     }
@@ -3442,6 +3535,26 @@ void ClientReadStream::updateServerWindow() {
 }
 
 void ClientReadStream::updateWindowSize() {
+  if (window_controller_) {
+    window_controller_->onWindowSlide(
+        num_records_delivered_, deps_->getCurrentTime());
+    size_t new_size = window_controller_->computeWindowSize(
+        window_size_, deps_->hasMemoryPressure());
+    // Senders were already allowed to send up to window_high_ and WINDOW
+    // messages can only move it forward, so a smaller window only takes
+    // effect as records get delivered.
+    if (window_high_ >= next_lsn_to_deliver_) {
+      new_size = std::max(
+          new_size,
+          std::min<size_t>(buffer_->capacity(),
+                           window_high_ - next_lsn_to_deliver_ + 1));
+    }
+    window_size_ = new_size;
+    flow_control_threshold_ =
+        window_controller_->computeFlowControlThreshold(window_size_);
+    return;
+  }
+
   if (deps_->hasMemoryPressure()) {
     // cut the window size in half
     window_size_ = std::max(size_t(1), window_size_ / 2);
@@ -3568,6 +3681,11 @@ void ClientReadStream::sendWindowMessage(SenderState& state) {
     int rv = deps_->sendWindowMessage(
         state.getShardID(), server_window_.low, server_window_.high);
     if (rv == 0) {
+      if (window_controller_ && state.getNextLsn() > state.getWindowHigh()) {
+        // The sender used up its previous window and is waiting for this
+        // message; its next record completes a round trip.
+        state.window_rtt_probe_sent = deps_->getCurrentTime();
+      }
       state.resetRetryWindowTimer();
       state.setWindowHigh(server_window_.high);
     } else {
@@ -3625,6 +3743,11 @@ ClientReadStream::~ClientReadStream() {
     WORKER_STAT_DECR(client.num_read_streams);
   }
 
+  if (bytes_buffered_ > 0) {
+    // Records still in the buffer are freed with it.
+    deps_->onBytesBufferedChanged(-int64_t(bytes_buffered_));
+  }
+
   // Not safe to destroy while executing a callback
   ld_check(!inside_callback_);
 
@@ -3761,6 +3884,35 @@ void ClientReadStream::handleStartPROTONOSUPPORT(ShardID shard_id) {
   // Assuming a socket to the server exists, which seems reasonable if we just
   // got a PROTONOSUPPORT error.
   ld_check(proto.hasValue());
+  if (attrs_.sample_mode != ServerRecordSampleMode::NONE &&
+      proto.value() < Compatibility::SERVER_SIDE_SAMPLING_SUPPORT) {
+    // The shard cannot sample, and reading from it without sampling would
+    // ship records the reader did not ask for. Like a STARTED with
+    // E::INVALID_PARAM, do not retry until the other end closes the socket.
+    RATELIMIT_ERROR(std::chrono::seconds(10),
+                    1,
+                    "%s does not support server-side sampling (protocol "
+                    "%u < %u), not reading log %lu from it",
+                    shard_id.toString().c_str(),
+                    proto.value(),
+                    Compatibility::SERVER_SIDE_SAMPLING_SUPPORT,
+                    log_id_.val());
+    auto it = storage_set_states_.find(shard_id);
+    ld_check(it != storage_set_states_.end());
+    SenderState& state = it->second;
+    state.setConnectionState(ConnectionState::PERSISTENT_ERROR);
+    state.resetReconnectTimer();
+    state.resetRetryWindowTimer();
+    if (scd_->isActive()) {
+      scd_->addToShardsDownAndScheduleRewind(
+          shard_id,
+          folly::format("{} added to known down list because it does not "
+                        "support server-side sampling",
+                        shard_id.toString())
+              .str());
+    }
+    return;
+  }
   if (proto.value() < coordinated_proto_) {
     RATELIMIT_INFO(
         std::chrono::seconds(10),
@@ -3838,6 +3990,7 @@ void ClientReadStream::rewind(const std::string& reason) {
 
   // clear the entire read stream buffer
   buffer_->clear();
+  adjustBytesBuffered(-int64_t(bytes_buffered_));
 
   gap_end_outside_window_ = LSN_INVALID;
 
@@ -3963,6 +4116,12 @@ size_t ClientReadStream::getBytesBuffered() const {
   return bytes_buffered_;
 }
 
+void ClientReadStream::adjustBytesBuffered(int64_t delta) {
+  ld_check(delta >= 0 || bytes_buffered_ >= size_t(-delta));
+  bytes_buffered_ += delta;
+  deps_->onBytesBufferedChanged(delta);
+}
+
 //
 // Production implementations of ClientReadStreamDependencies methods
 //
@@ -3972,8 +4131,35 @@ ClientReadStreamDependencies::ClientReadStreamDependencies() = default;
 ClientReadStreamDependencies::~ClientReadStreamDependencies() {}
 
 bool ClientReadStreamDependencies::hasMemoryPressure() const {
-  // TODO(T6159466): implement memory limits/accounting
-  return false;
+  const Settings& settings = getSettings();
+  if (settings.client_readers_memory_budget == 0) {
+    return false;
+  }
+  // Each worker gets an equal share of the budget.  Read streams are spread
+  // evenly across workers so this is close enough to a global limit and needs
+  // no synchronization.
+  const size_t worker_budget = std::max<size_t>(
+      1,
+      settings.client_readers_memory_budget /
+          std::max(1, settings.num_workers));
+  return getWorkerBytesBuffered() > worker_budget;
+}
+
+size_t ClientReadStreamDependencies::getWorkerBytesBuffered() const {
+  Worker* w = Worker::onThisThread(false);
+  return w ? w->clientReadStreams().getBytesBuffered() : 0;
+}
+
+std::chrono::steady_clock::time_point
+ClientReadStreamDependencies::getCurrentTime() const {
+  return std::chrono::steady_clock::now();
+}
+
+void ClientReadStreamDependencies::onBytesBufferedChanged(int64_t delta) {
+  Worker* w = Worker::onThisThread(false);
+  if (w) {
+    w->clientReadStreams().noteBytesBufferedChanged(delta);
+  }
 }
 
 void ClientReadStreamDependencies::getMetaDataForEpoch(
@@ -4212,6 +4398,12 @@ int ClientReadStreamDependencies::sendStartMessage(
 
   auto msg = std::make_unique<START_Message>(
       header, filtered_out, attrs, client_session_id_);
+  if (Worker::settings().client_read_batch_control_messages) {
+    // `onclose' is registered when the batch goes out.
+    w->clientReadStreams().controlBatcher().enqueue(
+        read_stream_id_, shard, std::move(msg));
+    return 0;
+  }
   return w->sender().sendMessage(std::move(msg), shard.asNodeID(), onclose);
 }
 
@@ -4225,6 +4417,11 @@ int ClientReadStreamDependencies::sendStopMessage(ShardID shard) {
   header.shard = shard.shard();
 
   auto msg = std::make_unique<STOP_Message>(header);
+  if (Worker::settings().client_read_batch_control_messages) {
+    w->clientReadStreams().controlBatcher().enqueue(
+        read_stream_id_, shard, std::move(msg));
+    return 0;
+  }
   return w->sender().sendMessage(std::move(msg), shard.asNodeID());
 }
 
@@ -4244,6 +4441,11 @@ int ClientReadStreamDependencies::sendWindowMessage(ShardID shard,
   ld_check(window_low <= window_high);
 
   auto msg = std::make_unique<WINDOW_Message>(header);
+  if (Worker::settings().client_read_batch_control_messages) {
+    w->clientReadStreams().controlBatcher().enqueue(
+        read_stream_id_, shard, std::move(msg));
+    return 0;
+  }
   return w->sender().sendMessage(std::move(msg), shard.asNodeID());
 }
 
@@ -7,6 +7,7 @@
  */
 #pragma once
 
+#include <chrono>
 #include <functional>
 #include <memory>
 #include <queue>
@@ -42,6 +43,7 @@ class ClientReadStreamBuffer;
 class ClientReadStreamConnectionHealth;
 class ClientReadStreamScd;
 class ClientReadStreamTracer;
+class ClientReadStreamWindowController;
 class ClientReadTracer;
 class ClientReadersFlowTracer;
 class ClientStalledReadTracer;
@@ -315,8 +317,30 @@ class ClientReadStreamDependencies {
 
   virtual ~ClientReadStreamDependencies();
 
+  /**
+   * @return true if read streams on this worker buffer more than their share
+   *         of client_readers_memory_budget.
+   */
   virtual bool hasMemoryPressure() const;
 
+  /**
+   * @return total number of payload bytes buffered by all read streams on
+   *         this worker, as reported through onBytesBufferedChanged().
+   */
+  virtual size_t getWorkerBytesBuffered() const;
+
+  /**
+   * Called when the number of payload bytes buffered by the read stream
+   * changes by `delta'.
+   */
+  virtual void onBytesBufferedChanged(int64_t delta);
+
+  /**
+   * Clock used to measure round trip times and drain rates for the adaptive
+   * window.
+   */
+  virtual std::chrono::steady_clock::time_point getCurrentTime() const;
+
   virtual TimeoutMap* getCommonTimeouts();
 
   virtual const struct timeval* getZeroTimeout();
@@ -446,6 +470,32 @@ class ClientReadStream : boost::noncopyable {
    */
   void onStartSent(ShardID shard, Status status);
 
+  /**
+   * Called when a WINDOW message to `shard' that
+   * ClientReadStreamDependencies::sendWindowMessage() accepted could not be
+   * sent after all, because it was batched and the batch failed to go out
+   * (see ClientReadStreamControlBatcher).  Schedules a retry.
+   *
+   * @param window_low  low end of the window in the failed message
+   */
+  void onWindowSendFailed(ShardID shard, lsn_t window_low);
+
+  /**
+   * @return the callback that must be registered on the socket to `shard'
+   *         when sending it a START, or nullptr if `shard' is no longer in
+   *         the read set.
+   */
+  SocketCallback* getSocketClosedCallback(ShardID shard);
+
+  /**
+   * Called periodically by AllClientReadStreams.  If no record or gap was
+   * received since the previous call, frees the memory that the stream only
+   * needs while records are flowing: the buffer slots if nothing is
+   * buffered, and the inactive timers of the senders.  Both are allocated
+   * again when needed.
+   */
+  void compactIfIdle();
+
   /**
    * Called by a worker thread when a RECORD message is received from a
    * storage shard.
@@ -1028,10 +1078,19 @@ class ClientReadStream : boost::noncopyable {
    * in increasing order of LSNs as it moves gap information forward.
    */
   void clearRecordState(lsn_t lsn, RecordState& rstate) {
+    if (rstate.record) {
+      adjustBytesBuffered(-int64_t(rstate.record->payload.size()));
+    }
     unlinkRecordState(lsn, rstate);
     rstate.reset();
   }
 
+  /**
+   * Updates bytes_buffered_ and the per-worker total used to detect memory
+   * pressure.
+   */
+  void adjustBytesBuffered(int64_t delta);
+
   /**
    * @return   number of storage shards in the storage set whose GapState is
    *           st regardless of their authoritative status.
@@ -1323,6 +1382,13 @@ class ClientReadStream : boost::noncopyable {
    */
   size_t window_size_;
 
+  /**
+   * If client_read_adaptive_window is set, sizes window_size_ and picks
+   * flow_control_threshold_ from the measured RTT to senders and the rate at
+   * which the application drains records.  Null otherwise.
+   */
+  std::unique_ptr<ClientReadStreamWindowController> window_controller_;
+
   /**
    * The largest LSN in sender's sliding window. This member variable
    * is employed to avoid doing the math every time we call
@@ -1546,6 +1612,16 @@ class ClientReadStream : boost::noncopyable {
   // The timestamp when last record was received by client
   std::chrono::milliseconds last_received_ts_{0};
 
+  // With TIME_BUCKET sampling, the time bucket of the last record delivered.
+  // Each storage node samples the records it ships, so with single copy
+  // delivery several of them may ship a record of the same bucket; all but
+  // the first are delivered as FILTERED_OUT gaps.
+  bool has_sampled_bucket_{false};
+  int64_t last_sampled_bucket_{0};
+
+  // Set when a record or gap is received, cleared by compactIfIdle().
+  bool active_since_compaction_ = true;
+
   // @see scheduleRewind().
   std::unique_ptr<LibeventTimer> immediate_rewind_timer_;
 
@@ -0,0 +1,291 @@
+/**
+ * Copyright (c) 2017-present, Facebook, Inc. and its affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+#include "ClientReadStreamBitmapBuffer.h"
+
+#include <algorithm>
+
+#include "logdevice/common/DataRecordOwnsPayload.h"
+#include "logdevice/common/LibeventTimer.h"
+#include "logdevice/common/client_read_stream/ClientReadStream.h"
+#include "logdevice/common/debug.h"
+
+namespace facebook { namespace logdevice {
+
+using RecordState = ClientReadStreamRecordState;
+
+constexpr size_t ClientReadStreamBitmapBuffer::BITS_PER_WORD;
+
+static bool isMarker(const RecordState& rstate) {
+  return rstate.record || rstate.gap || rstate.filtered_out;
+}
+
+ClientReadStreamBitmapBuffer::ClientReadStreamBitmapBuffer(size_t capacity,
+                                                           lsn_t buffer_head)
+    : capacity_(capacity),
+      bitmap_((capacity + BITS_PER_WORD - 1) / BITS_PER_WORD, 0),
+      buffer_head_(buffer_head) {
+  ld_check(capacity > 0);
+}
+
+ClientReadStreamBitmapBuffer::~ClientReadStreamBitmapBuffer() = default;
+
+template <typename F>
+bool ClientReadStreamBitmapBuffer::scanPhysical(size_t begin,
+                                                size_t end,
+                                                bool reverse,
+                                                F&& f) {
+  if (begin >= end) {
+    return true;
+  }
+  const size_t first_word = begin / BITS_PER_WORD;
+  const size_t last_word = (end - 1) / BITS_PER_WORD;
+  auto masked = [&](size_t w) {
+    uint64_t bits = bitmap_[w];
+    if (w == first_word) {
+      bits &= ~uint64_t(0) << (begin % BITS_PER_WORD);
+    }
+    if (w == last_word && end % BITS_PER_WORD != 0) {
+      bits &= (uint64_t(1) << (end % BITS_PER_WORD)) - 1;
+    }
+    return bits;
+  };
+
+  // f may clear bits of the word being scanned, hence working on a copy.
+  if (!reverse) {
+    for (size_t w = first_word; w <= last_word; ++w) {
+      for (uint64_t bits = masked(w); bits != 0; bits &= bits - 1) {
+        if (!f(w * BITS_PER_WORD + __builtin_ctzll(bits))) {
+          return false;
+        }
+      }
+    }
+  } else {
+    for (size_t w = last_word + 1; w-- > first_word;) {
+      for (uint64_t bits = masked(w); bits != 0;) {
+        const size_t bit = BITS_PER_WORD - 1 - __builtin_clzll(bits);
+        if (!f(w * BITS_PER_WORD + bit)) {
+          return false;
+        }
+        bits &= ~(uint64_t(1) << bit);
+      }
+    }
+  }
+  return true;
+}
+
+template <typename F>
+bool ClientReadStreamBitmapBuffer::scan(size_t offset,
+                                        size_t count,
+                                        bool reverse,
+                                        F&& f) {
+  ld_check(count <= capacity_);
+  if (count == 0) {
+    return true;
+  }
+  const size_t p = physical(offset);
+  if (!reverse) {
+    // Offsets [offset, offset + count): up to the end of slots_, then
+    // wrapping around to its beginning.
+    const size_t first = std::min(count, capacity_ - p);
+    if (!scanPhysical(p, p + first, false, [&](size_t idx) {
+          return f(offset + (idx - p));
+        })) {
+      return false;
+    }
+    return scanPhysical(0, count - first, false, [&](size_t idx) {
+      return f(offset + first + idx);
+    });
+  } else {
+    // Offsets offset, offset - 1, ..., offset - count + 1: down to the
+    // beginning of slots_, then wrapping around to its end.
+    const size_t first = std::min(count, p + 1);
+    if (!scanPhysical(p + 1 - first, p + 1, true, [&](size_t idx) {
+          return f(offset - (p - idx));
+        })) {
+      return false;
+    }
+    const size_t rest = count - first;
+    return scanPhysical(capacity_ - rest, capacity_, true, [&](size_t idx) {
+      return f(offset - first - (capacity_ - 1 - idx));
+    });
+  }
+}
+
+void ClientReadStreamBitmapBuffer::clearBits(size_t begin, size_t end) {
+  if (begin >= end) {
+    return;
+  }
+  const size_t first_word = begin / BITS_PER_WORD;
+  const size_t last_word = (end - 1) / BITS_PER_WORD;
+  for (size_t w = first_word; w <= last_word; ++w) {
+    uint64_t mask = ~uint64_t(0);
+    if (w == first_word) {
+      mask &= ~uint64_t(0) << (begin % BITS_PER_WORD);
+    }
+    if (w == last_word && end % BITS_PER_WORD != 0) {
+      mask &= (uint64_t(1) << (end % BITS_PER_WORD)) - 1;
+    }
+    bitmap_[w] &= ~mask;
+  }
+}
+
+RecordState* ClientReadStreamBitmapBuffer::createOrGet(lsn_t lsn) {
+  // lsn must be with in the range of
+  // [buffer_head, buffer_head + capacity() - 1]
+  if (!LSNInBuffer(lsn)) {
+    return nullptr;
+  }
+  if (!slots_) {
+    slots_.reset(new RecordState[capacity_]);
+  }
+  const size_t idx = physical(lsn - buffer_head_);
+  setBit(idx);
+  return &slots_[idx];
+}
+
+RecordState* ClientReadStreamBitmapBuffer::find(lsn_t lsn) {
+  if (!slots_ || !LSNInBuffer(lsn)) {
+    return nullptr;
+  }
+
+  RecordState& state = slots_[physical(lsn - buffer_head_)];
+  if (!isMarker(state)) {
+    // this is an empty placeholder RecordState, treat it as not
+    // exist
+    ld_check(state.list.empty());
+    return nullptr;
+  }
+
+  return &state;
+}
+
+std::pair<ClientReadStreamRecordState*, lsn_t>
+ClientReadStreamBitmapBuffer::findFirstMarker() {
+  // avoid searching beyond buffer capacity
+  // avoid searching beyond LSN_MAX
+  size_t limit =
+      std::min(capacity(), LSN_MAX - std::max(buffer_head_, 1lu) + 1);
+
+  std::pair<ClientReadStreamRecordState*, lsn_t> result(nullptr, LSN_INVALID);
+  scan(0, limit, false, [&](size_t offset) {
+    const size_t idx = physical(offset);
+    if (isMarker(slots_[idx])) {
+      result = std::make_pair(&slots_[idx], buffer_head_ + offset);
+      return false;
+    }
+    // The slot was handed out by createOrGet() but nothing was stored in
+    // it.  Forget about it so that later scans skip it.
+    ld_check(slots_[idx].list.empty());
+    clearBit(idx);
+    return true;
+  });
+  return result;
+}
+
+ClientReadStreamRecordState* ClientReadStreamBitmapBuffer::front() {
+  if (!slots_) {
+    return nullptr;
+  }
+  RecordState& state = slots_[head_];
+  if (isMarker(state)) {
+    return &state;
+  }
+
+  // the descriptor is a placeholder, return nullptr
+  ld_check(state.list.empty());
+  return nullptr;
+}
+
+void ClientReadStreamBitmapBuffer::popFront() {
+  if (!slots_) {
+    return;
+  }
+  // record and list, if exist, must be already consumed
+  RecordState& state = slots_[head_];
+  ld_check(!state.record && !state.filtered_out);
+  ld_check(state.list.empty());
+  state.reset();
+  clearBit(head_);
+}
+
+void ClientReadStreamBitmapBuffer::advanceBufferHead(size_t offset) {
+  // Important: caller needs to ensure that there must not be any marker
+  // in the buffer slots that get advanced. Assert in the following statements.
+  const size_t n = std::min(offset, capacity_);
+
+#ifndef NDEBUG
+  scan(0, n, false, [&](size_t off) {
+    const RecordState& state = slots_[physical(off)];
+    ld_check(!isMarker(state));
+    ld_check(state.list.empty());
+    return true;
+  });
+#endif
+
+  const size_t first = std::min(n, capacity_ - head_);
+  clearBits(head_, head_ + first);
+  clearBits(0, n - first);
+
+  head_ = (head_ + offset % capacity_) % capacity_;
+  buffer_head_ += offset;
+}
+
+void ClientReadStreamBitmapBuffer::clear() {
+  // Only slots whose bit is set can hold anything.
+  scanPhysical(0, capacity_, false, [&](size_t idx) {
+    slots_[idx].reset();
+    return true;
+  });
+  std::fill(bitmap_.begin(), bitmap_.end(), 0);
+}
+
+bool ClientReadStreamBitmapBuffer::releaseMemoryIfEmpty() {
+  // findFirstMarker() also clears the bits of empty slots.
+  if (!slots_ || findFirstMarker().first != nullptr) {
+    return false;
+  }
+  slots_.reset();
+  std::fill(bitmap_.begin(), bitmap_.end(), 0);
+  return true;
+}
+
+void ClientReadStreamBitmapBuffer::forEachUpto(
+    lsn_t to,
+    std::function<void(lsn_t, RecordState& record)> callback) {
+  if (to < buffer_head_) {
+    return;
+  }
+  forEach(buffer_head_,
+          to,
+          [cb = std::move(callback)](lsn_t lsn, RecordState& rstate) {
+            cb(lsn, rstate);
+            return true;
+          });
+}
+
+void ClientReadStreamBitmapBuffer::forEach(
+    lsn_t from,
+    lsn_t to,
+    std::function<bool(lsn_t, ClientReadStreamRecordState& record)> cb) {
+  const bool reverse = from > to;
+  // Only LSNs within the buffer can have a slot.
+  const lsn_t lo = std::max(reverse ? to : from, buffer_head_);
+  const lsn_t hi = std::min(reverse ? from : to, maxLSNToAccept());
+  if (lo > hi) {
+    return;
+  }
+  scan(
+      (reverse ? hi : lo) - buffer_head_,
+      hi - lo + 1,
+      reverse,
+      [&](size_t offset) {
+        return cb(buffer_head_ + offset, slots_[physical(offset)]);
+      });
+}
+
+}} // namespace facebook::logdevice
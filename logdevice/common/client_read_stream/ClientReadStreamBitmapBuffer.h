@@ -0,0 +1,146 @@
+/**
+ * Copyright (c) 2017-present, Facebook, Inc. and its affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "logdevice/common/client_read_stream/ClientReadStreamBuffer.h"
+#include "logdevice/common/checks.h"
+
+namespace facebook { namespace logdevice {
+
+/**
+ * @file ClientReadStreamBitmapBuffer is an implementation of
+ *       ClientReadStreamBuffer that, like ClientReadStreamCircularBuffer,
+ *       preallocates a RecordState slot for every LSN in the buffer, but
+ *       also keeps an occupancy bitmap with one bit per slot.  A bit is set
+ *       when the slot is handed out by createOrGet(), and cleared when the
+ *       slot is popped, advanced over or found empty by findFirstMarker().
+ *       Every slot holding a record/gap marker has its bit set.
+ *
+ *       findFirstMarker(), forEach(), forEachUpto(), advanceBufferHead()
+ *       and clear() only look at slots whose bit is set, skipping 64 empty
+ *       slots per word of the bitmap.  This makes them cheap on large,
+ *       sparsely filled buffers, where ClientReadStreamCircularBuffer has to
+ *       walk every slot.
+ *
+ *       Like ClientReadStreamOrderedMapBuffer, forEach() and forEachUpto()
+ *       only visit slots that were handed out by createOrGet().
+ *
+ *       The slots are allocated by the first createOrGet() and freed by
+ *       releaseMemoryIfEmpty(); only the bitmap is always allocated.
+ */
+
+class ClientReadStreamBitmapBuffer : public ClientReadStreamBuffer {
+ public:
+  ClientReadStreamBitmapBuffer(size_t capacity, lsn_t buffer_head);
+
+  // see ClientReadStreamBuffer::createOrGet()
+  // complexity O(1)
+  ClientReadStreamRecordState* createOrGet(lsn_t lsn) override;
+
+  // see ClientReadStreamBuffer::find()
+  // complexity O(1)
+  ClientReadStreamRecordState* find(lsn_t lsn) override;
+
+  // see ClientReadStreamBuffer::findFirstMarker()
+  // complexity O(n/64 + k) in which n is the number of slots in the buffer
+  // and k the number of occupied slots before the first marker
+  std::pair<ClientReadStreamRecordState*, lsn_t> findFirstMarker() override;
+
+  // see ClientReadStreamBuffer::front()
+  // complexity O(1)
+  ClientReadStreamRecordState* front() override;
+
+  // see ClientReadStreamBuffer::popFront()
+  // complexity O(1)
+  void popFront() override;
+
+  // see ClientReadStreamBuffer::advanceBufferHead()
+  // complexity O(min(n, offset)/64)
+  void advanceBufferHead(size_t offset = 1) override;
+
+  // see ClientReadStreamBuffer::capacity()
+  size_t capacity() const override {
+    return capacity_;
+  }
+
+  // see ClientReadStreamBuffer::clear()
+  // complexity O(n/64 + k) in which k is the number of occupied slots
+  void clear() override;
+
+  // see ClientReadStreamBuffer::releaseMemoryIfEmpty()
+  // complexity O(n/64 + k)
+  bool releaseMemoryIfEmpty() override;
+
+  // see ClientReadStreamBuffer::forEachUpto()
+  // complexity O(min(n, to - buffer_head_)/64 + k)
+  void forEachUpto(
+      lsn_t to,
+      std::function<void(lsn_t, ClientReadStreamRecordState& record)> cb)
+      override;
+
+  // see ClientReadStreamBuffer::forEach()
+  // complexity O(min(n, abs(to - from))/64 + k)
+  void forEach(lsn_t from,
+               lsn_t to,
+               std::function<bool(lsn_t, ClientReadStreamRecordState& record)>
+                   cb) override;
+
+  // see ClientReadStreamBuffer::getBufferHead()
+  lsn_t getBufferHead() const override {
+    return buffer_head_;
+  }
+
+  ~ClientReadStreamBitmapBuffer() override;
+
+ private:
+  static constexpr size_t BITS_PER_WORD = 64;
+
+  // Physical index in slots_ of the slot `offset' LSNs after buffer_head_.
+  size_t physical(size_t offset) const {
+    ld_check(offset < capacity());
+    const size_t idx = head_ + offset;
+    return idx >= capacity() ? idx - capacity() : idx;
+  }
+
+  void setBit(size_t idx) {
+    bitmap_[idx / BITS_PER_WORD] |= uint64_t(1) << (idx % BITS_PER_WORD);
+  }
+  void clearBit(size_t idx) {
+    bitmap_[idx / BITS_PER_WORD] &= ~(uint64_t(1) << (idx % BITS_PER_WORD));
+  }
+
+  // Clears the bits of physical slots [begin, end).
+  void clearBits(size_t begin, size_t end);
+
+  // Calls f(offset) for the offset of each occupied slot among the `count'
+  // slots starting at `offset' (going towards higher LSNs if !reverse, lower
+  // LSNs otherwise), until f returns false.  Returns false if f did.
+  template <typename F>
+  bool scan(size_t offset, size_t count, bool reverse, F&& f);
+
+  // Same as scan() over physical slots [begin, end), calling f(idx).
+  template <typename F>
+  bool scanPhysical(size_t begin, size_t end, bool reverse, F&& f);
+
+  const size_t capacity_;
+  // RecordState for every LSN in the buffer; the slot of buffer_head_ is
+  // slots_[head_].  Null until the first createOrGet() and after
+  // releaseMemoryIfEmpty(), in which case every bit of bitmap_ is clear.
+  std::unique_ptr<ClientReadStreamRecordState[]> slots_;
+  // One bit per slot, set if the slot may be non-empty.
+  std::vector<uint64_t> bitmap_;
+  // Index in slots_ of the slot for buffer_head_.
+  size_t head_{0};
+  lsn_t buffer_head_;
+};
+
+}} // namespace facebook::logdevice
@@ -104,6 +104,18 @@ class ClientReadStreamBuffer {
    */
   virtual void clear() = 0;
 
+  /**
+   * Frees the memory used by the buffer if it holds no record or gap marker,
+   * for implementations that preallocate their slots.  The memory is
+   * allocated again by the next createOrGet().  Used to shrink idle read
+   * streams.
+   *
+   * @return true if memory was freed
+   */
+  virtual bool releaseMemoryIfEmpty() {
+    return false;
+  }
+
   /**
    * Invoke the supplied callback for each RecordState instance up to and
    * including the specified LSN.  The callback may modify the instance.
@@ -8,6 +8,7 @@
 #pragma once
 
 #include <folly/Memory.h>
+#include "logdevice/common/client_read_stream/ClientReadStreamBitmapBuffer.h"
 #include "logdevice/common/client_read_stream/ClientReadStreamCircularBuffer.h"
 #include "logdevice/common/client_read_stream/ClientReadStreamOrderedMapBuffer.h"
 
@@ -20,6 +21,7 @@ namespace facebook { namespace logdevice {
 enum class ClientReadStreamBufferType : uint8_t {
   CIRCULAR = 0,
   ORDERED_MAP,
+  BITMAP,
 };
 
 class ClientReadStreamBufferFactory {
@@ -34,6 +36,9 @@ class ClientReadStreamBufferFactory {
       case ClientReadStreamBufferType::ORDERED_MAP:
         return std::make_unique<ClientReadStreamOrderedMapBuffer>(
             capacity, buffer_head);
+      case ClientReadStreamBufferType::BITMAP:
+        return std::make_unique<ClientReadStreamBitmapBuffer>(
+            capacity, buffer_head);
     }
 
     ld_check(false);
@@ -22,15 +22,18 @@ RecordState* ClientReadStreamCircularBuffer::createOrGet(lsn_t lsn) {
   if (!LSNInBuffer(lsn)) {
     return nullptr;
   }
-  return &buffer_[getIndex(lsn)];
+  if (!buffer_) {
+    allocate();
+  }
+  return &(*buffer_)[getIndex(lsn)];
 }
 
 RecordState* ClientReadStreamCircularBuffer::find(lsn_t lsn) {
-  if (!LSNInBuffer(lsn)) {
+  if (!buffer_ || !LSNInBuffer(lsn)) {
     return nullptr;
   }
 
-  RecordState& state = buffer_[getIndex(lsn)];
+  RecordState& state = (*buffer_)[getIndex(lsn)];
   if (!state.record && !state.gap && !state.filtered_out) {
     // this is an empty placeholder RecordState, treat it as not
     // exist
@@ -43,18 +46,23 @@ RecordState* ClientReadStreamCircularBuffer::find(lsn_t lsn) {
 
 std::pair<ClientReadStreamRecordState*, lsn_t>
 ClientReadStreamCircularBuffer::findFirstMarker() {
+  if (!buffer_) {
+    return std::make_pair(nullptr, LSN_INVALID);
+  }
+  auto& buffer = *buffer_;
+
   // avoid searching beyond buffer capacity
   // avoid searching beyond LSN_MAX
   size_t limit =
       std::min(capacity(), LSN_MAX - std::max(buffer_head_, 1lu) + 1);
 
   for (size_t i = 0; i < limit; ++i) {
-    if (buffer_[i].gap || buffer_[i].record || buffer_[i].filtered_out) {
-      return std::make_pair(&buffer_[i], getLSN(i));
+    if (buffer[i].gap || buffer[i].record || buffer[i].filtered_out) {
+      return std::make_pair(&buffer[i], getLSN(i));
     }
     // for slot that is not a record/gap marker, its list must be
     // empty
-    ld_check(buffer_[i].list.empty());
+    ld_check(buffer[i].list.empty());
   }
 
   // no gap/record marker in buffer
@@ -62,44 +70,71 @@ ClientReadStreamCircularBuffer::findFirstMarker() {
 }
 
 ClientReadStreamRecordState* ClientReadStreamCircularBuffer::front() {
-  if (buffer_.front().record || buffer_.front().gap ||
-      buffer_.front().filtered_out) {
-    return &buffer_.front();
+  if (!buffer_) {
+    return nullptr;
+  }
+  RecordState& front = buffer_->front();
+  if (front.record || front.gap || front.filtered_out) {
+    return &front;
   }
 
   // the descriptor is a placeholder, return nullptr
-  ld_check(buffer_.front().list.empty());
+  ld_check(front.list.empty());
   return nullptr;
 }
 
 void ClientReadStreamCircularBuffer::popFront() {
+  if (!buffer_) {
+    return;
+  }
+  RecordState& front = buffer_->front();
   // record and list, if exist, must be already consumed
-  ld_check(!buffer_.front().record && !buffer_.front().filtered_out);
-  ld_check(buffer_.front().list.empty());
-  buffer_.front().reset();
+  ld_check(!front.record && !front.filtered_out);
+  ld_check(front.list.empty());
+  front.reset();
 }
 
 void ClientReadStreamCircularBuffer::advanceBufferHead(size_t offset) {
   // Important: caller needs to ensure that there must not be any marker
   // in the buffer slots that get advanced. Assert in the following statements.
 
+  if (buffer_) {
+    auto& buffer = *buffer_;
 #ifndef NDEBUG
-  size_t limit =
-      std::min(std::min(offset, capacity()), LSN_MAX - buffer_head_ + 1);
-  for (size_t i = 0; i < limit; ++i) {
-    ld_check(!buffer_[i].gap && !buffer_[i].record && !buffer_[i].filtered_out);
-    ld_check(buffer_[i].list.empty());
-  }
+    size_t limit =
+        std::min(std::min(offset, capacity()), LSN_MAX - buffer_head_ + 1);
+    for (size_t i = 0; i < limit; ++i) {
+      ld_check(!buffer[i].gap && !buffer[i].record && !buffer[i].filtered_out);
+      ld_check(buffer[i].list.empty());
+    }
 #endif
-
-  buffer_.rotate(offset);
+    buffer.rotate(offset);
+  }
   buffer_head_ += offset;
 }
 
 void ClientReadStreamCircularBuffer::clear() {
-  for (size_t i = 0; i < buffer_.size(); ++i) {
-    buffer_[i].reset();
+  if (!buffer_) {
+    return;
+  }
+  for (size_t i = 0; i < buffer_->size(); ++i) {
+    (*buffer_)[i].reset();
+  }
+}
+
+void ClientReadStreamCircularBuffer::allocate() {
+  ld_check(!buffer_);
+  buffer_ =
+      std::make_unique<CircularBuffer<ClientReadStreamRecordState>>(capacity_);
+}
+
+bool ClientReadStreamCircularBuffer::releaseMemoryIfEmpty() {
+  if (!buffer_ || findFirstMarker().first != nullptr) {
+    return false;
   }
+  // Descriptors without a marker hold nothing, see find().
+  buffer_.reset();
+  return true;
 }
 
 void ClientReadStreamCircularBuffer::forEachUpto(
@@ -119,10 +154,14 @@ void ClientReadStreamCircularBuffer::forEach(
     lsn_t to,
     std::function<bool(lsn_t, ClientReadStreamRecordState& record)> cb) {
   const bool reverse = from > to;
+  if (!buffer_) {
+    // Every descriptor in range is visited, and the callback may fill it.
+    allocate();
+  }
   size_t count = (reverse) ? from - to + 1 : to - from + 1;
   size_t limit = std::min(count, capacity());
   for (size_t i = 0; i < limit; i++) {
-    if (!cb(from, buffer_[getIndex(from)])) {
+    if (!cb(from, (*buffer_)[getIndex(from)])) {
       break;
     }
     from += (reverse) ? -1 : 1;
@@ -7,6 +7,8 @@
  */
 #pragma once
 
+#include <memory>
+
 #include "logdevice/common/client_read_stream/ClientReadStreamBuffer.h"
 #include "logdevice/common/CircularBuffer.h"
 
@@ -18,12 +20,16 @@ namespace facebook { namespace logdevice {
  *       RecordState descriptor for LSNs in the buffer is preallocated as
  *       placeholders. Advancing the buffer head is implemented by simply
  *       rotating the circular buffer.
+ *
+ *       The descriptors are allocated by the first createOrGet() or
+ *       forEach(), and freed by releaseMemoryIfEmpty(), so that idle read
+ *       streams with nothing buffered don't pay for them.
  */
 
 class ClientReadStreamCircularBuffer : public ClientReadStreamBuffer {
  public:
   ClientReadStreamCircularBuffer(size_t capacity, lsn_t buffer_head)
-      : buffer_(capacity), buffer_head_(buffer_head) {}
+      : capacity_(capacity), buffer_head_(buffer_head) {}
 
   // see ClientReadStreamBuffer::createOrGet()
   // complexity O(1)
@@ -51,13 +57,17 @@ class ClientReadStreamCircularBuffer : public ClientReadStreamBuffer {
 
   // see ClientReadStreamBuffer::capacity()
   size_t capacity() const override {
-    return buffer_.size();
+    return capacity_;
   }
 
   // see ClientReadStreamBuffer::clear()
   // complexity O(n)
   void clear() override;
 
+  // see ClientReadStreamBuffer::releaseMemoryIfEmpty()
+  // complexity O(n)
+  bool releaseMemoryIfEmpty() override;
+
   // see ClientReadStreamBuffer::forEachUpto()
   // complexity O(min(n, to - buffer_head_))
   void forEachUpto(
@@ -92,8 +102,13 @@ class ClientReadStreamCircularBuffer : public ClientReadStreamBuffer {
     return buffer_head_ + index;
   }
 
-  // circular buffer that holds all descriptors
-  CircularBuffer<ClientReadStreamRecordState> buffer_;
+  // Allocates buffer_, all descriptors being placeholders.
+  void allocate();
+
+  const size_t capacity_;
+  // circular buffer that holds all descriptors, null until first needed and
+  // after releaseMemoryIfEmpty()
+  std::unique_ptr<CircularBuffer<ClientReadStreamRecordState>> buffer_;
   // tracks the buffer head
   lsn_t buffer_head_;
 };
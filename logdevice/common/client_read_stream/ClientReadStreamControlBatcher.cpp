@@ -0,0 +1,160 @@
+/**
+ * Copyright (c) 2017-present, Facebook, Inc. and its affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+#include "ClientReadStreamControlBatcher.h"
+
+#include "logdevice/common/Sender.h"
+#include "logdevice/common/Worker.h"
+#include "logdevice/common/client_read_stream/AllClientReadStreams.h"
+#include "logdevice/common/debug.h"
+#include "logdevice/common/protocol/READ_CONTROL_BATCH_Message.h"
+#include "logdevice/common/protocol/START_Message.h"
+#include "logdevice/common/protocol/WINDOW_Message.h"
+#include "logdevice/common/util.h"
+
+namespace facebook { namespace logdevice {
+
+constexpr size_t ClientReadStreamControlBatcher::MAX_BATCH_SIZE;
+
+ClientReadStreamControlBatcher::ClientReadStreamControlBatcher(
+    AllClientReadStreams& owner)
+    : NodeMessageBatcher(Compatibility::READ_CONTROL_BATCH_SUPPORT,
+                         MAX_BATCH_SIZE),
+      owner_(owner) {}
+
+void ClientReadStreamControlBatcher::enqueue(read_stream_id_t rsid,
+                                             ShardID shard,
+                                             std::unique_ptr<Message> msg) {
+  ld_check(READ_CONTROL_BATCH_Message::canBatch(msg->type_));
+  NodeMessageBatcher::enqueue(
+      shard, ClientReadStreamControlEntry{rsid, shard.shard(), std::move(msg)});
+}
+
+std::chrono::milliseconds ClientReadStreamControlBatcher::getMaxDelay() const {
+  // Read streams send their messages in bursts within one iteration.
+  return std::chrono::milliseconds::zero();
+}
+
+std::unique_ptr<Message> ClientReadStreamControlBatcher::createMessage(
+    ClientReadStreamControlEntry& entry) {
+  return std::move(entry.msg);
+}
+
+std::unique_ptr<Message> ClientReadStreamControlBatcher::createBatchMessage(
+    std::vector<ClientReadStreamControlEntry> entries) {
+  auto batch = std::make_unique<READ_CONTROL_BATCH_Message>();
+  batch->messages_.reserve(entries.size());
+  for (auto& entry : entries) {
+    batch->add(std::move(entry.msg));
+  }
+  return std::move(batch);
+}
+
+bool ClientReadStreamControlBatcher::canBatch(
+    const ClientReadStreamControlEntry& entry,
+    uint16_t proto) const {
+  // Embedded messages are serialized without the protocol check the
+  // messaging layer does for each message it sends, so one the node can't
+  // take would fail the whole batch.
+  return entry.msg->getMinProtocolVersion() <= proto;
+}
+
+bool ClientReadStreamControlBatcher::isStale(
+    NodeID node,
+    const ClientReadStreamControlEntry& entry) {
+  if (entry.msg->type_ == MessageType::STOP) {
+    return false;
+  }
+  return getSocketClosedCallback(
+             entry.rsid, ShardID(node.index(), entry.shard)) == nullptr;
+}
+
+int ClientReadStreamControlBatcher::sendMessage(std::unique_ptr<Message>& msg,
+                                                NodeID node) {
+  Sender& sender = Worker::onThisThread()->sender();
+  auto start_callback = [&](const Message& m) {
+    const START_Header& header =
+        checked_downcast<const START_Message&>(m).header_;
+    return getSocketClosedCallback(
+        header.read_stream_id, ShardID(node.index(), header.shard));
+  };
+
+  if (msg->type_ == MessageType::START) {
+    SocketCallback* cb = start_callback(*msg);
+    if (!cb) {
+      // The stream went away while an earlier message was being sent.
+      msg.reset();
+      return 0;
+    }
+    return sender.sendMessage(std::move(msg), node, cb);
+  }
+
+  std::vector<SocketCallback*> onclose;
+  if (msg->type_ == MessageType::READ_CONTROL_BATCH) {
+    for (const auto& embedded :
+         checked_downcast<const READ_CONTROL_BATCH_Message&>(*msg).messages_) {
+      if (embedded->type_ == MessageType::START) {
+        SocketCallback* cb = start_callback(*embedded);
+        if (cb) {
+          onclose.push_back(cb);
+        }
+      }
+    }
+  }
+  const int rv = sender.sendMessage(std::move(msg), node);
+  if (rv == 0) {
+    for (SocketCallback* cb : onclose) {
+      if (!cb->active()) {
+        sender.registerOnSocketClosed(Address(node), *cb);
+      }
+    }
+  }
+  return rv;
+}
+
+void ClientReadStreamControlBatcher::onSendFailed(const Message& msg,
+                                                  Status st,
+                                                  NodeID node) {
+  switch (msg.type_) {
+    case MessageType::READ_CONTROL_BATCH:
+      for (const auto& embedded :
+           checked_downcast<const READ_CONTROL_BATCH_Message&>(msg)
+               .messages_) {
+        onSendFailed(*embedded, st, node);
+      }
+      break;
+    case MessageType::START: {
+      const START_Header& header =
+          checked_downcast<const START_Message&>(msg).header_;
+      owner_.onStartSent(
+          header.read_stream_id, ShardID(node.index(), header.shard), st);
+      break;
+    }
+    case MessageType::WINDOW: {
+      const WINDOW_Header& header =
+          checked_downcast<const WINDOW_Message&>(msg).header_;
+      ClientReadStream* stream = owner_.getStream(header.read_stream_id);
+      if (stream) {
+        stream->onWindowSendFailed(ShardID(node.index(), header.shard),
+                                   header.sliding_window.low);
+      }
+      break;
+    }
+    default:
+      // STOP is a courtesy; nothing to do if it can't be sent.
+      break;
+  }
+}
+
+SocketCallback*
+ClientReadStreamControlBatcher::getSocketClosedCallback(read_stream_id_t rsid,
+                                                        ShardID shard) {
+  ClientReadStream* stream = owner_.getStream(rsid);
+  return stream ? stream->getSocketClosedCallback(shard) : nullptr;
+}
+
+}} // namespace facebook::logdevice
@@ -0,0 +1,105 @@
+/**
+ * Copyright (c) 2017-present, Facebook, Inc. and its affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "logdevice/common/NodeMessageBatcher.h"
+#include "logdevice/common/protocol/Message.h"
+
+namespace facebook { namespace logdevice {
+
+/**
+ * @file Collects the START, WINDOW and STOP messages that the read streams of
+ *       a worker send during one event loop iteration, and sends them to each
+ *       storage node as a single READ_CONTROL_BATCH message at the end of the
+ *       iteration.  A client that starts reading thousands of logs, or whose
+ *       read streams slide their windows in lockstep, then sends one message
+ *       per storage node instead of one per read stream and shard.  Messages
+ *       are never merged, and a node handles those of a batch in order.
+ *
+ *       A message that itself needs a newer protocol than the node speaks
+ *       (e.g. a START with a filter the node doesn't support) is not put in
+ *       the batch but sent on its own, so that only its read stream sees the
+ *       failure.  Failures to send a batch are reported to each read stream
+ *       as if its message had failed on its own.
+ *
+ *       This only batches control messages: each read stream still has its
+ *       own server-side stream and receives its own records.
+ *
+ *       Used by ClientReadStreamDependencies when
+ *       --client-read-batch-control-messages is set.  See NodeMessageBatcher.
+ */
+
+class AllClientReadStreams;
+class SocketCallback;
+
+struct ClientReadStreamControlEntry {
+  read_stream_id_t rsid;
+  shard_index_t shard;
+  // START, WINDOW or STOP message of read stream `rsid' to `shard'.
+  std::unique_ptr<Message> msg;
+};
+
+class ClientReadStreamControlBatcher
+    : public NodeMessageBatcher<ClientReadStreamControlEntry> {
+ public:
+  explicit ClientReadStreamControlBatcher(AllClientReadStreams& owner);
+
+  /**
+   * Queues a START, WINDOW or STOP message sent by read stream `rsid' to
+   * `shard'.
+   */
+  void enqueue(read_stream_id_t rsid,
+               ShardID shard,
+               std::unique_ptr<Message> msg);
+
+  // Maximum number of messages in one READ_CONTROL_BATCH.
+  static constexpr size_t MAX_BATCH_SIZE = 1024;
+
+ protected:
+  std::chrono::milliseconds getMaxDelay() const override;
+  std::unique_ptr<Message>
+  createMessage(ClientReadStreamControlEntry& entry) override;
+  std::unique_ptr<Message> createBatchMessage(
+      std::vector<ClientReadStreamControlEntry> entries) override;
+
+  /**
+   * Keeps out of the batch messages that need a newer protocol than `proto'.
+   */
+  bool canBatch(const ClientReadStreamControlEntry& entry,
+                uint16_t proto) const override;
+
+  /**
+   * Drops messages of read streams that were destroyed, or of shards they no
+   * longer read from, since they were queued.  STOPs are sent regardless.
+   */
+  bool isStale(NodeID node, const ClientReadStreamControlEntry& entry) override;
+
+  /**
+   * Sends STARTs, on their own or in a batch, with the socket close callback
+   * of their read stream, as Sender::sendMessage() does for a single START.
+   */
+  int sendMessage(std::unique_ptr<Message>& msg, NodeID node) override;
+
+  /**
+   * Tells the read stream of each message in `msg' that it could not be sent.
+   */
+  void onSendFailed(const Message& msg, Status st, NodeID node) override;
+
+ private:
+  // See ClientReadStream::getSocketClosedCallback().  nullptr if the read
+  // stream is gone.
+  SocketCallback* getSocketClosedCallback(read_stream_id_t rsid,
+                                          ShardID shard);
+
+  AllClientReadStreams& owner_;
+};
+
+}} // namespace facebook::logdevice
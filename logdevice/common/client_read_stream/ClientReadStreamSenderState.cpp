@@ -23,10 +23,7 @@ namespace facebook { namespace logdevice {
 
 ClientReadStreamSenderState::ClientReadStreamSenderState(
     ClientReadStream* client_read_stream,
-    ShardID shard_id,
-    std::unique_ptr<BackoffTimer>&& reconnect_timer,
-    std::unique_ptr<BackoffTimer>&& started_timer,
-    std::unique_ptr<BackoffTimer>&& retry_window_timer)
+    ShardID shard_id)
     : max_data_record_lsn(0),
       filter_version(0),
       last_received_filter_version(0),
@@ -35,40 +32,76 @@ ClientReadStreamSenderState::ClientReadStreamSenderState(
       window_high_(0),
       next_lsn_(0),
       shard_id_(shard_id),
-      on_socket_close_(this),
-      reconnect_timer_(std::move(reconnect_timer)),
-      started_timer_(std::move(started_timer)),
-      retry_window_timer_(std::move(retry_window_timer)) {
-  reconnect_timer_->setCallback([this]() {
-    ld_check(getConnectionState() == ConnectionState::RECONNECT_PENDING);
-    RATELIMIT_DEBUG(
-        std::chrono::seconds(10),
-        5,
-        "TIMED out connecting to shard %s after %ldms, log %lu, retrying",
-        shard_id_.toString().c_str(),
-        reconnect_timer_->getNextDelay().count(),
-        client_read_stream_->log_id_.val_);
-    reconnectTimerCallback();
-  });
-  started_timer_->setCallback([this]() { startedTimerCallback(); });
-  retry_window_timer_->setCallback(
-      [this]() { client_read_stream_->sendWindowMessage(*this); });
+      on_socket_close_(this) {}
+
+BackoffTimer& ClientReadStreamSenderState::getReconnectTimer() {
+  if (!reconnect_timer_) {
+    reconnect_timer_ = client_read_stream_->deps_->createBackoffTimer(
+        client_read_stream_->deps_->getSettings().reader_reconnect_delay);
+    reconnect_timer_->setCallback([this]() {
+      ld_check(getConnectionState() == ConnectionState::RECONNECT_PENDING);
+      RATELIMIT_DEBUG(
+          std::chrono::seconds(10),
+          5,
+          "TIMED out connecting to shard %s after %ldms, log %lu, retrying",
+          shard_id_.toString().c_str(),
+          reconnect_timer_->getNextDelay().count(),
+          client_read_stream_->log_id_.val_);
+      reconnectTimerCallback();
+    });
+  }
+  return *reconnect_timer_;
+}
+
+BackoffTimer& ClientReadStreamSenderState::getStartedTimer() {
+  if (!started_timer_) {
+    started_timer_ = client_read_stream_->deps_->createBackoffTimer(
+        client_read_stream_->deps_->getSettings().reader_started_timeout);
+    started_timer_->setCallback([this]() { startedTimerCallback(); });
+  }
+  return *started_timer_;
+}
+
+BackoffTimer& ClientReadStreamSenderState::getRetryWindowTimer() {
+  if (!retry_window_timer_) {
+    retry_window_timer_ = client_read_stream_->deps_->createBackoffTimer(
+        client_read_stream_->deps_->getSettings().reader_retry_window_delay);
+    retry_window_timer_->setCallback(
+        [this]() { client_read_stream_->sendWindowMessage(*this); });
+  }
+  return *retry_window_timer_;
 }
 
 void ClientReadStreamSenderState::activateReconnectTimer() {
   setConnectionState(ConnectionState::RECONNECT_PENDING);
-  reconnect_timer_->activate();
+  getReconnectTimer().activate();
 }
 
 void ClientReadStreamSenderState::activateStartedTimer() {
-  started_timer_->activate();
+  getStartedTimer().activate();
+}
+
+void ClientReadStreamSenderState::activateRetryWindowTimer() {
+  getRetryWindowTimer().activate();
+}
+
+void ClientReadStreamSenderState::releaseIdleTimers() {
+  if (connection_state_ != ConnectionState::READING) {
+    return;
+  }
+  for (auto* timer :
+       {&reconnect_timer_, &started_timer_, &retry_window_timer_}) {
+    if (*timer && !(*timer)->isActive()) {
+      timer->reset();
+    }
+  }
 }
 
 void ClientReadStreamSenderState::extendStartedTimer(filter_version_t fv) {
   if (fv > last_received_filter_version &&
       fv <= client_read_stream_->filter_version_) {
     last_received_filter_version = fv;
-    if (started_timer_->isActive()) {
+    if (started_timer_ && started_timer_->isActive()) {
       started_timer_->cancel();
       started_timer_->activate();
     }
@@ -84,7 +117,7 @@ void ClientReadStreamSenderState::startedTimerCallback() {
                     "%ldms, log %lu, "
                     "retrying",
                     shard_id_.toString().c_str(),
-                    started_timer_->getNextDelay().count(),
+                    started_timer_ ? started_timer_->getNextDelay().count() : 0,
                     client_read_stream_->log_id_.val_);
 
   reconnectTimerCallback();
@@ -78,20 +78,16 @@ class ClientReadStreamSenderState : boost::noncopyable {
   };
 
   /**
+   * The timers used to reconnect, to wait for STARTED and to resend WINDOW
+   * messages are only created when first activated, and can be released
+   * with releaseIdleTimers(), since most senders of most read streams never
+   * need them.
+   *
    * @param client_read_stream pointer to owner ClientReadStream instance
-   * @param deps               pointer to ClientReadStreamDependencies instance
    * @param shard_id           ID of the shard to read from
-   * @param node_d             ID of the node this shard belongs to.
-   * @param reconnect_timer    timer to use when reconnecting
-   * @param started_timer      timer to use when waiting for STARTED
-   * @param retry_window_timer timer to use when resending WINDOW messages
    */
-  ClientReadStreamSenderState(
-      ClientReadStream* client_read_stream,
-      ShardID shard_id,
-      std::unique_ptr<BackoffTimer>&& reconnect_timer,
-      std::unique_ptr<BackoffTimer>&& started_timer,
-      std::unique_ptr<BackoffTimer>&& retry_window_timer);
+  ClientReadStreamSenderState(ClientReadStream* client_read_stream,
+                              ShardID shard_id);
 
   /**
    * The largest LSN such that this node sent a data record that is >= next_lsn_
@@ -136,6 +132,14 @@ class ClientReadStreamSenderState : boost::noncopyable {
    */
   bool under_replicated;
 
+  /**
+   * Set when a WINDOW message was sent to this sender while it had exhausted
+   * its previous window.  The next record from the sender completes a round
+   * trip, which is fed to the adaptive window controller.  Cleared once
+   * sampled.
+   */
+  folly::Optional<std::chrono::steady_clock::time_point> window_rtt_probe_sent;
+
   // Pointer to owner
   ClientReadStream* client_read_stream_;
 
@@ -226,15 +230,19 @@ class ClientReadStreamSenderState : boost::noncopyable {
   void activateReconnectTimer();
 
   void cancelReconnectTimer() {
-    reconnect_timer_->cancel();
+    if (reconnect_timer_) {
+      reconnect_timer_->cancel();
+    }
   }
 
   void resetReconnectTimer() {
-    reconnect_timer_->reset();
+    if (reconnect_timer_) {
+      reconnect_timer_->reset();
+    }
   }
 
   bool reconnectTimerIsActive() const {
-    return reconnect_timer_->isActive();
+    return reconnect_timer_ && reconnect_timer_->isActive();
   }
 
   void activateStartedTimer();
@@ -248,21 +256,33 @@ class ClientReadStreamSenderState : boost::noncopyable {
   void extendStartedTimer(filter_version_t);
 
   void resetStartedTimer() {
-    started_timer_->reset();
+    if (started_timer_) {
+      started_timer_->reset();
+    }
   }
 
   void cancelStartedTimer() {
-    started_timer_->cancel();
+    if (started_timer_) {
+      started_timer_->cancel();
+    }
   }
 
-  void activateRetryWindowTimer() {
-    retry_window_timer_->activate();
-  }
+  void activateRetryWindowTimer();
 
   void resetRetryWindowTimer() {
-    retry_window_timer_->reset();
+    if (retry_window_timer_) {
+      retry_window_timer_->reset();
+    }
   }
 
+  /**
+   * Destroys the timers that are not running, if the sender is in the
+   * READING state.  Timers of a sender that is reading have been reset, so
+   * this does not lose any backoff state.  Must not be called from a timer
+   * callback.
+   */
+  void releaseIdleTimers();
+
   ShardID getShardID() const {
     return shard_id_;
   }
@@ -338,6 +358,12 @@ class ClientReadStreamSenderState : boost::noncopyable {
 
   SocketClosedCallback on_socket_close_;
 
+  // Create the timers on first use.
+  BackoffTimer& getReconnectTimer();
+  BackoffTimer& getStartedTimer();
+  BackoffTimer& getRetryWindowTimer();
+
+  // Null until first activated, see releaseIdleTimers().
   std::unique_ptr<BackoffTimer> reconnect_timer_;
   std::unique_ptr<BackoffTimer> started_timer_;
   std::unique_ptr<BackoffTimer> retry_window_timer_;
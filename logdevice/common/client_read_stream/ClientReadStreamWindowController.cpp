@@ -0,0 +1,95 @@
+/**
+ * Copyright (c) 2017-present, Facebook, Inc. and its affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+#include "ClientReadStreamWindowController.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "logdevice/common/checks.h"
+
+namespace facebook { namespace logdevice {
+
+constexpr size_t ClientReadStreamWindowController::RTT_SAMPLES;
+constexpr double ClientReadStreamWindowController::DRAIN_RATE_ALPHA;
+
+ClientReadStreamWindowController::ClientReadStreamWindowController(
+    const Params& params)
+    : params_(params) {
+  ld_check(params_.min_window >= 1);
+  ld_check(params_.min_window <= params_.max_window);
+  ld_check(params_.headroom > 0);
+  ld_check(params_.min_flow_control_threshold <=
+           params_.max_flow_control_threshold);
+}
+
+void ClientReadStreamWindowController::onRttSample(
+    std::chrono::microseconds rtt) {
+  rtt_samples_[next_rtt_sample_] = std::max<int64_t>(rtt.count(), 1);
+  next_rtt_sample_ = (next_rtt_sample_ + 1) % RTT_SAMPLES;
+  num_rtt_samples_ = std::min(num_rtt_samples_ + 1, RTT_SAMPLES);
+}
+
+void ClientReadStreamWindowController::onWindowSlide(
+    uint64_t records_delivered,
+    Clock::time_point now) {
+  if (have_last_slide_ && now > last_slide_time_ &&
+      records_delivered >= last_slide_records_) {
+    const double seconds =
+        std::chrono::duration<double>(now - last_slide_time_).count();
+    const double rate = (records_delivered - last_slide_records_) / seconds;
+    drain_rate_ = drain_rate_ == 0
+        ? rate
+        : DRAIN_RATE_ALPHA * rate + (1 - DRAIN_RATE_ALPHA) * drain_rate_;
+  }
+  have_last_slide_ = true;
+  last_slide_records_ = records_delivered;
+  last_slide_time_ = now;
+}
+
+std::chrono::microseconds ClientReadStreamWindowController::getRtt() const {
+  if (num_rtt_samples_ == 0) {
+    return std::chrono::microseconds::zero();
+  }
+  return std::chrono::microseconds(*std::min_element(
+      rtt_samples_.begin(), rtt_samples_.begin() + num_rtt_samples_));
+}
+
+double ClientReadStreamWindowController::getBdpRecords() const {
+  return drain_rate_ * std::chrono::duration<double>(getRtt()).count();
+}
+
+size_t ClientReadStreamWindowController::computeWindowSize(
+    size_t current,
+    bool memory_pressure) const {
+  if (memory_pressure) {
+    return std::max(params_.min_window, current / 2);
+  }
+  if (num_rtt_samples_ == 0 || drain_rate_ == 0) {
+    // Nothing measured yet.  Grow slowly like the non-adaptive window does.
+    return std::min(params_.max_window,
+                    std::max(params_.min_window, current + 1));
+  }
+  const double target = std::ceil(getBdpRecords() * params_.headroom);
+  if (target >= params_.max_window) {
+    return params_.max_window;
+  }
+  return std::max(params_.min_window, static_cast<size_t>(target));
+}
+
+double ClientReadStreamWindowController::computeFlowControlThreshold(
+    size_t window_size) const {
+  if (window_size <= 1 || num_rtt_samples_ == 0 || drain_rate_ == 0) {
+    return params_.max_flow_control_threshold;
+  }
+  // Slide while at least one RTT worth of records remains in the window.
+  const double threshold = 1.0 - getBdpRecords() / window_size;
+  return std::max(params_.min_flow_control_threshold,
+                  std::min(params_.max_flow_control_threshold, threshold));
+}
+
+}} // namespace facebook::logdevice
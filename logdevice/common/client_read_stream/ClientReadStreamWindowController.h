@@ -0,0 +1,129 @@
+/**
+ * Copyright (c) 2017-present, Facebook, Inc. and its affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @file ClientReadStreamWindowController.h
+ *
+ * Sizes the flow control window of a ClientReadStream from the
+ * bandwidth-delay product of the stream, instead of always using the full
+ * client_read_buffer_size.
+ *
+ * ClientReadStream feeds two measurements into the controller:
+ *   - RTT samples, taken when a sender that had exhausted its window delivers
+ *     its first record after a WINDOW message extended the window.  The time
+ *     between sending the WINDOW and receiving that record is one round trip
+ *     plus the storage node's processing time.  The controller keeps the
+ *     minimum of the most recent samples, which filters out samples inflated
+ *     by senders that had nothing to send.
+ *   - The drain rate of the consumer, in records per second, measured each
+ *     time the window slides.
+ *
+ * The target window is drain_rate * rtt * headroom: enough records in flight
+ * to keep the consumer busy for `headroom' round trips.  This lets streams
+ * over high-latency links use the whole buffer while streams on a LAN keep
+ * few records in flight.  Under memory pressure the window is halved instead.
+ *
+ * The controller also picks the flow control threshold: the window must
+ * slide (and WINDOW messages go out) while there are still at least one
+ * RTT's worth of records left in it, otherwise senders stall waiting for the
+ * update.
+ *
+ * This class is not thread-safe and does no I/O; it is owned by a
+ * ClientReadStream and only ever used on its worker thread.
+ */
+
+namespace facebook { namespace logdevice {
+
+class ClientReadStreamWindowController {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  struct Params {
+    // Bounds on the window size.  `max_window' is normally the capacity of
+    // the ClientReadStream buffer.
+    size_t min_window;
+    size_t max_window;
+    // Number of round trips worth of records to keep in flight.
+    double headroom;
+    // The flow control threshold is picked in
+    // [min_flow_control_threshold, max_flow_control_threshold], the upper
+    // bound normally being client_read_flow_control_threshold.
+    double min_flow_control_threshold;
+    double max_flow_control_threshold;
+  };
+
+  explicit ClientReadStreamWindowController(const Params& params);
+
+  /**
+   * Records one RTT sample.
+   */
+  void onRttSample(std::chrono::microseconds rtt);
+
+  /**
+   * Called whenever the window slides.  `records_delivered' is the total
+   * number of records delivered to the application since the stream started;
+   * the controller derives the drain rate from consecutive calls.
+   */
+  void onWindowSlide(uint64_t records_delivered, Clock::time_point now);
+
+  /**
+   * @return the window size to use after sliding the window, given the
+   *         current window size.
+   */
+  size_t computeWindowSize(size_t current, bool memory_pressure) const;
+
+  /**
+   * @return the flow control threshold to use with a window of
+   *         `window_size' records.
+   */
+  double computeFlowControlThreshold(size_t window_size) const;
+
+  /**
+   * @return the current RTT estimate, or zero if there were no samples yet.
+   */
+  std::chrono::microseconds getRtt() const;
+
+  /**
+   * @return the smoothed drain rate in records per second, or zero if not
+   *         known yet.
+   */
+  double getDrainRate() const {
+    return drain_rate_;
+  }
+
+  /**
+   * @return the number of records the consumer drains during one RTT, i.e.
+   *         the bandwidth-delay product of the stream in records.
+   */
+  double getBdpRecords() const;
+
+ private:
+  static constexpr size_t RTT_SAMPLES = 16;
+  // Weight of the newest drain rate measurement in the moving average.
+  static constexpr double DRAIN_RATE_ALPHA = 0.25;
+
+  Params params_;
+
+  // Ring buffer of the most recent RTT samples, in microseconds.
+  std::array<int64_t, RTT_SAMPLES> rtt_samples_{};
+  size_t num_rtt_samples_{0};
+  size_t next_rtt_sample_{0};
+
+  double drain_rate_{0};
+  bool have_last_slide_{false};
+  uint64_t last_slide_records_{0};
+  Clock::time_point last_slide_time_;
+};
+
+}} // namespace facebook::logdevice
@@ -559,6 +559,18 @@ bool parsePrincipals(const folly::dynamic& clusterMap,
       return false;
     }
 
+    successful =
+        getIntFromMap(principal, "read_weight", map_entry->read_weight);
+    // "read_weight" is an optional field, so ignore NOTFOUND errors.
+    if ((!successful && err != E::NOTFOUND) ||
+        (successful && map_entry->read_weight == 0)) {
+      ld_error("While processing principal \"%s\": \"read_weight\" must be "
+               "a positive integer.",
+               name.c_str());
+      err = E::INVALID_CONFIG;
+      return false;
+    }
+
     principals_map.insert({name, map_entry});
   }
 
@@ -101,6 +101,25 @@ enum ProtocolVersion : uint16_t {
   // Support OffsetMap instead of a uint64_t for byte offset
   OFFSET_MAP_SUPPORT, // = 84
 
+  // Clients can batch START, WINDOW and STOP messages for many read streams
+  // into a single READ_CONTROL_BATCH message.
+  READ_CONTROL_BATCH_SUPPORT, // = 85
+
+  // START messages can ask storage nodes to only ship a sample of the records
+  // (START_Header::SAMPLE).
+  SERVER_SIDE_SAMPLING_SUPPORT, // = 86
+
+  // Server-side filters of type PREFIX, KEY_SET and BLOOM.
+  SERVER_RECORD_FILTER_KEY_SETS, // = 87
+
+  // Sequencers can send the RELEASEs of many logs to a storage node in a
+  // single RELEASE_BATCH message.
+  RELEASE_BATCH_SUPPORT, // = 88
+
+  // Sequencers can send the SEALs of many logs to a storage node in a single
+  // SEAL_BATCH message during recovery.
+  SEAL_BATCH_SUPPORT, // = 89
+
   // NOTE: insert new protocol versions here
 
   // Maximum version number of the protocol this version of LogDevice
@@ -142,6 +161,11 @@ static_assert(CHECKSUM_SUPPORT == 81, "");
 static_assert(TAIL_RECORD_IN_GSS_REPLY == 82, "");
 static_assert(STORE_E2E_TRACING_SUPPORT == 83, "");
 static_assert(OFFSET_MAP_SUPPORT == 84, "");
+static_assert(READ_CONTROL_BATCH_SUPPORT == 85, "");
+static_assert(SERVER_SIDE_SAMPLING_SUPPORT == 86, "");
+static_assert(SERVER_RECORD_FILTER_KEY_SETS == 87, "");
+static_assert(RELEASE_BATCH_SUPPORT == 88, "");
+static_assert(SEAL_BATCH_SUPPORT == 89, "");
 
 constexpr uint16_t MIN_PROTOCOL_SUPPORTED = PROTOCOL_VERSION_LOWER_BOUND + 1;
 constexpr uint16_t MAX_PROTOCOL_SUPPORTED = PROTOCOL_VERSION_UPPER_BOUND - 1;
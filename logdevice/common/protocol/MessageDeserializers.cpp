@@ -52,8 +52,11 @@
 #include "NODE_STATS_REPLY_Message.h"
 #include "NODE_STATS_AGGREGATE_Message.h"
 #include "NODE_STATS_AGGREGATE_REPLY_Message.h"
+#include "READ_CONTROL_BATCH_Message.h"
 #include "RECORD_Message.h"
+#include "RELEASE_BATCH_Message.h"
 #include "RELEASE_Message.h"
+#include "SEAL_BATCH_Message.h"
 #include "SEAL_Message.h"
 #include "SEALED_Message.h"
 #include "SHUTDOWN_Message.h"
@@ -0,0 +1,102 @@
+/**
+ * Copyright (c) 2017-present, Facebook, Inc. and its affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+#include "READ_CONTROL_BATCH_Message.h"
+
+#include "logdevice/common/debug.h"
+#include "logdevice/common/protocol/MessageTypeNames.h"
+#include "logdevice/common/protocol/ProtocolReader.h"
+#include "logdevice/common/protocol/ProtocolWriter.h"
+#include "logdevice/common/protocol/START_Message.h"
+#include "logdevice/common/protocol/STOP_Message.h"
+#include "logdevice/common/protocol/WINDOW_Message.h"
+
+namespace facebook { namespace logdevice {
+
+READ_CONTROL_BATCH_Message::READ_CONTROL_BATCH_Message()
+    : Message(MessageType::READ_CONTROL_BATCH, TrafficClass::HANDSHAKE) {}
+
+bool READ_CONTROL_BATCH_Message::canBatch(MessageType type) {
+  return type == MessageType::START || type == MessageType::WINDOW ||
+      type == MessageType::STOP;
+}
+
+void READ_CONTROL_BATCH_Message::add(std::unique_ptr<Message> msg) {
+  ld_check(msg);
+  ld_check(canBatch(msg->type_));
+  messages_.push_back(std::move(msg));
+}
+
+void READ_CONTROL_BATCH_Message::serialize(ProtocolWriter& writer) const {
+  writer.write(static_cast<uint32_t>(messages_.size()));
+  for (const auto& msg : messages_) {
+    writer.write(msg->type_);
+    msg->serialize(writer);
+  }
+}
+
+MessageReadResult
+READ_CONTROL_BATCH_Message::deserialize(ProtocolReader& reader) {
+  auto m = std::make_unique<READ_CONTROL_BATCH_Message>();
+  uint32_t count = 0;
+  reader.read(&count);
+  for (uint32_t i = 0; i < count && reader.ok(); ++i) {
+    MessageType type;
+    reader.read(&type);
+    if (!reader.ok()) {
+      break;
+    }
+    switch (type) {
+      case MessageType::START: {
+        auto start = START_Message::read(reader);
+        if (start) {
+          m->messages_.push_back(std::move(start));
+        }
+        break;
+      }
+      case MessageType::WINDOW: {
+        WINDOW_Header hdr;
+        reader.read(&hdr);
+        m->messages_.push_back(std::make_unique<WINDOW_Message>(hdr));
+        break;
+      }
+      case MessageType::STOP: {
+        STOP_Header hdr;
+        reader.read(&hdr);
+        m->messages_.push_back(std::make_unique<STOP_Message>(hdr));
+        break;
+      }
+      default:
+        ld_error("Bad READ_CONTROL_BATCH message: unexpected embedded message "
+                 "type %s",
+                 messageTypeNames[type].c_str());
+        return reader.errorResult(E::BADMSG);
+    }
+  }
+  return reader.resultMsg(std::move(m));
+}
+
+void READ_CONTROL_BATCH_Message::onSent(Status st, const Address& to) const {
+  for (const auto& msg : messages_) {
+    msg->onSent(st, to);
+  }
+}
+
+bool READ_CONTROL_BATCH_Message::allowUnencrypted() const {
+  for (const auto& msg : messages_) {
+    if (!msg->allowUnencrypted()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+uint16_t READ_CONTROL_BATCH_Message::getMinProtocolVersion() const {
+  return Compatibility::READ_CONTROL_BATCH_SUPPORT;
+}
+
+}} // namespace facebook::logdevice
@@ -0,0 +1,64 @@
+/**
+ * Copyright (c) 2017-present, Facebook, Inc. and its affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+#pragma once
+
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+#include "Message.h"
+
+namespace facebook { namespace logdevice {
+
+/**
+ * @file READ_CONTROL_BATCH is sent by readers in place of several START,
+ *       WINDOW and STOP messages addressed to the same storage node, e.g.
+ *       when a client starts reading thousands of logs at once.  The storage
+ *       node handles the embedded messages in order, exactly as if they had
+ *       arrived one by one on the same socket.
+ *
+ *       Only sent to nodes that speak at least
+ *       Compatibility::READ_CONTROL_BATCH_SUPPORT; see
+ *       ClientReadStreamControlBatcher.
+ */
+
+class READ_CONTROL_BATCH_Message : public Message {
+ public:
+  READ_CONTROL_BATCH_Message();
+
+  READ_CONTROL_BATCH_Message(READ_CONTROL_BATCH_Message&&) noexcept = delete;
+  READ_CONTROL_BATCH_Message& operator=(const READ_CONTROL_BATCH_Message&) =
+      delete;
+  READ_CONTROL_BATCH_Message& operator=(READ_CONTROL_BATCH_Message&&) = delete;
+
+  /**
+   * Appends a message to the batch.  `msg' must be a START, WINDOW or STOP
+   * message.
+   */
+  void add(std::unique_ptr<Message> msg);
+
+  // see Message.h
+  void serialize(ProtocolWriter&) const override;
+  Disposition onReceived(const Address&) override {
+    // Receipt handler lives in server/ServerMessageDispatch.cpp; this should
+    // never get called.
+    std::abort();
+  }
+  // Calls onSent() of each embedded message.
+  void onSent(Status st, const Address& to) const override;
+  bool allowUnencrypted() const override;
+  uint16_t getMinProtocolVersion() const override;
+  static Message::deserializer_t deserialize;
+
+  // @return true if messages of type `type' can be embedded in a batch.
+  static bool canBatch(MessageType type);
+
+  std::vector<std::unique_ptr<Message>> messages_;
+};
+
+}} // namespace facebook::logdevice
@@ -39,19 +39,23 @@ RECORD_Message::RECORD_Message(const RECORD_Header& header,
                                std::unique_ptr<ExtraMetadata> extra_metadata,
                                Source source,
                                uint64_t byte_offset,
-                               std::shared_ptr<std::string> log_group_path)
+                               std::shared_ptr<std::string> log_group_path,
+                               std::shared_ptr<const void> payload_owner)
     :
 
       Message(MessageType::RECORD, tc),
       header_(header),
       payload_(std::move(payload)),
+      payload_owner_(std::move(payload_owner)),
       extra_metadata_(std::move(extra_metadata)),
       source_(source),
       byte_offset_(byte_offset),
       log_group_path_(std::move(log_group_path)) {}
 
 RECORD_Message::~RECORD_Message() {
-  free(const_cast<void*>(payload_.data()));
+  if (!payload_owner_) {
+    free(const_cast<void*>(payload_.data()));
+  }
 }
 
 void RECORD_Message::serialize(ProtocolWriter& writer) const {
@@ -137,13 +137,19 @@ class RECORD_Message : public Message, boost::noncopyable {
 
   // NOTE: populates header flags and header payload_size based on
   // extra_metadata parameter
+  //
+  // If `payload_owner' is given, `payload' points into memory it keeps alive
+  // and the message doesn't take ownership of the payload.  This lets the
+  // RECORD messages of all streams shipping the same record share one copy
+  // of its payload.
   RECORD_Message(const RECORD_Header& header,
                  TrafficClass tc,
                  Payload&& payload,
                  std::unique_ptr<ExtraMetadata> extra_metadata,
                  Source source = Source::LOCAL_LOG_STORE,
                  uint64_t byte_offset = BYTE_OFFSET_INVALID,
-                 std::shared_ptr<std::string> log_group_path = nullptr);
+                 std::shared_ptr<std::string> log_group_path = nullptr,
+                 std::shared_ptr<const void> payload_owner = nullptr);
 
   /**
    * Convenience method that calculates how much space a RECORD message
@@ -188,8 +194,13 @@ class RECORD_Message : public Message, boost::noncopyable {
   // - On the read path, the payload gets malloc-d in deserialize().
   //   onReceived() then passes its ownership to the client library where the
   //   memory will get freed later when it is no longer needed.
+  // - Unless payload_owner_ is set, in which case the payload is shared with
+  //   other messages and payload_owner_ keeps it alive.
   Payload payload_;
 
+  // used only on the sending end
+  std::shared_ptr<const void> payload_owner_;
+
   // If non-null:
   // - On the send path, the structure will be embedded in the RECORD
   //   message
@@ -0,0 +1,44 @@
+/**
+ * Copyright (c) 2017-present, Facebook, Inc. and its affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+#include "RELEASE_BATCH_Message.h"
+
+#include "logdevice/common/protocol/ProtocolReader.h"
+#include "logdevice/common/protocol/ProtocolWriter.h"
+
+namespace facebook { namespace logdevice {
+
+RELEASE_BATCH_Message::RELEASE_BATCH_Message(
+    std::vector<RELEASE_Header> headers)
+    : Message(MessageType::RELEASE_BATCH, TrafficClass::READ_TAIL),
+      headers_(std::move(headers)) {}
+
+void RELEASE_BATCH_Message::serialize(ProtocolWriter& writer) const {
+  writer.write(static_cast<uint32_t>(headers_.size()));
+  writer.writeVector(headers_);
+}
+
+MessageReadResult RELEASE_BATCH_Message::deserialize(ProtocolReader& reader) {
+  uint32_t count = 0;
+  reader.read(&count);
+  std::vector<RELEASE_Header> headers;
+  reader.readVector(&headers, count);
+  return reader.result(
+      [&] { return new RELEASE_BATCH_Message(std::move(headers)); });
+}
+
+void RELEASE_BATCH_Message::onSent(Status st, const Address& to) const {
+  for (const RELEASE_Header& header : headers_) {
+    RELEASE_Message::onReleaseSent(header, st, to);
+  }
+}
+
+uint16_t RELEASE_BATCH_Message::getMinProtocolVersion() const {
+  return Compatibility::RELEASE_BATCH_SUPPORT;
+}
+
+}} // namespace facebook::logdevice
@@ -0,0 +1,53 @@
+/**
+ * Copyright (c) 2017-present, Facebook, Inc. and its affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+#pragma once
+
+#include <cstdlib>
+#include <vector>
+
+#include "logdevice/common/protocol/Message.h"
+#include "logdevice/common/protocol/RELEASE_Message.h"
+
+namespace facebook { namespace logdevice {
+
+/**
+ * @file RELEASE_BATCH is sent by sequencer nodes in place of the RELEASE
+ *       messages for many logs addressed to the same storage node.  Each
+ *       header has the same meaning as the header of a RELEASE message.  The
+ *       storage node applies all of them while handling the message, and
+ *       notifies each worker of the releases of the logs it reads once.
+ *
+ *       Only sent to nodes that speak at least
+ *       Compatibility::RELEASE_BATCH_SUPPORT; see ReleaseBatcher.
+ */
+
+class RELEASE_BATCH_Message : public Message {
+ public:
+  explicit RELEASE_BATCH_Message(std::vector<RELEASE_Header> headers);
+
+  RELEASE_BATCH_Message(const RELEASE_BATCH_Message&) noexcept = delete;
+  RELEASE_BATCH_Message(RELEASE_BATCH_Message&&) noexcept = delete;
+  RELEASE_BATCH_Message& operator=(const RELEASE_BATCH_Message&) = delete;
+  RELEASE_BATCH_Message& operator=(RELEASE_BATCH_Message&&) = delete;
+
+  // see Message.h
+  void serialize(ProtocolWriter&) const override;
+  Disposition onReceived(const Address&) override {
+    // Receipt handler lives in PurgeCoordinator::onReceived(); this should
+    // never get called.
+    std::abort();
+  }
+  // Does for each header what RELEASE_Message::onSent() does.
+  void onSent(Status st, const Address& to) const override;
+  uint16_t getMinProtocolVersion() const override;
+  static Message::deserializer_t deserialize;
+
+  std::vector<RELEASE_Header> headers_;
+};
+
+}} // namespace facebook::logdevice
@@ -41,34 +41,42 @@ MessageReadResult RELEASE_Message::deserialize(ProtocolReader& reader) {
 }
 
 void RELEASE_Message::onSent(Status st, const Address& to) const {
-  if (st == Status::PROTONOSUPPORT) {
+  ld_check(st != Status::PROTONOSUPPORT ||
+           header_.release_type == ReleaseType::PER_EPOCH);
+  onReleaseSent(header_, st, to);
+}
+
+void RELEASE_Message::onReleaseSent(const RELEASE_Header& header,
+                                    Status st,
+                                    const Address& to) {
+  if (st == Status::PROTONOSUPPORT &&
+      header.release_type == ReleaseType::PER_EPOCH) {
     // We get here if we attempt to send a per-epoch RELEASE message to a node
     // running an older version. This is fine. Per-epoch RELEASE messages are
     // best effort and only affect the ability of readers to read past the
     // global last-released LSN.
-    ld_check(header_.release_type == ReleaseType::PER_EPOCH);
     RATELIMIT_INFO(std::chrono::seconds(10),
                    1,
                    "Failed to send a per-epoch RELEASE for record %s to %s "
                    "because of old protocol",
-                   header_.rid.toString().c_str(),
+                   header.rid.toString().c_str(),
                    Sender::describeConnection(to).c_str());
     return;
   }
 
   std::shared_ptr<Sequencer> sequencer =
       Worker::onThisThread()->processor_->allSequencers().findSequencer(
-          header_.rid.logid);
+          header.rid.logid);
 
   if (!sequencer) {
     // for metadata logs, it is possible that the meta sequencer is destroyed
     // before some releases are sent.
-    if (!MetaDataLog::isMetaDataLog(header_.rid.logid)) {
+    if (!MetaDataLog::isMetaDataLog(header.rid.logid)) {
       RATELIMIT_CRITICAL(std::chrono::seconds(1),
                          10,
                          "INTERNAL ERROR: unable to find a sequencer for "
                          "log %lu",
-                         header_.rid.logid.val_);
+                         header.rid.logid.val_);
     }
     return;
   }
@@ -80,7 +88,7 @@ void RELEASE_Message::onSent(Status st, const Address& to) const {
                     std::chrono::seconds(1),
                     1,
                     "Failed to send a RELEASE for record %s to %s: %s. ",
-                    header_.rid.toString().c_str(),
+                    header.rid.toString().c_str(),
                     Sender::describeConnection(to).c_str(),
                     error_description(st));
 
@@ -90,9 +98,9 @@ void RELEASE_Message::onSent(Status st, const Address& to) const {
 
   ld_check(!to.isClientAddress());
   sequencer->noteReleaseSuccessful(
-      ShardID(to.asNodeID().index(), header_.shard),
-      compose_lsn(header_.rid.epoch, header_.rid.esn),
-      header_.release_type);
+      ShardID(to.asNodeID().index(), header.shard),
+      compose_lsn(header.rid.epoch, header.rid.esn),
+      header.release_type);
 }
 
 bool RELEASE_Message::warnAboutOldProtocol() const {
@@ -60,6 +60,13 @@ class RELEASE_Message : public Message {
   void onSent(Status st, const Address& to) const override;
   static Message::deserializer_t deserialize;
 
+  /**
+   * Tells the sequencer of the log whether the release in `header' was sent
+   * to `to'.  Also used for the releases of a RELEASE_BATCH message.
+   */
+  static void
+  onReleaseSent(const RELEASE_Header& header, Status st, const Address& to);
+
   bool warnAboutOldProtocol() const override;
 
   const RELEASE_Header& getHeader() const {
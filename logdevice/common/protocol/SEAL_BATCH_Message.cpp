@@ -0,0 +1,43 @@
+/**
+ * Copyright (c) 2017-present, Facebook, Inc. and its affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+#include "SEAL_BATCH_Message.h"
+
+#include "logdevice/common/protocol/ProtocolReader.h"
+#include "logdevice/common/protocol/ProtocolWriter.h"
+
+namespace facebook { namespace logdevice {
+
+SEAL_BATCH_Message::SEAL_BATCH_Message(std::vector<SEAL_Header> headers)
+    : Message(MessageType::SEAL_BATCH, TrafficClass::RECOVERY),
+      headers_(std::move(headers)) {}
+
+void SEAL_BATCH_Message::serialize(ProtocolWriter& writer) const {
+  writer.write(static_cast<uint32_t>(headers_.size()));
+  writer.writeVector(headers_);
+}
+
+MessageReadResult SEAL_BATCH_Message::deserialize(ProtocolReader& reader) {
+  uint32_t count = 0;
+  reader.read(&count);
+  std::vector<SEAL_Header> headers;
+  reader.readVector(&headers, count);
+  return reader.result(
+      [&] { return new SEAL_BATCH_Message(std::move(headers)); });
+}
+
+void SEAL_BATCH_Message::onSent(Status st, const Address& to) const {
+  for (const SEAL_Header& header : headers_) {
+    SEAL_Message::onSealSent(header, st, to);
+  }
+}
+
+uint16_t SEAL_BATCH_Message::getMinProtocolVersion() const {
+  return Compatibility::SEAL_BATCH_SUPPORT;
+}
+
+}} // namespace facebook::logdevice
@@ -0,0 +1,52 @@
+/**
+ * Copyright (c) 2017-present, Facebook, Inc. and its affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+#pragma once
+
+#include <cstdlib>
+#include <vector>
+
+#include "logdevice/common/protocol/Message.h"
+#include "logdevice/common/protocol/SEAL_Message.h"
+
+namespace facebook { namespace logdevice {
+
+/**
+ * @file SEAL_BATCH is sent by sequencer nodes during recovery in place of the
+ *       SEAL messages for many logs addressed to the same storage node.  Each
+ *       header has the same meaning as the header of a SEAL message, and the
+ *       storage node replies to each of them with a separate SEALED message.
+ *
+ *       Only sent to nodes that speak at least
+ *       Compatibility::SEAL_BATCH_SUPPORT; see SealBatcher.
+ */
+
+class SEAL_BATCH_Message : public Message {
+ public:
+  explicit SEAL_BATCH_Message(std::vector<SEAL_Header> headers);
+
+  SEAL_BATCH_Message(const SEAL_BATCH_Message&) noexcept = delete;
+  SEAL_BATCH_Message(SEAL_BATCH_Message&&) noexcept = delete;
+  SEAL_BATCH_Message& operator=(const SEAL_BATCH_Message&) = delete;
+  SEAL_BATCH_Message& operator=(SEAL_BATCH_Message&&) = delete;
+
+  // see Message.h
+  void serialize(ProtocolWriter&) const override;
+  Disposition onReceived(const Address&) override {
+    // Receipt handler lives in server/SEAL_onReceived.cpp; this should never
+    // get called.
+    std::abort();
+  }
+  // Does for each header what SEAL_Message::onSent() does.
+  void onSent(Status st, const Address& to) const override;
+  uint16_t getMinProtocolVersion() const override;
+  static Message::deserializer_t deserialize;
+
+  std::vector<SEAL_Header> headers_;
+};
+
+}} // namespace facebook::logdevice
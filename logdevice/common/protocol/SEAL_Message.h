@@ -57,6 +57,13 @@ class SEAL_Message : public Message {
   Disposition onReceived(const Address&) override;
   static Message::deserializer_t deserialize;
 
+  /**
+   * Tells the LogRecoveryRequest of the log whether the SEAL in `header' was
+   * sent to `to'.  Also used for the seals of a SEAL_BATCH message.
+   */
+  static void
+  onSealSent(const SEAL_Header& header, Status status, const Address& to);
+
   SEAL_Header header_;
 };
 
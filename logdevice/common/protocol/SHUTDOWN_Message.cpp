@@ -47,12 +47,16 @@ Message::Disposition SHUTDOWN_Message::onReceived(const Address& from) {
   Worker* w = Worker::onThisThread();
   w->sender().setPeerShuttingDown(from.asNodeID());
 
-  // Inform the LogRebuilding state machines about graceful
-  // shutdown
+  // Inform the LogRebuilding state machines and ChunkRebuildings about
+  // graceful shutdown
   for (const auto& lr : w->runningLogRebuildings().map) {
     lr.second->onGracefulShutdown(
         from.asNodeID().index(), header_.serverInstanceId);
   }
+  for (const auto& cr : w->runningChunkRebuildings().map) {
+    cr.second->onGracefulShutdown(
+        from.asNodeID().index(), header_.serverInstanceId);
+  }
   return Disposition::NORMAL;
 }
 
@@ -8,6 +8,7 @@
 #define __STDC_FORMAT_MACROS
 #include "START_Message.h"
 
+#include <algorithm>
 #include <memory>
 #include <random>
 
@@ -94,6 +95,20 @@ void START_Message::serialize(ProtocolWriter& writer) const {
     hdr.num_filtered_out = filtered_out_.size();
   }
 
+  if ((hdr.flags & START_Header::SAMPLE) &&
+      writer.proto() < Compatibility::SERVER_SIDE_SAMPLING_SUPPORT) {
+    // Reading without sampling would ship records the reader did not ask
+    // for. getMinProtocolVersion() normally fails the send before this.
+    RATELIMIT_ERROR(std::chrono::seconds(10),
+                    2,
+                    "Server-side sampling requested for log %lu is not "
+                    "supported by peer protocol %hu",
+                    header_.log_id.val(),
+                    writer.proto());
+    writer.setError(E::PROTONOSUPPORT);
+    return;
+  }
+
   writer.write(hdr);
 
   if (writer.proto() >= Compatibility::SUPPORT_LARGER_FILTERED_OUT_LIST) {
@@ -103,6 +118,20 @@ void START_Message::serialize(ProtocolWriter& writer) const {
   }
 
   if (writer.proto() >= Compatibility::SERVER_CAN_FILTER_RECORD) {
+    if (attrs_.filter_type > ServerRecordFilterType::RANGE &&
+        writer.proto() < Compatibility::SERVER_RECORD_FILTER_KEY_SETS) {
+      // Reading without the filter would ship records the reader did not
+      // ask for.
+      RATELIMIT_ERROR(std::chrono::seconds(10),
+                      2,
+                      "Server-side filter type %d requested for log %lu is "
+                      "not supported by peer protocol %hu",
+                      static_cast<int>(attrs_.filter_type),
+                      header_.log_id.val(),
+                      writer.proto());
+      writer.setError(E::PROTONOSUPPORT);
+      return;
+    }
     writer.write(static_cast<uint8_t>(attrs_.filter_type));
     writer.writeLengthPrefixedVector(attrs_.filter_key1);
     writer.writeLengthPrefixedVector(attrs_.filter_key2);
@@ -124,6 +153,11 @@ void START_Message::serialize(ProtocolWriter& writer) const {
       writer.write(h2);
     }
   }
+
+  if (hdr.flags & START_Header::SAMPLE) {
+    writer.write(static_cast<uint8_t>(attrs_.sample_mode));
+    writer.write(attrs_.sample_param);
+  }
 }
 
 void START_Message::readFilteredOut(ProtocolReader& reader, START_Message& m) {
@@ -137,6 +171,14 @@ void START_Message::readFilteredOut(ProtocolReader& reader, START_Message& m) {
 }
 
 MessageReadResult START_Message::deserialize(ProtocolReader& reader) {
+  auto m = read(reader);
+  if (!m) {
+    return reader.errorResult();
+  }
+  return reader.resultMsg(std::move(m));
+}
+
+std::unique_ptr<START_Message> START_Message::read(ProtocolReader& reader) {
   const auto proto = reader.proto();
 
   START_Header hdr;
@@ -158,12 +200,15 @@ MessageReadResult START_Message::deserialize(ProtocolReader& reader) {
       uint8_t temp;
       reader.read(&temp, sizeof(temp));
       m->attrs_.filter_type = static_cast<ServerRecordFilterType>(temp);
-      if (m->attrs_.filter_type != ServerRecordFilterType::EQUALITY &&
-          m->attrs_.filter_type != ServerRecordFilterType::RANGE &&
-          m->attrs_.filter_type != ServerRecordFilterType::NOFILTER) {
+      const auto max_filter_type =
+          proto >= Compatibility::SERVER_RECORD_FILTER_KEY_SETS
+          ? ServerRecordFilterType::MAX
+          : ServerRecordFilterType::PREFIX;
+      if (m->attrs_.filter_type >= max_filter_type) {
         ld_error("Bad START message, unknown ServerRecordFilterType: %d",
                  static_cast<int>(m->attrs_.filter_type));
-        return reader.errorResult(E::BADMSG);
+        reader.setError(E::BADMSG);
+        return nullptr;
       }
       reader.readLengthPrefixedVector(&m->attrs_.filter_key1);
       reader.readLengthPrefixedVector(&m->attrs_.filter_key2);
@@ -176,9 +221,40 @@ MessageReadResult START_Message::deserialize(ProtocolReader& reader) {
         reader.read(&m->csid_hash_pt2, sizeof(m->csid_hash_pt2));
       }
     }
+
+    if (proto >= Compatibility::SERVER_SIDE_SAMPLING_SUPPORT &&
+        (m->header_.flags & START_Header::SAMPLE)) {
+      uint8_t mode;
+      reader.read(&mode, sizeof(mode));
+      m->attrs_.sample_mode = static_cast<ServerRecordSampleMode>(mode);
+      if (m->attrs_.sample_mode == ServerRecordSampleMode::NONE ||
+          m->attrs_.sample_mode >= ServerRecordSampleMode::MAX) {
+        ld_error("Bad START message, unknown ServerRecordSampleMode: %d",
+                 static_cast<int>(mode));
+        reader.setError(E::BADMSG);
+        return nullptr;
+      }
+      reader.read(&m->attrs_.sample_param, sizeof(m->attrs_.sample_param));
+    }
   }
 
-  return reader.resultMsg(std::move(m));
+  if (!reader.ok()) {
+    return nullptr;
+  }
+  return m;
+}
+
+uint16_t START_Message::getMinProtocolVersion() const {
+  uint16_t proto = Message::getMinProtocolVersion();
+  if (header_.flags & START_Header::SAMPLE) {
+    proto = std::max<uint16_t>(
+        proto, Compatibility::SERVER_SIDE_SAMPLING_SUPPORT);
+  }
+  if (attrs_.filter_type > ServerRecordFilterType::RANGE) {
+    proto = std::max<uint16_t>(
+        proto, Compatibility::SERVER_RECORD_FILTER_KEY_SETS);
+  }
+  return proto;
 }
 
 bool START_Message::allowUnencrypted() const {
@@ -204,6 +280,10 @@ START_Message::getDebugInfo() const {
   add("replication", header_.replication);
   add("scd_copyset_reordering", int(header_.scd_copyset_reordering));
   add("flags", header_.flags);
+  if (header_.flags & START_Header::SAMPLE) {
+    add("sample_mode", int(attrs_.sample_mode));
+    add("sample_param", attrs_.sample_param);
+  }
   return res;
 }
 
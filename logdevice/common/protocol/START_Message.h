@@ -104,6 +104,12 @@ struct START_Header {
   // client's region.
   static const START_flags_t LOCAL_SCD_ENABLED = 1u << 11; //=2048
 
+  // Only ship a sample of the records, as described by
+  // ReadStreamAttributes::sample_mode and sample_param, which are serialized
+  // after the other read stream attributes.  Other records are reported as
+  // FILTERED_OUT gaps.  @see ServerRecordSampler.h
+  static const START_flags_t SAMPLE = 1u << 12; //=4096
+
 } __attribute__((__packed__));
 
 class START_Message : public Message {
@@ -147,10 +153,23 @@ class START_Message : public Message {
     // We have highly sophisticated handling for protocol versions
     return false;
   }
+  // Server-side sampling needs SERVER_SIDE_SAMPLING_SUPPORT, and server-side
+  // filters other than EQUALITY and RANGE need SERVER_RECORD_FILTER_KEY_SETS.
+  uint16_t getMinProtocolVersion() const override;
   bool allowUnencrypted() const override;
   static void readFilteredOut(ProtocolReader& reader, START_Message& m);
   static Message::deserializer_t deserialize;
 
+  /**
+   * Reads the fields written by serialize() from `reader'. Unlike
+   * deserialize(), does not require the message to extend to the end of the
+   * reader's input, so that START messages can be embedded in other messages
+   * (see READ_CONTROL_BATCH_Message).
+   *
+   * @return the message, or nullptr if `reader' is in an error state.
+   */
+  static std::unique_ptr<START_Message> read(ProtocolReader& reader);
+
   // `proto_' only populated when receiving
   uint16_t proto_;
   START_Header header_;
@@ -158,7 +177,7 @@ class START_Message : public Message {
   // Other storage shards will send records that those shards in this list were
   // supposed to send.
   small_shardset_t filtered_out_;
-  // server-side filtering parameters
+  // server-side filtering and sampling parameters
   ReadStreamAttributes attrs_;
 
   std::string client_session_id_; // session id of client that created stream
@@ -144,13 +144,13 @@ Message::Disposition STORED_Message::onReceived(const Address& from) {
 
   if (header_.flags & STORED_Header::REBUILDING) {
     do {
-      auto log_rebuilding =
-          w->runningLogRebuildings().find(header_.rid.logid, shard_idx);
-      if (!log_rebuilding) {
-        break;
-      }
       RecordRebuildingInterface* r =
-          log_rebuilding->findRecordRebuilding(header_.rid.lsn());
+          findRecordRebuilding(w->runningLogRebuildings(),
+                               w->runningChunkRebuildings(),
+                               rebuilding_id_,
+                               header_.rid.logid,
+                               shard_idx,
+                               header_.rid.lsn());
       if (!r) {
         break;
       }
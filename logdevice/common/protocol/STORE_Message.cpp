@@ -357,19 +357,20 @@ void STORE_Message::onSent(Status st, const Address& to) const {
 
   if (header_.flags & STORE_Header::REBUILDING) {
     Worker* w = Worker::onThisThread();
-    auto log_rebuilding =
-        w->runningLogRebuildings().find(header_.rid.logid, shard_idx);
-    if (log_rebuilding) {
-      RecordRebuildingInterface* r =
-          log_rebuilding->findRecordRebuilding(header_.rid.lsn());
-      if (r) {
-        r->onStoreSent(st,
-                       header_,
-                       shard,
-                       extra_.rebuilding_version,
-                       extra_.rebuilding_wave);
-        return;
-      }
+    RecordRebuildingInterface* r =
+        findRecordRebuilding(w->runningLogRebuildings(),
+                             w->runningChunkRebuildings(),
+                             extra_.rebuilding_id,
+                             header_.rid.logid,
+                             shard_idx,
+                             header_.rid.lsn());
+    if (r) {
+      r->onStoreSent(st,
+                     header_,
+                     shard,
+                     extra_.rebuilding_version,
+                     extra_.rebuilding_wave);
+      return;
     }
 
     RATELIMIT_INFO(std::chrono::seconds(1),
@@ -186,6 +186,48 @@ void RebuildingSettings::defineSettings(SettingEasyInit& init) {
        "time.",
        SERVER,
        SettingsCategory::Rebuilding);
+  init("rebuilding-throttle-on-overload",
+       &throttle_on_overload,
+       "false",
+       nullptr,
+       "If true, a donor slows down rebuilding while recipients of its "
+       "rebuilding stores reply that they are overloaded. Each overloaded "
+       "reply halves the donor's rebuilding-max-logs-in-flight, "
+       "rebuilding-max-records-in-flight and, with rebuilding-v2, "
+       "total-log-rebuilding-size-per-shard-mb, down to "
+       "rebuilding-throttle-min-fraction of their values, at most once per "
+       "100ms. While replies are successful, they are raised back by 1% of "
+       "their values every 100ms. The overloaded recipient is also avoided in "
+       "new copysets of the log for overloaded-retry-interval.",
+       SERVER | EXPERIMENTAL,
+       SettingsCategory::Rebuilding);
+  init("rebuilding-throttle-min-fraction",
+       &throttle_min_fraction,
+       "0.05",
+       [](double val) {
+         if (val <= 0 || val > 1) {
+           throw boost::program_options::error(
+               "rebuilding-throttle-min-fraction must be in (0, 1]");
+         }
+       },
+       "Lowest fraction of its in-flight limits that "
+       "rebuilding-throttle-on-overload can throttle a donor to.",
+       SERVER | EXPERIMENTAL,
+       SettingsCategory::Rebuilding);
+  init("rebuilding-v2",
+       &enable_v2,
+       "false",
+       nullptr,
+       "If true, a donor reads each partition of a shard once, for all logs "
+       "together, instead of running a separate LogRebuilding for each log. "
+       "Records are re-replicated in chunks of consecutive records of a log "
+       "with the same copyset. rebuilding-local-window and "
+       "rebuilding-max-logs-in-flight don't apply; "
+       "rebuilding-max-records-in-flight and rebuilding-max-amends-in-flight "
+       "apply per chunk. Only takes effect for rebuildings started after the "
+       "change.",
+       SERVER | EXPERIMENTAL,
+       SettingsCategory::Rebuilding);
   init("rebuilding-use-rocksdb-cache",
        &use_rocksdb_cache,
        "true",
@@ -223,7 +265,8 @@ void RebuildingSettings::defineSettings(SettingEasyInit& init) {
          }
        },
        "Maximum amount of memory that can be consumed by all LogRebuilding "
-       "state machines, per shard",
+       "state machines, per shard. With rebuilding-v2, maximum amount of "
+       "record data read but not yet durably re-replicated, per shard",
        SERVER,
        SettingsCategory::Rebuilding);
   init("max-log-rebuilding-"
@@ -44,6 +44,9 @@ struct RebuildingSettings : public SettingsBundle {
   size_t max_records_in_flight;
   size_t max_amends_in_flight;
   size_t max_logs_in_flight;
+  bool throttle_on_overload;
+  double throttle_min_fraction;
+  bool enable_v2;
   bool use_rocksdb_cache;
   RebuildingReadOnlyOption read_only;
   size_t checkpoint_interval_mb;
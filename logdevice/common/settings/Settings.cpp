@@ -22,6 +22,7 @@
 #include "logdevice/common/protocol/MessageTypeNames.h"
 #include "logdevice/common/FileConfigSource.h"
 #include "logdevice/common/Sockaddr.h"
+#include "logdevice/common/client_read_stream/ClientReadStreamBufferFactory.h"
 #include "logdevice/common/configuration/ZookeeperConfigSource.h"
 #include "logdevice/common/protocol/Compatibility.h"
 #include "logdevice/common/settings/Validators.h"
@@ -234,6 +235,25 @@ static int parse_scd_copyset_reordering(const std::string& val) {
   }
 }
 
+static ClientReadStreamBufferType
+parse_client_read_buffer_type(const std::string& val) {
+  if (val == "circular") {
+    return ClientReadStreamBufferType::CIRCULAR;
+  } else if (val == "ordered-map") {
+    return ClientReadStreamBufferType::ORDERED_MAP;
+  } else if (val == "bitmap") {
+    return ClientReadStreamBufferType::BITMAP;
+  } else {
+    std::array<char, 1024> buf;
+    snprintf(buf.data(),
+             buf.size(),
+             "Invalid value for --client-read-buffer-type: %s. "
+             "Expected one of: circular, ordered-map, bitmap",
+             val.c_str());
+    throw boost::program_options::error(std::string(buf.data()));
+  }
+}
+
 std::istream& operator>>(std::istream& in, NodeLocationScope& val) {
   std::string key;
   in >> key;
@@ -450,6 +470,58 @@ void Settings::defineSettings(SettingEasyInit& init) {
        "amount of RECORD data to push to the client at once",
        SERVER | CLIENT,
        SettingsCategory::ReadPath);
+  init("catchup-queue-tail-quantum-kb",
+       &catchup_queue_tail_quantum_kb,
+       "1024",
+       parse_nonnegative<ssize_t>(),
+       "deficit round robin quantum of tailing read streams in a client's "
+       "catchup queue: how many kilobytes of records a stream may deliver "
+       "each time its turn comes, before yielding to the client's other "
+       "streams. Also how many kilobytes, times the read_weight of its "
+       "principal, a client may read each round when clients compete for a "
+       "worker. 0 means no limit",
+       SERVER,
+       SettingsCategory::ReadPath);
+  init("catchup-queue-backlog-quantum-kb",
+       &catchup_queue_backlog_quantum_kb,
+       "256",
+       parse_nonnegative<ssize_t>(),
+       "same as --catchup-queue-tail-quantum-kb for read streams reading "
+       "backlog (READ_BACKLOG traffic class). Smaller than the tail quantum "
+       "so that a large backlog doesn't delay the client's tailing streams",
+       SERVER,
+       SettingsCategory::ReadPath);
+  init("output-adaptive-drain-time",
+       &output_adaptive_drain_time,
+       "0ms",
+       validate_nonnegative<ssize_t>(),
+       "if positive, the amount of RECORD data to push to a client at once "
+       "(and so the size of read storage tasks) is adapted to how fast the "
+       "client reads: it is the amount its socket was observed to drain in "
+       "this much time, between --output-adaptive-min-records-kb and "
+       "--output-adaptive-max-records-kb, instead of --output-max-records-kb. "
+       "Slow clients then get small batches that don't sit in socket buffers "
+       "and fast clients get large ones. 0 disables",
+       SERVER,
+       SettingsCategory::ReadPath);
+  init("output-adaptive-min-records-kb",
+       &output_adaptive_min_records_kb,
+       "64",
+       parse_positive<ssize_t>(),
+       "lower bound of the amount of RECORD data pushed to a client at once, "
+       "see --output-adaptive-drain-time. Must not be greater than "
+       "--output-adaptive-max-records-kb",
+       SERVER,
+       SettingsCategory::ReadPath);
+  init("output-adaptive-max-records-kb",
+       &output_adaptive_max_records_kb,
+       "16384",
+       parse_positive<ssize_t>(),
+       "upper bound of the amount of RECORD data pushed to a client at once, "
+       "see --output-adaptive-drain-time. A batch is also never more than a "
+       "quarter of the worker's share of --read-storage-tasks-max-mem-bytes",
+       SERVER,
+       SettingsCategory::ReadPath);
   init("max-cached-digest-record-queued-kb",
        &max_cached_digest_record_queued_kb,
        "256",
@@ -481,6 +553,16 @@ void Settings::defineSettings(SettingEasyInit& init) {
        "Maximum execution time for reading records. 'max' means no limit.",
        SERVER | EXPERIMENTAL,
        SettingsCategory::ResourceManagement);
+  init("read-storage-task-deadline",
+       &read_storage_task_deadline,
+       "max",
+       validate_positive<ssize_t>(),
+       "Read storage tasks for client read streams that are still waiting for "
+       "a storage thread this long after they were issued are dropped "
+       "instead of executed, on the assumption that the client has timed "
+       "out. The read stream retries later. 'max' means no deadline.",
+       SERVER,
+       SettingsCategory::ReadPath);
   init("read-requests",
        &requests_from_pipe,
        "128",
@@ -954,6 +1036,68 @@ void Settings::defineSettings(SettingEasyInit& init) {
        "window update messages (less means more often)",
        CLIENT | SERVER /* for event log reads */,
        SettingsCategory::ReadPath);
+  init("client-read-buffer-type",
+       &client_read_buffer_type,
+       "circular",
+       parse_client_read_buffer_type,
+       "type of buffer in which read streams hold records that can't be "
+       "delivered yet: circular (one slot per LSN in the window), "
+       "ordered-map (only holds received records, for very large sparse "
+       "windows) or bitmap (like circular, with an occupancy bitmap so that "
+       "scans skip empty slots).  Only applies to new read streams.",
+       CLIENT,
+       SettingsCategory::ReadPath);
+  init("client-read-decode-parallelism",
+       &client_read_decode_parallelism,
+       "1",
+       validate_positive<ssize_t>(),
+       "maximum number of threads Reader uses to decompress BufferedWriter "
+       "batches that are ready to be read. With more than 1, read() and "
+       "readBatch() decompress all ready batches at once, fanning out to a "
+       "pool of decode threads shared by all clients in the process.",
+       CLIENT,
+       SettingsCategory::ReadPath);
+  init("client-read-adaptive-window",
+       &client_read_adaptive_window,
+       "false",
+       nullptr,
+       "if true, size the flow control window of each read stream from the "
+       "measured round trip time to storage nodes and the rate at which the "
+       "application consumes records, instead of always using "
+       "--client-read-buffer-size records. The window never exceeds "
+       "--client-read-buffer-size. Only applies to new read streams.",
+       CLIENT,
+       SettingsCategory::ReadPath);
+  init("client-readers-memory-budget",
+       &client_readers_memory_budget,
+       "0",
+       parse_memory_budget(),
+       "maximum total size of record payloads buffered by all read streams of "
+       "the client. Read streams shrink their flow control windows while the "
+       "limit is exceeded. Accepts a size (e.g. \"1G\") or a percentage of "
+       "system memory (e.g. \"5%\"). 0 means unlimited.",
+       CLIENT,
+       SettingsCategory::ReadPath);
+  init("client-read-batch-control-messages",
+       &client_read_batch_control_messages,
+       "false",
+       nullptr,
+       "if true, START, WINDOW and STOP messages that read streams send to the "
+       "same storage node around the same time are batched into a single "
+       "message, which greatly reduces the number of messages when reading "
+       "many logs at once. Only used with storage nodes that support it.",
+       CLIENT,
+       SettingsCategory::ReadPath);
+  init("client-read-stream-idle-compaction-interval",
+       &client_read_stream_idle_compaction_interval,
+       "30s",
+       validate_nonnegative<ssize_t>(),
+       "how often read streams that have not received any record or gap "
+       "since the previous check release the memory of their empty record "
+       "buffer and of their inactive timers. Reduces the memory footprint of "
+       "clients reading many mostly idle logs. 0 disables.",
+       CLIENT,
+       SettingsCategory::ReadPath);
   init("client-epoch-metadata-cache-size",
        &client_epoch_metadata_cache_size,
        "50000",
@@ -1016,6 +1160,52 @@ void Settings::defineSettings(SettingEasyInit& init) {
        "logs, currently the event logs and logsconfig logs",
        SERVER,
        SettingsCategory::WritePath);
+  init("batch-releases",
+       &batch_releases,
+       "false",
+       nullptr,
+       "if true, sequencers coalesce the RELEASE messages that the logs of a "
+       "worker send to the same storage node and send them as a single "
+       "RELEASE_BATCH message, with only the latest release of each log. This "
+       "greatly reduces the number of messages storage nodes handle when "
+       "many logs are written to. Only used with storage nodes that support "
+       "it. See also --release-batch-max-delay.",
+       SERVER,
+       SettingsCategory::WritePath);
+  init("release-batch-max-delay",
+       &release_batch_max_delay,
+       "0ms",
+       validate_nonnegative<ssize_t>(),
+       "with --batch-releases, the maximum time a RELEASE waits for other "
+       "RELEASEs to the same storage node before they are sent. This bounds "
+       "the delivery latency added by batching. Larger values coalesce more "
+       "releases of the same log. 0 means RELEASEs are sent at the end of "
+       "the event loop iteration in which they were produced.",
+       SERVER,
+       SettingsCategory::WritePath);
+  init("batch-seals",
+       &batch_seals,
+       "false",
+       nullptr,
+       "if true, log recoveries running on the same worker send their SEAL "
+       "messages for the same storage node as a single SEAL_BATCH message. "
+       "This reduces the number of messages storage nodes handle when a "
+       "sequencer node recovers many logs at once, e.g. after failover. Only "
+       "used with storage nodes that support it. See also "
+       "--seal-batch-max-delay.",
+       SERVER,
+       SettingsCategory::Recovery);
+  init("seal-batch-max-delay",
+       &seal_batch_max_delay,
+       "0ms",
+       validate_nonnegative<ssize_t>(),
+       "with --batch-seals, the maximum time a SEAL waits for other SEALs to "
+       "the same storage node before they are sent. Larger values put the "
+       "SEALs of more logs in each batch at the cost of delaying recovery. 0 "
+       "means SEALs are sent at the end of the event loop iteration in which "
+       "they were produced.",
+       SERVER,
+       SettingsCategory::Recovery);
   init("recovery-grace-period",
        &recovery_grace_period,
        "100ms",
@@ -1502,6 +1692,28 @@ void Settings::defineSettings(SettingEasyInit& init) {
        "\"any\" or \"\" to keep the default.",
        SERVER | REQUIRES_RESTART /* used once when ExecStorageThread starts */,
        SettingsCategory::ResourceManagement);
+  init("storage-threads-adaptive-concurrency",
+       &storage_threads_adaptive_concurrency,
+       "false",
+       nullptr, // no validation
+       "If true, the number of storage tasks the 'slow' storage threads of a "
+       "shard execute concurrently is limited, and the limit is adjusted to "
+       "the measured latency of the tasks: it grows while latency stays "
+       "close to its baseline and shrinks when latency inflates. The number "
+       "of slow threads (--storage-threads-per-shard-slow) is the upper "
+       "bound, so it should be set higher than usual, e.g. to the "
+       "concurrency the fastest device in the cluster can sustain.",
+       SERVER | REQUIRES_RESTART /* used when StorageThreadPool is created */,
+       SettingsCategory::ResourceManagement);
+  init("storage-threads-min-concurrency-slow",
+       &storage_threads_min_concurrency_slow,
+       "2",
+       parse_positive<ssize_t>(),
+       "with --storage-threads-adaptive-concurrency, lower bound of the "
+       "number of storage tasks the 'slow' storage threads of a shard "
+       "execute concurrently. This is also the initial limit.",
+       SERVER | REQUIRES_RESTART /* used when StorageThreadPool is created */,
+       SettingsCategory::ResourceManagement);
 
   init("checksumming-enabled",
        &checksumming_enabled,
@@ -2307,6 +2519,17 @@ void Settings::defineSettings(SettingEasyInit& init) {
        "When the real time buffer reaches this size, we evict entries.",
        SERVER | REQUIRES_RESTART | EXPERIMENTAL,
        SettingsCategory::ReadPath);
+  init("real-time-recent-batches-per-log",
+       &real_time_recent_batches_per_log,
+       "64",
+       nullptr, // no validation
+       "Number of most recently released batches of records of each log that "
+       "a worker keeps after handing them to read streams, so that a stream "
+       "that fell slightly behind the tail can catch up from memory instead "
+       "of reading from the local log store. Counted against "
+       "--real-time-max-bytes. 0 disables.",
+       SERVER | EXPERIMENTAL,
+       SettingsCategory::ReadPath);
 
   init("test-timestamp-linear-transform",
        &test_timestamp_linear_transform,
@@ -48,6 +48,8 @@ struct hash<facebook::logdevice::MessageType> {
 
 namespace facebook { namespace logdevice {
 
+enum class ClientReadStreamBufferType : uint8_t;
+
 struct Settings : public SettingsBundle {
   const char* getName() const override {
     return "ProcessorSettings";
@@ -126,6 +128,22 @@ struct Settings : public SettingsBundle {
   // the client at once.  If -1, use the TCP sendbuf size.
   int output_max_records_kb;
 
+  // CatchupQueue serves the read streams of a client with deficit round
+  // robin: every time a stream gets its turn it may read this many more
+  // kilobytes before yielding to the other streams.  Separate quanta for
+  // tailing and backlog streams.  0 means no limit.  The tail quantum, scaled
+  // by the read weight of the client's principal, is also the share of a
+  // client in each round of CatchupQueueArbiter.
+  ssize_t catchup_queue_tail_quantum_kb;
+  ssize_t catchup_queue_backlog_quantum_kb;
+
+  // If positive, output_max_records_kb is replaced, for each client, with the
+  // amount of RECORD data its socket was observed to drain in this much time,
+  // bounded by output_adaptive_{min,max}_records_kb.
+  std::chrono::milliseconds output_adaptive_drain_time;
+  ssize_t output_adaptive_min_records_kb;
+  ssize_t output_adaptive_max_records_kb;
+
   // How many bytes of records to read in a single StorageTask.
   // Similar to output_max_records_kb but is applied *before* filtering records.
   int64_t max_record_bytes_read_at_once;
@@ -133,6 +151,11 @@ struct Settings : public SettingsBundle {
   // Maximum execution time for reading records
   std::chrono::milliseconds max_record_read_execution_time;
 
+  // Read storage tasks still queued this long after they were created are
+  // dropped, their client has likely given up on them.  max means no
+  // deadline.
+  std::chrono::milliseconds read_storage_task_deadline;
+
   // @deprecated
   unsigned requests_from_pipe;
 
@@ -370,6 +393,25 @@ struct Settings : public SettingsBundle {
   chrono_expbackoff_t<std::chrono::milliseconds>
       release_broadcast_interval_internal_logs;
 
+  // If true, sequencers send the RELEASEs of a worker's logs to each storage
+  // node in RELEASE_BATCH messages, keeping only the latest release of each
+  // log.  See ReleaseBatcher.
+  bool batch_releases;
+
+  // With batch_releases, how long a RELEASE can wait for others to the same
+  // storage node before its batch is sent.  0 means until the end of the
+  // event loop iteration.
+  std::chrono::milliseconds release_batch_max_delay;
+
+  // If true, LogRecoveryRequests send their SEALs to each storage node in
+  // SEAL_BATCH messages.  See SealBatcher.
+  bool batch_seals;
+
+  // With batch_seals, how long a SEAL can wait for others to the same
+  // storage node before its batch is sent.  0 means until the end of the
+  // event loop iteration.
+  std::chrono::milliseconds seal_batch_max_delay;
+
   bool skip_recovery;
 
   // Maximum number of LogRecoveryRequests for data logs that can be running
@@ -499,6 +541,35 @@ struct Settings : public SettingsBundle {
   // but also wire chatter.
   double client_read_flow_control_threshold;
 
+  // (client-only setting) Type of buffer used by read streams created by
+  // Reader and AsyncReader to hold records that can't be delivered yet.
+  ClientReadStreamBufferType client_read_buffer_type;
+
+  // (client-only setting) Maximum number of threads Reader uses to decompress
+  // the BufferedWriter batches that are ready to be read.  1 decodes on the
+  // calling thread only.
+  size_t client_read_decode_parallelism;
+
+  // (client-only setting) If true, ClientReadStream sizes its flow control
+  // window and flow control threshold from the measured round trip time to
+  // storage nodes and the rate at which the application consumes records,
+  // up to client_read_buffer_size.
+  bool client_read_adaptive_window;
+
+  // (client-only setting) Limit on the total size of payloads buffered by all
+  // read streams of the client, split evenly across workers.  When exceeded,
+  // read streams shrink their windows.  0 means unlimited.
+  size_t client_readers_memory_budget;
+
+  // (client-only setting) If true, START, WINDOW and STOP messages that the
+  // read streams of a worker send to the same storage node during one event
+  // loop iteration are sent as a single READ_CONTROL_BATCH message.
+  bool client_read_batch_control_messages;
+
+  // (client-only setting) How often read streams that received nothing
+  // since the previous check free their idle buffers and timers.  0 disables.
+  std::chrono::milliseconds client_read_stream_idle_compaction_interval;
+
   // (client-only setting) maximum number of epoch metadata entries cached in
   // the client. Set it to 0 to disable epoch metadata caching
   size_t client_epoch_metadata_cache_size;
@@ -683,6 +754,13 @@ struct Settings : public SettingsBundle {
   // See man ioprio_set for possible values.
   folly::Optional<std::pair<int, int>> slow_ioprio;
 
+  // If true, the number of tasks 'slow' storage threads execute concurrently
+  // is adjusted to the latency of the tasks, between
+  // storage_threads_min_concurrency_slow and the number of slow threads.
+  // See AdaptiveConcurrencyLimiter.
+  bool storage_threads_adaptive_concurrency;
+  int storage_threads_min_concurrency_slow;
+
   // (client-only setting) Timeout after which ClientReadStream considers a
   // storage node down if it does not send any data for some time but the socket
   // to it remains open. This can happen if:
@@ -1042,6 +1120,11 @@ struct Settings : public SettingsBundle {
   // entries.
   size_t real_time_eviction_threshold_bytes;
 
+  // (server-only setting) Number of most recently released record batches of
+  // each log that a worker keeps after handing them to its read streams, so
+  // that streams which fell slightly behind can catch up from memory.
+  size_t real_time_recent_batches_per_log;
+
   // Test Options:
 
   // This option should only be used in tests. This is used to linerarly
@@ -25,7 +25,10 @@ struct ClientHistograms : public HistogramBundle {
             {"get_tail_lsn_latency", &get_tail_lsn_latency},
             {"is_log_empty_latency", &is_log_empty_latency},
             {"data_size", &data_size},
-            {"trim_latency", &trim_latency}};
+            {"trim_latency", &trim_latency},
+            {"buffered_write_decoded_bytes", &buffered_write_decoded_bytes},
+            {"buffered_write_decode_latency",
+             &buffered_write_decode_latency}};
   }
   LatencyHistogram append_latency;
   LatencyHistogram findtime_latency;
@@ -36,6 +39,10 @@ struct ClientHistograms : public HistogramBundle {
   LatencyHistogram is_log_empty_latency;
   LatencyHistogram data_size;
   LatencyHistogram trim_latency;
+  // Uncompressed size of BufferedWriter blobs decoded by the client
+  SizeHistogram buffered_write_decoded_bytes;
+  // Time to decompress and parse a BufferedWriter blob
+  LatencyHistogram buffered_write_decode_latency;
 };
 
 }} // namespace facebook::logdevice
@@ -7,7 +7,9 @@
  */
 #include <random>
 #include <folly/Memory.h>
+#include <folly/Varint.h>
 #include <gtest/gtest.h>
+#include <zstd.h>
 
 #include "logdevice/common/DataRecordOwnsPayload.h"
 #include "logdevice/common/debug.h"
@@ -17,6 +19,7 @@
 #include "logdevice/common/buffered_writer/BufferedWriteDecoderImpl.h"
 #include "logdevice/common/buffered_writer/BufferedWriterImpl.h"
 #include "logdevice/common/buffered_writer/BufferedWriterSingleLog.h"
+#include "logdevice/common/buffered_writer/DecompressionBufferPool.h"
 #include "logdevice/common/protocol/RECORD_Message.h"
 #include "logdevice/common/settings/util.h"
 #include "logdevice/common/test/TestUtil.h"
@@ -875,3 +878,168 @@ TEST_F(BufferedWriterTest, InitialDelayGreaterThanMaxDelay) {
   std::vector<std::string> expected = {"a"};
   ASSERT_EQ(expected, cb.payloads_succeeded);
 }
+
+// decodeOneShared() should decode an uncompressed blob without copying it and
+// keep the payloads valid after the source record is destroyed.
+TEST(BufferedWriteDecoderTest, DecodeOneSharedDoesNotCopy) {
+  // Uncompressed blob with SIZE_INCLUDED: marker, flags, batch size, then
+  // length-prefixed payloads
+  const std::string blob = std::string("\xb1") +
+      char(BufferedWriteDecoderImpl::Flags::SIZE_INCLUDED) + "\x02" +
+      "\x03" + "foo" + "\x06" + "barbaz";
+  void* buf = malloc(blob.size());
+  memcpy(buf, blob.data(), blob.size());
+  auto record = std::make_unique<DataRecordOwnsPayload>(
+      logid_t(1),
+      Payload(buf, blob.size()),
+      lsn_t(1),
+      std::chrono::milliseconds(0),
+      RECORD_flags_t(RECORD_Header::BUFFERED_WRITER_BLOB));
+
+  auto decoder = std::make_shared<BufferedWriteDecoderImpl>();
+  std::vector<Payload> payloads;
+  ASSERT_EQ(0, decoder->decodeOneShared(*record, payloads));
+  // The record still holds the payload, e.g. for redelivery
+  ASSERT_EQ(buf, record->payload.data());
+  record.reset();
+
+  ASSERT_EQ(2, payloads.size());
+  // Payloads point into the original buffer
+  ASSERT_EQ((const char*)buf + 4, payloads[0].data());
+  ASSERT_EQ("foo", payloads[0].toString());
+  ASSERT_EQ("barbaz", payloads[1].toString());
+}
+
+namespace {
+
+// Builds a ZSTD-compressed BufferedWriter blob holding `payloads'.  If
+// `corrupt', the uncompressed size in the header is wrong.
+std::string makeZstdBlob(const std::vector<std::string>& payloads,
+                         bool corrupt = false) {
+  uint8_t varint[folly::kMaxVarintLength64];
+  std::string body;
+  for (const std::string& payload : payloads) {
+    body.append((const char*)varint,
+                folly::encodeVarint(payload.size(), varint));
+    body += payload;
+  }
+  std::string compressed(ZSTD_compressBound(body.size()), '\0');
+  size_t len = ZSTD_compress(
+      &compressed[0], compressed.size(), body.data(), body.size(), 1);
+  EXPECT_FALSE(ZSTD_isError(len));
+  compressed.resize(len);
+
+  std::string blob = std::string("\xb1") +
+      char(BufferedWriteDecoderImpl::Flags::SIZE_INCLUDED |
+           (uint8_t)Compression::ZSTD);
+  blob.append((const char*)varint,
+              folly::encodeVarint(payloads.size(), varint));
+  blob.append((const char*)varint,
+              folly::encodeVarint(body.size() + corrupt, varint));
+  return blob + compressed;
+}
+
+std::unique_ptr<DataRecord> makeBlobRecord(const std::string& blob,
+                                           lsn_t lsn) {
+  void* buf = malloc(blob.size());
+  memcpy(buf, blob.data(), blob.size());
+  return std::make_unique<DataRecordOwnsPayload>(
+      logid_t(1),
+      Payload(buf, blob.size()),
+      lsn,
+      std::chrono::milliseconds(0),
+      RECORD_flags_t(RECORD_Header::BUFFERED_WRITER_BLOB));
+}
+
+} // namespace
+
+// Parallel decode() must deliver payloads in record order and leave only the
+// malformed records in the input vector, like the sequential one.
+TEST(BufferedWriteDecoderTest, ParallelDecodePreservesOrder) {
+  std::vector<std::unique_ptr<DataRecord>> records;
+  std::vector<std::string> expected;
+  for (int i = 0; i < 40; ++i) {
+    std::vector<std::string> batch;
+    for (int j = 0; j < 10; ++j) {
+      batch.push_back(std::to_string(i) + "-" + std::to_string(j) +
+                      std::string(1000, 'a' + j));
+    }
+    const bool corrupt = i == 17;
+    if (!corrupt) {
+      expected.insert(expected.end(), batch.begin(), batch.end());
+    }
+    records.push_back(
+        makeBlobRecord(makeZstdBlob(batch, corrupt), lsn_t(i + 1)));
+  }
+
+  BufferedWriteDecoder::Options options;
+  options.parallelism = 4;
+  auto decoder = BufferedWriteDecoder::create(options);
+  std::vector<Payload> payloads;
+  ASSERT_EQ(-1, decoder->decode(std::move(records), payloads));
+
+  std::vector<std::string> decoded;
+  for (const Payload& payload : payloads) {
+    decoded.push_back(payload.toString());
+  }
+  ASSERT_EQ(expected, decoded);
+  for (size_t i = 0; i < records.size(); ++i) {
+    ASSERT_EQ(i == 17, records[i] != nullptr);
+  }
+}
+
+// Buffers of records decoded with decodeEach() go back to the pool when the
+// last payload using them is released, even while the decoder lives on.  The
+// decode threads are joined when the last parallel decoder is destroyed.
+TEST(BufferedWriteDecoderTest, DecodeEachReleasesBuffersWithPayloads) {
+  // Large enough to be alone in the 2MB size class
+  const std::string big(1500 * 1000, 'x');
+  std::vector<std::unique_ptr<DataRecord>> records;
+  records.push_back(makeBlobRecord(makeZstdBlob({"a" + big}), lsn_t(1)));
+  records.push_back(makeBlobRecord(makeZstdBlob({"b" + big}), lsn_t(2)));
+
+  auto decoder = std::make_unique<BufferedWriteDecoderImpl>(4);
+  std::vector<std::vector<Payload>> payloads;
+  std::vector<std::shared_ptr<const void>> owners;
+  std::vector<int> rvs;
+  decoder->decodeEach(records, payloads, owners, rvs);
+  ASSERT_EQ(std::vector<int>({0, 0}), rvs);
+  ASSERT_EQ(nullptr, records[0].get());
+  ASSERT_EQ(nullptr, records[1].get());
+  ASSERT_GT(BufferedWriteDecoderImpl::getDecodeThreadCount(), 0);
+
+  DecompressionBufferPool& pool = DecompressionBufferPool::get();
+  const size_t retained = pool.getRetainedBytes();
+  payloads[0].clear();
+  owners[0].reset();
+  ASSERT_EQ(retained + 2 * 1024 * 1024, pool.getRetainedBytes());
+
+  // The other payload is still valid without the decoder
+  decoder.reset();
+  ASSERT_EQ(0, BufferedWriteDecoderImpl::getDecodeThreadCount());
+  ASSERT_EQ(1, payloads[1].size());
+  ASSERT_EQ("b" + big, payloads[1][0].toString());
+}
+
+TEST(BufferedWriteDecoderTest, DecompressionBufferPoolReusesBuffers) {
+  DecompressionBufferPool pool;
+  uint8_t* ptr;
+  {
+    auto buf = pool.allocate(5000);
+    ptr = buf.get();
+    ASSERT_EQ(0, pool.getRetainedBytes());
+  }
+  // Rounded up to the 8KB size class and kept after release
+  ASSERT_EQ(8192, pool.getRetainedBytes());
+  {
+    // Same size class
+    auto buf = pool.allocate(6000);
+    ASSERT_EQ(ptr, buf.get());
+    ASSERT_EQ(0, pool.getRetainedBytes());
+  }
+  {
+    // Too large to be pooled
+    auto buf = pool.allocate(DecompressionBufferPool::MAX_CLASS_SIZE + 1);
+  }
+  ASSERT_EQ(8192, pool.getRetainedBytes());
+}
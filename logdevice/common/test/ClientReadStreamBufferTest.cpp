@@ -10,6 +10,7 @@
 #include "logdevice/common/DataRecordOwnsPayload.h"
 #include "logdevice/common/LibeventTimer.h"
 #include "logdevice/common/client_read_stream/ClientReadStream.h"
+#include "logdevice/common/client_read_stream/ClientReadStreamBitmapBuffer.h"
 #include "logdevice/common/client_read_stream/ClientReadStreamBuffer.h"
 #include "logdevice/common/client_read_stream/ClientReadStreamBufferFactory.h"
 #include "logdevice/common/client_read_stream/ClientReadStreamCircularBuffer.h"
@@ -37,11 +38,7 @@ class ClientReadStreamBufferTest
     : public ::testing::TestWithParam<ClientReadStreamBufferType> {
  public:
   virtual void SetUp() {
-    if (GetParam() == ClientReadStreamBufferType::CIRCULAR) {
-      buf = std::make_unique<ClientReadStreamCircularBuffer>(10, 100);
-    } else {
-      buf = std::make_unique<ClientReadStreamOrderedMapBuffer>(10, 100);
-    }
+    buf = ClientReadStreamBufferFactory::create(GetParam(), 10, 100);
   }
   std::unique_ptr<ClientReadStreamBuffer> buf;
 };
@@ -57,8 +54,8 @@ TEST_P(ClientReadStreamBufferTest, ForEachForward) {
 }
 
 TEST_P(ClientReadStreamBufferTest, ForEachWithHoles) {
-  // holes are only supported in ordered map
-  if (GetParam() != ClientReadStreamBufferType::ORDERED_MAP) {
+  // holes are only supported in ordered map and bitmap buffers
+  if (GetParam() == ClientReadStreamBufferType::CIRCULAR) {
     return;
   }
   auto reset_buffer = [&]() {
@@ -120,9 +117,9 @@ TEST_P(ClientReadStreamBufferTest, ForEachBackward2) {
 TEST_P(ClientReadStreamBufferTest, ForEachForwardEmpty) {
   Collector collector;
   buf->forEach(100, 102, std::ref(collector));
-  if (GetParam() == ClientReadStreamBufferType::ORDERED_MAP) {
-    // Ordered map only returns actual entries
-    // but since the map is empty, it should not return anything
+  if (GetParam() != ClientReadStreamBufferType::CIRCULAR) {
+    // Ordered map and bitmap buffers only return actual entries
+    // but since the buffer is empty, it should not return anything
     ASSERT_COLLECTED(collector);
   } else {
     ASSERT_COLLECTED(collector, 100, 101, 102);
@@ -133,9 +130,9 @@ TEST_P(ClientReadStreamBufferTest, ForEachForwardEmpty) {
 TEST_P(ClientReadStreamBufferTest, ForEachBackwardEmpty) {
   Collector collector;
   buf->forEach(102, 100, std::ref(collector));
-  if (GetParam() == ClientReadStreamBufferType::ORDERED_MAP) {
-    // Ordered map only returns actual entries
-    // but since the map is empty, it should not return anything
+  if (GetParam() != ClientReadStreamBufferType::CIRCULAR) {
+    // Ordered map and bitmap buffers only return actual entries
+    // but since the buffer is empty, it should not return anything
     ASSERT_COLLECTED(collector);
   } else {
     ASSERT_COLLECTED(collector, 102, 101, 100);
@@ -143,10 +140,105 @@ TEST_P(ClientReadStreamBufferTest, ForEachBackwardEmpty) {
   ASSERT_TRUE(true);
 }
 
+TEST_P(ClientReadStreamBufferTest, FindFirstMarker) {
+  ASSERT_EQ(LSN_INVALID, buf->findFirstMarker().second);
+  buf->createOrGet(lsn_t{104})->gap = true;
+  buf->createOrGet(lsn_t{107})->gap = true;
+  auto marker = buf->findFirstMarker();
+  ASSERT_EQ(lsn_t{104}, marker.second);
+  ASSERT_EQ(buf->find(lsn_t{104}), marker.first);
+  marker.first->gap = false;
+  buf->advanceBufferHead(4);
+  buf->popFront();
+  buf->advanceBufferHead(1);
+  ASSERT_EQ(lsn_t{107}, buf->findFirstMarker().second);
+}
+
+TEST_P(ClientReadStreamBufferTest, ReleaseMemoryIfEmpty) {
+  buf->createOrGet(lsn_t{103})->gap = true;
+  ASSERT_FALSE(buf->releaseMemoryIfEmpty());
+  ASSERT_NE(nullptr, buf->find(lsn_t{103}));
+
+  buf->find(lsn_t{103})->gap = false;
+  buf->advanceBufferHead(4);
+  // Nothing buffered anymore.  The ordered map has nothing to release.
+  ASSERT_EQ(GetParam() != ClientReadStreamBufferType::ORDERED_MAP,
+            buf->releaseMemoryIfEmpty());
+  ASSERT_FALSE(buf->releaseMemoryIfEmpty());
+  ASSERT_EQ(nullptr, buf->front());
+  ASSERT_EQ(nullptr, buf->find(lsn_t{105}));
+  ASSERT_EQ(LSN_INVALID, buf->findFirstMarker().second);
+  buf->popFront();
+  buf->advanceBufferHead(2);
+  ASSERT_EQ(lsn_t{106}, buf->getBufferHead());
+  ASSERT_EQ(10, buf->capacity());
+
+  // The buffer works as before once something is stored again.
+  buf->createOrGet(lsn_t{108})->gap = true;
+  auto marker = buf->findFirstMarker();
+  ASSERT_EQ(lsn_t{108}, marker.second);
+  ASSERT_EQ(buf->find(lsn_t{108}), marker.first);
+}
+
 INSTANTIATE_TEST_CASE_P(
     ClientReadStreamBufferTest,
     ClientReadStreamBufferTest,
     ::testing::Values(ClientReadStreamBufferType::CIRCULAR,
-                      ClientReadStreamBufferType::ORDERED_MAP));
+                      ClientReadStreamBufferType::ORDERED_MAP,
+                      ClientReadStreamBufferType::BITMAP));
+
+// Exercises the bitmap buffer across 64-slot word boundaries and the
+// wraparound of its ring of slots.
+TEST(ClientReadStreamBitmapBufferTest, WordBoundariesAndWraparound) {
+  const size_t capacity = 200;
+  ClientReadStreamBitmapBuffer buf(capacity, 1000);
+  // Move the physical head to the middle of a word.
+  buf.advanceBufferHead(150);
+  const lsn_t head = 1150;
+
+  const std::vector<lsn_t> markers = {
+      head, head + 13, head + 49, head + 50, head + 63, head + 64, head + 199};
+  for (lsn_t lsn : markers) {
+    buf.createOrGet(lsn)->gap = true;
+  }
+  // A placeholder that never becomes a marker.
+  buf.createOrGet(head + 30);
+
+  Collector collector;
+  buf.forEach(head, head + 199, std::ref(collector));
+  ASSERT_COLLECTED(collector,
+                   head,
+                   head + 13,
+                   head + 30,
+                   head + 49,
+                   head + 50,
+                   head + 63,
+                   head + 64,
+                   head + 199);
+  buf.forEach(head + 199, head + 40, std::ref(collector));
+  ASSERT_COLLECTED(
+      collector, head + 199, head + 64, head + 63, head + 50, head + 49);
+
+  for (lsn_t lsn : markers) {
+    auto marker = buf.findFirstMarker();
+    ASSERT_EQ(lsn, marker.second);
+    marker.first->gap = false;
+    buf.advanceBufferHead(lsn - buf.getBufferHead() + 1);
+  }
+  ASSERT_EQ(LSN_INVALID, buf.findFirstMarker().second);
+  buf.forEachUpto(buf.maxLSNToAccept(), std::ref(collector));
+  ASSERT_COLLECTED(collector);
+
+  // Advancing by more than the capacity empties the buffer.
+  buf.createOrGet(buf.getBufferHead() + 5);
+  buf.advanceBufferHead(3 * capacity + 7);
+  buf.forEachUpto(buf.maxLSNToAccept(), std::ref(collector));
+  ASSERT_COLLECTED(collector);
+
+  buf.createOrGet(buf.getBufferHead() + 1)->gap = true;
+  buf.clear();
+  ASSERT_EQ(nullptr, buf.find(buf.getBufferHead() + 1));
+  ASSERT_EQ(LSN_INVALID, buf.findFirstMarker().second);
+}
 
 }} // namespace facebook::logdevice
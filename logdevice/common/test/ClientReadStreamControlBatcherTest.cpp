@@ -0,0 +1,190 @@
+/**
+ * Copyright (c) 2017-present, Facebook, Inc. and its affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+#include "logdevice/common/client_read_stream/ClientReadStreamControlBatcher.h"
+
+#include <memory>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "logdevice/common/ReadStreamAttributes.h"
+#include "logdevice/common/client_read_stream/AllClientReadStreams.h"
+#include "logdevice/common/protocol/Compatibility.h"
+#include "logdevice/common/protocol/READ_CONTROL_BATCH_Message.h"
+#include "logdevice/common/protocol/START_Message.h"
+#include "logdevice/common/protocol/STOP_Message.h"
+#include "logdevice/common/protocol/WINDOW_Message.h"
+#include "logdevice/common/util.h"
+
+using namespace facebook::logdevice;
+
+// Batching itself is tested in NodeMessageBatcherTest.
+
+namespace {
+
+read_stream_id_t readStreamOf(const Message& msg) {
+  switch (msg.type_) {
+    case MessageType::START:
+      return checked_downcast<const START_Message&>(msg).header_.read_stream_id;
+    case MessageType::WINDOW:
+      return checked_downcast<const WINDOW_Message&>(msg)
+          .header_.read_stream_id;
+    case MessageType::STOP:
+      return checked_downcast<const STOP_Message&>(msg).header_.read_stream_id;
+    default:
+      ADD_FAILURE() << "unexpected message type";
+      return READ_STREAM_ID_INVALID;
+  }
+}
+
+struct Sent {
+  bool batch;
+  // Types and read streams of the message, or of those embedded in the batch.
+  std::vector<MessageType> types;
+  std::vector<read_stream_id_t> rsids;
+};
+
+class MockClientReadStreamControlBatcher
+    : public ClientReadStreamControlBatcher {
+ public:
+  explicit MockClientReadStreamControlBatcher(AllClientReadStreams& owner)
+      : ClientReadStreamControlBatcher(owner) {}
+
+  uint16_t proto = Compatibility::MAX_PROTOCOL_SUPPORTED;
+  std::vector<Sent> sent;
+
+ protected:
+  folly::Optional<uint16_t> getPeerProtocol(NodeID /*node*/) override {
+    return proto;
+  }
+
+  int sendMessage(std::unique_ptr<Message>& msg, NodeID /*node*/) override {
+    Sent s{msg->type_ == MessageType::READ_CONTROL_BATCH, {}, {}};
+    auto record = [&](const Message& m) {
+      s.types.push_back(m.type_);
+      s.rsids.push_back(readStreamOf(m));
+    };
+    if (s.batch) {
+      for (const auto& embedded :
+           checked_downcast<READ_CONTROL_BATCH_Message&>(*msg).messages_) {
+        record(*embedded);
+      }
+    } else {
+      record(*msg);
+    }
+    sent.push_back(std::move(s));
+    msg.reset();
+    return 0;
+  }
+
+  bool isStale(NodeID /*node*/,
+               const ClientReadStreamControlEntry& /*entry*/) override {
+    return false;
+  }
+
+  void scheduleFlush() override {}
+};
+
+const ShardID N1S0(1, 0);
+
+START_Header startHeader(read_stream_id_t::raw_type rsid) {
+  START_Header header{};
+  header.log_id = logid_t(1);
+  header.read_stream_id = read_stream_id_t(rsid);
+  header.start_lsn = LSN_OLDEST;
+  header.until_lsn = LSN_MAX;
+  header.window_high = LSN_MAX;
+  header.filter_version = filter_version_t{1};
+  header.shard = N1S0.shard();
+  return header;
+}
+
+std::unique_ptr<Message> start(read_stream_id_t::raw_type rsid,
+                               ServerRecordFilterType filter_type =
+                                   ServerRecordFilterType::NOFILTER) {
+  ReadStreamAttributes attrs;
+  attrs.filter_type = filter_type;
+  return std::make_unique<START_Message>(
+      startHeader(rsid), small_shardset_t{}, &attrs);
+}
+
+std::unique_ptr<Message> window(read_stream_id_t::raw_type rsid) {
+  WINDOW_Header header;
+  header.log_id = logid_t(1);
+  header.read_stream_id = read_stream_id_t(rsid);
+  header.sliding_window.low = LSN_OLDEST;
+  header.sliding_window.high = LSN_MAX;
+  header.shard = N1S0.shard();
+  return std::make_unique<WINDOW_Message>(header);
+}
+
+std::unique_ptr<Message> stop(read_stream_id_t::raw_type rsid) {
+  STOP_Header header;
+  header.log_id = logid_t(1);
+  header.read_stream_id = read_stream_id_t(rsid);
+  header.shard = N1S0.shard();
+  return std::make_unique<STOP_Message>(header);
+}
+
+class ClientReadStreamControlBatcherTest : public ::testing::Test {
+ protected:
+  void enqueueAll() {
+    batcher_.enqueue(read_stream_id_t(1), N1S0, start(1));
+    batcher_.enqueue(read_stream_id_t(2),
+                     N1S0,
+                     start(2, ServerRecordFilterType::KEY_SET));
+    batcher_.enqueue(read_stream_id_t(1), N1S0, window(1));
+    batcher_.enqueue(read_stream_id_t(3), N1S0, stop(3));
+  }
+
+  AllClientReadStreams owner_;
+  MockClientReadStreamControlBatcher batcher_{owner_};
+};
+
+} // namespace
+
+// Messages of all types go out in one READ_CONTROL_BATCH, in order.
+TEST_F(ClientReadStreamControlBatcherTest, Batch) {
+  enqueueAll();
+  batcher_.flush();
+  ASSERT_EQ(1, batcher_.sent.size());
+  EXPECT_TRUE(batcher_.sent[0].batch);
+  EXPECT_EQ(std::vector<MessageType>({MessageType::START,
+                                      MessageType::START,
+                                      MessageType::WINDOW,
+                                      MessageType::STOP}),
+            batcher_.sent[0].types);
+  EXPECT_EQ(std::vector<read_stream_id_t>({read_stream_id_t(1),
+                                           read_stream_id_t(2),
+                                           read_stream_id_t(1),
+                                           read_stream_id_t(3)}),
+            batcher_.sent[0].rsids);
+}
+
+// A START whose filter the node's protocol doesn't support is sent on its own
+// instead of failing the batch of the other read streams.
+TEST_F(ClientReadStreamControlBatcherTest, UnsupportedMessageSentAlone) {
+  batcher_.proto = Compatibility::SERVER_RECORD_FILTER_KEY_SETS - 1;
+  enqueueAll();
+  batcher_.flush();
+  ASSERT_EQ(2, batcher_.sent.size());
+
+  EXPECT_FALSE(batcher_.sent[0].batch);
+  EXPECT_EQ(std::vector<read_stream_id_t>({read_stream_id_t(2)}),
+            batcher_.sent[0].rsids);
+
+  EXPECT_TRUE(batcher_.sent[1].batch);
+  EXPECT_EQ(std::vector<MessageType>({MessageType::START,
+                                      MessageType::WINDOW,
+                                      MessageType::STOP}),
+            batcher_.sent[1].types);
+  EXPECT_EQ(std::vector<read_stream_id_t>({read_stream_id_t(1),
+                                           read_stream_id_t(1),
+                                           read_stream_id_t(3)}),
+            batcher_.sent[1].rsids);
+}
@@ -23,6 +23,7 @@
 #include "logdevice/common/client_read_stream/ClientReadStreamBufferFactory.h"
 #include "logdevice/common/client_read_stream/ClientReadStreamConnectionHealth.h"
 #include "logdevice/common/client_read_stream/ClientReadStreamScd.h"
+#include "logdevice/common/client_read_stream/ClientReadStreamWindowController.h"
 #include "logdevice/common/configuration/Configuration.h"
 #include "logdevice/common/configuration/LocalLogsConfig.h"
 #include "logdevice/common/configuration/UpdateableConfig.h"
@@ -210,6 +211,11 @@ struct TestState {
   std::vector<CacheEntry> cache_entries_;
 
   bool has_memory_pressure = false;
+  // Payload bytes buffered by read streams, as reported through
+  // onBytesBufferedChanged()
+  int64_t bytes_buffered = 0;
+  // Returned by getCurrentTime()
+  std::chrono::steady_clock::time_point now{std::chrono::hours(1)};
   std::unordered_map<ShardID, ClientReadStreamSenderState, ShardID::Hash>*
       storage_set_states;
 };
@@ -373,7 +379,23 @@ class MockClientReadStreamDependencies : public ClientReadStreamDependencies {
   }
 
   bool hasMemoryPressure() const override {
-    return state_.has_memory_pressure;
+    // Tests either force memory pressure or configure a memory budget that
+    // the production logic checks against `bytes_buffered'.
+    return state_.has_memory_pressure ||
+        ClientReadStreamDependencies::hasMemoryPressure();
+  }
+
+  size_t getWorkerBytesBuffered() const override {
+    return static_cast<size_t>(state_.bytes_buffered);
+  }
+
+  void onBytesBufferedChanged(int64_t delta) override {
+    state_.bytes_buffered += delta;
+    EXPECT_GE(state_.bytes_buffered, 0);
+  }
+
+  std::chrono::steady_clock::time_point getCurrentTime() const override {
+    return state_.now;
   }
 
  private:
@@ -382,9 +404,9 @@ class MockClientReadStreamDependencies : public ClientReadStreamDependencies {
 };
 
 static std::unique_ptr<DataRecordOwnsPayload>
-mockRecord(lsn_t lsn, RECORD_flags_t flags = 0) {
-  std::chrono::milliseconds timestamp(0);
-
+mockRecord(lsn_t lsn,
+           RECORD_flags_t flags = 0,
+           std::chrono::milliseconds timestamp = std::chrono::milliseconds(0)) {
   static const char* data = "data";
   int payload_size = strlen(data);
   void* payload = malloc(payload_size);
@@ -584,6 +606,18 @@ class ClientReadStreamTest
     return read_stream_->connection_health_tracker_->stall_grace_period_.get();
   }
 
+  size_t getWindowSize() const {
+    return read_stream_->window_size_;
+  }
+
+  double getFlowControlThreshold() const {
+    return read_stream_->flow_control_threshold_;
+  }
+
+  const ClientReadStreamWindowController* getWindowController() const {
+    return read_stream_->window_controller_.get();
+  }
+
   bool isCurrentlyInSingleCopyDeliveryMode() const {
     return read_stream_->scd_ && read_stream_->scd_->isActive();
   }
@@ -872,7 +906,8 @@ INSTANTIATE_TEST_CASE_P(
     ClientReadStreamTest,
     ClientReadStreamTest,
     ::testing::Values(ClientReadStreamBufferType::CIRCULAR,
-                      ClientReadStreamBufferType::ORDERED_MAP));
+                      ClientReadStreamBufferType::ORDERED_MAP,
+                      ClientReadStreamBufferType::BITMAP));
 
 /**
  * Simple test where records come in order from different nodes.
@@ -1222,6 +1257,121 @@ TEST_P(ClientReadStreamTest, DynamicWindowScaling) {
   ASSERT_NO_WINDOW_MESSAGES();
 }
 
+/**
+ * With the adaptive window, the window is sized from the measured RTT to
+ * senders and the rate at which records are delivered.
+ */
+TEST_P(ClientReadStreamTest, AdaptiveWindowFollowsBdp) {
+  using std::chrono::milliseconds;
+  state_.shards.resize(4);
+  state_.settings.client_read_adaptive_window = true;
+  buffer_size_ = 1000;
+  flow_control_threshold_ = 0.7;
+  start();
+  ASSERT_NE(nullptr, getWindowController());
+  state_.start.clear();
+
+  // N0 uses up its whole window but lsn 1 is missing, so nothing can be
+  // delivered yet.
+  for (int i = 2; i <= 1000; ++i) {
+    onDataRecord(N0, mockRecord(lsn(1, i)));
+  }
+  ASSERT_RECV();
+  ASSERT_EQ(999 * 4, read_stream_->getBytesBuffered());
+  ASSERT_EQ(999 * 4, state_.bytes_buffered);
+
+  // Delivering everything slides the window.  Nothing was measured yet, so
+  // the window keeps its size.  N0 was blocked on the window, so the WINDOW
+  // message sent to it starts an RTT measurement.
+  onDataRecord(N1, mockRecord(lsn(1, 1)));
+  ASSERT_EQ(1000, state_.recv.size());
+  state_.recv.clear();
+  ASSERT_EQ(0, state_.bytes_buffered);
+  ASSERT_WINDOW_MESSAGES(lsn(1, 1001), lsn(1, 2000), N0, N1, N2, N3);
+  ASSERT_EQ(1000, getWindowSize());
+
+  // N0's next record arrives 100ms later.
+  state_.now += milliseconds(100);
+  onDataRecord(N0, mockRecord(lsn(1, 1001)));
+  ASSERT_RECV(lsn(1, 1001));
+  ASSERT_EQ(milliseconds(100), getWindowController()->getRtt());
+
+  // 700 records delivered in one second since the last slide: the
+  // bandwidth-delay product is 70 records.  The window targets 140 records
+  // but senders were already allowed to send up to lsn 2000, so it only
+  // shrinks as those records get delivered.
+  state_.now += milliseconds(900);
+  for (int i = 1002; i <= 1700; ++i) {
+    onDataRecord(N0, mockRecord(lsn(1, i)));
+  }
+  ASSERT_EQ(699, state_.recv.size());
+  state_.recv.clear();
+  ASSERT_DOUBLE_EQ(700, getWindowController()->getDrainRate());
+  ASSERT_EQ(300, getWindowSize());
+  ASSERT_NO_WINDOW_MESSAGES();
+
+  for (int i = 1701; i <= 1910; ++i) {
+    onDataRecord(N0, mockRecord(lsn(1, i)));
+  }
+  ASSERT_EQ(210, state_.recv.size());
+  state_.recv.clear();
+  ASSERT_EQ(140, getWindowSize());
+  ASSERT_WINDOW_MESSAGES(lsn(1, 1911), lsn(1, 2050), N0, N1, N2, N3);
+  // The window slides while one RTT worth of records is still left in it.
+  ASSERT_DOUBLE_EQ(0.5, getFlowControlThreshold());
+}
+
+/**
+ * With a memory budget, records buffered by the read stream count against
+ * the worker's share of the budget and shrink the adaptive window.  Bytes
+ * are accounted for until records are delivered or the stream goes away.
+ */
+TEST_P(ClientReadStreamTest, AdaptiveWindowMemoryBudget) {
+  state_.shards.resize(4);
+  state_.settings.client_read_adaptive_window = true;
+  state_.settings.num_workers = 1;
+  // 37 records of 4 bytes
+  state_.settings.client_readers_memory_budget = 150;
+  buffer_size_ = 100;
+  flow_control_threshold_ = 0.5;
+  start();
+
+  // Everything but lsn 51 arrives.
+  for (int i = 2; i <= 100; ++i) {
+    if (i != 51) {
+      onDataRecord(N0, mockRecord(lsn(1, i)));
+    }
+  }
+  ASSERT_EQ(98 * 4, read_stream_->getBytesBuffered());
+  ASSERT_EQ(98 * 4, state_.bytes_buffered);
+
+  // Records up to lsn 50 are delivered and the window slides while 49 records
+  // are still buffered, above the budget: the window is halved.  Senders
+  // may already send up to lsn 100, so no WINDOW message goes out.
+  onDataRecord(N1, mockRecord(lsn(1, 1)));
+  ASSERT_EQ(50, state_.recv.size());
+  state_.recv.clear();
+  ASSERT_EQ(49 * 4, state_.bytes_buffered);
+  ASSERT_EQ(50, getWindowSize());
+  ASSERT_NO_WINDOW_MESSAGES();
+
+  // Once the rest is delivered the buffer is empty and the window grows
+  // again, from its halved size.
+  onDataRecord(N1, mockRecord(lsn(1, 51)));
+  ASSERT_EQ(50, state_.recv.size());
+  state_.recv.clear();
+  ASSERT_EQ(0, state_.bytes_buffered);
+  ASSERT_EQ(51, getWindowSize());
+  ASSERT_WINDOW_MESSAGES(lsn(1, 101), lsn(1, 151), N0, N1, N2, N3);
+
+  // Bytes of records still buffered when the stream is destroyed are
+  // released.
+  onDataRecord(N0, mockRecord(lsn(1, 110)));
+  ASSERT_EQ(4, state_.bytes_buffered);
+  read_stream_.reset();
+  ASSERT_EQ(0, state_.bytes_buffered);
+}
+
 /**
  * Receiving the same LSN from the same node more than once should not be an
  * issue.  This can happen when:
@@ -7480,4 +7630,46 @@ TEST_P(ClientReadStreamTest, FilteredOutGapMixedWithOthers) {
   ASSERT_GAP_MESSAGES(GapMessage{GapType::FILTERED_OUT, lsn(1, 7), lsn(1, 7)});
 }
 
+/**
+ * With TIME_BUCKET sampling, storage nodes sample independently. Only the
+ * first record of a bucket is delivered, later ones are FILTERED_OUT gaps.
+ */
+TEST_P(ClientReadStreamTest, TimeBucketSampleDeliveredOnce) {
+  state_.shards.resize(2);
+  ReadStreamAttributes attrs;
+  attrs.sample_mode = ServerRecordSampleMode::TIME_BUCKET;
+  attrs.sample_param = 1000;
+  start(LOG_ID, &attrs);
+
+  using std::chrono::milliseconds;
+  onDataRecord(N0, mockRecord(lsn(1, 1), 0, milliseconds(1100)));
+  ASSERT_RECV(lsn(1, 1));
+  // N1 sampled the same bucket.
+  onDataRecord(N1, mockRecord(lsn(1, 2), 0, milliseconds(1500)));
+  ASSERT_RECV();
+  ASSERT_GAP_MESSAGES(GapMessage{GapType::FILTERED_OUT, lsn(1, 2), lsn(1, 2)});
+  onGap(N0, mockGap(N0, lsn(1, 3), lsn(1, 3), GapReason::FILTERED_OUT));
+  ASSERT_GAP_MESSAGES(GapMessage{GapType::FILTERED_OUT, lsn(1, 3), lsn(1, 3)});
+  onDataRecord(N1, mockRecord(lsn(1, 4), 0, milliseconds(2000)));
+  ASSERT_RECV(lsn(1, 4));
+  ASSERT_EQ(0, state_.bytes_buffered);
+}
+
+/**
+ * A sampled read stream does not read from shards whose protocol does not
+ * support sampling, rather than reading all of their records.
+ */
+TEST_P(ClientReadStreamTest, SampleNotSupported) {
+  ReadStreamAttributes attrs;
+  attrs.sample_mode = ServerRecordSampleMode::EVERY_NTH;
+  attrs.sample_param = 10;
+  start(LOG_ID, &attrs);
+  overrideConnectionStates(ConnectionState::CONNECTING, {N0});
+
+  state_.protos[N0.node()] = Compatibility::SERVER_SIDE_SAMPLING_SUPPORT - 1;
+  onStartSent(N0, E::PROTONOSUPPORT);
+  ASSERT_EQ(ConnectionState::PERSISTENT_ERROR,
+            state_.storage_set_states->at(N0).getConnectionState());
+}
+
 }} // namespace facebook::logdevice
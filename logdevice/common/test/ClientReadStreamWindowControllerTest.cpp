@@ -0,0 +1,85 @@
+/**
+ * Copyright (c) 2017-present, Facebook, Inc. and its affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+#include "logdevice/common/client_read_stream/ClientReadStreamWindowController.h"
+
+#include <chrono>
+
+#include <gtest/gtest.h>
+
+using namespace facebook::logdevice;
+using namespace std::chrono;
+
+namespace {
+
+using Controller = ClientReadStreamWindowController;
+
+Controller::Params params(size_t max_window, double threshold = 0.7) {
+  Controller::Params p;
+  p.min_window = 16;
+  p.max_window = max_window;
+  p.headroom = 2.0;
+  p.min_flow_control_threshold = 0.1;
+  p.max_flow_control_threshold = threshold;
+  return p;
+}
+
+Controller::Clock::time_point at(int64_t us) {
+  return Controller::Clock::time_point(microseconds(us));
+}
+
+} // namespace
+
+TEST(ClientReadStreamWindowControllerTest, NoSamples) {
+  Controller c(params(512));
+  EXPECT_EQ(microseconds::zero(), c.getRtt());
+  EXPECT_EQ(0, c.getDrainRate());
+  // Without measurements the window grows by one like the fixed window does.
+  EXPECT_EQ(101, c.computeWindowSize(100, false));
+  EXPECT_EQ(512, c.computeWindowSize(512, false));
+  EXPECT_EQ(0.7, c.computeFlowControlThreshold(512));
+}
+
+TEST(ClientReadStreamWindowControllerTest, MemoryPressureHalvesWindow) {
+  Controller c(params(512));
+  EXPECT_EQ(256, c.computeWindowSize(512, true));
+  EXPECT_EQ(16, c.computeWindowSize(20, true));
+}
+
+TEST(ClientReadStreamWindowControllerTest, RttIsMinOfRecentSamples) {
+  Controller c(params(512));
+  c.onRttSample(milliseconds(30));
+  c.onRttSample(milliseconds(10));
+  c.onRttSample(milliseconds(20));
+  EXPECT_EQ(milliseconds(10), c.getRtt());
+  // The 10ms sample falls out of the ring after enough newer samples.
+  for (int i = 0; i < 16; ++i) {
+    c.onRttSample(milliseconds(40));
+  }
+  EXPECT_EQ(milliseconds(40), c.getRtt());
+}
+
+TEST(ClientReadStreamWindowControllerTest, WindowFollowsBdp) {
+  Controller c(params(8192));
+  c.onRttSample(milliseconds(100));
+  // 1000 records per second.
+  c.onWindowSlide(0, at(0));
+  c.onWindowSlide(1000, at(1000000));
+  EXPECT_DOUBLE_EQ(1000, c.getDrainRate());
+  EXPECT_DOUBLE_EQ(100, c.getBdpRecords());
+  EXPECT_EQ(200, c.computeWindowSize(8192, false));
+  // Slide while one RTT worth of records is still left in the window.
+  EXPECT_DOUBLE_EQ(0.5, c.computeFlowControlThreshold(200));
+  // Bounded by the buffer capacity and the configured threshold range once
+  // the smoothed drain rate approaches 100k records per second.
+  for (int i = 1; i <= 10; ++i) {
+    c.onWindowSlide(1000 + i * 100000, at((i + 1) * 1000000));
+  }
+  EXPECT_GT(c.getDrainRate(), 90000);
+  EXPECT_EQ(8192, c.computeWindowSize(200, false));
+  EXPECT_EQ(0.1, c.computeFlowControlThreshold(8192));
+}
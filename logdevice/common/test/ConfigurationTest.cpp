@@ -245,6 +245,17 @@ TEST(ConfigurationTest, SimpleValid) {
       15.4,
       config->serverConfig()->getTracerSamplePercentage("appender").value());
 
+  const std::string tailer = "tailer";
+  auto principal = config->serverConfig()->getPrincipalByName(&tailer);
+  ASSERT_NE(nullptr, principal);
+  EXPECT_EQ(TrafficClass::READ_TAIL, principal->max_read_traffic_class);
+  EXPECT_EQ(4, principal->read_weight);
+  const std::string batch_reader = "batch_reader";
+  principal = config->serverConfig()->getPrincipalByName(&batch_reader);
+  ASSERT_NE(nullptr, principal);
+  EXPECT_EQ(9, principal->egress_dscp);
+  EXPECT_EQ(1, principal->read_weight);
+
   char buf[256];
 
   {
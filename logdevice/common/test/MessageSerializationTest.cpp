@@ -27,13 +27,17 @@
 #include "logdevice/common/protocol/MessageTypeNames.h"
 #include "logdevice/common/protocol/ProtocolReader.h"
 #include "logdevice/common/protocol/ProtocolWriter.h"
+#include "logdevice/common/protocol/READ_CONTROL_BATCH_Message.h"
 #include "logdevice/common/protocol/RECORD_Message.h"
+#include "logdevice/common/protocol/RELEASE_BATCH_Message.h"
+#include "logdevice/common/protocol/SEAL_BATCH_Message.h"
 #include "logdevice/common/protocol/SEALED_Message.h"
 #include "logdevice/common/protocol/SHUTDOWN_Message.h"
 #include "logdevice/common/protocol/START_Message.h"
 #include "logdevice/common/protocol/STARTED_Message.h"
 #include "logdevice/common/protocol/STOP_Message.h"
 #include "logdevice/common/protocol/STORE_Message.h"
+#include "logdevice/common/protocol/WINDOW_Message.h"
 #include "logdevice/common/protocol/GET_EPOCH_RECOVERY_METADATA_Message.h"
 #include "logdevice/common/protocol/GET_EPOCH_RECOVERY_METADATA_REPLY_Message.h"
 #include "logdevice/common/Metadata.h"
@@ -1430,6 +1434,178 @@ TEST_F(MessageSerializationTest, START_num_filtered_out) {
   }
 }
 
+TEST_F(MessageSerializationTest, READ_CONTROL_BATCH) {
+  START_Header start = {logid_t(0xDCC49E8FF44783D3),
+                        read_stream_id_t(0x8B49478D2C473B3A),
+                        lsn_t(5),
+                        lsn_t(13),
+                        lsn_t(8),
+                        START_Header::SINGLE_COPY_DELIVERY,
+                        0,
+                        filter_version_t(0x8B49478D2C473B3A),
+                        0,
+                        0,
+                        SCDCopysetReordering::NONE,
+                        shard_index_t{0}};
+  WINDOW_Header window = {logid_t(0xDCC49E8FF44783D3),
+                          read_stream_id_t(0x8B49478D2C473B3A),
+                          {lsn_t(9), lsn_t(16)},
+                          shard_index_t{1}};
+  STOP_Header stop = {logid_t(0xDCC49E8FF44783D3),
+                      read_stream_id_t(0x8B49478D2C473B3A),
+                      shard_index_t{2}};
+
+  READ_CONTROL_BATCH_Message m;
+  m.add(std::make_unique<START_Message>(start));
+  m.add(std::make_unique<WINDOW_Message>(window));
+  m.add(std::make_unique<STOP_Message>(stop));
+
+  auto check = [&](const READ_CONTROL_BATCH_Message& m2, uint16_t /*proto*/) {
+    ASSERT_EQ(3, m2.messages_.size());
+    ASSERT_EQ(MessageType::START, m2.messages_[0]->type_);
+    ASSERT_EQ(MessageType::WINDOW, m2.messages_[1]->type_);
+    ASSERT_EQ(MessageType::STOP, m2.messages_[2]->type_);
+    const auto& start2 =
+        checked_downcast<const START_Message&>(*m2.messages_[0]).header_;
+    ASSERT_EQ(start.log_id, start2.log_id);
+    ASSERT_EQ(start.read_stream_id, start2.read_stream_id);
+    ASSERT_EQ(start.start_lsn, start2.start_lsn);
+    ASSERT_EQ(start.until_lsn, start2.until_lsn);
+    ASSERT_EQ(start.window_high, start2.window_high);
+    ASSERT_EQ(start.flags, start2.flags);
+    ASSERT_EQ(start.shard, start2.shard);
+    const auto& window2 =
+        checked_downcast<const WINDOW_Message&>(*m2.messages_[1]).header_;
+    ASSERT_EQ(window.read_stream_id, window2.read_stream_id);
+    ASSERT_EQ(window.sliding_window.low, window2.sliding_window.low);
+    ASSERT_EQ(window.sliding_window.high, window2.sliding_window.high);
+    ASSERT_EQ(window.shard, window2.shard);
+    const auto& stop2 =
+        checked_downcast<const STOP_Message&>(*m2.messages_[2]).getHeader();
+    ASSERT_EQ(stop.read_stream_id, stop2.read_stream_id);
+    ASSERT_EQ(stop.shard, stop2.shard);
+  };
+
+  std::string expected =
+      "03000000" // number of messages
+      "74"       // START
+      "D38347F48F9EC4DC3A3B472C8D47498B05000000000000000D0000000000000"
+      "0080000000000000080000000"
+      "00003A3B472C8D47498B00"
+      "000000000000000000000000"
+      "0000000000000000000000000000000000"
+      "77"               // WINDOW
+      "D38347F48F9EC4DC" // log_id
+      "3A3B472C8D47498B" // read_stream_id
+      "0900000000000000" // sliding_window.low
+      "1000000000000000" // sliding_window.high
+      "0100"             // shard
+      "70"               // STOP
+      "D38347F48F9EC4DC" // log_id
+      "3A3B472C8D47498B" // read_stream_id
+      "0200";            // shard
+  DO_TEST(m,
+          check,
+          Compatibility::READ_CONTROL_BATCH_SUPPORT,
+          Compatibility::MAX_PROTOCOL_SUPPORTED,
+          [&](uint16_t /*proto*/) { return expected; },
+          nullptr);
+}
+
+TEST_F(MessageSerializationTest, RELEASE_BATCH) {
+  std::vector<RELEASE_Header> headers = {
+      {RecordID(esn_t(0x11223344), epoch_t(5), logid_t(0x0102030405060708)),
+       ReleaseType::GLOBAL,
+       shard_index_t{3}},
+      {RecordID(esn_t(7), epoch_t(0x8F9EC4DC), logid_t(42)),
+       ReleaseType::PER_EPOCH,
+       shard_index_t{0}}};
+  RELEASE_BATCH_Message m(headers);
+
+  auto check = [&](const RELEASE_BATCH_Message& m2, uint16_t /*proto*/) {
+    ASSERT_EQ(headers.size(), m2.headers_.size());
+    for (size_t i = 0; i < headers.size(); ++i) {
+      // RELEASE_Header is packed, compare copies of the fields.
+      RecordID rid = m2.headers_[i].rid;
+      ReleaseType release_type = m2.headers_[i].release_type;
+      shard_index_t shard = m2.headers_[i].shard;
+      EXPECT_EQ(RecordID(headers[i].rid), rid);
+      EXPECT_EQ(ReleaseType(headers[i].release_type), release_type);
+      EXPECT_EQ(shard_index_t(headers[i].shard), shard);
+    }
+  };
+
+  std::string expected = "02000000"         // number of releases
+                         "44332211"         // esn
+                         "05000000"         // epoch
+                         "0807060504030201" // log_id
+                         "00"               // GLOBAL
+                         "0300"             // shard
+                         "07000000"         // esn
+                         "DCC49E8F"         // epoch
+                         "2A00000000000000" // log_id
+                         "01"               // PER_EPOCH
+                         "0000";            // shard
+  DO_TEST(m,
+          check,
+          Compatibility::RELEASE_BATCH_SUPPORT,
+          Compatibility::MAX_PROTOCOL_SUPPORTED,
+          [&](uint16_t /*proto*/) { return expected; },
+          nullptr);
+}
+
+TEST_F(MessageSerializationTest, SEAL_BATCH) {
+  std::vector<SEAL_Header> headers(2);
+  headers[0].rqid = request_id_t(0x0102030405060708);
+  headers[0].log_id = logid_t(42);
+  headers[0].seal_epoch = epoch_t(5);
+  headers[0].last_clean_epoch = epoch_t(3);
+  headers[0].sealed_by = NodeID(2, 1);
+  headers[0].shard = 3;
+  headers[1].rqid = request_id_t(9);
+  headers[1].log_id = logid_t(0x1122334455667788);
+  headers[1].seal_epoch = epoch_t(0x8F9EC4DC);
+  headers[1].last_clean_epoch = epoch_t(0);
+  headers[1].sealed_by = NodeID(2, 1);
+  headers[1].shard = 0;
+  SEAL_BATCH_Message m(headers);
+
+  auto check = [&](const SEAL_BATCH_Message& m2, uint16_t /*proto*/) {
+    ASSERT_EQ(headers.size(), m2.headers_.size());
+    for (size_t i = 0; i < headers.size(); ++i) {
+      // SEAL_Header is packed, compare copies of the fields.
+      const SEAL_Header h = m2.headers_[i];
+      const SEAL_Header expected_h = headers[i];
+      EXPECT_EQ(expected_h.rqid, h.rqid);
+      EXPECT_EQ(expected_h.log_id, h.log_id);
+      EXPECT_EQ(expected_h.seal_epoch, h.seal_epoch);
+      EXPECT_EQ(expected_h.last_clean_epoch, h.last_clean_epoch);
+      EXPECT_EQ(expected_h.sealed_by, h.sealed_by);
+      EXPECT_EQ(expected_h.shard, h.shard);
+    }
+  };
+
+  std::string expected = "02000000"         // number of seals
+                         "0807060504030201" // rqid
+                         "2A00000000000000" // log_id
+                         "05000000"         // seal_epoch
+                         "03000000"         // last_clean_epoch
+                         "01000200"         // sealed_by
+                         "0300"             // shard
+                         "0900000000000000" // rqid
+                         "8877665544332211" // log_id
+                         "DCC49E8F"         // seal_epoch
+                         "00000000"         // last_clean_epoch
+                         "01000200"         // sealed_by
+                         "0000";            // shard
+  DO_TEST(m,
+          check,
+          Compatibility::SEAL_BATCH_SUPPORT,
+          Compatibility::MAX_PROTOCOL_SUPPORTED,
+          [&](uint16_t /*proto*/) { return expected; },
+          nullptr);
+}
+
 TEST_F(MessageSerializationTest, CLEAN) {
   CLEAN_Header h = {
       logid_t(0xBBC18E8AA44783D3),
@@ -0,0 +1,99 @@
+/**
+ * Copyright (c) 2017-present, Facebook, Inc. and its affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+#pragma once
+
+#include <map>
+#include <memory>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "logdevice/common/NodeMessageBatcher.h"
+#include "logdevice/include/Err.h"
+
+namespace facebook { namespace logdevice {
+
+/**
+ * @file A NodeMessageBatcher subclass (`Batcher') that records the messages
+ *       it would send and the headers of those that failed, and whose flush
+ *       is only ever called explicitly.  `Batcher' sends each Header as a
+ *       SingleMessage, which has getHeader(), or as part of a BatchMessage,
+ *       which keeps them in `headers_'.
+ */
+
+template <typename Batcher,
+          typename Header,
+          typename SingleMessage,
+          typename BatchMessage>
+class MockNodeMessageBatcher : public Batcher {
+ public:
+  struct Sent {
+    NodeID node;
+    // Headers of the message, a single one for SingleMessage.
+    std::vector<Header> headers;
+    bool batch;
+  };
+
+  struct Failed {
+    Header header;
+    Status st;
+    NodeID node;
+  };
+
+  // Protocol of each node with a handshaken connection.
+  std::map<NodeID, uint16_t> protocols;
+  // If set, sending fails with this error.
+  Status send_error = E::OK;
+
+  std::vector<Sent> sent;
+  std::vector<Failed> failed;
+  int flushes_scheduled = 0;
+
+ protected:
+  folly::Optional<uint16_t> getPeerProtocol(NodeID node) override {
+    auto it = protocols.find(node);
+    if (it == protocols.end()) {
+      return folly::none;
+    }
+    return it->second;
+  }
+
+  int sendMessage(std::unique_ptr<Message>& msg, NodeID node) override {
+    if (send_error != E::OK) {
+      err = send_error;
+      return -1;
+    }
+    if (auto* batch = dynamic_cast<BatchMessage*>(msg.get())) {
+      sent.push_back(Sent{node, batch->headers_, true});
+    } else {
+      auto* single = dynamic_cast<SingleMessage*>(msg.get());
+      EXPECT_NE(nullptr, single);
+      sent.push_back(Sent{node, {single->getHeader()}, false});
+    }
+    msg.reset();
+    return 0;
+  }
+
+  void onSendFailed(const Message& msg, Status st, NodeID node) override {
+    if (auto* batch = dynamic_cast<const BatchMessage*>(&msg)) {
+      for (const Header& header : batch->headers_) {
+        failed.push_back(Failed{header, st, node});
+      }
+    } else {
+      auto* single = dynamic_cast<const SingleMessage*>(&msg);
+      EXPECT_NE(nullptr, single);
+      failed.push_back(Failed{single->getHeader(), st, node});
+    }
+  }
+
+  void scheduleFlush() override {
+    ++flushes_scheduled;
+  }
+};
+
+}} // namespace facebook::logdevice
@@ -0,0 +1,207 @@
+/**
+ * Copyright (c) 2017-present, Facebook, Inc. and its affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+#include <map>
+
+#include <gtest/gtest.h>
+
+#include "logdevice/common/ReleaseBatcher.h"
+#include "logdevice/common/SealBatcher.h"
+#include "logdevice/common/protocol/Compatibility.h"
+#include "logdevice/common/protocol/RELEASE_BATCH_Message.h"
+#include "logdevice/common/protocol/SEAL_BATCH_Message.h"
+#include "logdevice/common/test/MockNodeMessageBatcher.h"
+
+using namespace facebook::logdevice;
+
+// Behaviour common to all NodeMessageBatchers, checked for each of them.
+// How headers of the same key are merged is tested in the test of each
+// subclass.
+
+namespace {
+
+struct ReleaseBatcherTraits {
+  using Mock = MockNodeMessageBatcher<ReleaseBatcher,
+                                      RELEASE_Header,
+                                      RELEASE_Message,
+                                      RELEASE_BATCH_Message>;
+  static uint16_t batchProtocol() {
+    return Compatibility::RELEASE_BATCH_SUPPORT;
+  }
+  static RELEASE_Header header(logid_t::raw_type log) {
+    return RELEASE_Header{
+        RecordID(esn_t(1), epoch_t(1), logid_t(log)), ReleaseType::GLOBAL, 0};
+  }
+  static logid_t logOf(const RELEASE_Header& header) {
+    return header.rid.logid;
+  }
+};
+
+struct SealBatcherTraits {
+  using Mock = MockNodeMessageBatcher<SealBatcher,
+                                      SEAL_Header,
+                                      SEAL_Message,
+                                      SEAL_BATCH_Message>;
+  static uint16_t batchProtocol() {
+    return Compatibility::SEAL_BATCH_SUPPORT;
+  }
+  static SEAL_Header header(logid_t::raw_type log) {
+    SEAL_Header header;
+    header.rqid = request_id_t(1);
+    header.log_id = logid_t(log);
+    header.seal_epoch = epoch_t(2);
+    header.last_clean_epoch = epoch_t(1);
+    header.sealed_by = NodeID(0, 1);
+    header.shard = 0;
+    return header;
+  }
+  static logid_t logOf(const SEAL_Header& header) {
+    return header.log_id;
+  }
+};
+
+// Batchers address nodes by index, see ShardID::asNodeID().
+const NodeID N1(1, 0);
+const NodeID N2(2, 0);
+
+template <typename Traits>
+class NodeMessageBatcherTest : public ::testing::Test {
+ protected:
+  using Mock = typename Traits::Mock;
+
+  NodeMessageBatcherTest() {
+    batcher_.protocols[N1] = Compatibility::MAX_PROTOCOL_SUPPORTED;
+    batcher_.protocols[N2] = Compatibility::MAX_PROTOCOL_SUPPORTED;
+  }
+
+  // Queues a header of log `log' for shard 0 of `node'.  Headers of different
+  // logs are never merged.
+  void enqueue(NodeID node, logid_t::raw_type log) {
+    batcher_.enqueue(ShardID(node.index(), 0), Traits::header(log));
+  }
+
+  Mock batcher_;
+};
+
+using Batchers = ::testing::Types<ReleaseBatcherTraits, SealBatcherTraits>;
+TYPED_TEST_CASE(NodeMessageBatcherTest, Batchers);
+
+} // namespace
+
+// Headers to a node go out in one batch message at the flush, in the order
+// they were queued; a lone header goes out as a single message.
+TYPED_TEST(NodeMessageBatcherTest, OneBatchPerNode) {
+  auto& batcher = this->batcher_;
+  this->enqueue(N1, 1);
+  this->enqueue(N1, 2);
+  this->enqueue(N1, 3);
+  this->enqueue(N2, 4);
+  EXPECT_TRUE(batcher.sent.empty());
+  EXPECT_GT(batcher.flushes_scheduled, 0);
+
+  batcher.flush();
+  ASSERT_EQ(2, batcher.sent.size());
+  std::map<NodeID, size_t> by_node;
+  for (size_t i = 0; i < batcher.sent.size(); ++i) {
+    by_node[batcher.sent[i].node] = i;
+  }
+  const auto& n1 = batcher.sent[by_node.at(N1)];
+  EXPECT_TRUE(n1.batch);
+  ASSERT_EQ(3, n1.headers.size());
+  for (size_t i = 0; i < 3; ++i) {
+    EXPECT_EQ(logid_t(i + 1), TypeParam::logOf(n1.headers[i]));
+  }
+  const auto& n2 = batcher.sent[by_node.at(N2)];
+  EXPECT_FALSE(n2.batch);
+  ASSERT_EQ(1, n2.headers.size());
+  EXPECT_EQ(logid_t(4), TypeParam::logOf(n2.headers[0]));
+
+  // Nothing left.
+  batcher.sent.clear();
+  batcher.flush();
+  EXPECT_TRUE(batcher.sent.empty());
+  EXPECT_TRUE(batcher.failed.empty());
+}
+
+// A node's batch is sent as soon as it is full, without waiting for the flush.
+TYPED_TEST(NodeMessageBatcherTest, MaxBatchSize) {
+  using Mock = typename TypeParam::Mock;
+  auto& batcher = this->batcher_;
+  for (size_t i = 1; i <= Mock::MAX_BATCH_SIZE + 1; ++i) {
+    this->enqueue(N1, i);
+  }
+  this->enqueue(N2, 1);
+  ASSERT_EQ(1, batcher.sent.size());
+  EXPECT_TRUE(batcher.sent[0].batch);
+  EXPECT_EQ(N1, batcher.sent[0].node);
+  EXPECT_EQ(Mock::MAX_BATCH_SIZE, batcher.sent[0].headers.size());
+
+  batcher.flush();
+  ASSERT_EQ(3, batcher.sent.size());
+  for (size_t i = 1; i < 3; ++i) {
+    ASSERT_EQ(1, batcher.sent[i].headers.size());
+    if (batcher.sent[i].node == N1) {
+      EXPECT_EQ(logid_t(Mock::MAX_BATCH_SIZE + 1),
+                TypeParam::logOf(batcher.sent[i].headers[0]));
+    }
+  }
+}
+
+// Nodes on a protocol older than the batch message's, or without a
+// handshaken connection, get single messages.
+TYPED_TEST(NodeMessageBatcherTest, FallBackToSingleMessages) {
+  auto& batcher = this->batcher_;
+  batcher.protocols[N1] = TypeParam::batchProtocol() - 1;
+  batcher.protocols.erase(N2);
+  for (NodeID node : {N1, N2}) {
+    this->enqueue(node, 1);
+    this->enqueue(node, 2);
+  }
+  batcher.flush();
+  ASSERT_EQ(4, batcher.sent.size());
+  for (const auto& s : batcher.sent) {
+    EXPECT_FALSE(s.batch);
+    EXPECT_EQ(1, s.headers.size());
+  }
+}
+
+// When a message can't be sent, each of its headers is reported as failed.
+TYPED_TEST(NodeMessageBatcherTest, SendFailure) {
+  auto& batcher = this->batcher_;
+  batcher.send_error = E::NOBUFS;
+  batcher.protocols.erase(N2);
+  this->enqueue(N1, 1);
+  this->enqueue(N1, 2);
+  this->enqueue(N2, 3);
+  this->enqueue(N2, 4);
+  batcher.flush();
+  EXPECT_TRUE(batcher.sent.empty());
+
+  ASSERT_EQ(4, batcher.failed.size());
+  std::map<logid_t, NodeID> by_log;
+  for (const auto& f : batcher.failed) {
+    EXPECT_EQ(E::NOBUFS, f.st);
+    by_log[TypeParam::logOf(f.header)] = f.node;
+  }
+  ASSERT_EQ(4, by_log.size());
+  EXPECT_EQ(N1, by_log[logid_t(1)]);
+  EXPECT_EQ(N1, by_log[logid_t(2)]);
+  EXPECT_EQ(N2, by_log[logid_t(3)]);
+  EXPECT_EQ(N2, by_log[logid_t(4)]);
+}
+
+// clear() drops queued headers.
+TYPED_TEST(NodeMessageBatcherTest, Clear) {
+  auto& batcher = this->batcher_;
+  this->enqueue(N1, 1);
+  this->enqueue(N1, 2);
+  this->enqueue(N2, 3);
+  batcher.clear();
+  batcher.flush();
+  EXPECT_TRUE(batcher.sent.empty());
+  EXPECT_TRUE(batcher.failed.empty());
+}
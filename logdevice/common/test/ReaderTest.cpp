@@ -16,12 +16,19 @@
 #include <thread>
 
 #include <folly/Memory.h>
+#include <folly/Varint.h>
+#include <zstd.h>
 
 #include "logdevice/common/DataRecordOwnsPayload.h"
 #include "logdevice/common/LibeventTimer.h"
 #include "logdevice/common/ReaderImpl.h"
+#include "logdevice/common/buffered_writer/BufferedWriteDecoderImpl.h"
+#include "logdevice/common/client_read_stream/ClientReadStreamBufferFactory.h"
+#include "logdevice/common/settings/Settings.h"
+#include "logdevice/common/settings/UpdateableSettings.h"
 #include "logdevice/common/types_internal.h"
 #include "logdevice/common/test/TestUtil.h"
+#include "logdevice/include/BufferedWriter.h"
 #include "logdevice/include/Client.h"
 #include "logdevice/include/Reader.h"
 
@@ -121,6 +128,45 @@ static std::unique_ptr<DataRecordOwnsPayload> make_record(logid_t log_id,
       (RECORD_flags_t)0);
 }
 
+// Makes a record holding a ZSTD-compressed BufferedWriter blob of `payloads'.
+// If `corrupt', the uncompressed size in the header is wrong.
+static std::unique_ptr<DataRecordOwnsPayload>
+make_buffered_record(logid_t log_id,
+                     lsn_t lsn,
+                     const std::vector<std::string>& payloads,
+                     bool corrupt = false) {
+  uint8_t varint[folly::kMaxVarintLength64];
+  std::string body;
+  for (const std::string& payload : payloads) {
+    body.append((const char*)varint,
+                folly::encodeVarint(payload.size(), varint));
+    body += payload;
+  }
+  std::string compressed(ZSTD_compressBound(body.size()), '\0');
+  size_t len = ZSTD_compress(
+      &compressed[0], compressed.size(), body.data(), body.size(), 1);
+  EXPECT_FALSE(ZSTD_isError(len));
+  compressed.resize(len);
+
+  std::string blob = std::string("\xb1") +
+      char(BufferedWriteDecoderImpl::Flags::SIZE_INCLUDED |
+           (uint8_t)BufferedWriter::Options::Compression::ZSTD);
+  blob.append((const char*)varint,
+              folly::encodeVarint(payloads.size(), varint));
+  blob.append((const char*)varint,
+              folly::encodeVarint(body.size() + corrupt, varint));
+  blob += compressed;
+
+  void* buf = malloc(blob.size());
+  memcpy(buf, blob.data(), blob.size());
+  return std::make_unique<DataRecordOwnsPayload>(
+      log_id,
+      Payload(buf, blob.size()),
+      lsn,
+      std::chrono::milliseconds(0),
+      RECORD_flags_t(RECORD_Header::BUFFERED_WRITER_BLOB));
+}
+
 /**
  * Simple test where we simulate ClientReadStream putting a few records on the
  * Reader's queue and then read() them
@@ -290,6 +336,77 @@ TEST_F(ReaderTestSingleLog, Gap) {
   ASSERT_STREQ("record 8", (const char*)records_out[2]->payload.data());
 }
 
+/**
+ * readBatch() should deliver the same records as read(), laid out in a
+ * columnar RecordBatch, and stop at gaps just like read().
+ */
+TEST_F(ReaderTestSingleLog, ReadBatch) {
+  RecordBatch batch;
+  GapRecord gap_out;
+
+  bridge_->onDataRecord(rsid_, make_record(LOG_ID, lsn_t(1)), false);
+  bridge_->onDataRecord(rsid_, make_record(LOG_ID, lsn_t(2)), false);
+  bridge_->onGapRecord(
+      rsid_, GapRecord(LOG_ID, GapType::DATALOSS, lsn_t(3), lsn_t(3)), false);
+  bridge_->onDataRecord(rsid_, make_record(LOG_ID, lsn_t(4)), false);
+
+  reader_->setTimeout(std::chrono::milliseconds::zero());
+
+  ssize_t nread;
+  nread = reader_->readBatch(100, &batch, &gap_out);
+  ASSERT_EQ(2, nread);
+  ASSERT_EQ(2, batch.size());
+  ASSERT_EQ(LOG_ID, batch.logid(0));
+  ASSERT_EQ(lsn_t(1), batch.lsn(0));
+  ASSERT_EQ(lsn_t(2), batch.lsn(1));
+  ASSERT_LT(batch.timestamp(0), batch.timestamp(1));
+  ASSERT_EQ(200, batch.payloadBytes());
+  ASSERT_EQ(std::vector<int>({0, 0}), batch.batchOffsets());
+  ASSERT_EQ(100, batch.payload(1).size());
+  ASSERT_STREQ("record 1", (const char*)batch.payload(0).data());
+  ASSERT_STREQ("record 2", (const char*)batch.payload(1).data());
+
+  nread = reader_->readBatch(100, &batch, &gap_out);
+  ASSERT_EQ(-1, nread);
+  ASSERT_EQ(E::GAP, err);
+  ASSERT_EQ(lsn_t(3), gap_out.lo);
+  ASSERT_TRUE(batch.empty());
+
+  // Reusing the batch clears the previous contents
+  nread = reader_->readBatch(100, &batch, &gap_out);
+  ASSERT_EQ(1, nread);
+  ASSERT_EQ(1, batch.size());
+  ASSERT_EQ(lsn_t(4), batch.lsn(0));
+  ASSERT_STREQ("record 4", (const char*)batch.payload(0).data());
+}
+
+/**
+ * The default Reader::readBatch(), implemented on top of read(), should
+ * deliver the same batch as ReaderImpl's.
+ */
+TEST_F(ReaderTestSingleLog, ReadBatchDefaultImplementation) {
+  RecordBatch batch;
+  GapRecord gap_out;
+
+  bridge_->onDataRecord(rsid_, make_record(LOG_ID, lsn_t(1)), false);
+  bridge_->onDataRecord(rsid_, make_record(LOG_ID, lsn_t(2)), false);
+  bridge_->onGapRecord(
+      rsid_, GapRecord(LOG_ID, GapType::DATALOSS, lsn_t(3), lsn_t(3)), false);
+
+  reader_->setTimeout(std::chrono::milliseconds::zero());
+
+  ssize_t nread = reader_->Reader::readBatch(100, &batch, &gap_out);
+  ASSERT_EQ(2, nread);
+  ASSERT_EQ(std::vector<lsn_t>({lsn_t(1), lsn_t(2)}), batch.lsns());
+  ASSERT_EQ(200, batch.payloadBytes());
+  ASSERT_STREQ("record 2", (const char*)batch.payload(1).data());
+
+  nread = reader_->Reader::readBatch(100, &batch, &gap_out);
+  ASSERT_EQ(-1, nread);
+  ASSERT_EQ(E::GAP, err);
+  ASSERT_TRUE(batch.empty());
+}
+
 /**
  * If a client stops reading a log, any buffered records should be discarded
  */
@@ -317,6 +434,34 @@ TEST_F(ReaderTestSingleLog, StopReading) {
   ASSERT_EQ(0, nread);
 }
 
+/**
+ * Sampling parameters that can't be used for the sampling mode (N == 0, zero
+ * bucket width) are rejected by startReading() instead of silently reading
+ * every record.
+ */
+TEST(ReaderTest, InvalidSampleParam) {
+  auto reader = TestReader::create(2, 100);
+  ReadStreamAttributes attrs;
+  attrs.sample_mode = ServerRecordSampleMode::EVERY_NTH;
+  attrs.sample_param = 0;
+  ASSERT_EQ(-1, reader->startReading(logid_t(1), lsn_t(1), LSN_MAX, &attrs));
+  ASSERT_EQ(E::INVALID_PARAM, err);
+
+  attrs.sample_mode = ServerRecordSampleMode::TIME_BUCKET;
+  ASSERT_EQ(-1, reader->startReading(logid_t(1), lsn_t(1), LSN_MAX, &attrs));
+  ASSERT_EQ(E::INVALID_PARAM, err);
+  ASSERT_FALSE(reader->isReadingAny());
+
+  attrs.sample_param = 1000;
+  ASSERT_EQ(0, reader->startReading(logid_t(1), lsn_t(1), LSN_MAX, &attrs));
+
+  // Any parameter goes when not sampling
+  attrs.sample_mode = ServerRecordSampleMode::NONE;
+  attrs.sample_param = 0;
+  ASSERT_EQ(0, reader->startReading(logid_t(2), lsn_t(1), LSN_MAX, &attrs));
+  ASSERT_FALSE(isValidSampleParam(ServerRecordSampleMode::MAX, 1));
+}
+
 /**
  * There was a bug where stopReading() could cause a read with a timeout to
  * hang.
@@ -349,6 +494,84 @@ TEST(ReaderTest, StopReadingTimeout) {
   ASSERT_EQ(0, nread);
 }
 
+/**
+ * With decode parallelism, all buffered writes ready in the queue are decoded
+ * at once.  Records, DATALOSS gaps for malformed blobs and the entries that
+ * follow must come out in queue order, like with sequential decoding.
+ */
+TEST_F(ReaderTestSingleLog, ParallelDecode) {
+  reader_->setDecodeParallelism(4);
+  for (int i = 1; i <= 3; ++i) {
+    bridge_->onDataRecord(
+        rsid_,
+        make_buffered_record(LOG_ID,
+                             lsn_t(i),
+                             {std::to_string(i) + "a" + std::string(100, 'x'),
+                              std::to_string(i) + "b" + std::string(100, 'y')}),
+        false);
+  }
+  bridge_->onDataRecord(
+      rsid_, make_buffered_record(LOG_ID, lsn_t(4), {"c"}, true), false);
+  bridge_->onDataRecord(rsid_, make_record(LOG_ID, lsn_t(5)), false);
+
+  reader_->setTimeout(std::chrono::milliseconds::zero());
+  std::vector<std::unique_ptr<DataRecord>> records_out;
+  GapRecord gap_out;
+
+  ssize_t nread = reader_->read(100, &records_out, &gap_out);
+  ASSERT_EQ(6, nread);
+  for (int i = 0; i < 6; ++i) {
+    const DataRecord& record = *records_out[i];
+    EXPECT_EQ(lsn_t(i / 2 + 1), record.attrs.lsn);
+    EXPECT_EQ(i % 2, record.attrs.batch_offset);
+    EXPECT_EQ(std::to_string(i / 2 + 1) + (i % 2 ? "b" : "a") +
+                  std::string(100, i % 2 ? 'y' : 'x'),
+              record.payload.toString());
+  }
+  // Records own their payloads, decoded payloads stay valid after the
+  // records they were decoded with are freed
+  records_out.erase(records_out.begin(), records_out.begin() + 3);
+  EXPECT_EQ(std::string("3b") + std::string(100, 'y'),
+            records_out.back()->payload.toString());
+  records_out.clear();
+
+  nread = reader_->read(100, &records_out, &gap_out);
+  ASSERT_EQ(-1, nread);
+  ASSERT_EQ(E::GAP, err);
+  ASSERT_EQ(GapType::DATALOSS, gap_out.type);
+  ASSERT_EQ(lsn_t(4), gap_out.lo);
+  ASSERT_EQ(lsn_t(4), gap_out.hi);
+
+  nread = reader_->read(100, &records_out, &gap_out);
+  ASSERT_EQ(1, nread);
+  ASSERT_EQ(lsn_t(5), records_out[0]->attrs.lsn);
+}
+
+/**
+ * Readers create read streams with the buffer type picked by the
+ * client-read-buffer-type setting.
+ */
+TEST(ReaderTest, BufferTypeSetting) {
+  Settings settings = create_default_settings<Settings>();
+  {
+    auto processor = make_test_processor(settings);
+    ReaderImpl reader(1, -1, processor.get(), nullptr, nullptr);
+    EXPECT_EQ(ClientReadStreamBufferType::CIRCULAR, reader.getBufferType());
+  }
+
+  UpdateableSettings<Settings> bitmap_settings(
+      {{"client-read-buffer-type", "bitmap"}});
+  ASSERT_EQ(ClientReadStreamBufferType::BITMAP,
+            bitmap_settings->client_read_buffer_type);
+  auto processor = make_test_processor(*bitmap_settings.get());
+  ReaderImpl reader(1, -1, processor.get(), nullptr, nullptr);
+  EXPECT_EQ(ClientReadStreamBufferType::BITMAP, reader.getBufferType());
+
+  // setBufferType() still overrides the setting
+  reader.setBufferType(ClientReadStreamBufferType::ORDERED_MAP);
+  EXPECT_EQ(ClientReadStreamBufferType::ORDERED_MAP, reader.getBufferType());
+}
+
 /**
  * If a client restarts reading a log (at a different LSN, say), any buffered
  * records should be discarded
@@ -573,4 +796,144 @@ INSTANTIATE_TEST_CASE_P(MultipleProducers,
                         ReaderTestBlockingStress,
                         ::testing::Values(4, 16));
 
+static std::unique_ptr<DataRecordOwnsPayload>
+make_record_at(logid_t log_id, lsn_t lsn, std::chrono::milliseconds ts) {
+  auto record = make_record(log_id, lsn);
+  record->attrs.timestamp = ts;
+  return record;
+}
+
+/**
+ * Fixture that sets up a reader merging two logs by timestamp
+ */
+class ReaderTestMerge : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    dbg::assertOnData = true;
+    reader_ = TestReader::create(2, 100);
+    reader_->mergeByTimestamp(WINDOW);
+    auto* test_reader = dynamic_cast<TestReader*>(reader_.get());
+    bridge_ = test_reader->getBridge();
+    EXPECT_EQ(0, reader_->startReading(LOG1, lsn_t(1), LSN_MAX));
+    rsid1_ = test_reader->getLastReadStreamID();
+    EXPECT_EQ(0, reader_->startReading(LOG2, lsn_t(1), LSN_MAX));
+    rsid2_ = test_reader->getLastReadStreamID();
+    reader_->setTimeout(std::chrono::milliseconds::zero());
+  }
+
+  std::vector<int64_t> readTimestamps(size_t nrecords) {
+    std::vector<std::unique_ptr<DataRecord>> records_out;
+    GapRecord gap_out;
+    ssize_t nread = reader_->read(nrecords, &records_out, &gap_out);
+    EXPECT_EQ(records_out.size(), static_cast<size_t>(nread));
+    std::vector<int64_t> ts;
+    for (const auto& record : records_out) {
+      ts.push_back(record->attrs.timestamp.count());
+    }
+    return ts;
+  }
+
+  const std::chrono::milliseconds WINDOW{1000};
+  const logid_t LOG1{333}, LOG2{444};
+  std::unique_ptr<ReaderImpl> reader_;
+  ReaderBridge* bridge_;
+  read_stream_id_t rsid1_, rsid2_;
+};
+
+/**
+ * Records of both logs come out in timestamp order.  The newest record is
+ * held back as long as the other log may still produce an earlier one.
+ */
+TEST_F(ReaderTestMerge, Basic) {
+  using std::chrono::milliseconds;
+  bridge_->onDataRecord(
+      rsid1_, make_record_at(LOG1, lsn_t(1), milliseconds(10)), false);
+  bridge_->onDataRecord(
+      rsid1_, make_record_at(LOG1, lsn_t(2), milliseconds(30)), false);
+  bridge_->onDataRecord(
+      rsid2_, make_record_at(LOG2, lsn_t(1), milliseconds(20)), false);
+  bridge_->onDataRecord(
+      rsid2_, make_record_at(LOG2, lsn_t(2), milliseconds(40)), false);
+
+  ASSERT_EQ(std::vector<int64_t>({10, 20, 30}), readTimestamps(100));
+  ASSERT_EQ(std::vector<int64_t>(), readTimestamps(100));
+
+  // Once LOG1 has something newer, 40 can be delivered.
+  bridge_->onDataRecord(
+      rsid1_, make_record_at(LOG1, lsn_t(3), milliseconds(50)), false);
+  ASSERT_EQ(std::vector<int64_t>({40}), readTimestamps(100));
+
+  // Stopping LOG1 releases the records of LOG2.
+  bridge_->onDataRecord(
+      rsid2_, make_record_at(LOG2, lsn_t(3), milliseconds(60)), false);
+  ASSERT_EQ(0, reader_->stopReading(LOG1));
+  ASSERT_EQ(std::vector<int64_t>({60}), readTimestamps(100));
+}
+
+/**
+ * A record is delivered without waiting for the other log once a record
+ * newer by more than the window was seen, and gaps are not held back.
+ */
+TEST_F(ReaderTestMerge, OutOfOrdernessWindow) {
+  using std::chrono::milliseconds;
+  bridge_->onDataRecord(
+      rsid1_, make_record_at(LOG1, lsn_t(1), milliseconds(100)), false);
+  bridge_->onDataRecord(
+      rsid1_, make_record_at(LOG1, lsn_t(2), milliseconds(200)), false);
+  ASSERT_EQ(std::vector<int64_t>(), readTimestamps(100));
+
+  bridge_->onDataRecord(
+      rsid1_, make_record_at(LOG1, lsn_t(3), milliseconds(100 + 1500)), false);
+  ASSERT_EQ(std::vector<int64_t>({100, 200}), readTimestamps(100));
+
+  bridge_->onGapRecord(
+      rsid2_, GapRecord(LOG2, GapType::BRIDGE, lsn_t(1), lsn_t(5)), false);
+  std::vector<std::unique_ptr<DataRecord>> records_out;
+  GapRecord gap_out;
+  ASSERT_EQ(-1, reader_->read(100, &records_out, &gap_out));
+  ASSERT_EQ(E::GAP, err);
+  ASSERT_EQ(LOG2, gap_out.logid);
+  ASSERT_EQ(lsn_t(5), gap_out.hi);
+}
+
+/**
+ * A blocking read() does not wait for an idle log for longer than the
+ * window.
+ */
+TEST_F(ReaderTestMerge, IdleLog) {
+  using namespace std::chrono;
+  bridge_->onDataRecord(
+      rsid1_, make_record_at(LOG1, lsn_t(1), milliseconds(100)), false);
+
+  reader_->setTimeout(seconds(30));
+  Alarm alarm(seconds(10));
+  auto tstart = steady_clock::now();
+  ASSERT_EQ(std::vector<int64_t>({100}), readTimestamps(1));
+  auto elapsed = steady_clock::now() - tstart;
+  ASSERT_GE(duration_cast<milliseconds>(elapsed).count(), WINDOW.count() / 2);
+}
+
+/**
+ * readBatch() merges the same way.
+ */
+TEST_F(ReaderTestMerge, ReadBatch) {
+  using std::chrono::milliseconds;
+  for (int i = 0; i < 3; ++i) {
+    bridge_->onDataRecord(
+        rsid1_, make_record_at(LOG1, lsn_t(i + 1), milliseconds(2 * i)), false);
+    bridge_->onDataRecord(
+        rsid2_,
+        make_record_at(LOG2, lsn_t(i + 1), milliseconds(2 * i + 1)),
+        false);
+  }
+  RecordBatch batch;
+  GapRecord gap_out;
+  ASSERT_EQ(5, reader_->readBatch(100, &batch, &gap_out));
+  ASSERT_EQ(5, batch.size());
+  for (size_t i = 0; i < batch.size(); ++i) {
+    EXPECT_EQ(static_cast<int64_t>(i), batch.timestamp(i).count());
+    EXPECT_EQ(i % 2 ? LOG2 : LOG1, batch.logid(i));
+  }
+}
+
 }} // namespace facebook::logdevice
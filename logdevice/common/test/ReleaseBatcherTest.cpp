@@ -0,0 +1,69 @@
+/**
+ * Copyright (c) 2017-present, Facebook, Inc. and its affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+#include <gtest/gtest.h>
+
+#include "logdevice/common/ReleaseBatcher.h"
+#include "logdevice/common/protocol/Compatibility.h"
+#include "logdevice/common/protocol/RELEASE_BATCH_Message.h"
+#include "logdevice/common/test/MockNodeMessageBatcher.h"
+
+using namespace facebook::logdevice;
+
+// Batching itself is tested in NodeMessageBatcherTest.
+
+namespace {
+
+using MockReleaseBatcher = MockNodeMessageBatcher<ReleaseBatcher,
+                                                  RELEASE_Header,
+                                                  RELEASE_Message,
+                                                  RELEASE_BATCH_Message>;
+
+RELEASE_Header release(logid_t::raw_type log,
+                       esn_t::raw_type esn,
+                       shard_index_t shard = 0,
+                       ReleaseType type = ReleaseType::GLOBAL) {
+  return RELEASE_Header{
+      RecordID(esn_t(esn), epoch_t(1), logid_t(log)), type, shard};
+}
+
+// ReleaseBatcher addresses nodes by index, see ShardID::asNodeID().
+const NodeID N1(1, 0);
+
+} // namespace
+
+// Releases of the same log, shard and type are coalesced into the one with
+// the highest LSN, in the position of the first one queued.  Releases that
+// differ in any of these are kept apart.
+TEST(ReleaseBatcherTest, Coalescing) {
+  MockReleaseBatcher batcher;
+  batcher.protocols[N1] = Compatibility::MAX_PROTOCOL_SUPPORTED;
+  auto enqueue = [&](const RELEASE_Header& header) {
+    batcher.enqueue(ShardID(N1.index(), header.shard), header);
+  };
+  enqueue(release(1, 10));
+  enqueue(release(1, 12));
+  enqueue(release(1, 11));
+  enqueue(release(1, 5, 1));
+  enqueue(release(1, 7, 0, ReleaseType::PER_EPOCH));
+  enqueue(release(2, 3));
+
+  batcher.flush();
+  ASSERT_EQ(1, batcher.sent.size());
+  EXPECT_TRUE(batcher.sent[0].batch);
+  const std::vector<RELEASE_Header>& headers = batcher.sent[0].headers;
+  ASSERT_EQ(4, headers.size());
+  EXPECT_EQ(RecordID(esn_t(12), epoch_t(1), logid_t(1)), headers[0].rid);
+  EXPECT_EQ(ReleaseType::GLOBAL, headers[0].release_type);
+  EXPECT_EQ(0, headers[0].shard);
+  EXPECT_EQ(esn_t(5), headers[1].rid.esn);
+  EXPECT_EQ(1, headers[1].shard);
+  EXPECT_EQ(esn_t(7), headers[2].rid.esn);
+  EXPECT_EQ(ReleaseType::PER_EPOCH, headers[2].release_type);
+  EXPECT_EQ(logid_t(2), headers[3].rid.logid);
+  EXPECT_TRUE(batcher.failed.empty());
+}
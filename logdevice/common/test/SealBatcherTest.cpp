@@ -0,0 +1,78 @@
+/**
+ * Copyright (c) 2017-present, Facebook, Inc. and its affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+#include <gtest/gtest.h>
+
+#include "logdevice/common/SealBatcher.h"
+#include "logdevice/common/protocol/Compatibility.h"
+#include "logdevice/common/protocol/SEAL_BATCH_Message.h"
+#include "logdevice/common/test/MockNodeMessageBatcher.h"
+
+using namespace facebook::logdevice;
+
+// Batching itself is tested in NodeMessageBatcherTest.
+
+namespace {
+
+using MockSealBatcher = MockNodeMessageBatcher<SealBatcher,
+                                               SEAL_Header,
+                                               SEAL_Message,
+                                               SEAL_BATCH_Message>;
+
+SEAL_Header seal(logid_t::raw_type log,
+                 epoch_t::raw_type epoch,
+                 request_id_t::raw_type rqid,
+                 shard_index_t shard = 0) {
+  SEAL_Header header;
+  header.rqid = request_id_t(rqid);
+  header.log_id = logid_t(log);
+  header.seal_epoch = epoch_t(epoch);
+  header.last_clean_epoch = epoch_t(epoch - 1);
+  header.sealed_by = NodeID(0, 1);
+  header.shard = shard;
+  return header;
+}
+
+// SealBatcher addresses nodes by index, see ShardID::asNodeID().
+const NodeID N1(1, 0);
+
+} // namespace
+
+// A retried SEAL of a log and shard replaces the queued one, in its position,
+// unless it is for a lower epoch.  SEALs of other logs or shards are kept
+// apart.
+TEST(SealBatcherTest, HighestEpochWins) {
+  MockSealBatcher batcher;
+  batcher.protocols[N1] = Compatibility::MAX_PROTOCOL_SUPPORTED;
+  auto enqueue = [&](const SEAL_Header& header) {
+    batcher.enqueue(ShardID(N1.index(), header.shard), header);
+  };
+  enqueue(seal(1, 5, 1));
+  enqueue(seal(1, 7, 2));
+  // Stale, must not replace epoch 7.
+  enqueue(seal(1, 6, 3));
+  enqueue(seal(1, 5, 4, 1));
+  enqueue(seal(2, 5, 5));
+  // Retry for the same epoch replaces the queued one.
+  enqueue(seal(2, 5, 6));
+
+  batcher.flush();
+  ASSERT_EQ(1, batcher.sent.size());
+  EXPECT_TRUE(batcher.sent[0].batch);
+  const std::vector<SEAL_Header>& headers = batcher.sent[0].headers;
+  ASSERT_EQ(3, headers.size());
+  EXPECT_EQ(logid_t(1), headers[0].log_id);
+  EXPECT_EQ(0, headers[0].shard);
+  EXPECT_EQ(epoch_t(7), headers[0].seal_epoch);
+  EXPECT_EQ(request_id_t(2), headers[0].rqid);
+  EXPECT_EQ(logid_t(1), headers[1].log_id);
+  EXPECT_EQ(1, headers[1].shard);
+  EXPECT_EQ(request_id_t(4), headers[1].rqid);
+  EXPECT_EQ(logid_t(2), headers[2].log_id);
+  EXPECT_EQ(request_id_t(6), headers[2].rqid);
+  EXPECT_TRUE(batcher.failed.empty());
+}
@@ -0,0 +1,59 @@
+/**
+ * Copyright (c) 2017-present, Facebook, Inc. and its affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+#include "logdevice/common/ServerRecordFilterEncoding.h"
+
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+using namespace facebook::logdevice;
+
+TEST(ServerRecordFilterEncodingTest, KeySetRoundTrip) {
+  std::vector<folly::StringPiece> decoded;
+  const std::string empty = ServerRecordFilterEncoding::encodeKeySet({});
+  ASSERT_TRUE(ServerRecordFilterEncoding::decodeKeySet(empty, &decoded));
+  EXPECT_TRUE(decoded.empty());
+
+  std::string long_key(300, 'x');
+  const std::string encoded = ServerRecordFilterEncoding::encodeKeySet(
+      {"b", "a", "", long_key, "b", std::string("\0z", 2)});
+  ASSERT_TRUE(ServerRecordFilterEncoding::decodeKeySet(encoded, &decoded));
+  std::vector<std::string> keys(decoded.begin(), decoded.end());
+  EXPECT_EQ(std::vector<std::string>(
+                {"", std::string("\0z", 2), "a", "b", long_key}),
+            keys);
+
+  // Truncated.
+  EXPECT_FALSE(ServerRecordFilterEncoding::decodeKeySet(
+      folly::StringPiece(encoded).subpiece(0, encoded.size() - 1), &decoded));
+}
+
+TEST(ServerRecordFilterEncodingTest, BloomFilter) {
+  std::vector<std::string> keys;
+  for (int i = 0; i < 500; ++i) {
+    keys.push_back("tenant" + std::to_string(i));
+  }
+  const std::string filter = ServerRecordFilterEncoding::buildBloomFilter(keys);
+  ASSERT_TRUE(ServerRecordFilterEncoding::isValidBloomFilter(filter));
+  for (const std::string& key : keys) {
+    EXPECT_TRUE(ServerRecordFilterEncoding::bloomFilterMayContain(filter, key));
+  }
+  int false_positives = 0;
+  for (int i = 500; i < 10500; ++i) {
+    false_positives += ServerRecordFilterEncoding::bloomFilterMayContain(
+        filter, "tenant" + std::to_string(i));
+  }
+  // About 1% with 10 bits per key.
+  EXPECT_LT(false_positives, 300);
+
+  EXPECT_FALSE(ServerRecordFilterEncoding::isValidBloomFilter(""));
+  EXPECT_FALSE(ServerRecordFilterEncoding::isValidBloomFilter("\x01"));
+  EXPECT_FALSE(
+      ServerRecordFilterEncoding::isValidBloomFilter(std::string("\0ab", 3)));
+}
@@ -0,0 +1,234 @@
+/**
+ * Copyright (c) 2017-present, Facebook, Inc. and its affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+#include <folly/Benchmark.h>
+#include <folly/Varint.h>
+#include <gflags/gflags.h>
+#include <zstd.h>
+
+#include "logdevice/common/DataRecordOwnsPayload.h"
+#include "logdevice/common/buffered_writer/BufferedWriteDecoderImpl.h"
+#include "logdevice/common/protocol/RECORD_Message.h"
+
+using namespace facebook::logdevice;
+
+/**
+ * @file Benchmark of the client-side decoding of uncompressed BufferedWriter
+ *       batches, as done by AsyncReader, comparing the copying
+ *       decodeOne(const DataRecord&) with decodeOneShared(), which shares
+ *       ownership of the received payload buffer.
+ *
+ *       Each iteration decodes one batch of --batch_size records of
+ *       --payload_size bytes, so MB/s per core follows from the time per
+ *       iteration.  main() also prints the number of operator new calls per
+ *       decoded record for both variants.
+ *
+ *       The DecodeZstd benchmarks compare decode() of --records_per_decode
+ *       ZSTD-compressed batches on the calling thread with decode() using
+ *       --parallelism threads.
+ *
+ *       Run with --bm_min_usec=1000000.
+ */
+
+DEFINE_int32(payload_size, 200, "Size of each record in the batch.");
+DEFINE_int32(batch_size, 100, "Number of records in each batch.");
+DEFINE_int32(records_per_decode,
+             16,
+             "Number of compressed batches passed to each decode() call.");
+DEFINE_int32(parallelism, 4, "Parallelism of the parallel decoder.");
+
+static std::atomic<uint64_t> n_allocations{0};
+
+void* operator new(size_t size) {
+  n_allocations.fetch_add(1, std::memory_order_relaxed);
+  void* p = malloc(size);
+  if (!p) {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+void operator delete(void* p) noexcept {
+  free(p);
+}
+
+namespace {
+
+std::string makeBlob() {
+  std::string blob;
+  blob.push_back('\xb1');
+  blob.push_back(BufferedWriteDecoderImpl::Flags::SIZE_INCLUDED);
+  uint8_t varint[folly::kMaxVarintLength64];
+  size_t len = folly::encodeVarint(FLAGS_batch_size, varint);
+  blob.append((const char*)varint, len);
+  for (int i = 0; i < FLAGS_batch_size; ++i) {
+    len = folly::encodeVarint(FLAGS_payload_size, varint);
+    blob.append((const char*)varint, len);
+    blob.append(FLAGS_payload_size, 'x');
+  }
+  return blob;
+}
+
+std::unique_ptr<DataRecordOwnsPayload> makeRecord(const std::string& blob) {
+  void* buf = malloc(blob.size());
+  memcpy(buf, blob.data(), blob.size());
+  return std::make_unique<DataRecordOwnsPayload>(
+      logid_t(1),
+      Payload(buf, blob.size()),
+      lsn_t(1),
+      std::chrono::milliseconds(0),
+      RECORD_flags_t(RECORD_Header::BUFFERED_WRITER_BLOB));
+}
+
+template <typename DecodeFn>
+void run(unsigned int iters, DecodeFn decode) {
+  std::string blob;
+  std::vector<std::unique_ptr<DataRecordOwnsPayload>> records;
+  BENCHMARK_SUSPEND {
+    blob = makeBlob();
+    for (unsigned int i = 0; i < iters; ++i) {
+      records.push_back(makeRecord(blob));
+    }
+  }
+  std::vector<Payload> payloads;
+  for (auto& record : records) {
+    auto decoder = std::make_shared<BufferedWriteDecoderImpl>();
+    payloads.clear();
+    int rv = decode(*decoder, *record, payloads);
+    ld_check(rv == 0);
+    folly::doNotOptimizeAway(payloads.data());
+  }
+  BENCHMARK_SUSPEND {
+    records.clear();
+  }
+}
+
+int decodeCopy(BufferedWriteDecoderImpl& decoder,
+               DataRecordOwnsPayload& record,
+               std::vector<Payload>& payloads) {
+  return decoder.decodeOne(record, payloads);
+}
+
+int decodeShared(BufferedWriteDecoderImpl& decoder,
+                 DataRecordOwnsPayload& record,
+                 std::vector<Payload>& payloads) {
+  return decoder.decodeOneShared(record, payloads);
+}
+
+// Same batch as makeBlob(), compressed with ZSTD.  Payloads are made
+// somewhat compressible but not trivially so.
+std::string makeZstdBlob() {
+  uint8_t varint[folly::kMaxVarintLength64];
+  std::string body;
+  uint64_t x = 0x9e3779b97f4a7c15ull;
+  for (int i = 0; i < FLAGS_batch_size; ++i) {
+    body.append((const char*)varint,
+                folly::encodeVarint(FLAGS_payload_size, varint));
+    for (int j = 0; j < FLAGS_payload_size; ++j) {
+      x ^= x << 13;
+      x ^= x >> 7;
+      x ^= x << 17;
+      body.push_back('a' + x % 8);
+    }
+  }
+  std::string compressed(ZSTD_compressBound(body.size()), '\0');
+  size_t len = ZSTD_compress(
+      &compressed[0], compressed.size(), body.data(), body.size(), 3);
+  ld_check(!ZSTD_isError(len));
+  compressed.resize(len);
+
+  std::string blob;
+  blob.push_back('\xb1');
+  blob.push_back(BufferedWriteDecoderImpl::Flags::SIZE_INCLUDED |
+                 (uint8_t)Compression::ZSTD);
+  blob.append((const char*)varint,
+              folly::encodeVarint(FLAGS_batch_size, varint));
+  blob.append((const char*)varint, folly::encodeVarint(body.size(), varint));
+  return blob + compressed;
+}
+
+void runZstd(unsigned int iters, size_t parallelism) {
+  std::string blob;
+  std::vector<std::vector<std::unique_ptr<DataRecord>>> calls;
+  BENCHMARK_SUSPEND {
+    blob = makeZstdBlob();
+    calls.resize(iters);
+    for (auto& records : calls) {
+      for (int i = 0; i < FLAGS_records_per_decode; ++i) {
+        records.push_back(makeRecord(blob));
+      }
+    }
+  }
+  std::vector<Payload> payloads;
+  for (auto& records : calls) {
+    BufferedWriteDecoderImpl decoder(parallelism);
+    payloads.clear();
+    int rv = decoder.decode(std::move(records), payloads);
+    ld_check(rv == 0);
+    folly::doNotOptimizeAway(payloads.data());
+  }
+}
+
+template <typename DecodeFn>
+double allocationsPerRecord(DecodeFn decode) {
+  const std::string blob = makeBlob();
+  const int nbatches = 1000;
+  uint64_t total = 0;
+  std::vector<Payload> payloads;
+  payloads.reserve(FLAGS_batch_size);
+  for (int i = 0; i < nbatches; ++i) {
+    auto record = makeRecord(blob);
+    uint64_t before = n_allocations.load();
+    {
+      auto decoder = std::make_shared<BufferedWriteDecoderImpl>();
+      payloads.clear();
+      decode(*decoder, *record, payloads);
+    }
+    total += n_allocations.load() - before;
+  }
+  return double(total) / (double(nbatches) * FLAGS_batch_size);
+}
+
+} // namespace
+
+BENCHMARK(DecodeCopy, iters) {
+  run(iters, decodeCopy);
+}
+
+BENCHMARK_RELATIVE(DecodeShared, iters) {
+  run(iters, decodeShared);
+}
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK(DecodeZstdSequential, iters) {
+  runZstd(iters, 1);
+}
+
+BENCHMARK_RELATIVE(DecodeZstdParallel, iters) {
+  runZstd(iters, FLAGS_parallelism);
+}
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  folly::runBenchmarks();
+  std::cout << "allocations per record, copy:   "
+            << allocationsPerRecord(decodeCopy) << std::endl;
+  std::cout << "allocations per record, shared: "
+            << allocationsPerRecord(decodeShared) << std::endl;
+  return 0;
+}
@@ -0,0 +1,150 @@
+/**
+ * Copyright (c) 2017-present, Facebook, Inc. and its affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+#include <memory>
+
+#include <folly/Benchmark.h>
+#include <gflags/gflags.h>
+
+#include "logdevice/common/DataRecordOwnsPayload.h"
+#include "logdevice/common/LibeventTimer.h"
+#include "logdevice/common/client_read_stream/ClientReadStream.h"
+#include "logdevice/common/client_read_stream/ClientReadStreamBufferFactory.h"
+
+using namespace facebook::logdevice;
+
+/**
+ * @file Benchmark comparing the ClientReadStreamBuffer implementations
+ *       (circular, ordered map, bitmap) on the operations ClientReadStream
+ *       performs on a large, sparsely filled buffer: looking for the first
+ *       marker, clearing a range with forEachUpto() and advancing the buffer
+ *       head past it.
+ *
+ *       Run with --bm_min_usec=1000000.
+ */
+
+DEFINE_int32(buffer_capacity, 16384, "Capacity of the buffer in records.");
+DEFINE_int32(marker_stride,
+             64,
+             "Distance in LSNs between consecutive markers in the buffer.");
+
+namespace {
+
+std::unique_ptr<ClientReadStreamBuffer>
+makeBuffer(ClientReadStreamBufferType type) {
+  return ClientReadStreamBufferFactory::create(
+      type, FLAGS_buffer_capacity, lsn_t(1));
+}
+
+// findFirstMarker() on a buffer whose only marker is in its last slot, as
+// happens when records beyond a gap arrived before the gap was resolved.
+void findFirstMarker(unsigned int iters, ClientReadStreamBufferType type) {
+  std::unique_ptr<ClientReadStreamBuffer> buf;
+  BENCHMARK_SUSPEND {
+    buf = makeBuffer(type);
+    buf->createOrGet(buf->maxLSNToAccept())->gap = true;
+  }
+  for (unsigned int i = 0; i < iters; ++i) {
+    folly::doNotOptimizeAway(buf->findFirstMarker());
+  }
+}
+
+// Fast-forwarding over gaps: each iteration finds the next marker, which is
+// `marker_stride' LSNs ahead, clears everything up to it and advances the
+// buffer head past it, refilling one marker at the far end of the buffer.
+// --marker_stride should divide --buffer_capacity.
+void slide(unsigned int iters, ClientReadStreamBufferType type) {
+  std::unique_ptr<ClientReadStreamBuffer> buf;
+  const size_t stride = FLAGS_marker_stride;
+  BENCHMARK_SUSPEND {
+    buf = makeBuffer(type);
+    for (lsn_t lsn = buf->getBufferHead() + stride - 1;
+         lsn <= buf->maxLSNToAccept();
+         lsn += stride) {
+      buf->createOrGet(lsn)->gap = true;
+    }
+  }
+  for (unsigned int i = 0; i < iters; ++i) {
+    auto marker = buf->findFirstMarker();
+    ld_check(marker.first);
+    buf->forEachUpto(
+        marker.second, [](lsn_t, ClientReadStreamRecordState& rstate) {
+          rstate.gap = false;
+        });
+    buf->advanceBufferHead(marker.second - buf->getBufferHead());
+    buf->popFront();
+    buf->advanceBufferHead(1);
+    buf->createOrGet(buf->maxLSNToAccept())->gap = true;
+  }
+}
+
+// clear() of a buffer holding one marker per `marker_stride' slots, as done
+// on every rewind.
+void clear(unsigned int iters, ClientReadStreamBufferType type) {
+  std::unique_ptr<ClientReadStreamBuffer> buf;
+  BENCHMARK_SUSPEND {
+    buf = makeBuffer(type);
+  }
+  for (unsigned int i = 0; i < iters; ++i) {
+    BENCHMARK_SUSPEND {
+      for (lsn_t lsn = buf->getBufferHead();
+           lsn <= buf->maxLSNToAccept();
+           lsn += FLAGS_marker_stride) {
+        buf->createOrGet(lsn)->gap = true;
+      }
+    }
+    buf->clear();
+  }
+}
+
+} // namespace
+
+BENCHMARK(FindFirstMarkerCircular, iters) {
+  findFirstMarker(iters, ClientReadStreamBufferType::CIRCULAR);
+}
+
+BENCHMARK_RELATIVE(FindFirstMarkerOrderedMap, iters) {
+  findFirstMarker(iters, ClientReadStreamBufferType::ORDERED_MAP);
+}
+
+BENCHMARK_RELATIVE(FindFirstMarkerBitmap, iters) {
+  findFirstMarker(iters, ClientReadStreamBufferType::BITMAP);
+}
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK(SlideCircular, iters) {
+  slide(iters, ClientReadStreamBufferType::CIRCULAR);
+}
+
+BENCHMARK_RELATIVE(SlideOrderedMap, iters) {
+  slide(iters, ClientReadStreamBufferType::ORDERED_MAP);
+}
+
+BENCHMARK_RELATIVE(SlideBitmap, iters) {
+  slide(iters, ClientReadStreamBufferType::BITMAP);
+}
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK(ClearCircular, iters) {
+  clear(iters, ClientReadStreamBufferType::CIRCULAR);
+}
+
+BENCHMARK_RELATIVE(ClearOrderedMap, iters) {
+  clear(iters, ClientReadStreamBufferType::ORDERED_MAP);
+}
+
+BENCHMARK_RELATIVE(ClearBitmap, iters) {
+  clear(iters, ClientReadStreamBufferType::BITMAP);
+}
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  folly::runBenchmarks();
+  return 0;
+}
@@ -0,0 +1,196 @@
+/**
+ * Copyright (c) 2017-present, Facebook, Inc. and its affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <vector>
+
+#include <folly/Benchmark.h>
+#include <gflags/gflags.h>
+
+#include "logdevice/common/DataRecordOwnsPayload.h"
+#include "logdevice/common/LibeventTimer.h"
+#include "logdevice/common/client_read_stream/ClientReadStream.h"
+#include "logdevice/common/client_read_stream/ClientReadStreamBufferFactory.h"
+#include "logdevice/common/client_read_stream/ClientReadStreamSenderState.h"
+
+using namespace facebook::logdevice;
+
+/**
+ * @file Measures the per-stream memory of the parts of ClientReadStream that
+ *       dominate the footprint of a client reading a very large number of
+ *       mostly idle logs: the record buffer and the per-sender state.  Prints
+ *       the heap bytes per object before and after
+ *       ClientReadStreamBuffer::releaseMemoryIfEmpty(), then benchmarks the
+ *       cost of reallocating a released buffer when records start flowing
+ *       again.
+ *
+ *       Run with --bm_min_usec=1000000.
+ */
+
+DEFINE_int32(buffer_capacity, 512, "Capacity of the buffer in records.");
+DEFINE_int32(num_objects, 10000, "Number of objects to measure.");
+
+namespace {
+std::atomic<size_t> allocated_bytes{0};
+} // namespace
+
+// Keeps track of the number of live heap bytes in allocated_bytes.
+void* operator new(size_t size) {
+  void* p = std::malloc(size + sizeof(max_align_t));
+  if (!p) {
+    throw std::bad_alloc();
+  }
+  *static_cast<size_t*>(p) = size;
+  allocated_bytes += size;
+  return static_cast<char*>(p) + sizeof(max_align_t);
+}
+
+void operator delete(void* p) noexcept {
+  if (!p) {
+    return;
+  }
+  void* base = static_cast<char*>(p) - sizeof(max_align_t);
+  allocated_bytes -= *static_cast<size_t*>(base);
+  std::free(base);
+}
+
+void* operator new[](size_t size) {
+  return operator new(size);
+}
+
+void operator delete[](void* p) noexcept {
+  operator delete(p);
+}
+
+namespace {
+
+std::unique_ptr<ClientReadStreamBuffer>
+makeBuffer(ClientReadStreamBufferType type) {
+  return ClientReadStreamBufferFactory::create(
+      type, FLAGS_buffer_capacity, lsn_t(1));
+}
+
+const char* typeName(ClientReadStreamBufferType type) {
+  switch (type) {
+    case ClientReadStreamBufferType::CIRCULAR:
+      return "circular";
+    case ClientReadStreamBufferType::ORDERED_MAP:
+      return "ordered map";
+    case ClientReadStreamBufferType::BITMAP:
+      return "bitmap";
+  }
+  return "unknown";
+}
+
+void reportBufferMemory(ClientReadStreamBufferType type) {
+  const size_t n = FLAGS_num_objects;
+  std::vector<std::unique_ptr<ClientReadStreamBuffer>> bufs;
+  bufs.reserve(n);
+  const size_t base = allocated_bytes;
+  for (size_t i = 0; i < n; ++i) {
+    bufs.push_back(makeBuffer(type));
+  }
+  const size_t created = allocated_bytes - base;
+  // A stream that received one record, delivered it and went idle.
+  for (auto& buf : bufs) {
+    buf->createOrGet(buf->getBufferHead());
+    buf->advanceBufferHead(1);
+  }
+  const size_t used = allocated_bytes - base;
+  for (auto& buf : bufs) {
+    buf->releaseMemoryIfEmpty();
+  }
+  const size_t released = allocated_bytes - base;
+  printf("%-12s buffer: %8zu bytes when created, %8zu after use, "
+         "%8zu after releaseMemoryIfEmpty()\n",
+         typeName(type),
+         created / n,
+         used / n,
+         released / n);
+}
+
+void reportSenderStateMemory() {
+  const size_t n = FLAGS_num_objects;
+  const size_t base = allocated_bytes;
+  std::vector<std::unique_ptr<ClientReadStreamSenderState>> states;
+  states.reserve(n);
+  const size_t reserved = allocated_bytes - base;
+  for (size_t i = 0; i < n; ++i) {
+    // Timers are only created once activated, which needs an owner.
+    states.push_back(std::make_unique<ClientReadStreamSenderState>(
+        nullptr, ShardID(i, 0)));
+  }
+  printf("sender state: %8zu bytes without timers (sizeof %zu)\n",
+         (allocated_bytes - base - reserved) / n,
+         sizeof(ClientReadStreamSenderState));
+}
+
+// Cost of the first createOrGet() after the buffer memory was released,
+// i.e. of a stream becoming active again.
+void reallocate(unsigned int iters, ClientReadStreamBufferType type) {
+  std::unique_ptr<ClientReadStreamBuffer> buf;
+  BENCHMARK_SUSPEND {
+    buf = makeBuffer(type);
+  }
+  for (unsigned int i = 0; i < iters; ++i) {
+    buf->createOrGet(buf->getBufferHead());
+    BENCHMARK_SUSPEND {
+      buf->advanceBufferHead(1);
+      buf->releaseMemoryIfEmpty();
+    }
+  }
+}
+
+// Same without releasing, for reference.
+void reuse(unsigned int iters, ClientReadStreamBufferType type) {
+  std::unique_ptr<ClientReadStreamBuffer> buf;
+  BENCHMARK_SUSPEND {
+    buf = makeBuffer(type);
+  }
+  for (unsigned int i = 0; i < iters; ++i) {
+    buf->createOrGet(buf->getBufferHead());
+    BENCHMARK_SUSPEND {
+      buf->advanceBufferHead(1);
+    }
+  }
+}
+
+} // namespace
+
+BENCHMARK(ReuseCircular, iters) {
+  reuse(iters, ClientReadStreamBufferType::CIRCULAR);
+}
+
+BENCHMARK_RELATIVE(ReallocateCircular, iters) {
+  reallocate(iters, ClientReadStreamBufferType::CIRCULAR);
+}
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK(ReuseBitmap, iters) {
+  reuse(iters, ClientReadStreamBufferType::BITMAP);
+}
+
+BENCHMARK_RELATIVE(ReallocateBitmap, iters) {
+  reallocate(iters, ClientReadStreamBufferType::BITMAP);
+}
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  for (auto type : {ClientReadStreamBufferType::CIRCULAR,
+                    ClientReadStreamBufferType::ORDERED_MAP,
+                    ClientReadStreamBufferType::BITMAP}) {
+    reportBufferMemory(type);
+  }
+  reportSenderStateMemory();
+  folly::runBenchmarks();
+  return 0;
+}
@@ -0,0 +1,201 @@
+/**
+ * Copyright (c) 2017-present, Facebook, Inc. and its affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include <folly/Benchmark.h>
+#include <gflags/gflags.h>
+
+#include "logdevice/common/DataRecordOwnsPayload.h"
+#include "logdevice/common/ReaderImpl.h"
+#include "logdevice/include/RecordBatch.h"
+
+using namespace facebook::logdevice;
+
+/**
+ * @file Benchmark of the Reader returned by
+ *       Client::createTimestampMergingReader() against a plain Reader.
+ *       Producer threads stand in for the workers running ClientReadStreams
+ *       and push records of their share of the logs onto the reader's queue,
+ *       retrying when it is full, while the benchmark thread drains it with
+ *       readBatch().  Varying the number of logs and of producer threads
+ *       shows how the merge scales with both.
+ *
+ *       Run with --bm_min_usec=1000000.
+ */
+
+DEFINE_int32(buffer_size, 128, "Read buffer size of each log.");
+DEFINE_int32(batch_size, 1024, "Number of records per readBatch() call.");
+DEFINE_int32(payload_size, 100, "Payload size in bytes.");
+DEFINE_int32(window_ms, 1000, "Out-of-orderness window of the merge.");
+DEFINE_int32(timestamp_jitter_ms,
+             50,
+             "Maximum difference between the timestamps of records of "
+             "different logs with the same LSN.");
+
+namespace facebook { namespace logdevice {
+
+// Same as the reader used by ReaderTest, pretends to start and stop
+// ClientReadStreams without a Processor.
+class TestReader : public ReaderImpl {
+ public:
+  explicit TestReader(size_t max_logs)
+      : ReaderImpl(max_logs, nullptr, nullptr, nullptr, "", FLAGS_buffer_size) {
+    destructor_stops_reading_ = false;
+  }
+
+  read_stream_id_t getLastReadStreamID() const {
+    return last_issued_rsid_;
+  }
+
+  ReaderBridge* getBridge() {
+    return bridge_.get();
+  }
+
+ protected:
+  int startReadingImpl(logid_t /*log_id*/,
+                       lsn_t /*from*/,
+                       lsn_t /*until*/,
+                       ReadingHandle* handle_out,
+                       const ReadStreamAttributes* /*attrs*/) override {
+    last_issued_rsid_.val_ = ++next_rsid_;
+    handle_out->read_stream_id = last_issued_rsid_;
+    handle_out->worker_id.val_ = -2; // should never be used
+    return 0;
+  }
+
+  int postStopReadingRequest(ReadingHandle /*handle*/,
+                             std::function<void()> cb) override {
+    if (cb) {
+      cb();
+    }
+    return 0;
+  }
+
+ private:
+  read_stream_id_t::raw_type next_rsid_{0};
+  read_stream_id_t last_issued_rsid_{READ_STREAM_ID_INVALID};
+};
+
+}} // namespace facebook::logdevice
+
+namespace {
+
+std::unique_ptr<DataRecordOwnsPayload>
+makeRecord(logid_t log_id, lsn_t lsn, std::chrono::milliseconds timestamp) {
+  void* buf = malloc(FLAGS_payload_size);
+  memset(buf, 'x', FLAGS_payload_size);
+  return std::make_unique<DataRecordOwnsPayload>(
+      log_id,
+      Payload(buf, FLAGS_payload_size),
+      lsn,
+      timestamp,
+      (RECORD_flags_t)0);
+}
+
+// Reads a total of about `iters' records from `nlogs' logs filled by
+// `nthreads' producer threads.
+void readLogs(unsigned int iters, size_t nlogs, size_t nthreads, bool merge) {
+  std::unique_ptr<TestReader> reader;
+  std::vector<read_stream_id_t> rsids;
+  const lsn_t records_per_log = std::max<lsn_t>(1, iters / nlogs);
+  BENCHMARK_SUSPEND {
+    reader = std::make_unique<TestReader>(nlogs);
+    if (merge) {
+      reader->mergeByTimestamp(std::chrono::milliseconds(FLAGS_window_ms));
+    }
+    reader->setTimeout(std::chrono::milliseconds(100));
+    for (size_t i = 0; i < nlogs; ++i) {
+      int rv = reader->startReading(logid_t(i + 1), lsn_t(1), records_per_log);
+      ld_check(rv == 0);
+      rsids.push_back(reader->getLastReadStreamID());
+    }
+  }
+
+  ReaderBridge* bridge = reader->getBridge();
+  std::vector<std::thread> producers;
+  for (size_t t = 0; t < nthreads; ++t) {
+    producers.emplace_back([&, t] {
+      std::minstd_rand rng(t);
+      std::uniform_int_distribution<int> jitter(0, FLAGS_timestamp_jitter_ms);
+      for (lsn_t lsn = 1; lsn <= records_per_log; ++lsn) {
+        for (size_t i = t; i < nlogs; i += nthreads) {
+          auto record = makeRecord(logid_t(i + 1),
+                                   lsn,
+                                   std::chrono::milliseconds(
+                                       lsn * FLAGS_window_ms + jitter(rng)));
+          while (bridge->onDataRecord(rsids[i], std::move(record), false) !=
+                 0) {
+            // The queue is full, like a ClientReadStream whose window is
+            // exhausted.
+            std::this_thread::yield();
+          }
+        }
+      }
+    });
+  }
+
+  RecordBatch batch;
+  GapRecord gap;
+  size_t nread = 0;
+  while (reader->isReadingAny()) {
+    ssize_t n = reader->readBatch(FLAGS_batch_size, &batch, &gap);
+    if (n > 0) {
+      nread += n;
+    }
+  }
+  folly::doNotOptimizeAway(nread);
+
+  BENCHMARK_SUSPEND {
+    for (auto& producer : producers) {
+      producer.join();
+    }
+    reader.reset();
+  }
+}
+
+void plain(unsigned int iters, size_t nlogs, size_t nthreads) {
+  readLogs(iters, nlogs, nthreads, false);
+}
+
+void merged(unsigned int iters, size_t nlogs, size_t nthreads) {
+  readLogs(iters, nlogs, nthreads, true);
+}
+
+} // namespace
+
+BENCHMARK_NAMED_PARAM(plain, 16_logs_1_thread, 16, 1)
+BENCHMARK_RELATIVE_NAMED_PARAM(merged, 16_logs_1_thread, 16, 1)
+BENCHMARK_RELATIVE_NAMED_PARAM(merged, 16_logs_4_threads, 16, 4)
+BENCHMARK_RELATIVE_NAMED_PARAM(merged, 16_logs_16_threads, 16, 16)
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK_NAMED_PARAM(plain, 256_logs_1_thread, 256, 1)
+BENCHMARK_RELATIVE_NAMED_PARAM(merged, 256_logs_1_thread, 256, 1)
+BENCHMARK_RELATIVE_NAMED_PARAM(merged, 256_logs_4_threads, 256, 4)
+BENCHMARK_RELATIVE_NAMED_PARAM(merged, 256_logs_16_threads, 256, 16)
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK_NAMED_PARAM(plain, 4096_logs_1_thread, 4096, 1)
+BENCHMARK_RELATIVE_NAMED_PARAM(merged, 4096_logs_1_thread, 4096, 1)
+BENCHMARK_RELATIVE_NAMED_PARAM(merged, 4096_logs_4_threads, 4096, 4)
+BENCHMARK_RELATIVE_NAMED_PARAM(merged, 4096_logs_16_threads, 4096, 16)
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  folly::runBenchmarks();
+  return 0;
+}
@@ -0,0 +1,150 @@
+/**
+ * Copyright (c) 2017-present, Facebook, Inc. and its affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include <folly/Benchmark.h>
+#include <gflags/gflags.h>
+
+#include "logdevice/common/DataRecordOwnsPayload.h"
+#include "logdevice/common/ReaderImpl.h"
+#include "logdevice/include/Reader.h"
+#include "logdevice/include/RecordBatch.h"
+
+using namespace facebook::logdevice;
+
+/**
+ * @file Benchmark comparing the application-thread cost of consuming records
+ *       through Reader::read() (one DataRecord per record) and
+ *       Reader::readBatch() (columnar RecordBatch).  Records are pushed
+ *       through ReaderBridge outside of the timed section, so results are
+ *       records/s on the consuming core; the per-record cost of handing
+ *       records over from workers, the same for both, is not measured.
+ *
+ *       Run with --bm_min_usec=1000000.
+ */
+
+DEFINE_int32(payload_size, 200, "Payload size of each record in bytes.");
+DEFINE_int32(read_size, 1000, "Number of records requested per read call.");
+
+namespace {
+
+const logid_t LOG_ID(1);
+const size_t QUEUE_RECORDS = 4096;
+
+class BenchReader : public ReaderImpl {
+ public:
+  BenchReader()
+      : ReaderImpl(1, nullptr, nullptr, nullptr, "", QUEUE_RECORDS) {
+    destructor_stops_reading_ = false;
+  }
+
+  ReaderBridge* getBridge() {
+    return bridge_.get();
+  }
+
+  read_stream_id_t getReadStreamID() const {
+    return read_stream_id_t(1);
+  }
+
+ protected:
+  int startReadingImpl(logid_t /*log_id*/,
+                       lsn_t /*from*/,
+                       lsn_t /*until*/,
+                       ReadingHandle* handle_out,
+                       const ReadStreamAttributes* /*attrs*/) override {
+    handle_out->read_stream_id = getReadStreamID();
+    handle_out->worker_id.val_ = -2;
+    return 0;
+  }
+  int postStopReadingRequest(ReadingHandle /*handle*/,
+                             std::function<void()> cb) override {
+    if (cb) {
+      cb();
+    }
+    return 0;
+  }
+};
+
+void produce(BenchReader& reader, lsn_t* next_lsn, size_t nrecords) {
+  for (size_t i = 0; i < nrecords; ++i) {
+    const size_t size = FLAGS_payload_size;
+    void* buf = malloc(size);
+    memset(buf, 'x', size);
+    auto record = std::make_unique<DataRecordOwnsPayload>(
+        LOG_ID,
+        Payload(buf, size),
+        (*next_lsn)++,
+        std::chrono::milliseconds(1),
+        RECORD_flags_t(0));
+    int rv = reader.getBridge()->onDataRecord(
+        reader.getReadStreamID(), std::move(record), false);
+    ld_check(rv == 0);
+  }
+}
+
+template <typename ConsumeFn>
+void run(unsigned int iters, ConsumeFn consume) {
+  std::unique_ptr<BenchReader> reader;
+  lsn_t next_lsn = 1;
+  BENCHMARK_SUSPEND {
+    reader = std::make_unique<BenchReader>();
+    reader->startReading(LOG_ID, lsn_t(1), LSN_MAX);
+    reader->setTimeout(std::chrono::milliseconds::zero());
+  }
+
+  size_t remaining = iters;
+  while (remaining > 0) {
+    size_t nrecords = std::min(remaining, QUEUE_RECORDS);
+    BENCHMARK_SUSPEND {
+      produce(*reader, &next_lsn, nrecords);
+    }
+    size_t consumed = 0;
+    while (consumed < nrecords) {
+      consumed += consume(*reader);
+    }
+    remaining -= nrecords;
+  }
+}
+
+} // namespace
+
+BENCHMARK(ReadDataRecords, iters) {
+  std::vector<std::unique_ptr<DataRecord>> records;
+  GapRecord gap;
+  run(iters, [&](BenchReader& reader) {
+    records.clear();
+    ssize_t nread = reader.read(FLAGS_read_size, &records, &gap);
+    ld_check(nread >= 0);
+    for (const auto& record : records) {
+      folly::doNotOptimizeAway(record->payload.data());
+    }
+    return nread;
+  });
+}
+
+BENCHMARK_RELATIVE(ReadRecordBatch, iters) {
+  RecordBatch batch;
+  GapRecord gap;
+  run(iters, [&](BenchReader& reader) {
+    ssize_t nread = reader.readBatch(FLAGS_read_size, &batch, &gap);
+    ld_check(nread >= 0);
+    for (size_t i = 0; i < batch.size(); ++i) {
+      folly::doNotOptimizeAway(batch.payload(i).data());
+    }
+    return nread;
+  });
+}
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  folly::runBenchmarks();
+  return 0;
+}
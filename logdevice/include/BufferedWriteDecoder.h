@@ -27,12 +27,23 @@ class BufferedWriteDecoderImpl;
 
 class BufferedWriteDecoder {
  public:
+  struct Options {
+    // Maximum number of threads decode() uses to decompress the records it
+    // is given, including the calling thread.  The other threads come from a
+    // pool shared by all decoders in the process.  Payloads are appended to
+    // `payloads_out' in the same order regardless.  1 decodes everything on
+    // the calling thread.
+    size_t parallelism = 1;
+  };
+
   /**
    * Creates a BufferedWriteDecoder instance.  It can be used to decode
    * batched writes made by any BufferedWriter.
    */
   static std::unique_ptr<BufferedWriteDecoder> create();
 
+  static std::unique_ptr<BufferedWriteDecoder> create(const Options& options);
+
   /**
    * Returns the number of individual records stored in a single
    * DataRecord.
@@ -447,6 +447,37 @@ class Client {
   virtual std::unique_ptr<Reader>
   createReader(size_t max_logs, ssize_t buffer_size = -1) noexcept = 0;
 
+  /**
+   * Creates a Reader that returns the records of all the logs it reads
+   * merged in timestamp order.  Like with createReader(), each log is read
+   * by one of the client's worker threads, so many logs are fetched and
+   * buffered in parallel; only the merge runs on the thread calling read()
+   * or readBatch().
+   *
+   * Records of different logs are returned in timestamp order as long as
+   * their timestamps are no more than `max_out_of_orderness' apart from the
+   * newest record seen so far.  A record is held back until every log being
+   * read has a record to compare it against, until a record newer by more
+   * than `max_out_of_orderness' arrives, or for at most
+   * `max_out_of_orderness' if some log has nothing to read.  Records of the
+   * same log are always returned in LSN order, and gaps are returned as soon
+   * as all earlier records of their log were.
+   *
+   * A log that is ahead of the others is not buffered without bound: its
+   * read stream stops fetching records once its buffer (see buffer_size) is
+   * full, until the merge catches up.
+   *
+   * @param max_logs              same as for createReader()
+   * @param max_out_of_orderness  how late a record may arrive, compared to
+   *                              records of other logs, and still be
+   *                              returned in order
+   * @param buffer_size           same as for createReader()
+   */
+  virtual std::unique_ptr<Reader> createTimestampMergingReader(
+      size_t max_logs,
+      std::chrono::milliseconds max_out_of_orderness,
+      ssize_t buffer_size = -1) noexcept = 0;
+
   /**
    * Creates an AsyncReader object that can be used to read from one or more
    * logs via callbacks.
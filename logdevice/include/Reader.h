@@ -13,6 +13,7 @@
 #include <folly/Range.h>
 
 #include "logdevice/include/Record.h"
+#include "logdevice/include/RecordBatch.h"
 #include "logdevice/include/types.h"
 
 namespace facebook { namespace logdevice {
@@ -144,6 +145,47 @@ class Reader {
                        std::vector<std::unique_ptr<DataRecord>>* data_out,
                        GapRecord* gap_out) = 0;
 
+  /**
+   * Like read() but delivers data records into a columnar RecordBatch.
+   * Payloads are not copied; the batch takes ownership of the records and
+   * keeps them alive until it is cleared.  Records decoded from
+   * BufferedWriter blobs are appended without creating a DataRecord for each
+   * of them.
+   *
+   * `batch_out' is cleared before records are added.  Semantics with respect
+   * to `nrecords', timeouts and gaps are the same as for read().
+   *
+   * Example usage:
+   *   RecordBatch batch;
+   *   GapRecord gap;
+   *   ssize_t nread = reader->readBatch(1000, &batch, &gap);
+   *   if (nread >= 0) {
+   *     for (size_t i = 0; i < batch.size(); ++i) {
+   *       // process batch.lsn(i), batch.payload(i), ...
+   *     }
+   *   } else {
+   *     assert(err == E::GAP);
+   *     // process gap
+   *   }
+   *
+   * @return Returns the number of records delivered (between 0 and
+   *         `nrecords`), or -1 if there was a gap, in which case
+   *         logdevice::err is set to E::GAP and *gap_out is filled in.
+   */
+  virtual ssize_t readBatch(size_t nrecords,
+                            RecordBatch* batch_out,
+                            GapRecord* gap_out) {
+    // Default implementation on top of read(), for Reader implementations
+    // that have no more efficient way of filling the batch.
+    batch_out->clear();
+    std::vector<std::unique_ptr<DataRecord>> records;
+    ssize_t nread = read(nrecords, &records, gap_out);
+    for (auto& record : records) {
+      batch_out->append(std::move(record));
+    }
+    return nread;
+  }
+
   /**
    * If called, whenever read() can return some records but not the number
    * requested by the caller, it will return the records instead of waiting
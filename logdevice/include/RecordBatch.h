@@ -0,0 +1,218 @@
+/**
+ * Copyright (c) 2017-present, Facebook, Inc. and its affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+#pragma once
+
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "logdevice/include/Record.h"
+#include "logdevice/include/types.h"
+
+namespace facebook { namespace logdevice {
+
+class BufferedWriteDecoder;
+
+/**
+ * @file A columnar batch of data records, filled by Reader::readBatch().
+ *
+ * The attributes of all records are kept in contiguous arrays (one array per
+ * attribute).  Payloads are not copied: the batch takes ownership of the
+ * DataRecord objects taken off the reader's queue (or of the decoder holding
+ * records decoded from a BufferedWriter blob) and payload() returns views
+ * into their memory.
+ *
+ * clear() keeps the capacity of all arrays, so reusing the same RecordBatch
+ * across readBatch() calls does not reallocate them in steady state.
+ *
+ * The batch is not backed by an arena, and only the consuming side is
+ * batched: each record still arrives from the worker as its own DataRecord
+ * and its own entry of the reader's queue.
+ *
+ * Payload views returned by payload() are only valid until the batch is
+ * cleared, refilled or destroyed.
+ *
+ * This class is *not* thread-safe.
+ */
+
+class RecordBatch {
+ public:
+  RecordBatch() {}
+
+  RecordBatch(const RecordBatch&) = delete;
+  RecordBatch& operator=(const RecordBatch&) = delete;
+  RecordBatch(RecordBatch&&) = default;
+  RecordBatch& operator=(RecordBatch&&) = default;
+
+  /**
+   * @return number of data records in the batch
+   */
+  size_t size() const {
+    return lsns_.size();
+  }
+
+  bool empty() const {
+    return lsns_.empty();
+  }
+
+  /**
+   * Removes all records from the batch, freeing their payloads.  Memory of
+   * the attribute arrays is retained for reuse.
+   */
+  void clear() {
+    logids_.clear();
+    lsns_.clear();
+    timestamps_.clear();
+    batch_offsets_.clear();
+    byte_offsets_.clear();
+    payloads_.clear();
+    records_.clear();
+    decoders_.clear();
+    payload_bytes_ = 0;
+  }
+
+  /**
+   * Preallocates space for `nrecords' records.
+   */
+  void reserve(size_t nrecords) {
+    logids_.reserve(nrecords);
+    lsns_.reserve(nrecords);
+    timestamps_.reserve(nrecords);
+    batch_offsets_.reserve(nrecords);
+    byte_offsets_.reserve(nrecords);
+    payloads_.reserve(nrecords);
+    records_.reserve(nrecords);
+  }
+
+  /**
+   * Appends a record to the batch, taking ownership of it.  The payload is
+   * not copied.
+   */
+  void append(std::unique_ptr<DataRecord> record) {
+    assert(record);
+    appendAttributes(record->logid,
+                     record->attrs.lsn,
+                     record->attrs.timestamp,
+                     record->attrs.batch_offset,
+                     record->attrs.byte_offset,
+                     record->payload);
+    records_.push_back(std::move(record));
+  }
+
+  /**
+   * Appends the records decoded from one BufferedWriter blob.  `payloads'
+   * point into memory owned by `decoder', which the batch keeps alive.
+   * Records get batch offsets 0, 1, ... in the order of `payloads'.
+   */
+  void appendDecoded(std::shared_ptr<BufferedWriteDecoder> decoder,
+                     logid_t log_id,
+                     lsn_t lsn,
+                     std::chrono::milliseconds timestamp,
+                     uint64_t byte_offset,
+                     const std::vector<Payload>& payloads) {
+    int batch_offset = 0;
+    for (const Payload& payload : payloads) {
+      appendAttributes(
+          log_id, lsn, timestamp, batch_offset++, byte_offset, payload);
+    }
+    decoders_.push_back(std::move(decoder));
+  }
+
+  logid_t logid(size_t i) const {
+    assert(i < size());
+    return logids_[i];
+  }
+
+  lsn_t lsn(size_t i) const {
+    assert(i < size());
+    return lsns_[i];
+  }
+
+  std::chrono::milliseconds timestamp(size_t i) const {
+    assert(i < size());
+    return timestamps_[i];
+  }
+
+  int batchOffset(size_t i) const {
+    assert(i < size());
+    return batch_offsets_[i];
+  }
+
+  uint64_t byteOffset(size_t i) const {
+    assert(i < size());
+    return byte_offsets_[i];
+  }
+
+  /**
+   * @return a view of record i's payload
+   */
+  const Payload& payload(size_t i) const {
+    assert(i < size());
+    return payloads_[i];
+  }
+
+  // Direct access to the columns, for consumers that want to process a whole
+  // attribute at a time.  All have size() elements.
+  const std::vector<logid_t>& logids() const {
+    return logids_;
+  }
+  const std::vector<lsn_t>& lsns() const {
+    return lsns_;
+  }
+  const std::vector<std::chrono::milliseconds>& timestamps() const {
+    return timestamps_;
+  }
+  const std::vector<int>& batchOffsets() const {
+    return batch_offsets_;
+  }
+  const std::vector<uint64_t>& byteOffsets() const {
+    return byte_offsets_;
+  }
+  const std::vector<Payload>& payloads() const {
+    return payloads_;
+  }
+
+  /**
+   * @return total number of payload bytes in the batch
+   */
+  size_t payloadBytes() const {
+    return payload_bytes_;
+  }
+
+ private:
+  void appendAttributes(logid_t log_id,
+                        lsn_t lsn,
+                        std::chrono::milliseconds timestamp,
+                        int batch_offset,
+                        uint64_t byte_offset,
+                        const Payload& payload) {
+    logids_.push_back(log_id);
+    lsns_.push_back(lsn);
+    timestamps_.push_back(timestamp);
+    batch_offsets_.push_back(batch_offset);
+    byte_offsets_.push_back(byte_offset);
+    payloads_.push_back(payload);
+    payload_bytes_ += payload.size();
+  }
+
+  std::vector<logid_t> logids_;
+  std::vector<lsn_t> lsns_;
+  std::vector<std::chrono::milliseconds> timestamps_;
+  std::vector<int> batch_offsets_;
+  std::vector<uint64_t> byte_offsets_;
+  // Views into memory owned by records_ or decoders_
+  std::vector<Payload> payloads_;
+  // Owners of the payloads
+  std::vector<std::unique_ptr<DataRecord>> records_;
+  std::vector<std::shared_ptr<BufferedWriteDecoder>> decoders_;
+  size_t payload_bytes_ = 0;
+};
+
+}} // namespace facebook::logdevice
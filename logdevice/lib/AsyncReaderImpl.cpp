@@ -36,7 +36,8 @@ AsyncReaderImpl::AsyncReaderImpl(std::shared_ptr<ClientImpl> client,
       processor_(&client_->getProcessor()),
       read_buffer_size_(buffer_size < 0
                             ? processor_->settings()->client_read_buffer_size
-                            : static_cast<size_t>(buffer_size)) {}
+                            : static_cast<size_t>(buffer_size)),
+      buffer_type_(processor_->settings()->client_read_buffer_type) {}
 
 AsyncReaderImpl::~AsyncReaderImpl() {
   // The destructor should ensure that all reading is stopped.
@@ -246,6 +247,15 @@ int AsyncReaderImpl::startReading(logid_t log_id,
     return -1;
   }
 
+  if (attrs && !isValidSampleParam(attrs->sample_mode, attrs->sample_param)) {
+    ld_error("invalid sampling parameter %lu for mode %d for log_id %lu",
+             attrs->sample_param,
+             static_cast<int>(attrs->sample_mode),
+             log_id.val_);
+    err = E::INVALID_PARAM;
+    return -1;
+  }
+
   if (!record_callback_) {
     ld_error("called without specifying record callback for log_id %lu",
              log_id.val_);
@@ -445,12 +455,16 @@ bool AsyncReaderImpl::handleBufferedWrite(std::unique_ptr<DataRecord>& record) {
   const RECORD_flags_t flags = record_with_attributes->flags_;
   record_with_attributes = nullptr; // no longer safe
 
-  auto decoder = std::make_shared<BufferedWriteDecoderImpl>();
+  auto decoder =
+      std::make_shared<BufferedWriteDecoderImpl>(1, processor_->stats_);
   std::vector<Payload> payloads;
   // We use an overload of BufferedWriteDecoderImpl that does not claim
   // ownership of the input DataRecord, in case the client rejects delivery
-  // and we need to return the record to ClientReadStream intact.
-  int rv = decoder->decodeOne(*record, payloads);
+  // and we need to return the record to ClientReadStream intact.  Instead of
+  // copying an uncompressed blob, the decoder shares ownership of the
+  // record's payload buffer.
+  int rv = decoder->decodeOneShared(
+      *static_cast<DataRecordOwnsPayload*>(record.get()), payloads);
   if (rv != 0) {
     // Whoops, decoding failed. This is tragic and unlikely with checksums
     // but let's generate a DATALOSS gap to inform the client.
@@ -52,6 +52,10 @@ class AsyncReaderImpl : public AsyncReader {
     buffer_type_ = buffer_type;
   }
 
+  ClientReadStreamBufferType getBufferType() const {
+    return buffer_type_;
+  }
+
   explicit AsyncReaderImpl(std::shared_ptr<ClientImpl> client,
                            ssize_t buffer_size);
 
@@ -109,9 +113,9 @@ class AsyncReaderImpl : public AsyncReader {
   // of ClientReadStream it creates
   size_t read_buffer_size_;
 
-  // type of the buffer used by the readstream, by default it uses a circular
-  // linear buffer
-  ClientReadStreamBufferType buffer_type_{ClientReadStreamBufferType::CIRCULAR};
+  // type of the buffer used by the readstream, client_read_buffer_type unless
+  // overridden with setBufferType()
+  ClientReadStreamBufferType buffer_type_;
 
   struct LogState {
     explicit LogState(ReadingHandle handle) : handle(handle) {}
@@ -17,6 +17,11 @@ std::unique_ptr<BufferedWriteDecoder> BufferedWriteDecoder::create() {
   return std::make_unique<BufferedWriteDecoderImpl>();
 }
 
+std::unique_ptr<BufferedWriteDecoder>
+BufferedWriteDecoder::create(const Options& options) {
+  return std::make_unique<BufferedWriteDecoderImpl>(options.parallelism);
+}
+
 int BufferedWriteDecoder::getBatchSize(const DataRecord& record,
                                        size_t* size_out) {
   return BufferedWriteDecoderImpl::getBatchSize(record, size_out);
@@ -690,6 +690,19 @@ std::unique_ptr<Reader> ClientImpl::createReader(size_t max_logs,
                                       shared_from_this());
 }
 
+std::unique_ptr<Reader> ClientImpl::createTimestampMergingReader(
+    size_t max_logs,
+    std::chrono::milliseconds max_out_of_orderness,
+    ssize_t buffer_size) noexcept {
+  auto reader = std::make_unique<ReaderImpl>(max_logs,
+                                             buffer_size,
+                                             processor_.get(),
+                                             getEpochMetaDataCache(),
+                                             shared_from_this());
+  reader->mergeByTimestamp(max_out_of_orderness);
+  return std::move(reader);
+}
+
 std::unique_ptr<AsyncReader>
 ClientImpl::createAsyncReader(ssize_t buffer_size) noexcept {
   return std::make_unique<AsyncReaderImpl>(shared_from_this(), buffer_size);
@@ -140,6 +140,11 @@ class ClientImpl : public Client,
   std::unique_ptr<Reader> createReader(size_t max_logs,
                                        ssize_t buffer_size) noexcept override;
 
+  std::unique_ptr<Reader> createTimestampMergingReader(
+      size_t max_logs,
+      std::chrono::milliseconds max_out_of_orderness,
+      ssize_t buffer_size) noexcept override;
+
   std::unique_ptr<AsyncReader>
   createAsyncReader(ssize_t buffer_size) noexcept override;
 
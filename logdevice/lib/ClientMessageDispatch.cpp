@@ -33,8 +33,11 @@ ClientMessageDispatch::onReceivedImpl(Message* msg, const Address& from) {
     case MessageType::NODE_STATS_AGGREGATE:
     case MessageType::NODE_STATS_AGGREGATE_REPLY:
     case MessageType::IS_LOG_EMPTY:
+    case MessageType::READ_CONTROL_BATCH:
     case MessageType::RELEASE:
+    case MessageType::RELEASE_BATCH:
     case MessageType::SEAL:
+    case MessageType::SEAL_BATCH:
     case MessageType::START:
     case MessageType::STOP:
     case MessageType::STORE:
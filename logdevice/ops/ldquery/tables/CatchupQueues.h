@@ -30,7 +30,9 @@ class CatchupQueues : public AdminCommandTable {
            "of one client on one socket.  It contains a queue of read streams "
            "for which there are new records to be sent to the client (we say "
            "these read streams are not caught up).  Read streams from that "
-           "queue are processed (or \"woken-up\") in a round-robin fashion. "
+           "queue are processed (or \"woken-up\") in a deficit round-robin "
+           "fashion.  The CatchupQueues of a worker take turns in proportion "
+           "to the read weights of their clients. "
            "The state machine is implemented in "
            "logdevice/common/CatchupQueue.h.";
   }
@@ -73,7 +75,31 @@ class CatchupQueues : public AdminCommandTable {
          DataType::INTEGER,
          "Ping timer is a timer that is used to ensure we eventually try to "
          "schedule more reads under certain conditions.  This column indicates "
-         "whether the timer is currently active."}};
+         "whether the timer is currently active."},
+        {"read_weight",
+         DataType::BIGINT,
+         "Weight of the client relative to other clients, from the "
+         "\"read_weight\" of its principal in the config.  Clients that "
+         "compete for a worker get to read in proportion to their weights."},
+        {"max_queue_delay_ms",
+         DataType::BIGINT,
+         "Longest time a read stream currently in the queue has been waiting "
+         "for its turn, in milliseconds."},
+        {"avg_queue_delay_ms",
+         DataType::BIGINT,
+         "Average time the read streams currently in the queue have been "
+         "waiting for their turn, in milliseconds."},
+        {"stream_queue_delays_ms",
+         DataType::TEXT,
+         "Time each read stream currently in the queue has been waiting for "
+         "its turn, in milliseconds, as a comma-separated list of "
+         "\"log_id:read_stream_id:delay\", in the order the streams will "
+         "get their turn."},
+        {"waiting_for_turn",
+         DataType::INTEGER,
+         "Whether the CatchupQueue is waiting for other clients of the "
+         "worker to read before it reads more, because it has read more "
+         "than its share."}};
   }
   std::string getCommandToSend(QueryContext& /*ctx*/) const override {
     return std::string("info catchup_queues --json\n");
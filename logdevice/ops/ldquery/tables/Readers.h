@@ -115,6 +115,10 @@ class Readers : public AdminCommandTable {
          DataType::INTEGER,
          "True if there is currently a storage task running on a slow storage "
          "thread for reading a batch of records."},
+        {"filtered_out_bytes",
+         DataType::BIGINT,
+         "Number of bytes of records that were not shipped because their key "
+         "didn't pass the server-side filter of this read stream."},
     };
   }
   std::string getCommandToSend(QueryContext& ctx) const override {
@@ -140,6 +140,8 @@ AdminCommandFactory::AdminCommandFactory() {
 
   selector_.add<commands::StatsHistogram>("stats2 histogram");
   selector_.add<commands::TrafficShapingHistogram>("stats2 shaping");
+  selector_.add<commands::StorageTaskQueueTimeHistogram>(
+      "stats2 storage_task_queue_time");
 
   selector_.add<commands::StatsThroughput>("stats throughput");
   selector_.add<commands::StatsCustomCounters>("stats custom counters");
@@ -20,6 +20,7 @@
 #include "logdevice/server/LogRebuildingCheckpoint.h"
 #include "logdevice/server/ServerProcessor.h"
 #include "logdevice/server/ServerWorker.h"
+#include "logdevice/server/rebuilding/RebuildingBandwidthController.h"
 #include "logdevice/server/rebuilding/ShardRebuildingV1.h"
 #include "logdevice/server/read_path/LogStorageStateMap.h"
 #include "logdevice/server/storage_tasks/PerWorkerStorageTaskQueue.h"
@@ -735,10 +736,19 @@ void LogRebuilding::startProcessingBatch(Status status,
     return;
     // `this` might be deleted here if we reached the end of the log.
   } else {
-    startRecordRebuildingStores(rebuildingSettings_->max_records_in_flight);
+    startRecordRebuildingStores(getMaxRecordsInFlight());
   }
 }
 
+size_t LogRebuilding::getMaxRecordsInFlight() {
+  size_t limit = rebuildingSettings_->max_records_in_flight;
+  auto controller = RebuildingBandwidthController::get();
+  if (controller) {
+    limit = controller->scaleLimit(limit, *rebuildingSettings_.get());
+  }
+  return limit;
+}
+
 size_t LogRebuilding::getMaxBlockSize() {
   return Worker::settings().sticky_copysets_block_size;
 }
@@ -940,7 +950,13 @@ void LogRebuilding::onAllStoresReceived(
     onAllStoresDurable(lsn);
   }
 
-  startRecordRebuildingStores();
+  // Start more stores if the bandwidth controller raised the limit, fewer
+  // if it lowered it. Always at least one if none are in flight.
+  const size_t max_in_flight = getMaxRecordsInFlight();
+  startRecordRebuildingStores(
+      max_in_flight > numRecordRebuildingStoresInFlight_
+          ? max_in_flight - numRecordRebuildingStoresInFlight_
+          : 0);
 }
 
 void LogRebuilding::onAllStoresDurable(lsn_t lsn) {
@@ -1061,6 +1077,8 @@ void LogRebuilding::onAllAmendsDurable(lsn_t lsn) {
   --numRecordRebuildingPendingAmendDurable_;
   size_t sz = recordDurabilityState_.at(lsn)->size;
   nBytesReplicated_ += sz;
+  STAT_INCR(getStats(), rebuilding_donor_records_rebuilt);
+  STAT_ADD(getStats(), rebuilding_donor_bytes_rebuilt, sz);
   bytesRebuiltSinceCheckpoint_ += sz;
   recordDurabilityState_.erase(lsn);
   ld_spew("All amends durable for rebuilding of record with lsn:%s"
@@ -1369,6 +1387,7 @@ void LogRebuilding::onReadTaskDone(RebuildingReadStorageTask& task) {
     // freeing the iterator if we didn't place it in the cache
     task.ownedIterator.reset();
   }
+  readRecordSizes_ = task.recordSizes;
 
   ServerWorker* w = ServerWorker::onThisThread(false);
   if (w) {
@@ -1641,6 +1660,7 @@ void LogRebuilding::putReadStorageTask(
                                                   ctx,
                                                   options,
                                                   std::move(read_iterator));
+  task->recordSizes = readRecordSizes_;
   auto task_queue =
       ServerWorker::onThisThread()->getStorageTaskQueueForShard(shard_);
   task_queue->putTask(std::move(task));
@@ -191,6 +191,10 @@ class LogRebuilding : public LogRebuildingInterface,
                     RecordTimestamp max_ts) override;
     bool shouldProcessTimeRange(RecordTimestamp min,
                                 RecordTimestamp max) override;
+    // Looks at timestamps and counts filtered records.
+    bool dependsOnlyOnCopyset() const override {
+      return false;
+    }
 
     /**
      * Update stats regarding skipped records.
@@ -262,6 +266,15 @@ class LogRebuilding : public LogRebuildingInterface,
     return id_;
   }
 
+  /**
+   * @return A new id from the counter used for LogRebuilding runs. Used by
+   *         ChunkRebuilding too, so that STORED replies can't be routed to
+   *         the wrong one.
+   */
+  static log_rebuilding_id_t allocateRebuildingId() {
+    return log_rebuilding_id_t(next_id++);
+  }
+
   /**
    * @return Restart version. Returns LSN_INVALID if start() has not been
    * called yet.
@@ -732,6 +745,9 @@ class LogRebuilding : public LogRebuildingInterface,
   // Overridden in tests
   virtual size_t getMaxBlockSize();
 
+  // rebuilding-max-records-in-flight scaled by RebuildingBandwidthController.
+  virtual size_t getMaxRecordsInFlight();
+
   // Returns the total size of log rebuilding state machine
   virtual size_t getTotalLogRebuildingSize();
 
@@ -869,6 +885,10 @@ class LogRebuilding : public LogRebuildingInterface,
   // If this is set to nullptr, iterators are re-created for every batch.
   std::shared_ptr<IteratorCache> iteratorCache_;
 
+  // Records read so far by read storage tasks. Passed to each task, which
+  // uses them to estimate the bytes skipped thanks to the copyset index.
+  RebuildingReadStorageTask::ReadRecordSizes readRecordSizes_;
+
   RebuildingEventsTracer rebuilding_events_tracer_;
 
   // Timer used to try issuing a read storage task again after some time
@@ -66,13 +66,20 @@ Message::Disposition MEMTABLE_FLUSHED_onReceived(MEMTABLE_FLUSHED_Message* msg,
   }
 
   // on the current worker, send an update to all LogRebuilding state machines
-  // whose log maps to the shard on which memtable was flushed.
+  // and ChunkRebuildings whose log maps to the shard on which memtable was
+  // flushed.
   for (const auto& lr : w->runningLogRebuildings().map) {
     if (lr.first.second == header.shard_idx_) {
       lr.second->onMemtableFlushed(
           header.node_index_, header.server_instance_id_, header.memtable_id_);
     }
   }
+  for (const auto& cr : w->runningChunkRebuildings().map) {
+    if (cr.second->getShard() == header.shard_idx_) {
+      cr.second->onMemtableFlushed(
+          header.node_index_, header.server_instance_id_, header.memtable_id_);
+    }
+  }
 
   return Message::Disposition::NORMAL;
 }
@@ -32,6 +32,38 @@ size_t ReleasedRecords::computeBytesEstimate(const ZeroCopiedRecord* entries) {
   return size;
 }
 
+std::shared_ptr<const std::string>
+ReleasedRecords::sharePayloads(const void* stream) {
+  if (!shared_payloads_) {
+    if (first_stream_ == nullptr || first_stream_ == stream) {
+      first_stream_ = stream;
+      return nullptr;
+    }
+    if (!payloads_bytes_.hasValue()) {
+      size_t total_size = 0;
+      for (const ZeroCopiedRecord* entry = entries_.get(); entry != nullptr;
+           entry = entry->next_.get()) {
+        total_size += entry->payload_raw.size;
+      }
+      payloads_bytes_ = total_size;
+    }
+    const size_t total_size = payloads_bytes_.value();
+    if (buffer_ && !buffer_->chargeSharedPayloads(total_size)) {
+      // Over budget; the stream copies the payload it ships instead.
+      return nullptr;
+    }
+    auto payloads = std::make_shared<std::string>();
+    payloads->reserve(total_size);
+    for (const ZeroCopiedRecord* entry = entries_.get(); entry != nullptr;
+         entry = entry->next_.get()) {
+      payloads->append(static_cast<const char*>(entry->payload_raw.data),
+                       entry->payload_raw.size);
+    }
+    shared_payloads_ = std::move(payloads);
+  }
+  return shared_payloads_;
+}
+
 std::string ReleasedRecords::toString() const {
   return folly::sformat("{} [{}-{}], bytes {}",
                         facebook::logdevice::toString(logid_),
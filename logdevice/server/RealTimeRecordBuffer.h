@@ -8,6 +8,7 @@
 #pragma once
 
 #include "folly/AtomicIntrusiveLinkedList.h"
+#include "folly/Optional.h"
 
 #include "logdevice/common/UnorderedMapWithLRU.h"
 #include "logdevice/include/types.h"
@@ -86,6 +87,32 @@ class ReleasedRecords {
 
   static size_t computeBytesEstimate(const ZeroCopiedRecord* entries);
 
+  /**
+   * The payloads of all entries, in list order, copied once into a buffer
+   * that the RECORD messages of every stream shipping these records point
+   * into.  Adding a tailer to a hot log then doesn't cost another copy of
+   * each payload.  The buffer is independent of the record cache and can
+   * outlive this object.
+   *
+   * Called by a stream about to ship the payload of one of the entries.  The
+   * buffer is only built once a second stream does so: returns nullptr to
+   * the first one, which copies just the payloads it ships, so that logs
+   * with a single tailer don't pay for a copy of every payload.
+   *
+   * The buffer is charged to the RealTimeRecordBuffer's memory budget until
+   * this object is deleted, even though RECORD messages still queued in
+   * sockets may keep it alive longer.  Also returns nullptr if it doesn't fit
+   * in the budget.
+   *
+   * Only called on the worker owning this object.
+   */
+  std::shared_ptr<const std::string> sharePayloads(const void* stream);
+
+  // Bytes of the buffer returned by sharePayloads(), 0 until it is built.
+  size_t getSharedPayloadsBytes() const {
+    return shared_payloads_ ? shared_payloads_->size() : 0;
+  }
+
   const logid_t logid_;
   // This object contains all the records for the log that this storage node has
   // between begin_lsn_ and end_lsn_ inclusive.  Note that, if we're not part of
@@ -97,6 +124,14 @@ class ReleasedRecords {
   const size_t bytes_estimate_;
   folly::AtomicIntrusiveLinkedListHook<ReleasedRecords> hook_;
   RealTimeRecordBuffer* buffer_{nullptr};
+
+ private:
+  std::shared_ptr<const std::string> shared_payloads_;
+  // Stream that first shipped a payload, see sharePayloads()
+  const void* first_stream_{nullptr};
+  // Total size of the payloads of all entries, computed by the first
+  // sharePayloads() call that needs it.
+  folly::Optional<size_t> payloads_bytes_;
 };
 
 // There is one of these per Worker, it lives in AllServerReadStreams.
@@ -137,6 +172,19 @@ class RealTimeRecordBuffer {
     return released_records_bytes_.load() > max_bytes_;
   }
 
+  // Charges the payloads ReleasedRecords::sharePayloads() copies to the
+  // budget.  Returns false, without charging, if they don't fit.  Refunded by
+  // deletedReleasedRecords().
+  bool chargeSharedPayloads(size_t bytes) {
+    size_t cur = released_records_bytes_.load();
+    do {
+      if (cur + bytes > max_bytes_) {
+        return false;
+      }
+    } while (!released_records_bytes_.compare_exchange_weak(cur, cur + bytes));
+    return true;
+  }
+
   logid_t toEvict() {
     return logids_.getLRU();
   }
@@ -146,7 +194,8 @@ class RealTimeRecordBuffer {
   }
 
   void deletedReleasedRecords(const ReleasedRecords* records) {
-    released_records_bytes_.fetch_sub(records->getBytesEstimate());
+    released_records_bytes_.fetch_sub(records->getBytesEstimate() +
+                                      records->getSharedPayloadsBytes());
 
     auto count_and_iter = logids_.getWithoutPromotion(records->logid_);
     ld_check(count_and_iter.first != nullptr);
@@ -172,9 +221,10 @@ class RealTimeRecordBuffer {
       released_records_;
 
   // The size of all records both in relased_records_ here, and in all
-  // ServerReadStream's released_records_.  Note that we need to append records
-  // to released_records_ before incrementing this, because when this is big
-  // enough to trigger eviction, we must be able to find the records to evict.
+  // ServerReadStream's released_records_, and of their shared payloads.  Note
+  // that we need to append records to released_records_ before incrementing
+  // this, because when this is big enough to trigger eviction, we must be able
+  // to find the records to evict.
   std::atomic<size_t> released_records_bytes_{0};
 
   const size_t eviction_threshold_bytes_;
@@ -21,6 +21,7 @@
 #include "logdevice/server/locallogstore/LocalLogStore.h"
 #include "logdevice/server/read_path/AllServerReadStreams.h"
 #include "logdevice/server/rebuilding/ShardRebuildingV1.h"
+#include "logdevice/server/rebuilding/ShardRebuildingV2.h"
 #include "logdevice/server/storage_tasks/PerWorkerStorageTaskQueue.h"
 #include "logdevice/server/storage_tasks/ReadStorageTask.h"
 #include "logdevice/server/storage_tasks/ShardedStorageThreadPool.h"
@@ -745,6 +746,17 @@ RebuildingCoordinator::createShardRebuilding(
     lsn_t restart_version,
     std::shared_ptr<const RebuildingSet> rebuilding_set,
     UpdateableSettings<RebuildingSettings> rebuilding_settings) {
+  if (rebuilding_settings->enable_v2) {
+    return std::make_unique<ShardRebuildingV2>(
+        shard,
+        version,
+        restart_version,
+        rebuilding_set,
+        shardedStore_->getByIndex(shard),
+        rebuilding_settings,
+        config_,
+        this);
+  }
   return std::make_unique<ShardRebuildingV1>(shard,
                                              version,
                                              restart_version,
@@ -151,6 +151,13 @@ void RebuildingReadStorageTask::execute() {
   // the worker.
   records = std::move(callback.releaseRecords());
   totalBytes = callback.totalBytes();
+  payloadBytesSkipped =
+      estimatePayloadBytesSkipped(read_ctx_before.it_stats_,
+                                  readCtx.it_stats_,
+                                  recordSizes);
+  STAT_ADD(storageThreadPool_->stats(),
+           rebuilding_payload_bytes_skipped,
+           payloadBytesSkipped);
 
   // Log some debugging information each time a storage task takes more than 10s
   // to execute.
@@ -160,6 +167,7 @@ void RebuildingReadStorageTask::execute() {
                "log id=%lu, "
                "status=%s, "
                "num records read=%lu, num bytes read=%lu, "
+               "est. bytes skipped=%lu, "
                "read context before: {%s}, "
                "read context after: {%s}",
                latency_sec,
@@ -167,11 +175,28 @@ void RebuildingReadStorageTask::execute() {
                error_name(status),
                records.size(),
                totalBytes,
+               payloadBytesSkipped,
                read_ctx_before.toString().c_str(),
                readCtx.toString().c_str());
   }
 }
 
+size_t RebuildingReadStorageTask::estimatePayloadBytesSkipped(
+    const LocalLogStore::ReadStats& before,
+    const LocalLogStore::ReadStats& after,
+    ReadRecordSizes& sizes) {
+  ld_check(after.read_records >= before.read_records);
+  ld_check(after.filtered_csi_entries >= before.filtered_csi_entries);
+  sizes.records += after.read_records - before.read_records;
+  sizes.bytes += after.read_record_bytes - before.read_record_bytes;
+  if (sizes.records == 0) {
+    return 0;
+  }
+  const size_t records_skipped =
+      after.filtered_csi_entries - before.filtered_csi_entries;
+  return records_skipped * (sizes.bytes / sizes.records);
+}
+
 void RebuildingReadStorageTask::onDone() {
   WORKER_STAT_DECR(num_in_flight_rebuilding_read_storage_tasks);
 
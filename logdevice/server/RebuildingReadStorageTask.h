@@ -82,6 +82,20 @@ class RebuildingReadStorageTask : public StorageTask {
   LocalLogStoreReader::ReadContext readCtx;
   LocalLogStore::ReadOptions options;
 
+  /**
+   * Number and total size of the records read so far by consecutive read
+   * tasks of the same rebuilding. Their average is the estimated size of the
+   * records filtered out by the copyset index.
+   */
+  struct ReadRecordSizes {
+    size_t records{0};
+    size_t bytes{0};
+  };
+
+  // Records read by previous tasks of the same LogRebuilding. Set by
+  // LogRebuilding before putting the task, updated by execute().
+  ReadRecordSizes recordSizes;
+
   // weak ptr to an iterator passed in by CatchupOneStream (if any).
   std::weak_ptr<LocalLogStore::ReadIterator> iteratorFromCache;
 
@@ -98,6 +112,26 @@ class RebuildingReadStorageTask : public StorageTask {
   // Total amount of record bytes that were allocated by this storage task.
   // Used for stats.
   size_t totalBytes{0};
+  // Estimated amount of record bytes that weren't read because the copyset
+  // index filtered the records out. See estimatePayloadBytesSkipped().
+  size_t payloadBytesSkipped{0};
+
+  /**
+   * Estimates how many record bytes a read skipped thanks to the copyset
+   * index, given the iterator stats before and after the read. Copyset index
+   * entries don't carry record sizes, so each record filtered out by its
+   * copyset index entry is assumed to have the average size of the records
+   * read so far, including by this read. A batch in which every record was
+   * filtered out thus still gets an estimate.
+   *
+   * @param sizes  records read by previous reads; this read's are added.
+   *
+   * @return the estimate, 0 if no records were ever read.
+   */
+  static size_t
+  estimatePayloadBytesSkipped(const LocalLogStore::ReadStats& before,
+                              const LocalLogStore::ReadStats& after,
+                              ReadRecordSizes& sizes);
 
  private:
   void getDebugInfoDetailed(StorageTaskDebugInfo&) const override;
@@ -15,6 +15,7 @@
 #include "logdevice/common/Processor.h"
 #include "logdevice/common/stats/PerShardHistograms.h"
 #include "logdevice/server/ServerWorker.h"
+#include "logdevice/server/rebuilding/RebuildingBandwidthController.h"
 #include "logdevice/server/storage_tasks/PerWorkerStorageTaskQueue.h"
 #include "logdevice/server/storage_tasks/ShardedStorageThreadPool.h"
 
@@ -549,6 +550,28 @@ void RecordRebuildingBase::onStored(const STORED_Header& header,
     return;
   }
 
+  const bool overloaded = (header.flags & STORED_Header::OVERLOADED) ||
+      header.status == E::DROPPED;
+  if (overloaded) {
+    WORKER_STAT_INCR(rebuilding_donor_overloaded_received);
+  }
+  if (overloaded || header.status == E::OK) {
+    auto settings = owner_->getRebuildingSettings();
+    if (overloaded && settings->throttle_on_overload) {
+      // Like Appender, avoid picking the recipient in new copysets for a
+      // while.
+      replication_->nodeset_state->setNotAvailableUntil(
+          from,
+          std::chrono::steady_clock::now() +
+              getSettings().overloaded_retry_interval,
+          NodeSetState::NotAvailableReason::OVERLOADED);
+    }
+    auto controller = RebuildingBandwidthController::get();
+    if (controller) {
+      controller->onStoreReply(overloaded, *settings.get());
+    }
+  }
+
   bool amend = curStageRecipient_->type != StageRecipients::Type::STORE;
   if (header.status != E::OK) {
     traceEvent(
@@ -8,6 +8,7 @@
 #include "ReleaseRequest.h"
 
 #include "logdevice/common/debug.h"
+#include "logdevice/common/util.h"
 #include "logdevice/server/ServerProcessor.h"
 #include "logdevice/server/ServerWorker.h"
 #include "logdevice/server/read_path/AllServerReadStreams.h"
@@ -16,12 +17,15 @@
 namespace facebook { namespace logdevice {
 
 Request::Execution ReleaseRequest::execute() {
-  ld_spew("ReleaseRequest(%s) running on worker %s for shard %u",
-          rid_.toString().c_str(),
-          Worker::onThisThread()->getName().c_str(),
-          shard_);
-  ServerWorker::onThisThread()->serverReadStreams().onRelease(
-      rid_, shard_, force_);
+  AllServerReadStreams& streams =
+      ServerWorker::onThisThread()->serverReadStreams();
+  for (const Release& release : releases_) {
+    ld_spew("ReleaseRequest(%s) running on worker %s for shard %u",
+            release.rid.toString().c_str(),
+            Worker::onThisThread()->getName().c_str(),
+            release.shard);
+    streams.onRelease(release.rid, release.shard, release.force);
+  }
   return Execution::COMPLETE;
 }
 
@@ -36,4 +40,73 @@ void ReleaseRequest::retry(ServerProcessor* processor,
       .retryRelease(idx, force);
 }
 
+ReleaseRequestBatch::ReleaseRequestBatch(ServerProcessor* processor)
+    : processor_(processor),
+      registered_(true),
+      releases_(processor->getWorkerCount(WorkerType::GENERAL)) {
+  ServerWorker* w = ServerWorker::onThisThread();
+  ld_check(w->release_request_batch_ == nullptr);
+  w->release_request_batch_ = this;
+}
+
+ReleaseRequestBatch::ReleaseRequestBatch(size_t nworkers)
+    : releases_(nworkers) {}
+
+ReleaseRequestBatch::~ReleaseRequestBatch() {
+  if (registered_) {
+    ServerWorker* w = ServerWorker::onThisThread();
+    ld_check(w->release_request_batch_ == this);
+    w->release_request_batch_ = nullptr;
+  }
+  post();
+}
+
+void ReleaseRequestBatch::post() {
+  for (size_t i = 0; i < releases_.size(); ++i) {
+    if (releases_[i].empty()) {
+      continue;
+    }
+    const worker_id_t idx(i);
+    std::unique_ptr<Request> req =
+        std::make_unique<ReleaseRequest>(idx, std::move(releases_[i]));
+    releases_[i].clear();
+    if (postRequest(req) != 0) {
+      ld_check(req);
+      const auto& releases =
+          checked_downcast<ReleaseRequest&>(*req).getReleases();
+      RATELIMIT_ERROR(std::chrono::seconds(10),
+                      5,
+                      "Could not propagate %zu RELEASEs to worker #%d.  "
+                      "postRequest() failed with error %s",
+                      releases.size(),
+                      idx.val_,
+                      error_description(err));
+      for (const ReleaseRequest::Release& release : releases) {
+        retry(idx, release);
+      }
+    }
+  }
+}
+
+int ReleaseRequestBatch::postRequest(std::unique_ptr<Request>& req) {
+  return processor_->postRequest(req);
+}
+
+void ReleaseRequestBatch::retry(worker_id_t target,
+                                const ReleaseRequest::Release& release) {
+  ReleaseRequest::retry(
+      processor_, release.rid.logid, release.shard, target, release.force);
+}
+
+ReleaseRequestBatch* ReleaseRequestBatch::current() {
+  ServerWorker* w = ServerWorker::onThisThread(false);
+  return w ? w->release_request_batch_ : nullptr;
+}
+
+void ReleaseRequestBatch::add(worker_id_t target,
+                              const ReleaseRequest::Release& release) {
+  ld_check(target.val_ >= 0 && size_t(target.val_) < releases_.size());
+  releases_[target.val_].push_back(release);
+}
+
 }} // namespace facebook::logdevice
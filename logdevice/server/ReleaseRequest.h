@@ -7,6 +7,11 @@
  */
 #pragma once
 
+#include <memory>
+#include <vector>
+
+#include <folly/small_vector.h>
+
 #include "logdevice/common/RecordID.h"
 #include "logdevice/common/Request.h"
 #include "logdevice/common/RequestType.h"
@@ -26,10 +31,20 @@ enum class ReleaseType : uint8_t;
  *
  * The worker receiving this request reads the new record from the local log
  * store and sends it to clients reading from the log.
+ *
+ * While processing a RELEASE_BATCH message, the releases of all the logs in
+ * the batch are collected by a ReleaseRequestBatch, and each worker gets a
+ * single request carrying the releases of the logs it is subscribed to.
  */
 
 class ReleaseRequest : public Request {
  public:
+  struct Release {
+    RecordID rid;
+    shard_index_t shard;
+    bool force;
+  };
+
   /**
    * @param target        worker thread that should process this request
    * @param rid           record that was released
@@ -44,9 +59,16 @@ class ReleaseRequest : public Request {
                           bool force)
       : Request(RequestType::RELEASE),
         target_(target),
-        rid_(rid),
-        shard_(shard),
-        force_(force) {}
+        releases_({Release{rid, shard, force}}) {}
+
+  /**
+   * Carries the releases of several logs to the same worker.
+   */
+  ReleaseRequest(worker_id_t target,
+                 folly::small_vector<Release, 1> releases)
+      : Request(RequestType::RELEASE),
+        target_(target),
+        releases_(std::move(releases)) {}
 
   int getThreadAffinity(int /*nthreads*/) override {
     // ReleaseRequest gets targeted at a specific worker.  Multiple instances
@@ -56,9 +78,14 @@ class ReleaseRequest : public Request {
 
   Request::Execution execute() override;
 
+  const folly::small_vector<Release, 1>& getReleases() const {
+    return releases_;
+  }
+
   /**
    * A helper function to post a new ReleaseRequest on all workers for
-   * which filter functor returns true.
+   * which filter functor returns true.  If a ReleaseRequestBatch is active on
+   * this thread, the release is added to it instead.
    *
    * @param processor     Processor object used to post a new request
    * @param rid           record part of the ReleaseRequest
@@ -71,39 +98,98 @@ class ReleaseRequest : public Request {
                                       RecordID const& rid,
                                       shard_index_t shard,
                                       Func&& filter,
-                                      bool force = false) {
-    processor->applyToWorkerIdxs(
-        [&](worker_id_t idx, WorkerType /*unused*/) {
-          if (!filter(idx)) {
-            return;
-          }
-
-          std::unique_ptr<Request> req =
-              std::make_unique<ReleaseRequest>(idx, rid, shard, force);
-          if (processor->postRequest(req) != 0) {
-            RATELIMIT_ERROR(std::chrono::seconds(10),
-                            5,
-                            "Could not propagate RELEASE %s to worker #%d.  "
-                            "postRequest() failed "
-                            "with error %s",
-                            rid.toString().c_str(),
-                            idx.val_,
-                            error_description(err));
-            retry(processor, rid.logid, shard, idx, force);
-          }
-        },
-        Processor::Order::FORWARD,
-        WorkerType::GENERAL);
-  }
+                                      bool force = false);
 
   static void
   retry(ServerProcessor*, logid_t, shard_index_t, worker_id_t, bool force);
 
  private:
   worker_id_t target_;
-  RecordID rid_;
-  shard_index_t shard_;
-  bool force_;
+  folly::small_vector<Release, 1> releases_;
 };
 
+/**
+ * While an instance is alive on a worker thread,
+ * ReleaseRequest::broadcastReleaseRequest() called on that thread collects
+ * releases per target worker instead of posting a request for each.  The
+ * destructor posts one ReleaseRequest per worker with all of them.  Used to
+ * notify workers of all the releases of a RELEASE_BATCH message at once.
+ * Instances don't nest.
+ */
+class ReleaseRequestBatch {
+ public:
+  explicit ReleaseRequestBatch(ServerProcessor* processor);
+  virtual ~ReleaseRequestBatch();
+
+  ReleaseRequestBatch(const ReleaseRequestBatch&) = delete;
+  ReleaseRequestBatch& operator=(const ReleaseRequestBatch&) = delete;
+
+  /**
+   * @return the batch active on this thread, or nullptr.
+   */
+  static ReleaseRequestBatch* current();
+
+  void add(worker_id_t target, const ReleaseRequest::Release& release);
+
+  /**
+   * Posts one ReleaseRequest to each worker that has releases, and empties
+   * the batch.  Releases that can't be posted are retried through
+   * LogStorageState::retryRelease().  Called by the destructor.
+   */
+  void post();
+
+ protected:
+  // Used in tests: collects releases for `nworkers' workers, without being
+  // registered on the current thread.
+  explicit ReleaseRequestBatch(size_t nworkers);
+
+  virtual int postRequest(std::unique_ptr<Request>& req);
+
+  virtual void retry(worker_id_t target,
+                     const ReleaseRequest::Release& release);
+
+ private:
+  ServerProcessor* processor_{nullptr};
+  // Whether the batch is registered on this thread, see current().
+  bool registered_{false};
+  // Indexed by worker.
+  std::vector<folly::small_vector<ReleaseRequest::Release, 1>> releases_;
+};
+
+template <typename Func>
+void ReleaseRequest::broadcastReleaseRequest(ServerProcessor* processor,
+                                             RecordID const& rid,
+                                             shard_index_t shard,
+                                             Func&& filter,
+                                             bool force) {
+  ReleaseRequestBatch* batch = ReleaseRequestBatch::current();
+  processor->applyToWorkerIdxs(
+      [&](worker_id_t idx, WorkerType /*unused*/) {
+        if (!filter(idx)) {
+          return;
+        }
+
+        if (batch) {
+          batch->add(idx, Release{rid, shard, force});
+          return;
+        }
+
+        std::unique_ptr<Request> req =
+            std::make_unique<ReleaseRequest>(idx, rid, shard, force);
+        if (processor->postRequest(req) != 0) {
+          RATELIMIT_ERROR(std::chrono::seconds(10),
+                          5,
+                          "Could not propagate RELEASE %s to worker #%d.  "
+                          "postRequest() failed "
+                          "with error %s",
+                          rid.toString().c_str(),
+                          idx.val_,
+                          error_description(err));
+          retry(processor, rid.logid, shard, idx, force);
+        }
+      },
+      Processor::Order::FORWARD,
+      WorkerType::GENERAL);
+}
+
 }} // namespace facebook::logdevice
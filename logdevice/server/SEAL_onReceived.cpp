@@ -11,6 +11,7 @@
 #include "logdevice/common/Sender.h"
 #include "logdevice/common/configuration/ServerConfig.h"
 #include "logdevice/common/protocol/SEALED_Message.h"
+#include "logdevice/common/stats/Stats.h"
 #include "logdevice/server/ServerProcessor.h"
 #include "logdevice/server/ServerWorker.h"
 #include "logdevice/server/read_path/LogStorageStateMap.h"
@@ -20,8 +21,11 @@
 
 namespace facebook { namespace logdevice {
 
-Message::Disposition SEAL_onReceived(SEAL_Message* msg, const Address& from) {
-  const SEAL_Header& header = msg->getHeader();
+namespace {
+
+// Validates the SEAL in `header' and seals the log, or replies with an error.
+Message::Disposition handleSeal(const SEAL_Header& header,
+                                const Address& from) {
   ServerWorker* worker = ServerWorker::onThisThread();
 
   if (header.log_id == LOGID_INVALID || !epoch_valid(header.seal_epoch)) {
@@ -142,4 +146,28 @@ Message::Disposition SEAL_onReceived(SEAL_Message* msg, const Address& from) {
 
   return Message::Disposition::NORMAL;
 }
+
+} // namespace
+
+Message::Disposition SEAL_onReceived(SEAL_Message* msg, const Address& from) {
+  return handleSeal(msg->getHeader(), from);
+}
+
+Message::Disposition SEAL_BATCH_onReceived(SEAL_BATCH_Message* msg,
+                                           const Address& from) {
+  WORKER_STAT_INCR(seal_batches_received);
+  WORKER_STAT_ADD(seal_batch_seals_received, msg->headers_.size());
+
+  // Each SEAL is answered with its own SEALED, as if it came in a SEAL
+  // message.
+  for (const SEAL_Header& header : msg->headers_) {
+    if (handleSeal(header, from) == Message::Disposition::ERROR) {
+      // The sequencer will resend the remaining SEALs when the connection is
+      // closed.
+      return Message::Disposition::ERROR;
+    }
+  }
+  return Message::Disposition::NORMAL;
+}
+
 }} // namespace facebook::logdevice
@@ -8,6 +8,7 @@
 #pragma once
 
 #include "logdevice/common/protocol/Message.h"
+#include "logdevice/common/protocol/SEAL_BATCH_Message.h"
 #include "logdevice/common/protocol/SEAL_Message.h"
 
 namespace facebook { namespace logdevice {
@@ -15,4 +16,7 @@ namespace facebook { namespace logdevice {
 struct Address;
 
 Message::Disposition SEAL_onReceived(SEAL_Message* msg, const Address& from);
+
+Message::Disposition SEAL_BATCH_onReceived(SEAL_BATCH_Message* msg,
+                                           const Address& from);
 }} // namespace facebook::logdevice
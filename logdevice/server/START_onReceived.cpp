@@ -16,6 +16,7 @@
 #include "logdevice/server/RecordCache.h"
 #include "logdevice/server/ServerProcessor.h"
 #include "logdevice/server/ServerRecordFilterFactory.h"
+#include "logdevice/server/ServerRecordSamplerFactory.h"
 #include "logdevice/server/ServerWorker.h"
 #include "logdevice/server/read_path/AllServerReadStreams.h"
 #include "logdevice/server/read_path/ServerReadStream.h"
@@ -183,6 +184,22 @@ Message::Disposition START_onReceived(START_Message* msg, const Address& from) {
     return Message::Disposition::ERROR;
   }
 
+  if ((header.flags & START_Header::SAMPLE) &&
+      !isValidSampleParam(msg->attrs_.sample_mode, msg->attrs_.sample_param)) {
+    // Reading all records instead would silently defeat the sampling; let
+    // the client know instead.
+    RATELIMIT_ERROR(std::chrono::seconds(10),
+                    10,
+                    "START message from %s for log %lu has invalid sampling "
+                    "parameter %lu for mode %d",
+                    Sender::describeConnection(from).c_str(),
+                    header.log_id.val_,
+                    msg->attrs_.sample_param,
+                    static_cast<int>(msg->attrs_.sample_mode));
+    WORKER_STAT_INCR(read_streams_invalid_sample_param);
+    return send_error_reply(msg, from, E::INVALID_PARAM);
+  }
+
   std::shared_ptr<PermissionChecker> permission_checker =
       Worker::onThisThread()
           ->processor_->security_info_->getPermissionChecker();
@@ -562,6 +579,17 @@ onReceivedContinuation(START_Message* msg,
     }
   }
 
+  stream->sampler_.reset();
+  if (header.flags & START_Header::SAMPLE) {
+    stream->sampler_ = ServerRecordSamplerFactory::create(msg->attrs_);
+    if (stream->sampler_ != nullptr) {
+      RATELIMIT_INFO(std::chrono::seconds(10),
+                     1,
+                     "Server-side sampling is enabled. %s",
+                     stream->sampler_->toString().c_str());
+    }
+  }
+
   w->processor_->getLogStorageStateMap().recoverLogState(
       header.log_id, shard_idx, LogStorageState::RecoverContext::START_MESSAGE);
   w->serverReadStreams().notifyNeedsCatchup(*stream, /* allow_delay */ false);
@@ -301,6 +301,15 @@ ServerParameters::ServerParameters(
     throw ConstructorFailed();
   }
 
+  if (processor_settings_->output_adaptive_min_records_kb >
+      processor_settings_->output_adaptive_max_records_kb) {
+    ld_error("--output-adaptive-min-records-kb (%zd) is greater than "
+             "--output-adaptive-max-records-kb (%zd)",
+             processor_settings_->output_adaptive_min_records_kb,
+             processor_settings_->output_adaptive_max_records_kb);
+    throw ConstructorFailed();
+  }
+
   // Construct the Server Trace Logger
   if (processor_settings_->trace_logger_disabled) {
     trace_logger_ = std::make_shared<NoopTraceLogger>(updateable_config_);
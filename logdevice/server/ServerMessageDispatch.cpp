@@ -13,6 +13,8 @@
 
 #include "logdevice/common/protocol/CLEAN_Message.h"
 #include "logdevice/common/protocol/MessageTypeNames.h"
+#include "logdevice/common/protocol/READ_CONTROL_BATCH_Message.h"
+#include "logdevice/common/protocol/RELEASE_BATCH_Message.h"
 #include "logdevice/common/protocol/RELEASE_Message.h"
 #include "logdevice/common/protocol/STOP_Message.h"
 #include "logdevice/common/protocol/STORE_Message.h"
@@ -117,13 +119,25 @@ ServerMessageDispatch::onReceivedImpl(Message* msg, const Address& from) {
       return NODE_STATS_AGGREGATE_REPLY_onReceived(
           checked_downcast<NODE_STATS_AGGREGATE_REPLY_Message*>(msg), from);
 
+    case MessageType::READ_CONTROL_BATCH:
+      return onReadControlBatch(
+          checked_downcast<READ_CONTROL_BATCH_Message*>(msg), from);
+
     case MessageType::RELEASE:
       return PurgeCoordinator::onReceived(
           checked_downcast<RELEASE_Message*>(msg), from);
 
+    case MessageType::RELEASE_BATCH:
+      return PurgeCoordinator::onReceived(
+          checked_downcast<RELEASE_BATCH_Message*>(msg), from);
+
     case MessageType::SEAL:
       return SEAL_onReceived(checked_downcast<SEAL_Message*>(msg), from);
 
+    case MessageType::SEAL_BATCH:
+      return SEAL_BATCH_onReceived(
+          checked_downcast<SEAL_BATCH_Message*>(msg), from);
+
     case MessageType::START:
       return START_onReceived(checked_downcast<START_Message*>(msg), from);
 
@@ -158,6 +172,24 @@ ServerMessageDispatch::onReceivedImpl(Message* msg, const Address& from) {
   }
 }
 
+Message::Disposition
+ServerMessageDispatch::onReadControlBatch(READ_CONTROL_BATCH_Message* msg,
+                                          const Address& from) {
+  for (auto& embedded : msg->messages_) {
+    ld_check(READ_CONTROL_BATCH_Message::canBatch(embedded->type_));
+    // The handler may take ownership of the message (Disposition::KEEP).
+    Message* m = embedded.release();
+    Message::Disposition disp = onReceivedImpl(m, from);
+    if (disp != Message::Disposition::KEEP) {
+      delete m;
+    }
+    if (disp == Message::Disposition::ERROR) {
+      return disp;
+    }
+  }
+  return Message::Disposition::NORMAL;
+}
+
 void ServerMessageDispatch::onSentImpl(const Message& msg,
                                        Status st,
                                        const Address& to,
@@ -16,6 +16,8 @@
 
 namespace facebook { namespace logdevice {
 
+class READ_CONTROL_BATCH_Message;
+
 class ServerMessageDispatch : public MessageDispatch {
  public:
   Message::Disposition onReceivedImpl(Message* msg,
@@ -24,5 +26,11 @@ class ServerMessageDispatch : public MessageDispatch {
                   Status st,
                   const Address& to,
                   const SteadyTimestamp enqueue_time) override;
+
+ private:
+  // Handles each message embedded in a READ_CONTROL_BATCH in order, as if it
+  // had been received on its own.
+  Message::Disposition onReadControlBatch(READ_CONTROL_BATCH_Message* msg,
+                                          const Address& from);
 };
 }} // namespace facebook::logdevice
@@ -18,6 +18,7 @@
 #include "logdevice/server/ServerSettings.h"
 #include "logdevice/server/ServerWorker.h"
 #include "logdevice/server/read_path/LogStorageStateMap.h"
+#include "logdevice/server/rebuilding/RebuildingBandwidthController.h"
 
 /**
  * @file Subclass of Processor containing state specific to servers, also
@@ -65,6 +66,10 @@ class ServerProcessor : public Processor {
 
   LogStorageStateMap& getLogStorageStateMap() const;
 
+  RebuildingBandwidthController& getRebuildingBandwidthController() {
+    return rebuilding_bandwidth_controller_;
+  }
+
   // Alternative factory for tests that need to construct a half-baked
   // Processor (no workers etc).
   template <typename... Args>
@@ -125,6 +130,8 @@ class ServerProcessor : public Processor {
   UpdateableSettings<ServerSettings> server_settings_;
   UpdateableSettings<GossipSettings> gossip_settings_;
   std::unique_ptr<LogStorageStateMap> log_storage_state_map_;
+  // Throttles rebuilding on this donor while recipients are overloaded.
+  RebuildingBandwidthController rebuilding_bandwidth_controller_;
   UpdateableSettings<Settings>::SubscriptionHandle settings_subscription_;
 };
 }} // namespace facebook::logdevice
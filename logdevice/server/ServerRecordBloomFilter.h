@@ -0,0 +1,50 @@
+/**
+ * Copyright (c) 2017-present, Facebook, Inc. and its affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+#include <sstream>
+#include <string>
+#include <folly/Range.h>
+#include "logdevice/common/ServerRecordFilter.h"
+#include "logdevice/common/ServerRecordFilterEncoding.h"
+
+namespace facebook { namespace logdevice {
+
+/**
+ * @file ServerRecordBloomFilter passes records whose key may be in the set of
+ *       keys the reader built a bloom filter from with
+ *       ServerRecordFilterEncoding::buildBloomFilter(). Lets readers interested
+ *       in a large set of keys send a compact filter, at the cost of some
+ *       false positives. Experimental feature: Use with caution.
+ */
+
+class ServerRecordBloomFilter final : public ServerRecordFilter {
+ public:
+  /**
+   * @param bloom_filter   must be valid, see
+   *                       ServerRecordFilterEncoding::isValidBloomFilter()
+   */
+  explicit ServerRecordBloomFilter(folly::StringPiece bloom_filter)
+      : bloom_filter_(bloom_filter.str()) {}
+
+  bool operator()(folly::StringPiece record_key) override {
+    return ServerRecordFilterEncoding::bloomFilterMayContain(
+        bloom_filter_, record_key);
+  }
+
+  std::string toString() const override {
+    std::stringstream ss;
+    ss << "Server-side filter type: BLOOM, " << (bloom_filter_.size() - 1) * 8
+       << " bits, " << static_cast<int>(bloom_filter_[0]) << " hashes";
+    return ss.str();
+  }
+
+ private:
+  const std::string bloom_filter_;
+};
+}} // namespace facebook::logdevice
@@ -0,0 +1,47 @@
+/**
+ * Copyright (c) 2017-present, Facebook, Inc. and its affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+#include <chrono>
+#include <sstream>
+#include <string>
+
+#include "logdevice/common/ServerRecordSampler.h"
+#include "logdevice/common/checks.h"
+#include "logdevice/common/types_internal.h"
+
+namespace facebook { namespace logdevice {
+
+/**
+ *  @file Sampler that keeps the records whose ESN is a multiple of N. Since
+ *  the decision only depends on the LSN, the sampled set does not depend on
+ *  which storage node ships each record, nor on the read stream being
+ *  restarted. Created by ServerRecordSamplerFactory and owned by
+ *  ServerReadStream.
+ */
+
+class ServerRecordEveryNthSampler final : public ServerRecordSampler {
+ public:
+  explicit ServerRecordEveryNthSampler(uint64_t n) : n_(n) {
+    ld_check(n_ > 0);
+  }
+
+  bool operator()(lsn_t lsn, std::chrono::milliseconds /*timestamp*/) override {
+    return lsn_to_esn(lsn).val_ % n_ == 0;
+  }
+
+  std::string toString() const override {
+    std::stringstream ss;
+    ss << "Server-side sampler mode: EVERY_NTH, n: " << n_;
+    return ss.str();
+  }
+
+ private:
+  const uint64_t n_;
+};
+}} // namespace facebook::logdevice
@@ -13,7 +13,11 @@
 #include "logdevice/common/ReadStreamAttributes.h"
 #include "logdevice/common/ServerRecordFilter.h"
 #include "logdevice/common/debug.h"
+#include "logdevice/common/ServerRecordFilterEncoding.h"
+#include "logdevice/server/ServerRecordBloomFilter.h"
 #include "logdevice/server/ServerRecordEqualityFilter.h"
+#include "logdevice/server/ServerRecordKeySetFilter.h"
+#include "logdevice/server/ServerRecordPrefixFilter.h"
 #include "logdevice/server/ServerRecordRangeFilter.h"
 
 namespace facebook { namespace logdevice {
@@ -31,6 +35,7 @@ class ServerRecordFilterFactory {
    *         key1  param for constructing ServerRecordFilter
    *         key2  param for constructing ServerRecordFilter, only used for
    *               ServerRecordRangeFilter. Serves as high_limit_.
+   *               Not used by PREFIX, KEY_SET and BLOOM filters.
    *  @return      unique_ptr to a ServerRecordFilter object; return nullptr
    *               if parameters are invalid.
    */
@@ -50,6 +55,25 @@ class ServerRecordFilterFactory {
           return nullptr;
         }
         return std::make_unique<ServerRecordRangeFilter>(key1, key2);
+      case ServerRecordFilterType::PREFIX:
+        return std::make_unique<ServerRecordPrefixFilter>(key1);
+      case ServerRecordFilterType::KEY_SET: {
+        auto filter = ServerRecordKeySetFilter::create(key1);
+        if (filter == nullptr) {
+          ld_error("ServerRecordKeySetFilter failed to construct. Malformed "
+                   "key set of size %zu",
+                   key1.size());
+        }
+        return std::move(filter);
+      }
+      case ServerRecordFilterType::BLOOM:
+        if (!ServerRecordFilterEncoding::isValidBloomFilter(key1)) {
+          ld_error("ServerRecordBloomFilter failed to construct. Malformed "
+                   "bloom filter of size %zu",
+                   key1.size());
+          return nullptr;
+        }
+        return std::make_unique<ServerRecordBloomFilter>(key1);
       case ServerRecordFilterType::NOFILTER:
         return nullptr;
       default:
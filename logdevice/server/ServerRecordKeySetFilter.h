@@ -0,0 +1,64 @@
+/**
+ * Copyright (c) 2017-present, Facebook, Inc. and its affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+#include <memory>
+#include <sstream>
+#include <string>
+#include <unordered_set>
+#include <vector>
+#include <folly/Range.h>
+#include "logdevice/common/ServerRecordFilter.h"
+#include "logdevice/common/ServerRecordFilterEncoding.h"
+
+namespace facebook { namespace logdevice {
+
+/**
+ * @file ServerRecordKeySetFilter passes records whose key is in a set of keys
+ *       sent by the reader, encoded with
+ *       ServerRecordFilterEncoding::encodeKeySet(). Experimental feature: Use
+ *       with caution.
+ */
+
+class ServerRecordKeySetFilter final : public ServerRecordFilter {
+ public:
+  /**
+   * @param encoded   encoded set of keys passing the filter
+   * @return          the filter, or nullptr if `encoded' is malformed
+   */
+  static std::unique_ptr<ServerRecordKeySetFilter>
+  create(folly::StringPiece encoded) {
+    std::unique_ptr<ServerRecordKeySetFilter> filter(
+        new ServerRecordKeySetFilter(encoded.str()));
+    // Decode from our own copy so that the set can point into it.
+    std::vector<folly::StringPiece> keys;
+    if (!ServerRecordFilterEncoding::decodeKeySet(filter->encoded_, &keys)) {
+      return nullptr;
+    }
+    filter->keys_.insert(keys.begin(), keys.end());
+    return filter;
+  }
+
+  bool operator()(folly::StringPiece record_key) override {
+    return keys_.count(record_key) > 0;
+  }
+
+  std::string toString() const override {
+    std::stringstream ss;
+    ss << "Server-side filter type: KEY_SET, " << keys_.size() << " keys";
+    return ss.str();
+  }
+
+ private:
+  explicit ServerRecordKeySetFilter(std::string encoded)
+      : encoded_(std::move(encoded)) {}
+
+  const std::string encoded_;
+  std::unordered_set<folly::StringPiece> keys_;
+};
+}} // namespace facebook::logdevice
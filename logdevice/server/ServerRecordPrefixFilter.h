@@ -0,0 +1,43 @@
+/**
+ * Copyright (c) 2017-present, Facebook, Inc. and its affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+#include <sstream>
+#include <string>
+#include <folly/Range.h>
+#include "logdevice/common/ServerRecordFilter.h"
+
+namespace facebook { namespace logdevice {
+
+/**
+ * @file ServerRecordPrefixFilter passes records whose key starts with a given
+ *       prefix. Experimental feature: Use with caution.
+ */
+
+class ServerRecordPrefixFilter final : public ServerRecordFilter {
+ public:
+  /**
+   * @param prefix   prefix of the keys passing the filter
+   */
+  explicit ServerRecordPrefixFilter(folly::StringPiece prefix)
+      : prefix_(prefix.str()) {}
+
+  bool operator()(folly::StringPiece record_key) override {
+    return record_key.startsWith(prefix_);
+  }
+
+  std::string toString() const override {
+    std::stringstream ss;
+    ss << "Server-side filter type: PREFIX, prefix: " << prefix_;
+    return ss.str();
+  }
+
+ private:
+  const std::string prefix_;
+};
+}} // namespace facebook::logdevice
@@ -0,0 +1,67 @@
+/**
+ * Copyright (c) 2017-present, Facebook, Inc. and its affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+#include <chrono>
+#include <memory>
+
+#include "logdevice/common/ReadStreamAttributes.h"
+#include "logdevice/common/ServerRecordSampler.h"
+#include "logdevice/common/debug.h"
+#include "logdevice/server/ServerRecordEveryNthSampler.h"
+#include "logdevice/server/ServerRecordTimeBucketSampler.h"
+
+namespace facebook { namespace logdevice {
+
+/**
+ *  @file Factory class for creating a ServerRecordSampler of the specified
+ *        mode.
+ */
+
+class ServerRecordSamplerFactory {
+ public:
+  /**
+   *  @param mode   specifies the sampling mode. Defined in
+   *                ServerRecordSampler.h
+   *         param  N for EVERY_NTH, bucket width in milliseconds for
+   *                TIME_BUCKET
+   *  @return       unique_ptr to a ServerRecordSampler object; nullptr if mode
+   *                is NONE or parameters are invalid.
+   */
+  static std::unique_ptr<ServerRecordSampler>
+  create(ServerRecordSampleMode mode, uint64_t param) {
+    switch (mode) {
+      case ServerRecordSampleMode::NONE:
+        return nullptr;
+      case ServerRecordSampleMode::EVERY_NTH:
+      case ServerRecordSampleMode::TIME_BUCKET:
+        if (!isValidSampleParam(mode, param)) {
+          ld_error("ServerRecordSampler failed to construct. Invalid "
+                   "parameter %lu for mode %d",
+                   param,
+                   static_cast<int>(mode));
+          return nullptr;
+        }
+        if (mode == ServerRecordSampleMode::EVERY_NTH) {
+          return std::make_unique<ServerRecordEveryNthSampler>(param);
+        }
+        return std::make_unique<ServerRecordTimeBucketSampler>(
+            std::chrono::milliseconds(param));
+      default:
+        ld_error("ServerRecordSampleMode provided is not defined: %d",
+                 static_cast<int>(mode));
+    }
+    return nullptr;
+  }
+
+  static std::unique_ptr<ServerRecordSampler>
+  create(const ReadStreamAttributes& attrs) {
+    return create(attrs.sample_mode, attrs.sample_param);
+  }
+};
+}} // namespace facebook::logdevice
@@ -0,0 +1,56 @@
+/**
+ * Copyright (c) 2017-present, Facebook, Inc. and its affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+#include <chrono>
+#include <sstream>
+#include <string>
+
+#include "logdevice/common/ServerRecordSampler.h"
+#include "logdevice/common/checks.h"
+
+namespace facebook { namespace logdevice {
+
+/**
+ *  @file Sampler that keeps the first record shipped in each time bucket of
+ *  `width' milliseconds, based on the record timestamp. Timestamps are not
+ *  strictly monotonic in a log; a record whose bucket differs from the one of
+ *  the last sampled record starts a new bucket. Created by
+ *  ServerRecordSamplerFactory and owned by ServerReadStream.
+ */
+
+class ServerRecordTimeBucketSampler final : public ServerRecordSampler {
+ public:
+  explicit ServerRecordTimeBucketSampler(std::chrono::milliseconds width)
+      : width_(width) {
+    ld_check(width_.count() > 0);
+  }
+
+  bool operator()(lsn_t /*lsn*/, std::chrono::milliseconds timestamp) override {
+    const int64_t bucket = timestamp.count() / width_.count();
+    if (has_sampled_ && bucket == last_bucket_) {
+      return false;
+    }
+    has_sampled_ = true;
+    last_bucket_ = bucket;
+    return true;
+  }
+
+  std::string toString() const override {
+    std::stringstream ss;
+    ss << "Server-side sampler mode: TIME_BUCKET, width: " << width_.count()
+       << "ms";
+    return ss.str();
+  }
+
+ private:
+  const std::chrono::milliseconds width_;
+  bool has_sampled_{false};
+  int64_t last_bucket_{0};
+};
+}} // namespace facebook::logdevice
@@ -23,6 +23,7 @@ class AllServerReadStreams;
 class NodeStatsControllerCallback;
 class PerWorkerStorageTaskQueue;
 class PurgeScheduler;
+class ReleaseRequestBatch;
 class StorageThreadPool;
 class ServerProcessor;
 class ServerWorkerImpl;
@@ -79,6 +80,10 @@ class ServerWorker : public Worker {
 
   std::unique_ptr<AllServerReadStreams> server_read_streams_;
 
+  // Set while this worker handles a RELEASE_BATCH message, see
+  // ReleaseRequestBatch.
+  ReleaseRequestBatch* release_request_batch_{nullptr};
+
   // This overrides Worker::onSettingsUpdated() but calls it first thing
   void onSettingsUpdated() override;
 
@@ -50,7 +50,12 @@ class InfoCatchupQueues : public AdminCommand {
                                  "Record Bytes Queued",
                                  "Storage task in flight",
                                  "Ping Timer Active",
-                                 "Blocked");
+                                 "Blocked",
+                                 "Read Weight",
+                                 "Max Queue Delay Ms",
+                                 "Avg Queue Delay Ms",
+                                 "Stream Queue Delays Ms",
+                                 "Waiting For Turn");
 
     auto tables = run_on_all_workers(server_->getProcessor(), [&]() {
       InfoCatchupQueuesTable t(table);
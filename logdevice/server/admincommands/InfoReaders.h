@@ -106,7 +106,8 @@ class InfoReaders : public AdminCommand {
                            "Last Enqueue Time",
                            "Last Batch Started Time",
                            "Storage task in flight",
-                           "version");
+                           "version",
+                           "Filtered out bytes");
 
     auto tables = run_on_all_workers(server_->getProcessor(), [&]() {
       InfoReadersTable t(table);
@@ -16,7 +16,9 @@
 #include "logdevice/common/stats/PerShardHistograms.h"
 #include "logdevice/common/stats/ServerHistograms.h"
 #include "logdevice/server/AdminCommand.h"
+#include "logdevice/server/ServerProcessor.h"
 #include "logdevice/server/locallogstore/ShardedRocksDBLocalLogStore.h"
+#include "logdevice/server/storage_tasks/ShardedStorageThreadPool.h"
 
 namespace facebook { namespace logdevice { namespace commands {
 
@@ -460,4 +462,80 @@ class TrafficShapingHistogram : public TrafficShapingHistogramBase {
   std::vector<std::unique_ptr<PerFlowGroupStats>> aggregated_flow_group_stats_;
 };
 
+// Time storage tasks spent queued, per principal the tasks run on behalf of.
+// Only covers tasks that identify their principal, e.g. reads of clients.
+using StorageTaskQueueTimeHistogramBase =
+    StatsHistogramBase<std::string /*principal*/, int /*shard*/>;
+class StorageTaskQueueTimeHistogram : public StorageTaskQueueTimeHistogramBase {
+ public:
+  std::string getUsage() override {
+    return "stats2 storage_task_queue_time [--principal=NAME] [--shard=N] " +
+        StorageTaskQueueTimeHistogramBase::getUsage();
+  }
+
+  void getOptions(boost::program_options::options_description& opts) override {
+    opts.add_options()(
+        "principal", boost::program_options::value<std::string>(&principal_))(
+        "shard", boost::program_options::value<shard_index_t>(&shard_));
+    StorageTaskQueueTimeHistogramBase::getOptions(opts);
+  }
+
+  void run() override {
+    if (!server_->getProcessor()->runningOnStorageNode()) {
+      out_.printf("Not a storage node.\r\n");
+      return;
+    }
+    execute("Principal", "Shard");
+  }
+
+ private:
+  std::string principal_;
+  shard_index_t shard_{-1};
+
+  // The histograms are kept by the storage thread pools rather than in the
+  // thread-local stats, so `stats' is not used.
+  std::vector<HistTuple>
+  findHistograms(facebook::logdevice::Stats& /*stats*/) override {
+    std::vector<HistTuple> hists;
+    ld_check(server_->getShardedLocalLogStore() != nullptr);
+    shard_index_t shard_lo = 0;
+    shard_index_t shard_hi =
+        server_->getShardedLocalLogStore()->numShards() - 1;
+    if (shard_ != -1) {
+      if (shard_ < shard_lo || shard_ > shard_hi) {
+        out_.printf("Shard index out or range\r\n");
+        return hists;
+      }
+      shard_lo = shard_hi = shard_;
+    }
+
+    for (shard_index_t idx = shard_lo; idx <= shard_hi; ++idx) {
+      server_->getServerProcessor()
+          ->sharded_storage_thread_pool_->getByIndex(idx)
+          .forEachPrincipalQueueTime(
+              [&](const std::string& principal, LatencyHistogram* hist) {
+                if (principal_.empty() || principal == principal_) {
+                  hists.push_back(HistTuple(
+                      "storage_task_queue_time", hist, principal, idx));
+                }
+              });
+    }
+    return hists;
+  }
+
+  void setUniqueCols(HistTuple& tuple, SummaryTable& table) override {
+    table.set<1>(std::get<2>(tuple));
+    table.set<2>(std::get<3>(tuple));
+  }
+
+  void printHist(HistTuple& tuple) override {
+    std::ostringstream oss;
+    std::get<1>(tuple)->print(oss);
+    out_.printf("Principal %s: Shard %d: storage_task_queue_time\r\n%s\r\n",
+                std::get<2>(tuple).c_str(),
+                std::get<3>(tuple),
+                oss.str().c_str());
+  }
+};
+
 }}} // namespace facebook::logdevice::commands
@@ -418,6 +418,9 @@ class LocalLogStore : boost::noncopyable {
     size_t read_csi_entries{0};
     size_t filtered_csi_entries{0};
     size_t sent_csi_entries{0};
+    // Part of filtered_csi_entries.  Entries rejected without calling the
+    // filter because they repeat the copyset of a rejected entry.
+    size_t filtered_csi_entries_same_copyset{0};
 
     // This counter is bumped each time we seek to a new partition in LogsDB.
     size_t seen_logsdb_partitions{0};
@@ -432,7 +435,8 @@ class LocalLogStore : boost::noncopyable {
     // Max lsn to read. Not supported by AllLogsIterator.
     lsn_t stop_reading_after_lsn{LSN_MAX};
 
-    // Max timestamp to read. Not supported by AllLogsIterator.
+    // Max timestamp to read. AllLogsIterator only checks it at partition
+    // boundaries.
     std::chrono::milliseconds stop_reading_after_timestamp{
         std::chrono::milliseconds::max()};
 
@@ -528,6 +532,14 @@ class LocalLogStore : boost::noncopyable {
                             RecordTimestamp max_ts) = 0;
     virtual ~ReadFilter() {}
 
+    // True if operator() only depends on the copyset and flags, and has no
+    // side effects.  The iterator may then skip calling it for a CSI entry
+    // that repeats the copyset and flags of an entry it has just rejected,
+    // which is common with sticky copysets.
+    virtual bool dependsOnlyOnCopyset() const {
+      return false;
+    }
+
     virtual bool shouldProcessTimeRange(RecordTimestamp /* min */,
                                         RecordTimestamp /* max */) {
       return true;
@@ -1062,6 +1074,10 @@ class LocalLogStoreReadFilter : public LocalLogStore::ReadFilter {
                   RecordTimestamp min_ts,
                   RecordTimestamp max_ts) override;
 
+  bool dependsOnlyOnCopyset() const override {
+    return true;
+  }
+
   // If valid(), this is the id of this storage shard and scd filtering should
   // be used.
   // @see doc/single-copy-delivery.md for more information about scd.
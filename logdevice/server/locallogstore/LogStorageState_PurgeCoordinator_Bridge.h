@@ -31,6 +31,9 @@ class LogStorageState_PurgeCoordinator_Bridge {
                    bool do_broadcast,
                    uint64_t epoch_offset = BYTE_OFFSET_INVALID) = 0;
   virtual void updateLastCleanInMemory(epoch_t epoch) = 0;
+  // Approximate number of bytes used by the purge coordinator, not counting
+  // the purge state machine it may be running.
+  virtual size_t getMemoryUsage() = 0;
 };
 
 }} // namespace facebook::logdevice
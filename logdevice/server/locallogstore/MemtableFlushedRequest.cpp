@@ -49,7 +49,7 @@ void MemtableFlushedRequest::broadcast() {
 }
 
 void MemtableFlushedRequest::applyFlush() {
-  // send an update to all LogRebuilding state machines
+  // send an update to all LogRebuilding state machines and ChunkRebuildings
   // whose log maps to the shard on which memtable was flushed.
   ServerWorker* w = ServerWorker::onThisThread();
   for (const auto& lr : w->runningLogRebuildings().map) {
@@ -58,6 +58,12 @@ void MemtableFlushedRequest::applyFlush() {
           node_index_, server_instance_id_, flushToken_);
     }
   }
+  for (const auto& cr : w->runningChunkRebuildings().map) {
+    if (shard_idx_ == cr.second->getShard()) {
+      cr.second->onMemtableFlushed(
+          node_index_, server_instance_id_, flushToken_);
+    }
+  }
 }
 
 std::shared_ptr<ServerConfig> MemtableFlushedRequest::getServerConfig() {
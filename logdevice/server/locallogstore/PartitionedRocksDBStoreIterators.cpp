@@ -943,6 +943,13 @@ void PartitionedRocksDBStore::PartitionedAllLogsIterator::setPartition(
 
   if (stats) {
     ++stats->seen_logsdb_partitions;
+    if (current_partition_) {
+      // Partitions are visited in order of starting timestamp, so the
+      // iterator stops at the first partition past
+      // stop_reading_after_timestamp.
+      stats->max_read_timestamp_lower_bound =
+          current_partition_->starting_timestamp.toMilliseconds();
+    }
   }
 }
 
@@ -8,6 +8,7 @@
 #include "RocksDBLocalLogStore.h"
 
 #include <cstdlib>
+#include <cstring>
 #include <ctime>
 #include <memory>
 #include <string>
@@ -307,6 +308,14 @@ class RocksDBLocalLogStore::CSIWrapper::CopySetIndexIterator
   const std::vector<ShardID>& getCurrentCopySet() const;
   LocalLogStoreRecordFormat::csi_flags_t getCurrentFlags() const;
 
+  // Entries with byte-identical flags and copyset (waves may differ) that
+  // were parsed one after another get the same run id.  Sticky copysets
+  // produce long runs of such entries.
+  uint64_t getCurrentRunId() const {
+    ld_check(state() == IteratorState::AT_RECORD);
+    return current_run_id_;
+  }
+
   // returns the size of the copyset index entry in bytes
   size_t getCurrentEntrySize();
 
@@ -349,6 +358,11 @@ class RocksDBLocalLogStore::CSIWrapper::CopySetIndexIterator
   uint32_t current_single_wave_{0};
   std::vector<ShardID> current_single_copyset_;
   LocalLogStoreRecordFormat::csi_flags_t current_single_flags_{0};
+  uint64_t current_run_id_{0};
+
+  // Value of the last successfully parsed entry, used to skip parsing
+  // entries that repeat its flags and copyset.  Empty if there is none.
+  std::string prev_value_;
 
   // Size of the copyset index entry (NB: not the record it represents) in
   // bytes. Used to apply disk i/o limits when reading.
@@ -715,6 +729,12 @@ void RocksDBLocalLogStore::CSIWrapper::moveTo(const Location& target,
   // True if `current` has been filtered out, based on either CSI or data.
   bool current_is_filtered_out = false;
 
+  // If the filter only looks at copysets and flags, id of the last run of
+  // identical CSI entries (see CopySetIndexIterator::getCurrentRunId()) that
+  // it rejected.  The rest of the run is rejected without calling the filter.
+  const bool reuse_filter_decisions = filter && filter->dependsOnlyOnCopyset();
+  folly::Optional<uint64_t> rejected_csi_run;
+
   if (stats) {
     // We are executing a seek/next that may land us on an LSN that is less than
     // stats->last_read_lsn. This can happen if the caller has previously seen
@@ -821,14 +841,25 @@ void RocksDBLocalLogStore::CSIWrapper::moveTo(const Location& target,
 
       // Running the filter on the copyset.
       ld_check(!current_is_filtered_out);
-      current_is_filtered_out |= filter &&
-          !(*filter)(current.log_id,
-                     current.lsn,
-                     cs.data(),
-                     cs.size(),
-                     flags,
-                     min_ts_,
-                     max_ts_);
+      const uint64_t run_id = csi_iterator_->getCurrentRunId();
+      if (rejected_csi_run.hasValue() && rejected_csi_run.value() == run_id) {
+        current_is_filtered_out = true;
+        if (stats) {
+          ++stats->filtered_csi_entries_same_copyset;
+        }
+      } else {
+        current_is_filtered_out |= filter &&
+            !(*filter)(current.log_id,
+                       current.lsn,
+                       cs.data(),
+                       cs.size(),
+                       flags,
+                       min_ts_,
+                       max_ts_);
+        if (current_is_filtered_out && reuse_filter_decisions) {
+          rejected_csi_run = run_id;
+        }
+      }
 
       if (stats) {
         stats->countCSIEntry(csi_iterator_->getCurrentEntrySize(),
@@ -1059,8 +1090,25 @@ void RocksDBLocalLogStore::CSIWrapper::CopySetIndexIterator::
     return;
   }
 
+  const rocksdb::Slice value = iterator_->value();
+  const size_t wave_size = sizeof(current_single_wave_);
+  if (!prev_value_.empty() && value.size() == prev_value_.size() &&
+      value.size() > wave_size &&
+      std::memcmp(value.data() + wave_size,
+                  prev_value_.data() + wave_size,
+                  value.size() - wave_size) == 0) {
+    // Same flags and copyset as the previous entry, which are already
+    // parsed.  Only the wave needs to be read.
+    std::memcpy(&current_single_wave_, value.data(), wave_size);
+    current_entry_size_ = value.size();
+    state_ = IteratorState::AT_RECORD;
+    return;
+  }
+  prev_value_.clear();
+  ++current_run_id_;
+
   if (!LocalLogStoreRecordFormat::parseCopySetIndexSingleEntry(
-          Slice(iterator_->value().data(), iterator_->value().size()),
+          Slice(value.data(), value.size()),
           &current_single_copyset_,
           &current_single_wave_,
           &current_single_flags_,
@@ -1079,6 +1127,7 @@ void RocksDBLocalLogStore::CSIWrapper::CopySetIndexIterator::
   }
 
   current_entry_size_ = iterator_->value().size();
+  prev_value_.assign(value.data(), value.size());
 
   dd_assert(current_single_copyset_.size() > 0,
             "Empty copyset in copyset index for log_id %lu, lsn %s",
@@ -24,6 +24,14 @@ class TestCallback : public LocalLogStoreReader::Callback {
     }
     --fail_after_;
 
+    if (record.filtered_out) {
+      records_.push_back(RawRecord::filteredOut(
+          record.lsn,
+          record.filtered_out_bytes,
+          record.from_under_replicated_region));
+      return 0;
+    }
+
     void* blob_copy = malloc(record.blob.size);
     if (blob_copy == nullptr) {
       throw std::bad_alloc();
@@ -64,6 +72,7 @@ LocalLogStoreTestReader::process(const TemporaryRocksDBStore* store,
                                        false, // is_rebuilding
                                        filter_,
                                        CatchupEventTrigger::OTHER);
+  ctx.key_filter_ = key_filter_;
 
   Status st = LocalLogStoreReader::read(*it, cb, &ctx, nullptr, settings_);
   records = std::move(cb.getRecords());
@@ -8,12 +8,15 @@
 #define __STDC_FORMAT_MACROS
 #include "AllServerReadStreams.h"
 
+#include <algorithm>
 #include <functional>
 #include <utility>
 
 #include <folly/Memory.h>
 
 #include "logdevice/common/AdminCommandTable.h"
+#include "logdevice/common/EventLoop.h"
+#include "logdevice/common/LibeventTimer.h"
 #include "logdevice/common/debug.h"
 #include "logdevice/common/Sender.h"
 #include "logdevice/common/configuration/UpdateableConfig.h"
@@ -46,6 +49,7 @@ AllServerReadStreams::AllServerReadStreams(
           settings->real_time_max_bytes / settings->num_workers,
           settings->real_time_eviction_threshold_bytes / settings->num_workers,
           stats),
+      catchup_queue_arbiter_([this] { scheduleArbiterResume(); }),
       processor_(processor),
       stats_(stats),
       settings_(settings),
@@ -81,28 +85,27 @@ AllServerReadStreams::insertOrGet(ClientID client_id,
       log_group_path = std::make_shared<std::string>(log_path.value());
     }
   }
-  auto stream = std::make_shared<ServerReadStream>(
-      read_stream_id, client_id, log_id, shard, stats_, log_group_path);
-
-  const auto insert_result = streams_.insert(std::move(stream));
-
-  if (insert_result.second) {
-    // We actually inserted ...
+  ServerReadStream* stream =
+      streams_.find(log_id, client_id, read_stream_id, shard);
+  const bool inserted = stream == nullptr;
 
+  if (inserted) {
     // Check that we aren't over capacity
-    if (streams_.size() > settings_->max_server_read_streams) {
-      streams_.erase(insert_result.first);
+    if (streams_.size() >= settings_->max_server_read_streams) {
       err = E::TEMPLIMIT;
       return std::make_pair(nullptr, false);
     }
 
+    stream = streams_.insert(std::make_unique<ServerReadStream>(
+        read_stream_id, client_id, log_id, shard, stats_, log_group_path));
+
     // Subscribe to RELEASE messages for this log
     if (updateSubscription(log_id, shard) != 0) {
       // This can fail if it is the first time we are seeing this log ID (so
       // we need to create a new LogStorageStateMap entry) and there are too
       // many logs in the server's LogStorageStateMap.  This is pretty bad - the
       // server cannot accept read traffic for new logs.
-      streams_.erase(insert_result.first);
+      streams_.erase(log_id, client_id, read_stream_id, shard);
       err = E::PERMLIMIT;
       return std::make_pair(nullptr, false);
     }
@@ -132,39 +135,31 @@ AllServerReadStreams::insertOrGet(ClientID client_id,
 
     if (on_worker_thread_) {
       // initialize the iterator cache
-      deref(insert_result.first).iterator_cache_ =
-          std::make_shared<IteratorCache>(
+      stream->iterator_cache_ = std::make_shared<IteratorCache>(
               &processor_->sharded_storage_thread_pool_->getByIndex(shard)
                    .getLocalLogStore(),
               log_id,
               false /* created_for_rebuilding */);
     }
   } else {
-    (*insert_result.first)->log_group_path_ = log_group_path;
+    stream->log_group_path_ = log_group_path;
   }
 
-  return std::make_pair(&deref(insert_result.first), insert_result.second);
+  return std::make_pair(stream, inserted);
 }
 
 ServerReadStream* AllServerReadStreams::get(ClientID client_id,
                                             logid_t log_id,
                                             read_stream_id_t read_stream_id,
                                             shard_index_t shard) {
-  auto key = boost::make_tuple(log_id, client_id, read_stream_id, shard);
-  const auto& index = streams_.get<FullKeyIndex>();
-  auto it = index.find(key);
-  return it != index.end() ? &deref(it) : nullptr;
+  return streams_.find(log_id, client_id, read_stream_id, shard);
 }
 
 void AllServerReadStreams::erase(ClientID client_id,
                                  logid_t log_id,
                                  read_stream_id_t read_stream_id,
                                  shard_index_t shard) {
-  auto& index = streams_.get<FullKeyIndex>();
-  auto key = boost::make_tuple(log_id, client_id, read_stream_id, shard);
-  auto it = index.find(key);
-  if (it != index.end()) {
-    index.erase(it);
+  if (streams_.erase(log_id, client_id, read_stream_id, shard)) {
     int rv = updateSubscription(log_id, shard);
     // If insertOrGet() had succeeded, there is a LogStorageStateMap entry for
     // this log and there is no reason to fail here.
@@ -173,17 +168,10 @@ void AllServerReadStreams::erase(ClientID client_id,
 }
 
 void AllServerReadStreams::eraseAllForClient(ClientID client_id) {
-  auto& client_index = streams_.get<ClientIndex>();
-
-  // First collect all logs that the client is subscribed to
-  std::vector<std::pair<logid_t, shard_index_t>> erased;
-  auto range = client_index.equal_range(client_id);
-  for (auto it = range.first; it != range.second; ++it) {
-    erased.push_back(std::make_pair((*it)->log_id_, (*it)->shard_));
-  }
-
-  // Destroy the ServerReadStream instances
-  client_index.erase(client_id);
+  // Destroy the ServerReadStream instances, remembering the logs that the
+  // client was subscribed to
+  std::vector<std::pair<logid_t, shard_index_t>> erased =
+      streams_.eraseAllForClient(client_id);
 
   // Destroy the CatchupQueue
   client_states_.erase(client_id);
@@ -258,15 +246,14 @@ void AllServerReadStreams::scheduleForCatchup(
 }
 
 void AllServerReadStreams::invalidateIterators(ClientID client_id) {
-  auto range = streams_.get<ClientIndex>().equal_range(client_id);
   auto now = std::chrono::steady_clock::now();
   auto ttl = Worker::settings().iterator_cache_ttl;
 
-  for (auto it = range.first; it != range.second; ++it) {
-    ld_check((*it)->iterator_cache_ && "IteratorCache not set");
+  streams_.forEachForClient(client_id, [&](ServerReadStream& stream) {
+    ld_check(stream.iterator_cache_ && "IteratorCache not set");
 
-    (*it)->iterator_cache_->invalidateIfUnused(now, ttl);
-  }
+    stream.iterator_cache_->invalidateIfUnused(now, ttl);
+  });
 }
 
 void AllServerReadStreams::onGapSent(ClientID client_id,
@@ -507,7 +494,7 @@ void AllServerReadStreams::onShardRebuilt(uint32_t shard) {
     return true;
   };
 
-  catchupIf(streams_.begin(), streams_.end(), unstall_stream);
+  catchupIf([&](auto visit) { streams_.forEach(visit); }, unstall_stream);
 }
 
 void AllServerReadStreams::onRelease(RecordID rid,
@@ -533,13 +520,13 @@ void AllServerReadStreams::onRelease(RecordID rid,
     //
     // This check ensures that in step (6) we avoid reading from the log store
     // since we know we'd already delivered the record.
-    return force || lsn >= stream.getReadPtr().lsn;
+    return stream.shard_ == shard &&
+        (force || lsn >= stream.getReadPtr().lsn);
   };
 
-  auto key = boost::make_tuple(rid.logid, shard);
-  auto range = streams_.get<LogShardIndex>().equal_range(key);
-  catchupIf(
-      range.first, range.second, should_catchup, CatchupEventTrigger::RELEASE);
+  catchupIf([&](auto visit) { streams_.forEachInLog(rid.logid, visit); },
+            should_catchup,
+            CatchupEventTrigger::RELEASE);
 }
 
 int AllServerReadStreams::updateSubscription(logid_t log_id,
@@ -556,12 +543,9 @@ int AllServerReadStreams::updateSubscription(logid_t log_id,
     return -1;
   }
 
-  auto key = boost::make_tuple(log_id, shard);
-  const auto& log_index = streams_.get<LogShardIndex>();
-
   // Depending on whether there are still any active streams for this log,
   // subscribe to or unsubscribe from RELEASE messages for the log.
-  if (log_index.find(key) != log_index.end()) {
+  if (streams_.hasStreams(log_id, shard)) {
     log_state->subscribeWorker(worker_id_);
   } else {
     log_state->unsubscribeWorker(worker_id_);
@@ -569,6 +553,16 @@ int AllServerReadStreams::updateSubscription(logid_t log_id,
   return 0;
 }
 
+void AllServerReadStreams::scheduleArbiterResume() {
+  ld_check(on_worker_thread_);
+  if (!arbiter_timer_) {
+    arbiter_timer_ = std::make_unique<LibeventTimer>(
+        EventLoop::onThisThread()->getEventBase(),
+        [this] { catchup_queue_arbiter_.resumeNext(); });
+  }
+  arbiter_timer_->activate(std::chrono::microseconds(0));
+}
+
 void AllServerReadStreams::getCatchupQueuesDebugInfo(
     InfoCatchupQueuesTable& table) {
   for (auto& c : client_states_) {
@@ -581,30 +575,22 @@ void AllServerReadStreams::getCatchupQueuesDebugInfo(
 void AllServerReadStreams::getReadStreamsDebugInfo(
     ClientID client_id,
     InfoReadersTable& table) const {
-  const auto& client_index = streams_.get<ClientIndex>();
-  auto range = client_index.equal_range(client_id);
-  std::string out;
-  for (auto it = range.first; it != range.second; ++it) {
-    (*it)->getDebugInfo(table);
-  }
+  streams_.forEachForClient(client_id, [&](ServerReadStream& stream) {
+    stream.getDebugInfo(table);
+  });
 }
 
 void AllServerReadStreams::getReadStreamsDebugInfo(
     logid_t log_id,
     InfoReadersTable& table) const {
-  const auto& log_index = streams_.get<LogIndex>();
-  auto range = log_index.equal_range(log_id);
-  std::string out;
-  for (auto it = range.first; it != range.second; ++it) {
-    (*it)->getDebugInfo(table);
-  }
+  streams_.forEachInLog(
+      log_id, [&](ServerReadStream& stream) { stream.getDebugInfo(table); });
 }
 
 void AllServerReadStreams::getReadStreamsDebugInfo(
     InfoReadersTable& table) const {
-  for (const auto& stream : streams_) {
-    stream->getDebugInfo(table);
-  }
+  streams_.forEach(
+      [&](ServerReadStream& stream) { stream.getDebugInfo(table); });
 }
 
 void AllServerReadStreams::blockUnblockClient(ClientID cid, bool block) {
@@ -715,16 +701,19 @@ void AllServerReadStreams::evictRealTimeLog(logid_t logid) {
   ld_check(logid != LOGID_INVALID);
   ld_check(logid != LOGID_INVALID2);
 
-  auto range = streams_.get<LogIndex>().equal_range(logid);
   // Items can only ever come off on this thread, so nothing should have
-  // removed entries / read streams between the "toEvict()' call above and the
-  // "equal_range' call.
-  ld_check(range.first != range.second);
-  for (auto it = range.first; it != range.second; ++it) {
-    auto recs{(*it)->giveReleasedRecords()};
+  // removed entries / read streams between the "toEvict()' call above and
+  // here.
+  bool found = false;
+  streams_.forEachInLog(logid, [&](ServerReadStream& stream) {
+    found = true;
+    auto recs{stream.giveReleasedRecords()};
     STAT_ADD(stats_, real_time_record_buffer_eviction, recs.size());
     // The shared_ptr to ReleasedRecords will be destroyed here.
-  }
+  });
+  // The log's streams may be gone while its recent records are still around.
+  found |= recent_released_records_.erase(logid) > 0;
+  ld_check(found);
 }
 
 void AllServerReadStreams::onShardStatusChanged() {
@@ -863,13 +852,44 @@ void AllServerReadStreams::distributeNewlyReleasedRecords() {
         records->buffer_ = &real_time_record_buffer_;
         real_time_record_buffer_.addToLRU(records->logid_);
         std::shared_ptr<ReleasedRecords> ptr{records.release()};
-        auto range = streams_.get<LogIndex>().equal_range(ptr->logid_);
-        for (auto it = range.first; it != range.second; ++it) {
-          (*it)->addReleasedRecords(ptr);
+        bool has_streams = false;
+        streams_.forEachInLog(ptr->logid_, [&](ServerReadStream& stream) {
+          stream.addReleasedRecords(ptr);
+          has_streams = true;
+        });
+
+        const size_t max_recent = settings_->real_time_recent_batches_per_log;
+        if (has_streams && max_recent > 0) {
+          auto& recent = recent_released_records_[ptr->logid_];
+          recent.push_back(std::move(ptr));
+          while (recent.size() > max_recent) {
+            recent.pop_front();
+          }
         }
       });
 }
 
+std::vector<std::shared_ptr<ReleasedRecords>>
+AllServerReadStreams::getRecentReleasedRecords(logid_t log_id,
+                                               lsn_t read_ptr) const {
+  auto it = recent_released_records_.find(log_id);
+  if (it == recent_released_records_.end() || it->second.empty()) {
+    return {};
+  }
+  const auto& recent = it->second;
+  if (*recent.front() > read_ptr || *recent.back() < read_ptr) {
+    return {};
+  }
+  // Batches are in LSN order.  Skip those entirely behind the read pointer.
+  auto first = std::find_if(
+      recent.begin(),
+      recent.end(),
+      [&](const std::shared_ptr<ReleasedRecords>& records) {
+        return !(*records < read_ptr);
+      });
+  return std::vector<std::shared_ptr<ReleasedRecords>>(first, recent.end());
+}
+
 Request::Execution EvictRealTimeRequest::execute() {
   ServerWorker::onThisThread()->serverReadStreams().evictRealTime();
   return Request::Execution::COMPLETE;
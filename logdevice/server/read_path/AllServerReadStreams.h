@@ -7,16 +7,13 @@
  */
 #pragma once
 
+#include <deque>
 #include <map>
 #include <queue>
 #include <set>
+#include <unordered_map>
 #include <utility>
 
-#include <boost/multi_index/composite_key.hpp>
-#include <boost/multi_index/hashed_index.hpp>
-#include <boost/multi_index/member.hpp>
-#include <boost/multi_index_container.hpp>
-
 #include "logdevice/common/Address.h"
 #include "logdevice/common/AdminCommandTable-fwd.h"
 #include "logdevice/common/ExponentialBackoffTimer.h"
@@ -36,8 +33,10 @@
 #include "logdevice/include/types.h"
 
 #include "logdevice/server/read_path/CatchupQueue.h"
+#include "logdevice/server/read_path/CatchupQueueArbiter.h"
 #include "logdevice/server/read_path/LogStorageStateMap.h"
 #include "logdevice/server/read_path/ServerReadStream.h"
+#include "logdevice/server/read_path/ServerReadStreamIndex.h"
 
 namespace facebook { namespace logdevice {
 
@@ -51,6 +50,7 @@ namespace facebook { namespace logdevice {
  */
 
 class EpochOffsetStorageTask;
+class LibeventTimer;
 class ReadStorageTask;
 class RECORD_Message;
 class StatsHolder;
@@ -261,6 +261,7 @@ class AllServerReadStreams : public ShardAuthoritativeStatusSubscriber {
 
     streams_.clear();
     client_states_.clear();
+    recent_released_records_.clear();
     // Free all released records that we didn't get around to sending.
     // This moves EpochRecordCacheEntrys to various workers, so
     // must be run before the Worker::~Worker() is called.
@@ -316,6 +317,15 @@ class AllServerReadStreams : public ShardAuthoritativeStatusSubscriber {
    */
   void distributeNewlyReleasedRecords();
 
+  /**
+   * @return the records most recently released for the log on this worker
+   *         that aren't entirely behind read_ptr, oldest first, see
+   *         recent_released_records_.  Empty, without copying anything, if
+   *         read_ptr is outside of the range of these records.
+   */
+  std::vector<std::shared_ptr<ReleasedRecords>>
+  getRecentReleasedRecords(logid_t log_id, lsn_t read_ptr) const;
+
   /**
    * Tell the real time record cache that we recently used the records from a
    * given log, so it can take this information into account in its eviction
@@ -345,6 +355,14 @@ class AllServerReadStreams : public ShardAuthoritativeStatusSubscriber {
 
   void blockUnblockClient(ClientID cid, bool block);
 
+  /**
+   * Arbiter sharing the worker between the CatchupQueues of clients, see
+   * CatchupQueueArbiter.  nullptr if not used from a worker thread.
+   */
+  CatchupQueueArbiter* getCatchupQueueArbiter() {
+    return on_worker_thread_ ? &catchup_queue_arbiter_ : nullptr;
+  }
+
   ~AllServerReadStreams() override;
 
  protected: // tests may override
@@ -371,10 +389,10 @@ class AllServerReadStreams : public ShardAuthoritativeStatusSubscriber {
 
  private:
   //
-  // Main data structure containing ServerReadStream instances.  We use a
-  // boost::multi_index to allow three access patterns:
+  // Main data structure containing ServerReadStream instances.  Supports
+  // three access patterns:
   // - Find/add/remove the stream for a specific (log id, client,
-  //   read stream id) triplet.
+  //   read stream id, shard) key.
   // - Find all clients subscribed to a log.  Used by delivery path.  This is
   //   a common high-volume operation.
   // - Find all logs that a client is subscribed to.  Only used to clean up
@@ -382,74 +400,20 @@ class AllServerReadStreams : public ShardAuthoritativeStatusSubscriber {
   //
   // NOTE: updateSubscription(log_id) should be called whenever this changes
   //
-
-  // Names for indexes
-  struct FullKeyIndex {};
-  struct LogIndex {};
-  struct LogShardIndex {};
-  struct ClientIndex {};
-
-  using client_id_member = boost::multi_index::
-      member<ServerReadStream, ClientID, &ServerReadStream::client_id_>;
-  using log_id_member = boost::multi_index::
-      member<ServerReadStream, logid_t, &ServerReadStream::log_id_>;
-  using read_stream_id_member = boost::multi_index::
-      member<ServerReadStream, read_stream_id_t, &ServerReadStream::id_>;
-  using shard_member = boost::multi_index::
-      member<ServerReadStream, shard_index_t, &ServerReadStream::shard_>;
-
-  // Note: using a shared_ptr here because multi_index_container does not seem
-  // to support in place construct and ServerReadStream is non copyable.
-  boost::multi_index::multi_index_container<
-      std::shared_ptr<ServerReadStream>,
-      boost::multi_index::indexed_by<
-          // index by (log ID, client ID, read stream ID, shard)
-          boost::multi_index::hashed_unique<
-              boost::multi_index::tag<FullKeyIndex>,
-              boost::multi_index::composite_key<ServerReadStream,
-                                                log_id_member,
-                                                client_id_member,
-                                                read_stream_id_member,
-                                                shard_member>,
-              boost::multi_index::composite_key_hash<logid_t::Hash,
-                                                     ClientID::Hash,
-                                                     read_stream_id_t::Hash,
-                                                     std::hash<shard_index_t>>>,
-
-          // index by log ID
-          boost::multi_index::hashed_non_unique<
-              boost::multi_index::tag<LogIndex>,
-              log_id_member,
-              logid_t::Hash>,
-
-          // index by (log ID, shard)
-          boost::multi_index::hashed_non_unique<
-              boost::multi_index::tag<LogShardIndex>,
-              boost::multi_index::
-                  composite_key<ServerReadStream, log_id_member, shard_member>,
-              boost::multi_index::composite_key_hash<logid_t::Hash,
-                                                     std::hash<shard_index_t>>>,
-
-          // index by client ID
-          boost::multi_index::hashed_non_unique<
-              boost::multi_index::tag<ClientIndex>,
-              client_id_member,
-              ClientID::Hash>>>
-      streams_;
+  ServerReadStreamIndex streams_;
 
   RealTimeRecordBuffer real_time_record_buffer_;
 
-  /**
-   * Retrieve a ServerReadStream behind an iterator. boost::multi_index does not
-   * allow retrieving a non const ServerReadStream because modifying its
-   * components that are part of the index keys is invalid. However, we know
-   * what we are doing and will never modify ServerReadStream::log_id_,
-   * ServerReadStream::client_id_, and ServerReadStream::id_.
-   */
-  template <typename I>
-  static constexpr ServerReadStream& deref(I& it) {
-    return const_cast<ServerReadStream&>(**it);
-  }
+  // The last few ReleasedRecords handed to the streams of each log, oldest
+  // first, at most Settings::real_time_recent_batches_per_log per log.  A
+  // stream drops the records pushed to it once it has fallen behind them;
+  // these let it catch up from memory rather than from the local log store.
+  // They are accounted for in real_time_record_buffer_ like the records held
+  // by streams, and evicted with them.
+  std::unordered_map<logid_t,
+                     std::deque<std::shared_ptr<ReleasedRecords>>,
+                     logid_t::Hash>
+      recent_released_records_;
 
   /**
    * Evicts buffered real time reads for a single log.
@@ -457,30 +421,28 @@ class AllServerReadStreams : public ShardAuthoritativeStatusSubscriber {
   void evictRealTimeLog(logid_t);
 
   /**
-   * Wake up all the read streams for which `pred` returns true in the specified
-   * range.
+   * Wake up all the read streams for which `pred` returns true among the
+   * streams visited by `for_each`.
    *
-   * @param begin Iterator to the initial position in a sequence of streams.
-   * @param end   Iterator to the final position in a sequence of streams.
-   * @param pred  Unary function that accepts a ServerReadStream that belongs to
-   *              the specified range and whose return value indicates if that
-   *              stream is to be woken up.
-   */
-  template <typename I, typename Pred>
-  void catchupIf(const I& begin,
-                 const I& end,
+   * @param for_each Function that calls its argument on each stream of a
+   *                 subset of streams_, e.g. the streams of a log.
+   * @param pred     Unary function that accepts a ServerReadStream and whose
+   *                 return value indicates if that stream is to be woken up.
+   */
+  template <typename ForEach, typename Pred>
+  void catchupIf(ForEach for_each,
                  Pred pred,
                  CatchupEventTrigger reason = CatchupEventTrigger::OTHER) {
-    // Because scheduleForCatchup() may invalidate iterators, we must not call
+    // Because scheduleForCatchup() may erase streams, we must not call
     // it while iterating through streams_.  Instead, first go through streams
     // for the log, mark them for catchup and later call
     // scheduleForCatchup() for any that need it.
     folly::small_vector<WeakRef<ServerReadStream>> to_push;
-    for (I it = begin; it != end; ++it) {
-      if (pred(deref(it)) && canScheduleForCatchup(deref(it))) {
-        to_push.emplace_back(deref(it).createRef());
+    for_each([&](ServerReadStream& stream) {
+      if (pred(stream) && canScheduleForCatchup(stream)) {
+        to_push.emplace_back(stream.createRef());
       }
-    }
+    });
     // NOTE: each scheduleForCatchup() call may erase some streams for the
     // client, including streams appearing later in `to_push'.  This is why we
     // took weak references above and check them here.
@@ -518,6 +480,12 @@ class AllServerReadStreams : public ShardAuthoritativeStatusSubscriber {
   typedef std::unordered_map<ClientID, ClientState, ClientID::Hash>
       ClientStateMap;
 
+  // Outlives the CatchupQueues in client_states_ that take part in it.
+  CatchupQueueArbiter catchup_queue_arbiter_;
+  // Resumes the clients waiting on catchup_queue_arbiter_.  Created on first
+  // use.
+  std::unique_ptr<LibeventTimer> arbiter_timer_;
+
   ClientStateMap client_states_;
 
   ServerProcessor* const processor_;
@@ -605,6 +573,13 @@ class AllServerReadStreams : public ShardAuthoritativeStatusSubscriber {
    */
   void scheduleShardStatusUpdateRetry(ClientID cid);
 
+  /**
+   * Activates arbiter_timer_ so that the next client waiting on
+   * catchup_queue_arbiter_ is resumed on the next iteration of the event
+   * loop.
+   */
+  void scheduleArbiterResume();
+
   friend class CatchupQueueTest;
 };
 
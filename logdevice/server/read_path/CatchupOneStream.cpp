@@ -140,6 +140,13 @@ void EnumMap<CatchupOneStream::Action, std::string>::setValues() {
 
 EnumMap<CatchupOneStream::Action, std::string> CatchupOneStream::action_names;
 
+// Where the payload of a real time record lives in the buffer that
+// ReleasedRecords::sharePayloads() shares across the streams shipping it.
+struct SharedPayloadRef {
+  ReleasedRecords* records;
+  size_t offset;
+};
+
 /**
  * Implementation of LocalLogStoreReader::Callback that ships records to the
  * client.
@@ -180,16 +187,22 @@ class ReadingCallback : public LocalLogStoreReader::Callback {
                     const esn_t last_known_good,
                     const copyset_size_t copyset_size,
                     const ShardID* const copyset,
-                    const uint64_t offset_within_epoch);
+                    const uint64_t offset_within_epoch,
+                    const bool filtered_out_by_reader = false,
+                    const SharedPayloadRef* shared_payload = nullptr);
 
  private:
-  // Sends a RECORD_Message for the given record over the wire
+  // Sends a RECORD_Message for the given record over the wire.  If
+  // `shared_payload' is set and other streams ship the record too, the
+  // message references their shared copy of the payload instead of making
+  // its own, see RECORD_Message.
   int shipRecord(lsn_t lsn,
                  std::chrono::milliseconds timestamp,
                  LocalLogStoreRecordFormat::flags_t disk_flags,
                  Payload payload,
                  std::unique_ptr<ExtraMetadata> extra_metadata,
-                 uint64_t byte_offset);
+                 uint64_t byte_offset,
+                 const SharedPayloadRef* shared_payload = nullptr);
 
   std::unique_ptr<ExtraMetadata>
   prepareExtraMetadata(esn_t last_known_good,
@@ -213,6 +226,27 @@ class ReadingCallback : public LocalLogStoreReader::Callback {
 int ReadingCallback::processRecord(const RawRecord& record) {
   const lsn_t lsn = record.lsn;
 
+  if (record.filtered_out) {
+    // LocalLogStoreReader already evaluated the server-side filter and didn't
+    // copy the record.
+    stream_->in_under_replicated_region_ |= record.from_under_replicated_region;
+    stream_->filtered_out_bytes_ += record.filtered_out_bytes;
+    STAT_ADD(catchup_->deps_.getStatsHolder(),
+             read_streams_num_bytes_filtered_out_by_key,
+             record.filtered_out_bytes);
+    return processRecord(lsn,
+                         std::chrono::milliseconds(0),
+                         0,
+                         std::map<KeyType, std::string>(),
+                         Payload(),
+                         0,
+                         ESN_INVALID,
+                         0,
+                         nullptr,
+                         BYTE_OFFSET_INVALID,
+                         /* filtered_out_by_reader */ true);
+  }
+
   // Parse the local log store blob
   std::chrono::milliseconds timestamp;
   Payload payload;
@@ -288,25 +322,38 @@ int ReadingCallback::processRecord(
     const esn_t last_known_good,
     const copyset_size_t copyset_size,
     const ShardID* const copyset,
-    const uint64_t offset_within_epoch) {
+    const uint64_t offset_within_epoch,
+    const bool filtered_out_by_reader,
+    const SharedPayloadRef* shared_payload) {
   ld_check(lsn > stream_->last_delivered_lsn_);
 
   // [Experimental Feature] If server-side filtering is enabled, we should
   // do filtering here. If record key can not pass record filter,
   // filtered_out will be set to be true. A gap message with reason
   // FILTERED_OUT will be sent to client-side.
-  bool filtered_out = false;
+  bool filtered_out = filtered_out_by_reader;
 
-  if (stream_->filter_pred_ != nullptr &&
+  if (!filtered_out && stream_->filter_pred_ != nullptr &&
       (flags & LocalLogStoreRecordFormat::FLAG_OPTIONAL_KEYS)) {
     const auto it = optional_keys.find(KeyType::FILTERABLE);
     if (it != optional_keys.end()) {
       if (!(*stream_->filter_pred_)(it->second)) {
         filtered_out = true;
+        stream_->filtered_out_bytes_ += payload.size();
+        STAT_ADD(catchup_->deps_.getStatsHolder(),
+                 read_streams_num_bytes_filtered_out_by_key,
+                 payload.size());
       }
     }
   }
 
+  // Server-side sampling applies to the records that passed the filter.
+  // Records not sampled are reported the same way as filtered out records.
+  if (!filtered_out && stream_->sampler_ != nullptr &&
+      !(*stream_->sampler_)(lsn, timestamp)) {
+    filtered_out = true;
+  }
+
   // Insert a TRIM gap for any records before this one that have been trimmed
   // between the time the read for this record was scheduled (pushRecords()
   // with its trim check) and read completed. This ensures that the client can
@@ -350,7 +397,7 @@ int ReadingCallback::processRecord(
   ld_check(!(flags & LocalLogStoreRecordFormat::FLAG_AMEND));
 
   std::unique_ptr<ExtraMetadata> extra_metadata;
-  if (stream_->include_extra_metadata_) {
+  if (stream_->include_extra_metadata_ && !filtered_out) {
     DCHECK_NOTNULL(copyset);
     extra_metadata = this->prepareExtraMetadata(
         last_known_good, wave, copyset, copyset_size, offset_within_epoch);
@@ -391,8 +438,13 @@ int ReadingCallback::processRecord(
       return -1;
     }
 
-    int rv = shipRecord(
-        lsn, timestamp, flags, payload, std::move(extra_metadata), byte_offset);
+    int rv = shipRecord(lsn,
+                        timestamp,
+                        flags,
+                        payload,
+                        std::move(extra_metadata),
+                        byte_offset,
+                        shared_payload);
     if (rv != 0) {
       return -1;
     }
@@ -547,7 +599,8 @@ int ReadingCallback::shipRecord(lsn_t lsn,
                                 LocalLogStoreRecordFormat::flags_t disk_flags,
                                 Payload payload,
                                 std::unique_ptr<ExtraMetadata> extra_metadata,
-                                uint64_t byte_offset) {
+                                uint64_t byte_offset,
+                                const SharedPayloadRef* shared_payload) {
   ++nrecords_;
 
   RECORD_flags_t wire_flags = 0;
@@ -573,6 +626,9 @@ int ReadingCallback::shipRecord(lsn_t lsn,
                           wire_flags,
                           stream_->shard_};
 
+  // Keeps the payload alive for the message if it is shared
+  std::shared_ptr<const void> payload_owner;
+
   if (stream_->no_payload_ || stream_->csi_data_only_) {
     payload = Payload(nullptr, 0);
     // Clear checksum flags if we don't ship payload
@@ -609,9 +665,25 @@ int ReadingCallback::shipRecord(lsn_t lsn,
     h.hash = checksum_32bit(Slice(payload));
     payload = Payload(&h, sizeof(h)).dup();
   } else {
-    // Make private copy of the data so it is stable for the lifetime of
-    // the, possibly deferred on transmission, RECORD message.
-    payload = payload.dup();
+    std::shared_ptr<const std::string> payloads;
+    if (shared_payload) {
+      payloads = shared_payload->records->sharePayloads(stream_);
+    }
+    if (payloads) {
+      // Other streams ship this record too.  Point into the copy of the
+      // payload shared by all of them, which payload_owner keeps stable for
+      // the lifetime of the message.
+      payload =
+          Payload(payloads->data() + shared_payload->offset, payload.size());
+      payload_owner = std::move(payloads);
+      STAT_ADD(catchup_->deps_.getStatsHolder(),
+               real_time_record_payload_bytes_shared,
+               payload.size());
+    } else {
+      // Make private copy of the data so it is stable for the lifetime of
+      // the, possibly deferred on transmission, RECORD message.
+      payload = payload.dup();
+    }
   }
 
   if (stream_->include_byte_offset_ && byte_offset != BYTE_OFFSET_INVALID) {
@@ -629,7 +701,8 @@ int ReadingCallback::shipRecord(lsn_t lsn,
                                        std::move(extra_metadata),
                                        RECORD_Message::Source::LOCAL_LOG_STORE,
                                        byte_offset,
-                                       stream_->log_group_path_);
+                                       stream_->log_group_path_,
+                                       std::move(payload_owner));
 
   if (lsn <= stream_->last_delivered_lsn_) {
     RATELIMIT_CRITICAL(std::chrono::seconds(10),
@@ -993,6 +1066,17 @@ CatchupOneStream::startRead(WeakRef<CatchupQueue> catchup_queue,
     }
   }
 
+  if (!inject_latency) {
+    // The stream may have fallen behind the records pushed to it, e.g. because
+    // it was throttled, but records recently released for the log may still
+    // cover its read pointer.
+    Action action = pushRecentReleasedRecords(read_ctx);
+    if (action != Action::NOT_IN_REAL_TIME_BUFFER) {
+      deps_.used(stream_->log_id_);
+      return action;
+    }
+  }
+
   if (try_non_blocking_read && !inject_latency) {
     // First try an immediate non-blocking read on the current worker
     // thread.  If we can get data from the local log store without going to
@@ -1148,9 +1232,15 @@ CatchupOneStream::Action CatchupOneStream::pushReleasedRecords(
       continue;
     }
 
+    // Offset of the entry's payload in ReleasedRecords::sharePayloads()
+    size_t next_payload_offset = 0;
+
     // The read ptr is within rec.  Consider each entry!
     for (ZeroCopiedRecord* entry = rec->entries_.get(); entry != nullptr;
          entry = entry->next_.get()) {
+      const SharedPayloadRef shared_payload{rec.get(), next_payload_offset};
+      next_payload_offset += entry->payload_raw.size;
+
       // Skip over already-delivered records
       if (entry->lsn < read_ctx.read_ptr_.lsn) {
         continue;
@@ -1193,7 +1283,9 @@ CatchupOneStream::Action CatchupOneStream::pushReleasedRecords(
           entry->last_known_good,
           entry->copyset.size(),
           entry->copyset.data(),
-          entry->offset_within_epoch);
+          entry->offset_within_epoch,
+          /* filtered_out_by_reader */ false,
+          &shared_payload);
       if (rv != 0) {
         ld_check_ne(err, E::CBREGISTERED);
         status = E::ABORTED;
@@ -1221,6 +1313,47 @@ CatchupOneStream::Action CatchupOneStream::pushReleasedRecords(
   return handleBatchEnd(stream_->version_, status, read_ctx.read_ptr_);
 }
 
+CatchupOneStream::Action CatchupOneStream::pushRecentReleasedRecords(
+    LocalLogStoreReader::ReadContext& read_ctx) {
+  std::vector<std::shared_ptr<ReleasedRecords>> recent =
+      deps_.getRecentReleasedRecords(stream_->log_id_, read_ctx.read_ptr_.lsn);
+  if (recent.empty()) {
+    // The stream is too far behind, or ahead, for the recent records to be of
+    // any use.  Not a miss.
+    return Action::NOT_IN_REAL_TIME_BUFFER;
+  }
+
+  // pushReleasedRecords() gives up unless the first records of the read
+  // pointer's epoch that aren't entirely behind the read pointer contain it.
+  // Check that here so that misses aren't counted in its stats.
+  bool covered = false;
+  for (const auto& rec : recent) {
+    if (!same_epoch(rec->end_lsn_, read_ctx.read_ptr_.lsn) ||
+        *rec < read_ctx.read_ptr_.lsn) {
+      continue;
+    }
+    covered = !(*rec > read_ctx.read_ptr_.lsn);
+    break;
+  }
+
+  const bool tail = stream_->trafficClass() == TrafficClass::READ_TAIL;
+  if (!covered) {
+    if (tail) {
+      STAT_INCR(deps_.getStatsHolder(), real_time_recent_miss_tail);
+    } else {
+      STAT_INCR(deps_.getStatsHolder(), real_time_recent_miss_backlog);
+    }
+    return Action::NOT_IN_REAL_TIME_BUFFER;
+  }
+
+  if (tail) {
+    STAT_INCR(deps_.getStatsHolder(), real_time_recent_hit_tail);
+  } else {
+    STAT_INCR(deps_.getStatsHolder(), real_time_recent_hit_backlog);
+  }
+  return pushReleasedRecords(recent, read_ctx);
+}
+
 CatchupOneStream::Action
 CatchupOneStream::readNonBlocking(WeakRef<CatchupQueue> /*catchup_queue*/,
                                   LocalLogStoreReader::ReadContext& read_ctx) {
@@ -1341,6 +1474,10 @@ void CatchupOneStream::readOnStorageThread(
   if (w) {
     client_address = w->sender().getSockaddr(Address(stream_->client_id_));
   }
+  // Schedule the task fairly with other principals' reads on the storage
+  // threads.
+  std::string principal = catchup_queue->getPrincipalName();
+  const uint32_t weight = catchup_queue->getReadWeight();
   auto task_uniq = std::make_unique<ReadStorageTask>(stream_->createRef(),
                                                      std::move(catchup_queue),
                                                      stream_->version_,
@@ -1350,6 +1487,13 @@ void CatchupOneStream::readOnStorageThread(
                                                      read_iterator,
                                                      is_tailer,
                                                      client_address);
+  task_uniq->principal_ = std::move(principal);
+  task_uniq->traffic_class_ = stream_->trafficClass();
+  task_uniq->fair_share_weight_ = weight;
+  const auto deadline = deps_.getSettings().read_storage_task_deadline;
+  if (deadline != std::chrono::milliseconds::max()) {
+    task_uniq->deadline_ = std::chrono::steady_clock::now() + deadline;
+  }
 
   deps_.putStorageTask(std::move(task_uniq), stream_->shard_);
   STAT_INCR(deps_.getStatsHolder(), read_requests_to_storage);
@@ -1829,6 +1973,7 @@ CatchupOneStream::createReadContext(lsn_t last_released_lsn,
                                             false, // is_rebuilding
                                             std::move(filter),
                                             catchup_reason);
+  read_ctx.key_filter_ = stream_->filter_pred_;
 
   return read_ctx;
 }
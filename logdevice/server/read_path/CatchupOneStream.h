@@ -176,6 +176,16 @@ class CatchupOneStream {
   Action pushReleasedRecords(std::vector<std::shared_ptr<ReleasedRecords>>&,
                              LocalLogStoreReader::ReadContext& read_ctx);
 
+  /**
+   * Like pushReleasedRecords() but with the records recently released for the
+   * log on this worker rather than those pushed to the stream.  Used when the
+   * stream has fallen behind its own records.
+   *
+   * @return Action::NOT_IN_REAL_TIME_BUFFER if the read pointer isn't covered
+   *         by the recent records, otherwise see pushReleasedRecords().
+   */
+  Action pushRecentReleasedRecords(LocalLogStoreReader::ReadContext& read_ctx);
+
   Action processTask(const ReadStorageTask& task);
 
   Action processRecords(const std::vector<RawRecord>& records,
@@ -7,6 +7,8 @@
  */
 #include "CatchupQueue.h"
 
+#include <algorithm>
+
 #include <folly/Optional.h>
 
 #include "logdevice/common/AdminCommandTable.h"
@@ -62,6 +64,9 @@ CatchupQueue::CatchupQueue(std::unique_ptr<CatchupQueueDependencies>&& deps,
       ref_holder_(this),
       resume_cb_(this),
       deps_(std::move(deps)),
+      read_weight_(deps_->getClientReadWeight(client_id)),
+      principal_name_(deps_->getClientPrincipalName(client_id)),
+      arbiter_(deps_->getArbiter()),
       ping_timer_(deps_->createPingTimer([this]() { pushRecords(); })),
       iterator_invalidation_timer_(deps_->createIteratorTimer(nullptr)) {
   iterator_invalidation_timer_->setCallback(
@@ -74,6 +79,10 @@ CatchupQueue::CatchupQueue(std::unique_ptr<CatchupQueueDependencies>&& deps,
       });
   iterator_invalidation_timer_->activate(
       deps_->iteratorTimerTTL(), common_timeouts());
+  if (arbiter_ != nullptr) {
+    arbiter_client_ = std::make_unique<CatchupQueueArbiter::Client>(
+        read_weight_, [this] { pushRecords(); });
+  }
 }
 
 CatchupQueue::~CatchupQueue() = default;
@@ -123,6 +132,7 @@ void CatchupQueue::add(ServerReadStream& stream, CatchupQueue::PushMode mode) {
     case PushMode::IMMEDIATE:
       stream_ld_debug(stream, "Enqueue stream in IMMEDIATE mode");
       queue_.push_back(stream);
+      stream.last_queued_time_ = stream.last_enqueued_time_;
       STAT_INCR(deps_->getStatsHolder(), catchup_queue_push_immediate);
       break;
   }
@@ -149,6 +159,7 @@ void CatchupQueue::processDelayedQueue() {
 
     stream_ld_debug(*stream, "Stream with artificial latency is ready");
     queue_.push_back(*stream);
+    stream->last_queued_time_ = now;
     queue_delayed_.erase(stream);
     ld_check(stream->isCatchingUp());
   }
@@ -165,6 +176,9 @@ void CatchupQueue::pushRecords(CatchupEventTrigger catchup_reason) {
   // line, we yield until there is enough space for it in a subsequent call.
   // This way, a large record won't get blocked by many read streams
   // consisting of small records.
+  //
+  // The size of each batch is also limited by the deficit round robin
+  // quantum of the stream, see getQuantum().
 
   if (blocked_) {
     catchup_queue_ld_debug("This catchup queue has been blocked by the `block "
@@ -188,7 +202,12 @@ void CatchupQueue::pushRecords(CatchupEventTrigger catchup_reason) {
     return;
   }
 
-  size_t max_record_bytes_queued = deps_->getMaxRecordBytesQueued(client_id_);
+  if (!mayRead()) {
+    catchup_queue_ld_debug("Waiting for other clients to read");
+    return;
+  }
+
+  size_t max_record_bytes_queued = getMaxRecordBytesQueued();
 
   // We limit the number of iterations in that loop in order to yield in the
   // extremely unlikely case where all batches we read keep returning zero or a
@@ -199,7 +218,11 @@ void CatchupQueue::pushRecords(CatchupEventTrigger catchup_reason) {
 
   auto next_from_queue = queue_.begin();
   size_t storage_task_count = 0;
-  for (size_t i = 0; i < max_iterations && next_from_queue != queue_.end() &&
+  // Turns skipped because the stream's deficit is exhausted don't count
+  // towards max_iterations.  Each skip grows the deficit, so this ends.
+  size_t n_skipped = 0;
+  for (size_t i = 0; i < max_iterations + n_skipped &&
+       next_from_queue != queue_.end() &&
        record_bytes_queued_ < max_record_bytes_queued;
        ++i) {
     auto stream = next_from_queue;
@@ -221,6 +244,31 @@ void CatchupQueue::pushRecords(CatchupEventTrigger catchup_reason) {
       continue;
     }
 
+    // A stream alone in the queue isn't limited by its quantum, there is
+    // nobody to be fair to.  It starts with a full quantum when other streams
+    // show up.
+    const int64_t quantum = getQuantum(*stream);
+    const bool alone = &queue_.front() == &queue_.back();
+    const int64_t prev_deficit = stream->drr_deficit_;
+    if (quantum > 0) {
+      if (alone) {
+        stream->drr_deficit_ = quantum;
+      } else {
+        // Cap the deficit so that the stream can't build up an unbounded
+        // burst.
+        stream->drr_deficit_ =
+            std::min(stream->drr_deficit_ + quantum, 2 * quantum);
+        if (stream->drr_deficit_ <= 0) {
+          // The stream overdrew its deficit with a large record in a previous
+          // turn.  It sits out until it has paid back.
+          STAT_INCR(deps_->getStatsHolder(), catchup_queue_drr_turns_skipped);
+          requeue(*stream);
+          ++n_skipped;
+          continue;
+        }
+      }
+    }
+
     const logid_t log_id = stream->log_id_;
     const read_stream_id_t read_stream_id = stream->id_;
 
@@ -249,6 +297,14 @@ void CatchupQueue::pushRecords(CatchupEventTrigger catchup_reason) {
     STAT_ADD(deps_->getStatsHolder(), read_streams_batch_queue_microsec, t);
 
     ld_check_lt(record_bytes_queued_, max_record_bytes_queued);
+    size_t max_bytes = max_record_bytes_queued - record_bytes_queued_;
+    stream->drr_limited_ =
+        quantum > 0 && !alone &&
+        stream->drr_deficit_ < static_cast<int64_t>(max_bytes);
+    if (stream->drr_limited_) {
+      max_bytes = stream->drr_deficit_;
+    }
+
     CatchupOneStream::Action act;
     size_t n_bytes_queued;
     bool try_non_blocking_read =
@@ -258,11 +314,21 @@ void CatchupQueue::pushRecords(CatchupEventTrigger catchup_reason) {
                                &*stream,
                                ref_holder_.ref(),
                                try_non_blocking_read,
-                               max_record_bytes_queued - record_bytes_queued_,
+                               max_bytes,
                                record_bytes_queued_ == 0,
                                !storage_task_in_flight_,
                                catchup_reason);
-    record_bytes_queued_ += n_bytes_queued;
+    noteRecordBytesQueued(n_bytes_queued);
+    if (act == CatchupOneStream::Action::WOULDBLOCK) {
+      // The stream couldn't read from the log store, this wasn't really its
+      // turn.
+      stream->drr_deficit_ = prev_deficit;
+    } else if (stream->drr_limited_) {
+      STAT_INCR(deps_->getStatsHolder(), catchup_queue_drr_limited_batches);
+    }
+    if (quantum > 0) {
+      stream->drr_deficit_ -= n_bytes_queued;
+    }
 
     // Note: storage_task_in_flight_ is NOT updated in the above call to
     // CatchupOneStream::read(), but stream->storage_task_in_flight_ is.  Also,
@@ -312,7 +378,10 @@ void CatchupQueue::pushRecords(CatchupEventTrigger catchup_reason) {
     } else if (act == CatchupOneStream::Action::DEQUEUE_AND_CONTINUE) {
       // There are no more records to deliver right now. The stream may be added
       // back to the queue later when we determine there is more to send.
+      // Like in classic deficit round robin, an idle stream doesn't keep
+      // its unused deficit (but keeps its debt).
       queue_.erase(stream);
+      stream->drr_deficit_ = std::min<int64_t>(stream->drr_deficit_, 0);
       ld_check(!stream->isCatchingUp());
       stream->adjustStatWhenCatchingUpChanged();
     } else if (act == CatchupOneStream::Action::ERASE_AND_CONTINUE) {
@@ -336,13 +405,14 @@ void CatchupQueue::pushRecords(CatchupEventTrigger catchup_reason) {
       ld_check(act == CatchupOneStream::Action::REQUEUE_AND_DRAIN ||
                act == CatchupOneStream::Action::REQUEUE_AND_CONTINUE);
       // Move the stream to the end of the queue.
-      queue_.erase(stream);
-      queue_.push_back(*stream);
+      requeue(*stream);
       ld_check(stream->isCatchingUp());
 
-      if (act == CatchupOneStream::Action::REQUEUE_AND_DRAIN) {
+      if (act == CatchupOneStream::Action::REQUEUE_AND_DRAIN &&
+          !stream->drr_limited_) {
         // Unlikely we'll be able to fit much more into the byte limit, wait
         // until already queued records drain (onRecordSent will wake us up).
+        // If the limit was the stream's deficit, other streams can go on.
         break;
       }
     }
@@ -414,7 +484,11 @@ void CatchupQueue::onRecordSent(const RECORD_Message& msg,
   const auto msg_size = msg.size();
   ld_check(record_bytes_queued_ >= msg_size);
   record_bytes_queued_ -= msg_size;
+  bytes_drained_ += msg_size;
   ld_spew("record drained, record_bytes_queued_ = %zu", record_bytes_queued_);
+  if (record_bytes_queued_ == 0) {
+    onOutputDrained();
+  }
 
   // Try to make progress on the queue after validations are completed.
   // We do this after all validations because pushRecords() can destroy
@@ -637,6 +711,16 @@ void CatchupQueueDependencies::distributeNewlyReleasedRecords() {
   all_server_read_streams_->distributeNewlyReleasedRecords();
 }
 
+std::vector<std::shared_ptr<ReleasedRecords>>
+CatchupQueueDependencies::getRecentReleasedRecords(logid_t log_id,
+                                                   lsn_t read_ptr) {
+  return all_server_read_streams_->getRecentReleasedRecords(log_id, read_ptr);
+}
+
+uint64_t CatchupQueueDependencies::getReadStorageTasksMemoryLimit() {
+  return all_server_read_streams_->getMemoryBudget().getLimit();
+}
+
 void CatchupQueueDependencies::used(logid_t logid) {
   all_server_read_streams_->used(logid);
 }
@@ -736,6 +820,41 @@ size_t CatchupQueueDependencies::getMaxRecordBytesQueued(ClientID client) {
   return max_record_bytes_queued;
 }
 
+uint32_t CatchupQueueDependencies::getClientReadWeight(ClientID client) {
+  Worker* w = Worker::onThisThread();
+  const PrincipalIdentity* principal =
+      w->sender().getPrincipal(Address(client));
+  if (principal == nullptr) {
+    return 1;
+  }
+  // Like the DSCP marking in Sender::setPrincipal(), the first identity with
+  // a non-default setting wins.
+  auto scfg = w->getServerConfig();
+  for (const auto& identity : principal->identities) {
+    auto principal_settings = scfg->getPrincipalByName(&identity.second);
+    if (principal_settings != nullptr && principal_settings->read_weight != 1) {
+      return principal_settings->read_weight;
+    }
+  }
+  return 1;
+}
+
+CatchupQueueArbiter* CatchupQueueDependencies::getArbiter() {
+  return all_server_read_streams_->getCatchupQueueArbiter();
+}
+
+std::string CatchupQueueDependencies::getClientPrincipalName(ClientID client) {
+  const PrincipalIdentity* principal =
+      Worker::onThisThread()->sender().getPrincipal(Address(client));
+  if (principal == nullptr) {
+    return "";
+  }
+  // Clients that don't authenticate all share the principal type as name.
+  return principal->primary_idenity.second.empty()
+      ? principal->type
+      : principal->primary_idenity.second;
+}
+
 const Settings& CatchupQueueDependencies::getSettings() const {
   return Worker::settings();
 }
@@ -771,7 +890,11 @@ void CatchupQueue::onReadTaskDone(const ReadStorageTask& task) {
   CatchupOneStream::Action act;
   std::tie(act, n_bytes_queued) =
       CatchupOneStream::onReadTaskDone(*deps_, stream, task);
-  record_bytes_queued_ += n_bytes_queued;
+  noteRecordBytesQueued(n_bytes_queued);
+  if (getQuantum(*stream) > 0) {
+    stream->drr_deficit_ -= n_bytes_queued;
+  }
+  const bool drr_limited = stream->drr_limited_;
 
   onBatchComplete(stream);
 
@@ -797,6 +920,7 @@ void CatchupQueue::onReadTaskDone(const ReadStorageTask& task) {
 
   if (act == CatchupOneStream::Action::DEQUEUE_AND_CONTINUE) {
     queue_.pop_front();
+    stream->drr_deficit_ = std::min<int64_t>(stream->drr_deficit_, 0);
     ld_check(!stream->isCatchingUp());
     stream->adjustStatWhenCatchingUpChanged();
   } else if (act == CatchupOneStream::Action::ERASE_AND_CONTINUE) {
@@ -816,13 +940,12 @@ void CatchupQueue::onReadTaskDone(const ReadStorageTask& task) {
     ld_check(act == CatchupOneStream::Action::REQUEUE_AND_DRAIN ||
              act == CatchupOneStream::Action::REQUEUE_AND_CONTINUE);
     // Move to the end of the queue.
-    queue_.pop_front();
-    queue_.push_back(*stream);
+    requeue(*stream);
     ld_check(stream->isCatchingUp());
   }
 
   if (act != CatchupOneStream::Action::REQUEUE_AND_DRAIN ||
-      record_bytes_queued_ == 0) {
+      record_bytes_queued_ == 0 || drr_limited) {
     pushRecords();
   }
 }
@@ -868,6 +991,38 @@ void CatchupQueue::adjustPingTimer() {
   }
 }
 
+int64_t CatchupQueue::getQuantum(const ServerReadStream& stream) const {
+  const Settings& settings = deps_->getSettings();
+  const int64_t quantum_kb = stream.trafficClass() == TrafficClass::READ_BACKLOG
+      ? settings.catchup_queue_backlog_quantum_kb
+      : settings.catchup_queue_tail_quantum_kb;
+  return quantum_kb * 1024;
+}
+
+bool CatchupQueue::mayRead() {
+  // Clients take turns of about a tail quantum per unit of weight.
+  // Arbitration is disabled along with deficit round robin.
+  const uint64_t quantum =
+      deps_->getSettings().catchup_queue_tail_quantum_kb * 1024;
+  if (!arbiter_client_ || quantum == 0) {
+    return true;
+  }
+  const bool was_waiting = arbiter_client_->isWaiting();
+  if (arbiter_->mayRead(*arbiter_client_, quantum)) {
+    return true;
+  }
+  if (!was_waiting) {
+    STAT_INCR(deps_->getStatsHolder(), catchup_queue_arbiter_waits);
+  }
+  return false;
+}
+
+void CatchupQueue::requeue(ServerReadStream& stream) {
+  queue_.erase(queue_.iterator_to(stream));
+  queue_.push_back(stream);
+  stream.last_queued_time_ = SteadyTimestamp::now();
+}
+
 void CatchupQueue::onReadLngTaskDone(ServerReadStream* stream) {
   catchup_queue_ld_debug("ReadLngTask done");
   onStorageTaskStopped(stream);
@@ -896,7 +1051,75 @@ void CatchupQueue::onBatchComplete(ServerReadStream* stream) {
   STAT_INCR(deps_->getStatsHolder(), read_streams_batch_complete);
 }
 
+size_t CatchupQueue::getMaxRecordBytesQueued() {
+  const size_t static_limit = deps_->getMaxRecordBytesQueued(client_id_);
+  const Settings& settings = deps_->getSettings();
+  if (settings.output_adaptive_drain_time.count() <= 0 || drain_rate_ <= 0) {
+    return static_limit;
+  }
+
+  const double drain_time_sec =
+      std::chrono::duration<double>(settings.output_adaptive_drain_time)
+          .count();
+  const size_t min_bytes = settings.output_adaptive_min_records_kb * 1024;
+  const size_t max_bytes = settings.output_adaptive_max_records_kb * 1024;
+  size_t limit = drain_rate_ * drain_time_sec;
+  // The upper bound wins if the bounds were updated at runtime to be
+  // inconsistent; the server refuses to start with them.
+  limit = std::min(std::max(limit, min_bytes), max_bytes);
+  // Read storage tasks acquire this much memory from the worker's budget
+  // before they are sent.  Leave room for other clients' tasks.
+  limit = std::min<size_t>(limit, deps_->getReadStorageTasksMemoryLimit() / 4);
+  return std::max<size_t>(limit, 1);
+}
+
+void CatchupQueue::noteRecordBytesQueued(size_t n_bytes) {
+  if (record_bytes_queued_ == 0 && n_bytes > 0) {
+    drain_started_ = SteadyTimestamp::now();
+    bytes_drained_ = 0;
+  }
+  record_bytes_queued_ += n_bytes;
+  if (arbiter_client_) {
+    arbiter_->charge(*arbiter_client_, n_bytes);
+  }
+}
+
+void CatchupQueue::onOutputDrained() {
+  const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+      SteadyTimestamp::now() - drain_started_);
+  if (bytes_drained_ == 0 || elapsed.count() <= 0) {
+    return;
+  }
+  const double sample = bytes_drained_ * 1e6 / elapsed.count();
+  // Exponentially weighted so that a single burst doesn't swing the batch
+  // size, with a weight high enough to follow a client that slows down.
+  drain_rate_ = drain_rate_ > 0 ? 0.75 * drain_rate_ + 0.25 * sample : sample;
+  bytes_drained_ = 0;
+}
+
 void CatchupQueue::getDebugInfo(InfoCatchupQueuesTable& table) {
+  // How long the streams in queue_ have been waiting for their turn.
+  const auto now = SteadyTimestamp::now();
+  std::chrono::milliseconds max_delay{0};
+  std::chrono::milliseconds total_delay{0};
+  size_t n_queued = 0;
+  // "log:read stream id:delay" for each stream, in the order they'll get
+  // their turn.
+  std::string stream_delays;
+  for (const ServerReadStream& stream : queue_) {
+    auto delay = std::chrono::duration_cast<std::chrono::milliseconds>(
+        now - stream.last_queued_time_);
+    max_delay = std::max(max_delay, delay);
+    total_delay += delay;
+    ++n_queued;
+    if (!stream_delays.empty()) {
+      stream_delays += ",";
+    }
+    stream_delays += std::to_string(stream.log_id_.val()) + ":" +
+        std::to_string(stream.id_.val()) + ":" +
+        std::to_string(delay.count());
+  }
+
   table.next()
       .set<0>(client_id_)
       .set<1>(queue_.size() + queue_delayed_.size())
@@ -905,7 +1128,12 @@ void CatchupQueue::getDebugInfo(InfoCatchupQueuesTable& table) {
       .set<4>(record_bytes_queued_)
       .set<5>(storage_task_in_flight_)
       .set<6>(ping_timer_->isActive())
-      .set<7>(blocked_);
+      .set<7>(blocked_)
+      .set<8>(read_weight_)
+      .set<9>(max_delay.count())
+      .set<10>(n_queued ? total_delay.count() / n_queued : 0)
+      .set<11>(std::move(stream_delays))
+      .set<12>(arbiter_client_ && arbiter_client_->isWaiting());
 }
 
 void CatchupQueue::blockUnBlock(bool block) {
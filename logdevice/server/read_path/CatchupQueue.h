@@ -11,8 +11,10 @@
 #include <functional>
 #include <memory>
 #include <mutex>
+#include <string>
 #include <tuple>
 #include <utility>
+#include <vector>
 
 #include <boost/intrusive/set.hpp>
 
@@ -31,6 +33,7 @@
 
 #include "logdevice/include/types.h"
 
+#include "logdevice/server/read_path/CatchupQueueArbiter.h"
 #include "logdevice/server/read_path/ServerReadStream.h"
 
 namespace facebook { namespace logdevice {
@@ -45,6 +48,18 @@ namespace facebook { namespace logdevice {
  *       records in a fair and efficient manner.  This is not trivial --
  *       imagine a client subscribing to many logs with significant backlogs
  *       of records.
+ *
+ *       Streams are served with deficit round robin: each time a stream gets
+ *       its turn, its deficit grows by a quantum of bytes (see
+ *       --catchup-queue-tail-quantum-kb and --catchup-queue-backlog-quantum-kb)
+ *       and the batch it reads is limited to its deficit.  Backlog streams
+ *       get a smaller quantum than tailing ones, so that a large backlog
+ *       doesn't hold up the delivery of newly released records.
+ *
+ *       Clients share the worker through a CatchupQueueArbiter, in
+ *       proportion to the read weights of their principals: a CatchupQueue
+ *       that has read more than its share waits for its turn before reading
+ *       more.
  */
 
 class AllServerReadStreams;
@@ -87,6 +102,12 @@ class CatchupQueueDependencies {
    */
   virtual void distributeNewlyReleasedRecords();
 
+  /**
+   * Proxy for AllServerReadStreams::getRecentReleasedRecords().
+   */
+  virtual std::vector<std::shared_ptr<ReleasedRecords>>
+  getRecentReleasedRecords(logid_t log_id, lsn_t read_ptr);
+
   /**
    * Proxy for AllServerReadStreams::used().
    */
@@ -157,6 +178,30 @@ class CatchupQueueDependencies {
    */
   virtual size_t getMaxRecordBytesQueued(ClientID client);
 
+  /**
+   * Limit of the worker's memory budget for read storage tasks, the share of
+   * --read-storage-tasks-max-mem-bytes of the worker.
+   */
+  virtual uint64_t getReadStorageTasksMemoryLimit();
+
+  /**
+   * Weight of the client in the sharing of the read path between clients:
+   * the read_weight of its principal, or 1 if the principal is not in the
+   * config.
+   */
+  virtual uint32_t getClientReadWeight(ClientID client);
+
+  /**
+   * Name of the client's principal, used to schedule the storage tasks of
+   * different principals fairly.  Empty if the client has no principal.
+   */
+  virtual std::string getClientPrincipalName(ClientID client);
+
+  /**
+   * Proxy for AllServerReadStreams::getCatchupQueueArbiter().
+   */
+  virtual CatchupQueueArbiter* getArbiter();
+
   virtual ~CatchupQueueDependencies();
 
  public:
@@ -202,6 +247,15 @@ class CatchupQueue {
     return resume_cb_;
   }
 
+  // See CatchupQueueDependencies::getClientPrincipalName() and
+  // getClientReadWeight().
+  const std::string& getPrincipalName() const {
+    return principal_name_;
+  }
+  uint32_t getReadWeight() const {
+    return read_weight_;
+  }
+
   /**
    * Tries to make progress delivering records to clients.  Externally called
    * when a client first starts reading or when a new record is released,
@@ -284,6 +338,17 @@ class CatchupQueue {
   // immediately by pushRecords().
   folly::IntrusiveList<ServerReadStream, &ServerReadStream::queue_hook_> queue_;
 
+  // See CatchupQueueDependencies::getClientReadWeight() and
+  // getClientPrincipalName().  Computed once since the principal of a client
+  // doesn't change.
+  const uint32_t read_weight_;
+  const std::string principal_name_;
+
+  // See CatchupQueueDependencies::getArbiter().  arbiter_client_ is null if
+  // there is no arbiter.
+  CatchupQueueArbiter* const arbiter_;
+  std::unique_ptr<CatchupQueueArbiter::Client> arbiter_client_;
+
   // If true, processing of this CatchupQueue has been blocked by the `block
   // catchup_queue` admin command.
   bool blocked_{false};
@@ -315,6 +380,14 @@ class CatchupQueue {
   // network.
   size_t record_bytes_queued_ = 0;
 
+  // Estimate of how fast the client's socket drains RECORD messages, in bytes
+  // per second, 0 until measured.  A sample is taken every time the output
+  // evbuffer is emptied: the bytes sent since it last became non-empty over
+  // the time it took.  Used with --output-adaptive-drain-time.
+  double drain_rate_ = 0;
+  SteadyTimestamp drain_started_;
+  size_t bytes_drained_ = 0;
+
   // Is there a storage task in flight for this catchup queue?  We only allow
   // one at a time.
   bool storage_task_in_flight_ = false;
@@ -342,6 +415,40 @@ class CatchupQueue {
 
   void adjustPingTimer();
 
+  /**
+   * How many record bytes we can queue in the output evbuffer for the client:
+   * CatchupQueueDependencies::getMaxRecordBytesQueued(), or the amount the
+   * client drains in --output-adaptive-drain-time if that is set.
+   */
+  size_t getMaxRecordBytesQueued();
+
+  /**
+   * Adds to record_bytes_queued_, starting a drain rate sample if the output
+   * evbuffer was empty.
+   */
+  void noteRecordBytesQueued(size_t n_bytes);
+
+  /**
+   * Called when the output evbuffer has been emptied.  Updates drain_rate_.
+   */
+  void onOutputDrained();
+
+  /**
+   * Asks the arbiter whether this client may read now.  If not, pushRecords()
+   * is called again when the client's turn comes.
+   */
+  bool mayRead();
+
+  /**
+   * Deficit round robin quantum of the stream in bytes, 0 if unlimited.
+   */
+  int64_t getQuantum(const ServerReadStream& stream) const;
+
+  /**
+   * Moves a stream to the end of queue_.
+   */
+  void requeue(ServerReadStream& stream);
+
   void onBatchComplete(ServerReadStream* stream);
 
   void onStorageTaskStarted(const ServerReadStream* stream);
@@ -0,0 +1,90 @@
+/**
+ * Copyright (c) 2017-present, Facebook, Inc. and its affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+#include "logdevice/server/read_path/CatchupQueueArbiter.h"
+
+#include <algorithm>
+
+#include "logdevice/common/checks.h"
+
+namespace facebook { namespace logdevice {
+
+CatchupQueueArbiter::CatchupQueueArbiter(std::function<void()> schedule_resume)
+    : schedule_resume_(std::move(schedule_resume)) {}
+
+bool CatchupQueueArbiter::mayRead(Client& client, uint64_t quantum) {
+  if (client.resumed_) {
+    // It's the client's turn.
+    client.resumed_ = false;
+  } else if (client.isWaiting()) {
+    return false;
+  } else if (bytesRead(client) >= quantum * client.weight_) {
+    if (waiting_.empty() && n_grants_ == client.last_grant_) {
+      // Nobody else is reading, no need to wait.
+      ++round_;
+    } else {
+      client.waiting_round_ = round_;
+      waiting_.push_back(client);
+      scheduleResume(UINT64_MAX);
+      return false;
+    }
+  }
+
+  client.last_grant_ = ++n_grants_;
+  return true;
+}
+
+void CatchupQueueArbiter::charge(Client& client, uint64_t bytes) {
+  bytesRead(client);
+  client.bytes_read_ += bytes;
+}
+
+uint64_t CatchupQueueArbiter::bytesRead(Client& client) {
+  if (client.round_ != round_) {
+    client.round_ = round_;
+    client.bytes_read_ = 0;
+  }
+  return client.bytes_read_;
+}
+
+void CatchupQueueArbiter::scheduleResume(uint64_t n_grants_at_schedule) {
+  if (!resume_scheduled_) {
+    resume_scheduled_ = true;
+    n_grants_at_schedule_ = n_grants_at_schedule;
+    schedule_resume_();
+  }
+}
+
+void CatchupQueueArbiter::resumeNext() {
+  resume_scheduled_ = false;
+  if (waiting_.empty()) {
+    return;
+  }
+  if (n_grants_ == n_grants_at_schedule_) {
+    // Nobody with some share left read during the last iteration.
+    ++round_;
+  }
+  Client& client = waiting_.front();
+  if (client.waiting_round_ == round_) {
+    // Other clients are still reading their share.
+    scheduleResume(n_grants_);
+    return;
+  }
+  waiting_.pop_front();
+  client.resumed_ = true;
+  if (!waiting_.empty()) {
+    scheduleResume(n_grants_);
+  }
+  // May destroy the client.
+  client.resume_();
+}
+
+CatchupQueueArbiter::Client::Client(uint32_t weight,
+                                    std::function<void()> resume)
+    : weight_(std::max(1u, weight)), resume_(std::move(resume)) {}
+
+}} // namespace facebook::logdevice
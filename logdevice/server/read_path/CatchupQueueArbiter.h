@@ -0,0 +1,146 @@
+/**
+ * Copyright (c) 2017-present, Facebook, Inc. and its affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+#pragma once
+
+#include <cstdint>
+#include <functional>
+
+#include <folly/IntrusiveList.h>
+
+namespace facebook { namespace logdevice {
+
+/**
+ * @file Shares the read path of a worker between the CatchupQueues of its
+ *       clients, in proportion to the read weights of their principals.
+ *
+ *       CatchupQueues are driven by the events of their own clients (records
+ *       released, output drained, storage tasks done), so without
+ *       arbitration a client gets as much of the worker as it has events.
+ *       The arbiter serves clients with weighted round robin by bytes:
+ *
+ *       - In each round, a client may read `weight * quantum` bytes.  The
+ *         batch that crosses the limit is allowed, so a client may overdraw
+ *         its share by a batch.
+ *       - A client that has used up its share waits for the next round.
+ *       - A round ends when an iteration of the event loop goes by without
+ *         any client that still has some share left reading.  Waiting
+ *         clients are then resumed in FIFO order, one per iteration.
+ *
+ *       A client that is alone doesn't wait: if no other client read since
+ *       its last turn, it starts a new round.  Only clients that read keep a
+ *       round going, so a client busy with a storage task or waiting for its
+ *       output buffer to drain doesn't hold back others.
+ *
+ *       This class is not thread-safe.  Each worker has its own instance.
+ */
+
+class CatchupQueueArbiter {
+ public:
+  class Client;
+
+  /**
+   * @param schedule_resume  Called when clients are waiting, arranges for
+   *                         resumeNext() to be called from the next iteration
+   *                         of the event loop.  Not called again until
+   *                         resumeNext() has been.
+   */
+  explicit CatchupQueueArbiter(std::function<void()> schedule_resume);
+
+  CatchupQueueArbiter(const CatchupQueueArbiter&) = delete;
+  CatchupQueueArbiter& operator=(const CatchupQueueArbiter&) = delete;
+
+  /**
+   * Called by a client before it reads.
+   *
+   * @param quantum  bytes a client of weight 1 may read per round
+   *
+   * @return true if the client may read now.  Otherwise the client waits and
+   *         its resume callback is called when its turn comes.
+   */
+  bool mayRead(Client& client, uint64_t quantum);
+
+  /**
+   * Accounts for bytes read by a client.
+   */
+  void charge(Client& client, uint64_t bytes);
+
+  /**
+   * Ends the round if no client has read since the last call, and resumes
+   * the next waiting client if its round is over.
+   */
+  void resumeNext();
+
+  size_t numWaiting() const {
+    return waiting_.size();
+  }
+
+  uint64_t getRound() const {
+    return round_;
+  }
+
+  /**
+   * Per-client state, owned by the CatchupQueue.  Leaves the arbiter when
+   * destroyed.
+   */
+  class Client {
+   public:
+    /**
+     * @param weight  share of the client, at least 1
+     * @param resume  called when the client's turn comes after mayRead()
+     *                returned false
+     */
+    Client(uint32_t weight, std::function<void()> resume);
+
+    Client(const Client&) = delete;
+    Client& operator=(const Client&) = delete;
+
+    bool isWaiting() const {
+      return hook_.is_linked();
+    }
+
+   private:
+    const uint32_t weight_;
+    std::function<void()> resume_;
+    // Bytes read in round round_.
+    uint64_t bytes_read_{0};
+    uint64_t round_{0};
+    // Round in which the client started waiting.
+    uint64_t waiting_round_{0};
+    // Set when the client is resumed, lets its next mayRead() through.
+    bool resumed_{false};
+    // Value of CatchupQueueArbiter::n_grants_ after the client's last turn.
+    uint64_t last_grant_{0};
+    // Links the client into CatchupQueueArbiter::waiting_.  Unlinks itself
+    // when destroyed.
+    folly::IntrusiveListHook hook_;
+
+    friend class CatchupQueueArbiter;
+  };
+
+ private:
+  std::function<void()> schedule_resume_;
+  bool resume_scheduled_{false};
+
+  uint64_t round_{0};
+  // Number of times a client was allowed to read.
+  uint64_t n_grants_{0};
+  // n_grants_ when resumeNext() last scheduled itself, or UINT64_MAX if
+  // schedule_resume_ was called from mayRead().  A round only ends after a
+  // whole iteration of the event loop without grants.
+  uint64_t n_grants_at_schedule_{UINT64_MAX};
+
+  // Clients waiting for their turn, in FIFO order.
+  folly::IntrusiveList<Client, &Client::hook_> waiting_;
+
+  // Bytes read by the client in the current round.
+  uint64_t bytesRead(Client& client);
+
+  void scheduleResume(uint64_t n_grants_at_schedule);
+};
+
+}} // namespace facebook::logdevice
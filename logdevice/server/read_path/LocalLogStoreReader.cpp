@@ -24,6 +24,32 @@
 
 namespace facebook { namespace logdevice { namespace LocalLogStoreReader {
 
+// @return true if the record has a filterable key that read_ctx->key_filter_
+//         rejects.
+static bool isFilteredOutByKey(const Slice& record_blob,
+                               ReadContext* read_ctx) {
+  LocalLogStoreRecordFormat::flags_t flags;
+  std::map<KeyType, std::string> optional_keys;
+  int rv = LocalLogStoreRecordFormat::parse(record_blob,
+                                            nullptr,
+                                            nullptr,
+                                            &flags,
+                                            nullptr,
+                                            nullptr,
+                                            nullptr,
+                                            0,
+                                            nullptr,
+                                            &optional_keys,
+                                            nullptr,
+                                            -1 /* unused */);
+  if (rv != 0 || !(flags & LocalLogStoreRecordFormat::FLAG_OPTIONAL_KEYS)) {
+    // Let the callback deal with malformed records.
+    return false;
+  }
+  const auto it = optional_keys.find(KeyType::FILTERABLE);
+  return it != optional_keys.end() && !(*read_ctx->key_filter_)(it->second);
+}
+
 static Status maybeSendRecord(LocalLogStore::ReadIterator& read_iterator,
                               Callback& callback,
                               ReadContext* read_ctx,
@@ -34,6 +60,22 @@ static Status maybeSendRecord(LocalLogStore::ReadIterator& read_iterator,
   size_t msg_size = RECORD_Message::expectedSize(payload_size);
   const lsn_t lsn = read_iterator.getLSN();
 
+  if (read_ctx->key_filter_ != nullptr &&
+      isFilteredOutByKey(record_blob, read_ctx)) {
+    // Skip the payload copy. The callback only turns this into a
+    // FILTERED_OUT gap, which doesn't count towards the byte limit.
+    if (callback.processRecord(RawRecord::filteredOut(
+            lsn,
+            record_blob.size,
+            read_iterator.accessedUnderReplicatedRegion())) != 0) {
+      if (err != E::CBREGISTERED) {
+        err = E::ABORTED;
+      }
+      return err;
+    }
+    return E::OK;
+  }
+
   // Have we shipped too much data to the client already?
   if (read_ctx->byteLimitReached(nrecords, bytes_delivered, msg_size)) {
     return E::BYTE_LIMIT_REACHED;
@@ -111,6 +153,9 @@ Status readImpl(LocalLogStore::ReadIterator& read_iterator,
     STAT_ADD(stats,
              read_streams_num_csi_entries_sent,
              read_ctx->it_stats_.sent_csi_entries);
+    STAT_ADD(stats,
+             read_streams_num_csi_entries_filtered_same_copyset,
+             read_ctx->it_stats_.filtered_csi_entries_same_copyset);
     if (read_ctx->rebuilding_) {
       PER_SHARD_STAT_ADD(stats,
                          read_streams_num_records_read_rebuilding,
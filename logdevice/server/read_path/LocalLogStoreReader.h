@@ -15,6 +15,7 @@
 #include "logdevice/common/CopySet.h"
 #include "logdevice/common/LocalLogStoreRecordFormat.h"
 #include "logdevice/common/SCDCopysetReordering.h"
+#include "logdevice/common/ServerRecordFilter.h"
 #include "logdevice/common/settings/Settings.h"
 #include "logdevice/common/TailRecord.h"
 #include "logdevice/common/stats/Stats.h"
@@ -65,17 +66,36 @@ class RawRecord : boost::noncopyable {
       : lsn(other.lsn),
         blob(other.blob),
         owned(other.owned),
-        from_under_replicated_region(other.from_under_replicated_region) {
+        from_under_replicated_region(other.from_under_replicated_region),
+        filtered_out(other.filtered_out),
+        filtered_out_bytes(other.filtered_out_bytes) {
     other.lsn = LSN_INVALID;
     other.blob = Slice();
     other.owned = false;
     other.from_under_replicated_region = false;
+    other.filtered_out = false;
+    other.filtered_out_bytes = 0;
+  }
+
+  /**
+   * A record rejected by ReadContext::key_filter_. Carries no blob, only the
+   * size of the one that was not copied.
+   */
+  static RawRecord filteredOut(lsn_t lsn,
+                               size_t blob_size,
+                               bool from_under_replicated_region) {
+    RawRecord record(lsn, Slice(), false, from_under_replicated_region);
+    record.filtered_out = true;
+    record.filtered_out_bytes = blob_size;
+    return record;
   }
 
   lsn_t lsn;
   Slice blob;
   bool owned;
   bool from_under_replicated_region;
+  bool filtered_out{false};
+  size_t filtered_out_bytes{0};
 };
 
 namespace LocalLogStoreReader {
@@ -141,6 +161,10 @@ struct ReadContext {
   bool rebuilding_{false};
   // Filter to be used for filtering records that should not be sent.
   std::shared_ptr<LocalLogStore::ReadFilter> lls_filter_;
+  // If set, server-side filter on the key of the records. It is evaluated on
+  // the record header before the record is copied; records it rejects are
+  // passed to the callback as RawRecord::filteredOut().
+  std::shared_ptr<ServerRecordFilter> key_filter_;
   // A reason of the current catchup
   CatchupEventTrigger catchup_reason_;
   // Iterabtor statistics. Reset by LocalLogStoreReader::read().
@@ -0,0 +1,210 @@
+/**
+ * Copyright (c) 2017-present, Facebook, Inc. and its affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "logdevice/common/checks.h"
+#include "logdevice/common/types_internal.h"
+#include "logdevice/include/types.h"
+
+namespace facebook { namespace logdevice {
+
+/**
+ * @file Insert-only concurrent map from log ids to heap-allocated objects of
+ *       type T, which must have a `logid_t getLogID() const' method.
+ *
+ *       Lookups are lock-free and wait-free: an open-addressing table of
+ *       atomic pointers to the objects is probed linearly.  The key is not
+ *       stored in the table, it is read from the object; at load factor at
+ *       most 1/2 the first probe usually hits, and the caller is about to
+ *       access the object anyway.  An empty slot ends the probe.
+ *
+ *       Inserts take a mutex.  They only happen once per log, while lookups
+ *       happen on every operation on the log.  When the table gets half full
+ *       the inserting thread copies the pointers into a table twice the size
+ *       and publishes it.  Readers may still be probing an older table, so
+ *       old tables are only freed by clear() and the destructor.  Their total
+ *       size is less than that of the current table.
+ *
+ *       Objects are owned by the map and live until clear() or destruction,
+ *       so pointers returned by find() and insertOrGet() stay valid without
+ *       any reclamation scheme.
+ */
+
+template <typename T>
+class LockFreeLogMap {
+ public:
+  explicit LockFreeLogMap(size_t initial_capacity = 1024) {
+    size_t capacity = 16;
+    while (capacity < initial_capacity) {
+      capacity *= 2;
+    }
+    tables_.push_back(std::make_unique<Table>(capacity));
+    table_.store(tables_.back().get());
+  }
+
+  LockFreeLogMap(const LockFreeLogMap&) = delete;
+  LockFreeLogMap& operator=(const LockFreeLogMap&) = delete;
+
+  ~LockFreeLogMap() {
+    clear();
+  }
+
+  /**
+   * @return the object for the log, or nullptr if there is none.  Lock-free.
+   */
+  T* find(logid_t log_id) const {
+    return findIn(*table_.load(std::memory_order_acquire), log_id);
+  }
+
+  /**
+   * @return the object for the log, calling make() to create it if there is
+   *         none.  make() returns a std::unique_ptr<T> and is called with the
+   *         insert mutex held.
+   */
+  template <typename Make>
+  T* insertOrGet(logid_t log_id, Make make) {
+    T* found = find(log_id);
+    if (found) {
+      return found;
+    }
+
+    std::lock_guard<std::mutex> lock(insert_mutex_);
+    Table* table = table_.load(std::memory_order_relaxed);
+    // Another thread may have inserted it, possibly growing the table.
+    found = findIn(*table, log_id);
+    if (found) {
+      return found;
+    }
+    if ((size_ + 1) * 2 > table->capacity) {
+      table = grow(*table);
+    }
+    T* obj = make().release();
+    ld_check(obj);
+    ld_check(obj->getLogID() == log_id);
+    place(*table, obj);
+    size_.store(size_.load(std::memory_order_relaxed) + 1,
+                std::memory_order_relaxed);
+    return obj;
+  }
+
+  /**
+   * Calls f(T&) on every object.  Objects inserted concurrently may or may
+   * not be visited.
+   */
+  template <typename F>
+  void forEach(F f) const {
+    const Table& table = *table_.load(std::memory_order_acquire);
+    for (size_t i = 0; i < table.capacity; ++i) {
+      T* obj = table.slots[i].load(std::memory_order_acquire);
+      if (obj) {
+        f(*obj);
+      }
+    }
+  }
+
+  size_t size() const {
+    return size_.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * Bytes used by the tables, not counting the objects.
+   */
+  size_t tableMemoryUsage() const {
+    std::lock_guard<std::mutex> lock(insert_mutex_);
+    size_t bytes = 0;
+    for (const auto& table : tables_) {
+      bytes += table->capacity * sizeof(std::atomic<T*>);
+    }
+    return bytes;
+  }
+
+  /**
+   * Destroys all objects.  Not thread-safe: no other method may be called
+   * concurrently.
+   */
+  void clear() {
+    std::lock_guard<std::mutex> lock(insert_mutex_);
+    Table& current = *table_.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < current.capacity; ++i) {
+      delete current.slots[i].exchange(nullptr);
+    }
+    // Older tables only point to objects also in the current one.
+    tables_.erase(tables_.begin(), tables_.end() - 1);
+    size_.store(0);
+  }
+
+ private:
+  struct Table {
+    explicit Table(size_t cap)
+        : capacity(cap), slots(new std::atomic<T*>[cap]) {
+      for (size_t i = 0; i < capacity; ++i) {
+        slots[i].store(nullptr, std::memory_order_relaxed);
+      }
+    }
+
+    const size_t capacity; // power of two
+    const std::unique_ptr<std::atomic<T*>[]> slots;
+  };
+
+  static size_t hash(logid_t log_id) {
+    // Mix the bits: data and metadata log ids differ in the high bits.
+    return Hash64<logid_t::raw_type>()(log_id.val_);
+  }
+
+  static T* findIn(const Table& table, logid_t log_id) {
+    const size_t mask = table.capacity - 1;
+    for (size_t i = hash(log_id) & mask;; i = (i + 1) & mask) {
+      T* obj = table.slots[i].load(std::memory_order_acquire);
+      if (obj == nullptr) {
+        return nullptr;
+      }
+      if (obj->getLogID() == log_id) {
+        return obj;
+      }
+    }
+  }
+
+  // Called with insert_mutex_ held, there's a single writer.
+  static void place(Table& table, T* obj) {
+    const size_t mask = table.capacity - 1;
+    size_t i = hash(obj->getLogID()) & mask;
+    while (table.slots[i].load(std::memory_order_relaxed) != nullptr) {
+      i = (i + 1) & mask;
+    }
+    table.slots[i].store(obj, std::memory_order_release);
+  }
+
+  // Called with insert_mutex_ held.
+  Table* grow(const Table& old) {
+    auto table = std::make_unique<Table>(old.capacity * 2);
+    for (size_t i = 0; i < old.capacity; ++i) {
+      T* obj = old.slots[i].load(std::memory_order_relaxed);
+      if (obj) {
+        place(*table, obj);
+      }
+    }
+    tables_.push_back(std::move(table));
+    table_.store(tables_.back().get(), std::memory_order_release);
+    return tables_.back().get();
+  }
+
+  // The table new lookups go to, tables_.back().
+  std::atomic<Table*> table_;
+
+  mutable std::mutex insert_mutex_;
+  // Current and retired tables, protected by insert_mutex_.
+  std::vector<std::unique_ptr<Table>> tables_;
+  std::atomic<size_t> size_{0};
+};
+
+}} // namespace facebook::logdevice
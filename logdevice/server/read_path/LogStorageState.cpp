@@ -50,16 +50,52 @@ LogStorageState::LogStorageState(logid_t log_id,
               : nullptr),
       log_id_(log_id),
       shard_(shard),
-      owner_(owner) {
-  retry_release_.timer_scheduled_ = false;
-  retry_release_.force_ = false;
-  if (owner_->getProcessor() != nullptr) { // may be null in tests
-    purge_coordinator_ =
-        owner_->getProcessor()->createPurgeCoordinator(log_id, shard_, this);
+      owner_(owner) {}
+
+LogStorageState::~LogStorageState() {
+  delete purge_coordinator_.load();
+  delete rare_state_.load();
+}
+
+LogStorageState_PurgeCoordinator_Bridge*
+LogStorageState::getPurgeCoordinator() {
+  LogStorageState_PurgeCoordinator_Bridge* pc = purge_coordinator_.load();
+  if (pc != nullptr || owner_->getProcessor() == nullptr) {
+    // Processor may be null in tests.
+    return pc;
+  }
+  std::unique_ptr<LogStorageState_PurgeCoordinator_Bridge> created =
+      owner_->getProcessor()->createPurgeCoordinator(log_id_, shard_, this);
+  if (purge_coordinator_.compare_exchange_strong(pc, created.get())) {
+    return created.release();
+  }
+  // Lost the race, use the one another thread installed.
+  return pc;
+}
+
+size_t LogStorageState::getOutOfLineMemoryUsage() const {
+  size_t bytes = 0;
+  if (rare_state_.load() != nullptr) {
+    bytes += sizeof(RareState);
+  }
+  LogStorageState_PurgeCoordinator_Bridge* pc = purge_coordinator_.load();
+  if (pc != nullptr) {
+    bytes += pc->getMemoryUsage();
   }
+  return bytes;
 }
 
-LogStorageState::~LogStorageState() = default;
+LogStorageState::RareState& LogStorageState::getRareState() {
+  RareState* rs = rare_state_.load();
+  if (rs != nullptr) {
+    return *rs;
+  }
+  auto created = std::make_unique<RareState>();
+  if (rare_state_.compare_exchange_strong(rs, created.get())) {
+    return *created.release();
+  }
+  return *rs;
+}
 
 bool LogStorageState::notePermanentError(const char* context) {
   if (!permanent_error_.exchange(true)) {
@@ -143,8 +179,12 @@ folly::Optional<epoch_t> LogStorageState::getLastCleanEpoch() const {
 
 folly::Optional<std::pair<epoch_t, uint64_t>>
 LogStorageState::getEpochOffset() const {
-  RWLock::ReadHolder read_guard(rw_lock_);
-  return latest_epoch_offset_;
+  const RareState* rs = rare_state_.load();
+  if (rs == nullptr) {
+    return folly::none;
+  }
+  RWLock::ReadHolder read_guard(rs->rw_lock_);
+  return rs->latest_epoch_offset_;
 }
 
 void LogStorageState::updateLastCleanEpoch(epoch_t epoch) {
@@ -153,13 +193,14 @@ void LogStorageState::updateLastCleanEpoch(epoch_t epoch) {
 
 void LogStorageState::updateEpochOffset(
     std::pair<epoch_t, uint64_t> epoch_offset) {
-  RWLock::WriteHolder write_guard(rw_lock_);
-  if (latest_epoch_offset_.hasValue() &&
-      latest_epoch_offset_.value().first < epoch_offset.first) {
+  RareState& rs = getRareState();
+  RWLock::WriteHolder write_guard(rs.rw_lock_);
+  if (rs.latest_epoch_offset_.hasValue() &&
+      rs.latest_epoch_offset_.value().first < epoch_offset.first) {
     // No updates needed for older epoch.
     return;
   }
-  latest_epoch_offset_.assign(epoch_offset);
+  rs.latest_epoch_offset_.assign(epoch_offset);
 }
 
 int LogStorageState::updateTrimPoint(lsn_t new_val) {
@@ -192,17 +233,18 @@ int LogStorageState::updateSeal(Seal new_seal, LogStorageState::SealType type) {
 }
 
 void LogStorageState::retryRelease(worker_id_t id, bool force) {
-  std::lock_guard<std::mutex> guard(retry_release_.mutex_);
-  retry_release_.failed_workers_.set(id.val_);
-  retry_release_.force_ |= force;
-  if (!retry_release_.timer_scheduled_) {
+  RetryRelease& retry_release = getRareState().retry_release_;
+  std::lock_guard<std::mutex> guard(retry_release.mutex_);
+  retry_release.failed_workers_.set(id.val_);
+  retry_release.force_ |= force;
+  if (!retry_release.timer_scheduled_) {
     ExponentialBackoffTimerNode* node = Worker::onThisThread()->registerTimer(
         std::bind(
             &LogStorageState::onRetryReleaseTimer, this, std::placeholders::_1),
         RETRY_RELEASE_INITIAL_DELAY,
         RETRY_RELEASE_MAX_DELAY);
     node->timer->activate();
-    retry_release_.timer_scheduled_ = true;
+    retry_release.timer_scheduled_ = true;
   } else {
     // There is a timer scheduled to fire or currently running.  Once it
     // finishes resending, it will check for any new failures and reactivate.
@@ -213,18 +255,21 @@ void LogStorageState::retryRelease(worker_id_t id, bool force) {
 void LogStorageState::onRetryReleaseTimer(ExponentialBackoffTimerNode* node) {
   ld_spew("fired for log %lu", log_id_.val_);
 
-  ld_check(retry_release_.timer_scheduled_);
+  // Allocated by retryRelease(), which scheduled the timer.
+  ld_check(rare_state_.load() != nullptr);
+  RetryRelease& retry_release = rare_state_.load()->retry_release_;
+  ld_check(retry_release.timer_scheduled_);
 
   std::bitset<MAX_WORKERS> failed_workers;
   bool force;
   {
-    std::lock_guard<std::mutex> guard(retry_release_.mutex_);
-    failed_workers = retry_release_.failed_workers_;
+    std::lock_guard<std::mutex> guard(retry_release.mutex_);
+    failed_workers = retry_release.failed_workers_;
     // Reset the public bitset.  Later we will check it to see if anyone has
     // added new bits while we were broadcasting, to see if we need to
     // reactivate the timer.
-    retry_release_.failed_workers_.reset();
-    force = retry_release_.force_;
+    retry_release.failed_workers_.reset();
+    force = retry_release.force_;
   }
 
   ReleaseRequest::broadcastReleaseRequest(
@@ -239,16 +284,16 @@ void LogStorageState::onRetryReleaseTimer(ExponentialBackoffTimerNode* node) {
   // to the public bitset, by ReleaseRequest::broadcastReleaseRequest().
 
   {
-    std::lock_guard<std::mutex> guard(retry_release_.mutex_);
-    if (retry_release_.failed_workers_.any()) {
+    std::lock_guard<std::mutex> guard(retry_release.mutex_);
+    if (retry_release.failed_workers_.any()) {
       // Some workers failed while retrying above, or failed on another thread
       // while we were retrying.  Reactivate the timer with a larger delay.
       node->timer->activate();
     } else {
       // The bitset is empty.  Clean up.
       delete node;
-      retry_release_.timer_scheduled_ = false;
-      retry_release_.force_ = false;
+      retry_release.timer_scheduled_ = false;
+      retry_release.force_ = false;
     }
   }
 }
@@ -439,7 +484,7 @@ void LogStorageState::getSeqStateRequestCallback(
   // Epoch offset may be available if sequencer is not under recovery and
   // LogTailAttributes were requested by setting INCLUDE_EPOCH_OFFSET flag.
   if (result.last_released_lsn != LSN_INVALID) {
-    log_state->purge_coordinator_->onReleaseMessage(
+    log_state->getPurgeCoordinator()->onReleaseMessage(
         result.last_released_lsn,
         result.last_seq,
         ReleaseType::GLOBAL,
@@ -9,6 +9,7 @@
 
 #include <bitset>
 #include <memory>
+#include <mutex>
 #include <string>
 
 #include <folly/AtomicBitSet.h>
@@ -319,9 +320,19 @@ class LogStorageState {
 
   ~LogStorageState();
 
-  // TODO change to inline PurgeCoordinator instance (which was moved to
-  // server/) once this class is in server/
-  std::unique_ptr<LogStorageState_PurgeCoordinator_Bridge> purge_coordinator_;
+  /**
+   * Returns the log's purge coordinator, creating it on first use: most logs
+   * on a shard are idle and never need one.  Returns nullptr in tests that
+   * don't have a ServerProcessor.  Thread-safe.
+   */
+  LogStorageState_PurgeCoordinator_Bridge* getPurgeCoordinator();
+
+  /**
+   * Approximate number of bytes allocated on demand for this log outside of
+   * the LogStorageState object: the rare state and the purge coordinator.
+   * Doesn't count the record cache.
+   */
+  size_t getOutOfLineMemoryUsage() const;
 
   std::unique_ptr<RecordCache> record_cache_;
 
@@ -342,16 +353,26 @@ class LogStorageState {
     return shard_;
   }
 
+  logid_t getLogID() const {
+    return log_id_;
+  }
+
  private:
   const logid_t log_id_;
   const shard_index_t shard_;
-  LogStorageStateMap* const owner_;
 
-  // The last released LSN for the log. Updated when a global RELEASE message
-  // is received from the log's sequencer. Read by CatchupQueue when reading
-  // from the local log store. Anything up to the last released LSN can be
-  // safely read.
-  std::atomic<lsn_t> last_released_lsn_{LSN_INVALID};
+  // The small fields below are kept together, in what would otherwise be
+  // padding after shard_: there can be tens of millions of LogStorageStates.
+
+  // Initialization state of last_released_lsn. Zero if uninitialized,
+  // otherwise bitwise-or of values from LastReleasedSource
+  std::atomic<uint8_t> last_released_lsn_state_{0};
+
+  // Is there a GetSeqStateRequest inflight for this log?  If so, we avoid
+  // creating new ones until it comes back.
+  std::atomic<bool> get_seq_state_inflight_{false};
+
+  std::atomic<bool> recover_log_state_task_in_flight_{false};
 
   // Set to true if a permanent error was encountered and this LogStorageState
   // likely will never be fully up-to-date. If true, we should avoid creating
@@ -370,6 +391,14 @@ class LogStorageState {
   // but succeed to send records in clean epochs.
   std::atomic<bool> permanent_error_{false};
 
+  LogStorageStateMap* const owner_;
+
+  // The last released LSN for the log. Updated when a global RELEASE message
+  // is received from the log's sequencer. Read by CatchupQueue when reading
+  // from the local log store. Anything up to the last released LSN can be
+  // safely read.
+  std::atomic<lsn_t> last_released_lsn_{LSN_INVALID};
+
   // The last per-epoch released LSN for the log. Updated when a global or
   // per-epoch RELEASE message is received from the log's sequencer. Read by
   // CatchupQueue when reading from the local log store. Anything between the
@@ -378,16 +407,6 @@ class LogStorageState {
   // (LNG) of its epoch.
   std::atomic<lsn_t> last_per_epoch_released_lsn_{LSN_INVALID};
 
-  // Initialization state of last_released_lsn. Zero if uninitialized,
-  // otherwise bitwise-or of values from LastReleasedSource
-  std::atomic<uint8_t> last_released_lsn_state_{0};
-
-  // Is there a GetSeqStateRequest inflight for this log?  If so, we avoid
-  // creating new ones until it comes back.
-  std::atomic<bool> get_seq_state_inflight_{false};
-
-  std::atomic<bool> recover_log_state_task_in_flight_{false};
-
   // Trim point of log.  Allows the local log store to delete trimmed
   // records and read paths to recognize that records are missing because of
   // trimming.  All records up to (and including) this LSN are scheduled for
@@ -440,23 +459,39 @@ class LogStorageState {
   std::atomic<std::chrono::seconds> log_removal_time_{std::chrono::seconds(0)};
 
   using RWLock = folly::SharedMutexWritePriority;
-  // Lock to update and read latest_epoch_offset_ safely.
-  mutable RWLock rw_lock_;
-  // Pair of latest updated epoch and corresponding epoch offset.
-  // This value get updated from sequencer once recover() get triggered.
-  // It is not updated with RELEASE messages, so epoch of last_released_lsn_
-  // can be different from epoch in latest_epoch_offset_ pair.
-  folly::Optional<std::pair<epoch_t, uint64_t>> latest_epoch_offset_;
 
   // Data needed to manage retrying sending ReleaseRequests to workers.
   struct RetryRelease {
     std::mutex mutex_;
     // True when there is a timer scheduled to fire or currently running on
     // *some* worker.
-    bool timer_scheduled_;
-    bool force_;
+    bool timer_scheduled_ = false;
+    bool force_ = false;
     std::bitset<MAX_WORKERS> failed_workers_;
-  } retry_release_;
+  };
+
+  // State that few logs need, kept out of line to keep LogStorageState
+  // small.  Allocated on first use by getRareState() and only freed with the
+  // LogStorageState, so it can be used without holding any lock.
+  struct RareState {
+    // Lock to update and read latest_epoch_offset_ safely.
+    mutable RWLock rw_lock_;
+    // Pair of latest updated epoch and corresponding epoch offset.
+    // This value get updated from sequencer once recover() get triggered.
+    // It is not updated with RELEASE messages, so epoch of last_released_lsn_
+    // can be different from epoch in latest_epoch_offset_ pair.
+    folly::Optional<std::pair<epoch_t, uint64_t>> latest_epoch_offset_;
+
+    RetryRelease retry_release_;
+  };
+
+  std::atomic<RareState*> rare_state_{nullptr};
+
+  // @see getPurgeCoordinator()
+  std::atomic<LogStorageState_PurgeCoordinator_Bridge*> purge_coordinator_{
+      nullptr};
+
+  RareState& getRareState();
 
   /**
    * Callback for timer to retry sending a ReleaseRequest to workers that we
@@ -42,40 +42,25 @@ LogStorageStateMap::LogStorageStateMap(
 
 LogStorageState* LogStorageStateMap::insertOrGet(logid_t log_id,
                                                  shard_index_t shard_idx) {
-  Map& map = *shard_map_[shard_idx];
-
-  // First try a lookup to avoid memory allocation in the common case
-  auto it = map.find(log_id.val_);
-  if (it != map.cend()) {
-    return it->second.get();
-  }
-
-  // No state for this log yet.
-  auto insert_result =
-      map.emplace(log_id.val(),
-                  std::make_unique<LogStorageState>(
-                      log_id, shard_idx, this, cache_disposal_.get()));
-
-  // Whether or not we were the ones to insert or some other thread beat us
-  // to it, return a pointer to whatever ended up in the map.
-  return insert_result.first->second.get();
+  ld_check(shard_idx < shard_map_.size());
+  return shard_map_[shard_idx]->insertOrGet(log_id, [&] {
+    return std::make_unique<LogStorageState>(
+        log_id, shard_idx, this, cache_disposal_.get());
+  });
 }
 
 LogStorageState* LogStorageStateMap::find(logid_t log_id,
                                           shard_index_t shard_idx) {
   ld_check(shard_idx < shard_map_.size());
-  Map& map = *shard_map_[shard_idx];
-  auto it = map.find(log_id.val_);
-  return it != map.cend() ? it->second.get() : nullptr;
+  return shard_map_[shard_idx]->find(log_id);
 }
 
 LogStorageState& LogStorageStateMap::get(logid_t log_id,
                                          shard_index_t shard_idx) {
   ld_check(shard_idx < shard_map_.size());
-  Map& map = *shard_map_[shard_idx];
-  auto it = map.find(log_id.val_);
-  ld_check(it != map.cend());
-  return *(it->second);
+  LogStorageState* state = shard_map_[shard_idx]->find(log_id);
+  ld_check(state != nullptr);
+  return *state;
 }
 
 void LogStorageStateMap::clear() {
@@ -85,6 +70,17 @@ void LogStorageStateMap::clear() {
   }
 }
 
+size_t LogStorageStateMap::getMemoryUsage() const {
+  size_t bytes = 0;
+  for (const auto& map : shard_map_) {
+    bytes += map->tableMemoryUsage() + map->size() * sizeof(LogStorageState);
+    map->forEach([&](const LogStorageState& state) {
+      bytes += state.getOutOfLineMemoryUsage();
+    });
+  }
+  return bytes;
+}
+
 int LogStorageStateMap::repopulateRecordCacheFromLinearBuffer(
     logid_t log_id,
     shard_index_t shard,
@@ -112,15 +108,13 @@ LogStorageStateMap::ReleaseStates
 LogStorageStateMap::getAllLastReleasedLSNs(shard_index_t shard) const {
   ReleaseStates states;
 
-  for (auto entry = shard_map_[shard]->cbegin();
-       entry != shard_map_[shard]->cend();
-       ++entry) {
+  shard_map_[shard]->forEach([&](const LogStorageState& state) {
     LogStorageState::LastReleasedLSN last_released =
-        entry->second->getLastReleasedLSN();
+        state.getLastReleasedLSN();
     if (last_released.hasValue()) {
-      states.emplace_back(logid_t(entry->first), last_released.value());
+      states.emplace_back(state.getLogID(), last_released.value());
     }
-  }
+  });
 
   return states;
 }
@@ -143,12 +137,11 @@ void LogStorageStateMap::shutdownRecordCaches() {
     return;
   }
   for (shard_index_t i = 0; i < num_shards_; ++i) {
-    for (auto entry = shard_map_[i]->cbegin(); entry != shard_map_[i]->cend();
-         ++entry) {
-      if (entry->second->record_cache_ != nullptr) {
-        entry->second->record_cache_->shutdown();
+    shard_map_[i]->forEach([](LogStorageState& state) {
+      if (state.record_cache_ != nullptr) {
+        state.record_cache_->shutdown();
       }
-    }
+    });
   }
 }
 
@@ -12,10 +12,9 @@
 #include <memory>
 #include <vector>
 
-#include <folly/concurrency/ConcurrentHashMap.h>
-
 #include "logdevice/server/RecordCacheDisposal.h"
 #include "logdevice/server/RecordCacheMonitorThread.h"
+#include "logdevice/server/read_path/LockFreeLogMap.h"
 #include "logdevice/server/read_path/LogStorageState.h"
 
 #include "logdevice/common/types_internal.h"
@@ -70,10 +69,17 @@ class LogStorageStateMap {
   LogStorageState& get(logid_t log_id, shard_index_t shard_idx);
 
   /**
-   * Used in tests.
+   * Used in tests.  Not thread-safe.
    */
   void clear();
 
+  /**
+   * Approximate number of bytes used by the map and its LogStorageState
+   * objects, including their rare state and purge coordinators.  Doesn't
+   * count record caches.  Walks all logs, don't call on a hot path.
+   */
+  size_t getMemoryUsage() const;
+
   using ReleaseStates = std::vector<std::pair<logid_t, lsn_t>>;
 
   /**
@@ -168,10 +174,8 @@ class LogStorageStateMap {
   // Parent Processor instance. May be null in tests.
   ServerProcessor* const processor_;
 
-  // use Hash64 to mitigate the effect of logid (data and metadata) collision
-  using Map = folly::ConcurrentHashMap<logid_t::raw_type,
-                                       std::unique_ptr<LogStorageState>,
-                                       Hash64<logid_t::raw_type>>;
+  // Lookups, which happen for every record stored or released, don't lock.
+  using Map = LockFreeLogMap<LogStorageState>;
 
   const std::vector<std::unique_ptr<Map>> shard_map_;
 
@@ -191,15 +195,13 @@ template <typename Func>
 int LogStorageStateMap::forEachLogOnShard(shard_index_t shard,
                                           const Func& func) const {
   ld_check(shard < shard_map_.size());
-  for (auto kv = shard_map_[shard]->cbegin(); kv != shard_map_[shard]->cend();
-       ++kv) {
-    if (kv->second != nullptr) {
-      if (func(logid_t(kv->first), *kv->second) != 0) {
-        return -1;
-      }
+  bool failed = false;
+  shard_map_[shard]->forEach([&](const LogStorageState& state) {
+    if (!failed && func(state.getLogID(), state) != 0) {
+      failed = true;
     }
-  }
-  return 0;
+  });
+  return failed ? -1 : 0;
 }
 
 template <typename Func>
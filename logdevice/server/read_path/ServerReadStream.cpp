@@ -266,6 +266,7 @@ void ServerReadStream::getDebugInfo(InfoReadersTable& table) const {
 
   table.set<18>(storage_task_in_flight_);
   table.set<19>(version_.val_);
+  table.set<20>(filtered_out_bytes_);
 }
 
 void ServerReadStream::addReleasedRecords(
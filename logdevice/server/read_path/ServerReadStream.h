@@ -20,6 +20,7 @@
 #include "logdevice/common/NodeID.h"
 #include "logdevice/common/SCDCopysetReordering.h"
 #include "logdevice/common/ServerRecordFilter.h"
+#include "logdevice/common/ServerRecordSampler.h"
 #include "logdevice/common/SimpleEnumMap.h"
 #include "logdevice/common/configuration/TrafficClass.h"
 #include "logdevice/common/WeakRefHolder.h"
@@ -243,6 +244,9 @@ class ServerReadStream : boost::noncopyable {
   // to LSN_INVALID.
   lsn_t filtered_out_end_lsn_ = LSN_INVALID;
 
+  // Number of bytes of records not shipped because of filter_pred_.
+  uint64_t filtered_out_bytes_ = 0;
+
   // Cached last_known_good lsn for the epoch the stream is currently reading
   // from. Avoids asking the store for mutable per-epoch metadata on every
   // single record when reading past the last_released_lsn.
@@ -435,6 +439,19 @@ class ServerReadStream : boost::noncopyable {
   // here of the next time we can read a batch.
   SteadyTimestamp next_read_time_;
 
+  // Last time the stream was put at the back of CatchupQueue::queue_, when
+  // added or after reading a batch.  Used to report queueing delays.
+  SteadyTimestamp last_queued_time_;
+
+  // Deficit round robin state of CatchupQueue: number of bytes the stream may
+  // still read before yielding to other streams of the client.  Negative if
+  // the stream read a record larger than what it had left.
+  int64_t drr_deficit_ = 0;
+
+  // True if the batch being read is limited by drr_deficit_ rather than by
+  // the space left in the client's output buffer.
+  bool drr_limited_ = false;
+
   // Whether there is currently a storage task in flight for this stream, in
   // which case the stream should be at the top of CatchupQueue.
   bool storage_task_in_flight_;
@@ -461,8 +478,14 @@ class ServerReadStream : boost::noncopyable {
   folly::Optional<std::pair<epoch_t, uint64_t>> epoch_offset_ = folly::none;
 
   // ServerRecordFilter used to filter out record. It will be constructed
-  // by ServerRecordFilterFactory.
-  std::unique_ptr<ServerRecordFilter> filter_pred_;
+  // by ServerRecordFilterFactory. Shared with the storage tasks reading for
+  // this stream, which evaluate it before copying records.
+  std::shared_ptr<ServerRecordFilter> filter_pred_;
+
+  // If set, only records accepted by the sampler are shipped, others are
+  // reported as FILTERED_OUT gaps like records rejected by filter_pred_.
+  // Constructed by ServerRecordSamplerFactory.
+  std::unique_ptr<ServerRecordSampler> sampler_;
 
   // The location of the client reader.
   // Only used if local_scd_enabled_ is set to true.
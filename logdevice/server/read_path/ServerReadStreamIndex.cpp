@@ -0,0 +1,306 @@
+/**
+ * Copyright (c) 2017-present, Facebook, Inc. and its affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+#include "logdevice/server/read_path/ServerReadStreamIndex.h"
+
+#include <algorithm>
+
+#include <folly/hash/Hash.h>
+
+namespace facebook { namespace logdevice {
+
+constexpr ServerReadStreamIndex::Handle ServerReadStreamIndex::INVALID_HANDLE;
+
+ServerReadStreamIndex::ServerReadStreamIndex() {}
+
+ServerReadStreamIndex::~ServerReadStreamIndex() {
+  clear();
+}
+
+uint32_t ServerReadStreamIndex::keyHash(logid_t log_id,
+                                        ClientID client_id,
+                                        read_stream_id_t read_stream_id,
+                                        shard_index_t shard) {
+  const uint64_t client_and_shard =
+      (uint64_t(ClientID::Hash()(client_id)) << 16) | uint16_t(shard);
+  return folly::hash::hash_128_to_64(
+      log_id.val_,
+      folly::hash::hash_128_to_64(read_stream_id.val_, client_and_shard));
+}
+
+uint32_t ServerReadStreamIndex::logHash(logid_t log_id) {
+  return folly::hash::twang_mix64(log_id.val_);
+}
+
+uint32_t ServerReadStreamIndex::clientHash(ClientID client_id) {
+  return folly::hash::twang_mix64(ClientID::Hash()(client_id));
+}
+
+ServerReadStreamIndex::Handle
+ServerReadStreamIndex::findHandle(logid_t log_id,
+                                  ClientID client_id,
+                                  read_stream_id_t read_stream_id,
+                                  shard_index_t shard) const {
+  const Handle* found = by_key_.find(
+      keyHash(log_id, client_id, read_stream_id, shard), [&](Handle h) {
+        const ServerReadStream& s = streamAt(h);
+        return s.log_id_ == log_id && s.client_id_ == client_id &&
+            s.id_ == read_stream_id && s.shard_ == shard;
+      });
+  return found ? *found : INVALID_HANDLE;
+}
+
+ServerReadStream* ServerReadStreamIndex::find(logid_t log_id,
+                                              ClientID client_id,
+                                              read_stream_id_t read_stream_id,
+                                              shard_index_t shard) const {
+  Handle h = findHandle(log_id, client_id, read_stream_id, shard);
+  return h != INVALID_HANDLE ? &streamAt(h) : nullptr;
+}
+
+ServerReadStream*
+ServerReadStreamIndex::insert(std::unique_ptr<ServerReadStream> stream) {
+  ld_check(stream);
+  ld_check(findHandle(stream->log_id_,
+                      stream->client_id_,
+                      stream->id_,
+                      stream->shard_) == INVALID_HANDLE);
+
+  Handle h;
+  if (free_head_ != INVALID_HANDLE) {
+    h = free_head_;
+    free_head_ = slots_[h].log_next;
+    slots_[h].log_next = INVALID_HANDLE;
+  } else {
+    ld_check(slots_.size() < INVALID_HANDLE);
+    h = slots_.size();
+    slots_.emplace_back();
+  }
+  Slot& slot = slots_[h];
+  slot.stream = std::move(stream);
+  const ServerReadStream& s = *slot.stream;
+
+  by_key_.insert(keyHash(s), h);
+
+  // Push to the front of the log's and the client's lists.
+  const uint32_t log_hash = logHash(s.log_id_);
+  Handle* log_head = log_heads_.find(
+      log_hash, [&](Handle x) { return streamAt(x).log_id_ == s.log_id_; });
+  if (log_head) {
+    slot.log_next = *log_head;
+    slots_[*log_head].log_prev = h;
+    *log_head = h;
+  } else {
+    log_heads_.insert(log_hash, h);
+  }
+
+  const uint32_t client_hash = clientHash(s.client_id_);
+  Handle* client_head =
+      client_heads_.find(client_hash, [&](Handle x) {
+        return streamAt(x).client_id_ == s.client_id_;
+      });
+  if (client_head) {
+    slot.client_next = *client_head;
+    slots_[*client_head].client_prev = h;
+    *client_head = h;
+  } else {
+    client_heads_.insert(client_hash, h);
+  }
+
+  ++size_;
+  return slot.stream.get();
+}
+
+std::unique_ptr<ServerReadStream> ServerReadStreamIndex::release(Handle h) {
+  Slot& slot = slots_[h];
+  const ServerReadStream& s = streamAt(h);
+  auto is_h = [h](Handle x) { return x == h; };
+
+  by_key_.erase(keyHash(s), h);
+
+  if (slot.log_prev != INVALID_HANDLE) {
+    slots_[slot.log_prev].log_next = slot.log_next;
+  } else if (slot.log_next != INVALID_HANDLE) {
+    // Was the head, the next stream of the log takes over.
+    Handle* head = log_heads_.find(logHash(s.log_id_), is_h);
+    ld_check(head);
+    *head = slot.log_next;
+  } else {
+    log_heads_.erase(logHash(s.log_id_), h);
+  }
+  if (slot.log_next != INVALID_HANDLE) {
+    slots_[slot.log_next].log_prev = slot.log_prev;
+  }
+
+  if (slot.client_prev != INVALID_HANDLE) {
+    slots_[slot.client_prev].client_next = slot.client_next;
+  } else if (slot.client_next != INVALID_HANDLE) {
+    Handle* head = client_heads_.find(clientHash(s.client_id_), is_h);
+    ld_check(head);
+    *head = slot.client_next;
+  } else {
+    client_heads_.erase(clientHash(s.client_id_), h);
+  }
+  if (slot.client_next != INVALID_HANDLE) {
+    slots_[slot.client_next].client_prev = slot.client_prev;
+  }
+
+  std::unique_ptr<ServerReadStream> stream = std::move(slot.stream);
+  slot.log_prev = INVALID_HANDLE;
+  slot.client_prev = INVALID_HANDLE;
+  slot.client_next = INVALID_HANDLE;
+  slot.log_next = free_head_;
+  free_head_ = h;
+  --size_;
+  return stream;
+}
+
+bool ServerReadStreamIndex::erase(logid_t log_id,
+                                  ClientID client_id,
+                                  read_stream_id_t read_stream_id,
+                                  shard_index_t shard) {
+  Handle h = findHandle(log_id, client_id, read_stream_id, shard);
+  if (h == INVALID_HANDLE) {
+    return false;
+  }
+  release(h);
+  return true;
+}
+
+std::vector<std::pair<logid_t, shard_index_t>>
+ServerReadStreamIndex::eraseAllForClient(ClientID client_id) {
+  std::vector<Handle> handles;
+  const Handle* head =
+      client_heads_.find(clientHash(client_id), [&](Handle h) {
+        return streamAt(h).client_id_ == client_id;
+      });
+  for (Handle h = head ? *head : INVALID_HANDLE; h != INVALID_HANDLE;
+       h = slots_[h].client_next) {
+    handles.push_back(h);
+  }
+
+  std::vector<std::pair<logid_t, shard_index_t>> erased;
+  std::vector<std::unique_ptr<ServerReadStream>> streams;
+  erased.reserve(handles.size());
+  streams.reserve(handles.size());
+  for (Handle h : handles) {
+    streams.push_back(release(h));
+    erased.emplace_back(streams.back()->log_id_, streams.back()->shard_);
+  }
+  // Destroy the streams now that the index no longer references them.
+  streams.clear();
+  return erased;
+}
+
+bool ServerReadStreamIndex::hasStreams(logid_t log_id,
+                                       shard_index_t shard) const {
+  const Handle* head = log_heads_.find(logHash(log_id), [&](Handle h) {
+    return streamAt(h).log_id_ == log_id;
+  });
+  for (Handle h = head ? *head : INVALID_HANDLE; h != INVALID_HANDLE;
+       h = slots_[h].log_next) {
+    if (streamAt(h).shard_ == shard) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void ServerReadStreamIndex::clear() {
+  std::vector<std::unique_ptr<ServerReadStream>> streams;
+  streams.reserve(size_);
+  for (Slot& slot : slots_) {
+    if (slot.stream) {
+      streams.push_back(std::move(slot.stream));
+    }
+  }
+  std::vector<Slot>().swap(slots_);
+  free_head_ = INVALID_HANDLE;
+  size_ = 0;
+  by_key_.clear();
+  log_heads_.clear();
+  client_heads_.clear();
+  streams.clear();
+}
+
+void ServerReadStreamIndex::reserve(size_t n) {
+  slots_.reserve(n);
+  by_key_.reserve(n);
+}
+
+void ServerReadStreamIndex::HandleTable::insert(uint32_t hash, Handle handle) {
+  ld_check(handle != INVALID_HANDLE);
+  // Keep the load factor at most 3/4.
+  if ((size_ + 1) * 4 > entries_.size() * 3) {
+    rehash(std::max<size_t>(16, entries_.size() * 2));
+  }
+  size_t i = hash & mask();
+  while (entries_[i].handle != INVALID_HANDLE) {
+    i = (i + 1) & mask();
+  }
+  entries_[i].hash = hash;
+  entries_[i].handle = handle;
+  ++size_;
+}
+
+void ServerReadStreamIndex::HandleTable::erase(uint32_t hash, Handle handle) {
+  ld_check(!entries_.empty());
+  size_t i = hash & mask();
+  while (entries_[i].handle != handle) {
+    ld_check(entries_[i].handle != INVALID_HANDLE);
+    i = (i + 1) & mask();
+  }
+
+  // Backward-shift deletion: move back entries of the probe sequence that
+  // would no longer be reachable through the hole, instead of leaving a
+  // tombstone.
+  for (size_t j = (i + 1) & mask(); entries_[j].handle != INVALID_HANDLE;
+       j = (j + 1) & mask()) {
+    const size_t home = entries_[j].hash & mask();
+    // The entry at j can fill the hole at i unless its home slot lies
+    // cyclically in (i, j].
+    if (((j - home) & mask()) >= ((j - i) & mask())) {
+      entries_[i] = entries_[j];
+      i = j;
+    }
+  }
+  entries_[i] = Entry();
+  --size_;
+}
+
+void ServerReadStreamIndex::HandleTable::reserve(size_t n) {
+  size_t capacity = 16;
+  while (n * 4 > capacity * 3) {
+    capacity *= 2;
+  }
+  if (capacity > entries_.size()) {
+    rehash(capacity);
+  }
+}
+
+void ServerReadStreamIndex::HandleTable::rehash(size_t capacity) {
+  ld_check((capacity & (capacity - 1)) == 0);
+  std::vector<Entry> old(capacity);
+  old.swap(entries_);
+  for (const Entry& e : old) {
+    if (e.handle == INVALID_HANDLE) {
+      continue;
+    }
+    size_t i = e.hash & mask();
+    while (entries_[i].handle != INVALID_HANDLE) {
+      i = (i + 1) & mask();
+    }
+    entries_[i] = e;
+  }
+}
+
+void ServerReadStreamIndex::HandleTable::clear() {
+  std::vector<Entry>().swap(entries_);
+  size_ = 0;
+}
+
+}} // namespace facebook::logdevice
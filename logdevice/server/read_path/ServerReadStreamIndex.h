@@ -0,0 +1,270 @@
+/**
+ * Copyright (c) 2017-present, Facebook, Inc. and its affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "logdevice/common/ClientID.h"
+#include "logdevice/common/checks.h"
+#include "logdevice/common/types_internal.h"
+#include "logdevice/include/types.h"
+#include "logdevice/server/read_path/ServerReadStream.h"
+
+namespace facebook { namespace logdevice {
+
+/**
+ * @file Container of the ServerReadStream objects of AllServerReadStreams,
+ *       laid out for a large number (millions) of streams per worker.
+ *
+ *       Streams are addressed by 32-bit handles into a slot array.  Three
+ *       open-addressing tables of (hash, handle) pairs, 8 bytes per entry,
+ *       index them:
+ *       - by (log, client, read stream id, shard), to find a stream;
+ *       - by log, pointing at the head of an intrusive list of the log's
+ *         streams, walked on RELEASE fan-out;
+ *       - by client, pointing at the head of an intrusive list of the
+ *         client's streams, walked when the client disconnects.
+ *       The tables don't store keys: a key is compared by looking at the
+ *       stream the handle points to, which only happens on a hash match.
+ *       Growing a table only moves its entries around using the stored
+ *       hashes, without touching the streams.
+ *
+ *       Compared to a boost::multi_index with a hashed index per access
+ *       pattern, this saves the per-element nodes and shared_ptr control
+ *       blocks, and keeps the hot lookups within a couple of cache lines.
+ *
+ *       Pointers to streams are stable until the stream is erased.  The
+ *       callbacks of the forEach*() methods may modify the streams but not
+ *       the index.  Not thread-safe.
+ */
+
+class ServerReadStreamIndex {
+ public:
+  using Handle = uint32_t;
+  static constexpr Handle INVALID_HANDLE = std::numeric_limits<Handle>::max();
+
+  ServerReadStreamIndex();
+
+  ServerReadStreamIndex(const ServerReadStreamIndex&) = delete;
+  ServerReadStreamIndex& operator=(const ServerReadStreamIndex&) = delete;
+
+  ~ServerReadStreamIndex();
+
+  size_t size() const {
+    return size_;
+  }
+
+  /**
+   * @return the stream with the given key, or nullptr if there is none.
+   */
+  ServerReadStream* find(logid_t log_id,
+                         ClientID client_id,
+                         read_stream_id_t read_stream_id,
+                         shard_index_t shard) const;
+
+  /**
+   * Takes ownership of a stream.  There must not be a stream with the same
+   * key in the index.
+   *
+   * @return the inserted stream
+   */
+  ServerReadStream* insert(std::unique_ptr<ServerReadStream> stream);
+
+  /**
+   * Destroys the stream with the given key, if any.
+   *
+   * @return true if a stream was erased
+   */
+  bool erase(logid_t log_id,
+             ClientID client_id,
+             read_stream_id_t read_stream_id,
+             shard_index_t shard);
+
+  /**
+   * Destroys all streams of a client.
+   *
+   * @return the (log, shard) of each erased stream
+   */
+  std::vector<std::pair<logid_t, shard_index_t>>
+  eraseAllForClient(ClientID client_id);
+
+  /**
+   * @return true if there is at least one stream for the log on the shard.
+   */
+  bool hasStreams(logid_t log_id, shard_index_t shard) const;
+
+  /**
+   * Destroys all streams.
+   */
+  void clear();
+
+  /**
+   * Makes room for `n' streams without growing the tables.
+   */
+  void reserve(size_t n);
+
+  /**
+   * Calls cb(ServerReadStream&) on every stream of the log.
+   */
+  template <typename F>
+  void forEachInLog(logid_t log_id, F cb) const;
+
+  /**
+   * Calls cb(ServerReadStream&) on every stream of the client.
+   */
+  template <typename F>
+  void forEachForClient(ClientID client_id, F cb) const;
+
+  /**
+   * Calls cb(ServerReadStream&) on every stream.
+   */
+  template <typename F>
+  void forEach(F cb) const;
+
+ private:
+  struct Slot {
+    // nullptr if the slot is free.
+    std::unique_ptr<ServerReadStream> stream;
+    // Links of the per-log and per-client lists.  In a free slot,
+    // log_next links the free list.
+    Handle log_prev = INVALID_HANDLE;
+    Handle log_next = INVALID_HANDLE;
+    Handle client_prev = INVALID_HANDLE;
+    Handle client_next = INVALID_HANDLE;
+  };
+
+  /**
+   * Open-addressing hash table of handles with linear probing and
+   * backward-shift deletion.  Keys live in the streams; lookups take a
+   * predicate telling whether the handle's stream has the wanted key.
+   */
+  class HandleTable {
+   public:
+    // Returns a pointer to the table's copy of the handle, so that the
+    // caller can repoint it (list heads change), or nullptr if not found.
+    template <typename Eq>
+    Handle* find(uint32_t hash, Eq eq);
+    template <typename Eq>
+    const Handle* find(uint32_t hash, Eq eq) const {
+      return const_cast<HandleTable*>(this)->find(hash, eq);
+    }
+    void insert(uint32_t hash, Handle handle);
+    // The handle must be in the table.
+    void erase(uint32_t hash, Handle handle);
+    void reserve(size_t n);
+    void clear();
+
+   private:
+    struct Entry {
+      uint32_t hash = 0;
+      Handle handle = INVALID_HANDLE;
+    };
+
+    size_t mask() const {
+      return entries_.size() - 1;
+    }
+
+    // Rebuilds the table with the given number of entries, a power of two.
+    void rehash(size_t capacity);
+
+    // Power of two, or 0.
+    std::vector<Entry> entries_;
+    size_t size_{0};
+  };
+
+  static uint32_t keyHash(logid_t log_id,
+                          ClientID client_id,
+                          read_stream_id_t read_stream_id,
+                          shard_index_t shard);
+  static uint32_t keyHash(const ServerReadStream& stream) {
+    return keyHash(
+        stream.log_id_, stream.client_id_, stream.id_, stream.shard_);
+  }
+  static uint32_t logHash(logid_t log_id);
+  static uint32_t clientHash(ClientID client_id);
+
+  ServerReadStream& streamAt(Handle handle) const {
+    ld_check(handle < slots_.size());
+    ld_check(slots_[handle].stream);
+    return *slots_[handle].stream;
+  }
+
+  Handle findHandle(logid_t log_id,
+                    ClientID client_id,
+                    read_stream_id_t read_stream_id,
+                    shard_index_t shard) const;
+
+  // Unlinks the stream from all tables and lists and frees its slot.
+  // Returns the stream so that the caller destroys it once the index is
+  // consistent again: the destructor of ServerReadStream may look around.
+  std::unique_ptr<ServerReadStream> release(Handle handle);
+
+  std::vector<Slot> slots_;
+  // Head of the list of free slots, linked through Slot::log_next.
+  Handle free_head_{INVALID_HANDLE};
+  size_t size_{0};
+
+  HandleTable by_key_;
+  HandleTable log_heads_;
+  HandleTable client_heads_;
+};
+
+template <typename F>
+void ServerReadStreamIndex::forEachInLog(logid_t log_id, F cb) const {
+  const Handle* head = log_heads_.find(logHash(log_id), [&](Handle h) {
+    return streamAt(h).log_id_ == log_id;
+  });
+  for (Handle h = head ? *head : INVALID_HANDLE; h != INVALID_HANDLE;
+       h = slots_[h].log_next) {
+    cb(streamAt(h));
+  }
+}
+
+template <typename F>
+void ServerReadStreamIndex::forEachForClient(ClientID client_id, F cb) const {
+  const Handle* head = client_heads_.find(clientHash(client_id), [&](Handle h) {
+    return streamAt(h).client_id_ == client_id;
+  });
+  for (Handle h = head ? *head : INVALID_HANDLE; h != INVALID_HANDLE;
+       h = slots_[h].client_next) {
+    cb(streamAt(h));
+  }
+}
+
+template <typename F>
+void ServerReadStreamIndex::forEach(F cb) const {
+  for (const Slot& slot : slots_) {
+    if (slot.stream) {
+      cb(*slot.stream);
+    }
+  }
+}
+
+template <typename Eq>
+ServerReadStreamIndex::Handle* ServerReadStreamIndex::HandleTable::find(
+    uint32_t hash,
+    Eq eq) {
+  if (entries_.empty()) {
+    return nullptr;
+  }
+  for (size_t i = hash & mask();; i = (i + 1) & mask()) {
+    Entry& e = entries_[i];
+    if (e.handle == INVALID_HANDLE) {
+      return nullptr;
+    }
+    if (e.hash == hash && eq(e.handle)) {
+      return &e.handle;
+    }
+  }
+}
+
+}} // namespace facebook::logdevice
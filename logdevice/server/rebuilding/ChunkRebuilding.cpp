@@ -0,0 +1,380 @@
+/**
+ * Copyright (c) 2017-present, Facebook, Inc. and its affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+#include "logdevice/server/rebuilding/ChunkRebuilding.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+#include <folly/ScopeGuard.h>
+
+#include "logdevice/common/EventLoop.h"
+#include "logdevice/common/Processor.h"
+#include "logdevice/common/Worker.h"
+#include "logdevice/server/LogRebuilding.h"
+#include "logdevice/server/rebuilding/RebuildingBandwidthController.h"
+#include "logdevice/server/rebuilding/ShardRebuildingV2.h"
+
+namespace facebook { namespace logdevice {
+
+ChunkRebuilding::ChunkRebuilding(ShardRebuildingV2* owner,
+                                 shard_index_t shard,
+                                 std::unique_ptr<ChunkData> data,
+                                 std::shared_ptr<ReplicationScheme> replication)
+    : owner_(owner),
+      shard_(shard),
+      data_(std::move(data)),
+      replication_(std::move(replication)) {
+  ld_check(owner_ != nullptr);
+  ld_check(data_ != nullptr);
+  ld_check(!data_->records.empty());
+  ld_check(replication_ != nullptr);
+}
+
+ChunkRebuilding::~ChunkRebuilding() {
+  if (id_ != LOG_REBUILDING_ID_INVALID) {
+    map_->erase(id_);
+  }
+}
+
+void ChunkRebuilding::start() {
+  ld_check(id_ == LOG_REBUILDING_ID_INVALID);
+
+  map_ = &getChunkRebuildingMap();
+  durabilityTimer_ = createTimer([this] { onDurabilityTimeout(); });
+  restartTimer_ = createTimer([this] { restart(); });
+
+  restart();
+}
+
+void ChunkRebuilding::restart() {
+  if (id_ != LOG_REBUILDING_ID_INVALID) {
+    // Stale STOREDs for the previous attempt will be discarded because of the
+    // new id.
+    map_->erase(id_);
+    WORKER_STAT_INCR(chunk_rebuilding_restarts);
+  }
+  id_ = LogRebuilding::allocateRebuildingId();
+  map_->insert(id_, this);
+
+  cancelRestartTimer();
+  activateDurabilityTimer();
+
+  records_.clear();
+  records_.resize(data_->records.size());
+  stage_ = Stage::STORES;
+  nextRecord_ = 0;
+  numInFlight_ = 0;
+  numReceived_ = 0;
+  pendingFlushes_.clear();
+  stageStartTime_ = SteadyTimestamp::now();
+
+  makeProgress();
+}
+
+void ChunkRebuilding::onDurabilityTimeout() {
+  RATELIMIT_INFO(std::chrono::seconds(10),
+                 2,
+                 "Chunk of %lu records of log %lu [%s, %s] wasn't durably "
+                 "rebuilt within %lds, restarting it.",
+                 data_->records.size(),
+                 data_->logID.val_,
+                 lsn_to_string(data_->minLSN()).c_str(),
+                 lsn_to_string(data_->maxLSN()).c_str(),
+                 getRebuildingSettings()->record_durability_timeout.count());
+  restart();
+}
+
+size_t ChunkRebuilding::getMemoryUsage() const {
+  return data_->totalBytes +
+      data_->records.size() *
+      (sizeof(RawRecord) + sizeof(RecordState) + sizeof(RecordRebuildingStore));
+}
+
+int ChunkRebuilding::findRecord(lsn_t lsn) const {
+  const auto& recs = data_->records;
+  auto it = std::lower_bound(
+      recs.begin(), recs.end(), lsn, [](const RawRecord& r, lsn_t l) {
+        return r.lsn < l;
+      });
+  if (it == recs.end() || it->lsn != lsn) {
+    return -1;
+  }
+  return it - recs.begin();
+}
+
+void ChunkRebuilding::makeProgress() {
+  if (starting_) {
+    // We'll be called again when startStores() or startAmends() returns.
+    return;
+  }
+
+  while (true) {
+    if (stage_ == Stage::STORES) {
+      startStores();
+    } else if (stage_ == Stage::AMENDS) {
+      startAmends();
+    } else {
+      return;
+    }
+
+    if (numReceived_ < records_.size() || !pendingFlushes_.empty()) {
+      return;
+    }
+
+    // Everything in the current stage is received and durable.
+    auto elapsed_ms =
+        SteadyTimestamp(SteadyTimestamp::now() - stageStartTime_)
+            .toMilliseconds()
+            .count();
+    stageStartTime_ = SteadyTimestamp::now();
+    nextRecord_ = 0;
+    numReceived_ = 0;
+    ld_check(numInFlight_ == 0);
+
+    if (stage_ == Stage::STORES) {
+      WORKER_STAT_ADD(rebuilding_donor_store_persisted_ms, elapsed_ms);
+      stage_ = Stage::AMENDS;
+      continue;
+    }
+
+    WORKER_STAT_ADD(rebuilding_donor_amend_persisted_ms, elapsed_ms);
+    WORKER_STAT_ADD(rebuilding_donor_records_rebuilt, data_->records.size());
+    WORKER_STAT_ADD(rebuilding_donor_bytes_rebuilt, data_->totalBytes);
+    stage_ = Stage::DONE;
+    cancelDurabilityTimer();
+    cancelRestartTimer();
+    records_.clear();
+    owner_->onChunkRebuildingDone(this);
+    return;
+  }
+}
+
+void ChunkRebuilding::startStores() {
+  ld_check(!starting_);
+  starting_ = true;
+  SCOPE_EXIT {
+    starting_ = false;
+  };
+
+  const auto settings = getRebuildingSettings();
+  const bool read_only =
+      settings->read_only == RebuildingReadOnlyOption::ON_DONOR;
+  size_t max_in_flight = settings->max_records_in_flight;
+  auto controller = RebuildingBandwidthController::get();
+  if (controller) {
+    max_in_flight = controller->scaleLimit(max_in_flight, *settings.get());
+  }
+
+  while (numInFlight_ < max_in_flight &&
+         nextRecord_ < records_.size()) {
+    // RecordRebuildingStore takes ownership of the record. Give it a copy so
+    // that we can start over if needed.
+    const RawRecord& rec = data_->records[nextRecord_];
+    void* blob_copy = malloc(rec.blob.size);
+    if (blob_copy == nullptr) {
+      throw std::bad_alloc();
+    }
+    memcpy(blob_copy, rec.blob.data, rec.blob.size);
+
+    RecordState& st = records_[nextRecord_];
+    ++nextRecord_;
+    ++numInFlight_;
+    st.store = createRecordRebuildingStore(
+        RawRecord(rec.lsn, Slice(blob_copy, rec.blob.size), /* owned */ true));
+    st.store->start(read_only);
+  }
+}
+
+void ChunkRebuilding::startAmends() {
+  ld_check(!starting_);
+  starting_ = true;
+  SCOPE_EXIT {
+    starting_ = false;
+  };
+
+  const size_t max_amends_in_flight =
+      getRebuildingSettings()->max_amends_in_flight;
+
+  while (numInFlight_ < max_amends_in_flight &&
+         nextRecord_ < records_.size()) {
+    RecordState& st = records_[nextRecord_];
+    ++nextRecord_;
+    ++numInFlight_;
+    ld_check(st.amendState);
+    st.amend = createRecordRebuildingAmend(*st.amendState);
+    st.amend->start();
+  }
+}
+
+void ChunkRebuilding::onAllStoresReceived(
+    lsn_t lsn,
+    std::unique_ptr<FlushTokenMap> flushTokenMap) {
+  ld_check(stage_ == Stage::STORES);
+  int idx = findRecord(lsn);
+  ld_check(idx >= 0);
+  RecordState& st = records_[idx];
+  ld_check(st.store);
+  st.amendState = st.store->getRecordRebuildingAmendState();
+  // Destroys RecordRebuildingStore state machine.
+  st.store.reset();
+
+  ld_check(numInFlight_ > 0);
+  --numInFlight_;
+  ++numReceived_;
+  registerFlushTokens(*flushTokenMap);
+  makeProgress();
+}
+
+void ChunkRebuilding::onAllAmendsReceived(
+    lsn_t lsn,
+    std::unique_ptr<FlushTokenMap> flushTokenMap) {
+  ld_check(stage_ == Stage::AMENDS);
+  int idx = findRecord(lsn);
+  ld_check(idx >= 0);
+  RecordState& st = records_[idx];
+  ld_check(st.amend);
+  // Destroys RecordRebuildingAmend state machine.
+  st.amend.reset();
+  st.amendState.reset();
+
+  ld_check(numInFlight_ > 0);
+  --numInFlight_;
+  ++numReceived_;
+  registerFlushTokens(*flushTokenMap);
+  makeProgress();
+}
+
+void ChunkRebuilding::onCopysetInvalid(lsn_t lsn) {
+  RATELIMIT_INFO(std::chrono::seconds(10),
+                 2,
+                 "Copyset of record %lu%s became invalid while amending, "
+                 "restarting its chunk.",
+                 data_->logID.val_,
+                 lsn_to_string(lsn).c_str());
+  // The amend that called us can't be destroyed here.
+  activateRestartTimer();
+}
+
+void ChunkRebuilding::registerFlushTokens(const FlushTokenMap& tokens) {
+  for (const auto& kv : tokens) {
+    auto it = flushedUpTo_.find(kv.first);
+    if (it != flushedUpTo_.end() && it->second >= kv.second) {
+      // Memtable already flushed.
+      continue;
+    }
+    FlushToken& pending = pendingFlushes_[kv.first];
+    pending = std::max(pending, kv.second);
+  }
+}
+
+void ChunkRebuilding::onMemtableFlushed(node_index_t node_index,
+                                        ServerInstanceId server_instance_id,
+                                        FlushToken flushToken) {
+  if (stage_ == Stage::DONE) {
+    return;
+  }
+  auto key = std::make_pair(node_index, server_instance_id);
+  FlushToken& flushed = flushedUpTo_[key];
+  flushed = std::max(flushed, flushToken);
+
+  auto it = pendingFlushes_.find(key);
+  if (it != pendingFlushes_.end() && it->second <= flushToken) {
+    pendingFlushes_.erase(it);
+    makeProgress();
+  }
+}
+
+void ChunkRebuilding::onGracefulShutdown(node_index_t node_index,
+                                         ServerInstanceId server_instance_id) {
+  // A node flushes all its memtables when shutting down gracefully.
+  onMemtableFlushed(node_index, server_instance_id, FlushToken_MAX);
+}
+
+RecordRebuildingInterface* ChunkRebuilding::findRecordRebuilding(lsn_t lsn) {
+  int idx = findRecord(lsn);
+  if (idx < 0 || records_.empty()) {
+    return nullptr;
+  }
+  RecordState& st = records_[idx];
+  if (st.store) {
+    return st.store.get();
+  }
+  return st.amend.get();
+}
+
+ChunkRebuildingMap& ChunkRebuilding::getChunkRebuildingMap() {
+  return Worker::onThisThread()->runningChunkRebuildings();
+}
+
+std::unique_ptr<RecordRebuildingStore>
+ChunkRebuilding::createRecordRebuildingStore(RawRecord record) {
+  return std::make_unique<RecordRebuildingStore>(
+      data_->blockID, shard_, std::move(record), this, replication_);
+}
+
+std::unique_ptr<RecordRebuildingAmend>
+ChunkRebuilding::createRecordRebuildingAmend(
+    const RecordRebuildingAmendState& s) {
+  return std::make_unique<RecordRebuildingAmend>(s.lsn_,
+                                                 shard_,
+                                                 this,
+                                                 s.replication_,
+                                                 s.storeHeader_,
+                                                 s.flags_,
+                                                 s.newCopyset_,
+                                                 s.amendRecipients_,
+                                                 s.rebuildingWave_);
+}
+
+std::unique_ptr<LibeventTimer>
+ChunkRebuilding::createTimer(std::function<void()> callback) {
+  return std::make_unique<LibeventTimer>(
+      EventLoop::onThisThread()->getEventBase(), std::move(callback));
+}
+
+void ChunkRebuilding::activateDurabilityTimer() {
+  durabilityTimer_->activate(
+      getRebuildingSettings()->record_durability_timeout);
+}
+
+void ChunkRebuilding::cancelDurabilityTimer() {
+  durabilityTimer_->cancel();
+}
+
+void ChunkRebuilding::activateRestartTimer() {
+  if (!restartTimer_->isActive()) {
+    restartTimer_->activate(std::chrono::milliseconds(0));
+  }
+}
+
+void ChunkRebuilding::cancelRestartTimer() {
+  restartTimer_->cancel();
+}
+
+const RebuildingSet& ChunkRebuilding::getRebuildingSet() const {
+  return owner_->getRebuildingSet();
+}
+
+lsn_t ChunkRebuilding::getRebuildingVersion() const {
+  return owner_->getRebuildingVersion();
+}
+
+lsn_t ChunkRebuilding::getRestartVersion() const {
+  return owner_->getRestartVersion();
+}
+
+ServerInstanceId ChunkRebuilding::getServerInstanceId() const {
+  return Worker::onThisThread()->processor_->getServerInstanceId();
+}
+
+UpdateableSettings<RebuildingSettings>
+ChunkRebuilding::getRebuildingSettings() const {
+  return owner_->getRebuildingSettings();
+}
+
+}} // namespace facebook::logdevice
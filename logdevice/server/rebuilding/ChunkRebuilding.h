@@ -0,0 +1,182 @@
+/**
+ * Copyright (c) 2017-present, Facebook, Inc. and its affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "logdevice/common/LibeventTimer.h"
+#include "logdevice/common/RebuildingTypes.h"
+#include "logdevice/common/Timestamp.h"
+#include "logdevice/common/settings/RebuildingSettings.h"
+#include "logdevice/server/RecordRebuildingAmend.h"
+#include "logdevice/server/RecordRebuildingStore.h"
+#include "logdevice/server/rebuilding/RebuildingReadStorageTaskV2.h"
+
+namespace facebook { namespace logdevice {
+
+/**
+ * @file ChunkRebuilding re-replicates a chunk of consecutive records of one
+ *       log, read by ShardRebuildingV2. All records in a chunk belong to the
+ *       same epoch and have the same copyset.
+ *
+ * The workflow is the same as in LogRebuilding, but durability is tracked for
+ * the chunk as a whole:
+ *  1/ Run a RecordRebuildingStore for each record, at most
+ *     `max_records_in_flight` at a time.
+ *  2/ Once all stores are received, wait for the memtables they were written
+ *     to to be flushed.
+ *  3/ Run a RecordRebuildingAmend for each record, at most
+ *     `max_amends_in_flight` at a time.
+ *  4/ Once all amends are received, wait for them to be flushed too, then
+ *     notify the ShardRebuildingV2.
+ *
+ * If the chunk doesn't become durable within `record_durability_timeout`, or
+ * an amend finds that the copyset is no longer valid, the chunk starts over
+ * from 1/ with a new rebuilding id. The records are kept for that purpose.
+ *
+ * Lives on the worker thread of the owning ShardRebuildingV2, which destroys
+ * it. Callbacks from the worker's ChunkRebuildingMap never destroy it
+ * synchronously.
+ */
+
+class ShardRebuildingV2;
+
+class ChunkRebuilding : public RecordRebuildingOwner,
+                        public ChunkRebuildingInterface {
+ public:
+  using ChunkData = RebuildingReadStorageTaskV2::ChunkData;
+
+  ChunkRebuilding(ShardRebuildingV2* owner,
+                  shard_index_t shard,
+                  std::unique_ptr<ChunkData> data,
+                  std::shared_ptr<ReplicationScheme> replication);
+  ~ChunkRebuilding() override;
+
+  virtual void start();
+
+  // Memory accounted for this chunk by ShardRebuildingV2.
+  size_t getMemoryUsage() const;
+
+  size_t getBlockID() const {
+    return data_->blockID;
+  }
+
+  // RecordRebuildingOwner and ChunkRebuildingInterface implementation.
+
+  const RebuildingSet& getRebuildingSet() const override;
+  logid_t getLogID() const override {
+    return data_->logID;
+  }
+  shard_index_t getShard() const override {
+    return shard_;
+  }
+  lsn_t getRebuildingVersion() const override;
+  lsn_t getRestartVersion() const override;
+  log_rebuilding_id_t getLogRebuildingId() const override {
+    return id_;
+  }
+  ServerInstanceId getServerInstanceId() const override;
+  UpdateableSettings<RebuildingSettings> getRebuildingSettings() const override;
+
+  void onAllStoresReceived(
+      lsn_t lsn,
+      std::unique_ptr<FlushTokenMap> flushTokenMap) override;
+  void onCopysetInvalid(lsn_t lsn) override;
+  void onAllAmendsReceived(
+      lsn_t lsn,
+      std::unique_ptr<FlushTokenMap> flushTokenMap) override;
+
+  RecordRebuildingInterface* findRecordRebuilding(lsn_t lsn) override;
+  void onMemtableFlushed(node_index_t node_index,
+                         ServerInstanceId server_instance_id,
+                         FlushToken flushToken) override;
+  void onGracefulShutdown(node_index_t node_index,
+                          ServerInstanceId server_instance_id) override;
+
+ protected:
+  // The following may be overridden by tests.
+
+  virtual ChunkRebuildingMap& getChunkRebuildingMap();
+
+  virtual std::unique_ptr<RecordRebuildingStore>
+  createRecordRebuildingStore(RawRecord record);
+
+  virtual std::unique_ptr<RecordRebuildingAmend>
+  createRecordRebuildingAmend(const RecordRebuildingAmendState& state);
+
+  virtual std::unique_ptr<LibeventTimer>
+  createTimer(std::function<void()> callback);
+
+  virtual void activateDurabilityTimer();
+  virtual void cancelDurabilityTimer();
+
+  /**
+   * Activates restartTimer_ with zero timeout, unless already active.
+   */
+  virtual void activateRestartTimer();
+  virtual void cancelRestartTimer();
+
+  // Re-replicates the chunk from scratch.
+  void restart();
+  void onDurabilityTimeout();
+
+ private:
+  enum class Stage { STORES, AMENDS, DONE };
+
+  struct RecordState {
+    std::unique_ptr<RecordRebuildingStore> store;
+    std::unique_ptr<RecordRebuildingAmendState> amendState;
+    std::unique_ptr<RecordRebuildingAmend> amend;
+  };
+
+  // Index of the record with the given LSN, or -1.
+  int findRecord(lsn_t lsn) const;
+
+  // Starts stores or amends while below the in-flight limits, then moves to
+  // the next stage if everything in this one is received and durable.
+  void makeProgress();
+  void startStores();
+  void startAmends();
+
+  // Adds the tokens to pendingFlushes_, unless already flushed.
+  void registerFlushTokens(const FlushTokenMap& tokens);
+
+  ShardRebuildingV2* owner_;
+  const shard_index_t shard_;
+  std::unique_ptr<ChunkData> data_;
+  std::shared_ptr<ReplicationScheme> replication_;
+
+  log_rebuilding_id_t id_ = LOG_REBUILDING_ID_INVALID;
+  // Map in which the chunk is registered under id_. Set by start().
+  ChunkRebuildingMap* map_ = nullptr;
+  Stage stage_ = Stage::STORES;
+  std::vector<RecordState> records_;
+  // Index of the next record whose store or amend to start.
+  size_t nextRecord_ = 0;
+  size_t numInFlight_ = 0;
+  size_t numReceived_ = 0;
+
+  // Max flush token we're waiting for, per node and server instance.
+  FlushTokenMap pendingFlushes_;
+  // Max flush token known to be flushed, per node and server instance.
+  FlushTokenMap flushedUpTo_;
+
+  // True while startStores() or startAmends() is running. Used to prevent
+  // recursion when state machines complete synchronously.
+  bool starting_ = false;
+
+  SteadyTimestamp stageStartTime_;
+  std::unique_ptr<LibeventTimer> durabilityTimer_;
+  // Used for deferring restart() out of callbacks from RecordRebuilding
+  // state machines.
+  std::unique_ptr<LibeventTimer> restartTimer_;
+};
+
+}} // namespace facebook::logdevice
@@ -0,0 +1,94 @@
+/**
+ * Copyright (c) 2017-present, Facebook, Inc. and its affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+#include "logdevice/server/rebuilding/RebuildingBandwidthController.h"
+
+#include <algorithm>
+
+#include "logdevice/server/ServerProcessor.h"
+#include "logdevice/server/ServerWorker.h"
+
+namespace facebook { namespace logdevice {
+
+constexpr double RebuildingBandwidthController::kDecreaseRatio;
+constexpr std::chrono::milliseconds
+    RebuildingBandwidthController::kDecreaseInterval;
+constexpr double RebuildingBandwidthController::kIncreaseStep;
+constexpr std::chrono::milliseconds
+    RebuildingBandwidthController::kIncreaseInterval;
+
+RebuildingBandwidthController* RebuildingBandwidthController::get() {
+  ServerWorker* w = ServerWorker::onThisThread(false);
+  return w ? &w->processor_->getRebuildingBandwidthController() : nullptr;
+}
+
+void RebuildingBandwidthController::onStoreReply(
+    bool overloaded,
+    const RebuildingSettings& settings,
+    SteadyTimestamp now) {
+  if (!settings.throttle_on_overload) {
+    return;
+  }
+  const double min_factor = settings.throttle_min_fraction;
+  const int64_t now_ms = now.toMilliseconds().count();
+
+  if (overloaded) {
+    int64_t last_ms = lastDecreaseMs_.load();
+    if (now_ms - last_ms < kDecreaseInterval.count() ||
+        !lastDecreaseMs_.compare_exchange_strong(last_ms, now_ms)) {
+      // Another reply already decreased the factor recently.
+      return;
+    }
+  } else {
+    if (factor_.load() >= 1.0) {
+      return;
+    }
+    int64_t last_ms = lastIncreaseMs_.load();
+    if (now_ms - last_ms < kIncreaseInterval.count() ||
+        now_ms - lastDecreaseMs_.load() < kIncreaseInterval.count() ||
+        !lastIncreaseMs_.compare_exchange_strong(last_ms, now_ms)) {
+      // Already increased during this interval, or just decreased.
+      return;
+    }
+  }
+
+  double cur = factor_.load();
+  double next;
+  do {
+    next = overloaded ? cur * kDecreaseRatio : cur + kIncreaseStep;
+    next = std::max(min_factor, std::min(1.0, next));
+    if (next == cur) {
+      return;
+    }
+  } while (!factor_.compare_exchange_weak(cur, next));
+}
+
+double RebuildingBandwidthController::getThrottleFactor(
+    const RebuildingSettings& settings) const {
+  if (!settings.throttle_on_overload) {
+    return 1.0;
+  }
+  // The min fraction may have been raised since the factor was last updated.
+  return std::max(settings.throttle_min_fraction, factor_.load());
+}
+
+size_t
+RebuildingBandwidthController::scaleLimit(size_t limit,
+                                          const RebuildingSettings& settings)
+    const {
+  return std::max(
+      size_t(1), static_cast<size_t>(limit * getThrottleFactor(settings)));
+}
+
+double
+RebuildingBandwidthController::scaleLimit(double limit,
+                                          const RebuildingSettings& settings)
+    const {
+  return limit * getThrottleFactor(settings);
+}
+
+}} // namespace facebook::logdevice
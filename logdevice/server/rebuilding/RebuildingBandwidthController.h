@@ -0,0 +1,85 @@
+/**
+ * Copyright (c) 2017-present, Facebook, Inc. and its affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <limits>
+
+#include "logdevice/common/Timestamp.h"
+#include "logdevice/common/settings/RebuildingSettings.h"
+
+namespace facebook { namespace logdevice {
+
+/**
+ * @file Node-wide feedback controller that slows down rebuilding on this donor
+ *       while recipients of its stores report being overloaded.
+ *
+ * Recipients set STORED_Header::OVERLOADED when their storage task queue is
+ * overloaded, i.e. when rebuilding stores compete with foreground reads and
+ * appends for storage threads. The controller keeps a throttle factor in
+ * [rebuilding-throttle-min-fraction, 1]:
+ *  - an overloaded reply halves it, at most once per kDecreaseInterval so
+ *    that a burst of replies caused by the same episode counts once;
+ *  - successful, not overloaded, replies increase it by kIncreaseStep, at most
+ *    once per kIncreaseInterval and not within kIncreaseInterval of a
+ *    decrease. The recovery rate thus doesn't depend on how many stores are
+ *    in flight.
+ *
+ * The factor scales the concurrency limits of the donor: logs or bytes read
+ * in flight by ShardRebuilding and records stored in flight by LogRebuilding
+ * and ChunkRebuilding. It thus caps both read and write bandwidth of the
+ * donor.
+ *
+ * Fed and used by all workers, so all methods are thread safe.
+ */
+
+class RebuildingBandwidthController {
+ public:
+  // Returns the controller of the ServerProcessor of the current thread, or
+  // nullptr if not running on a ServerWorker (e.g. in tests).
+  static RebuildingBandwidthController* get();
+
+  // Factor by which an overloaded reply decreases the throttle factor.
+  static constexpr double kDecreaseRatio = 0.5;
+  // Minimum time between two decreases.
+  static constexpr std::chrono::milliseconds kDecreaseInterval{100};
+  // Increase of the throttle factor per kIncreaseInterval with successful
+  // replies. It takes about 10s to go back to full speed from the minimum.
+  static constexpr double kIncreaseStep = 0.01;
+  static constexpr std::chrono::milliseconds kIncreaseInterval{100};
+
+  /**
+   * Called for every STORED received by a rebuilding store or amend.
+   * Does nothing unless rebuilding-throttle-on-overload is set.
+   *
+   * @param overloaded  true if the recipient reported being overloaded or
+   *                    dropped the store.
+   */
+  void onStoreReply(bool overloaded,
+                    const RebuildingSettings& settings,
+                    SteadyTimestamp now = SteadyTimestamp::now());
+
+  // Current throttle factor, 1 if not throttled.
+  double getThrottleFactor(const RebuildingSettings& settings) const;
+
+  // Scales the given limit by the throttle factor. Never returns less than 1.
+  size_t scaleLimit(size_t limit, const RebuildingSettings& settings) const;
+  double scaleLimit(double limit, const RebuildingSettings& settings) const;
+
+ private:
+  std::atomic<double> factor_{1.0};
+  // Time of the last decrease and increase, in milliseconds since steady
+  // clock epoch.
+  std::atomic<int64_t> lastDecreaseMs_{
+      std::numeric_limits<int64_t>::min() / 2};
+  std::atomic<int64_t> lastIncreaseMs_{
+      std::numeric_limits<int64_t>::min() / 2};
+};
+
+}} // namespace facebook::logdevice
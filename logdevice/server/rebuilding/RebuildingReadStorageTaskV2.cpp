@@ -0,0 +1,251 @@
+/**
+ * Copyright (c) 2017-present, Facebook, Inc. and its affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+#include "logdevice/server/rebuilding/RebuildingReadStorageTaskV2.h"
+
+#include <chrono>
+#include <cstdlib>
+
+#include "logdevice/common/LocalLogStoreRecordFormat.h"
+#include "logdevice/common/Worker.h"
+#include "logdevice/common/debug.h"
+#include "logdevice/common/util.h"
+#include "logdevice/server/LogRebuilding.h"
+#include "logdevice/server/RebuildingReadStorageTask.h"
+#include "logdevice/server/rebuilding/ShardRebuildingV2.h"
+#include "logdevice/server/storage_tasks/StorageThreadPool.h"
+
+namespace facebook { namespace logdevice {
+
+namespace {
+
+/**
+ * Same as LogRebuilding's filter, but also filters out logs, epochs and LSNs
+ * that are not in the RebuildingPlan, which LogRebuilding does by only
+ * reading the needed LSN ranges of one log.
+ */
+class AllLogsRebuildingReadFilter : public LogRebuilding::RebuildingReadFilter {
+ public:
+  explicit AllLogsRebuildingReadFilter(
+      const RebuildingReadStorageTaskV2::Context& context)
+      : RebuildingReadFilter(context.rebuildingSet, LOGID_INVALID),
+        context_(context) {
+    scd_my_shard_id_ = context.myShardID;
+  }
+
+  bool operator()(logid_t log,
+                  lsn_t lsn,
+                  const ShardID* copyset,
+                  const copyset_size_t copyset_size,
+                  const csi_flags_t csi_flags,
+                  RecordTimestamp min_ts,
+                  RecordTimestamp max_ts) override {
+    // The iterator usually calls us many times in a row for the same log.
+    if (log != cachedLog_) {
+      auto it = context_.logs.find(log);
+      cachedLog_ = log;
+      cachedPlan_ = it == context_.logs.end() ? nullptr : it->second.get();
+    }
+    if (cachedPlan_ == nullptr || lsn > cachedPlan_->untilLSN) {
+      return false;
+    }
+    auto epoch_it = cachedPlan_->epochsToRead.find(lsn_to_epoch(lsn).val_);
+    if (epoch_it == cachedPlan_->epochsToRead.end()) {
+      return false;
+    }
+    scd_replication_ =
+        epoch_it->second->replication.getReplicationFactor();
+
+    return RebuildingReadFilter::operator()(
+        log, lsn, copyset, copyset_size, csi_flags, min_ts, max_ts);
+  }
+
+ private:
+  const RebuildingReadStorageTaskV2::Context& context_;
+  logid_t cachedLog_ = LOGID_INVALID;
+  const RebuildingPlan* cachedPlan_ = nullptr;
+};
+
+} // namespace
+
+RebuildingReadStorageTaskV2::RebuildingReadStorageTaskV2(
+    WeakRefHolder<ShardRebuildingV2>::Ref owner,
+    std::shared_ptr<Context> _context)
+    : StorageTask(StorageTask::Type::REBUILDING_READ),
+      context(std::move(_context)),
+      owner_(std::move(owner)) {}
+
+void RebuildingReadStorageTaskV2::execute() {
+  ld_check(context);
+  ld_check(!context->reachedEnd);
+  Context& ctx = *context;
+
+  STAT_INCR(
+      storageThreadPool_->stats(), num_in_flight_rebuilding_read_storage_tasks);
+
+  if (!ctx.iterator) {
+    LocalLogStore::ReadOptions opts(
+        "RebuildingReadStorageTaskV2", /* rebuilding */ true);
+    opts.allow_blocking_io = true;
+    opts.tailing = false;
+    opts.fill_cache = ctx.useRocksDBCache;
+    opts.allow_copyset_index = true;
+    ctx.iterator = storageThreadPool_->getLocalLogStore().readAllLogs(opts);
+  }
+  LocalLogStore::AllLogsIterator& it = *ctx.iterator;
+
+  AllLogsRebuildingReadFilter filter(ctx);
+  LocalLogStore::ReadStats stats;
+  stats.max_bytes_to_read = ctx.maxBatchBytes;
+  stats.stop_reading_after_timestamp = ctx.windowEnd.toMilliseconds();
+  stats.read_start_time = std::chrono::steady_clock::now();
+
+  auto start = std::chrono::steady_clock::now();
+
+  it.seek(ctx.nextLocation ? *ctx.nextLocation : *it.minLocation(),
+          &filter,
+          &stats);
+
+  while (true) {
+    IteratorState state = it.state();
+    if (state == IteratorState::AT_RECORD) {
+      addRecord(it.getLogID(), it.getLSN(), it.getRecord());
+      it.next(&filter, &stats);
+      continue;
+    }
+
+    if (state == IteratorState::AT_END) {
+      ctx.reachedEnd = true;
+      ctx.nextLocation.reset();
+      ctx.nextTimestamp = RecordTimestamp::max();
+    } else if (state == IteratorState::LIMIT_REACHED) {
+      ctx.nextLocation = it.getLocation();
+      if (stats.max_read_timestamp_lower_bound.hasValue()) {
+        ctx.nextTimestamp =
+            RecordTimestamp(stats.max_read_timestamp_lower_bound.value());
+      }
+    } else {
+      // WOULDBLOCK is impossible because we allow blocking IO.
+      ld_check(state == IteratorState::ERROR);
+      // Discard the batch. The next task will read it again from the same
+      // place.
+      status = E::FAILED;
+      chunks.clear();
+      totalBytes = 0;
+    }
+    break;
+  }
+
+  // Don't pin memtables and partitions while waiting for records to be
+  // re-replicated.
+  it.invalidate();
+
+  STAT_ADD(storageThreadPool_->stats(),
+           rebuilding_read_storage_tasks_allocated_records_bytes,
+           totalBytes);
+  STAT_ADD(storageThreadPool_->stats(),
+           read_streams_num_records_late_filtered_rebuilding,
+           filter.nRecordsLateFiltered);
+  STAT_ADD(storageThreadPool_->stats(),
+           rebuilding_payload_bytes_skipped,
+           RebuildingReadStorageTask::estimatePayloadBytesSkipped(
+               LocalLogStore::ReadStats(), stats, ctx.recordSizes));
+
+  const auto latency_sec = sec_since(start);
+  if (latency_sec > 10) {
+    ld_warning("Reading a batch took %lds. status=%s, num chunks=%lu, "
+               "num bytes read=%lu, partitions seen=%lu",
+               latency_sec,
+               error_name(status),
+               chunks.size(),
+               totalBytes,
+               stats.seen_logsdb_partitions);
+  }
+}
+
+void RebuildingReadStorageTaskV2::addRecord(logid_t log,
+                                            lsn_t lsn,
+                                            Slice blob) {
+  Context& ctx = *context;
+
+  copyset_size_t copyset_size;
+  Payload payload;
+  copysetBuf_.resize(COPYSET_SIZE_MAX);
+  int rv = LocalLogStoreRecordFormat::parse(blob,
+                                            nullptr,
+                                            nullptr,
+                                            nullptr,
+                                            nullptr,
+                                            &copyset_size,
+                                            copysetBuf_.data(),
+                                            copysetBuf_.size(),
+                                            nullptr,
+                                            nullptr,
+                                            &payload,
+                                            ctx.myShardID.shard());
+  if (rv != 0) {
+    RATELIMIT_ERROR(std::chrono::seconds(1),
+                    1,
+                    "Cannot parse record at lsn %s of log %lu.",
+                    lsn_to_string(lsn).c_str(),
+                    log.val_);
+    // RecordRebuildingStore will skip the record. Give it a chunk of its own.
+    copysetBuf_.clear();
+    payload = Payload();
+  } else {
+    copysetBuf_.resize(copyset_size);
+  }
+
+  ChunkData* chunk = chunks.empty() ? nullptr : chunks.back().get();
+  if (chunk == nullptr || chunk->logID != log ||
+      lsn_to_epoch(chunk->maxLSN()) != lsn_to_epoch(lsn) ||
+      copysetBuf_.empty() || copysetBuf_ != lastCopyset_ ||
+      chunkPayloadBytes_ > ctx.maxChunkBytes) {
+    chunks.push_back(std::make_unique<ChunkData>());
+    chunk = chunks.back().get();
+    chunk->logID = log;
+    chunk->blockID = ctx.nextBlockID++;
+    chunkPayloadBytes_ = 0;
+  }
+  std::swap(lastCopyset_, copysetBuf_);
+  chunkPayloadBytes_ += payload.size();
+
+  // Copy the record out of the local log store into a malloc'd buffer, since
+  // it will be sent at some later time, after the iterator is invalidated.
+  void* blob_copy = malloc(blob.size);
+  if (blob_copy == nullptr) {
+    throw std::bad_alloc();
+  }
+  memcpy(blob_copy, blob.data, blob.size);
+  chunk->records.emplace_back(lsn,
+                              Slice(blob_copy, blob.size),
+                              true // owned, we malloc-d the memory
+  );
+  chunk->totalBytes += blob.size;
+  totalBytes += blob.size;
+}
+
+void RebuildingReadStorageTaskV2::onDone() {
+  WORKER_STAT_DECR(num_in_flight_rebuilding_read_storage_tasks);
+
+  ShardRebuildingV2* owner = owner_.get();
+  if (owner == nullptr) {
+    // The ShardRebuildingV2 was aborted.
+    return;
+  }
+  owner->onReadTaskDone(*this);
+}
+
+void RebuildingReadStorageTaskV2::onDropped() {
+  ShardRebuildingV2* owner = owner_.get();
+  if (owner == nullptr) {
+    return;
+  }
+  owner->onReadTaskDropped(*this);
+}
+
+}} // namespace facebook::logdevice
@@ -0,0 +1,140 @@
+/**
+ * Copyright (c) 2017-present, Facebook, Inc. and its affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+#pragma once
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "logdevice/common/RebuildingTypes.h"
+#include "logdevice/common/Timestamp.h"
+#include "logdevice/common/WeakRefHolder.h"
+#include "logdevice/include/types.h"
+#include "logdevice/server/RebuildingReadStorageTask.h"
+#include "logdevice/server/locallogstore/LocalLogStore.h"
+#include "logdevice/server/rebuilding/RebuildingPlan.h"
+#include "logdevice/server/storage_tasks/StorageTask.h"
+
+namespace facebook { namespace logdevice {
+
+/**
+ * @file Task created by ShardRebuildingV2 to read the next batch of records
+ *       of all logs of the shard. Reads through an AllLogsIterator, which
+ *       goes over the shard partition by partition, so each partition is read
+ *       sequentially and only once. Records are grouped into chunks of
+ *       consecutive records of the same log and epoch with the same copyset.
+ *       Upon completion, the task (including the chunks) gets sent back to
+ *       the worker thread.
+ */
+
+class ShardRebuildingV2;
+
+class RebuildingReadStorageTaskV2 : public StorageTask {
+ public:
+  // A group of records that will be re-replicated together by a
+  // ChunkRebuilding.
+  struct ChunkData {
+    logid_t logID;
+    // Used for seeding the copyset selector. Unique within the shard.
+    size_t blockID;
+    // Owned copies of the records, in increasing order of LSN.
+    std::vector<RawRecord> records;
+    // Sum of record blob sizes.
+    size_t totalBytes = 0;
+
+    lsn_t minLSN() const {
+      return records.front().lsn;
+    }
+    lsn_t maxLSN() const {
+      return records.back().lsn;
+    }
+  };
+
+  // State of the reading, shared by consecutive storage tasks of the same
+  // ShardRebuildingV2. At most one task uses it at a time; the worker thread
+  // only touches it while no task is in flight.
+  struct Context {
+    std::shared_ptr<const RebuildingSet> rebuildingSet;
+    ShardID myShardID;
+    // What to read for each log. Not modified after rebuilding starts.
+    std::unordered_map<logid_t, std::unique_ptr<RebuildingPlan>, logid_t::Hash>
+        logs;
+
+    // Limits of each batch, updated by ShardRebuildingV2 before each task.
+    RecordTimestamp windowEnd = RecordTimestamp::min();
+    size_t maxBatchBytes = 0;
+    // Max sum of payload sizes in a chunk.
+    size_t maxChunkBytes = 0;
+    bool useRocksDBCache = true;
+
+    // Created by the first task, kept across tasks.
+    std::unique_ptr<LocalLogStore::AllLogsIterator> iterator;
+    // Where the next task should start reading. nullptr before the first
+    // task.
+    std::unique_ptr<LocalLogStore::AllLogsIterator::Location> nextLocation;
+
+    // True if we read everything.
+    bool reachedEnd = false;
+    // Lower bound on timestamps of records at nextLocation. Comes from
+    // partition boundaries. If it's greater than windowEnd, we're waiting for
+    // the global window to slide.
+    RecordTimestamp nextTimestamp = RecordTimestamp::min();
+
+    size_t nextBlockID = 0;
+
+    // Records read so far by all tasks, for estimating the size of records
+    // filtered out by the copyset index.
+    RebuildingReadStorageTask::ReadRecordSizes recordSizes;
+  };
+
+  RebuildingReadStorageTaskV2(WeakRefHolder<ShardRebuildingV2>::Ref owner,
+                              std::shared_ptr<Context> context);
+
+  void execute() override;
+
+  void onDone() override;
+
+  void onDropped() override;
+
+  ThreadType getThreadType() const override {
+    // Read tasks may take a while to execute, so they shouldn't block fast
+    // write operations.
+    return ThreadType::SLOW;
+  }
+
+  Priority getPriority() const override {
+    // Rebuilding reads should be lo-pri compared to regular reads
+    return Priority::LOW;
+  }
+
+  std::shared_ptr<Context> context;
+
+  //
+  // These will hold the result after execute()
+  //
+  Status status = E::OK;
+  std::vector<std::unique_ptr<ChunkData>> chunks;
+  // Total amount of record bytes that were allocated by this storage task.
+  size_t totalBytes = 0;
+
+ private:
+  WeakRefHolder<ShardRebuildingV2>::Ref owner_;
+
+  // Copies the record and appends it to the last chunk in `chunks` or to a
+  // new one.
+  void addRecord(logid_t log, lsn_t lsn, Slice blob);
+
+  // Copyset of the last record added by addRecord(). Cleared if the record
+  // couldn't be parsed.
+  std::vector<ShardID> lastCopyset_;
+  std::vector<ShardID> copysetBuf_;
+  // Sum of payload sizes in the last chunk.
+  size_t chunkPayloadBytes_ = 0;
+};
+
+}} // namespace facebook::logdevice
@@ -12,6 +12,7 @@
 #include "logdevice/common/Worker.h"
 #include "logdevice/common/configuration/UpdateableConfig.h"
 #include "logdevice/server/locallogstore/PartitionedRocksDBStore.h"
+#include "logdevice/server/rebuilding/RebuildingBandwidthController.h"
 
 namespace facebook { namespace logdevice {
 
@@ -416,13 +417,18 @@ bool ShardRebuildingV1::isLogRebuilding(logid_t logid) {
 
 void ShardRebuildingV1::wakeUpLogs() {
   size_t max_logs_in_flight = rebuildingSettings_->max_logs_in_flight;
+  auto controller = RebuildingBandwidthController::get();
+  if (controller) {
+    max_logs_in_flight =
+        controller->scaleLimit(max_logs_in_flight, *rebuildingSettings_.get());
+  }
 
   wakeupQueue_.advanceWindow(localWindowEnd_);
 
   if (max_logs_in_flight <= nRunningLogRebuildings_) {
-    // Note: "max_logs_in_flight" can be decreased at runtime so
-    //       "nRunningLogRebuildings_" can exceed this
-    //       value while active logs drain.
+    // Note: "max_logs_in_flight" can be decreased at runtime or by the
+    //       bandwidth controller so "nRunningLogRebuildings_" can exceed
+    //       this value while active logs drain.
     return;
   }
 
@@ -0,0 +1,382 @@
+/**
+ * Copyright (c) 2017-present, Facebook, Inc. and its affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+#include "logdevice/server/rebuilding/ShardRebuildingV2.h"
+
+#include "logdevice/common/AdminCommandTable.h"
+#include "logdevice/common/EventLoop.h"
+#include "logdevice/common/MetaDataLog.h"
+#include "logdevice/common/Worker.h"
+#include "logdevice/common/configuration/UpdateableConfig.h"
+#include "logdevice/server/ServerWorker.h"
+#include "logdevice/server/rebuilding/RebuildingBandwidthController.h"
+#include "logdevice/server/storage_tasks/PerWorkerStorageTaskQueue.h"
+
+namespace facebook { namespace logdevice {
+
+ShardRebuildingV2::ShardRebuildingV2(
+    shard_index_t shard,
+    lsn_t rebuilding_version,
+    lsn_t restart_version,
+    std::shared_ptr<const RebuildingSet> rebuilding_set,
+    LocalLogStore* store,
+    UpdateableSettings<RebuildingSettings> rebuilding_settings,
+    std::shared_ptr<UpdateableConfig> config,
+    Listener* listener)
+    : rebuildingVersion_(rebuilding_version),
+      restartVersion_(restart_version),
+      shard_(shard),
+      rebuildingSet_(rebuilding_set),
+      store_(store),
+      rebuildingSettings_(rebuilding_settings),
+      config_(config),
+      listener_(listener),
+      readContext_(std::make_shared<RebuildingReadStorageTaskV2::Context>()),
+      refHolder_(this) {}
+
+ShardRebuildingV2::~ShardRebuildingV2() {
+  STAT_SUB(getStats(), num_logs_rebuilding, readContext_->logs.size());
+  setWaitingOnGlobalWindow(false);
+  // Unregister chunks from the worker before the rest of the state goes away.
+  chunks_.clear();
+  finishedChunks_.clear();
+}
+
+void ShardRebuildingV2::start(
+    std::unordered_map<logid_t, std::unique_ptr<RebuildingPlan>> plan) {
+  auto cfg = config_->get();
+  RebuildingReadStorageTaskV2::Context& ctx = *readContext_;
+  ctx.rebuildingSet = rebuildingSet_;
+  ctx.myShardID =
+      ShardID(cfg->serverConfig()->getMyNodeID().index(), shard_);
+  for (auto& p : plan) {
+    ld_check(p.second != nullptr);
+    ctx.logs.emplace(p.first, std::move(p.second));
+  }
+  STAT_ADD(getStats(), num_logs_rebuilding, ctx.logs.size());
+
+  readRetryTimer_ = createReadRetryTimer([this] { tryMakeProgress(); });
+  cleanupTimer_ = createCleanupTimer();
+
+  tryMakeProgress();
+}
+
+void ShardRebuildingV2::advanceGlobalWindow(RecordTimestamp new_window_end) {
+  globalWindowEnd_ = new_window_end;
+  if (readRetryTimer_ && !completed_) {
+    // start() was called.
+    tryMakeProgress();
+  }
+}
+
+void ShardRebuildingV2::noteConfigurationChanged() {
+  std::shared_ptr<Configuration> config = config_->get();
+
+  for (const auto& p : readContext_->logs) {
+    logid_t logid = p.first;
+    if (MetaDataLog::isMetaDataLog(logid)) {
+      // rebuilding metadata logs regardless of whether the data log exists
+      // or not
+      continue;
+    }
+    if (removedLogs_.count(logid) ||
+        config->getLogGroupByIDRaw(logid) != nullptr) {
+      continue;
+    }
+    ld_info("Log:%lu marked for rebuilding was removed from config.",
+            logid.val());
+    removedLogs_.insert(logid);
+  }
+
+  // Abort chunks of removed logs.
+  for (auto it = chunks_.begin(); it != chunks_.end();) {
+    if (removedLogs_.count(it->second->getLogID())) {
+      bytesInFlight_ -= it->second->getMemoryUsage();
+      it = chunks_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+
+  if (readRetryTimer_ && !completed_) {
+    tryMakeProgress();
+  }
+}
+
+void ShardRebuildingV2::getDebugInfo(InfoShardsRebuildingTable& table) const {
+  table.set<4>(nextTimestamp_.toMilliseconds())
+      .set<6>(chunks_.size())
+      .set<9>(bytesInFlight_)
+      .set<12>(readContext_->logs.size() - removedLogs_.size());
+}
+
+void ShardRebuildingV2::tryMakeProgress() {
+  ld_check(!completed_);
+
+  if (readTaskInFlight_) {
+    return;
+  }
+
+  if (reachedEnd_) {
+    if (chunks_.empty()) {
+      completed_ = true;
+      listener_->onShardRebuildingComplete(shard_);
+      // `this` may be destroyed here.
+    }
+    return;
+  }
+
+  if (readRetryTimer_->isActive()) {
+    return;
+  }
+
+  double max_mb_in_flight =
+      rebuildingSettings_->total_log_rebuilding_size_per_shard_mb;
+  auto controller = RebuildingBandwidthController::get();
+  if (controller) {
+    max_mb_in_flight =
+        controller->scaleLimit(max_mb_in_flight, *rebuildingSettings_.get());
+  }
+  size_t max_bytes_in_flight = max_mb_in_flight * 1024 * 1024;
+  if (bytesInFlight_ >= max_bytes_in_flight) {
+    // Will be called again when some chunk is done.
+    return;
+  }
+
+  if (nextTimestamp_ > globalWindowEnd_) {
+    setWaitingOnGlobalWindow(true);
+    if (nextTimestamp_ != lastReportedTimestamp_) {
+      lastReportedTimestamp_ = nextTimestamp_;
+      listener_->notifyShardDonorProgress(
+          shard_, nextTimestamp_, rebuildingVersion_);
+    }
+    return;
+  }
+  setWaitingOnGlobalWindow(false);
+
+  sendReadTask();
+}
+
+void ShardRebuildingV2::sendReadTask() {
+  ld_check(!readTaskInFlight_);
+  auto settings = rebuildingSettings_.get();
+  RebuildingReadStorageTaskV2::Context& ctx = *readContext_;
+  ctx.windowEnd = globalWindowEnd_;
+  ctx.maxBatchBytes = settings->max_batch_bytes;
+  ctx.maxChunkBytes = getSettings().sticky_copysets_block_size;
+  ctx.useRocksDBCache = settings->use_rocksdb_cache;
+
+  readTaskInFlight_ = true;
+  putStorageTask(std::make_unique<RebuildingReadStorageTaskV2>(
+      refHolder_.ref(), readContext_));
+}
+
+void ShardRebuildingV2::putStorageTask(
+    std::unique_ptr<RebuildingReadStorageTaskV2> task) {
+  ServerWorker::onThisThread()->getStorageTaskQueueForShard(shard_)->putTask(
+      std::move(task));
+}
+
+void ShardRebuildingV2::onReadTaskDone(RebuildingReadStorageTaskV2& task) {
+  ld_check(readTaskInFlight_);
+  ld_check(task.context == readContext_);
+  readTaskInFlight_ = false;
+
+  if (task.status != E::OK) {
+    ld_error("An error occurred while reading from the local log store for "
+             "rebuilding of shard %u. Will retry after %ldms",
+             shard_,
+             readRetryTimer_->getNextDelay().count());
+    readRetryTimer_->activate();
+    return;
+  }
+  readRetryTimer_->reset();
+
+  reachedEnd_ = readContext_->reachedEnd;
+  nextTimestamp_ = readContext_->nextTimestamp;
+
+  startChunks(std::move(task.chunks));
+  tryMakeProgress();
+  // `this` may be destroyed here.
+}
+
+void ShardRebuildingV2::onReadTaskDropped(RebuildingReadStorageTaskV2&) {
+  ld_check(readTaskInFlight_);
+  readTaskInFlight_ = false;
+
+  ld_error("Could not read from local log store for rebuilding of shard %u "
+           "because read storage task was dropped. Will retry after %ldms",
+           shard_,
+           readRetryTimer_->getNextDelay().count());
+  readRetryTimer_->activate();
+}
+
+void ShardRebuildingV2::startChunks(
+    std::vector<std::unique_ptr<RebuildingReadStorageTaskV2::ChunkData>>
+        chunks) {
+  for (auto& data : chunks) {
+    ld_check(data != nullptr);
+    if (removedLogs_.count(data->logID)) {
+      continue;
+    }
+    auto replication = getReplicationScheme(data->logID, data->minLSN());
+    if (replication == nullptr) {
+      // The read filter only lets through epochs from the plan.
+      ld_check(false);
+      continue;
+    }
+
+    auto chunk = createChunkRebuilding(std::move(data), std::move(replication));
+    ChunkRebuilding* ptr = chunk.get();
+    bytesInFlight_ += ptr->getMemoryUsage();
+    auto ins = chunks_.emplace(ptr->getBlockID(), std::move(chunk));
+    ld_check(ins.second);
+    ptr->start();
+  }
+}
+
+std::shared_ptr<ReplicationScheme>
+ShardRebuildingV2::getReplicationScheme(logid_t log, lsn_t lsn) {
+  auto plan_it = readContext_->logs.find(log);
+  if (plan_it == readContext_->logs.end()) {
+    return nullptr;
+  }
+  const RebuildingPlan& plan = *plan_it->second;
+  auto epoch_it = plan.epochsToRead.find(lsn_to_epoch(lsn).val_);
+  if (epoch_it == plan.epochsToRead.end()) {
+    return nullptr;
+  }
+
+  auto& scheme =
+      replicationSchemes_[std::make_pair(log, epoch_it->first.lower())];
+  if (scheme != nullptr) {
+    return scheme;
+  }
+
+  auto cfg = config_->get();
+  auto log_group = cfg->getLogGroupByIDRaw(log);
+  auto& rebuilding_shards = rebuildingSet_->shards;
+  auto it = rebuilding_shards.find(readContext_->myShardID);
+  bool relocate_local_records = it != rebuilding_shards.end() &&
+      it->second.mode == RebuildingMode::RELOCATE;
+  scheme = std::make_shared<ReplicationScheme>(
+      log,
+      *epoch_it->second,
+      cfg->serverConfig(),
+      log_group ? &log_group->attrs() : nullptr,
+      getSettings(),
+      relocate_local_records);
+
+  // Same as LogRebuilding: don't pick shards that need to be rebuilt.
+  for (const auto& kv : rebuilding_shards) {
+    if (!cfg->serverConfig()->getNode(kv.first.node())) {
+      // This node is no longer in the config.
+      continue;
+    }
+    if (!kv.second.dc_dirty_ranges.empty()) {
+      // Shard is only missing some time-ranged records. It should be
+      // up and able to take stores.
+      continue;
+    }
+    scheme->nodeset_state->setNotAvailableUntil(
+        kv.first,
+        std::chrono::steady_clock::time_point::max(),
+        NodeSetState::NotAvailableReason::STORE_DISABLED);
+  }
+  return scheme;
+}
+
+void ShardRebuildingV2::onChunkRebuildingDone(ChunkRebuilding* chunk) {
+  auto it = chunks_.find(chunk->getBlockID());
+  ld_check(it != chunks_.end());
+  ld_check(it->second.get() == chunk);
+  ld_check(bytesInFlight_ >= chunk->getMemoryUsage());
+  bytesInFlight_ -= chunk->getMemoryUsage();
+
+  // We're inside a callback from the chunk. Destroy it later.
+  finishedChunks_.push_back(std::move(it->second));
+  chunks_.erase(it);
+  activateCleanupTimer();
+}
+
+void ShardRebuildingV2::onCleanupTimer() {
+  finishedChunks_.clear();
+
+  // Drop ReplicationSchemes no longer used by any chunk.
+  for (auto it = replicationSchemes_.begin();
+       it != replicationSchemes_.end();) {
+    if (it->second.use_count() == 1) {
+      it = replicationSchemes_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+
+  tryMakeProgress();
+  // `this` may be destroyed here.
+}
+
+void ShardRebuildingV2::setWaitingOnGlobalWindow(bool waiting) {
+  bool was_waiting = waitingOnGlobalWindowSince_ != SteadyTimestamp::min();
+  if (waiting == was_waiting) {
+    return;
+  }
+  if (waiting) {
+    PER_SHARD_STAT_SET(
+        getStats(), rebuilding_global_window_waiting_flag, shard_, 1);
+    waitingOnGlobalWindowSince_ = SteadyTimestamp::now();
+  } else {
+    PER_SHARD_STAT_SET(
+        getStats(), rebuilding_global_window_waiting_flag, shard_, 0);
+    auto waited =
+        SteadyTimestamp(SteadyTimestamp::now() - waitingOnGlobalWindowSince_);
+    PER_SHARD_STAT_ADD(getStats(),
+                       rebuilding_global_window_waiting_total,
+                       shard_,
+                       waited.toMilliseconds().count());
+    waitingOnGlobalWindowSince_ = SteadyTimestamp::min();
+  }
+}
+
+StatsHolder* ShardRebuildingV2::getStats() {
+  return Worker::stats();
+}
+
+const Settings& ShardRebuildingV2::getSettings() const {
+  return Worker::settings();
+}
+
+std::unique_ptr<ChunkRebuilding> ShardRebuildingV2::createChunkRebuilding(
+    std::unique_ptr<RebuildingReadStorageTaskV2::ChunkData> data,
+    std::shared_ptr<ReplicationScheme> replication) {
+  return std::make_unique<ChunkRebuilding>(
+      this, shard_, std::move(data), std::move(replication));
+}
+
+std::unique_ptr<BackoffTimer>
+ShardRebuildingV2::createReadRetryTimer(std::function<void()> callback) {
+  auto timer = std::make_unique<ExponentialBackoffTimer>(
+      EventLoop::onThisThread()->getEventBase(),
+      std::move(callback),
+      std::chrono::milliseconds(5),
+      std::chrono::seconds(10));
+  timer->setTimeoutMap(&Worker::onThisThread()->commonTimeouts());
+  return std::move(timer);
+}
+
+std::unique_ptr<LibeventTimer> ShardRebuildingV2::createCleanupTimer() {
+  return std::make_unique<LibeventTimer>(
+      EventLoop::onThisThread()->getEventBase(), [this] { onCleanupTimer(); });
+}
+
+void ShardRebuildingV2::activateCleanupTimer() {
+  if (!cleanupTimer_->isActive()) {
+    cleanupTimer_->activate(std::chrono::milliseconds(0));
+  }
+}
+
+}} // namespace facebook::logdevice
@@ -0,0 +1,195 @@
+/**
+ * Copyright (c) 2017-present, Facebook, Inc. and its affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+#pragma once
+
+#include <functional>
+#include <map>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "logdevice/common/BackoffTimer.h"
+#include "logdevice/common/LibeventTimer.h"
+#include "logdevice/common/RebuildingTypes.h"
+#include "logdevice/common/WeakRefHolder.h"
+#include "logdevice/common/settings/RebuildingSettings.h"
+#include "logdevice/common/settings/Settings.h"
+#include "logdevice/common/settings/UpdateableSettings.h"
+#include "logdevice/server/rebuilding/ChunkRebuilding.h"
+#include "logdevice/server/rebuilding/RebuildingReadStorageTaskV2.h"
+
+namespace facebook { namespace logdevice {
+
+class LocalLogStore;
+class UpdateableConfig;
+
+/**
+ * Implementation of ShardRebuildingInterface that reads all logs of the shard
+ * together, partition by partition, instead of running a LogRebuilding per
+ * log. This way each partition is read once and sequentially, rather than
+ * being seeked into by every log that has records in it.
+ *
+ * Reading is done by RebuildingReadStorageTaskV2, one at a time, through an
+ * AllLogsIterator. The records it returns are grouped into chunks, each
+ * re-replicated by a ChunkRebuilding. Reading pauses while the records of
+ * in-flight chunks take more than `total_log_rebuilding_size_per_shard_mb`,
+ * or while the next partition starts after the global window.
+ *
+ * With a non-partitioned store the iterator doesn't report timestamps, so the
+ * global window isn't enforced.
+ *
+ * Lives on the worker on which it's constructed. All methods, including
+ * destructor, must be called from the same worker thread.
+ */
+
+class ShardRebuildingV2 : public ShardRebuildingInterface {
+ public:
+  // Global window is initially set to RecordTimestamp::min(), so
+  // the ShardRebuildingV2 won't make progress until advanceGlobalWindow() is
+  // called. Call it either before or after start().
+  ShardRebuildingV2(shard_index_t shard,
+                    lsn_t rebuilding_version,
+                    lsn_t restart_version,
+                    std::shared_ptr<const RebuildingSet> rebuilding_set,
+                    LocalLogStore* store,
+                    UpdateableSettings<RebuildingSettings> rebuilding_settings,
+                    std::shared_ptr<UpdateableConfig> config,
+                    ShardRebuildingInterface::Listener* listener);
+  ~ShardRebuildingV2() override;
+
+  void start(std::unordered_map<logid_t, std::unique_ptr<RebuildingPlan>> plan)
+      override;
+
+  void advanceGlobalWindow(RecordTimestamp new_window_end) override;
+
+  /**
+   * Stop rebuilding logs that were removed from config.
+   */
+  void noteConfigurationChanged() override;
+
+  void getDebugInfo(InfoShardsRebuildingTable& table) const override;
+
+  // Called by RebuildingReadStorageTaskV2.
+  void onReadTaskDone(RebuildingReadStorageTaskV2& task);
+  void onReadTaskDropped(RebuildingReadStorageTaskV2& task);
+
+  /**
+   * Called by a ChunkRebuilding when all its records are durably stored and
+   * amended. The chunk is destroyed asynchronously.
+   */
+  virtual void onChunkRebuildingDone(ChunkRebuilding* chunk);
+
+  const RebuildingSet& getRebuildingSet() const {
+    return *rebuildingSet_;
+  }
+  lsn_t getRebuildingVersion() const {
+    return rebuildingVersion_;
+  }
+  lsn_t getRestartVersion() const {
+    return restartVersion_;
+  }
+  UpdateableSettings<RebuildingSettings> getRebuildingSettings() const {
+    return rebuildingSettings_;
+  }
+
+ protected:
+  // The following may be overridden by tests.
+
+  virtual StatsHolder* getStats();
+
+  virtual void putStorageTask(std::unique_ptr<RebuildingReadStorageTaskV2> t);
+
+  virtual const Settings& getSettings() const;
+
+  virtual std::unique_ptr<ChunkRebuilding> createChunkRebuilding(
+      std::unique_ptr<RebuildingReadStorageTaskV2::ChunkData> data,
+      std::shared_ptr<ReplicationScheme> replication);
+
+  virtual std::unique_ptr<BackoffTimer>
+  createReadRetryTimer(std::function<void()> callback);
+
+  virtual std::unique_ptr<LibeventTimer> createCleanupTimer();
+
+  /**
+   * Activates cleanupTimer_ with zero timeout, unless already active.
+   */
+  virtual void activateCleanupTimer();
+
+  // Destroys chunks that finished, drops unused ReplicationSchemes and
+  // continues reading.
+  void onCleanupTimer();
+
+ private:
+  // Sends a read task if there isn't one in flight and nothing prevents
+  // reading further; reports progress and completion.
+  void tryMakeProgress();
+
+  void sendReadTask();
+
+  // Creates and starts a ChunkRebuilding for each chunk read.
+  void startChunks(std::vector<std::unique_ptr<
+                       RebuildingReadStorageTaskV2::ChunkData>> chunks);
+
+  // Returns the ReplicationScheme for the epoch of the given LSN, shared by
+  // all chunks of that epoch interval. nullptr if the epoch isn't in the plan.
+  std::shared_ptr<ReplicationScheme> getReplicationScheme(logid_t log,
+                                                          lsn_t lsn);
+
+  void setWaitingOnGlobalWindow(bool waiting);
+
+  lsn_t rebuildingVersion_;
+  lsn_t restartVersion_;
+  shard_index_t shard_;
+  std::shared_ptr<const RebuildingSet> rebuildingSet_;
+  LocalLogStore* store_;
+  UpdateableSettings<RebuildingSettings> rebuildingSettings_;
+  std::shared_ptr<UpdateableConfig> config_;
+  Listener* listener_;
+
+  // Reading state shared with the read storage tasks. Also owns the
+  // RebuildingPlan of each log. Only accessed while no read task is in
+  // flight, except for the plans, which are immutable.
+  std::shared_ptr<RebuildingReadStorageTaskV2::Context> readContext_;
+  bool readTaskInFlight_ = false;
+  // Copies of readContext_->reachedEnd and readContext_->nextTimestamp, safe
+  // to use while a read task is in flight.
+  bool reachedEnd_ = false;
+  RecordTimestamp nextTimestamp_{RecordTimestamp::min()};
+  // Retries reading after a read task was dropped or failed.
+  std::unique_ptr<BackoffTimer> readRetryTimer_;
+
+  RecordTimestamp globalWindowEnd_{RecordTimestamp::min()};
+  // Next timestamp we reported to listener_ through
+  // notifyShardDonorProgress().
+  RecordTimestamp lastReportedTimestamp_{RecordTimestamp::min()};
+  SteadyTimestamp waitingOnGlobalWindowSince_ = SteadyTimestamp::min();
+
+  // Chunks being re-replicated, by block id.
+  std::unordered_map<size_t, std::unique_ptr<ChunkRebuilding>> chunks_;
+  // Chunks that finished and are waiting for cleanupTimer_ to destroy them.
+  std::vector<std::unique_ptr<ChunkRebuilding>> finishedChunks_;
+  std::unique_ptr<LibeventTimer> cleanupTimer_;
+  // Sum of ChunkRebuilding::getMemoryUsage() of chunks_.
+  size_t bytesInFlight_ = 0;
+
+  // ReplicationSchemes of the epoch intervals of the chunks in flight, by
+  // log and first epoch of the interval.
+  std::map<std::pair<logid_t, epoch_t::raw_type>,
+           std::shared_ptr<ReplicationScheme>>
+      replicationSchemes_;
+
+  // Logs removed from config. Their records are skipped.
+  std::unordered_set<logid_t, logid_t::Hash> removedLogs_;
+
+  // true if onShardRebuildingComplete() was called.
+  bool completed_ = false;
+
+  // Used by storage tasks to tell whether `this` is still alive.
+  WeakRefHolder<ShardRebuildingV2> refHolder_;
+};
+
+}} // namespace facebook::logdevice
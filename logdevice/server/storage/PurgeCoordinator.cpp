@@ -16,6 +16,7 @@
 #include "logdevice/common/debug.h"
 #include "logdevice/common/protocol/CLEANED_Message.h"
 #include "logdevice/common/protocol/CLEAN_Message.h"
+#include "logdevice/common/protocol/RELEASE_BATCH_Message.h"
 #include "logdevice/common/protocol/RELEASE_Message.h"
 #include "logdevice/common/stats/Stats.h"
 #include "logdevice/server/CleanedResponseRequest.h"
@@ -210,7 +211,7 @@ Message::Disposition PurgeCoordinator::onReceived(CLEAN_Message* msg,
     return Message::Disposition::NORMAL;
   }
 
-  checked_downcast<PurgeCoordinator&>(*log_state->purge_coordinator_)
+  checked_downcast<PurgeCoordinator&>(*log_state->getPurgeCoordinator())
       .onCleanMessage(std::unique_ptr<CLEAN_Message>(msg),
                       w->sender().getNodeID(from),
                       from,
@@ -222,9 +223,29 @@ Message::Disposition PurgeCoordinator::onReceived(CLEAN_Message* msg,
 
 Message::Disposition PurgeCoordinator::onReceived(RELEASE_Message* msg,
                                                   const Address& from) {
+  return onRelease(msg->getHeader(), from);
+}
+
+Message::Disposition
+PurgeCoordinator::onReceived(RELEASE_BATCH_Message* msg, const Address& from) {
   ServerWorker* w = ServerWorker::onThisThread();
+  WORKER_STAT_INCR(release_batches_received);
+  WORKER_STAT_ADD(release_batch_releases_received, msg->headers_.size());
+
+  // Posts the ReleaseRequests when going out of scope.
+  ReleaseRequestBatch batch(w->processor_);
+  for (const RELEASE_Header& header : msg->headers_) {
+    Message::Disposition disp = onRelease(header, from);
+    if (disp == Message::Disposition::ERROR) {
+      return disp;
+    }
+  }
+  return Message::Disposition::NORMAL;
+}
 
-  const RELEASE_Header& header = msg->getHeader();
+Message::Disposition PurgeCoordinator::onRelease(const RELEASE_Header& header,
+                                                 const Address& from) {
+  ServerWorker* w = ServerWorker::onThisThread();
 
   const shard_size_t n_shards = w->getServerConfig()->getNumShards();
   shard_index_t shard = header.shard;
@@ -360,7 +381,7 @@ Message::Disposition PurgeCoordinator::onReceived(RELEASE_Message* msg,
             do_broadcast ? log_state : nullptr, header.rid));
   }
 
-  checked_downcast<PurgeCoordinator&>(*log_state->purge_coordinator_)
+  checked_downcast<PurgeCoordinator&>(*log_state->getPurgeCoordinator())
       .onReleaseMessage(header.rid.lsn(),
                         w->sender().getNodeID(from),
                         header.release_type,
@@ -532,6 +553,11 @@ void PurgeCoordinator::updateLastCleanInMemory(epoch_t epoch) {
   parent_->updateLastCleanEpoch(epoch);
 }
 
+size_t PurgeCoordinator::getMemoryUsage() {
+  std::lock_guard<std::mutex> guard(mutex_);
+  return sizeof(*this) + buffered_clean_.capacity() * sizeof(BufferedClean);
+}
+
 void PurgeCoordinator::updateSealInMemory(Seal seal) {
   // clean epoch is considered as NORMAL seal
   parent_->updateSeal(seal, LogStorageState::SealType::NORMAL);
@@ -29,7 +29,9 @@ namespace facebook { namespace logdevice {
 class CLEAN_Message;
 class LogStorageState;
 class PurgeUncleanEpochs;
+class RELEASE_BATCH_Message;
 class RELEASE_Message;
+struct RELEASE_Header;
 enum class ReleaseType : uint8_t;
 
 /**
@@ -63,6 +65,11 @@ class PurgeCoordinator : public LogStorageState_PurgeCoordinator_Bridge {
                                          const Address& from);
   static Message::Disposition onReceived(RELEASE_Message* msg,
                                          const Address& from);
+  // Handles each release of the batch as if it came in a RELEASE message,
+  // then notifies each worker of all the releases it is interested in with
+  // a single ReleaseRequest.
+  static Message::Disposition onReceived(RELEASE_BATCH_Message* msg,
+                                         const Address& from);
 
   //
   // NOTE: all public methods expect the mutex *not* to be held
@@ -115,6 +122,8 @@ class PurgeCoordinator : public LogStorageState_PurgeCoordinator_Bridge {
    */
   void updateLastCleanInMemory(epoch_t epoch) override;
 
+  size_t getMemoryUsage() override;
+
   /**
    * called by the state machine when the seal record is updated.
    */
@@ -148,6 +157,11 @@ class PurgeCoordinator : public LogStorageState_PurgeCoordinator_Bridge {
   ~PurgeCoordinator() override;
 
  private:
+  // Validates a release received in a RELEASE or RELEASE_BATCH message and
+  // hands it over to the log's PurgeCoordinator.
+  static Message::Disposition onRelease(const RELEASE_Header& header,
+                                        const Address& from);
+
   // LSN that we got a RELEASE for and NodeID of the sequencer we got it from.
   struct BufferedRelease {
     lsn_t lsn;
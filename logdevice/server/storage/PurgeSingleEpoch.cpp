@@ -7,6 +7,7 @@
  */
 #include "PurgeSingleEpoch.h"
 
+#include <algorithm>
 #include <functional>
 
 #include <folly/Memory.h>
@@ -233,8 +234,15 @@ void PurgeSingleEpoch::purgeRecords() {
                                      : "n/a");
 
   // delete every record in [start, end] in this epoch
-  startStorageTask(std::make_unique<PurgeDeleteRecordsStorageTask>(
-      log_id_, epoch_, start_esn, end_esn, ref_holder_.ref()));
+  if (PurgeDeleteRecordsStorageTask::deleteByKeys(start_esn, end_esn)) {
+    STAT_INCR(getStats(), purging_delete_started);
+    STAT_INCR(getStats(), purging_v2_delete_by_keys);
+    startStorageTask(std::make_unique<PurgeDeleteRecordsByKeysStorageTask>(
+        log_id_, epoch_, start_esn, end_esn, ref_holder_.ref()));
+  } else {
+    startStorageTask(std::make_unique<PurgeDeleteRecordsStorageTask>(
+        log_id_, epoch_, start_esn, end_esn, ref_holder_.ref()));
+  }
 }
 
 void PurgeSingleEpoch::onPurgeRecordsTaskDone(Status status) {
@@ -427,21 +435,13 @@ void PurgeDeleteRecordsStorageTask::executeImpl(LocalLogStore& store,
 
   std::vector<DeleteWriteOp> deletes;
   std::vector<const WriteOp*> ops;
-  if (end_esn_.val_ - start_esn_.val_ <= PURGE_DELETE_BY_KEY_THRESHOLD - 1) {
+  if (deleteByKeys(start_esn_, end_esn_)) {
     // there are not so many records to delete, delete all possible keys to
     // avoid reading from the data key space, which may incur expensive
     // I/O operations (e.g., disk seeks).
     STAT_INCR(stats, purging_v2_delete_by_keys);
 
-    // shouldn't overflow here
-    const size_t num_keys = end_esn_.val_ - start_esn_.val_ + 1;
-    deletes.reserve(num_keys);
-
-    for (size_t i = 0; i < num_keys; ++i) {
-      esn_t::raw_type esn = start_esn_.val_ + static_cast<esn_t::raw_type>(i);
-
-      deletes.emplace_back(log_id_, compose_lsn(epoch_, esn_t(esn)));
-    }
+    deletes = makeDeletesByKeys(log_id_, epoch_, start_esn_, end_esn_);
 
     if (MetaDataLog::isMetaDataLog(log_id_)) {
       ld_info("Maybe deleting metadata log records; log: %lu epoch: %u "
@@ -453,8 +453,6 @@ void PurgeDeleteRecordsStorageTask::executeImpl(LocalLogStore& store,
     }
     PurgingTracer::traceRecordPurge(
         logger, log_id_, epoch_, ESN_INVALID, start_esn_, end_esn_, true);
-
-    ld_check(deletes.size() == num_keys);
   } else {
     // the range contains too many keys, read the data space to collect records
     // that were actually stored in this range
@@ -526,6 +524,31 @@ void PurgeDeleteRecordsStorageTask::executeImpl(LocalLogStore& store,
   STAT_INCR(stats, purging_delete_done);
 }
 
+bool PurgeDeleteRecordsStorageTask::deleteByKeys(esn_t start_esn,
+                                                 esn_t end_esn) {
+  ld_check(start_esn <= end_esn);
+  return end_esn.val_ - start_esn.val_ <= PURGE_DELETE_BY_KEY_THRESHOLD - 1;
+}
+
+std::vector<DeleteWriteOp>
+PurgeDeleteRecordsStorageTask::makeDeletesByKeys(logid_t log_id,
+                                                 epoch_t epoch,
+                                                 esn_t start,
+                                                 esn_t end) {
+  ld_check(deleteByKeys(start, end));
+  // shouldn't overflow here
+  const size_t num_keys = end.val_ - start.val_ + 1;
+  std::vector<DeleteWriteOp> deletes;
+  deletes.reserve(num_keys);
+
+  for (size_t i = 0; i < num_keys; ++i) {
+    esn_t::raw_type esn = start.val_ + static_cast<esn_t::raw_type>(i);
+
+    deletes.emplace_back(log_id, compose_lsn(epoch, esn_t(esn)));
+  }
+  return deletes;
+}
+
 void PurgeDeleteRecordsStorageTask::onDone() {
   PurgeSingleEpoch* driver = driver_.get();
   if (driver != nullptr) {
@@ -542,6 +565,77 @@ void PurgeDeleteRecordsStorageTask::onDropped() {
   onDone();
 }
 
+///////// PurgeDeleteRecordsByKeysStorageTask
+
+PurgeDeleteRecordsByKeysStorageTask::PurgeDeleteRecordsByKeysStorageTask(
+    logid_t log_id,
+    epoch_t epoch,
+    esn_t start_esn,
+    esn_t end_esn,
+    WeakRef<PurgeSingleEpoch> driver)
+    : WriteStorageTask(StorageTask::Type::PURGE_DELETE_RECORDS_BY_KEYS),
+      log_id_(log_id),
+      epoch_(epoch),
+      start_esn_(start_esn),
+      end_esn_(end_esn),
+      deletes_(PurgeDeleteRecordsStorageTask::makeDeletesByKeys(log_id,
+                                                                epoch,
+                                                                start_esn,
+                                                                end_esn)),
+      driver_(std::move(driver)) {}
+
+size_t
+PurgeDeleteRecordsByKeysStorageTask::getWriteOps(const WriteOp** write_ops,
+                                                 size_t write_ops_len) const {
+  const size_t n = std::min(write_ops_len, deletes_.size());
+  for (size_t i = 0; i < n; ++i) {
+    write_ops[i] = &deletes_[i];
+  }
+  return n;
+}
+
+void PurgeDeleteRecordsByKeysStorageTask::onDone() {
+  PurgeSingleEpoch* driver = driver_.get();
+  if (driver == nullptr) {
+    return;
+  }
+
+  if (status_ == E::OK) {
+    STAT_INCR(driver->getStats(), purging_delete_done);
+    if (MetaDataLog::isMetaDataLog(log_id_)) {
+      ld_info("Maybe deleted metadata log records; log: %lu epoch: %u "
+              "start esn: %u end esn: %u",
+              log_id_.val_,
+              epoch_.val_,
+              start_esn_.val_,
+              end_esn_.val_);
+    }
+    PurgingTracer::traceRecordPurge(
+        storageThreadPool_->getProcessor().getTraceLogger().get(),
+        log_id_,
+        epoch_,
+        ESN_INVALID,
+        start_esn_,
+        end_esn_,
+        true);
+  }
+
+  // Storage errors are reported as E::FAILED, like the ones of
+  // PurgeDeleteRecordsStorageTask. Statuses that mean the write wasn't
+  // attempted, e.g. because the store is disabled, are retried.
+  driver->onPurgeRecordsTaskDone(
+      status_ == E::LOCAL_LOG_STORE_WRITE ? E::FAILED : status_);
+}
+
+void PurgeDeleteRecordsByKeysStorageTask::onDropped() {
+  PurgeSingleEpoch* driver = driver_.get();
+  if (driver != nullptr) {
+    STAT_INCR(driver->getStats(), purging_task_dropped);
+  }
+  status_ = E::DROPPED;
+  onDone();
+}
+
 ///////// PurgeWriteEpochRecoveryMetadataStorageTask
 
 void PurgeWriteEpochRecoveryMetadataStorageTask::execute() {
@@ -15,7 +15,9 @@
 #include "logdevice/common/ShardAuthoritativeStatusMap.h"
 #include "logdevice/common/WeakRefHolder.h"
 #include "logdevice/common/WorkerCallbackHelper.h"
+#include "logdevice/server/locallogstore/WriteOps.h"
 #include "logdevice/server/storage/SealStorageTask.h"
+#include "logdevice/server/storage_tasks/WriteStorageTask.h"
 
 namespace facebook { namespace logdevice {
 
@@ -158,6 +160,18 @@ class PurgeDeleteRecordsStorageTask : public StorageTask {
     return Durability::ASYNC_WRITE;
   }
 
+  // if the ESN range contains less or equal number of records than this
+  // threshold, delete key by key directly. Otherwise, create an iterator
+  // to read actual records for deletion
+  static const size_t PURGE_DELETE_BY_KEY_THRESHOLD = 4096;
+
+  // true if [start_esn, end_esn] is small enough to be deleted key by key
+  static bool deleteByKeys(esn_t start_esn, esn_t end_esn);
+
+  // A delete for every possible key in [start_esn, end_esn] of the epoch.
+  static std::vector<DeleteWriteOp>
+  makeDeletesByKeys(logid_t log_id, epoch_t epoch, esn_t start, esn_t end);
+
  private:
   const logid_t log_id_;
   const epoch_t epoch_;
@@ -165,11 +179,48 @@ class PurgeDeleteRecordsStorageTask : public StorageTask {
   const esn_t end_esn_;
   WeakRef<PurgeSingleEpoch> driver_;
   Status status_;
+};
 
-  // if the ESN range contains less or equal number of records than this
-  // threshold, delete key by key directly. Otherwise, create an iterator
-  // to read actual records for deletion
-  static const size_t PURGE_DELETE_BY_KEY_THRESHOLD = 4096;
+/**
+ * Deletes a range of ESNs small enough to be deleted key by key (see
+ * PurgeDeleteRecordsStorageTask::deleteByKeys()), without reading the data.
+ * As a WriteStorageTask, it goes through write batching: storage threads apply
+ * the deletes of many epochs and logs purged concurrently, e.g. after a mass
+ * recovery, in a single LocalLogStore::writeMulti() call.
+ */
+class PurgeDeleteRecordsByKeysStorageTask : public WriteStorageTask {
+ public:
+  PurgeDeleteRecordsByKeysStorageTask(logid_t log_id,
+                                      epoch_t epoch,
+                                      esn_t start_esn,
+                                      esn_t end_esn,
+                                      WeakRef<PurgeSingleEpoch> driver);
+
+  void onDone() override;
+  void onDropped() override;
+  ThreadType getThreadType() const override {
+    return ThreadType::METADATA;
+  }
+
+  size_t getNumWriteOps() const override {
+    return deletes_.size();
+  }
+
+  size_t getWriteOps(const WriteOp** write_ops,
+                     size_t write_ops_len) const override;
+
+  bool allowIfStoreIsNotAcceptingWrites(Status status) const override {
+    // Deleting records frees up space.
+    return status == E::NOSPC;
+  }
+
+ private:
+  const logid_t log_id_;
+  const epoch_t epoch_;
+  const esn_t start_esn_;
+  const esn_t end_esn_;
+  const std::vector<DeleteWriteOp> deletes_;
+  WeakRef<PurgeSingleEpoch> driver_;
 };
 
 class PurgeWriteEpochRecoveryMetadataStorageTask : public StorageTask {
@@ -29,8 +29,10 @@
 #include "logdevice/common/types_internal.h"
 #include "logdevice/include/Err.h"
 #include "logdevice/include/Record.h"
+#include "logdevice/server/locallogstore/WriteOps.h"
 #include "logdevice/server/storage/SealStorageTask.h"
 #include "logdevice/server/storage_tasks/StorageTask.h"
+#include "logdevice/server/storage_tasks/WriteStorageTask.h"
 
 namespace facebook { namespace logdevice {
 
@@ -352,33 +354,50 @@ class PurgeReadLastCleanTask : public StorageTask {
   epoch_t result_;
 };
 
-class PurgeWriteLastCleanTask : public StorageTask {
+/**
+ * Writes the new last clean epoch of a log once purging is done.  This is a
+ * WriteStorageTask so that the last clean epochs of logs purged concurrently
+ * are written and synced together by WriteBatchStorageTask.
+ */
+class PurgeWriteLastCleanTask : public WriteStorageTask {
  public:
   PurgeWriteLastCleanTask(logid_t log_id,
                           epoch_t epoch,
                           WeakRef<PurgeUncleanEpochs> driver)
-      : StorageTask(StorageTask::Type::PURGE_WRITE_LAST_CLEAN),
-        log_id_(log_id),
-        epoch_(epoch),
+      : WriteStorageTask(StorageTask::Type::PURGE_WRITE_LAST_CLEAN),
+        metadata_(epoch),
+        write_op_(log_id, &metadata_, Durability::SYNC_WRITE),
         driver_(std::move(driver)) {}
 
-  void execute() override;
-  // @param log_state may be nullptr in tests
-  void executeImpl(LocalLogStore& store, LogStorageState* log_state);
-  Durability durability() const override {
-    return Durability::SYNC_WRITE;
-  }
   void onDone() override;
   void onDropped() override;
   ThreadType getThreadType() const override {
     return ThreadType::METADATA;
   }
 
+  size_t getNumWriteOps() const override {
+    return 1;
+  }
+
+  size_t getWriteOps(const WriteOp** write_ops,
+                     size_t write_ops_len) const override {
+    if (write_ops_len > 0) {
+      write_ops[0] = &write_op_;
+      return 1;
+    } else {
+      return 0;
+    }
+  }
+
+  bool allowIfStoreIsNotAcceptingWrites(Status status) const override {
+    // Metadata only, and lets purging go on and free up space.
+    return status == E::NOSPC;
+  }
+
  private:
-  const logid_t log_id_;
-  epoch_t epoch_;
+  LastCleanMetadata metadata_;
+  const PutLogMetadataWriteOp write_op_;
   WeakRef<PurgeUncleanEpochs> driver_;
-  Status status_;
 };
 
 // Wrapper instead of typedef to allow forward-declaring in Worker.h
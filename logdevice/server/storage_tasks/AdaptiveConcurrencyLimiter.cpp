@@ -0,0 +1,104 @@
+/**
+ * Copyright (c) 2017-present, Facebook, Inc. and its affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+#include "AdaptiveConcurrencyLimiter.h"
+
+#include <algorithm>
+
+#include "logdevice/common/checks.h"
+
+namespace facebook { namespace logdevice {
+
+constexpr size_t AdaptiveConcurrencyLimiter::WINDOW_SAMPLES;
+constexpr double AdaptiveConcurrencyLimiter::LONG_WINDOW;
+constexpr double AdaptiveConcurrencyLimiter::TOLERANCE;
+constexpr double AdaptiveConcurrencyLimiter::QUEUE_SIZE;
+constexpr double AdaptiveConcurrencyLimiter::SMOOTHING;
+
+AdaptiveConcurrencyLimiter::AdaptiveConcurrencyLimiter(size_t min_limit,
+                                                       size_t max_limit)
+    : min_limit_(std::max<size_t>(1, std::min(min_limit, max_limit))),
+      max_limit_(std::max<size_t>(1, max_limit)),
+      // Start low and let the limit grow, rather than thrash the device
+      // until the first windows complete.
+      limit_(min_limit_),
+      estimated_limit_(min_limit_) {}
+
+void AdaptiveConcurrencyLimiter::acquire() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  cv_.wait(lock, [this] { return disabled_ || in_flight_ < limit_; });
+  ++in_flight_;
+  window_max_in_flight_ = std::max(window_max_in_flight_, in_flight_);
+}
+
+size_t AdaptiveConcurrencyLimiter::release(std::chrono::microseconds latency) {
+  size_t limit;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ld_check(in_flight_ > 0);
+    --in_flight_;
+    window_latency_sum_ += std::max<int64_t>(1, latency.count());
+    if (++window_samples_ >= WINDOW_SAMPLES) {
+      updateLimit(window_latency_sum_ / window_samples_);
+      window_samples_ = 0;
+      window_latency_sum_ = 0;
+      window_max_in_flight_ = in_flight_;
+    }
+    limit = limit_;
+  }
+  // The limit may have grown by more than one.
+  cv_.notify_all();
+  return limit;
+}
+
+void AdaptiveConcurrencyLimiter::updateLimit(double short_term_latency) {
+  if (long_term_latency_ == 0) {
+    long_term_latency_ = short_term_latency;
+  } else {
+    long_term_latency_ += (short_term_latency - long_term_latency_) /
+        LONG_WINDOW;
+  }
+  // The baseline lags behind if the device got faster (e.g. the working set
+  // moved to the page cache), so that the gradient is stuck at 1.  Let it
+  // catch up quickly.
+  if (long_term_latency_ > 2 * short_term_latency) {
+    long_term_latency_ *= 0.95;
+  }
+
+  const double gradient = std::max(
+      0.5,
+      std::min(1.0, TOLERANCE * long_term_latency_ / short_term_latency));
+  double new_limit = estimated_limit_ * gradient + QUEUE_SIZE;
+  if (new_limit > estimated_limit_ && window_max_in_flight_ * 2 < limit_) {
+    // Not using the tokens we have.
+    new_limit = estimated_limit_;
+  }
+  new_limit = estimated_limit_ * (1 - SMOOTHING) + new_limit * SMOOTHING;
+  estimated_limit_ = std::max<double>(
+      min_limit_, std::min<double>(max_limit_, new_limit));
+  limit_ = static_cast<size_t>(estimated_limit_);
+}
+
+void AdaptiveConcurrencyLimiter::disable() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    disabled_ = true;
+  }
+  cv_.notify_all();
+}
+
+size_t AdaptiveConcurrencyLimiter::getLimit() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return limit_;
+}
+
+size_t AdaptiveConcurrencyLimiter::getInFlight() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return in_flight_;
+}
+
+}} // namespace facebook::logdevice
@@ -0,0 +1,104 @@
+/**
+ * Copyright (c) 2017-present, Facebook, Inc. and its affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+
+namespace facebook { namespace logdevice {
+
+/**
+ * @file Limits the number of storage tasks a group of storage threads
+ *       executes concurrently, adjusting the limit to the latency of the
+ *       tasks in the style of the gradient2 algorithm (a TCP Vegas-like
+ *       latency based congestion control).
+ *
+ *       Task execution times are averaged over windows of WINDOW_SAMPLES
+ *       tasks (the short-term latency), and the short-term latencies are
+ *       smoothed over about LONG_WINDOW windows (the long-term latency, the
+ *       baseline of an uncongested device).  At the end of each window
+ *
+ *         gradient = clamp(TOLERANCE * long_term / short_term, 0.5, 1)
+ *         limit = limit * gradient + QUEUE_SIZE
+ *
+ *       smoothed and clamped to [min_limit, max_limit].  While latency stays
+ *       within TOLERANCE of the baseline the limit keeps growing; when
+ *       latency inflates, because the device is saturated or threads contend
+ *       for it, the limit shrinks until limit * (1 - gradient) = QUEUE_SIZE.
+ *       If the higher latency persists, it becomes the new baseline.  The
+ *       limit doesn't grow in windows in which fewer than half of the
+ *       tokens were used: latency says nothing about more concurrency then.
+ *
+ *       Threads call acquire() before picking up a task and release() with
+ *       the task's execution time after running it, so a group of threads
+ *       larger than the limit behaves like a group of `limit' threads.
+ *
+ *       Thread-safe.
+ */
+
+class AdaptiveConcurrencyLimiter {
+ public:
+  static constexpr size_t WINDOW_SAMPLES = 32;
+  static constexpr double LONG_WINDOW = 20;
+  static constexpr double TOLERANCE = 1.5;
+  static constexpr double QUEUE_SIZE = 2;
+  // Weight of the new limit computed at the end of a window.
+  static constexpr double SMOOTHING = 0.2;
+
+  AdaptiveConcurrencyLimiter(size_t min_limit, size_t max_limit);
+
+  /**
+   * Blocks until fewer than getLimit() tokens are held, then takes one.
+   */
+  void acquire();
+
+  /**
+   * Returns a token taken by acquire().
+   *
+   * @param latency  how long the task executed with the token took
+   * @return         the limit after taking the sample into account
+   */
+  size_t release(std::chrono::microseconds latency);
+
+  /**
+   * Lifts the limit for good, waking up all threads blocked in acquire().
+   * Used on shutdown so that every thread gets to its stop task promptly.
+   */
+  void disable();
+
+  size_t getLimit() const;
+  size_t getInFlight() const;
+
+ private:
+  // Called with mutex_ held at the end of each window.
+  void updateLimit(double short_term_latency);
+
+  const size_t min_limit_;
+  const size_t max_limit_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable cv_;
+
+  bool disabled_{false};
+  size_t in_flight_{0};
+  // limit_ is estimated_limit_ rounded down.
+  size_t limit_;
+  double estimated_limit_;
+
+  // Long-term latency in usec, 0 until the first window completes.
+  double long_term_latency_{0};
+
+  // Current window.
+  size_t window_samples_{0};
+  double window_latency_sum_{0};
+  size_t window_max_in_flight_{0};
+};
+
+}} // namespace facebook::logdevice
@@ -51,6 +51,7 @@ void ExecStorageThread::run() {
           task->reply_shard_idx_,
           queueing_usec);
     }
+    pool_->recordPrincipalQueueTime(*task, queueing_usec);
 
     auto execution_start_time = std::chrono::steady_clock::now();
     task->execute();
@@ -62,6 +63,7 @@ void ExecStorageThread::run() {
         pool_->stats(), task->getType(), storage_tasks_executed);
     STORAGE_TASK_TYPE_STAT_ADD(
         pool_->stats(), task->getType(), storage_thread_usec, usec);
+    pool_->onTaskExecuted(thread_type_, usec);
 
     // Maintaining stats for execution latency.
     if (task->reply_shard_idx_ != -1) {
@@ -13,7 +13,6 @@
 #include <mutex>
 #include <vector>
 
-#include <folly/MPMCQueue.h>
 #include <folly/SharedMutex.h>
 #include <folly/small_vector.h>
 
@@ -21,12 +20,15 @@
 #include <logdevice/common/Semaphore.h>
 #include <logdevice/common/util.h>
 #include <logdevice/common/stats/Stats.h>
+#include <logdevice/server/storage_tasks/WeightedFairQueue.h>
 
 /**
  * @file  The priority queue implementation used by StorageThreadPool.
  *        Strict priority can be relaxed by providing a yield schedule
  *        that causes priorities to be periodically masked from consideration
- *        during read attempts of the queue.
+ *        during read attempts of the queue.  Within a priority, tasks of
+ *        different principals and traffic classes are scheduled fairly, see
+ *        WeightedFairQueue.
  */
 namespace facebook { namespace logdevice {
 
@@ -35,7 +37,7 @@ class PrioritizedQueue {
  public:
   PrioritizedQueue(size_t size, StatsHolder* stats) : stats_(stats) {
     for (size_t i = 0; i < NumPriorities; ++i) {
-      queues_.emplace_back(size);
+      queues_.push_back(std::make_unique<WeightedFairQueue<T>>(size));
     }
   }
 
@@ -47,7 +49,7 @@ class PrioritizedQueue {
   }
   bool writeIfNotFull(T task) {
     shared_lock<folly::SharedMutex> l(introspection_mutex_);
-    bool rv = queues_[getPriority(task)].writeIfNotFull(task);
+    bool rv = queues_[getPriority(task)]->writeIfNotFull(task);
     if (rv) {
       sem_.post();
     }
@@ -55,7 +57,7 @@ class PrioritizedQueue {
   }
   void blockingWrite(T task) {
     shared_lock<folly::SharedMutex> l(introspection_mutex_);
-    queues_[getPriority(task)].blockingWrite(task);
+    queues_[getPriority(task)]->blockingWrite(task);
     sem_.post();
   }
 
@@ -77,7 +79,7 @@ class PrioritizedQueue {
 
     // Highest to lowest, yielding if required due to the yield schedule.
     for (int pri = NumPriorities - 1; pri >= 0; --pri) {
-      if (queues_[pri].readIfNotEmpty(out)) {
+      if (queues_[pri]->readIfNotEmpty(out)) {
         return;
       }
     }
@@ -99,7 +101,7 @@ class PrioritizedQueue {
 
     for (int i = 0;; i++) {
       for (int pri = 0; pri < NumPriorities; ++pri) {
-        if (queues_[pri].readIfNotEmpty(out)) {
+        if (queues_[pri]->readIfNotEmpty(out)) {
           return;
         }
       }
@@ -128,7 +130,7 @@ class PrioritizedQueue {
 
     // using readIfNotEmpty() below instead of read() as we can't afford to
     // not ship a queue entry after decrementing the semaphore
-    if (queues_[pri].readIfNotEmpty(out)) {
+    if (queues_[pri]->readIfNotEmpty(out)) {
       return true;
     } else {
       // We have to bump the semaphore back so someone else could pop that
@@ -171,7 +173,7 @@ class PrioritizedQueue {
     shared_lock<folly::SharedMutex> l(introspection_mutex_);
     ssize_t res = 0;
     for (auto& q : queues_) {
-      res += q.size();
+      res += q->size();
     }
     return res;
   }
@@ -179,7 +181,7 @@ class PrioritizedQueue {
     shared_lock<folly::SharedMutex> l(introspection_mutex_);
     ssize_t res = 0;
     for (auto& q : queues_) {
-      res += q.capacity();
+      res += q->capacity();
     }
     return res;
   }
@@ -191,15 +193,7 @@ class PrioritizedQueue {
   void introspect_contents(std::function<void(T&)> cb) {
     std::unique_lock<folly::SharedMutex> l(introspection_mutex_);
     for (int pri = NumPriorities - 1; pri >= 0; --pri) {
-      std::vector<T> queue_contents;
-      T out;
-      while (queues_[pri].read(out)) {
-        cb(out);
-        queue_contents.push_back(std::move(out));
-      }
-      for (T& item : queue_contents) {
-        queues_[pri].blockingWrite(std::move(item));
-      }
+      queues_[pri]->forEach(cb);
     }
   }
 
@@ -207,7 +201,7 @@ class PrioritizedQueue {
   // Fixed integer math scale factor for testing ratio of read attempts
   // to yields for each priority class.
   static constexpr int64_t YIELD_SCALE = 1000;
-  std::vector<folly::MPMCQueue<T>> queues_;
+  std::vector<std::unique_ptr<WeightedFairQueue<T>>> queues_;
 
   Semaphore sem_;
 
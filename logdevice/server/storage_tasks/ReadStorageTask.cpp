@@ -206,6 +206,15 @@ void ReadStorageTask::getDebugInfoDetailed(StorageTaskDebugInfo& info) const {
 }
 
 int StorageThreadCallback::processRecord(const RawRecord& record) {
+  if (record.filtered_out) {
+    // Nothing to copy, the worker only needs the LSN to send a gap.
+    records_.push_back(RawRecord::filteredOut(
+        record.lsn,
+        record.filtered_out_bytes,
+        record.from_under_replicated_region));
+    return 0;
+  }
+
   // When doing local log store reads on a storage thread, we need to copy the
   // data out of the local log store into a malloc'd buffer, since records
   // will only get passed to the messaging layer at some later time (when the
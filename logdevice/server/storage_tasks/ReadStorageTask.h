@@ -94,6 +94,10 @@ class ReadStorageTask : public StorageTask {
     return is_tailer_ ? Priority::HIGH : Priority::MID;
   }
 
+  std::chrono::steady_clock::time_point getDeadline() const override {
+    return deadline_;
+  }
+
   // Used to track if the ServerReadStream for which this task is for has been
   // destroyed.
   WeakRef<ServerReadStream> stream_;
@@ -128,6 +132,10 @@ class ReadStorageTask : public StorageTask {
   // Used to determine the task's priority
   const bool is_tailer_;
 
+  // See Settings::read_storage_task_deadline.  Set by CatchupOneStream.
+  std::chrono::steady_clock::time_point deadline_{
+      std::chrono::steady_clock::time_point::max()};
+
  private:
   void getDebugInfoDetailed(StorageTaskDebugInfo&) const override;
 
@@ -146,7 +146,7 @@ void RecoverLogStateTask::onDone() {
   // last clean epoch of 0.
   if (last_clean_metadata_.hasValue()) {
     epoch_t epoch = last_clean_metadata_.value().epoch_;
-    log_state.purge_coordinator_->updateLastCleanInMemory(epoch);
+    log_state.getPurgeCoordinator()->updateLastCleanInMemory(epoch);
   }
 
   // If we failed to read some of the metadata, tell readers to not expect the
@@ -7,10 +7,12 @@
  */
 #pragma once
 
+#include <chrono>
 #include <memory>
 #include <string>
 
 #include "logdevice/common/AdminCommandTable-fwd.h"
+#include "logdevice/common/configuration/TrafficClass.h"
 #include "logdevice/common/settings/Durability.h"
 #include "logdevice/common/StorageTask-enums.h"
 #include "logdevice/common/StorageTaskDebugInfo.h"
@@ -152,6 +154,15 @@ class StorageTask {
     return true;
   }
 
+  /**
+   * Time after which the result of this task is useless, typically because
+   * the client has timed out.  Droppable tasks still queued past their
+   * deadline are dropped instead of executed.
+   */
+  virtual std::chrono::steady_clock::time_point getDeadline() const {
+    return std::chrono::steady_clock::time_point::max();
+  }
+
   /**
    * Hook called on a storage thread when the task is dropped during a queue
    * drop.  Subclasses can override to perform extra processing.
@@ -214,6 +225,15 @@ class StorageTask {
    */
   bool dropped_from_storage_thread_queue_ = false;
 
+  // Principal on whose behalf the task runs and its traffic class, if any.
+  // Tasks of the same priority are scheduled fairly across (principal,
+  // traffic class) flows, with a share proportional to fair_share_weight_;
+  // see WeightedFairQueue.  Also used for per-principal queueing time
+  // histograms.
+  std::string principal_;
+  TrafficClass traffic_class_ = TrafficClass::INVALID;
+  uint32_t fair_share_weight_ = 1;
+
   // Time this task was queued for execution.
   // Used to maintain histograms of queueing time of storage tasks.
   std::chrono::steady_clock::time_point enqueue_time_;
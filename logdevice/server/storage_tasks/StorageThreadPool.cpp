@@ -115,6 +115,11 @@ StorageThreadPool::StorageThreadPool(
         (ssize_t)StorageTask::Priority::NUM_PRIORITIES;
   }
 
+  if (settings_->storage_threads_adaptive_concurrency) {
+    slow_concurrency_limiter_ = std::make_unique<AdaptiveConcurrencyLimiter>(
+        settings_->storage_threads_min_concurrency_slow, nthreads_slow_);
+  }
+
   // Start ExecStorageThread instances
   for (int type = 0; type < (int)ThreadType::MAX; ++type) {
     for (int i = 0; i < params[type].nthreads; ++i) {
@@ -184,6 +189,10 @@ StorageThreadPool::~StorageThreadPool() {
   // (`shutting_down_' is true, `threads_' is empty).
   shutDown();
   join();
+  PER_SHARD_STAT_ADD(stats_,
+                     storage_threads_concurrency_limit_slow,
+                     shard_idx_,
+                     -reported_slow_concurrency_limit_.load());
 }
 
 void StorageThreadPool::shutDown(bool persist_record_caches) {
@@ -191,6 +200,11 @@ void StorageThreadPool::shutDown(bool persist_record_caches) {
     return;
   }
 
+  if (slow_concurrency_limiter_) {
+    // Let every thread get to its StopExecStorageTask.
+    slow_concurrency_limiter_->disable();
+  }
+
   int total_num_threads = nthreads_slow_ + nthreads_fast_stallable_ +
       nthreads_metadata_ + nthreads_fast_time_sensitive_;
   auto remaining_threads =
@@ -314,6 +328,10 @@ std::unique_ptr<StorageTask>
 StorageThreadPool::blockingGetTask(StorageTask::ThreadType type) {
   auto& task_queue = taskQueues_[getThreadType(type)];
 
+  if (type == ThreadType::SLOW && slow_concurrency_limiter_) {
+    slow_concurrency_limiter_->acquire();
+  }
+
   while (true) {
     StorageTask* rawptr;
     task_queue.queue.blockingRead(rawptr);
@@ -327,11 +345,39 @@ StorageThreadPool::blockingGetTask(StorageTask::ThreadType type) {
       continue;
     }
 
+    // The client is likely to have given up on tasks past their deadline, and
+    // executing them would only delay the tasks that are still on time.
+    auto deadline = task->getDeadline();
+    if (deadline != std::chrono::steady_clock::time_point::max() &&
+        task->isDroppable() && std::chrono::steady_clock::now() > deadline) {
+      STORAGE_TASK_TYPE_STAT_INCR(
+          stats_, task->getType(), storage_tasks_expired);
+      StorageTaskResponse::sendDroppedToWorker(std::move(task));
+      continue;
+    }
+
     STORAGE_TASK_STAT_INCR(stats_, type, storage_tasks_dequeued);
     return task;
   }
 }
 
+void StorageThreadPool::onTaskExecuted(StorageTask::ThreadType type,
+                                       int64_t usec) {
+  if (type != ThreadType::SLOW || !slow_concurrency_limiter_) {
+    return;
+  }
+  const int64_t limit =
+      slow_concurrency_limiter_->release(std::chrono::microseconds(usec));
+  const int64_t prev = reported_slow_concurrency_limit_.exchange(limit);
+  if (limit != prev) {
+    // The stat is a sum over threads, so it's maintained with deltas.
+    PER_SHARD_STAT_ADD(stats_,
+                       storage_threads_concurrency_limit_slow,
+                       shard_idx_,
+                       limit - prev);
+  }
+}
+
 folly::small_vector<std::unique_ptr<WriteStorageTask>, 4>
 StorageThreadPool::tryGetWriteBatch(StorageTask::ThreadType thread_type,
                                     size_t max_count,
@@ -410,6 +456,44 @@ StorageThreadPool::getThreadType(StorageTask::ThreadType type) const {
   return type;
 }
 
+constexpr size_t StorageThreadPool::MAX_PRINCIPALS_TRACKED;
+constexpr const char* StorageThreadPool::OTHER_PRINCIPALS;
+
+void StorageThreadPool::recordPrincipalQueueTime(const StorageTask& task,
+                                                 int64_t usec) {
+  if (task.principal_.empty()) {
+    return;
+  }
+  {
+    auto map = principal_queue_time_.rlock();
+    auto it = map->find(task.principal_);
+    if (it == map->end() && map->size() >= MAX_PRINCIPALS_TRACKED) {
+      it = map->find(OTHER_PRINCIPALS);
+    }
+    if (it != map->end()) {
+      it->second->add(usec);
+      return;
+    }
+  }
+  auto map = principal_queue_time_.wlock();
+  const std::string& key = map->size() < MAX_PRINCIPALS_TRACKED
+      ? task.principal_
+      : std::string(OTHER_PRINCIPALS);
+  auto& hist = (*map)[key];
+  if (!hist) {
+    hist = std::make_unique<LatencyHistogram>();
+  }
+  hist->add(usec);
+}
+
+void StorageThreadPool::forEachPrincipalQueueTime(
+    folly::FunctionRef<void(const std::string&, LatencyHistogram*)> cb) {
+  auto map = principal_queue_time_.rlock();
+  for (const auto& kv : *map) {
+    cb(kv.first, kv.second.get());
+  }
+}
+
 void StorageThreadPool::getStorageTaskDebugInfo(InfoStorageTasksTable& table) {
   size_t seq_counter = 0;
   auto cb = [&](StorageTask* task,
@@ -7,15 +7,22 @@
  */
 #pragma once
 
+#include <atomic>
 #include <memory>
+#include <string>
+#include <unordered_map>
 #include <vector>
 
+#include <folly/Function.h>
 #include <folly/small_vector.h>
+#include <folly/Synchronized.h>
 
 #include "logdevice/common/Semaphore.h"
 #include "logdevice/common/settings/Settings.h"
 #include "logdevice/common/SimpleEnumMap.h"
+#include "logdevice/common/stats/Histogram.h"
 
+#include "logdevice/server/storage_tasks/AdaptiveConcurrencyLimiter.h"
 #include "logdevice/server/storage_tasks/PrioritizedQueue.h"
 #include "logdevice/server/storage_tasks/StorageTask.h"
 
@@ -130,6 +137,14 @@ class StorageThreadPool {
    */
   std::unique_ptr<StorageTask> blockingGetTask(StorageTask::ThreadType type);
 
+  /**
+   * Called by storage threads after executing a task they got from
+   * blockingGetTask().
+   *
+   * @param usec  execution time of the task
+   */
+  void onTaskExecuted(StorageTask::ThreadType type, int64_t usec);
+
   /**
    * Tries to get a batch of WriteStorageTasks from the write queue.
    * @return nullptr if write queue was empty
@@ -171,6 +186,25 @@ class StorageThreadPool {
    */
   void getStorageTaskDebugInfo(InfoStorageTasksTable& table);
 
+  /**
+   * Adds the time `task' spent in the queue to the queueing time histogram of
+   * its principal, if it has one.  Called by storage threads.
+   */
+  void recordPrincipalQueueTime(const StorageTask& task, int64_t usec);
+
+  /**
+   * Calls cb() with the queueing time histogram of every principal that had
+   * tasks executed by this pool.  Histograms are never destroyed, pointers to
+   * them stay valid for the lifetime of the pool.
+   */
+  void forEachPrincipalQueueTime(
+      folly::FunctionRef<void(const std::string&, LatencyHistogram*)> cb);
+
+  // Queueing times of principals beyond the first MAX_PRINCIPALS_TRACKED are
+  // accounted to OTHER_PRINCIPALS, principal names are client provided.
+  static constexpr size_t MAX_PRINCIPALS_TRACKED = 1000;
+  static constexpr const char* OTHER_PRINCIPALS = "(other)";
+
  private:
   UpdateableSettings<Settings> settings_;
   // Number of storage threads of each type.
@@ -215,6 +249,19 @@ class StorageThreadPool {
   // Separate queue for each of the two types of storage threads.
   SimpleEnumMap<StorageTask::ThreadType, PerTypeTaskQueue> taskQueues_;
 
+  // If --storage-threads-adaptive-concurrency is set, limits the number of
+  // tasks slow threads execute concurrently.  A thread takes a token before
+  // getting a task from the queue and returns it after executing the task.
+  std::unique_ptr<AdaptiveConcurrencyLimiter> slow_concurrency_limiter_;
+  // Value of slow_concurrency_limiter_'s limit last accounted in the
+  // storage_threads_concurrency_limit_slow stat.
+  std::atomic<int64_t> reported_slow_concurrency_limit_{0};
+
+  // See recordPrincipalQueueTime().
+  folly::Synchronized<
+      std::unordered_map<std::string, std::unique_ptr<LatencyHistogram>>>
+      principal_queue_time_;
+
   /**
    * Called when tasksToDrop_ was observed to be more than 0, suggesting that
    * a task should be dropped.
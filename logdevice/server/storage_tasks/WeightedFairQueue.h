@@ -0,0 +1,261 @@
+/**
+ * Copyright (c) 2017-present, Facebook, Inc. and its affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <folly/MPMCQueue.h>
+#include <folly/hash/Hash.h>
+
+#include "logdevice/common/checks.h"
+#include "logdevice/common/configuration/TrafficClass.h"
+
+/**
+ * @file  Bounded queue of tasks of one priority level of PrioritizedQueue.
+ *        Tasks are grouped into flows by the principal they run on behalf of
+ *        and their traffic class.  Flows are served with weighted round
+ *        robin: each flow that has queued tasks gets as many tasks dequeued
+ *        as its weight each round, so that a single tenant with a deep
+ *        queue of tasks can't delay the tasks of other tenants by more than
+ *        a round.  Tasks within a flow are FIFO.
+ *
+ *        Tasks that don't identify a principal, such as writes and internal
+ *        tasks, are the bulk of the load and don't need fairness between
+ *        them.  They go to a lock-free folly::MPMCQueue, which is served as
+ *        one more flow of weight 1.  When no principal has tasks queued,
+ *        reads don't take the mutex at all.
+ *
+ *        Up to `capacity` tasks can be queued in total, with or without a
+ *        principal.  Writers reserve a slot with a compare-and-swap; blocked
+ *        writers wait on a condition variable that readers only signal when
+ *        a writer is waiting.
+ *
+ *        Exposes the subset of the folly::MPMCQueue interface used by
+ *        PrioritizedQueue.  T is a pointer to a StorageTask (or a subclass).
+ */
+namespace facebook { namespace logdevice {
+
+template <class T>
+class WeightedFairQueue {
+ public:
+  explicit WeightedFairQueue(size_t capacity)
+      : capacity_(capacity), untagged_(capacity) {
+    ld_check(capacity > 0);
+  }
+
+  bool writeIfNotFull(T task) {
+    if (!reserve()) {
+      return false;
+    }
+    write(std::move(task));
+    return true;
+  }
+
+  void blockingWrite(T task) {
+    if (!reserve()) {
+      std::unique_lock<std::mutex> lock(mutex_);
+      ++blocked_writers_;
+      not_full_.wait(lock, [this] { return reserve(); });
+      --blocked_writers_;
+    }
+    write(std::move(task));
+  }
+
+  bool readIfNotEmpty(T& out) {
+    if (!readImpl(out)) {
+      return false;
+    }
+    reserved_.fetch_sub(1);
+    if (blocked_writers_.load() > 0) {
+      // Taking the mutex orders this with the writer's check of reserved_.
+      std::lock_guard<std::mutex> lock(mutex_);
+      not_full_.notify_one();
+    }
+    return true;
+  }
+
+  bool read(T& out) {
+    return readIfNotEmpty(out);
+  }
+
+  ssize_t size() const {
+    return untagged_.size() + tagged_size_.load();
+  }
+
+  size_t capacity() const {
+    return capacity_;
+  }
+
+  // Calls cb() on every queued task: tasks with a principal in the order of
+  // the flows in the current round, then tasks without one.  Must not be
+  // called concurrently with other methods.
+  void forEach(std::function<void(T&)> cb) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      for (Flow* flow : active_) {
+        for (T& task : flow->tasks) {
+          cb(task);
+        }
+      }
+    }
+    std::vector<T> untagged;
+    T task;
+    while (untagged_.readIfNotEmpty(task)) {
+      cb(task);
+      untagged.push_back(std::move(task));
+    }
+    for (T& t : untagged) {
+      untagged_.blockingWrite(std::move(t));
+    }
+  }
+
+ private:
+  using FlowKey = std::pair<std::string, TrafficClass>;
+
+  struct FlowKeyHash {
+    size_t operator()(const FlowKey& key) const {
+      return folly::hash::hash_combine(
+          key.first, static_cast<uint8_t>(key.second));
+    }
+  };
+
+  struct Flow {
+    std::deque<T> tasks;
+    // Number of tasks the flow gets per round.
+    uint32_t weight = 1;
+    // Number of tasks the flow may still dequeue in the current round.
+    uint32_t credits = 0;
+  };
+
+  // Takes one of the capacity_ slots, if any is left.
+  bool reserve() {
+    size_t cur = reserved_.load();
+    do {
+      if (cur >= capacity_) {
+        return false;
+      }
+    } while (!reserved_.compare_exchange_weak(cur, cur + 1));
+    return true;
+  }
+
+  // Queues a task for which a slot was reserved.
+  void write(T task) {
+    if (task->principal_.empty()) {
+      // Can't be full, it has room for all reserved slots.
+      untagged_.blockingWrite(std::move(task));
+      return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    push(std::move(task));
+  }
+
+  bool readImpl(T& out) {
+    if (tagged_size_.load() == 0) {
+      // Fast path, only tasks without a principal may be queued.
+      return untagged_.readIfNotEmpty(out);
+    }
+    if (untagged_turn_.load() && untagged_.readIfNotEmpty(out)) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      // Next turn of untagged_ after each flow has had its turn.
+      turns_until_untagged_ = active_.size();
+      untagged_turn_.store(turns_until_untagged_ == 0);
+      return true;
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (size_ > 0) {
+        pop(out);
+        return true;
+      }
+    }
+    return untagged_.readIfNotEmpty(out);
+  }
+
+  void push(T task) {
+    auto it = flows_.find(FlowKey(task->principal_, task->traffic_class_));
+    if (it == flows_.end()) {
+      it = flows_
+               .emplace(FlowKey(task->principal_, task->traffic_class_),
+                        Flow())
+               .first;
+    }
+    Flow& flow = it->second;
+    // Weights come from the config and may change, go with the latest.
+    flow.weight = std::max(1u, task->fair_share_weight_);
+    if (flow.tasks.empty()) {
+      flow.credits = flow.weight;
+      active_.push_back(&flow);
+    }
+    flow.tasks.push_back(std::move(task));
+    tagged_size_.store(++size_);
+  }
+
+  void pop(T& out) {
+    ld_check(!active_.empty());
+    Flow* flow = active_.front();
+    ld_check(!flow->tasks.empty());
+    out = std::move(flow->tasks.front());
+    flow->tasks.pop_front();
+    tagged_size_.store(--size_);
+
+    if (flow->tasks.empty()) {
+      active_.pop_front();
+      // Don't keep state for idle flows, principals come and go.
+      flows_.erase(FlowKey(out->principal_, out->traffic_class_));
+    } else if (--flow->credits == 0) {
+      flow->credits = flow->weight;
+      active_.pop_front();
+      active_.push_back(flow);
+    } else {
+      return;
+    }
+    // End of the flow's turn.
+    if (turns_until_untagged_ > 0 && --turns_until_untagged_ == 0) {
+      untagged_turn_.store(true);
+    }
+  }
+
+  const size_t capacity_;
+  // Number of tasks queued or being queued, at most capacity_.
+  std::atomic<size_t> reserved_{0};
+
+  mutable std::mutex mutex_;
+  std::condition_variable not_full_;
+  // Number of writers waiting on not_full_, only changed with mutex_ held.
+  std::atomic<size_t> blocked_writers_{0};
+
+  // Number of tasks with a principal queued.  tagged_size_ mirrors it for
+  // readers that don't take the mutex.
+  size_t size_{0};
+  std::atomic<size_t> tagged_size_{0};
+
+  // Tasks without a principal.
+  folly::MPMCQueue<T> untagged_;
+  // Whether untagged_ is next in the round.
+  std::atomic<bool> untagged_turn_{true};
+  // Number of flow turns left before untagged_'s turn.
+  size_t turns_until_untagged_{0};
+
+  // Only contains flows with queued tasks.  References to elements of an
+  // unordered_map are stable, so active_ can point into it.
+  std::unordered_map<FlowKey, Flow, FlowKeyHash> flows_;
+
+  // Flows with queued tasks, in round robin order.  The front flow is the
+  // one whose turn it is.
+  std::deque<Flow*> active_;
+};
+
+}} // namespace facebook::logdevice
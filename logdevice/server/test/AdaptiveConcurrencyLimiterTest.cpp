@@ -0,0 +1,105 @@
+/**
+ * Copyright (c) 2017-present, Facebook, Inc. and its affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+#include "logdevice/server/storage_tasks/AdaptiveConcurrencyLimiter.h"
+
+#include <gtest/gtest.h>
+
+using namespace facebook::logdevice;
+using std::chrono::microseconds;
+
+namespace {
+
+// Keeps the limiter saturated: takes all available tokens, then completes
+// one task with the given latency, `tasks' times.
+void runSaturated(AdaptiveConcurrencyLimiter& limiter,
+                  microseconds latency,
+                  size_t tasks) {
+  for (size_t i = 0; i < tasks; ++i) {
+    while (limiter.getInFlight() < limiter.getLimit()) {
+      limiter.acquire();
+    }
+    limiter.release(latency);
+  }
+}
+
+void releaseAll(AdaptiveConcurrencyLimiter& limiter) {
+  while (limiter.getInFlight() > 0) {
+    limiter.release(microseconds(1000));
+  }
+}
+
+} // namespace
+
+TEST(AdaptiveConcurrencyLimiterTest, GrowsWhileLatencyIsStable) {
+  AdaptiveConcurrencyLimiter limiter(2, 64);
+  EXPECT_EQ(2u, limiter.getLimit());
+
+  runSaturated(limiter, microseconds(1000), 10 * 32);
+  size_t limit = limiter.getLimit();
+  EXPECT_GT(limit, 2u);
+
+  runSaturated(limiter, microseconds(1000), 1000 * 32);
+  EXPECT_GT(limiter.getLimit(), limit);
+  EXPECT_EQ(64u, limiter.getLimit());
+  releaseAll(limiter);
+}
+
+TEST(AdaptiveConcurrencyLimiterTest, ShrinksWhenLatencyInflates) {
+  AdaptiveConcurrencyLimiter limiter(2, 64);
+  runSaturated(limiter, microseconds(1000), 1000 * 32);
+  ASSERT_EQ(64u, limiter.getLimit());
+
+  runSaturated(limiter, microseconds(5000), 10 * 32);
+  size_t limit = limiter.getLimit();
+  EXPECT_LT(limit, 48u);
+  EXPECT_GE(limit, 2u);
+
+  // Once latency is back to normal the limit grows again.
+  runSaturated(limiter, microseconds(1000), 1000 * 32);
+  EXPECT_GT(limiter.getLimit(), limit);
+  releaseAll(limiter);
+}
+
+// If the threads don't use the tokens they have, task latency says nothing
+// about whether more concurrency would help.
+TEST(AdaptiveConcurrencyLimiterTest, DoesntGrowWhenNotSaturated) {
+  AdaptiveConcurrencyLimiter limiter(4, 64);
+  for (int i = 0; i < 100 * 32; ++i) {
+    limiter.acquire();
+    limiter.release(microseconds(1000));
+  }
+  EXPECT_EQ(4u, limiter.getLimit());
+}
+
+TEST(AdaptiveConcurrencyLimiterTest, Bounds) {
+  {
+    // Min is clamped to max.
+    AdaptiveConcurrencyLimiter limiter(10, 3);
+    EXPECT_EQ(3u, limiter.getLimit());
+    // Latency keeps growing, but the limit doesn't drop below min.
+    for (int i = 1; i <= 100; ++i) {
+      runSaturated(limiter, microseconds(1000 * i), 32);
+      EXPECT_EQ(3u, limiter.getLimit());
+    }
+    releaseAll(limiter);
+  }
+  {
+    AdaptiveConcurrencyLimiter limiter(0, 0);
+    EXPECT_EQ(1u, limiter.getLimit());
+  }
+}
+
+TEST(AdaptiveConcurrencyLimiterTest, Disable) {
+  AdaptiveConcurrencyLimiter limiter(1, 1);
+  limiter.acquire();
+  limiter.disable();
+  // Would block if the limiter were still enabled.
+  limiter.acquire();
+  EXPECT_EQ(2u, limiter.getInFlight());
+  releaseAll(limiter);
+}
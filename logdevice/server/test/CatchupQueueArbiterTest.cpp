@@ -0,0 +1,157 @@
+/**
+ * Copyright (c) 2017-present, Facebook, Inc. and its affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+#include <memory>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "logdevice/server/read_path/CatchupQueueArbiter.h"
+
+using namespace facebook::logdevice;
+
+namespace {
+
+const uint64_t QUANTUM = 1000;
+const uint64_t BATCH = 1000;
+
+// A client that reads a batch every time it gets to, like a CatchupQueue
+// whose output buffer always drains in time.
+struct TestClient {
+  TestClient(CatchupQueueArbiter& arbiter, uint32_t weight)
+      : arbiter(arbiter), client(weight, [this] { tryRead(); }) {}
+
+  void tryRead() {
+    if (arbiter.mayRead(client, QUANTUM)) {
+      arbiter.charge(client, BATCH);
+      bytes_read += BATCH;
+    }
+  }
+
+  CatchupQueueArbiter& arbiter;
+  CatchupQueueArbiter::Client client;
+  uint64_t bytes_read{0};
+};
+
+class CatchupQueueArbiterTest : public ::testing::Test {
+ protected:
+  TestClient* addClient(uint32_t weight) {
+    clients_.push_back(std::make_unique<TestClient>(arbiter_, weight));
+    return clients_.back().get();
+  }
+
+  // Runs `iterations` iterations of the event loop.  In each, the client of
+  // index i gets an event every periods[i] iterations (every iteration by
+  // default).
+  void run(int iterations, std::vector<int> periods = {}) {
+    for (int it = 0; it < iterations; ++it) {
+      if (resume_scheduled_) {
+        resume_scheduled_ = false;
+        arbiter_.resumeNext();
+      }
+      for (size_t i = 0; i < clients_.size(); ++i) {
+        if (i < periods.size() && it % periods[i] != 0) {
+          continue;
+        }
+        if (!clients_[i]->client.isWaiting()) {
+          clients_[i]->tryRead();
+        }
+      }
+    }
+  }
+
+  bool resume_scheduled_{false};
+  CatchupQueueArbiter arbiter_{[this] {
+    ASSERT_FALSE(resume_scheduled_);
+    resume_scheduled_ = true;
+  }};
+  std::vector<std::unique_ptr<TestClient>> clients_;
+};
+
+} // namespace
+
+// A client alone on the worker never waits, however much it reads.
+TEST_F(CatchupQueueArbiterTest, LoneClientNeverWaits) {
+  TestClient* c = addClient(1);
+  run(100);
+  EXPECT_EQ(100 * BATCH, c->bytes_read);
+  EXPECT_FALSE(resume_scheduled_);
+  EXPECT_EQ(0, arbiter_.numWaiting());
+}
+
+// Clients that compete read in proportion to their weights.
+TEST_F(CatchupQueueArbiterTest, WeightedShares) {
+  TestClient* a = addClient(1);
+  TestClient* b = addClient(3);
+  TestClient* c = addClient(1);
+  run(400);
+  EXPECT_GT(a->bytes_read, 0u);
+  EXPECT_NEAR(3.0, double(b->bytes_read) / a->bytes_read, 0.2);
+  EXPECT_NEAR(1.0, double(c->bytes_read) / a->bytes_read, 0.2);
+}
+
+// A client that rarely reads, e.g. because its output buffer drains slowly,
+// doesn't hold back the others, and isn't starved by them.
+TEST_F(CatchupQueueArbiterTest, SlowClientDoesNotHoldBackOthers) {
+  TestClient* a = addClient(1);
+  TestClient* b = addClient(3);
+  TestClient* slow = addClient(1);
+  run(400, {1, 1, 50});
+  EXPECT_NEAR(3.0, double(b->bytes_read) / a->bytes_read, 0.2);
+  EXPECT_EQ(8 * BATCH, slow->bytes_read);
+}
+
+// A client that used up its share waits until the others stop reading, then
+// gets a new round.
+TEST_F(CatchupQueueArbiterTest, WaitsForNextRound) {
+  TestClient* a = addClient(1);
+  TestClient* b = addClient(2);
+  run(1);
+  // a used up its share, b has some left.
+  a->tryRead();
+  EXPECT_TRUE(a->client.isWaiting());
+  EXPECT_TRUE(resume_scheduled_);
+  const uint64_t round = arbiter_.getRound();
+
+  // b reads the rest of its share, then waits too.
+  run(2, {1000, 1});
+  EXPECT_TRUE(a->client.isWaiting());
+  EXPECT_TRUE(b->client.isWaiting());
+  EXPECT_EQ(BATCH, a->bytes_read);
+  EXPECT_EQ(2 * BATCH, b->bytes_read);
+  EXPECT_EQ(round, arbiter_.getRound());
+
+  // Nobody read during the last iteration: new round, clients resume in the
+  // order they started waiting, one per iteration.
+  resume_scheduled_ = false;
+  arbiter_.resumeNext();
+  EXPECT_EQ(round + 1, arbiter_.getRound());
+  EXPECT_FALSE(a->client.isWaiting());
+  EXPECT_EQ(2 * BATCH, a->bytes_read);
+  EXPECT_TRUE(b->client.isWaiting());
+  EXPECT_TRUE(resume_scheduled_);
+  resume_scheduled_ = false;
+  arbiter_.resumeNext();
+  EXPECT_FALSE(b->client.isWaiting());
+  EXPECT_EQ(3 * BATCH, b->bytes_read);
+  EXPECT_EQ(0, arbiter_.numWaiting());
+  EXPECT_FALSE(resume_scheduled_);
+}
+
+// A client destroyed while waiting leaves the arbiter.
+TEST_F(CatchupQueueArbiterTest, DestroyWaitingClient) {
+  addClient(1);
+  addClient(1);
+  run(1);
+  clients_[0]->tryRead();
+  ASSERT_TRUE(clients_[0]->client.isWaiting());
+  clients_.erase(clients_.begin());
+  EXPECT_EQ(0, arbiter_.numWaiting());
+  resume_scheduled_ = false;
+  arbiter_.resumeNext();
+  EXPECT_FALSE(resume_scheduled_);
+}
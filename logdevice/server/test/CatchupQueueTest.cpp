@@ -7,16 +7,22 @@
  */
 #include <gtest/gtest.h>
 
+#include <map>
 #include <memory>
+#include <thread>
 #include <utility>
 #include <vector>
 
 #include <folly/Memory.h>
+#include <folly/String.h>
+#include <folly/json.h>
 
 #include "logdevice/common/DataRecordOwnsPayload.h"
 #include "logdevice/common/FlowGroup.h"
 #include "logdevice/common/LocalLogStoreRecordFormat.h"
 #include "logdevice/common/Sender.h"
+#include "logdevice/common/ServerRecordFilterEncoding.h"
+#include "logdevice/common/ZeroCopiedRecord.h"
 
 #include "logdevice/common/protocol/Compatibility.h"
 #include "logdevice/common/protocol/GAP_Message.h"
@@ -26,14 +32,19 @@
 #include "logdevice/common/protocol/STORE_Message.h"
 #include "logdevice/common/protocol/WINDOW_Message.h"
 
+#include "logdevice/common/settings/util.h"
+
 #include "logdevice/common/stats/Stats.h"
 
 #include "logdevice/common/test/MockBackoffTimer.h"
 #include "logdevice/common/test/MockLibeventTimer.h"
 #include "logdevice/server/ServerRecordFilterFactory.h"
+#include "logdevice/server/ServerRecordSamplerFactory.h"
+#include "logdevice/server/RealTimeRecordBuffer.h"
 
 #include "logdevice/server/read_path/AllServerReadStreams.h"
 #include "logdevice/server/read_path/CatchupQueue.h"
+#include "logdevice/server/read_path/CatchupQueueArbiter.h"
 #include "logdevice/server/read_path/LogStorageStateMap.h"
 
 #include "logdevice/server/storage_tasks/ReadStorageTask.h"
@@ -266,6 +277,22 @@ class CatchupQueueTest : public ::testing::Test {
     streams_.notifyNeedsCatchup(stream, more_data);
   }
 
+  // Blocks or unblocks processing of the client's CatchupQueue, like the
+  // `block catchup_queue` admin command.
+  void blockCatchupQueue(bool block);
+
+  // Sets the CatchupQueue's estimate of how fast the client drains records.
+  void setDrainRate(double bytes_per_sec) {
+    getClientStateMap().find(client_id_)->second.catchup_queue->drain_rate_ =
+        bytes_per_sec;
+  }
+
+  double getDrainRate() {
+    return getClientStateMap()
+        .find(client_id_)
+        ->second.catchup_queue->drain_rate_;
+  }
+
   void invokeCallback() {
     ld_check(callback_);
     can_send_ = true;
@@ -285,6 +312,14 @@ class CatchupQueueTest : public ::testing::Test {
   TestAllServerReadStreams streams_;
   const ClientID client_id_{9999};
   const logid_t log_id_{1};
+  Settings settings_{create_default_settings<Settings>()};
+  // Read weight of the client's principal, read when the CatchupQueue is
+  // created.
+  uint32_t read_weight_{1};
+  // Arbiter the CatchupQueue takes part in, read when the CatchupQueue is
+  // created.  Tests call resumeNext() themselves.
+  std::unique_ptr<CatchupQueueArbiter> arbiter_;
+  bool arbiter_resume_scheduled_{false};
   BWAvailableCallback* callback_{nullptr};
   InterceptedMessages messages_;
   bool delay_read_{false};
@@ -434,8 +469,20 @@ class MockCatchupQueueDependencies : public CatchupQueueDependencies {
     return 128 * 1024;
   }
 
+  uint32_t getClientReadWeight(ClientID) override {
+    return test_.read_weight_;
+  }
+
+  std::string getClientPrincipalName(ClientID) override {
+    return "";
+  }
+
+  CatchupQueueArbiter* getArbiter() override {
+    return test_.arbiter_.get();
+  }
+
   const Settings& getSettings() const override {
-    return *settings_.get();
+    return test_.settings_;
   }
 
  private:
@@ -445,7 +492,6 @@ class MockCatchupQueueDependencies : public CatchupQueueDependencies {
     test_.flow_group_.push(callback, priority);
   }
 
-  UpdateableSettings<Settings> settings_; // never updated
   CatchupQueueTest& test_;
   StatsHolder server_stats_;
 };
@@ -1827,6 +1873,90 @@ TEST_F(CatchupQueueTest, ServerRecordFilterFeatureTest) {
   // filter_key1 > filter_key2, an error message should be printed
   // ServerRecordFilterFactory should return a nullptr
   filterTestHelper(ServerRecordFilterType::RANGE, "b", "a", "", ")");
+
+  // Test case 10: PREFIX filter   check: starts with "eu/"
+  filterTestHelper(
+      ServerRecordFilterType::PREFIX, "eu/", "", "eu/tenant", "us/tenant");
+
+  // Test case 11: KEY_SET filter   check: in {"t1", "t7", "t42"}
+  filterTestHelper(
+      ServerRecordFilterType::KEY_SET,
+      ServerRecordFilterEncoding::encodeKeySet({"t1", "t7", "t42"}),
+      "",
+      "t7",
+      "t4");
+
+  // Test case 12: BLOOM filter built from {"t1", "t7", "t42"}. "t4" is not a
+  // false positive for this filter.
+  const std::string bloom =
+      ServerRecordFilterEncoding::buildBloomFilter({"t1", "t7", "t42"});
+  ASSERT_FALSE(ServerRecordFilterEncoding::bloomFilterMayContain(bloom, "t4"));
+  filterTestHelper(ServerRecordFilterType::BLOOM, bloom, "", "t42", "t4");
+}
+
+/**
+ * Server-side sampling keeps every 5th record and reports the others as
+ * FILTERED_OUT gaps.
+ */
+TEST_F(CatchupQueueTest, ServerRecordSamplerEveryNth) {
+  resetCatchupQueue();
+  read_stream_id_t read_stream_id(1);
+  ServerReadStream& stream = createStream(read_stream_id);
+  stream.sampler_ =
+      ServerRecordSamplerFactory::create(ServerRecordSampleMode::EVERY_NTH, 5);
+  ASSERT_NE(nullptr, stream.sampler_);
+
+  notifyNeedsCatchup(stream, read_stream_id, /* more_data */ true);
+  ASSERT_EQ(/*STARTED*/ 1, messages_.size());
+  messages_.clear();
+
+  ASSERT_EQ(1, tasks_.size());
+  auto task = std::move(tasks_.front());
+  task->status_ = E::CAUGHT_UP;
+  task->records_ = ReadStorageTask::RecordContainer();
+  for (int i = 1; i <= 20; i++) {
+    task->records_.push_back(createFakeRecord(i, 100));
+  }
+  streams_.onReadTaskDone(*task);
+
+  ASSERT_LE(8, messages_.size());
+  for (int i = 0; i < 4; i++) {
+    GAP_Message* gap_msg =
+        dynamic_cast<GAP_Message*>(messages_[2 * i].first.get());
+    ASSERT_NE(nullptr, gap_msg);
+    EXPECT_EQ(GapReason::FILTERED_OUT, gap_msg->getHeader().reason);
+    EXPECT_EQ(lsn_t(5 * i + 1), gap_msg->getHeader().start_lsn);
+    EXPECT_EQ(lsn_t(5 * i + 4), gap_msg->getHeader().end_lsn);
+    RECORD_Message* record_msg =
+        dynamic_cast<RECORD_Message*>(messages_[2 * i + 1].first.get());
+    ASSERT_NE(nullptr, record_msg);
+    EXPECT_EQ(lsn_t(5 * (i + 1)), record_msg->header_.lsn);
+  }
+  tasks_.clear();
+  messages_.clear();
+}
+
+TEST(ServerRecordSamplerTest, TimeBucket) {
+  auto sampler = ServerRecordSamplerFactory::create(
+      ServerRecordSampleMode::TIME_BUCKET, 1000);
+  ASSERT_NE(nullptr, sampler);
+  using std::chrono::milliseconds;
+  EXPECT_TRUE((*sampler)(lsn_t(1), milliseconds(10500)));
+  EXPECT_FALSE((*sampler)(lsn_t(2), milliseconds(10999)));
+  EXPECT_TRUE((*sampler)(lsn_t(3), milliseconds(11000)));
+  EXPECT_FALSE((*sampler)(lsn_t(4), milliseconds(11001)));
+  // Skipping buckets without records.
+  EXPECT_TRUE((*sampler)(lsn_t(5), milliseconds(15000)));
+
+  EXPECT_EQ(nullptr,
+            ServerRecordSamplerFactory::create(
+                ServerRecordSampleMode::TIME_BUCKET, 0));
+  EXPECT_EQ(nullptr,
+            ServerRecordSamplerFactory::create(
+                ServerRecordSampleMode::EVERY_NTH, 0));
+  EXPECT_EQ(
+      nullptr,
+      ServerRecordSamplerFactory::create(ServerRecordSampleMode::NONE, 1));
 }
 
 TEST_F(CatchupQueueTest, MergeFilteredOutGapOnServerSide1) {
@@ -2118,4 +2248,543 @@ TEST_F(CatchupQueueTest, StreamValidations) {
   }
 }
 
+namespace {
+
+// A record released to real time readers.  The test owns the payload.
+class TestZeroCopiedRecord : public ZeroCopiedRecord {
+ public:
+  TestZeroCopiedRecord(lsn_t lsn, Slice payload)
+      : ZeroCopiedRecord(lsn,
+                         0,
+                         0,
+                         esn_t(0),
+                         1,
+                         copyset_t({N1}),
+                         BYTE_OFFSET_INVALID,
+                         std::map<KeyType, std::string>(),
+                         payload,
+                         nullptr) {}
+};
+
+} // namespace
+
+namespace {
+
+// Chains records with the given payloads into a ReleasedRecords starting at
+// `first_lsn'.  The caller owns the payloads.
+std::shared_ptr<ReleasedRecords>
+makeReleasedRecords(logid_t log_id,
+                    lsn_t first_lsn,
+                    const std::vector<std::string>& payloads) {
+  std::shared_ptr<ZeroCopiedRecord> entries;
+  for (int i = payloads.size() - 1; i >= 0; --i) {
+    auto entry = std::make_shared<TestZeroCopiedRecord>(
+        first_lsn + i, Slice(payloads[i].data(), payloads[i].size()));
+    entry->next_ = std::move(entries);
+    entries = std::move(entry);
+  }
+  return std::make_shared<ReleasedRecords>(
+      log_id,
+      first_lsn,
+      first_lsn + payloads.size() - 1,
+      entries,
+      ReleasedRecords::computeBytesEstimate(entries.get()));
+}
+
+} // namespace
+
+/**
+ * Streams tailing the same log ship the records of a ReleasedRecords without
+ * each copying their payloads.  The first stream to ship makes its own
+ * copies; the payloads are copied into a shared buffer once a second stream
+ * ships them, and all later RECORD messages point into it.
+ */
+TEST_F(CatchupQueueTest, RealTimeRecordsSharePayload) {
+  const std::vector<std::string> payloads = {"first", "second", "third"};
+  auto released = makeReleasedRecords(log_id_, lsn_t(1), payloads);
+
+  const int nstreams = 3;
+  for (int i = 1; i <= nstreams; ++i) {
+    ServerReadStream& stream = createStream(read_stream_id_t(i));
+    stream.addReleasedRecords(released);
+    notifyNeedsCatchup(stream, read_stream_id_t(i));
+  }
+
+  // lsn -> payload pointer of the second stream that shipped it
+  std::map<lsn_t, const void*> shared;
+  size_t nrecords = 0;
+  for (const auto& m : messages_) {
+    auto* msg = dynamic_cast<RECORD_Message*>(m.first.get());
+    if (!msg) {
+      continue;
+    }
+    ++nrecords;
+    const RECORD_Header& header = getHeader(*msg);
+    const Payload& payload = getPayload(*msg);
+    ASSERT_EQ(payloads[header.lsn - 1], payload.toString());
+    EXPECT_NE(static_cast<const void*>(payloads[header.lsn - 1].data()),
+              payload.data());
+    if (header.read_stream_id == read_stream_id_t(1)) {
+      continue;
+    }
+    auto it = shared.emplace(header.lsn, payload.data()).first;
+    EXPECT_EQ(it->second, payload.data());
+  }
+  EXPECT_EQ(nstreams * payloads.size(), nrecords);
+  EXPECT_EQ(payloads.size(), shared.size());
+  EXPECT_EQ((nstreams - 1) * (5 + 6 + 5),
+            getStats(client_id_).real_time_record_payload_bytes_shared);
+
+  // The messages keep the shared payloads alive.
+  released.reset();
+  for (const auto& m : messages_) {
+    auto* msg = dynamic_cast<RECORD_Message*>(m.first.get());
+    if (msg) {
+      EXPECT_EQ(payloads[getHeader(*msg).lsn - 1], getPayload(*msg).toString());
+    }
+  }
+}
+
+/**
+ * The shared payload buffer is only built if more than one stream ships the
+ * payloads: not for a single tailer, nor for tailers that don't ship
+ * payloads.
+ */
+TEST_F(CatchupQueueTest, RealTimeRecordsSharePayloadOnlyWhenShipped) {
+  const std::vector<std::string> payloads = {"first", "second", "third"};
+  auto released = makeReleasedRecords(log_id_, lsn_t(1), payloads);
+
+  ServerReadStream& no_payload = createStream(read_stream_id_t(1));
+  no_payload.no_payload_ = true;
+  no_payload.addReleasedRecords(released);
+  notifyNeedsCatchup(no_payload, read_stream_id_t(1));
+
+  ServerReadStream& tailer = createStream(read_stream_id_t(2));
+  tailer.addReleasedRecords(released);
+  notifyNeedsCatchup(tailer, read_stream_id_t(2));
+
+  size_t nrecords = 0;
+  for (const auto& m : messages_) {
+    nrecords += dynamic_cast<RECORD_Message*>(m.first.get()) != nullptr;
+  }
+  EXPECT_EQ(2 * payloads.size(), nrecords);
+  EXPECT_EQ(0, getStats(client_id_).real_time_record_payload_bytes_shared);
+}
+
+/**
+ * The shared payload buffer is charged to the real time buffer's budget until
+ * the ReleasedRecords is deleted, and not built if it doesn't fit.
+ */
+TEST(RealTimeRecordBufferTest, SharedPayloadsCharged) {
+  const std::vector<std::string> payloads = {"first", "second"};
+  const size_t payload_bytes = 11;
+  RealTimeRecordBuffer buffer(payload_bytes, payload_bytes, nullptr);
+  const char stream1 = 0, stream2 = 0;
+
+  auto released = makeReleasedRecords(logid_t(1), lsn_t(1), payloads);
+  released->buffer_ = &buffer;
+  buffer.addToLRU(logid_t(1));
+  EXPECT_FALSE(released->sharePayloads(&stream1));
+  auto shared = released->sharePayloads(&stream2);
+  ASSERT_TRUE(shared);
+  EXPECT_EQ(payload_bytes, released->getSharedPayloadsBytes());
+  EXPECT_FALSE(buffer.chargeSharedPayloads(1));
+
+  released.reset();
+  ASSERT_TRUE(buffer.chargeSharedPayloads(payload_bytes));
+
+  released = makeReleasedRecords(logid_t(1), lsn_t(3), payloads);
+  released->buffer_ = &buffer;
+  buffer.addToLRU(logid_t(1));
+  EXPECT_FALSE(released->sharePayloads(&stream1));
+  EXPECT_FALSE(released->sharePayloads(&stream2));
+  EXPECT_EQ(0, released->getSharedPayloadsBytes());
+
+  released.reset();
+  buffer.shutdown();
+}
+
+/**
+ * A stream that has none of the released records, e.g. because it didn't
+ * exist or was behind when they were pushed to streams, reads them from the
+ * records recently released for the log instead of from the local log store.
+ */
+TEST_F(CatchupQueueTest, RecentReleasedRecords) {
+  const std::vector<std::string> payloads = {"first", "second", "third"};
+  std::shared_ptr<ZeroCopiedRecord> entries;
+  for (int i = payloads.size() - 1; i >= 0; --i) {
+    auto entry = std::make_shared<TestZeroCopiedRecord>(
+        lsn_t(i + 1), Slice(payloads[i].data(), payloads[i].size()));
+    entry->next_ = std::move(entries);
+    entries = std::move(entry);
+  }
+
+  // Only the first stream exists when the records are released.
+  ServerReadStream& tailer = createStream(read_stream_id_t(1));
+  streams_.appendReleasedRecords(std::make_unique<ReleasedRecords>(
+      log_id_,
+      lsn_t(1),
+      lsn_t(payloads.size()),
+      entries,
+      ReleasedRecords::computeBytesEstimate(entries.get())));
+  streams_.distributeNewlyReleasedRecords();
+  EXPECT_EQ(1u, tailer.giveReleasedRecords().size());
+
+  ServerReadStream& behind = createStream(read_stream_id_t(2));
+  notifyNeedsCatchup(behind, read_stream_id_t(2));
+
+  std::vector<lsn_t> shipped;
+  for (const auto& m : messages_) {
+    auto* msg = dynamic_cast<RECORD_Message*>(m.first.get());
+    if (msg) {
+      const RECORD_Header& header = getHeader(*msg);
+      EXPECT_EQ(read_stream_id_t(2), header.read_stream_id);
+      EXPECT_EQ(payloads[header.lsn - 1], getPayload(*msg).toString());
+      shipped.push_back(header.lsn);
+    }
+  }
+  EXPECT_EQ(std::vector<lsn_t>({1, 2, 3}), shipped);
+  EXPECT_EQ(0, n_non_blocking_read_attempts_);
+  EXPECT_EQ(1, getStats(client_id_).real_time_recent_hit_tail);
+  EXPECT_EQ(0, getStats(client_id_).real_time_recent_miss_tail);
+}
+
+/**
+ * A stream whose read pointer is outside of the range of the recently
+ * released records goes to the local log store without counting a miss.
+ * Hits are counted separately for backlog streams.
+ */
+TEST_F(CatchupQueueTest, RecentReleasedRecordsOutOfRange) {
+  const std::vector<std::string> payloads = {"fifth", "sixth", "seventh"};
+  const lsn_t first_lsn = 5;
+  std::shared_ptr<ZeroCopiedRecord> entries;
+  for (int i = payloads.size() - 1; i >= 0; --i) {
+    auto entry = std::make_shared<TestZeroCopiedRecord>(
+        first_lsn + i, Slice(payloads[i].data(), payloads[i].size()));
+    entry->next_ = std::move(entries);
+    entries = std::move(entry);
+  }
+
+  ServerReadStream& tailer = createStream(read_stream_id_t(1));
+  tailer.setReadPtr(first_lsn);
+  streams_.appendReleasedRecords(std::make_unique<ReleasedRecords>(
+      log_id_,
+      first_lsn,
+      first_lsn + payloads.size() - 1,
+      entries,
+      ReleasedRecords::computeBytesEstimate(entries.get())));
+  streams_.distributeNewlyReleasedRecords();
+  EXPECT_EQ(1u, tailer.giveReleasedRecords().size());
+
+  // Reads backlog from within the range.
+  ServerReadStream& backlog = createStream(read_stream_id_t(2));
+  backlog.setTrafficClass(TrafficClass::READ_BACKLOG);
+  backlog.setReadPtr(first_lsn + 1);
+  notifyNeedsCatchup(backlog, read_stream_id_t(2));
+  EXPECT_EQ(0, n_non_blocking_read_attempts_);
+  EXPECT_EQ(1, getStats(client_id_).real_time_recent_hit_backlog);
+  EXPECT_EQ(0, getStats(client_id_).real_time_recent_miss_backlog);
+
+  // Reads from the start of the log, far behind the recent records.
+  ServerReadStream& behind = createStream(read_stream_id_t(3));
+  notifyNeedsCatchup(behind, read_stream_id_t(3));
+  EXPECT_EQ(1, n_non_blocking_read_attempts_);
+  EXPECT_EQ(0, getStats(client_id_).real_time_recent_hit_tail);
+  EXPECT_EQ(0, getStats(client_id_).real_time_recent_miss_tail);
+}
+
+void CatchupQueueTest::blockCatchupQueue(bool block) {
+  getClientStateMap().find(client_id_)->second.catchup_queue->blockUnBlock(
+      block);
+}
+
+/**
+ * A backlog stream and a tailing stream of the same client share the output
+ * buffer with deficit round robin: the backlog stream's batch is limited to
+ * its quantum, and once it is done the tailing stream gets its turn without
+ * waiting for the output buffer to drain.
+ */
+TEST_F(CatchupQueueTest, DeficitRoundRobin) {
+  settings_.catchup_queue_backlog_quantum_kb = 16;
+  settings_.catchup_queue_tail_quantum_kb = 64;
+  setLastReleasedLSN(LSN_MAX);
+
+  // Queue both streams before the CatchupQueue gets to process them.
+  blockCatchupQueue(true);
+  read_stream_id_t id1(1);
+  ServerReadStream& stream1 = createStream(id1);
+  stream1.setTrafficClass(TrafficClass::READ_BACKLOG);
+  stream1.setReadPtr(100);
+  stream1.last_delivered_lsn_ = 100 - 1;
+  notifyNeedsCatchup(stream1, id1);
+  read_stream_id_t id2(2);
+  ServerReadStream& stream2 = createStream(id2);
+  stream2.setReadPtr(200);
+  stream2.last_delivered_lsn_ = 200 - 1;
+  notifyNeedsCatchup(stream2, id2);
+  ASSERT_EQ(0, tasks_.size());
+  blockCatchupQueue(false);
+
+  // The backlog stream reads at most its quantum.
+  ASSERT_EQ(1, tasks_.size());
+  std::unique_ptr<ReadStorageTask> task = std::move(tasks_.front());
+  tasks_.clear();
+  ASSERT_EQ(100, task->read_ctx_.read_ptr_.lsn);
+  ASSERT_EQ(16 * 1024, task->read_ctx_.max_bytes_to_deliver_);
+
+  ReadStorageTask::RecordContainer records;
+  records.push_back(createFakeRecord(100, 6000));
+  records.push_back(createFakeRecord(101, 6000));
+  task->status_ = E::BYTE_LIMIT_REACHED;
+  task->records_ = std::move(records);
+  task->read_ctx_.read_ptr_ = {lsn_t{102}};
+  streams_.onReadTaskDone(*task);
+  // 2 STARTED messages. 2 Records.
+  ASSERT_EQ(4, messages_.size());
+
+  // The output buffer is far from full, so the tailing stream is served right
+  // away, up to its own quantum.
+  ASSERT_EQ(1, tasks_.size());
+  task = std::move(tasks_.front());
+  tasks_.clear();
+  ASSERT_EQ(200, task->read_ctx_.read_ptr_.lsn);
+  ASSERT_EQ(64 * 1024, task->read_ctx_.max_bytes_to_deliver_);
+  EXPECT_EQ(2, getStats(client_id_).catchup_queue_drr_limited_batches);
+}
+
+/**
+ * The quanta of read streams don't depend on the read weight of the client's
+ * principal, which only matters between clients (see CatchupQueueArbiter),
+ * and a stream alone in its queue is not limited by its quantum.
+ */
+TEST_F(CatchupQueueTest, DeficitRoundRobinReadWeight) {
+  settings_.catchup_queue_backlog_quantum_kb = 16;
+  read_weight_ = 3;
+  resetCatchupQueue();
+
+  blockCatchupQueue(true);
+  for (int i = 1; i <= 2; ++i) {
+    ServerReadStream& stream = createStream(read_stream_id_t(i));
+    stream.setTrafficClass(TrafficClass::READ_BACKLOG);
+    notifyNeedsCatchup(stream, read_stream_id_t(i));
+  }
+  blockCatchupQueue(false);
+
+  ASSERT_EQ(1, tasks_.size());
+  std::unique_ptr<ReadStorageTask> task = std::move(tasks_.front());
+  tasks_.clear();
+  ASSERT_EQ(16 * 1024, task->read_ctx_.max_bytes_to_deliver_);
+
+  // Stream 1 is done, stream 2 is left alone.
+  task->status_ = E::CAUGHT_UP;
+  task->read_ctx_.read_ptr_ = {lsn_t{101}};
+  streams_.onReadTaskDone(*task);
+  ASSERT_EQ(1, tasks_.size());
+  task = std::move(tasks_.front());
+  tasks_.clear();
+  ASSERT_EQ(128 * 1024, task->read_ctx_.max_bytes_to_deliver_);
+}
+
+/**
+ * A client that has read its share of the worker waits while other clients
+ * read theirs, and reads again when the next round of CatchupQueueArbiter
+ * starts.
+ */
+TEST_F(CatchupQueueTest, ArbiterWaitsForOtherClients) {
+  settings_.catchup_queue_tail_quantum_kb = 16;
+  arbiter_ = std::make_unique<CatchupQueueArbiter>(
+      [this] { arbiter_resume_scheduled_ = true; });
+  resetCatchupQueue();
+  // Another client on the same worker.
+  CatchupQueueArbiter::Client other(1, [] {});
+
+  read_stream_id_t id(1);
+  ServerReadStream& stream = createStream(id);
+  notifyNeedsCatchup(stream, id);
+  ASSERT_EQ(1, tasks_.size());
+  std::unique_ptr<ReadStorageTask> task = std::move(tasks_.front());
+  tasks_.clear();
+
+  // The other client reads while the storage task is in flight.
+  ASSERT_TRUE(arbiter_->mayRead(other, 16 * 1024));
+
+  // The storage task brings back more than the client's share.
+  ReadStorageTask::RecordContainer records;
+  records.push_back(createFakeRecord(1, 10000));
+  records.push_back(createFakeRecord(2, 10000));
+  task->status_ = E::PARTIAL;
+  task->records_ = std::move(records);
+  task->read_ctx_.read_ptr_ = {lsn_t{3}};
+  streams_.onReadTaskDone(*task);
+  EXPECT_EQ(0, tasks_.size());
+  EXPECT_EQ(1, arbiter_->numWaiting());
+  EXPECT_TRUE(arbiter_resume_scheduled_);
+  EXPECT_EQ(1, getStats(client_id_).catchup_queue_arbiter_waits);
+
+  // The round goes on while the other client reads.
+  for (int i = 0; i < 2; ++i) {
+    arbiter_resume_scheduled_ = false;
+    arbiter_->resumeNext();
+    EXPECT_TRUE(arbiter_resume_scheduled_);
+    ASSERT_TRUE(arbiter_->mayRead(other, 16 * 1024));
+  }
+  EXPECT_EQ(0, tasks_.size());
+
+  // An iteration goes by without reads, the client gets its turn.
+  arbiter_resume_scheduled_ = false;
+  arbiter_->resumeNext();
+  EXPECT_TRUE(arbiter_resume_scheduled_);
+  EXPECT_EQ(0, tasks_.size());
+  arbiter_resume_scheduled_ = false;
+  arbiter_->resumeNext();
+  EXPECT_FALSE(arbiter_resume_scheduled_);
+  EXPECT_EQ(0, arbiter_->numWaiting());
+  ASSERT_EQ(1, tasks_.size());
+  EXPECT_EQ(3, tasks_.front()->read_ctx_.read_ptr_.lsn);
+}
+
+/**
+ * The catchup_queues table lists how long each queued stream has waited.
+ */
+TEST_F(CatchupQueueTest, DebugInfoStreamQueueDelays) {
+  blockCatchupQueue(true);
+  for (int i = 1; i <= 2; ++i) {
+    ServerReadStream& stream = createStream(read_stream_id_t(i));
+    notifyNeedsCatchup(stream, read_stream_id_t(i));
+  }
+
+  InfoCatchupQueuesTable table(false,
+                               "Client",
+                               "Queued total",
+                               "Queued Immediate",
+                               "Queued delayed",
+                               "Record Bytes Queued",
+                               "Storage task in flight",
+                               "Ping Timer Active",
+                               "Blocked",
+                               "Read Weight",
+                               "Max Queue Delay Ms",
+                               "Avg Queue Delay Ms",
+                               "Stream Queue Delays Ms",
+                               "Waiting For Turn");
+  streams_.getCatchupQueuesDebugInfo(table);
+  ASSERT_EQ(1, table.numRows());
+  folly::dynamic row = folly::parseJson(table.toString(true))["rows"][0];
+  // "log:read stream id:delay" of both streams, in queue order.
+  std::vector<std::string> delays;
+  folly::split(',', row[11].asString(), delays);
+  ASSERT_EQ(2, delays.size());
+  for (int i = 0; i < 2; ++i) {
+    std::vector<std::string> fields;
+    folly::split(':', delays[i], fields);
+    ASSERT_EQ(3, fields.size());
+    EXPECT_EQ(folly::to<std::string>(log_id_.val()), fields[0]);
+    EXPECT_EQ(folly::to<std::string>(i + 1), fields[1]);
+    // Freshly queued.
+    EXPECT_LT(folly::to<int64_t>(fields[2]), 60000);
+  }
+  EXPECT_EQ("0", row[12].asString());
+  blockCatchupQueue(false);
+}
+
+/**
+ * With --output-adaptive-drain-time, the size of read storage tasks follows
+ * how fast the client drains records, within bounds.
+ */
+TEST_F(CatchupQueueTest, AdaptiveBatchSize) {
+  settings_.output_adaptive_drain_time = std::chrono::milliseconds(100);
+  settings_.output_adaptive_min_records_kb = 64;
+  settings_.output_adaptive_max_records_kb = 1024;
+
+  auto read_batch = [&](read_stream_id_t id) {
+    ServerReadStream& stream = createStream(id);
+    notifyNeedsCatchup(stream, id);
+    EXPECT_EQ(1, tasks_.size());
+    std::unique_ptr<ReadStorageTask> task = std::move(tasks_.front());
+    tasks_.clear();
+    // The stream is done reading.
+    task->status_ = E::CAUGHT_UP;
+    task->read_ctx_.read_ptr_ = {lsn_t{101}};
+    streams_.onReadTaskDone(*task);
+    EXPECT_EQ(0, tasks_.size());
+    return task->read_ctx_.max_bytes_to_deliver_;
+  };
+
+  // Nothing measured yet: the static limit applies.
+  EXPECT_EQ(128 * 1024, read_batch(read_stream_id_t(1)));
+
+  // 1MB/s drains 100KB in 100ms.
+  setDrainRate(1e6);
+  EXPECT_EQ(100000, read_batch(read_stream_id_t(2)));
+
+  // Slow and fast clients are bounded.
+  setDrainRate(1e3);
+  EXPECT_EQ(64 * 1024, read_batch(read_stream_id_t(3)));
+  setDrainRate(1e9);
+  EXPECT_EQ(1024 * 1024, read_batch(read_stream_id_t(4)));
+}
+
+/**
+ * The drain rate is measured every time the output evbuffer empties, and the
+ * next read storage task is sized from it.
+ */
+TEST_F(CatchupQueueTest, AdaptiveBatchSizeFollowsDrain) {
+  settings_.output_adaptive_drain_time = std::chrono::milliseconds(100);
+  settings_.output_adaptive_min_records_kb = 1;
+  settings_.output_adaptive_max_records_kb = 1024;
+  const read_stream_id_t id(1);
+  ServerReadStream& stream = createStream(id);
+  notifyNeedsCatchup(stream, id);
+
+  // Completes the read storage task in flight with two records starting at
+  // `lsn', waits for `drain_time', then drains them.  Returns the batch size
+  // of the next read storage task.
+  auto read_and_drain = [&](lsn_t lsn, std::chrono::milliseconds drain_time) {
+    EXPECT_EQ(1, tasks_.size());
+    std::unique_ptr<ReadStorageTask> task = std::move(tasks_.front());
+    tasks_.clear();
+    ReadStorageTask::RecordContainer records;
+    records.push_back(createFakeRecord(lsn, 5000));
+    records.push_back(createFakeRecord(lsn + 1, 5000));
+    task->status_ = E::BYTE_LIMIT_REACHED;
+    task->records_ = std::move(records);
+    task->read_ctx_.read_ptr_ = {lsn + 2};
+    streams_.onReadTaskDone(*task);
+    // Nothing more is read until the records drain.
+    EXPECT_EQ(0, tasks_.size());
+
+    std::this_thread::sleep_for(drain_time);
+    SteadyTimestamp enqueue_time = SteadyTimestamp::now();
+    std::unique_ptr<RECORD_Message> msg1(
+        createFakeRecordMessage(id, lsn, 5000));
+    std::unique_ptr<RECORD_Message> msg2(
+        createFakeRecordMessage(id, lsn + 1, 5000));
+    streams_.onRecordSent(client_id_, *msg1, enqueue_time);
+    streams_.onRecordSent(client_id_, *msg2, enqueue_time);
+    EXPECT_EQ(1, tasks_.size());
+    const size_t batch =
+        tasks_.empty() ? 0 : tasks_.front()->read_ctx_.max_bytes_to_deliver_;
+    return std::make_pair(msg1->size() + msg2->size(), batch);
+  };
+  auto expected_batch = [&] {
+    return std::min<size_t>(
+        std::max<size_t>(getDrainRate() * 0.1, 1024), 1024 * 1024);
+  };
+
+  // The first sample is the estimate.
+  EXPECT_EQ(0, getDrainRate());
+  auto res = read_and_drain(1, std::chrono::milliseconds(20));
+  const double rate1 = getDrainRate();
+  EXPECT_GT(rate1, 0);
+  EXPECT_LE(rate1, res.first / 0.02);
+  EXPECT_EQ(expected_batch(), res.second);
+
+  // A slower drain pulls the estimate down, and the batch size with it.
+  res = read_and_drain(3, std::chrono::milliseconds(200));
+  const double rate2 = getDrainRate();
+  EXPECT_GE(rate2, 0.75 * rate1);
+  EXPECT_LE(rate2, 0.75 * rate1 + 0.25 * res.first / 0.2);
+  EXPECT_EQ(expected_batch(), res.second);
+}
+
 }} // namespace facebook::logdevice
@@ -0,0 +1,456 @@
+/**
+ * Copyright (c) 2017-present, Facebook, Inc. and its affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+#include <map>
+#include <memory>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "logdevice/common/LocalLogStoreRecordFormat.h"
+#include "logdevice/common/configuration/LocalLogsConfig.h"
+#include "logdevice/common/configuration/UpdateableConfig.h"
+#include "logdevice/common/debug.h"
+#include "logdevice/common/settings/util.h"
+#include "logdevice/common/test/TestUtil.h"
+#include "logdevice/server/rebuilding/ChunkRebuilding.h"
+#include "logdevice/server/rebuilding/ShardRebuildingV2.h"
+
+using namespace facebook::logdevice;
+
+namespace {
+
+const logid_t kLogID(1);
+const shard_index_t kShard = 0;
+const size_t kNumNodes = 10;
+const ServerInstanceId kServerInstanceId = 42;
+
+using ChunkData = RebuildingReadStorageTaskV2::ChunkData;
+
+lsn_t lsn(esn_t::raw_type esn) {
+  return compose_lsn(epoch_t(3), esn_t(esn));
+}
+
+// Creates a fake record as if it was read from the local log store.
+RawRecord createFakeRecord(lsn_t lsn, size_t payload_size) {
+  STORE_Header header;
+  header.rid = RecordID{lsn_to_esn(lsn), lsn_to_epoch(lsn), kLogID};
+  header.timestamp = 0;
+  header.last_known_good = esn_t(0);
+  header.wave = 1;
+  header.flags = 0;
+  header.copyset_size = 1;
+  StoreChainLink chain[] = {{ShardID(1, 0), ClientID()}};
+
+  std::string buf;
+  Slice header_blob = LocalLogStoreRecordFormat::formRecordHeader(
+      header, chain, &buf, false, std::map<KeyType, std::string>());
+
+  size_t size = header_blob.size + payload_size;
+  void* data = malloc(size);
+  ld_check(data);
+  memcpy(data, header_blob.data, header_blob.size);
+  return RawRecord(lsn, Slice(data, size), /* owned payload */ true);
+}
+
+class MockRecordRebuildingStore : public RecordRebuildingStore {
+ public:
+  MockRecordRebuildingStore(RawRecord record,
+                            RecordRebuildingOwner* owner,
+                            std::shared_ptr<ReplicationScheme> replication,
+                            const Settings& settings)
+      : RecordRebuildingStore(/*block_id=*/1,
+                              kShard,
+                              std::move(record),
+                              owner,
+                              replication),
+        settings_(settings) {}
+  void start(bool) override {}
+  void onComplete() override {}
+  const Settings& getSettings() const override {
+    return settings_;
+  }
+
+  const Settings& settings_;
+};
+
+class MockRecordRebuildingAmend : public RecordRebuildingAmend {
+ public:
+  MockRecordRebuildingAmend(const RecordRebuildingAmendState& s,
+                            RecordRebuildingOwner* owner,
+                            const Settings& settings)
+      : RecordRebuildingAmend(s.lsn_,
+                              kShard,
+                              owner,
+                              s.replication_,
+                              s.storeHeader_,
+                              s.flags_,
+                              s.newCopyset_,
+                              s.amendRecipients_,
+                              s.rebuildingWave_),
+        settings_(settings) {}
+  void start(bool) override {}
+  const Settings& getSettings() const override {
+    return settings_;
+  }
+
+  const Settings& settings_;
+};
+
+// Owner of the chunks, only records which ones are done.
+class MockShardRebuildingV2 : public ShardRebuildingV2 {
+ public:
+  MockShardRebuildingV2(std::shared_ptr<const RebuildingSet> rebuilding_set,
+                        UpdateableSettings<RebuildingSettings> settings,
+                        std::shared_ptr<UpdateableConfig> config)
+      : ShardRebuildingV2(kShard,
+                          /*rebuilding_version=*/1,
+                          /*restart_version=*/1,
+                          std::move(rebuilding_set),
+                          /*store=*/nullptr,
+                          std::move(settings),
+                          std::move(config),
+                          /*listener=*/nullptr) {}
+
+  void onChunkRebuildingDone(ChunkRebuilding* chunk) override {
+    done.push_back(chunk);
+  }
+
+  std::vector<ChunkRebuilding*> done;
+};
+
+class MockChunkRebuilding : public ChunkRebuilding {
+ public:
+  MockChunkRebuilding(ShardRebuildingV2* owner,
+                      std::unique_ptr<ChunkData> data,
+                      std::shared_ptr<ReplicationScheme> replication,
+                      ChunkRebuildingMap& map,
+                      const Settings& settings)
+      : ChunkRebuilding(owner, kShard, std::move(data), replication),
+        scheme_(replication),
+        chunk_map_(map),
+        settings_(settings) {}
+
+  void fireDurabilityTimer() {
+    ASSERT_TRUE(durabilityTimerActive);
+    durabilityTimerActive = false;
+    onDurabilityTimeout();
+  }
+
+  void fireRestartTimer() {
+    ASSERT_TRUE(restartTimerActive);
+    restartTimerActive = false;
+    restart();
+  }
+
+  // RecordRebuildingStore state machines created since the last call, by LSN.
+  std::map<lsn_t, RecordRebuildingStore*> takeStores() {
+    std::map<lsn_t, RecordRebuildingStore*> res;
+    res.swap(stores);
+    return res;
+  }
+  // LSNs of RecordRebuildingAmend state machines created since the last call.
+  std::vector<lsn_t> takeAmends() {
+    std::vector<lsn_t> res;
+    res.swap(amends);
+    return res;
+  }
+
+  bool durabilityTimerActive = false;
+  bool restartTimerActive = false;
+
+ protected:
+  ChunkRebuildingMap& getChunkRebuildingMap() override {
+    return chunk_map_;
+  }
+
+  std::unique_ptr<RecordRebuildingStore>
+  createRecordRebuildingStore(RawRecord record) override {
+    auto store = std::make_unique<MockRecordRebuildingStore>(
+        std::move(record), this, scheme_, settings_);
+    stores[store->getRecord().lsn] = store.get();
+    return std::move(store);
+  }
+
+  std::unique_ptr<RecordRebuildingAmend>
+  createRecordRebuildingAmend(const RecordRebuildingAmendState& s) override {
+    amends.push_back(s.lsn_);
+    return std::make_unique<MockRecordRebuildingAmend>(s, this, settings_);
+  }
+
+  std::unique_ptr<LibeventTimer>
+  createTimer(std::function<void()> /*callback*/) override {
+    return nullptr;
+  }
+
+  void activateDurabilityTimer() override {
+    durabilityTimerActive = true;
+  }
+  void cancelDurabilityTimer() override {
+    durabilityTimerActive = false;
+  }
+  void activateRestartTimer() override {
+    restartTimerActive = true;
+  }
+  void cancelRestartTimer() override {
+    restartTimerActive = false;
+  }
+
+ private:
+  std::shared_ptr<ReplicationScheme> scheme_;
+  ChunkRebuildingMap& chunk_map_;
+  const Settings& settings_;
+  std::map<lsn_t, RecordRebuildingStore*> stores;
+  std::vector<lsn_t> amends;
+};
+
+} // namespace
+
+class ChunkRebuildingTest : public ::testing::Test {
+ public:
+  ChunkRebuildingTest()
+      : config_(std::make_shared<UpdateableConfig>()),
+        rebuilding_settings_(create_default_settings<RebuildingSettings>()),
+        settings_(create_default_settings<Settings>()) {
+    dbg::assertOnData = true;
+    rebuilding_settings_.max_records_in_flight = 2;
+    rebuilding_settings_.max_amends_in_flight = 2;
+  }
+
+  void init(size_t nrecords) {
+    updateConfig();
+    auto rebuilding_set = std::make_shared<RebuildingSet>();
+    rebuilding_set->shards.emplace(
+        ShardID(1, 0), RebuildingNodeInfo(RebuildingMode::RESTORE));
+    owner_ = std::make_unique<MockShardRebuildingV2>(
+        rebuilding_set,
+        UpdateableSettings<RebuildingSettings>(rebuilding_settings_),
+        config_);
+
+    auto data = std::make_unique<ChunkData>();
+    data->logID = kLogID;
+    data->blockID = 1;
+    for (size_t i = 1; i <= nrecords; ++i) {
+      data->records.push_back(createFakeRecord(lsn(i), 100));
+      data->totalBytes += data->records.back().blob.size;
+    }
+
+    StorageSet storage_set;
+    for (node_index_t n = 0; n < kNumNodes; ++n) {
+      storage_set.push_back(ShardID(n, 0));
+    }
+    auto replication = std::make_shared<ReplicationScheme>(
+        kLogID,
+        EpochMetaData(storage_set,
+                      ReplicationProperty({{NodeLocationScope::NODE, 3}}),
+                      epoch_t(1),
+                      epoch_t(1)),
+        config_->get()->serverConfig(),
+        nullptr,
+        settings_,
+        /*relocate_local_records=*/false);
+
+    chunk_ = std::make_unique<MockChunkRebuilding>(
+        owner_.get(), std::move(data), replication, map_, settings_);
+  }
+
+  void updateConfig() {
+    Configuration::Nodes nodes;
+    for (node_index_t i = 0; i < kNumNodes; ++i) {
+      Configuration::Node& node = nodes[i];
+      node.address = Sockaddr(
+          get_localhost_address_str(), folly::to<std::string>(4440 + i));
+      node.generation = 1;
+      node.addStorageRole();
+    }
+    Configuration::NodesConfig nodes_config(std::move(nodes));
+    Configuration::MetaDataLogsConfig meta_config =
+        createMetaDataLogsConfig(nodes_config, kNumNodes, 3);
+    config_->updateableServerConfig()->update(
+        ServerConfig::fromData(__FILE__, nodes_config, meta_config));
+
+    auto logs_config = std::make_unique<configuration::LocalLogsConfig>();
+    Configuration::Log log{};
+    log.replicationFactor = 3;
+    log.rangeName = "mylogs";
+    logs_config->insert(boost::icl::right_open_interval<logid_t::raw_type>(
+                            kLogID.val_, kLogID.val_ + 1),
+                        log);
+    config_->updateableLogsConfig()->update(std::move(logs_config));
+  }
+
+  void onAllStoresReceived(esn_t::raw_type esn, FlushTokenMap tokens = {}) {
+    chunk_->onAllStoresReceived(
+        lsn(esn), std::make_unique<FlushTokenMap>(std::move(tokens)));
+  }
+
+  void onAllAmendsReceived(esn_t::raw_type esn, FlushTokenMap tokens = {}) {
+    chunk_->onAllAmendsReceived(
+        lsn(esn), std::make_unique<FlushTokenMap>(std::move(tokens)));
+  }
+
+  // Looks up a record the way STORE and STORED messages do.
+  RecordRebuildingInterface* route(log_rebuilding_id_t id,
+                                   esn_t::raw_type esn,
+                                   logid_t log = kLogID,
+                                   shard_index_t shard = kShard) {
+    return findRecordRebuilding(
+        log_rebuildings_, map_, id, log, shard, lsn(esn));
+  }
+
+  std::vector<lsn_t> lsns(std::vector<esn_t::raw_type> esns) {
+    std::vector<lsn_t> res;
+    for (auto esn : esns) {
+      res.push_back(lsn(esn));
+    }
+    return res;
+  }
+
+  std::vector<lsn_t> keys(const std::map<lsn_t, RecordRebuildingStore*>& m) {
+    std::vector<lsn_t> res;
+    for (const auto& kv : m) {
+      res.push_back(kv.first);
+    }
+    return res;
+  }
+
+  std::shared_ptr<UpdateableConfig> config_;
+  RebuildingSettings rebuilding_settings_;
+  Settings settings_;
+  LogRebuildingMap log_rebuildings_;
+  ChunkRebuildingMap map_;
+  std::unique_ptr<MockShardRebuildingV2> owner_;
+  std::unique_ptr<MockChunkRebuilding> chunk_;
+};
+
+// Stores and amends are started at most max_records_in_flight and
+// max_amends_in_flight at a time, and each stage only ends once its memtables
+// are flushed.
+TEST_F(ChunkRebuildingTest, Simple) {
+  init(3);
+  chunk_->start();
+  EXPECT_TRUE(chunk_->durabilityTimerActive);
+  EXPECT_EQ(lsns({1, 2}), keys(chunk_->takeStores()));
+
+  const auto node1 = std::make_pair(node_index_t(1), kServerInstanceId);
+  const auto node2 = std::make_pair(node_index_t(2), kServerInstanceId);
+  onAllStoresReceived(1, {{node1, 10}});
+  EXPECT_EQ(lsns({3}), keys(chunk_->takeStores()));
+  onAllStoresReceived(2, {{node2, 5}});
+  onAllStoresReceived(3, {{node1, 12}});
+  EXPECT_TRUE(chunk_->takeStores().empty());
+
+  // Waiting for memtables to be flushed.
+  EXPECT_TRUE(chunk_->takeAmends().empty());
+  chunk_->onMemtableFlushed(1, kServerInstanceId, 11);
+  chunk_->onMemtableFlushed(2, kServerInstanceId, 5);
+  EXPECT_TRUE(chunk_->takeAmends().empty());
+  chunk_->onGracefulShutdown(1, kServerInstanceId);
+  EXPECT_EQ(lsns({1, 2}), chunk_->takeAmends());
+
+  onAllAmendsReceived(2);
+  EXPECT_EQ(lsns({3}), chunk_->takeAmends());
+  onAllAmendsReceived(1, {{node2, 6}});
+  onAllAmendsReceived(3);
+  EXPECT_TRUE(owner_->done.empty());
+
+  // A flush of an older memtable doesn't count.
+  chunk_->onMemtableFlushed(2, ServerInstanceId(kServerInstanceId - 1), 100);
+  EXPECT_TRUE(owner_->done.empty());
+  chunk_->onMemtableFlushed(2, kServerInstanceId, 6);
+  ASSERT_EQ(1, owner_->done.size());
+  EXPECT_EQ(chunk_.get(), owner_->done[0]);
+  EXPECT_FALSE(chunk_->durabilityTimerActive);
+}
+
+// A chunk that doesn't become durable in time starts over under a new id.
+TEST_F(ChunkRebuildingTest, RestartOnDurabilityTimeout) {
+  init(2);
+  chunk_->start();
+  chunk_->takeStores();
+  const log_rebuilding_id_t id = chunk_->getLogRebuildingId();
+
+  const auto node1 = std::make_pair(node_index_t(1), kServerInstanceId);
+  onAllStoresReceived(1, {{node1, 10}});
+  onAllStoresReceived(2, {{node1, 10}});
+  EXPECT_TRUE(chunk_->takeAmends().empty());
+
+  chunk_->fireDurabilityTimer();
+  EXPECT_NE(id, chunk_->getLogRebuildingId());
+  EXPECT_TRUE(chunk_->durabilityTimerActive);
+  EXPECT_EQ(lsns({1, 2}), keys(chunk_->takeStores()));
+  EXPECT_EQ(nullptr, route(id, 1));
+  EXPECT_NE(nullptr, route(chunk_->getLogRebuildingId(), 1));
+
+  // Flushes are remembered across restarts.
+  chunk_->onMemtableFlushed(1, kServerInstanceId, 10);
+  onAllStoresReceived(1, {{node1, 10}});
+  onAllStoresReceived(2, {{node1, 9}});
+  EXPECT_EQ(lsns({1, 2}), chunk_->takeAmends());
+  onAllAmendsReceived(1);
+  onAllAmendsReceived(2);
+  EXPECT_EQ(1, owner_->done.size());
+}
+
+// An amend that finds the copyset invalid restarts the chunk, but not from
+// inside its own callback.
+TEST_F(ChunkRebuildingTest, RestartOnCopysetInvalid) {
+  init(2);
+  chunk_->start();
+  chunk_->takeStores();
+  onAllStoresReceived(1);
+  onAllStoresReceived(2);
+  EXPECT_EQ(lsns({1, 2}), chunk_->takeAmends());
+  const log_rebuilding_id_t id = chunk_->getLogRebuildingId();
+
+  chunk_->onCopysetInvalid(lsn(2));
+  EXPECT_TRUE(chunk_->restartTimerActive);
+  EXPECT_EQ(id, chunk_->getLogRebuildingId());
+  // The amend is still there.
+  EXPECT_NE(nullptr, route(id, 2));
+  chunk_->onCopysetInvalid(lsn(1));
+
+  chunk_->fireRestartTimer();
+  EXPECT_NE(id, chunk_->getLogRebuildingId());
+  EXPECT_FALSE(chunk_->restartTimerActive);
+  EXPECT_EQ(lsns({1, 2}), keys(chunk_->takeStores()));
+  EXPECT_TRUE(owner_->done.empty());
+}
+
+// STORE and STORED messages find the state machine of their record through
+// the ChunkRebuildingMap, using the id they carry.
+TEST_F(ChunkRebuildingTest, RoutingThroughChunkRebuildingMap) {
+  init(3);
+  chunk_->start();
+  auto stores = chunk_->takeStores();
+  const log_rebuilding_id_t id = chunk_->getLogRebuildingId();
+  ASSERT_EQ(1, map_.map.size());
+
+  EXPECT_EQ(stores[lsn(1)], route(id, 1));
+  EXPECT_EQ(stores[lsn(2)], route(id, 2));
+  // Store not started yet.
+  EXPECT_EQ(nullptr, route(id, 3));
+  // Not in the chunk.
+  EXPECT_EQ(nullptr, route(id, 4));
+  // Wrong id, log or shard.
+  EXPECT_EQ(nullptr, route(log_rebuilding_id_t(id.val_ + 1), 1));
+  EXPECT_EQ(nullptr, route(id, 1, logid_t(kLogID.val_ + 1)));
+  EXPECT_EQ(nullptr, route(id, 1, kLogID, kShard + 1));
+
+  // Amends are found the same way.
+  onAllStoresReceived(1);
+  onAllStoresReceived(2);
+  onAllStoresReceived(3);
+  EXPECT_EQ(lsns({1, 2}), chunk_->takeAmends());
+  EXPECT_NE(nullptr, route(id, 1));
+  EXPECT_NE(nullptr, route(id, 2));
+  EXPECT_EQ(nullptr, route(id, 3));
+
+  // The chunk unregisters itself when destroyed.
+  chunk_.reset();
+  EXPECT_TRUE(map_.map.empty());
+}
@@ -21,6 +21,7 @@
 #include "logdevice/server/locallogstore/test/LocalLogStoreTestReader.h"
 #include "logdevice/server/locallogstore/test/StoreUtil.h"
 #include "logdevice/server/locallogstore/test/TemporaryLogStore.h"
+#include "logdevice/server/ServerRecordFilterFactory.h"
 #include "logdevice/server/read_path/LocalLogStoreReader.h"
 
 using namespace facebook::logdevice;
@@ -52,6 +53,7 @@ struct RecordDescriptor {
   STORE_flags_t flags = 0;
   size_t extra_payload_size = 0;
   DataKeyFormat key_format = DataKeyFormat::DEFAULT;
+  std::string filterable_key;
 };
 
 } // namespace
@@ -112,7 +114,10 @@ class LocalLogStoreReaderTest : public ::testing::TestWithParam<Options> {
         chain.data(),
         buf,
         shardIDInCopyset(),
-        std::map<KeyType, std::string>());
+        rec.filterable_key.empty()
+            ? std::map<KeyType, std::string>()
+            : std::map<KeyType, std::string>{
+                  {KeyType::FILTERABLE, rec.filterable_key}});
   }
 
   Slice formCopySetIndexEntry(const RecordDescriptor& rec, std::string* buf) {
@@ -466,6 +471,61 @@ TEST_P(LocalLogStoreReaderTest, SingleCopyDeliveryEmptyBatch) {
   ASSERT_EQ(7, read_ptr.lsn);
 }
 
+// Runs of records with the same copyset, as written with sticky copysets.
+// With the copyset index, the filter only needs to run on the first entry of
+// a rejected run, the result must be the same.
+TEST_P(LocalLogStoreReaderTest, SingleCopyDeliveryStickyCopyset) {
+  class CountingFilter : public LLSFilter {
+   public:
+    bool operator()(logid_t log,
+                    lsn_t lsn,
+                    const ShardID* copyset,
+                    const copyset_size_t copyset_size,
+                    const csi_flags_t flags,
+                    RecordTimestamp min_ts,
+                    RecordTimestamp max_ts) override {
+      ++calls;
+      return LLSFilter::operator()(
+          log, lsn, copyset, copyset_size, flags, min_ts, max_ts);
+    }
+    int calls = 0;
+  };
+
+  std::vector<RecordDescriptor> data;
+  for (lsn_t lsn = 1; lsn <= 18; ++lsn) {
+    // Waves differ within runs, they aren't part of what the filter sees.
+    const uint32_t wave = lsn % 3 + 1;
+    if (lsn == 9 || lsn == 10) {
+      data.push_back({lsn, wave, {N0, N1, N2}});
+    } else {
+      data.push_back({lsn, wave, {N1, N0, N2}});
+    }
+  }
+  auto store = createStore(data);
+
+  auto filter = std::make_shared<CountingFilter>();
+  filter->scd_my_shard_id_ = N0;
+
+  ReadPointer read_ptr;
+  std::vector<RawRecord> records;
+  const Status st = ReadOperation()
+                        .use_csi(useCSI())
+                        .until_lsn(19)
+                        .window_high(19)
+                        .last_released(18)
+                        .filter(filter)
+                        .process(store.get(), records, &read_ptr);
+
+  ASSERT_EQ(E::CAUGHT_UP, st);
+  ASSERT_SHIPPED(records, 9, 10);
+  ASSERT_EQ(19, read_ptr.lsn);
+  if (useCSI()) {
+    EXPECT_LT(filter->calls, 10);
+  } else {
+    EXPECT_GE(filter->calls, 18);
+  }
+}
+
 TEST_P(LocalLogStoreReaderTest, SingleCopyDeliverySimpleOneKnownDown) {
   auto store = createStore({{1, 1, {N1, N0, N3, N4, N5}},
                             {2, 1, {N2, N5, N0, N4, N3}},
@@ -1233,6 +1293,41 @@ TEST_P(LocalLogStoreReaderTest, ReadPtrContinuityPartial) {
   ASSERT_SHIPPED(records, 2);
 }
 
+// Records whose key doesn't pass the server-side filter are passed to the
+// callback without their blob.
+TEST_P(LocalLogStoreReaderTest, KeyFilter) {
+  RecordDescriptor rec1{1, 1, {N1, N2}, 0, 1000};
+  rec1.filterable_key = "eu/tenant1";
+  RecordDescriptor rec2{2, 1, {N1, N2}, 0, 1000};
+  rec2.filterable_key = "us/tenant2";
+  // No key, never filtered out.
+  RecordDescriptor rec3{3, 1, {N1, N2}, 0, 1000};
+  RecordDescriptor rec4{4, 1, {N1, N2}, 0, 1000};
+  rec4.filterable_key = "eu/tenant3";
+  auto store = createStore({rec1, rec2, rec3, rec4});
+
+  std::vector<RawRecord> records;
+  const Status st = ReadOperation()
+                        .use_csi(useCSI())
+                        .until_lsn(4)
+                        .window_high(4)
+                        .last_released(4)
+                        .key_filter(ServerRecordFilterFactory::create(
+                            ServerRecordFilterType::PREFIX, "eu/", ""))
+                        // Only the two records passing the filter fit.
+                        .max_bytes_all_records(
+                            2 * RECORD_Message::expectedSize(1500))
+                        .process(store.get(), records);
+
+  EXPECT_EQ(E::BYTE_LIMIT_REACHED, st);
+  ASSERT_SHIPPED(records, 1, 2, 3);
+  EXPECT_FALSE(records[0].filtered_out);
+  EXPECT_TRUE(records[1].filtered_out);
+  EXPECT_EQ(nullptr, records[1].blob.data);
+  EXPECT_GT(records[1].filtered_out_bytes, 1000);
+  EXPECT_FALSE(records[2].filtered_out);
+}
+
 INSTANTIATE_TEST_CASE_P(LocalLogStoreReaderTest,
                         LocalLogStoreReaderTest,
                         ::testing::Values(WAVE_IN_VALUE,
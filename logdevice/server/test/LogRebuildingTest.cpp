@@ -18,6 +18,7 @@
 #include "logdevice/common/configuration/LocalLogsConfig.h"
 #include "logdevice/common/test/TestUtil.h"
 #include "logdevice/server/LogRebuilding.h"
+#include "logdevice/server/RebuildingReadStorageTask.h"
 #include "logdevice/server/RecordRebuildingStore.h"
 
 using namespace facebook::logdevice;
@@ -2537,6 +2538,54 @@ TEST_F(LogRebuildingTest, Simple2) {
 //                 reached the end of the timestamp window, and waits for
 //                 RebuildingCoordinator to notify that the window was slid.
 
+TEST(RebuildingReadStorageTaskTest, EstimatePayloadBytesSkipped) {
+  RebuildingReadStorageTask::ReadRecordSizes sizes;
+  LocalLogStore::ReadStats before;
+  before.read_records = 3;
+  before.read_record_bytes = 300;
+  before.filtered_csi_entries = 10;
+
+  // Nothing ever read, nothing to estimate from.
+  LocalLogStore::ReadStats after = before;
+  after.filtered_csi_entries = 20;
+  EXPECT_EQ(0,
+            RebuildingReadStorageTask::estimatePayloadBytesSkipped(
+                before, after, sizes));
+
+  // 4 records of 1000 bytes on average were read, 10 more were skipped.
+  after.read_records = 7;
+  after.read_record_bytes = 4300;
+  EXPECT_EQ(10000,
+            RebuildingReadStorageTask::estimatePayloadBytesSkipped(
+                before, after, sizes));
+  EXPECT_EQ(4, sizes.records);
+  EXPECT_EQ(4000, sizes.bytes);
+
+  // Nothing skipped.
+  after.filtered_csi_entries = 10;
+  EXPECT_EQ(0,
+            RebuildingReadStorageTask::estimatePayloadBytesSkipped(
+                before, after, sizes));
+  EXPECT_EQ(8, sizes.records);
+
+  // A batch in which every record was filtered out uses the average of the
+  // previous batches.
+  before = after;
+  after.filtered_csi_entries = 15;
+  EXPECT_EQ(5000,
+            RebuildingReadStorageTask::estimatePayloadBytesSkipped(
+                before, after, sizes));
+
+  // The average follows the records read since.
+  before = after;
+  after.read_records += 8;
+  after.read_record_bytes += 24000;
+  after.filtered_csi_entries += 1;
+  EXPECT_EQ(2000,
+            RebuildingReadStorageTask::estimatePayloadBytesSkipped(
+                before, after, sizes));
+}
+
 // TODO(#7781951): write a test to verify that the sliding window of
 //                 RecordRebuildingStore state machines is working properly.
 
@@ -146,3 +146,53 @@ TEST(LogStorageStateMapTest, LastReleasedLSNSource) {
   EXPECT_EQ(
       LogStorageState::LastReleasedSource::RELEASE, released_state.source());
 }
+
+/**
+ * There can be tens of millions of logs on a storage node, most of them idle.
+ * Keep an eye on what each of them costs when nothing but the map entry is
+ * created.
+ */
+TEST(LogStorageStateMapTest, MemoryPerLog) {
+  const size_t nlogs = 100000;
+  LogStorageStateMap map(1);
+  for (size_t i = 1; i <= nlogs; ++i) {
+    ASSERT_NE(nullptr, map.insertOrGet(logid_t(i), THIS_SHARD));
+  }
+  for (size_t i = 1; i <= nlogs; ++i) {
+    LogStorageState* state = map.find(logid_t(i), THIS_SHARD);
+    ASSERT_NE(nullptr, state);
+    ASSERT_EQ(logid_t(i), state->getLogID());
+  }
+  EXPECT_EQ(nullptr, map.find(logid_t(nlogs + 1), THIS_SHARD));
+
+  ld_info("sizeof(LogStorageState) = %lu, memory per log = %lu bytes",
+          sizeof(LogStorageState),
+          map.getMemoryUsage() / nlogs);
+  EXPECT_LE(sizeof(LogStorageState), 192);
+  EXPECT_LE(map.getMemoryUsage() / nlogs, 256);
+}
+
+// State allocated on demand for a log is counted once it exists.
+TEST(LogStorageStateMapTest, MemoryUsageCountsRareState) {
+  LogStorageStateMap map(1);
+  LogStorageState* state = map.insertOrGet(logid_t(1), THIS_SHARD);
+  ASSERT_NE(nullptr, state);
+  const size_t before = map.getMemoryUsage();
+  EXPECT_EQ(0, state->getOutOfLineMemoryUsage());
+
+  state->updateEpochOffset(std::make_pair(epoch_t(3), 100));
+  EXPECT_GT(state->getOutOfLineMemoryUsage(), 0);
+  EXPECT_EQ(before + state->getOutOfLineMemoryUsage(), map.getMemoryUsage());
+}
+
+TEST(LogStorageStateMapTest, EpochOffset) {
+  LogStorageStateMap map(1);
+  LogStorageState log_state(logid_t(42), THIS_SHARD, &map);
+
+  EXPECT_FALSE(log_state.getEpochOffset().hasValue());
+  log_state.updateEpochOffset(std::make_pair(epoch_t(3), 100));
+  auto offset = log_state.getEpochOffset();
+  ASSERT_TRUE(offset.hasValue());
+  EXPECT_EQ(epoch_t(3), offset.value().first);
+  EXPECT_EQ(100, offset.value().second);
+}
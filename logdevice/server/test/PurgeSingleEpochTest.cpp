@@ -166,7 +166,7 @@ TEST_F(PurgeSingleEpochTest, Basic) {
   EpochRecoveryMetadata md(epoch_t(9), esn_t(10), esn_t(11), 0, 0, 0);
   EpochRecoveryStateMap map{{8, {E::OK, md}}};
   purge_->onGetEpochRecoveryMetadataComplete(E::OK, map);
-  CHECK_STORAGE_TASK(PurgeDeleteRecordsStorageTask);
+  CHECK_STORAGE_TASK(PurgeDeleteRecordsByKeysStorageTask);
   purge_->onPurgeRecordsTaskDone(E::OK);
   CHECK_STORAGE_TASK(PurgeWriteEpochRecoveryMetadataStorageTask);
   purge_->onWriteEpochRecoveryMetadataDone(E::OK);
@@ -182,7 +182,7 @@ TEST_F(PurgeSingleEpochTest, ERMKnown) {
   setUp();
   purge_->start();
   ASSERT_FALSE(GetERMRequestPosted_);
-  CHECK_STORAGE_TASK(PurgeDeleteRecordsStorageTask);
+  CHECK_STORAGE_TASK(PurgeDeleteRecordsByKeysStorageTask);
   purge_->onPurgeRecordsTaskDone(E::OK);
   CHECK_STORAGE_TASK(PurgeWriteEpochRecoveryMetadataStorageTask);
   purge_->onWriteEpochRecoveryMetadataDone(E::OK);
@@ -261,6 +261,25 @@ TEST_F(PurgeSingleEpochTest, DeleteRecordsByKey) {
   ASSERT_EQ(0, stats.get().purging_v2_delete_by_reading_data);
 }
 
+TEST_F(PurgeSingleEpochTest, DeleteRecordsByKeysWriteOps) {
+  ASSERT_TRUE(
+      PurgeDeleteRecordsStorageTask::deleteByKeys(esn_t(2), esn_t(4097)));
+  ASSERT_FALSE(
+      PurgeDeleteRecordsStorageTask::deleteByKeys(esn_t(2), esn_t(4098)));
+
+  PurgeDeleteRecordsByKeysStorageTask task(
+      LOG_ID, epoch_t(2), esn_t(5), esn_t(9), WeakRef<PurgeSingleEpoch>());
+  ASSERT_EQ(5, task.getNumWriteOps());
+  std::vector<const WriteOp*> ops(task.getNumWriteOps());
+  ASSERT_EQ(ops.size(), task.getWriteOps(ops.data(), ops.size()));
+  for (size_t i = 0; i < ops.size(); ++i) {
+    ASSERT_EQ(WriteType::DELETE, ops[i]->getType());
+    auto op = static_cast<const DeleteWriteOp*>(ops[i]);
+    EXPECT_EQ(LOG_ID, op->log_id);
+    EXPECT_EQ(lsn(2, 5 + i), op->lsn);
+  }
+}
+
 TEST_F(PurgeSingleEpochTest, DeleteRecordsByReadingData) {
   TemporaryRocksDBStore store;
   StatsHolder stats(StatsParams().setIsServer(true));
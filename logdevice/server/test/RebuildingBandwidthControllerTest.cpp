@@ -0,0 +1,116 @@
+/**
+ * Copyright (c) 2017-present, Facebook, Inc. and its affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+#include "logdevice/server/rebuilding/RebuildingBandwidthController.h"
+
+#include <gtest/gtest.h>
+
+#include "logdevice/common/settings/util.h"
+
+using namespace facebook::logdevice;
+using std::chrono::milliseconds;
+
+namespace {
+
+RebuildingSettings makeSettings(bool enabled, double min_fraction = 0.05) {
+  auto settings = create_default_settings<RebuildingSettings>();
+  settings.throttle_on_overload = enabled;
+  settings.throttle_min_fraction = min_fraction;
+  return settings;
+}
+
+} // namespace
+
+TEST(RebuildingBandwidthControllerTest, DisabledByDefault) {
+  auto settings = create_default_settings<RebuildingSettings>();
+  RebuildingBandwidthController controller;
+  controller.onStoreReply(true, settings);
+  EXPECT_EQ(1.0, controller.getThrottleFactor(settings));
+  EXPECT_EQ(100u, controller.scaleLimit(size_t(100), settings));
+}
+
+TEST(RebuildingBandwidthControllerTest, DecreaseAndRecover) {
+  auto settings = makeSettings(true);
+  RebuildingBandwidthController controller;
+  SteadyTimestamp now = SteadyTimestamp::now();
+
+  controller.onStoreReply(true, settings, now);
+  EXPECT_EQ(0.5, controller.getThrottleFactor(settings));
+  EXPECT_EQ(50u, controller.scaleLimit(size_t(100), settings));
+
+  // Overloaded replies within kDecreaseInterval of the last decrease count
+  // as the same episode.
+  controller.onStoreReply(true, settings, now + milliseconds(10));
+  EXPECT_EQ(0.5, controller.getThrottleFactor(settings));
+
+  now += RebuildingBandwidthController::kDecreaseInterval;
+  controller.onStoreReply(true, settings, now);
+  EXPECT_EQ(0.25, controller.getThrottleFactor(settings));
+
+  // Successful replies bring the factor back up, but not above 1.
+  for (int i = 0; i < 100; ++i) {
+    now += RebuildingBandwidthController::kIncreaseInterval;
+    controller.onStoreReply(false, settings, now);
+  }
+  EXPECT_EQ(1.0, controller.getThrottleFactor(settings));
+}
+
+// The factor increases once per kIncreaseInterval however many replies come
+// in, here 10 per millisecond.
+TEST(RebuildingBandwidthControllerTest, IncreasePerInterval) {
+  auto settings = makeSettings(true);
+  RebuildingBandwidthController controller;
+  SteadyTimestamp now = SteadyTimestamp::now();
+  controller.onStoreReply(true, settings, now);
+  controller.onStoreReply(true, settings, now + milliseconds(100));
+  now += milliseconds(100);
+  ASSERT_EQ(0.25, controller.getThrottleFactor(settings));
+
+  auto run = [&](int ms) {
+    for (int i = 0; i < ms; ++i) {
+      now += milliseconds(1);
+      for (int j = 0; j < 10; ++j) {
+        controller.onStoreReply(false, settings, now);
+      }
+    }
+  };
+
+  // Nothing during the interval that follows a decrease.
+  run(99);
+  EXPECT_EQ(0.25, controller.getThrottleFactor(settings));
+  run(1);
+  EXPECT_NEAR(0.26, controller.getThrottleFactor(settings), 1e-9);
+
+  // 10 more steps in the next second.
+  run(1000);
+  EXPECT_NEAR(0.36, controller.getThrottleFactor(settings), 1e-9);
+
+  // An overloaded reply still halves it right away.
+  controller.onStoreReply(true, settings, now);
+  EXPECT_NEAR(0.18, controller.getThrottleFactor(settings), 1e-9);
+
+  // Full speed in well under 10s.
+  run(9000);
+  EXPECT_EQ(1.0, controller.getThrottleFactor(settings));
+}
+
+TEST(RebuildingBandwidthControllerTest, MinFraction) {
+  auto settings = makeSettings(true, 0.1);
+  RebuildingBandwidthController controller;
+  SteadyTimestamp now = SteadyTimestamp::now();
+  for (int i = 0; i < 10; ++i) {
+    controller.onStoreReply(true, settings, now);
+    now += RebuildingBandwidthController::kDecreaseInterval;
+  }
+  EXPECT_DOUBLE_EQ(0.1, controller.getThrottleFactor(settings));
+  // Limits never go below 1.
+  EXPECT_EQ(1u, controller.scaleLimit(size_t(5), settings));
+
+  // Raising the minimum applies right away.
+  settings.throttle_min_fraction = 0.5;
+  EXPECT_EQ(0.5, controller.getThrottleFactor(settings));
+}
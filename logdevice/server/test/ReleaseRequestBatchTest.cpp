@@ -0,0 +1,112 @@
+/**
+ * Copyright (c) 2017-present, Facebook, Inc. and its affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+#include <memory>
+#include <set>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "logdevice/common/util.h"
+#include "logdevice/include/Err.h"
+#include "logdevice/server/ReleaseRequest.h"
+
+using namespace facebook::logdevice;
+
+namespace {
+
+struct Retry {
+  worker_id_t target;
+  ReleaseRequest::Release release;
+};
+
+class MockReleaseRequestBatch : public ReleaseRequestBatch {
+ public:
+  explicit MockReleaseRequestBatch(size_t nworkers)
+      : ReleaseRequestBatch(nworkers) {}
+
+  // Workers whose request pipe is full.
+  std::set<worker_id_t> full_workers;
+
+  std::vector<std::unique_ptr<ReleaseRequest>> posted;
+  std::vector<Retry> retries;
+
+ protected:
+  int postRequest(std::unique_ptr<Request>& req) override {
+    auto& release_req = checked_downcast<ReleaseRequest&>(*req);
+    if (full_workers.count(worker_id_t(release_req.getThreadAffinity(0)))) {
+      err = E::NOBUFS;
+      return -1;
+    }
+    req.release();
+    posted.emplace_back(&release_req);
+    return 0;
+  }
+
+  void retry(worker_id_t target,
+             const ReleaseRequest::Release& release) override {
+    retries.push_back(Retry{target, release});
+  }
+};
+
+ReleaseRequest::Release release(logid_t::raw_type log,
+                                esn_t::raw_type esn,
+                                bool force = false) {
+  return ReleaseRequest::Release{
+      RecordID(esn_t(esn), epoch_t(1), logid_t(log)), 0, force};
+}
+
+} // namespace
+
+// Each worker gets a single request with all of its releases, in order.
+TEST(ReleaseRequestBatchTest, OneRequestPerWorker) {
+  MockReleaseRequestBatch batch(3);
+  batch.add(worker_id_t(0), release(1, 10));
+  batch.add(worker_id_t(2), release(2, 20));
+  batch.add(worker_id_t(0), release(3, 30));
+  // The destructor doesn't see the mock's overrides, post explicitly.
+  batch.post();
+
+  ASSERT_EQ(2, batch.posted.size());
+  EXPECT_EQ(0, batch.posted[0]->getThreadAffinity(3));
+  const auto& w0 = batch.posted[0]->getReleases();
+  ASSERT_EQ(2, w0.size());
+  EXPECT_EQ(logid_t(1), w0[0].rid.logid);
+  EXPECT_EQ(logid_t(3), w0[1].rid.logid);
+
+  EXPECT_EQ(2, batch.posted[1]->getThreadAffinity(3));
+  const auto& w2 = batch.posted[1]->getReleases();
+  ASSERT_EQ(1, w2.size());
+  EXPECT_EQ(RecordID(esn_t(20), epoch_t(1), logid_t(2)), w2[0].rid);
+  EXPECT_TRUE(batch.retries.empty());
+
+  // The batch is empty after posting.
+  batch.post();
+  EXPECT_EQ(2, batch.posted.size());
+}
+
+// Releases for a worker whose request can't be posted are retried one by one
+// for that worker.
+TEST(ReleaseRequestBatchTest, RetryOnPostFailure) {
+  MockReleaseRequestBatch batch(2);
+  batch.full_workers.insert(worker_id_t(1));
+  batch.add(worker_id_t(0), release(1, 10));
+  batch.add(worker_id_t(1), release(2, 20));
+  batch.add(worker_id_t(1), release(3, 30, true));
+  batch.post();
+
+  ASSERT_EQ(1, batch.posted.size());
+  EXPECT_EQ(0, batch.posted[0]->getThreadAffinity(2));
+
+  ASSERT_EQ(2, batch.retries.size());
+  EXPECT_EQ(worker_id_t(1), batch.retries[0].target);
+  EXPECT_EQ(logid_t(2), batch.retries[0].release.rid.logid);
+  EXPECT_FALSE(batch.retries[0].release.force);
+  EXPECT_EQ(worker_id_t(1), batch.retries[1].target);
+  EXPECT_EQ(logid_t(3), batch.retries[1].release.rid.logid);
+  EXPECT_TRUE(batch.retries[1].release.force);
+}
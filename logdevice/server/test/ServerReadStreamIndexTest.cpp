@@ -0,0 +1,157 @@
+/**
+ * Copyright (c) 2017-present, Facebook, Inc. and its affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+#include "logdevice/server/read_path/ServerReadStreamIndex.h"
+
+#include <map>
+#include <random>
+#include <set>
+#include <tuple>
+
+#include <gtest/gtest.h>
+
+using namespace facebook::logdevice;
+
+namespace {
+
+using Key = std::tuple<logid_t, ClientID, read_stream_id_t, shard_index_t>;
+using LogShardSet = std::set<std::pair<logid_t, shard_index_t>>;
+
+std::unique_ptr<ServerReadStream> makeStream(const Key& key) {
+  return std::make_unique<ServerReadStream>(std::get<2>(key),
+                                            std::get<1>(key),
+                                            std::get<0>(key),
+                                            std::get<3>(key));
+}
+
+Key keyOf(const ServerReadStream& stream) {
+  return Key(stream.log_id_, stream.client_id_, stream.id_, stream.shard_);
+}
+
+// Checks every way of looking up streams in `index' against `model'.
+void verify(const ServerReadStreamIndex& index,
+            const std::map<Key, ServerReadStream*>& model) {
+  ASSERT_EQ(model.size(), index.size());
+
+  std::set<Key> all;
+  index.forEach([&](ServerReadStream& s) { all.insert(keyOf(s)); });
+  ASSERT_EQ(model.size(), all.size());
+
+  std::map<logid_t, std::set<Key>> by_log;
+  std::map<ClientID, std::set<Key>> by_client;
+  for (const auto& kv : model) {
+    const Key& key = kv.first;
+    ASSERT_EQ(kv.second,
+              index.find(std::get<0>(key),
+                         std::get<1>(key),
+                         std::get<2>(key),
+                         std::get<3>(key)));
+    ASSERT_TRUE(index.hasStreams(std::get<0>(key), std::get<3>(key)));
+    by_log[std::get<0>(key)].insert(key);
+    by_client[std::get<1>(key)].insert(key);
+  }
+  for (const auto& kv : by_log) {
+    std::set<Key> got;
+    index.forEachInLog(
+        kv.first, [&](ServerReadStream& s) { got.insert(keyOf(s)); });
+    ASSERT_EQ(kv.second, got);
+  }
+  for (const auto& kv : by_client) {
+    std::set<Key> got;
+    index.forEachForClient(
+        kv.first, [&](ServerReadStream& s) { got.insert(keyOf(s)); });
+    ASSERT_EQ(kv.second, got);
+  }
+}
+
+} // namespace
+
+TEST(ServerReadStreamIndexTest, Basic) {
+  ServerReadStreamIndex index;
+  const Key k1(logid_t(1), ClientID(1), read_stream_id_t(1), 0);
+  const Key k2(logid_t(1), ClientID(2), read_stream_id_t(1), 0);
+  const Key k3(logid_t(2), ClientID(1), read_stream_id_t(2), 1);
+
+  EXPECT_EQ(nullptr,
+            index.find(logid_t(1), ClientID(1), read_stream_id_t(1), 0));
+  EXPECT_FALSE(index.hasStreams(logid_t(1), 0));
+
+  std::map<Key, ServerReadStream*> model;
+  for (const Key& k : {k1, k2, k3}) {
+    model[k] = index.insert(makeStream(k));
+  }
+  verify(index, model);
+  EXPECT_FALSE(index.hasStreams(logid_t(1), 1));
+  EXPECT_FALSE(index.hasStreams(logid_t(3), 0));
+
+  EXPECT_FALSE(index.erase(logid_t(1), ClientID(1), read_stream_id_t(1), 1));
+  EXPECT_TRUE(index.erase(logid_t(1), ClientID(1), read_stream_id_t(1), 0));
+  model.erase(k1);
+  verify(index, model);
+
+  auto erased = index.eraseAllForClient(ClientID(1));
+  ASSERT_EQ(1u, erased.size());
+  EXPECT_EQ(logid_t(2), erased[0].first);
+  EXPECT_EQ(1, erased[0].second);
+  model.erase(k3);
+  verify(index, model);
+  EXPECT_FALSE(index.hasStreams(logid_t(2), 1));
+
+  index.clear();
+  model.clear();
+  verify(index, model);
+}
+
+// Random inserts and erases, checked against a std::map.  Few distinct logs
+// and clients so that lists get long and heads get erased often; many
+// streams so that the tables grow and collide.
+TEST(ServerReadStreamIndexTest, Random) {
+  std::mt19937 rng(0xbeef);
+  ServerReadStreamIndex index;
+  std::map<Key, ServerReadStream*> model;
+
+  auto random_key = [&] {
+    return Key(logid_t(rng() % 50 + 1),
+               ClientID(rng() % 20 + 1),
+               read_stream_id_t(rng() % 10 + 1),
+               rng() % 2);
+  };
+
+  for (int i = 0; i < 20000; ++i) {
+    const int op = rng() % 10;
+    if (op < 6) {
+      Key key = random_key();
+      if (!model.count(key)) {
+        model[key] = index.insert(makeStream(key));
+      }
+    } else if (op < 9) {
+      Key key = random_key();
+      EXPECT_EQ(model.erase(key) > 0,
+                index.erase(std::get<0>(key),
+                            std::get<1>(key),
+                            std::get<2>(key),
+                            std::get<3>(key)));
+    } else {
+      ClientID client(rng() % 20 + 1);
+      LogShardSet expected;
+      for (auto it = model.begin(); it != model.end();) {
+        if (std::get<1>(it->first) == client) {
+          expected.emplace(std::get<0>(it->first), std::get<3>(it->first));
+          it = model.erase(it);
+        } else {
+          ++it;
+        }
+      }
+      auto erased = index.eraseAllForClient(client);
+      EXPECT_EQ(expected, LogShardSet(erased.begin(), erased.end()));
+    }
+    if (i % 1000 == 0) {
+      verify(index, model);
+    }
+  }
+  verify(index, model);
+}
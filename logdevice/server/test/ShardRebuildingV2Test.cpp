@@ -0,0 +1,368 @@
+/**
+ * Copyright (c) 2017-present, Facebook, Inc. and its affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "logdevice/common/configuration/LocalLogsConfig.h"
+#include "logdevice/common/configuration/UpdateableConfig.h"
+#include "logdevice/common/debug.h"
+#include "logdevice/common/settings/util.h"
+#include "logdevice/common/test/MockBackoffTimer.h"
+#include "logdevice/common/test/TestUtil.h"
+#include "logdevice/server/rebuilding/ShardRebuildingV2.h"
+
+using namespace facebook::logdevice;
+
+namespace {
+
+const shard_index_t kShard = 0;
+const size_t kNumNodes = 10;
+const size_t KB = 1024;
+
+using ChunkData = RebuildingReadStorageTaskV2::ChunkData;
+
+RecordTimestamp ts(int64_t ms) {
+  return RecordTimestamp(std::chrono::milliseconds(ms));
+}
+
+// A chunk of a single record of `bytes` bytes.
+std::unique_ptr<ChunkData> chunk(logid_t log, size_t block_id, size_t bytes) {
+  auto data = std::make_unique<ChunkData>();
+  data->logID = log;
+  data->blockID = block_id;
+  void* blob = malloc(bytes);
+  ld_check(blob);
+  data->records.emplace_back(compose_lsn(epoch_t(3), esn_t(block_id + 1)),
+                             Slice(blob, bytes),
+                             /* owned payload */ true);
+  data->totalBytes = bytes;
+  return data;
+}
+
+// Doesn't re-replicate anything, finishes when the test says so.
+class MockChunkRebuilding : public ChunkRebuilding {
+ public:
+  MockChunkRebuilding(ShardRebuildingV2* owner,
+                      std::unique_ptr<ChunkData> data,
+                      std::shared_ptr<ReplicationScheme> replication,
+                      size_t& destroyed)
+      : ChunkRebuilding(owner,
+                        kShard,
+                        std::move(data),
+                        std::move(replication)),
+        shard_rebuilding_(owner),
+        destroyed_(destroyed) {}
+  ~MockChunkRebuilding() override {
+    ++destroyed_;
+  }
+
+  void start() override {}
+
+  void finish() {
+    shard_rebuilding_->onChunkRebuildingDone(this);
+  }
+
+ private:
+  ShardRebuildingV2* shard_rebuilding_;
+  size_t& destroyed_;
+};
+
+struct TestListener : public ShardRebuildingInterface::Listener {
+  void onShardRebuildingComplete(uint32_t shard_idx) override {
+    EXPECT_EQ(kShard, shard_idx);
+    EXPECT_FALSE(complete);
+    complete = true;
+  }
+  void notifyShardDonorProgress(uint32_t shard_idx,
+                                RecordTimestamp next_ts,
+                                lsn_t /*version*/) override {
+    EXPECT_EQ(kShard, shard_idx);
+    progress.push_back(next_ts);
+  }
+
+  bool complete = false;
+  std::vector<RecordTimestamp> progress;
+};
+
+class MockShardRebuildingV2 : public ShardRebuildingV2 {
+ public:
+  MockShardRebuildingV2(std::shared_ptr<const RebuildingSet> rebuilding_set,
+                        UpdateableSettings<RebuildingSettings> settings,
+                        std::shared_ptr<UpdateableConfig> config,
+                        Listener* listener,
+                        const Settings& server_settings,
+                        size_t& chunks_destroyed)
+      : ShardRebuildingV2(kShard,
+                          /*rebuilding_version=*/1,
+                          /*restart_version=*/1,
+                          std::move(rebuilding_set),
+                          /*store=*/nullptr,
+                          std::move(settings),
+                          std::move(config),
+                          listener),
+        settings_(server_settings),
+        chunksDestroyed_(chunks_destroyed) {}
+
+  void fireCleanupTimer() {
+    ASSERT_TRUE(cleanupTimerActive);
+    cleanupTimerActive = false;
+    onCleanupTimer();
+  }
+
+  std::vector<std::unique_ptr<RebuildingReadStorageTaskV2>> tasks;
+  // Chunks created, in order. Only valid until destroyed.
+  std::vector<MockChunkRebuilding*> chunks;
+  bool cleanupTimerActive = false;
+
+ protected:
+  StatsHolder* getStats() override {
+    return nullptr;
+  }
+
+  void
+  putStorageTask(std::unique_ptr<RebuildingReadStorageTaskV2> task) override {
+    tasks.push_back(std::move(task));
+  }
+
+  const Settings& getSettings() const override {
+    return settings_;
+  }
+
+  std::unique_ptr<ChunkRebuilding> createChunkRebuilding(
+      std::unique_ptr<ChunkData> data,
+      std::shared_ptr<ReplicationScheme> replication) override {
+    auto chunk = std::make_unique<MockChunkRebuilding>(
+        this, std::move(data), std::move(replication), chunksDestroyed_);
+    chunks.push_back(chunk.get());
+    return std::move(chunk);
+  }
+
+  std::unique_ptr<BackoffTimer>
+  createReadRetryTimer(std::function<void()> callback) override {
+    auto timer = std::make_unique<MockBackoffTimer>();
+    timer->setCallback(std::move(callback));
+    return std::move(timer);
+  }
+
+  std::unique_ptr<LibeventTimer> createCleanupTimer() override {
+    return nullptr;
+  }
+
+  void activateCleanupTimer() override {
+    cleanupTimerActive = true;
+  }
+
+ private:
+  const Settings& settings_;
+  size_t& chunksDestroyed_;
+};
+
+} // namespace
+
+class ShardRebuildingV2Test : public ::testing::Test {
+ public:
+  ShardRebuildingV2Test()
+      : config_(std::make_shared<UpdateableConfig>()),
+        rebuilding_settings_(create_default_settings<RebuildingSettings>()),
+        settings_(create_default_settings<Settings>()) {
+    dbg::assertOnData = true;
+    rebuilding_settings_.total_log_rebuilding_size_per_shard_mb = 1;
+  }
+
+  void init(logid_t::raw_type nlogs) {
+    updateConfig(nlogs);
+    auto rebuilding_set = std::make_shared<RebuildingSet>();
+    rebuilding_set->shards.emplace(
+        ShardID(1, 0), RebuildingNodeInfo(RebuildingMode::RESTORE));
+    rebuilding_ = std::make_unique<MockShardRebuildingV2>(
+        rebuilding_set,
+        UpdateableSettings<RebuildingSettings>(rebuilding_settings_),
+        config_,
+        &listener_,
+        settings_,
+        chunks_destroyed_);
+    nlogs_ = nlogs;
+  }
+
+  void start() {
+    StorageSet storage_set;
+    for (node_index_t n = 0; n < kNumNodes; ++n) {
+      storage_set.push_back(ShardID(n, 0));
+    }
+    auto metadata = std::make_shared<EpochMetaData>(
+        storage_set,
+        ReplicationProperty({{NodeLocationScope::NODE, 3}}),
+        epoch_t(1),
+        epoch_t(1));
+
+    std::unordered_map<logid_t, std::unique_ptr<RebuildingPlan>> plan;
+    for (logid_t::raw_type log = 1; log <= nlogs_; ++log) {
+      auto p = std::make_unique<RebuildingPlan>();
+      p->addEpochRange(EPOCH_MIN, epoch_t(10), metadata);
+      plan.emplace(logid_t(log), std::move(p));
+    }
+    rebuilding_->start(std::move(plan));
+  }
+
+  // Config with logs [1, nlogs].
+  void updateConfig(logid_t::raw_type nlogs) {
+    if (!config_->getServerConfig()) {
+      Configuration::Nodes nodes;
+      for (node_index_t i = 0; i < kNumNodes; ++i) {
+        Configuration::Node& node = nodes[i];
+        node.address = Sockaddr(
+            get_localhost_address_str(), folly::to<std::string>(4440 + i));
+        node.generation = 1;
+        node.addStorageRole();
+      }
+      Configuration::NodesConfig nodes_config(std::move(nodes));
+      Configuration::MetaDataLogsConfig meta_config =
+          createMetaDataLogsConfig(nodes_config, kNumNodes, 3);
+      auto server_config =
+          ServerConfig::fromData(__FILE__, nodes_config, meta_config);
+      server_config->setMyNodeID(NodeID(0, 1));
+      config_->updateableServerConfig()->update(std::move(server_config));
+    }
+
+    auto logs_config = std::make_unique<configuration::LocalLogsConfig>();
+    Configuration::Log log{};
+    log.replicationFactor = 3;
+    log.rangeName = "mylogs";
+    logs_config->insert(
+        boost::icl::right_open_interval<logid_t::raw_type>(1, nlogs + 1), log);
+    config_->updateableLogsConfig()->update(std::move(logs_config));
+  }
+
+  // Completes the read task in flight.
+  void onReadTaskDone(std::vector<std::unique_ptr<ChunkData>> chunks,
+                      RecordTimestamp next_ts,
+                      bool reached_end = false) {
+    ASSERT_EQ(1, rebuilding_->tasks.size());
+    auto task = std::move(rebuilding_->tasks[0]);
+    rebuilding_->tasks.clear();
+    task->context->nextTimestamp = next_ts;
+    task->context->reachedEnd = reached_end;
+    task->chunks = std::move(chunks);
+    rebuilding_->onReadTaskDone(*task);
+  }
+
+  // Chunks of 600KB, given as pairs of log id and block id.
+  std::vector<std::unique_ptr<ChunkData>>
+  chunks(std::vector<std::pair<logid_t::raw_type, size_t>> ids = {}) {
+    std::vector<std::unique_ptr<ChunkData>> res;
+    for (const auto& id : ids) {
+      res.push_back(chunk(logid_t(id.first), id.second, 600 * KB));
+    }
+    return res;
+  }
+
+  std::shared_ptr<UpdateableConfig> config_;
+  RebuildingSettings rebuilding_settings_;
+  Settings settings_;
+  TestListener listener_;
+  size_t chunks_destroyed_ = 0;
+  logid_t::raw_type nlogs_ = 0;
+  std::unique_ptr<MockShardRebuildingV2> rebuilding_;
+};
+
+// Reading stops at the end of the global window, and donor progress is
+// reported so that the window can slide.
+TEST_F(ShardRebuildingV2Test, WaitsOnGlobalWindow) {
+  init(1);
+  rebuilding_->advanceGlobalWindow(ts(10000));
+  start();
+  ASSERT_EQ(1, rebuilding_->tasks.size());
+  EXPECT_EQ(ts(10000), rebuilding_->tasks[0]->context->windowEnd);
+
+  // The next partition starts after the window.
+  onReadTaskDone(chunks({{1, 0}}), ts(20000));
+  EXPECT_EQ(1, rebuilding_->chunks.size());
+  EXPECT_TRUE(rebuilding_->tasks.empty());
+  EXPECT_EQ(std::vector<RecordTimestamp>{ts(20000)}, listener_.progress);
+
+  // Not far enough. Progress isn't reported again.
+  rebuilding_->advanceGlobalWindow(ts(15000));
+  EXPECT_TRUE(rebuilding_->tasks.empty());
+  EXPECT_EQ(1, listener_.progress.size());
+
+  rebuilding_->advanceGlobalWindow(ts(30000));
+  ASSERT_EQ(1, rebuilding_->tasks.size());
+  EXPECT_EQ(ts(30000), rebuilding_->tasks[0]->context->windowEnd);
+
+  // Done reading, but a chunk is still in flight.
+  onReadTaskDone(chunks(), RecordTimestamp::max(), /*reached_end=*/true);
+  EXPECT_TRUE(rebuilding_->tasks.empty());
+  EXPECT_FALSE(listener_.complete);
+
+  // The chunk is destroyed asynchronously.
+  rebuilding_->chunks[0]->finish();
+  EXPECT_EQ(0, chunks_destroyed_);
+  EXPECT_FALSE(listener_.complete);
+  rebuilding_->fireCleanupTimer();
+  EXPECT_EQ(1, chunks_destroyed_);
+  EXPECT_TRUE(listener_.complete);
+}
+
+// Reading pauses while chunks in flight take more than
+// total_log_rebuilding_size_per_shard_mb.
+TEST_F(ShardRebuildingV2Test, BytesInFlightLimit) {
+  init(1);
+  rebuilding_->advanceGlobalWindow(RecordTimestamp::max());
+  start();
+  onReadTaskDone(chunks({{1, 0}}), ts(0));
+  // 600KB in flight.
+  ASSERT_EQ(1, rebuilding_->tasks.size());
+  onReadTaskDone(chunks({{1, 1}}), ts(0));
+  // 1.2MB in flight.
+  EXPECT_TRUE(rebuilding_->tasks.empty());
+
+  rebuilding_->chunks[1]->finish();
+  rebuilding_->fireCleanupTimer();
+  ASSERT_EQ(1, rebuilding_->tasks.size());
+  onReadTaskDone(chunks({{1, 2}, {1, 3}}), ts(0), /*reached_end=*/true);
+  EXPECT_TRUE(rebuilding_->tasks.empty());
+
+  for (size_t i : {0, 2, 3}) {
+    rebuilding_->chunks[i]->finish();
+  }
+  EXPECT_FALSE(listener_.complete);
+  rebuilding_->fireCleanupTimer();
+  EXPECT_EQ(4, chunks_destroyed_);
+  EXPECT_TRUE(listener_.complete);
+}
+
+// Chunks of logs removed from the config are aborted and stop counting
+// towards the bytes in flight; further records of those logs are skipped.
+TEST_F(ShardRebuildingV2Test, LogsRemovedFromConfig) {
+  init(2);
+  rebuilding_->advanceGlobalWindow(RecordTimestamp::max());
+  start();
+  onReadTaskDone(chunks({{1, 0}, {2, 1}}), ts(0));
+  ASSERT_EQ(2, rebuilding_->chunks.size());
+  EXPECT_TRUE(rebuilding_->tasks.empty());
+
+  updateConfig(1);
+  rebuilding_->noteConfigurationChanged();
+  EXPECT_EQ(1, chunks_destroyed_);
+  // 600KB in flight, below the limit.
+  ASSERT_EQ(1, rebuilding_->tasks.size());
+
+  onReadTaskDone(chunks({{2, 2}, {1, 3}}), ts(0), /*reached_end=*/true);
+  ASSERT_EQ(3, rebuilding_->chunks.size());
+  EXPECT_EQ(logid_t(1), rebuilding_->chunks[2]->getLogID());
+  EXPECT_EQ(3, rebuilding_->chunks[2]->getBlockID());
+
+  rebuilding_->chunks[0]->finish();
+  rebuilding_->chunks[2]->finish();
+  rebuilding_->fireCleanupTimer();
+  EXPECT_EQ(3, chunks_destroyed_);
+  EXPECT_TRUE(listener_.complete);
+}
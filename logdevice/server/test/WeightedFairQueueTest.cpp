@@ -0,0 +1,174 @@
+/**
+ * Copyright (c) 2017-present, Facebook, Inc. and its affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "logdevice/server/storage_tasks/WeightedFairQueue.h"
+
+using namespace facebook::logdevice;
+
+namespace {
+
+struct Task {
+  Task(int id, std::string principal, uint32_t weight = 1)
+      : id(id), principal_(std::move(principal)), fair_share_weight_(weight) {}
+
+  int id;
+  std::string principal_;
+  TrafficClass traffic_class_ = TrafficClass::READ_BACKLOG;
+  uint32_t fair_share_weight_;
+};
+
+class WeightedFairQueueTest : public ::testing::Test {
+ protected:
+  Task* task(int id, std::string principal, uint32_t weight = 1) {
+    tasks_.push_back(std::make_unique<Task>(id, std::move(principal), weight));
+    return tasks_.back().get();
+  }
+
+  std::vector<int> drain(WeightedFairQueue<Task*>& q) {
+    std::vector<int> ids;
+    Task* t;
+    while (q.readIfNotEmpty(t)) {
+      ids.push_back(t->id);
+    }
+    return ids;
+  }
+
+  std::vector<std::unique_ptr<Task>> tasks_;
+};
+
+} // namespace
+
+// Tasks of a single flow come out in FIFO order.
+TEST_F(WeightedFairQueueTest, SingleFlowIsFifo) {
+  WeightedFairQueue<Task*> q(10);
+  for (int i = 1; i <= 5; ++i) {
+    ASSERT_TRUE(q.writeIfNotFull(task(i, "")));
+  }
+  EXPECT_EQ(5, q.size());
+  EXPECT_EQ(std::vector<int>({1, 2, 3, 4, 5}), drain(q));
+  EXPECT_EQ(0, q.size());
+}
+
+// Tasks without a principal take turns with the flows of principals, as one
+// more flow of weight 1.
+TEST_F(WeightedFairQueueTest, UntaggedTasksAreOneFlow) {
+  WeightedFairQueue<Task*> q(100);
+  for (int i = 1; i <= 3; ++i) {
+    q.writeIfNotFull(task(i, "a"));
+  }
+  q.writeIfNotFull(task(11, "b"));
+  q.writeIfNotFull(task(12, "b"));
+  for (int i = 101; i <= 103; ++i) {
+    q.writeIfNotFull(task(i, ""));
+  }
+  EXPECT_EQ(std::vector<int>({101, 1, 11, 102, 2, 12, 103, 3}), drain(q));
+}
+
+// A principal with a deep queue doesn't delay the tasks of another principal
+// queued after it.
+TEST_F(WeightedFairQueueTest, RoundRobinAcrossPrincipals) {
+  WeightedFairQueue<Task*> q(100);
+  for (int i = 1; i <= 5; ++i) {
+    q.writeIfNotFull(task(i, "heavy"));
+  }
+  q.writeIfNotFull(task(101, "light"));
+  q.writeIfNotFull(task(102, "light"));
+  EXPECT_EQ(std::vector<int>({1, 101, 2, 102, 3, 4, 5}), drain(q));
+}
+
+TEST_F(WeightedFairQueueTest, TrafficClassesAreSeparateFlows) {
+  WeightedFairQueue<Task*> q(100);
+  q.writeIfNotFull(task(1, "p"));
+  q.writeIfNotFull(task(2, "p"));
+  Task* tail = task(3, "p");
+  tail->traffic_class_ = TrafficClass::READ_TAIL;
+  q.writeIfNotFull(tail);
+  EXPECT_EQ(std::vector<int>({1, 3, 2}), drain(q));
+}
+
+TEST_F(WeightedFairQueueTest, Weights) {
+  WeightedFairQueue<Task*> q(100);
+  for (int i = 1; i <= 6; ++i) {
+    q.writeIfNotFull(task(i, "a", 3));
+  }
+  for (int i = 101; i <= 103; ++i) {
+    q.writeIfNotFull(task(i, "b", 1));
+  }
+  EXPECT_EQ(std::vector<int>({1, 2, 3, 101, 4, 5, 6, 102, 103}), drain(q));
+}
+
+// A flow that empties loses its place in the round; when it gets new tasks
+// it joins at the back, after the flows already queued.
+TEST_F(WeightedFairQueueTest, FlowRejoinsAtTheBack) {
+  WeightedFairQueue<Task*> q(100);
+  q.writeIfNotFull(task(1, "a"));
+  q.writeIfNotFull(task(2, "b"));
+  q.writeIfNotFull(task(3, "b"));
+  Task* t;
+  ASSERT_TRUE(q.readIfNotEmpty(t));
+  EXPECT_EQ(1, t->id);
+  q.writeIfNotFull(task(4, "a"));
+  q.writeIfNotFull(task(5, "c"));
+  EXPECT_EQ(std::vector<int>({2, 4, 5, 3}), drain(q));
+}
+
+TEST_F(WeightedFairQueueTest, Capacity) {
+  // Tasks with and without a principal share the capacity.
+  WeightedFairQueue<Task*> q(4);
+  EXPECT_TRUE(q.writeIfNotFull(task(1, "a")));
+  EXPECT_TRUE(q.writeIfNotFull(task(2, "b")));
+  EXPECT_TRUE(q.writeIfNotFull(task(101, "")));
+  EXPECT_TRUE(q.writeIfNotFull(task(102, "")));
+  EXPECT_FALSE(q.writeIfNotFull(task(3, "c")));
+  EXPECT_FALSE(q.writeIfNotFull(task(103, "")));
+  EXPECT_EQ(4, q.size());
+  EXPECT_EQ(4u, q.capacity());
+
+  std::vector<int> ids;
+  q.forEach([&](Task*& t) { ids.push_back(t->id); });
+  EXPECT_EQ(std::vector<int>({1, 2, 101, 102}), ids);
+  EXPECT_EQ(4, q.size());
+
+  EXPECT_EQ(std::vector<int>({101, 1, 2, 102}), drain(q));
+  EXPECT_TRUE(q.writeIfNotFull(task(3, "c")));
+  EXPECT_TRUE(q.writeIfNotFull(task(103, "")));
+}
+
+// A blocked writer is woken up by a read of either kind of task.
+TEST_F(WeightedFairQueueTest, BlockingWrite) {
+  WeightedFairQueue<Task*> q(2);
+  ASSERT_TRUE(q.writeIfNotFull(task(1, "a")));
+  ASSERT_TRUE(q.writeIfNotFull(task(101, "")));
+
+  Task* tagged = task(2, "b");
+  Task* untagged = task(102, "");
+  std::thread writer([&] {
+    q.blockingWrite(tagged);
+    q.blockingWrite(untagged);
+  });
+  std::vector<int> ids;
+  Task* t;
+  while (ids.size() < 4) {
+    if (q.readIfNotEmpty(t)) {
+      ids.push_back(t->id);
+    } else {
+      std::this_thread::yield();
+    }
+  }
+  writer.join();
+  std::sort(ids.begin(), ids.end());
+  EXPECT_EQ(std::vector<int>({1, 2, 101, 102}), ids);
+  EXPECT_EQ(0, q.size());
+}
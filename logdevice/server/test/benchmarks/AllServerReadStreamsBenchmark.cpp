@@ -0,0 +1,143 @@
+/**
+ * Copyright (c) 2017-present, Facebook, Inc. and its affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+#include <memory>
+#include <random>
+
+#include <folly/Benchmark.h>
+#include <gflags/gflags.h>
+
+#include "logdevice/common/settings/util.h"
+#include "logdevice/server/read_path/AllServerReadStreams.h"
+#include "logdevice/server/read_path/LogStorageStateMap.h"
+
+using namespace facebook::logdevice;
+
+/**
+ * @file Cost of the RELEASE fan-out and stream lookups of AllServerReadStreams
+ *       with a large number of read streams on a worker.  Streams are spread
+ *       evenly over --logs logs and --clients clients.  onRelease() doesn't
+ *       get to read anything: scheduling for catchup is stubbed out, so what
+ *       is measured is finding and checking the streams of the log.  The
+ *       target is 100k releases/s, i.e. under 10us per iteration of
+ *       OnRelease, with 1M streams.
+ *
+ *       Run with --bm_min_usec=1000000.
+ */
+
+DEFINE_int32(streams, 1000000, "Number of read streams.");
+DEFINE_int32(logs, 100000, "Number of logs the streams read.");
+DEFINE_int32(clients, 1000, "Number of clients the streams belong to.");
+
+namespace {
+
+class BenchAllServerReadStreams : public AllServerReadStreams {
+ public:
+  using AllServerReadStreams::AllServerReadStreams;
+
+  size_t scheduled_{0};
+
+ protected:
+  void scheduleForCatchup(ServerReadStream&,
+                          bool,
+                          CatchupEventTrigger) override {
+    ++scheduled_;
+  }
+};
+
+struct Fixture {
+  Fixture()
+      : map(1),
+        settings(makeSettings()),
+        streams(settings,
+                1ul << 30,
+                worker_id_t(0),
+                &map,
+                nullptr,
+                nullptr,
+                false) {
+    for (int i = 0; i < FLAGS_streams; ++i) {
+      auto res = streams.insertOrGet(ClientID(i % FLAGS_clients + 1),
+                                     logid_t(i % FLAGS_logs + 1),
+                                     0,
+                                     read_stream_id_t(i + 1));
+      ld_check(res.second);
+    }
+  }
+
+  static Settings makeSettings() {
+    Settings s = create_default_settings<Settings>();
+    // Room for the extra stream of InsertErase.
+    s.max_server_read_streams = FLAGS_streams + 1;
+    return s;
+  }
+
+  LogStorageStateMap map;
+  UpdateableSettings<Settings> settings;
+  BenchAllServerReadStreams streams;
+};
+
+// Built once, populating a million streams takes a while.
+Fixture& fixture() {
+  static Fixture* f = new Fixture();
+  return *f;
+}
+
+BENCHMARK(OnRelease, n) {
+  std::mt19937_64 rng;
+  Fixture* f;
+  BENCHMARK_SUSPEND {
+    f = &fixture();
+  }
+  for (unsigned int i = 0; i < n; ++i) {
+    logid_t log(rng() % FLAGS_logs + 1);
+    f->streams.onRelease(RecordID(esn_t(i + 1), epoch_t(1), log), 0, false);
+  }
+  folly::doNotOptimizeAway(f->streams.scheduled_);
+}
+
+BENCHMARK(Get, n) {
+  std::mt19937_64 rng;
+  Fixture* f;
+  BENCHMARK_SUSPEND {
+    f = &fixture();
+  }
+  for (unsigned int i = 0; i < n; ++i) {
+    int s = rng() % FLAGS_streams;
+    folly::doNotOptimizeAway(f->streams.get(ClientID(s % FLAGS_clients + 1),
+                                            logid_t(s % FLAGS_logs + 1),
+                                            read_stream_id_t(s + 1),
+                                            0));
+  }
+}
+
+// A short-lived stream: START followed by STOP.
+BENCHMARK(InsertErase, n) {
+  std::mt19937_64 rng;
+  Fixture* f;
+  BENCHMARK_SUSPEND {
+    f = &fixture();
+  }
+  static uint64_t next_id = FLAGS_streams + 1;
+  for (unsigned int i = 0; i < n; ++i) {
+    ClientID client(rng() % FLAGS_clients + 1);
+    logid_t log(rng() % FLAGS_logs + 1);
+    read_stream_id_t id(next_id++);
+    auto res = f->streams.insertOrGet(client, log, 0, id);
+    folly::doNotOptimizeAway(res);
+    f->streams.erase(client, log, id, 0);
+  }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  folly::runBenchmarks();
+
+  return 0;
+}
@@ -26,7 +26,9 @@ const shard_index_t SHARD_IDX = 0;
 /**
  * @file: a benchmark for testing time spent on accessing LogStorageStateMap
  *        populated with different logids. The performance is directly related
- *        to the internal AtomicHashMap, and specifically, its hash function.
+ *        to the internal LockFreeLogMap, and specifically, its hash function.
+ *        The ReleaseUpdates benchmark adds what a RELEASE does once the
+ *        state is found: advancing the log's last released LSN.
  */
 
 // range 1..100000
@@ -65,6 +67,31 @@ static inline void accessMap(LogStorageStateMap* map,
   }
 }
 
+// Like accessMap() but also advances the last released LSN of the log, as
+// RELEASE messages do.
+static inline void updateReleases(LogStorageStateMap* map,
+                                  int n_threads,
+                                  size_t n_iters) {
+  ld_check(map);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < n_threads; ++i) {
+    threads.emplace_back([map, i, n_iters]() {
+      std::mt19937_64 rnd(i);
+      std::uniform_int_distribution<logid_t::raw_type> dis(1, N_LOGS / 2);
+      for (size_t j = 0; j < n_iters; ++j) {
+        LogStorageState* state = map->find(logid_t(dis(rnd)), SHARD_IDX);
+        ld_check(state);
+        state->updateLastReleasedLSN(
+            j + 1, LogStorageState::LastReleasedSource::RELEASE);
+      }
+    });
+  }
+
+  for (auto& t : threads) {
+    t.join();
+  }
+}
+
 DEFINE_int32(num_threads, 32, "Number of threads for benchmarks.");
 
 BENCHMARK(LogStorageStateMapWithDataLogs, iters) {
@@ -89,6 +116,17 @@ BENCHMARK(LogStorageStateMapWithMetaDataLogs, iters) {
   accessMap(map.get(), FLAGS_num_threads, iters / FLAGS_num_threads);
 }
 
+BENCHMARK(ReleaseUpdates, iters) {
+  std::unique_ptr<LogStorageStateMap> map = nullptr;
+
+  BENCHMARK_SUSPEND {
+    map.reset(new LogStorageStateMap(1));
+    populateLogs(map.get(), false);
+  }
+
+  updateReleases(map.get(), FLAGS_num_threads, iters / FLAGS_num_threads);
+}
+
 BENCHMARK_DRAW_LINE();
 
 int main(int argc, char* argv[]) {
@@ -0,0 +1,167 @@
+/**
+ * Copyright (c) 2017-present, Facebook, Inc. and its affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <folly/Benchmark.h>
+#include <gflags/gflags.h>
+
+#include "logdevice/common/ZeroCopiedRecord.h"
+#include "logdevice/common/protocol/RECORD_Message.h"
+#include "logdevice/server/RealTimeRecordBuffer.h"
+
+using namespace facebook::logdevice;
+
+/**
+ * @file Cost of building the RECORD messages that ship the real time records
+ *       of a log to many tailing read streams, the way CatchupOneStream does:
+ *       a stream points into the buffer of ReleasedRecords::sharePayloads()
+ *       if it gets one, and copies the payload otherwise.  "private" gives
+ *       every stream its own ReleasedRecords, so each stream copies every
+ *       payload, as was the case before payloads were shared; "shared" has
+ *       all streams ship the same ReleasedRecords.  Each iteration builds and
+ *       destroys the messages of one release of --records_per_release
+ *       records; the time per iteration divided by the number of tailers and
+ *       records is the cost per record per stream.
+ *
+ *       Run with --bm_min_usec=1000000.
+ */
+
+DEFINE_int32(payload_size, 1024, "Payload size in bytes.");
+DEFINE_int32(records_per_release, 10, "Records in each ReleasedRecords.");
+
+namespace {
+
+// A record released to real time readers.  The benchmark owns the payload.
+class BenchZeroCopiedRecord : public ZeroCopiedRecord {
+ public:
+  BenchZeroCopiedRecord(lsn_t lsn, Slice payload)
+      : ZeroCopiedRecord(lsn,
+                         0,
+                         0,
+                         esn_t(0),
+                         1,
+                         copyset_t({ShardID(1, 0)}),
+                         BYTE_OFFSET_INVALID,
+                         std::map<KeyType, std::string>(),
+                         payload,
+                         nullptr) {}
+};
+
+std::shared_ptr<ReleasedRecords>
+makeReleasedRecords(lsn_t first_lsn, const std::vector<std::string>& payloads) {
+  std::shared_ptr<ZeroCopiedRecord> entries;
+  for (int i = payloads.size() - 1; i >= 0; --i) {
+    auto entry = std::make_shared<BenchZeroCopiedRecord>(
+        first_lsn + i, Slice(payloads[i].data(), payloads[i].size()));
+    entry->next_ = std::move(entries);
+    entries = std::move(entry);
+  }
+  return std::make_shared<ReleasedRecords>(
+      logid_t(1),
+      first_lsn,
+      first_lsn + payloads.size() - 1,
+      entries,
+      ReleasedRecords::computeBytesEstimate(entries.get()));
+}
+
+void fanout(unsigned int iters, size_t ntailers, bool shared) {
+  std::vector<std::string> payloads;
+  // Stand-ins for the streams, sharePayloads() only compares their address.
+  std::vector<char> streams;
+  std::vector<std::shared_ptr<ReleasedRecords>> released;
+  std::vector<std::unique_ptr<RECORD_Message>> messages;
+  BENCHMARK_SUSPEND {
+    payloads.assign(
+        FLAGS_records_per_release, std::string(FLAGS_payload_size, 'x'));
+    streams.resize(ntailers);
+    released.reserve(ntailers);
+    messages.reserve(ntailers * payloads.size());
+  }
+
+  for (unsigned int i = 0; i < iters; ++i) {
+    const lsn_t first_lsn = lsn_t(i) * payloads.size() + 1;
+    BENCHMARK_SUSPEND {
+      for (size_t t = 0; t < ntailers; ++t) {
+        released.push_back(shared && t > 0
+                               ? released.front()
+                               : makeReleasedRecords(first_lsn, payloads));
+      }
+    }
+
+    for (size_t t = 0; t < ntailers; ++t) {
+      ReleasedRecords& rec = *released[t];
+      size_t offset = 0;
+      for (const ZeroCopiedRecord* entry = rec.entries_.get(); entry;
+           entry = entry->next_.get()) {
+        RECORD_Header header{
+            logid_t(1), read_stream_id_t(t + 1), entry->lsn, 0, 0, 0};
+        Payload payload(entry->payload_raw.data, entry->payload_raw.size);
+        std::shared_ptr<const std::string> owner =
+            rec.sharePayloads(&streams[t]);
+        if (owner) {
+          payload = Payload(owner->data() + offset, payload.size());
+        } else {
+          payload = payload.dup();
+        }
+        offset += entry->payload_raw.size;
+        messages.push_back(std::make_unique<RECORD_Message>(
+            header,
+            TrafficClass::READ_TAIL,
+            std::move(payload),
+            nullptr,
+            RECORD_Message::Source::LOCAL_LOG_STORE,
+            BYTE_OFFSET_INVALID,
+            nullptr,
+            std::move(owner)));
+      }
+    }
+    folly::doNotOptimizeAway(messages.data());
+    messages.clear();
+
+    BENCHMARK_SUSPEND {
+      released.clear();
+    }
+  }
+}
+
+void privatePayloads(unsigned int iters, size_t ntailers) {
+  fanout(iters, ntailers, false);
+}
+
+void sharedPayloads(unsigned int iters, size_t ntailers) {
+  fanout(iters, ntailers, true);
+}
+
+} // namespace
+
+BENCHMARK_NAMED_PARAM(privatePayloads, 1_tailer, 1)
+BENCHMARK_RELATIVE_NAMED_PARAM(sharedPayloads, 1_tailer, 1)
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK_NAMED_PARAM(privatePayloads, 10_tailers, 10)
+BENCHMARK_RELATIVE_NAMED_PARAM(sharedPayloads, 10_tailers, 10)
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK_NAMED_PARAM(privatePayloads, 100_tailers, 100)
+BENCHMARK_RELATIVE_NAMED_PARAM(sharedPayloads, 100_tailers, 100)
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK_NAMED_PARAM(privatePayloads, 1000_tailers, 1000)
+BENCHMARK_RELATIVE_NAMED_PARAM(sharedPayloads, 1000_tailers, 1000)
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  folly::runBenchmarks();
+  return 0;
+}
@@ -0,0 +1,109 @@
+/**
+ * Copyright (c) 2017-present, Facebook, Inc. and its affiliates.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <folly/Benchmark.h>
+#include <gflags/gflags.h>
+
+#include "logdevice/server/storage_tasks/PrioritizedQueue.h"
+
+using namespace facebook::logdevice;
+
+/**
+ * @file Throughput of the storage task queue of a StorageThreadPool, with
+ *       --threads producers writing tasks and as many storage threads
+ *       reading them.  Compares tasks without a principal (writes, internal
+ *       tasks), which take the lock-free path, to read tasks of one and of
+ *       many principals, which are scheduled fairly under a mutex.  An
+ *       iteration is one task going through the queue.
+ *
+ *       Run with --bm_min_usec=1000000.
+ */
+
+DEFINE_int32(threads, 4, "Number of producer and of consumer threads.");
+DEFINE_int32(queue_size, 1000, "Capacity of each priority of the queue.");
+
+namespace {
+
+const size_t NUM_PRIORITIES = 3;
+
+struct BenchTask {
+  size_t getPriority() const {
+    return 1;
+  }
+  size_t getPayloadSize() const {
+    return 0;
+  }
+
+  std::string principal_;
+  TrafficClass traffic_class_ = TrafficClass::READ_BACKLOG;
+  uint32_t fair_share_weight_ = 1;
+};
+
+using Queue = PrioritizedQueue<BenchTask*, NUM_PRIORITIES>;
+
+// Pushes n tasks through the queue.  Tasks are spread over `nprincipals`
+// principals, 0 means that they don't have one.
+void run(unsigned int n, int nprincipals) {
+  std::unique_ptr<Queue> q;
+  std::vector<BenchTask> tasks;
+  BENCHMARK_SUSPEND {
+    q = std::make_unique<Queue>(FLAGS_queue_size, nullptr);
+    tasks.resize(std::max(1, nprincipals));
+    for (int i = 0; i < nprincipals; ++i) {
+      tasks[i].principal_ = "principal" + std::to_string(i);
+    }
+  }
+
+  const int nthreads = FLAGS_threads;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < nthreads; ++t) {
+    const unsigned int count =
+        n / nthreads + (unsigned(t) < n % nthreads ? 1 : 0);
+    threads.emplace_back([&, t, count] {
+      for (unsigned int i = 0; i < count; ++i) {
+        q->blockingWrite(&tasks[(t + i * nthreads) % tasks.size()]);
+      }
+    });
+    threads.emplace_back([&, count] {
+      BenchTask* task;
+      for (unsigned int i = 0; i < count; ++i) {
+        q->blockingRead(task);
+        folly::doNotOptimizeAway(task);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
+
+BENCHMARK(NoPrincipal, n) {
+  run(n, 0);
+}
+
+BENCHMARK_RELATIVE(OnePrincipal, n) {
+  run(n, 1);
+}
+
+BENCHMARK_RELATIVE(HundredPrincipals, n) {
+  run(n, 100);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  folly::runBenchmarks();
+
+  return 0;
+}
@@ -2559,6 +2559,73 @@ TEST_P(RebuildingTest, ReplicationCheckerDuringRebuilding) {
   EXPECT_NE(0, cluster->checkConsistency());
 }
 
+// Rebuilds a node with ShardRebuildingV1 and with ShardRebuildingV2 and
+// compares the throughput of donors. Doesn't assert which one is faster, since
+// in tests records are few and mostly in memtables.
+TEST_F(RebuildingTest, RebuildingV2Throughput) {
+  const int nlogs = 10;
+  const int nrecords_per_log = 200;
+  const node_index_t replaced = 3;
+
+  auto run = [&](bool v2) {
+    auto cluster = IntegrationTestUtils::ClusterFactory()
+                       .apply(commonSetup)
+                       .setLogConfig(logConfig(2))
+                       .setEventLogConfig(logConfig(3))
+                       .setParam("--rebuilding-v2", v2 ? "true" : "false")
+                       .setNumLogs(nlogs)
+                       .create(5);
+    cluster->waitForRecovery();
+    auto client = cluster->createClient();
+
+    ld_info("Writing with rebuilding-v2=%d.", (int)v2);
+    std::string data(1000, 'x');
+    for (int log = 1; log <= nlogs; ++log) {
+      for (int i = 0; i < nrecords_per_log; ++i) {
+        lsn_t lsn = client->appendSync(
+            logid_t(log), Payload(data.data(), data.size()));
+        ASSERT_NE(LSN_INVALID, lsn);
+      }
+    }
+
+    ASSERT_EQ(0, cluster->replace(replaced));
+    auto start_time = std::chrono::steady_clock::now();
+    for (shard_index_t shard = 0; shard < NUM_DB_SHARDS; ++shard) {
+      ASSERT_NE(LSN_INVALID, requestShardRebuilding(*client, replaced, shard));
+    }
+    cluster->getNode(replaced).waitUntilAllShardsFullyAuthoritative(client);
+    double seconds = std::chrono::duration_cast<std::chrono::duration<double>>(
+                         std::chrono::steady_clock::now() - start_time)
+                         .count();
+
+    int64_t bytes = 0;
+    int ndonors = 0;
+    for (node_index_t n = 0; n < 5; ++n) {
+      if (n == replaced) {
+        continue;
+      }
+      auto stats = cluster->getNode(n).stats();
+      bytes += stats["rebuilding_donor_bytes_rebuilt"];
+      ++ndonors;
+    }
+    EXPECT_GT(bytes, 0);
+    ld_info("rebuilding-v2=%d: rebuilt %ld bytes in %.3fs, %.3f MB/s per donor",
+            (int)v2,
+            bytes,
+            seconds,
+            bytes / 1e6 / seconds / ndonors);
+
+    cluster->waitForMetaDataLogWrites();
+    IntegrationTestUtils::Cluster::argv_t check_args = {
+        "--dont-count-bridge-records",
+    };
+    EXPECT_EQ(0, cluster->checkConsistency(check_args));
+  };
+
+  run(false);
+  run(true);
+}
+
 INSTANTIATE_TEST_CASE_P(RebuildingTest,
                         RebuildingTest,
                         ::testing::Values(false, true));
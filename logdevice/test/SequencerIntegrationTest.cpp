@@ -2713,3 +2713,49 @@ TEST_F(SequencerIntegrationTest, MetaDataWritePreempted) {
   int preempted_epoch = folly::to<int>(seq_info["Preempted epoch"]);
   ASSERT_GE(8, preempted_epoch);
 }
+
+// Restarts the only sequencer node of a cluster with many logs, which then
+// recovers all of them at once, and logs how long that takes with and without
+// --batch-seals.
+TEST_F(SequencerIntegrationTest, MassRecoveryTime) {
+  const int nlogs = 1000;
+
+  auto run = [&](bool batch_seals) {
+    auto cluster =
+        IntegrationTestUtils::ClusterFactory()
+            .setNumLogs(nlogs)
+            .setParam("--batch-seals", batch_seals ? "true" : "false")
+            .setParam("--concurrent-log-recoveries", std::to_string(nlogs))
+            .doPreProvisionEpochMetaData()
+            .create(5);
+    ASSERT_EQ(0, cluster->waitForRecovery());
+
+    ld_info("Restarting the sequencer node with batch-seals=%d.",
+            (int)batch_seals);
+    cluster->getNode(0).kill();
+    auto start_time = std::chrono::steady_clock::now();
+    cluster->getNode(0).start();
+    cluster->getNode(0).waitUntilAvailable();
+    ASSERT_EQ(0, cluster->waitForRecovery());
+    double seconds = std::chrono::duration_cast<std::chrono::duration<double>>(
+                         std::chrono::steady_clock::now() - start_time)
+                         .count();
+
+    auto stats = cluster->getNode(0).stats();
+    if (batch_seals) {
+      EXPECT_GT(stats["seal_batches_sent"], 0);
+    } else {
+      EXPECT_EQ(0, stats["seal_batches_sent"]);
+    }
+    ld_info("batch-seals=%d: recovered %d logs in %.3fs, %ld SEALs sent in "
+            "%ld batches",
+            (int)batch_seals,
+            nlogs,
+            seconds,
+            stats["seal_batch_seals_sent"],
+            stats["seal_batches_sent"]);
+  };
+
+  run(false);
+  run(true);
+}